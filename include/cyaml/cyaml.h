@@ -15,6 +15,7 @@
 #define CYAML_H
 
 #include <stdarg.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 
@@ -245,6 +246,18 @@ typedef struct cyaml_schema_value {
 	 * however, they have different sizes.
 	 */
 	uint32_t data_size;
+	/**
+	 * Expected number of sequence entries, or 0 if unknown.
+	 *
+	 * When loading a \ref CYAML_SEQUENCE value with \ref
+	 * CYAML_FLAG_POINTER, space for this many entries is allocated when
+	 * the first entry is read.  Beyond that, the allocation grows
+	 * geometrically.  This is ignored for other types.
+	 *
+	 * \note This is kept outside the type-specific union, where it would
+	 *       make every schema value larger.
+	 */
+	uint32_t seq_expected;
 	/** Anonymous union containing type-specific attributes. */
 	union {
 		/** \ref CYAML_STRING type-specific schema data. */
@@ -416,6 +429,103 @@ typedef enum cyaml_cfg_flags {
 	 * By default, strings are compared with case sensitivity.
 	 */
 	CYAML_CFG_CASE_INSENSITIVE    = (1 << 4),
+	/**
+	 * When loading, allocate the loaded data from an arena.
+	 *
+	 * Rather than making a separate allocation for every pointer value,
+	 * string, and sequence, the loaded data is placed in a small number
+	 * of large chunks, obtained from the client's \ref cyaml_mem_fn_t.
+	 *
+	 * Data loaded with this flag set must be freed with \ref cyaml_free,
+	 * using a config with this flag set.  The whole document is then
+	 * released at once, without walking the schema.  Individual parts of
+	 * the loaded data must not be freed or reallocated by the client.
+	 */
+	CYAML_CFG_ARENA               = (1 << 5),
+	/**
+	 * When loading, trim sequence allocations to fit their entries.
+	 *
+	 * Allocations for \ref CYAML_SEQUENCE values with
+	 * \ref CYAML_FLAG_POINTER grow geometrically as entries are read,
+	 * so they may be up to twice as large as needed.  When this flag
+	 * is set, each allocation is reduced to the exact size once the
+	 * end of the sequence is reached.
+	 */
+	CYAML_CFG_SHRINK_SEQUENCES    = (1 << 6),
+	/**
+	 * When loading from a file, map the file into memory.
+	 *
+	 * With this flag set, \ref cyaml_load_file maps regular files
+	 * read-only and parses them in place, rather than reading them
+	 * through stdio buffers.  Other kinds of file, such as pipes, are
+	 * read through stdio as normal.
+	 *
+	 * \note The file must not be truncated while it is being loaded.
+	 */
+	CYAML_CFG_MMAP_INPUT          = (1 << 7),
+	/**
+	 * When loading, share one allocation between equal strings.
+	 *
+	 * With this flag set, each distinct \ref CYAML_STRING value with
+	 * \ref CYAML_FLAG_POINTER is only allocated once per document, and
+	 * every occurrence of it in the loaded data points at the same
+	 * string.  This saves memory for documents that repeat a small
+	 * set of strings many times.
+	 *
+	 * \note This only has an effect if \ref CYAML_CFG_ARENA is also
+	 *       set, since the shared strings are owned by the whole
+	 *       document.  Clients must not modify interned strings.
+	 */
+	CYAML_CFG_INTERN_STRINGS      = (1 << 8),
+	/**
+	 * When loading, stop reading a mapping once all of its required
+	 * fields have been loaded.
+	 *
+	 * The rest of the mapping's input is skipped without being
+	 * decoded, so documents can be read as a projection onto the
+	 * fields a client needs.  Optional fields which come after the
+	 * last required field are left unset, and unknown keys after it
+	 * are ignored.  Mappings without required fields are read in full.
+	 */
+	CYAML_CFG_PROJECTION          = (1 << 9),
+	/**
+	 * When saving, write YAML with CYAML's own emitter, rather than
+	 * with `libyaml`'s.
+	 *
+	 * Scalars that need no quoting are written straight to the
+	 * output, and only values that need quoting are analysed, so
+	 * saving is faster.  The output is the same as `libyaml` writes
+	 * by default.
+	 *
+	 * \note This has no effect on the incremental \ref cyaml_writer_t
+	 *       interface, which always uses `libyaml`.
+	 */
+	CYAML_CFG_FAST_EMIT           = (1 << 10),
+	/**
+	 * Support YAML anchors and aliases for \ref CYAML_FLAG_POINTER
+	 * values.
+	 *
+	 * When loading, an alias shares the allocation that was made for
+	 * its anchored value, rather than the value being decoded again,
+	 * so memory use and load time scale with a document's unique
+	 * content.  An alias is accepted where the anchored value would
+	 * be valid, and must come after the end of the anchored value.
+	 * Without this flag, aliases are rejected with \ref CYAML_ERR_ALIAS.
+	 *
+	 * When saving, pointer values that are reached more than once in
+	 * the data are written in full the first time, with an anchor, and
+	 * as aliases after that.
+	 *
+	 * \note When loading, this only has an effect if \ref CYAML_CFG_ARENA
+	 *       is also set, since shared allocations are owned by the whole
+	 *       document.  Clients must not modify shared values unless they
+	 *       mean to change every use of them.
+	 *
+	 * \note When saving, \ref CYAML_CFG_FAST_EMIT is ignored if this is
+	 *       set, and the incremental \ref cyaml_writer_t interface never
+	 *       writes aliases.
+	 */
+	CYAML_CFG_ALIASES             = (1 << 11),
 } cyaml_cfg_flags_t;
 
 /**
@@ -454,6 +564,17 @@ typedef enum cyaml_err {
 	CYAML_ERR_LIBYAML_EVENT_INIT,    /**< Failed to initialise libyaml. */
 	CYAML_ERR_LIBYAML_EMITTER,       /**< Error inside libyaml emitter. */
 	CYAML_ERR_LIBYAML_PARSER,        /**< Error inside libyaml parser. */
+	CYAML_ERR_STREAM_END,            /**< No more documents in stream. */
+	CYAML_ERR_BUFFER_FULL,           /**< Output buffer is too small. */
+	CYAML_ERR_FILE_WRITE,            /**< Failed to write file. */
+	CYAML_ERR_SNAPSHOT_INVALID,      /**< Snapshot file is damaged. */
+	CYAML_ERR_SNAPSHOT_STALE,        /**< Snapshot is for other input. */
+	CYAML_ERR_WRITER_STATE,          /**< Writer call made out of order. */
+	CYAML_ERR_NEED_INPUT,            /**< More input must be pushed. */
+	CYAML_ERR_NOT_SUPPORTED,         /**< Feature not built in. */
+	CYAML_ERR_DECOMPRESS,            /**< Compressed input is invalid. */
+	CYAML_ERR_LIMIT_EXCEEDED,        /**< Load resource limit exceeded. */
+	CYAML_ERR_INVALID_ALIAS,         /**< Alias rejected by schema. */
 	CYAML_ERR__COUNT,                /**< Count of CYAML return codes.
 	                                  *   This is **not a valid return
 	                                  *   code** itself.
@@ -1192,9 +1313,208 @@ typedef void * (*cyaml_mem_fn_t)(
 		void *ptr,
 		size_t size);
 
+/**
+ * CYAML top level sequence entry handler function.
+ *
+ * Clients may implement this to receive the entries of a top level
+ * \ref CYAML_SEQUENCE one at a time, as they are loaded.
+ *
+ * The entry is laid out as it would be within the loaded sequence's
+ * array.  It is only valid for the duration of the call; afterwards its
+ * contents are freed, and its space is reused for the next entry.  The
+ * client may take ownership of any allocations referenced by the entry,
+ * by setting the pointers to them within the entry to NULL.
+ *
+ * \param[in] ctx    Client's private entry handler context.
+ * \param[in] entry  The loaded sequence entry.
+ * \param[in] index  Index of the entry in the sequence.
+ * \return \ref CYAML_OK to continue loading, or any other error code to
+ *         abandon loading, returning that error code.
+ */
+typedef cyaml_err_t (*cyaml_entry_fn_t)(
+		void *ctx,
+		cyaml_data_t *entry,
+		unsigned index);
+
+/**
+ * CYAML output write function.
+ *
+ * Clients may implement this to receive serialised YAML output from
+ * \ref cyaml_save_stream, in chunks, as it is produced.
+ *
+ * \param[in] ctx   Client's private write function context.
+ * \param[in] data  The next chunk of serialised YAML.
+ * \param[in] len   Length of data in bytes.
+ * \return \ref CYAML_OK if all of the data was written, or any other error
+ *         code to abandon saving, returning that error code.
+ */
+typedef cyaml_err_t (*cyaml_write_fn_t)(
+		void *ctx,
+		const char *data,
+		size_t len);
+
+/**
+ * CYAML input read function.
+ *
+ * Clients may implement this to provide YAML input to
+ * \ref cyaml_load_stream, in chunks, as it is needed.
+ *
+ * \param[in]  ctx     Client's private read function context.
+ * \param[out] buffer  Buffer to read the next chunk of input into.
+ * \param[in]  size    Size of buffer in bytes.
+ * \param[out] len     Returns the number of bytes read into buffer, which
+ *                     may be fewer than size.  Zero means the end of the
+ *                     input.
+ * \return \ref CYAML_OK on success, or any other error code to abandon
+ *         loading, returning that error code.
+ */
+typedef cyaml_err_t (*cyaml_read_fn_t)(
+		void *ctx,
+		uint8_t *buffer,
+		size_t size,
+		size_t *len);
+
+/**
+ * YAML event types, for \ref cyaml_stats_t.
+ *
+ * These are in the same order as libyaml's event types.
+ */
+typedef enum cyaml_stats_evt {
+	CYAML_STATS_EVT_NONE,       /**< Empty event. */
+	CYAML_STATS_EVT_STRM_START, /**< Stream start. */
+	CYAML_STATS_EVT_STRM_END,   /**< Stream end. */
+	CYAML_STATS_EVT_DOC_START,  /**< Document start. */
+	CYAML_STATS_EVT_DOC_END,    /**< Document end. */
+	CYAML_STATS_EVT_ALIAS,      /**< Alias. */
+	CYAML_STATS_EVT_SCALAR,     /**< Scalar value. */
+	CYAML_STATS_EVT_SEQ_START,  /**< Sequence start. */
+	CYAML_STATS_EVT_SEQ_END,    /**< Sequence end. */
+	CYAML_STATS_EVT_MAP_START,  /**< Mapping start. */
+	CYAML_STATS_EVT_MAP_END,    /**< Mapping end. */
+	CYAML_STATS_EVT__COUNT,     /**< Count of event types, **not a valid
+	                                 event type itself**. */
+} cyaml_stats_evt_t;
+
+/**
+ * CYAML load and save statistics.
+ *
+ * Clients may attach one of these to a \ref cyaml_config_t to find out
+ * where loading and saving time goes, and to spot pathological documents.
+ * The counters are only ever added to, so the client should zero the
+ * structure before use, and can accumulate statistics over many loads and
+ * saves.
+ *
+ * Statistics are only gathered if LibCYAML was built with `CYAML_STATS`
+ * defined, which is the default.  Build with `make STATS=0` to compile
+ * the instrumentation out entirely; the counters then always stay zero.
+ *
+ * \note The counters are updated without synchronisation, so a config
+ *       with statistics attached must not be used by more than one thread
+ *       at a time.  In particular, it must not be used with
+ *       \ref cyaml_load_batch with more than one thread.
+ */
+typedef struct cyaml_stats {
+	/**
+	 * Whether to time the load and save phases.
+	 *
+	 * Timing reads the monotonic clock twice per YAML event, so it is
+	 * optional.  This must not be changed while a load or save using
+	 * this structure is in progress.
+	 */
+	bool timing;
+	/** Number of YAML events parsed, by \ref cyaml_stats_evt_t type. */
+	uint64_t events[CYAML_STATS_EVT__COUNT];
+	/** Number of YAML events emitted. */
+	uint64_t events_emitted;
+	/** Number of `mem_fn` calls making new allocations. */
+	uint64_t mem_allocs;
+	/** Number of `mem_fn` calls resizing existing allocations. */
+	uint64_t mem_reallocs;
+	/** Number of `mem_fn` calls freeing allocations. */
+	uint64_t mem_frees;
+	/** Total bytes requested from `mem_fn` by allocations and resizes. */
+	uint64_t mem_bytes;
+	/** Number of resizes where `mem_fn` moved the allocation. */
+	uint64_t realloc_copies;
+	/** Deepest load or save state stack depth reached. */
+	uint32_t stack_peak;
+	/** Number of schema field keys compared against mapping keys. */
+	uint64_t key_probes;
+	/** Number of ignored values skipped, including their contents. */
+	uint64_t ignored_values;
+	/** Nanoseconds spent in libyaml's parser. */
+	uint64_t parse_ns;
+	/** Nanoseconds spent handling parsed events, excluding parsing. */
+	uint64_t decode_ns;
+	/** Nanoseconds spent in libyaml's emitter, including output. */
+	uint64_t emit_ns;
+} cyaml_stats_t;
+
+/**
+ * CYAML load resource limits.
+ *
+ * These bound what a single document can make LibCYAML do, so that
+ * untrusted input can't exhaust memory or time.  Each limit applies to
+ * each document loaded, and a limit of zero means no limit.  A load that
+ * exceeds a limit is abandoned as soon as the limit is crossed, and fails
+ * with \ref CYAML_ERR_LIMIT_EXCEEDED.
+ */
+typedef struct cyaml_limits {
+	/**
+	 * Maximum number of bytes allocated for the loaded data.
+	 *
+	 * This counts the data allocations made for \ref CYAML_FLAG_POINTER
+	 * values, including sequence growth, but not LibCYAML's own working
+	 * state.  Entries of sequences passed to a client `entry_fn` are
+	 * counted one at a time, since each is freed after being passed on.
+	 */
+	size_t max_bytes;
+	/**
+	 * Maximum nesting depth of mappings and sequences.
+	 *
+	 * A top level mapping or sequence is at depth one.  Collections
+	 * inside ignored values count too.
+	 */
+	uint32_t max_depth;
+	/**
+	 * Maximum total number of entries.
+	 *
+	 * Each mapping key and each sequence entry counts as one entry.
+	 * Within ignored values, each scalar, mapping and sequence counts
+	 * as one entry.
+	 */
+	uint64_t max_entries;
+	/** Maximum length of any scalar, including keys, in bytes. */
+	size_t max_scalar_len;
+} cyaml_limits_t;
+
+/**
+ * Opaque CYAML compiled schema.
+ *
+ * A compiled schema holds a validated schema along with data derived from
+ * it, such as mapping field counts and key lookup indexes.  Setting it in
+ * a \ref cyaml_config_t lets loads, saves and frees of its schema use the
+ * derived data directly, rather than working it out as they go.
+ *
+ * Create with \ref cyaml_schema_compile and free with
+ * \ref cyaml_schema_compiled_free.
+ *
+ * A compiled schema is never modified once created, so it may be shared
+ * by any number of threads.
+ */
+typedef struct cyaml_schema_compiled cyaml_schema_compiled_t;
+
 /**
  * Client CYAML configuration data.
  *
+ * LibCYAML has no global mutable state, and never modifies a config or a
+ * schema.  A config and schema may be shared by any number of threads
+ * loading and saving concurrently, so long as the client functions set in
+ * the config (`log_fn`, `mem_fn` and `entry_fn`) are safe to call from
+ * those threads at the same time.  The default \ref cyaml_log and
+ * \ref cyaml_mem functions are.  Stream, loader and saver objects may
+ * only be used by one thread at a time.
+ *
  * \todo Should provide facility for client to provide its own custom
  *       allocation functions.
  */
@@ -1244,6 +1564,48 @@ typedef struct cyaml_config {
 	cyaml_log_t log_level;
 	/** CYAML behaviour flags. */
 	cyaml_cfg_flags_t flags;
+	/**
+	 * Client function to receive top level sequence entries, or NULL.
+	 *
+	 * If set, and the top level schema type is \ref CYAML_SEQUENCE,
+	 * each entry is passed to this function as soon as it has been
+	 * loaded, rather than being added to a sequence allocation.  This
+	 * allows arbitrarily long sequences to be handled in constant memory.
+	 *
+	 * In this case, loading returns `NULL` data, with the sequence entry
+	 * count set to the number of entries handled.
+	 *
+	 * \note \ref CYAML_CFG_ARENA has no effect on such loads.
+	 */
+	cyaml_entry_fn_t entry_fn;
+	/**
+	 * Client entry function context pointer.
+	 *
+	 * This will be passed through to the client's entry_fn.
+	 */
+	void *entry_ctx;
+	/**
+	 * Client statistics structure, or NULL.
+	 *
+	 * If set, LibCYAML adds counts and timings for loads and saves
+	 * using this config to it.  See \ref cyaml_stats_t.
+	 */
+	cyaml_stats_t *stats;
+	/**
+	 * Compiled schema, or NULL.
+	 *
+	 * If set, loads, saves and frees using the compiled schema's
+	 * schema use its precomputed data.  Other schemas are handled as
+	 * normal.  The compiled schema is also ignored if it was compiled
+	 * with different \ref CYAML_CFG_CASE_INSENSITIVE setting.
+	 */
+	const cyaml_schema_compiled_t *compiled;
+	/**
+	 * Resource limits for loading.
+	 *
+	 * Leaving this zeroed applies no limits.  See \ref cyaml_limits_t.
+	 */
+	cyaml_limits_t limits;
 } cyaml_config_t;
 
 /**
@@ -1294,6 +1656,9 @@ extern void * cyaml_mem(
 /**
  * Load a YAML document from a file at the given path.
  *
+ * If \ref CYAML_CFG_MMAP_INPUT is set, regular files are mapped into
+ * memory and loaded as if by \ref cyaml_load_data.
+ *
  * \note In the event of the top-level mapping having only optional fields,
  *       and the YAML not setting any of them, this function can return \ref
  *       CYAML_OK, and `NULL` in the `data_out` parameter.
@@ -1344,91 +1709,1063 @@ extern cyaml_err_t cyaml_load_data(
 		unsigned *seq_count_out);
 
 /**
- * Save a YAML document to a file at the given path.
+ * Load a YAML document through a client read function.
  *
- * \param[in] path       Path to YAML file to write.
- * \param[in] config     Client's CYAML configuration structure.
- * \param[in] schema     CYAML schema for the YAML to be saved.
- * \param[in] data       The caller-owned data to be saved.
- * \param[in] seq_count  If top level type is sequence, this should be the
- *                       entry count, otherwise it is ignored.
- * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ * The input is read with read_fn as the `libyaml` parser needs it, into
+ * the parser's own input buffer, so the whole input is never held in
+ * memory.  This can be used to read from sockets, object storage, or
+ * decompressors, such as \ref cyaml_inflate_read.
+ *
+ * \note In the event of the top-level mapping having only optional fields,
+ *       and the YAML not setting any of them, this function can return \ref
+ *       CYAML_OK, and `NULL` in the `data_out` parameter.
+ *
+ * \param[in]  read_fn        Client function to read the input.
+ * \param[in]  read_ctx       Client's private context for read_fn.
+ * \param[in]  config         Client's CYAML configuration structure.
+ * \param[in]  schema         CYAML schema for the YAML to be loaded.
+ * \param[out] data_out       Returns the caller-owned loaded data on success.
+ *                            Untouched on failure.
+ * \param[out] seq_count_out  On success, returns the sequence entry count.
+ *                            Untouched on failure.
+ *                            Must be non-NULL if top-level schema type is
+ *                            \ref CYAML_SEQUENCE, otherwise, must be NULL.
+ * \return \ref CYAML_OK on success, the error code returned by read_fn if
+ *         it failed, or appropriate error code otherwise.
  */
-extern cyaml_err_t cyaml_save_file(
-		const char *path,
+extern cyaml_err_t cyaml_load_stream(
+		cyaml_read_fn_t read_fn,
+		void *read_ctx,
 		const cyaml_config_t *config,
 		const cyaml_schema_value_t *schema,
-		const cyaml_data_t *data,
-		unsigned seq_count);
+		cyaml_data_t **data_out,
+		unsigned *seq_count_out);
 
 /**
- * Save a YAML document into a string in memory.
+ * Opaque CYAML input decompressor.
  *
- * This allocates a buffer containing the serialised YAML data.
+ * An inflater is a decompression stage for \ref cyaml_load_stream.  It
+ * reads zlib or gzip compressed input through a client read function, and
+ * \ref cyaml_inflate_read provides the decompressed input.  The format is
+ * detected from the input's header, and concatenated gzip members are
+ * decompressed in turn.
  *
- * To free the returned YAML string, clients should use the \ref cyaml_mem_fn_t
- * function set in the \ref cyaml_config_t passed to this function.
- * For example:
+ * Decompression stages are just read functions, so other formats can be
+ * supported by clients in the same way, and stages can be chained.
  *
- * ```
- * char *yaml;
- * size_t len;
- * err = cyaml_save_file(&yaml, &len, &config, &client_schema, client_data, 0);
- * if (err == CYAML_OK) {
- *         // Use `yaml`:
- *         printf("%*s\n", len, yaml);
- *         // Free `yaml`:
- *         config.mem_fn(config.mem_ctx, yaml, 0);
- * }
- * ```
+ * Create with \ref cyaml_inflate_create, and free with
+ * \ref cyaml_inflate_destroy.
  *
- * \note The returned YAML string does not have a trailing '\0'.
+ * \note This needs libcyaml to be built with zlib support.  Otherwise,
+ *       \ref cyaml_inflate_create returns \ref CYAML_ERR_NOT_SUPPORTED.
+ */
+typedef struct cyaml_inflate cyaml_inflate_t;
+
+/**
+ * Create an input decompressor.
+ *
+ * \param[in]  config       Client's CYAML configuration structure, which
+ *                          must remain valid for the lifetime of the
+ *                          inflater.  Its memory allocation function is
+ *                          used for the decompressor's allocations.
+ * \param[in]  read_fn      Client function to read the compressed input.
+ * \param[in]  read_ctx     Client's private context for read_fn.
+ * \param[out] inflate_out  Returns the new inflater on success.
+ *                          Untouched on failure.
+ * \return \ref CYAML_OK on success, \ref CYAML_ERR_NOT_SUPPORTED if
+ *         libcyaml was built without zlib, or appropriate error code
+ *         otherwise.
+ */
+extern cyaml_err_t cyaml_inflate_create(
+		const cyaml_config_t *config,
+		cyaml_read_fn_t read_fn,
+		void *read_ctx,
+		cyaml_inflate_t **inflate_out);
+
+/**
+ * Read decompressed input from an inflater.
+ *
+ * This is a \ref cyaml_read_fn_t, to be passed to \ref cyaml_load_stream
+ * with the inflater as its context.
+ *
+ * \param[in]  ctx     The inflater.
+ * \param[out] buffer  Buffer to decompress the next chunk of input into.
+ * \param[in]  size    Size of buffer in bytes.
+ * \param[out] len     Returns the number of bytes put in buffer.  Zero
+ *                     means the end of the input.
+ * \return \ref CYAML_OK on success, \ref CYAML_ERR_DECOMPRESS if the
+ *         compressed input is invalid or truncated, the error code returned
+ *         by the inflater's read function if it failed, or appropriate
+ *         error code otherwise.
+ */
+extern cyaml_err_t cyaml_inflate_read(
+		void *ctx,
+		uint8_t *buffer,
+		size_t size,
+		size_t *len);
+
+/**
+ * Destroy an input decompressor.
  *
- * \param[out] output     Returns the caller-owned serialised YAML data on
- *                        success, untouched on failure.  Clients should use
- *                        the \ref cyaml_mem_fn_t function set in the \ref
- *                        cyaml_config_t to free the data.
- * \param[out] len        Returns the length of the data in output on success,
- *                        untouched on failure.
- * \param[out] len        Path to YAML file to write.
- * \param[in]  config     Client's CYAML configuration structure.
- * \param[in]  schema     CYAML schema for the YAML to be saved.
- * \param[in]  data       The caller-owned data to be saved.
- * \param[in]  seq_count  If top level type is sequence, this should be the
- *                        entry count, otherwise it is ignored.
+ * \param[in]  inf  The inflater to destroy, or NULL.
+ */
+extern void cyaml_inflate_destroy(
+		cyaml_inflate_t *inf);
+
+/**
+ * Opaque CYAML document stream.
+ *
+ * A document stream loads the documents from a multi-document YAML input
+ * one at a time.  Documents can be processed and freed before the next
+ * one is loaded, so only one document need be held in memory at a time.
+ *
+ * Create with \ref cyaml_stream_open_data, \ref cyaml_stream_open_file or
+ * \ref cyaml_stream_open_push, get each document with
+ * \ref cyaml_stream_next, and free with \ref cyaml_stream_close.
+ */
+typedef struct cyaml_stream cyaml_stream_t;
+
+/**
+ * Open a document stream for loading documents from a string.
+ *
+ * \note The input data, client config, and schema must remain valid for
+ *       the lifetime of the stream.
+ *
+ * \param[in]  input       Input YAML data.
+ * \param[in]  input_len   Length of input in bytes.
+ * \param[in]  config      Client's CYAML configuration structure.
+ * \param[in]  schema      CYAML schema for each document in the stream.
+ * \param[out] stream_out  Returns the document stream on success.
+ *                         Untouched on failure.
  * \return \ref CYAML_OK on success, or appropriate error code otherwise.
  */
-extern cyaml_err_t cyaml_save_data(
-		char **output,
-		size_t *len,
+extern cyaml_err_t cyaml_stream_open_data(
+		const uint8_t *input,
+		size_t input_len,
 		const cyaml_config_t *config,
 		const cyaml_schema_value_t *schema,
-		const cyaml_data_t *data,
-		unsigned seq_count);
+		cyaml_stream_t **stream_out);
 
 /**
- * Free data returned by a CYAML load function.
+ * Open a document stream for loading documents from a file.
  *
- * This is a convenience function, which is here purely to minimise the
- * amount of code required in clients.  Clients would be better off writing
- * their own free function for the specific data once loaded.
+ * If \ref CYAML_CFG_MMAP_INPUT is set, regular files are mapped into
+ * memory, as with \ref cyaml_load_file.
  *
- * \note This is a recursive operation, freeing all nested data.
+ * \note The client config and schema must remain valid for the lifetime of
+ *       the stream.
  *
- * \param[in] config     The client's CYAML library config.
- * \param[in] schema     The schema describing the content of data.  Must match
- *                       the schema given to the CYAML load function used to
- *                       load the data.
- * \param[in] data       The data structure to free.
- * \param[in] seq_count  If top level type is sequence, this should be the
- *                       entry count, otherwise it is ignored.
+ * \param[in]  path        Path to YAML file to load.
+ * \param[in]  config      Client's CYAML configuration structure.
+ * \param[in]  schema      CYAML schema for each document in the stream.
+ * \param[out] stream_out  Returns the document stream on success.
+ *                         Untouched on failure.
  * \return \ref CYAML_OK on success, or appropriate error code otherwise.
  */
-extern cyaml_err_t cyaml_free(
+extern cyaml_err_t cyaml_stream_open_file(
+		const char *path,
 		const cyaml_config_t *config,
 		const cyaml_schema_value_t *schema,
-		cyaml_data_t *data,
-		unsigned seq_count);
+		cyaml_stream_t **stream_out);
+
+/**
+ * Open a document stream for loading documents from pushed input.
+ *
+ * This suits input which arrives a piece at a time, for example from a
+ * non-blocking socket.  The client passes input to the stream with
+ * \ref cyaml_stream_feed as it arrives, and calls \ref cyaml_stream_next
+ * until it returns \ref CYAML_ERR_NEED_INPUT.  Each document is loaded as
+ * soon as the whole of it has been pushed, so documents are decoded while
+ * later ones are still arriving.  When there is no more input, the client
+ * calls \ref cyaml_stream_feed_end, and any final document can then be
+ * loaded.
+ *
+ * A document is known to be complete once the line with the document
+ * start ("---") or end ("...") marker that follows it has been pushed.
+ * Input which has been parsed is discarded, so only the document being
+ * received is buffered.
+ *
+ * \note Pushed input must be UTF-8 encoded.
+ *
+ * \note The client config and schema must remain valid for the lifetime of
+ *       the stream.
+ *
+ * \param[in]  config      Client's CYAML configuration structure.
+ * \param[in]  schema      CYAML schema for each document in the stream.
+ * \param[out] stream_out  Returns the document stream on success.
+ *                         Untouched on failure.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_stream_open_push(
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		cyaml_stream_t **stream_out);
+
+/**
+ * Push input to a document stream opened with \ref cyaml_stream_open_push.
+ *
+ * The input is copied, so the client's buffer may be reused as soon as
+ * this returns.  Input may be split anywhere.
+ *
+ * \param[in]  stream     Document stream to push input to.
+ * \param[in]  input      Input YAML data.
+ * \param[in]  input_len  Length of input in bytes.
+ * \return \ref CYAML_OK on success, \ref CYAML_ERR_STREAM_END if the input
+ *         has been ended with \ref cyaml_stream_feed_end, or appropriate
+ *         error code otherwise.
+ */
+extern cyaml_err_t cyaml_stream_feed(
+		cyaml_stream_t *stream,
+		const uint8_t *input,
+		size_t input_len);
+
+/**
+ * End the input of a document stream opened with
+ * \ref cyaml_stream_open_push.
+ *
+ * \param[in]  stream  Document stream to end the input of.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_stream_feed_end(
+		cyaml_stream_t *stream);
+
+/**
+ * Load the next document from a document stream.
+ *
+ * Each document returned is owned by the client, and must be freed
+ * with \ref cyaml_free, as for data from \ref cyaml_load_data.
+ *
+ * Once there are no more documents, \ref CYAML_ERR_STREAM_END is returned.
+ * After any failure, the stream can't be used to load further documents,
+ * and subsequent calls return the same error.  The exception is
+ * \ref CYAML_ERR_NEED_INPUT, after which loading continues once more
+ * input has been pushed.
+ *
+ * \note In the event of the top-level mapping having only optional fields,
+ *       and a document not setting any of them, this function can return
+ *       \ref CYAML_OK, and `NULL` in the `data_out` parameter.
+ *
+ * \param[in]  stream         Document stream to load from.
+ * \param[out] data_out       Returns the caller-owned loaded data on success.
+ *                            Untouched on failure.
+ * \param[out] seq_count_out  On success, returns the sequence entry count.
+ *                            Untouched on failure.
+ *                            Must be non-NULL if top-level schema type is
+ *                            \ref CYAML_SEQUENCE, otherwise, must be NULL.
+ * \return \ref CYAML_OK on success, \ref CYAML_ERR_STREAM_END if there are
+ *         no more documents, \ref CYAML_ERR_NEED_INPUT if the stream takes
+ *         pushed input and the next document is not complete yet, or
+ *         appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_stream_next(
+		cyaml_stream_t *stream,
+		cyaml_data_t **data_out,
+		unsigned *seq_count_out);
+
+/**
+ * Close a document stream.
+ *
+ * Documents already returned by \ref cyaml_stream_next are unaffected.
+ *
+ * \param[in]  stream  Document stream to close, or NULL.
+ */
+extern void cyaml_stream_close(
+		cyaml_stream_t *stream);
+
+/**
+ * Opaque CYAML reusable loader.
+ *
+ * A loader keeps the internal loading state between loads, so that its
+ * allocations can be reused.  This avoids much of the fixed setup cost of
+ * each load, which dominates when loading many small documents.
+ *
+ * Create with \ref cyaml_loader_create, load with
+ * \ref cyaml_loader_load_data or \ref cyaml_loader_load_file, and free
+ * with \ref cyaml_loader_destroy.
+ *
+ * A loader may only be used by one thread at a time.  Any schemas used
+ * with a loader must remain valid until the loader is destroyed.
+ */
+typedef struct cyaml_loader cyaml_loader_t;
+
+/**
+ * Create a reusable loader.
+ *
+ * \param[in]  config      Client's CYAML configuration structure, which
+ *                         must remain valid for the lifetime of the loader.
+ * \param[out] loader_out  Returns the new loader on success.
+ *                         Untouched on failure.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_loader_create(
+		const cyaml_config_t *config,
+		cyaml_loader_t **loader_out);
+
+/**
+ * Load a YAML document from a string in memory, using a loader.
+ *
+ * This behaves like \ref cyaml_load_data, with the loader's config.
+ *
+ * \param[in]  loader         The loader to use.
+ * \param[in]  input          Input YAML data.
+ * \param[in]  input_len      Length of input in bytes.
+ * \param[in]  schema         CYAML schema for the YAML to be loaded.
+ * \param[out] data_out       Returns the caller-owned loaded data on success.
+ *                            Untouched on failure.
+ * \param[out] seq_count_out  On success, returns the sequence entry count.
+ *                            Untouched on failure.
+ *                            Must be non-NULL if top-level schema type is
+ *                            \ref CYAML_SEQUENCE, otherwise, must be NULL.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_loader_load_data(
+		cyaml_loader_t *loader,
+		const uint8_t *input,
+		size_t input_len,
+		const cyaml_schema_value_t *schema,
+		cyaml_data_t **data_out,
+		unsigned *seq_count_out);
+
+/**
+ * Load a YAML document from a file at the given path, using a loader.
+ *
+ * This behaves like \ref cyaml_load_file, with the loader's config.
+ *
+ * \param[in]  loader         The loader to use.
+ * \param[in]  path           Path to YAML file to load.
+ * \param[in]  schema         CYAML schema for the YAML to be loaded.
+ * \param[out] data_out       Returns the caller-owned loaded data on success.
+ *                            Untouched on failure.
+ * \param[out] seq_count_out  On success, returns the sequence entry count.
+ *                            Untouched on failure.
+ *                            Must be non-NULL if top-level schema type is
+ *                            \ref CYAML_SEQUENCE, otherwise, must be NULL.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_loader_load_file(
+		cyaml_loader_t *loader,
+		const char *path,
+		const cyaml_schema_value_t *schema,
+		cyaml_data_t **data_out,
+		unsigned *seq_count_out);
+
+/**
+ * Destroy a reusable loader.
+ *
+ * Data already loaded with the loader is unaffected.
+ *
+ * \param[in]  loader  The loader to destroy, or NULL.
+ */
+extern void cyaml_loader_destroy(
+		cyaml_loader_t *loader);
+
+/**
+ * An item to be loaded by \ref cyaml_load_batch.
+ *
+ * The client sets the input fields, and the output fields are set by
+ * \ref cyaml_load_batch.
+ */
+typedef struct cyaml_batch_item {
+	/** Path to YAML file to load, or NULL to load from `input`. */
+	const char *path;
+	/** Input YAML data, used if `path` is NULL. */
+	const uint8_t *input;
+	/** Length of `input` in bytes. */
+	size_t input_len;
+	/** Returns the caller-owned loaded data on success, or NULL. */
+	cyaml_data_t *data;
+	/**
+	 * Returns the sequence entry count on success, if the top-level
+	 * schema type is \ref CYAML_SEQUENCE.
+	 */
+	unsigned seq_count;
+	/** Returns the result of loading the item. */
+	cyaml_err_t err;
+} cyaml_batch_item_t;
+
+/**
+ * Load a batch of independent YAML documents in parallel.
+ *
+ * Each item is loaded as if by \ref cyaml_load_file or
+ * \ref cyaml_load_data, with the same config and schema.  Items are
+ * shared out between a pool of worker threads as each thread becomes
+ * free, so that a few slow items don't hold up the rest.  Each thread
+ * has its own \ref cyaml_loader_t.
+ *
+ * The client functions in config are called concurrently from the worker
+ * threads, so must be thread safe.  If `entry_fn` is set, there is no
+ * ordering between the entries of different items.
+ *
+ * Every item's `data`, `seq_count` and `err` fields are set, whether or
+ * not the batch as a whole succeeds.  Clients should free each item's
+ * data, as for any other load.
+ *
+ * \param[in,out] items    Array of items to load.
+ * \param[in]     count    Number of entries in items.
+ * \param[in]     threads  Maximum number of threads to load with,
+ *                         including the calling thread, or 0 to use one
+ *                         thread per online CPU.
+ * \param[in]     config   Client's CYAML configuration structure.
+ * \param[in]     schema   CYAML schema for every item's YAML.
+ * \return \ref CYAML_OK if every item was loaded, otherwise the error
+ *         from the first item that failed to load, or an appropriate error
+ *         code for bad parameters, in which case no item is touched.
+ */
+extern cyaml_err_t cyaml_load_batch(
+		cyaml_batch_item_t *items,
+		size_t count,
+		unsigned threads,
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema);
+
+/**
+ * Save a YAML document to a file at the given path.
+ *
+ * \param[in] path       Path to YAML file to write.
+ * \param[in] config     Client's CYAML configuration structure.
+ * \param[in] schema     CYAML schema for the YAML to be saved.
+ * \param[in] data       The caller-owned data to be saved.
+ * \param[in] seq_count  If top level type is sequence, this should be the
+ *                       entry count, otherwise it is ignored.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_save_file(
+		const char *path,
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		const cyaml_data_t *data,
+		unsigned seq_count);
+
+/**
+ * Save a YAML document into a string in memory.
+ *
+ * This allocates a buffer containing the serialised YAML data.
+ *
+ * To free the returned YAML string, clients should use the \ref cyaml_mem_fn_t
+ * function set in the \ref cyaml_config_t passed to this function.
+ * For example:
+ *
+ * ```
+ * char *yaml;
+ * size_t len;
+ * err = cyaml_save_file(&yaml, &len, &config, &client_schema, client_data, 0);
+ * if (err == CYAML_OK) {
+ *         // Use `yaml`:
+ *         printf("%*s\n", len, yaml);
+ *         // Free `yaml`:
+ *         config.mem_fn(config.mem_ctx, yaml, 0);
+ * }
+ * ```
+ *
+ * \note The returned YAML string does not have a trailing '\0'.
+ *
+ * \param[out] output     Returns the caller-owned serialised YAML data on
+ *                        success, untouched on failure.  Clients should use
+ *                        the \ref cyaml_mem_fn_t function set in the \ref
+ *                        cyaml_config_t to free the data.
+ * \param[out] len        Returns the length of the data in output on success,
+ *                        untouched on failure.
+ * \param[out] len        Path to YAML file to write.
+ * \param[in]  config     Client's CYAML configuration structure.
+ * \param[in]  schema     CYAML schema for the YAML to be saved.
+ * \param[in]  data       The caller-owned data to be saved.
+ * \param[in]  seq_count  If top level type is sequence, this should be the
+ *                        entry count, otherwise it is ignored.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_save_data(
+		char **output,
+		size_t *len,
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		const cyaml_data_t *data,
+		unsigned seq_count);
+
+/**
+ * Save a YAML document into a caller-provided buffer.
+ *
+ * This does not allocate any memory for the output.  If the serialised
+ * document does not fit in the buffer, \ref CYAML_ERR_BUFFER_FULL is
+ * returned, and the buffer contents are undefined.
+ *
+ * \note The YAML written to the buffer does not have a trailing '\0'.
+ *
+ * \param[out] buffer     Caller-owned buffer to write the YAML into.
+ * \param[in]  size       Size of buffer in bytes.
+ * \param[out] len        Returns the length of the data written to buffer
+ *                        on success, untouched on failure.
+ * \param[in]  config     Client's CYAML configuration structure.
+ * \param[in]  schema     CYAML schema for the YAML to be saved.
+ * \param[in]  data       The caller-owned data to be saved.
+ * \param[in]  seq_count  If top level type is sequence, this should be the
+ *                        entry count, otherwise it is ignored.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_save_buffer(
+		char *buffer,
+		size_t size,
+		size_t *len,
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		const cyaml_data_t *data,
+		unsigned seq_count);
+
+/**
+ * Save a YAML document through a client write function.
+ *
+ * The serialised YAML is passed to write_fn in chunks as it is produced,
+ * so the whole document is never held in memory.  This can be used to
+ * write to sockets, compressors, or asynchronous I/O queues.
+ *
+ * \param[in]  write_fn   Client function to write the output.
+ * \param[in]  write_ctx  Client's private context for write_fn.
+ * \param[in]  config     Client's CYAML configuration structure.
+ * \param[in]  schema     CYAML schema for the YAML to be saved.
+ * \param[in]  data       The caller-owned data to be saved.
+ * \param[in]  seq_count  If top level type is sequence, this should be the
+ *                        entry count, otherwise it is ignored.
+ * \return \ref CYAML_OK on success, the error code returned by write_fn if
+ *         it failed, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_save_stream(
+		cyaml_write_fn_t write_fn,
+		void *write_ctx,
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		const cyaml_data_t *data,
+		unsigned seq_count);
+
+/**
+ * Save a YAML document to an open file descriptor.
+ *
+ * The output is written with `write()`, without buffering in stdio.
+ * The file descriptor is not closed.
+ *
+ * \param[in]  fd         File descriptor to write to.
+ * \param[in]  config     Client's CYAML configuration structure.
+ * \param[in]  schema     CYAML schema for the YAML to be saved.
+ * \param[in]  data       The caller-owned data to be saved.
+ * \param[in]  seq_count  If top level type is sequence, this should be the
+ *                        entry count, otherwise it is ignored.
+ * \return \ref CYAML_OK on success, \ref CYAML_ERR_FILE_WRITE if writing
+ *         failed, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_save_fd(
+		int fd,
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		const cyaml_data_t *data,
+		unsigned seq_count);
+
+/**
+ * Opaque CYAML reusable saver.
+ *
+ * A saver keeps the internal saving state between saves, so that its
+ * allocations can be reused.  This avoids much of the fixed setup cost of
+ * each save, which dominates when saving many small documents.
+ *
+ * Create with \ref cyaml_saver_create, save with
+ * \ref cyaml_saver_save_data, \ref cyaml_saver_save_buffer or
+ * \ref cyaml_saver_save_stream, and free with \ref cyaml_saver_destroy.
+ *
+ * A saver may only be used by one thread at a time.
+ */
+typedef struct cyaml_saver cyaml_saver_t;
+
+/**
+ * Create a reusable saver.
+ *
+ * \param[in]  config     Client's CYAML configuration structure, which
+ *                        must remain valid for the lifetime of the saver.
+ * \param[out] saver_out  Returns the new saver on success.
+ *                        Untouched on failure.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_saver_create(
+		const cyaml_config_t *config,
+		cyaml_saver_t **saver_out);
+
+/**
+ * Save a YAML document into a string in memory, using a saver.
+ *
+ * This behaves like \ref cyaml_save_data, with the saver's config.
+ *
+ * \param[in]  saver      The saver to use.
+ * \param[out] output     Returns the caller-owned serialised YAML data on
+ *                        success, untouched on failure.
+ * \param[out] len        Returns the length of the data in output on success,
+ *                        untouched on failure.
+ * \param[in]  schema     CYAML schema for the YAML to be saved.
+ * \param[in]  data       The caller-owned data to be saved.
+ * \param[in]  seq_count  If top level type is sequence, this should be the
+ *                        entry count, otherwise it is ignored.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_saver_save_data(
+		cyaml_saver_t *saver,
+		char **output,
+		size_t *len,
+		const cyaml_schema_value_t *schema,
+		const cyaml_data_t *data,
+		unsigned seq_count);
+
+/**
+ * Save a YAML document into a caller-provided buffer, using a saver.
+ *
+ * This behaves like \ref cyaml_save_buffer, with the saver's config.
+ *
+ * \param[in]  saver      The saver to use.
+ * \param[out] buffer     Caller-owned buffer to write the YAML into.
+ * \param[in]  size       Size of buffer in bytes.
+ * \param[out] len        Returns the length of the data written to buffer
+ *                        on success, untouched on failure.
+ * \param[in]  schema     CYAML schema for the YAML to be saved.
+ * \param[in]  data       The caller-owned data to be saved.
+ * \param[in]  seq_count  If top level type is sequence, this should be the
+ *                        entry count, otherwise it is ignored.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_saver_save_buffer(
+		cyaml_saver_t *saver,
+		char *buffer,
+		size_t size,
+		size_t *len,
+		const cyaml_schema_value_t *schema,
+		const cyaml_data_t *data,
+		unsigned seq_count);
+
+/**
+ * Save a YAML document through a client write function, using a saver.
+ *
+ * This behaves like \ref cyaml_save_stream, with the saver's config.
+ *
+ * \param[in]  saver      The saver to use.
+ * \param[in]  write_fn   Client function to write the output.
+ * \param[in]  write_ctx  Client's private context for write_fn.
+ * \param[in]  schema     CYAML schema for the YAML to be saved.
+ * \param[in]  data       The caller-owned data to be saved.
+ * \param[in]  seq_count  If top level type is sequence, this should be the
+ *                        entry count, otherwise it is ignored.
+ * \return \ref CYAML_OK on success, the error code returned by write_fn if
+ *         it failed, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_saver_save_stream(
+		cyaml_saver_t *saver,
+		cyaml_write_fn_t write_fn,
+		void *write_ctx,
+		const cyaml_schema_value_t *schema,
+		const cyaml_data_t *data,
+		unsigned seq_count);
+
+/**
+ * Destroy a reusable saver.
+ *
+ * \param[in]  saver  The saver to destroy, or NULL.
+ */
+extern void cyaml_saver_destroy(
+		cyaml_saver_t *saver);
+
+/**
+ * CYAML incremental writer.
+ *
+ * A writer keeps a `libyaml` emitter open for a whole output stream, so
+ * the stream can be written a piece at a time, while the client data for
+ * the rest of it is not yet produced.  Either whole documents are written
+ * with \ref cyaml_writer_document, or a top level sequence is written an
+ * entry at a time between \ref cyaml_writer_sequence_start and
+ * \ref cyaml_writer_sequence_end.
+ *
+ * Output is buffered by the `libyaml` emitter, which has a fixed size
+ * buffer, and it is flushed at the end of each document.  Use
+ * \ref cyaml_writer_flush to push pending sequence entries out earlier.
+ *
+ * Create with \ref cyaml_writer_create or \ref cyaml_writer_create_fd,
+ * end the stream with \ref cyaml_writer_finish and free with
+ * \ref cyaml_writer_destroy.
+ *
+ * Once a write fails, the writer returns the same error from every
+ * further call, except \ref cyaml_writer_destroy.
+ *
+ * A writer may only be used by one thread at a time.
+ */
+typedef struct cyaml_writer cyaml_writer_t;
+
+/**
+ * Create an incremental writer that writes through a client function.
+ *
+ * \param[in]  config      Client's CYAML configuration structure, which
+ *                         must remain valid for the lifetime of the writer.
+ * \param[in]  write_fn    Client function to write the output.
+ * \param[in]  write_ctx   Client's private context for write_fn.
+ * \param[out] writer_out  Returns the new writer on success.
+ *                         Untouched on failure.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_writer_create(
+		const cyaml_config_t *config,
+		cyaml_write_fn_t write_fn,
+		void *write_ctx,
+		cyaml_writer_t **writer_out);
+
+/**
+ * Create an incremental writer that writes to a file descriptor.
+ *
+ * The file descriptor is not closed by the writer.
+ *
+ * \param[in]  config      Client's CYAML configuration structure, which
+ *                         must remain valid for the lifetime of the writer.
+ * \param[in]  fd          An open file descriptor to write to.
+ * \param[out] writer_out  Returns the new writer on success.
+ *                         Untouched on failure.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_writer_create_fd(
+		const cyaml_config_t *config,
+		int fd,
+		cyaml_writer_t **writer_out);
+
+/**
+ * Write a YAML document with an incremental writer.
+ *
+ * The parameters are as for \ref cyaml_save_stream.  Document delimiters
+ * are written according to \ref CYAML_CFG_DOCUMENT_DELIM, except that
+ * `libyaml` always starts the second and later documents with "---".
+ *
+ * \param[in]  writer     The writer to use.
+ * \param[in]  schema     CYAML schema for the YAML to be saved.
+ * \param[in]  data       The caller-owned data to be saved.
+ * \param[in]  seq_count  If top level type is sequence, this should be the
+ *                        entry count, otherwise it is ignored.
+ * \return \ref CYAML_OK on success, \ref CYAML_ERR_WRITER_STATE if a
+ *         sequence is being written or the stream is finished, the error
+ *         code returned by write_fn if it failed, or appropriate error code
+ *         otherwise.
+ */
+extern cyaml_err_t cyaml_writer_document(
+		cyaml_writer_t *writer,
+		const cyaml_schema_value_t *schema,
+		const cyaml_data_t *data,
+		unsigned seq_count);
+
+/**
+ * Start a document with a top level sequence, to be written an entry at a
+ * time with \ref cyaml_writer_sequence_entry.
+ *
+ * \param[in]  writer  The writer to use.
+ * \param[in]  schema  CYAML schema for the sequence, which must have type
+ *                     \ref CYAML_SEQUENCE.  It must remain valid until
+ *                     \ref cyaml_writer_sequence_end is called.
+ * \return \ref CYAML_OK on success, \ref CYAML_ERR_WRITER_STATE if a
+ *         sequence is already being written or the stream is finished, or
+ *         appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_writer_sequence_start(
+		cyaml_writer_t *writer,
+		const cyaml_schema_value_t *schema);
+
+/**
+ * Write an entry of the sequence started by
+ * \ref cyaml_writer_sequence_start.
+ *
+ * \param[in]  writer  The writer to use.
+ * \param[in]  data    Points to the entry's data, laid out as it would be
+ *                     in the sequence's array of entries.  So, if the
+ *                     entry schema has \ref CYAML_FLAG_POINTER, this points
+ *                     to the pointer to the entry.
+ * \return \ref CYAML_OK on success, \ref CYAML_ERR_WRITER_STATE if no
+ *         sequence is being written, the error code returned by write_fn
+ *         if it failed, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_writer_sequence_entry(
+		cyaml_writer_t *writer,
+		const cyaml_data_t *data);
+
+/**
+ * End the sequence started by \ref cyaml_writer_sequence_start, and its
+ * document.
+ *
+ * \param[in]  writer  The writer to use.
+ * \return \ref CYAML_OK on success, \ref CYAML_ERR_WRITER_STATE if no
+ *         sequence is being written, the error code returned by write_fn
+ *         if it failed, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_writer_sequence_end(
+		cyaml_writer_t *writer);
+
+/**
+ * Pass everything buffered by an incremental writer to its output.
+ *
+ * `libyaml` holds back the last few events written, until it sees enough
+ * of what follows to choose how to write them, so output may still lag
+ * slightly behind the entries that have been written.
+ *
+ * \param[in]  writer  The writer to flush.
+ * \return \ref CYAML_OK on success, the error code returned by write_fn if
+ *         it failed, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_writer_flush(
+		cyaml_writer_t *writer);
+
+/**
+ * End an incremental writer's output stream.
+ *
+ * After this, the writer may only be destroyed.
+ *
+ * \param[in]  writer  The writer to finish.
+ * \return \ref CYAML_OK on success, \ref CYAML_ERR_WRITER_STATE if a
+ *         sequence is being written or the stream is already finished,
+ *         the error code returned by write_fn if it failed, or appropriate
+ *         error code otherwise.
+ */
+extern cyaml_err_t cyaml_writer_finish(
+		cyaml_writer_t *writer);
+
+/**
+ * Destroy an incremental writer.
+ *
+ * This does not finish the output stream.
+ *
+ * \param[in]  writer  The writer to destroy, or NULL.
+ */
+extern void cyaml_writer_destroy(
+		cyaml_writer_t *writer);
+
+/**
+ * Free data returned by a CYAML load function.
+ *
+ * This is a convenience function, which is here purely to minimise the
+ * amount of code required in clients.  Clients would be better off writing
+ * their own free function for the specific data once loaded.
+ *
+ * \note All nested data is freed.  The data is walked iteratively, so
+ *       deeply nested data doesn't exhaust the C stack.
+ *
+ * \note If the data was loaded with \ref CYAML_CFG_ARENA set, then config
+ *       must also have \ref CYAML_CFG_ARENA set.  In that case the data's
+ *       arena is freed in one go, and the schema is not walked.
+ *
+ * \param[in] config     The client's CYAML library config.
+ * \param[in] schema     The schema describing the content of data.  Must match
+ *                       the schema given to the CYAML load function used to
+ *                       load the data.
+ * \param[in] data       The data structure to free.
+ * \param[in] seq_count  If top level type is sequence, this should be the
+ *                       entry count, otherwise it is ignored.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_free(
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		cyaml_data_t *data,
+		unsigned seq_count);
+
+/**
+ * Make a deep copy of a data structure, using its schema.
+ *
+ * Each allocation in the data is copied, and the pointers in the copy are
+ * set to point to the copied allocations.  The copy is made with the
+ * config's allocator, and is freed with \ref cyaml_free, in the same way
+ * as loaded data.
+ *
+ * \note If config has \ref CYAML_CFG_ARENA set, the copy is made by
+ *       \ref cyaml_compact.
+ *
+ * \param[in]  config     The client's CYAML library config.
+ * \param[in]  schema     The schema describing the content of data.
+ * \param[in]  data       The data structure to copy.
+ * \param[in]  seq_count  If top level type is sequence, this should be the
+ *                        entry count, otherwise it must be 0.
+ * \param[out] copy_out   Returns the copy on success, which is NULL if the
+ *                        data has nothing to copy.  Untouched on failure.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_copy(
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		const cyaml_data_t *data,
+		unsigned seq_count,
+		cyaml_data_t **copy_out);
+
+/**
+ * Make a compacted deep copy of a data structure, using its schema.
+ *
+ * The copy is made in a single allocation, with each value's contents
+ * following it, which is cheaper to free and to walk than the scattered
+ * allocations of loaded data.
+ *
+ * The copy must be freed with \ref cyaml_free, with a config that has
+ * \ref CYAML_CFG_ARENA set.
+ *
+ * \param[in]  config     The client's CYAML library config.
+ * \param[in]  schema     The schema describing the content of data.
+ * \param[in]  data       The data structure to copy.
+ * \param[in]  seq_count  If top level type is sequence, this should be the
+ *                        entry count, otherwise it must be 0.
+ * \param[out] copy_out   Returns the copy on success, which is NULL if the
+ *                        data has nothing to copy.  Untouched on failure.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_compact(
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		const cyaml_data_t *data,
+		unsigned seq_count,
+		cyaml_data_t **copy_out);
+
+/**
+ * Compare two data structures, using their schema.
+ *
+ * Strings are compared by content, and pointers that are both NULL, or
+ * that point to the same allocation, are equal.  Values whose schemas
+ * contain no pointers or strings are compared byte for byte, so any
+ * padding in them must be zeroed, as it is in loaded and copied data.
+ *
+ * \param[in]  config     The client's CYAML library config.
+ * \param[in]  schema     The schema describing the content of the data.
+ * \param[in]  a          The first data structure.
+ * \param[in]  a_count    If top level type is sequence, this should be the
+ *                        entry count of `a`, otherwise it must be 0.
+ * \param[in]  b          The second data structure.
+ * \param[in]  b_count    If top level type is sequence, this should be the
+ *                        entry count of `b`, otherwise it must be 0.
+ * \param[out] equal_out  Returns whether the data structures are equal on
+ *                        success.  Untouched on failure.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_equal(
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		const cyaml_data_t *a,
+		unsigned a_count,
+		const cyaml_data_t *b,
+		unsigned b_count,
+		bool *equal_out);
+
+/**
+ * Validate and compile a schema.
+ *
+ * The whole schema is checked up front, rather than errors being found
+ * as values using the bad parts are loaded or saved.  Data needed to
+ * load, save and free values of the schema is worked out once, and kept
+ * in the returned compiled schema.
+ *
+ * To use the compiled schema, set it as the `compiled` member of a
+ * \ref cyaml_config_t.  The schema must remain valid for the lifetime of
+ * the compiled schema.
+ *
+ * \param[in]  config        Client's CYAML configuration structure.
+ * \param[in]  schema        The top-level schema to compile.
+ * \param[out] compiled_out  Returns the compiled schema on success.
+ *                           Untouched on failure.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_schema_compile(
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		cyaml_schema_compiled_t **compiled_out);
+
+/**
+ * Free a compiled schema.
+ *
+ * The compiled schema must not be in use by any config.
+ *
+ * \param[in]  config    Client's CYAML configuration structure.
+ * \param[in]  compiled  The compiled schema to free, or NULL.
+ */
+extern void cyaml_schema_compiled_free(
+		const cyaml_config_t *config,
+		cyaml_schema_compiled_t *compiled);
+
+/**
+ * Save loaded data as a binary snapshot file.
+ *
+ * A snapshot can be loaded with \ref cyaml_snapshot_load much faster than
+ * the YAML it came from, since there is nothing to parse.  Snapshots use
+ * the host's data layout, so they should be treated as a cache, and not
+ * moved between platforms.
+ *
+ * The snapshot records a fingerprint of the schema, and the client's
+ * `source` key.  The key should identify the version of the input the
+ * data was loaded from, for example by hashing its contents or its file
+ * modification time.
+ *
+ * \param[in]  path       Path to write the snapshot file to.
+ * \param[in]  config     Client's CYAML configuration structure.
+ * \param[in]  schema     CYAML schema for the data.
+ * \param[in]  data       The data to save, as loaded by CYAML.
+ * \param[in]  seq_count  If top level type is sequence, this should be the
+ *                        entry count, otherwise it is ignored.
+ * \param[in]  source     Client's key for the input the data came from.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_snapshot_save(
+		const char *path,
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		const cyaml_data_t *data,
+		unsigned seq_count,
+		uint64_t source);
+
+/**
+ * Load data from a binary snapshot file.
+ *
+ * The loaded data is the same as the data given to \ref cyaml_snapshot_save,
+ * and is freed with \ref cyaml_free in the same way as data loaded from
+ * YAML.  If \ref CYAML_CFG_ARENA is set, the whole snapshot is read into
+ * a single arena allocation.
+ *
+ * \param[in]  path           Path to snapshot file to load.
+ * \param[in]  config         Client's CYAML configuration structure.
+ * \param[in]  schema         CYAML schema for the data.
+ * \param[in]  source         Client's key for the expected input.
+ * \param[out] data_out       Returns the caller-owned loaded data on success.
+ *                            Untouched on failure.
+ * \param[out] seq_count_out  On success, returns the sequence entry count.
+ *                            Untouched on failure.
+ *                            Must be non-NULL if top-level schema type is
+ *                            \ref CYAML_SEQUENCE, otherwise, must be NULL.
+ * \return \ref CYAML_OK on success, \ref CYAML_ERR_SNAPSHOT_STALE if the
+ *         snapshot was saved with a different schema, source key or
+ *         platform, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_snapshot_load(
+		const char *path,
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		uint64_t source,
+		cyaml_data_t **data_out,
+		unsigned *seq_count_out);
+
+/**
+ * Load a YAML document from a file, using a snapshot cache.
+ *
+ * If the snapshot at `snapshot_path` was saved from the current version of
+ * the file, the data is loaded from the snapshot, and the YAML isn't read.
+ * Otherwise the YAML is loaded as if by \ref cyaml_load_file, and a new
+ * snapshot is saved.  Failure to save the snapshot is not an error.
+ *
+ * The file's version is identified by its device, inode, size and
+ * modification time.
+ *
+ * \param[in]  path           Path to YAML file to load.
+ * \param[in]  snapshot_path  Path to the snapshot file for the YAML file.
+ * \param[in]  config         Client's CYAML configuration structure.
+ * \param[in]  schema         CYAML schema for the YAML to be loaded.
+ * \param[out] data_out       Returns the caller-owned loaded data on success.
+ *                            Untouched on failure.
+ * \param[out] seq_count_out  On success, returns the sequence entry count.
+ *                            Untouched on failure.
+ *                            Must be non-NULL if top-level schema type is
+ *                            \ref CYAML_SEQUENCE, otherwise, must be NULL.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_load_file_cached(
+		const char *path,
+		const char *snapshot_path,
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		cyaml_data_t **data_out,
+		unsigned *seq_count_out);
 
 /**
  * Convert a cyaml error code to a human-readable string.
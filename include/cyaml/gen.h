@@ -0,0 +1,511 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (C) 2019 Michael Drake <tlsa@netsurf-browser.org>
+ */
+
+/**
+ * \file
+ * \brief CYAML generated code run time.
+ *
+ * LibCYAML normally interprets a schema at run time: every value is loaded
+ * and saved by code that looks at the schema's type, flags and sizes.  For
+ * a schema that is fixed at build time, the `cyaml-gen` tool can instead
+ * write C source for load, save and free functions that are specialised
+ * for that one schema.  The generated code has the schema's offsets,
+ * sizes, mapping keys and enumeration strings built in.  Values are
+ * stored in the client's data with the same layout the interpreter uses,
+ * so data loaded by either can be saved or freed by the other.
+ *
+ * A schema called `config_schema` would get generated functions like:
+ *
+ * ```
+ * cyaml_err_t config_load_data(const uint8_t *input, size_t input_len,
+ *         const cyaml_config_t *config, cyaml_data_t **data_out);
+ * cyaml_err_t config_save_data(char **output, size_t *len,
+ *         const cyaml_config_t *config, const cyaml_data_t *data);
+ * cyaml_err_t config_free(const cyaml_config_t *config,
+ *         cyaml_data_t *data);
+ * ```
+ *
+ * They take the same arguments and give the same results as \ref
+ * cyaml_load_data, \ref cyaml_save_data and \ref cyaml_free, without the
+ * schema.  For a top level \ref CYAML_SEQUENCE the functions also have the
+ * `seq_count` argument.
+ *
+ * The generated code only handles the plain loading and saving options.
+ * Loading with a config that uses \ref CYAML_CFG_ARENA, \ref
+ * CYAML_CFG_PROJECTION, \ref CYAML_CFG_CASE_INSENSITIVE, an `entry_fn`,
+ * `stats` or nonzero `limits`, saving with \ref CYAML_CFG_ALIASES or
+ * `stats`, and freeing arena allocated data are left to the interpreter.
+ * The generated functions pass such calls on to the LibCYAML interpreter
+ * if they were generated with a schema expression to fall back to.
+ * Otherwise, they return \ref CYAML_ERR_NOT_SUPPORTED.
+ *
+ * This header is the small run time that generated code is built on.
+ * Clients shouldn't need to call it directly.  The generator itself is
+ * not part of the library; see the `gen` target in the LibCYAML Makefile.
+ */
+
+#ifndef CYAML_GEN_H
+#define CYAML_GEN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "cyaml/cyaml.h"
+
+/** Size of buffer needed by the number formatting functions. */
+#define CYAML_GEN_NUMBER_BUF_SIZE 32
+
+/**
+ * Events given to generated loading code.
+ */
+typedef enum cyaml_gen_event {
+	CYAML_GEN_EVT_SCALAR,    /**< A scalar value. */
+	CYAML_GEN_EVT_SEQ_START, /**< Start of a sequence. */
+	CYAML_GEN_EVT_SEQ_END,   /**< End of a sequence. */
+	CYAML_GEN_EVT_MAP_START, /**< Start of a mapping. */
+	CYAML_GEN_EVT_MAP_END,   /**< End of a mapping. */
+	CYAML_GEN_EVT_NONE,      /**< The input has no document. */
+} cyaml_gen_event_t;
+
+/**
+ * Styles for generated saving code's mappings and sequences.
+ */
+typedef enum cyaml_gen_style {
+	/** Use the style from the \ref cyaml_config_t flags. */
+	CYAML_GEN_STYLE_DEFAULT,
+	CYAML_GEN_STYLE_BLOCK,   /**< Block style. */
+	CYAML_GEN_STYLE_FLOW,    /**< Flow style. */
+} cyaml_gen_style_t;
+
+/** Opaque generated code loading context. */
+typedef struct cyaml_gen_load cyaml_gen_load_t;
+
+/** Opaque generated code saving context. */
+typedef struct cyaml_gen_save cyaml_gen_save_t;
+
+/**
+ * Operations done by generated code.
+ */
+typedef enum cyaml_gen_op {
+	CYAML_GEN_OP_LOAD, /**< Loading, as for \ref cyaml_load_data. */
+	CYAML_GEN_OP_SAVE, /**< Saving, as for \ref cyaml_save_data. */
+	CYAML_GEN_OP_FREE, /**< Freeing, as for \ref cyaml_free. */
+} cyaml_gen_op_t;
+
+/**
+ * Check whether generated code can handle a client config.
+ *
+ * \param[in]  config  Client's CYAML configuration structure.
+ * \param[in]  op      The operation config is for.
+ * \return \ref CYAML_OK if generated code can handle config, \ref
+ *         CYAML_ERR_NOT_SUPPORTED if it must be left to the interpreter,
+ *         or appropriate error code if config is invalid.
+ */
+extern cyaml_err_t cyaml_gen_check_config(
+		const cyaml_config_t *config,
+		cyaml_gen_op_t op);
+
+/**
+ * Start loading from a buffer.
+ *
+ * \param[in]  config    Client's CYAML configuration structure.
+ * \param[in]  input     Input YAML data.
+ * \param[in]  input_len Length of input in bytes.
+ * \param[out] load_out  Returns the loading context on success.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_gen_load_start(
+		const cyaml_config_t *config,
+		const uint8_t *input,
+		size_t input_len,
+		cyaml_gen_load_t **load_out);
+
+/**
+ * Start the input's document, and get the event for its root value.
+ *
+ * \param[in]  load       The loading context.
+ * \param[out] event_out  Returns the root value's event, or \ref
+ *                        CYAML_GEN_EVT_NONE if there is no document.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_gen_load_document(
+		cyaml_gen_load_t *load,
+		cyaml_gen_event_t *event_out);
+
+/**
+ * Get the next event.
+ *
+ * YAML aliases are rejected with \ref CYAML_ERR_ALIAS.
+ *
+ * \param[in]  load       The loading context.
+ * \param[out] event_out  Returns the event.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_gen_load_next(
+		cyaml_gen_load_t *load,
+		cyaml_gen_event_t *event_out);
+
+/**
+ * Get the value of the current \ref CYAML_GEN_EVT_SCALAR event.
+ *
+ * \param[in]  load     The loading context.
+ * \param[out] len_out  Returns the value's length in bytes.
+ * \return the nul terminated value, valid until the next event.
+ */
+extern const char * cyaml_gen_load_scalar(
+		const cyaml_gen_load_t *load,
+		size_t *len_out);
+
+/**
+ * Skip over the value starting with the current event.
+ *
+ * \param[in]  load   The loading context.
+ * \param[in]  event  The current event.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_gen_load_skip(
+		cyaml_gen_load_t *load,
+		cyaml_gen_event_t event);
+
+/**
+ * Finish the document, once its root value is loaded.
+ *
+ * Any documents after the first are ignored, as by \ref cyaml_load_data.
+ *
+ * \param[in]  load  The loading context.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_gen_load_finish(
+		cyaml_gen_load_t *load);
+
+/**
+ * Get a loading context's client config.
+ *
+ * \param[in]  load  The loading context.
+ * \return the client's CYAML configuration structure.
+ */
+extern const cyaml_config_t * cyaml_gen_load_config(
+		const cyaml_gen_load_t *load);
+
+/**
+ * Allocate or grow an allocation for loaded data.
+ *
+ * Any new bytes are zeroed.
+ *
+ * \param[in]  load      The loading context.
+ * \param[in]  ptr       Existing allocation, or NULL.
+ * \param[in]  old_size  Size of existing allocation in bytes.
+ * \param[in]  new_size  Size of allocation needed in bytes.
+ * \return the allocation, or NULL on failure, leaving ptr unchanged.
+ */
+extern void * cyaml_gen_load_alloc(
+		cyaml_gen_load_t *load,
+		void *ptr,
+		size_t old_size,
+		size_t new_size);
+
+/**
+ * Destroy a loading context.
+ *
+ * \param[in]  load  The loading context to destroy, or NULL.
+ */
+extern void cyaml_gen_load_destroy(
+		cyaml_gen_load_t *load);
+
+/**
+ * Free an allocation made for loaded data.
+ *
+ * \param[in]  config  Client's CYAML configuration structure.
+ * \param[in]  ptr     The allocation to free, or NULL.
+ */
+extern void cyaml_gen_free(
+		const cyaml_config_t *config,
+		void *ptr);
+
+/**
+ * Write an integer value to client data.
+ *
+ * Like the interpreter, integers, sequence entry counts and pointers are
+ * stored least significant byte first.
+ *
+ * \param[in]  value  The value to write.
+ * \param[in]  size   The number of bytes of value to write; 1 to 8.
+ * \param[in]  data   The address to write to.
+ */
+static inline void cyaml_gen_data_write(
+		uint64_t value,
+		unsigned size,
+		uint8_t *data)
+{
+	switch (size) {
+	case 8: data[7] = (uint8_t)(value >> 56); /* Fall through. */
+	case 7: data[6] = (uint8_t)(value >> 48); /* Fall through. */
+	case 6: data[5] = (uint8_t)(value >> 40); /* Fall through. */
+	case 5: data[4] = (uint8_t)(value >> 32); /* Fall through. */
+	case 4: data[3] = (uint8_t)(value >> 24); /* Fall through. */
+	case 3: data[2] = (uint8_t)(value >> 16); /* Fall through. */
+	case 2: data[1] = (uint8_t)(value >>  8); /* Fall through. */
+	case 1: data[0] = (uint8_t)(value >>  0); /* Fall through. */
+	default: break;
+	}
+}
+
+/**
+ * Read an integer value from client data.
+ *
+ * \param[in]  size  The number of bytes to read; 1 to 8.
+ * \param[in]  data  The address to read from.
+ * \return the value read from data.
+ */
+static inline uint64_t cyaml_gen_data_read(
+		unsigned size,
+		const uint8_t *data)
+{
+	uint64_t value = 0;
+
+	switch (size) {
+	case 8: value |= (uint64_t)data[7] << 56; /* Fall through. */
+	case 7: value |= (uint64_t)data[6] << 48; /* Fall through. */
+	case 6: value |= (uint64_t)data[5] << 40; /* Fall through. */
+	case 5: value |= (uint64_t)data[4] << 32; /* Fall through. */
+	case 4: value |= (uint64_t)data[3] << 24; /* Fall through. */
+	case 3: value |= (uint64_t)data[2] << 16; /* Fall through. */
+	case 2: value |= (uint64_t)data[1] <<  8; /* Fall through. */
+	case 1: value |= (uint64_t)data[0] <<  0; /* Fall through. */
+	default: break;
+	}
+
+	return value;
+}
+
+/**
+ * Write a pointer to client data.
+ *
+ * \param[in]  ptr   The pointer to write.
+ * \param[in]  data  The address to write to.
+ */
+static inline void cyaml_gen_data_write_pointer(
+		const void *ptr,
+		uint8_t *data)
+{
+	cyaml_gen_data_write((uint64_t)(uintptr_t)ptr, sizeof(ptr), data);
+}
+
+/**
+ * Read a pointer from client data.
+ *
+ * \param[in]  data  The address to read from.
+ * \return the pointer read from data.
+ */
+static inline void * cyaml_gen_data_read_pointer(
+		const uint8_t *data)
+{
+	return (void *)(uintptr_t)cyaml_gen_data_read(sizeof(void *), data);
+}
+
+/**
+ * Parse a signed integer, as for \ref CYAML_INT.
+ *
+ * \param[in]  value      The string to parse.
+ * \param[in]  len        Length of value in bytes.
+ * \param[out] value_out  Updated with the parsed value on success.
+ * \return true on success, false if value is not a valid integer.
+ */
+extern bool cyaml_gen_parse_int(
+		const char *value,
+		size_t len,
+		int64_t *value_out);
+
+/**
+ * Parse an unsigned integer, as for \ref CYAML_UINT.
+ *
+ * \param[in]  value      The string to parse.
+ * \param[in]  len        Length of value in bytes.
+ * \param[out] value_out  Updated with the parsed value on success.
+ * \return true on success, false if value is not a valid integer.
+ */
+extern bool cyaml_gen_parse_uint(
+		const char *value,
+		size_t len,
+		uint64_t *value_out);
+
+/**
+ * Parse a single precision floating point value, as for \ref CYAML_FLOAT.
+ *
+ * \param[in]  value      The string to parse.
+ * \param[in]  len        Length of value in bytes.
+ * \param[out] value_out  Updated with the parsed value on success.
+ * \return true on success, false if value is not a valid number.
+ */
+extern bool cyaml_gen_parse_float(
+		const char *value,
+		size_t len,
+		float *value_out);
+
+/**
+ * Parse a double precision floating point value, as for \ref CYAML_FLOAT.
+ *
+ * \param[in]  value      The string to parse.
+ * \param[in]  len        Length of value in bytes.
+ * \param[out] value_out  Updated with the parsed value on success.
+ * \return true on success, false if value is not a valid number.
+ */
+extern bool cyaml_gen_parse_double(
+		const char *value,
+		size_t len,
+		double *value_out);
+
+/**
+ * Parse a boolean value, as for \ref CYAML_BOOL.
+ *
+ * \param[in]  value  The string to parse.
+ * \param[in]  len    Length of value in bytes.
+ * \return the boolean value.
+ */
+extern bool cyaml_gen_parse_bool(
+		const char *value,
+		size_t len);
+
+/**
+ * Format a signed integer.
+ *
+ * \param[in]  value  The integer to format.
+ * \param[out] buf    Buffer of at least \ref CYAML_GEN_NUMBER_BUF_SIZE
+ *                    bytes.
+ * \return the length of the formatted string.
+ */
+extern size_t cyaml_gen_format_int(
+		int64_t value,
+		char *buf);
+
+/**
+ * Format an unsigned integer.
+ *
+ * \param[in]  value  The integer to format.
+ * \param[out] buf    Buffer of at least \ref CYAML_GEN_NUMBER_BUF_SIZE
+ *                    bytes.
+ * \return the length of the formatted string.
+ */
+extern size_t cyaml_gen_format_uint(
+		uint64_t value,
+		char *buf);
+
+/**
+ * Format a single precision floating point value.
+ *
+ * \param[in]  value  The value to format.
+ * \param[out] buf    Buffer of at least \ref CYAML_GEN_NUMBER_BUF_SIZE
+ *                    bytes.
+ * \return the length of the formatted string.
+ */
+extern size_t cyaml_gen_format_float(
+		float value,
+		char *buf);
+
+/**
+ * Format a double precision floating point value.
+ *
+ * \param[in]  value  The value to format.
+ * \param[out] buf    Buffer of at least \ref CYAML_GEN_NUMBER_BUF_SIZE
+ *                    bytes.
+ * \return the length of the formatted string.
+ */
+extern size_t cyaml_gen_format_double(
+		double value,
+		char *buf);
+
+/**
+ * Start saving to an allocated buffer.
+ *
+ * This starts the document.
+ *
+ * \param[in]  config    Client's CYAML configuration structure.
+ * \param[out] save_out  Returns the saving context on success.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_gen_save_start(
+		const cyaml_config_t *config,
+		cyaml_gen_save_t **save_out);
+
+/**
+ * Start a mapping.
+ *
+ * \param[in]  save   The saving context.
+ * \param[in]  style  The mapping's style.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_gen_save_mapping_start(
+		cyaml_gen_save_t *save,
+		cyaml_gen_style_t style);
+
+/**
+ * End a mapping.
+ *
+ * \param[in]  save  The saving context.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_gen_save_mapping_end(
+		cyaml_gen_save_t *save);
+
+/**
+ * Start a sequence.
+ *
+ * \param[in]  save   The saving context.
+ * \param[in]  style  The sequence's style.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_gen_save_sequence_start(
+		cyaml_gen_save_t *save,
+		cyaml_gen_style_t style);
+
+/**
+ * End a sequence.
+ *
+ * \param[in]  save  The saving context.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_gen_save_sequence_end(
+		cyaml_gen_save_t *save);
+
+/**
+ * Write a scalar.
+ *
+ * \param[in]  save   The saving context.
+ * \param[in]  value  The scalar's UTF-8 value.
+ * \param[in]  len    Length of value in bytes.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_gen_save_scalar(
+		cyaml_gen_save_t *save,
+		const char *value,
+		size_t len);
+
+/**
+ * Finish the document, and take the output.
+ *
+ * On success, the client must free the output with the config's `mem_fn`,
+ * as for \ref cyaml_save_data.
+ *
+ * \param[in]  save    The saving context.
+ * \param[out] output  Returns the allocated output buffer.
+ * \param[out] len     Returns the length of output in bytes.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_gen_save_finish(
+		cyaml_gen_save_t *save,
+		char **output,
+		size_t *len);
+
+/**
+ * Destroy a saving context.
+ *
+ * \param[in]  save  The saving context to destroy, or NULL.
+ */
+extern void cyaml_gen_save_destroy(
+		cyaml_gen_save_t *save);
+
+#endif
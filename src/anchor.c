@@ -0,0 +1,451 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (C) 2019 Michael Drake <tlsa@netsurf-browser.org>
+ */
+
+/**
+ * \file
+ * \brief CYAML anchor and alias tables.
+ *
+ * Both tables are open addressed hash tables with linear probing, which
+ * are kept at most half full.  Anchor table slots index an array of the
+ * document's anchors, so that anchors being loaded can be referred to by
+ * index while the table grows.
+ */
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "anchor.h"
+#include "util.h"
+#include "mem.h"
+
+/** Number of slots in a newly created table. */
+#define CYAML_ANCHOR_SLOTS_MIN 64
+
+/** Number of entries in a newly created anchor array. */
+#define CYAML_ANCHOR_ENTRIES_MIN 16
+
+/** Number of bytes in a newly created anchor name buffer. */
+#define CYAML_ANCHOR_NAMES_MIN 256
+
+/**
+ * Hash an anchor name.
+ *
+ * \param[in]  str  Name to hash.
+ * \param[in]  len  Length of str in bytes.
+ * \return hash of the name.
+ */
+static inline uint32_t cyaml__anchor_hash(
+		const char *str,
+		size_t len)
+{
+	const uint8_t *s = (const uint8_t *)str;
+	uint32_t hash = 2166136261u; /* FNV-1a offset basis. */
+
+	for (size_t i = 0; i < len; i++) {
+		hash = (hash ^ s[i]) * 16777619u; /* FNV-1a prime. */
+	}
+
+	return hash;
+}
+
+/**
+ * Hash a pointer.
+ *
+ * \param[in]  ptr  Pointer to hash.
+ * \return hash of the pointer.
+ */
+static inline uint32_t cyaml__shared_hash(
+		const void *ptr)
+{
+	uint64_t v = (uintptr_t)ptr;
+
+	v ^= v >> 29;
+	v *= 0x9e3779b97f4a7c15u; /* Fibonacci hashing multiplier. */
+
+	return (uint32_t)(v >> 32);
+}
+
+/* Exported function, documented in anchor.h. */
+bool cyaml_anchor_schema_match(
+		const cyaml_schema_value_t *anchor,
+		uint32_t count,
+		const cyaml_schema_value_t *schema)
+{
+	/* Flags that make no difference to a loaded value. */
+	const unsigned ignored = CYAML_FLAG_OPTIONAL |
+			CYAML_FLAG_BLOCK | CYAML_FLAG_FLOW;
+
+	if (!(schema->flags & CYAML_FLAG_POINTER)) {
+		return false;
+	}
+	if (anchor == schema) {
+		return true;
+	}
+	if (anchor->type != schema->type ||
+	    anchor->data_size != schema->data_size ||
+	    (anchor->flags & ~ignored) != (schema->flags & ~ignored)) {
+		return false;
+	}
+
+	switch (schema->type) {
+	case CYAML_STRING:
+		return anchor->string.min >= schema->string.min &&
+		       anchor->string.max <= schema->string.max;
+	case CYAML_MAPPING:
+		return anchor->mapping.fields == schema->mapping.fields;
+	case CYAML_SEQUENCE: /* Fall through. */
+	case CYAML_SEQUENCE_FIXED:
+		return anchor->sequence.entry == schema->sequence.entry &&
+		       count >= schema->sequence.min &&
+		       count <= schema->sequence.max;
+	case CYAML_ENUM: /* Fall through. */
+	case CYAML_FLAGS:
+		return anchor->enumeration.strings ==
+				schema->enumeration.strings &&
+		       anchor->enumeration.count ==
+				schema->enumeration.count;
+	default:
+		return true;
+	}
+}
+
+/**
+ * Resize an anchor table's hash table, rehashing its anchors.
+ *
+ * \param[in]      config   The client's CYAML library config.
+ * \param[in,out]  anchors  The anchor table to resize.
+ * \param[in]      slots    New number of slots; a power of two.
+ * \return true on success, false on allocation failure.
+ */
+static bool cyaml__anchors_resize(
+		const cyaml_config_t *config,
+		cyaml_anchors_t *anchors,
+		uint32_t slots)
+{
+	uint32_t *old = anchors->slots;
+	uint32_t old_slots = (old == NULL) ? 0 : anchors->mask + 1;
+	uint32_t *temp;
+
+	temp = cyaml__alloc(config, sizeof(*temp) * slots, true);
+	if (temp == NULL) {
+		return false;
+	}
+
+	for (uint32_t i = 0; i < old_slots; i++) {
+		uint32_t pos;
+
+		if (old[i] == 0) {
+			continue;
+		}
+
+		pos = anchors->entries[old[i] - 1].hash & (slots - 1);
+		while (temp[pos] != 0) {
+			pos = (pos + 1) & (slots - 1);
+		}
+		temp[pos] = old[i];
+	}
+
+	cyaml__free(config, old);
+	anchors->slots = temp;
+	anchors->mask = slots - 1;
+
+	return true;
+}
+
+/**
+ * Ensure an anchor table has space for a new anchor.
+ *
+ * \param[in]      config   The client's CYAML library config.
+ * \param[in,out]  anchors  The anchor table.
+ * \param[in]      len      Length of the new anchor's name in bytes.
+ * \return true on success, false on allocation failure.
+ */
+static bool cyaml__anchors_ensure(
+		const cyaml_config_t *config,
+		cyaml_anchors_t *anchors,
+		size_t len)
+{
+	if (anchors->count == anchors->max) {
+		uint32_t max = (anchors->max == 0) ?
+				CYAML_ANCHOR_ENTRIES_MIN : anchors->max * 2;
+		cyaml_anchor_t *temp;
+
+		if (max < anchors->max) {
+			return false;
+		}
+		temp = cyaml__realloc(config, anchors->entries, 0,
+				sizeof(*temp) * max, false);
+		if (temp == NULL) {
+			return false;
+		}
+		anchors->entries = temp;
+		anchors->max = max;
+	}
+
+	if (len >= UINT32_MAX / 2 - anchors->names_used) {
+		return false;
+	}
+	if (anchors->names_used + len + 1 > anchors->names_max) {
+		uint32_t max = (anchors->names_max == 0) ?
+				CYAML_ANCHOR_NAMES_MIN : anchors->names_max;
+		char *temp;
+
+		while (anchors->names_used + len + 1 > max) {
+			max *= 2;
+		}
+		temp = cyaml__realloc(config, anchors->names, 0, max, false);
+		if (temp == NULL) {
+			return false;
+		}
+		anchors->names = temp;
+		anchors->names_max = max;
+	}
+
+	if (anchors->slots == NULL ||
+	    (anchors->count + 1) * 2 > anchors->mask) {
+		uint32_t slots = (anchors->slots == NULL) ?
+				CYAML_ANCHOR_SLOTS_MIN :
+				(anchors->mask + 1) * 2;
+		if (!cyaml__anchors_resize(config, anchors, slots)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/* Exported function, documented in anchor.h. */
+cyaml_err_t cyaml_anchors_add(
+		const cyaml_config_t *config,
+		cyaml_anchors_t *anchors,
+		const char *name,
+		size_t len,
+		const cyaml_schema_value_t *schema,
+		uint32_t *index_out)
+{
+	uint32_t hash = cyaml__anchor_hash(name, len);
+	cyaml_anchor_t *anchor;
+	uint32_t pos;
+
+	if (!cyaml__anchors_ensure(config, anchors, len)) {
+		return CYAML_ERR_OOM;
+	}
+
+	anchor = &anchors->entries[anchors->count];
+	*anchor = (cyaml_anchor_t) {
+		.name = anchors->names_used,
+		.len = (uint32_t)len,
+		.hash = hash,
+		.schema = schema,
+	};
+	memcpy(anchors->names + anchors->names_used, name, len);
+	anchors->names[anchors->names_used + len] = '\0';
+	anchors->names_used += (uint32_t)len + 1;
+
+	pos = hash & anchors->mask;
+	while (anchors->slots[pos] != 0) {
+		const cyaml_anchor_t *old =
+				&anchors->entries[anchors->slots[pos] - 1];
+		if (old->hash == hash && old->len == len &&
+		    memcmp(anchors->names + old->name, name, len) == 0) {
+			/* Redefined; the new anchor replaces the old. */
+			break;
+		}
+		pos = (pos + 1) & anchors->mask;
+	}
+
+	*index_out = anchors->count;
+	anchors->count++;
+	anchors->slots[pos] = anchors->count;
+
+	return CYAML_OK;
+}
+
+/* Exported function, documented in anchor.h. */
+const cyaml_anchor_t * cyaml_anchors_find(
+		const cyaml_anchors_t *anchors,
+		const char *name,
+		size_t len)
+{
+	uint32_t hash;
+	uint32_t pos;
+
+	if (anchors->slots == NULL) {
+		return NULL;
+	}
+
+	hash = cyaml__anchor_hash(name, len);
+	pos = hash & anchors->mask;
+	while (anchors->slots[pos] != 0) {
+		const cyaml_anchor_t *anchor =
+				&anchors->entries[anchors->slots[pos] - 1];
+		if (anchor->hash == hash && anchor->len == len &&
+		    memcmp(anchors->names + anchor->name, name, len) == 0) {
+			return anchor;
+		}
+		pos = (pos + 1) & anchors->mask;
+	}
+
+	return NULL;
+}
+
+/* Exported function, documented in anchor.h. */
+void cyaml_anchors_clear(
+		cyaml_anchors_t *anchors)
+{
+	if (anchors->slots != NULL) {
+		memset(anchors->slots, 0,
+				sizeof(*anchors->slots) * (anchors->mask + 1));
+	}
+	anchors->count = 0;
+	anchors->names_used = 0;
+}
+
+/* Exported function, documented in anchor.h. */
+void cyaml_anchors_fini(
+		const cyaml_config_t *config,
+		cyaml_anchors_t *anchors)
+{
+	cyaml__free(config, anchors->entries);
+	cyaml__free(config, anchors->slots);
+	cyaml__free(config, anchors->names);
+
+	*anchors = (cyaml_anchors_t) { .entries = NULL };
+}
+
+/**
+ * Resize a shared value table, rehashing its values.
+ *
+ * \param[in]      config  The client's CYAML library config.
+ * \param[in,out]  table   The shared value table to resize.
+ * \param[in]      slots   New number of slots; a power of two.
+ * \return true on success, false on allocation failure.
+ */
+static bool cyaml__shared_resize(
+		const cyaml_config_t *config,
+		cyaml_shared_table_t *table,
+		uint32_t slots)
+{
+	cyaml_shared_t *old = table->slots;
+	uint32_t old_slots = (old == NULL) ? 0 : table->mask + 1;
+	cyaml_shared_t *temp;
+
+	temp = cyaml__alloc(config, sizeof(*temp) * slots, true);
+	if (temp == NULL) {
+		return false;
+	}
+
+	for (uint32_t i = 0; i < old_slots; i++) {
+		uint32_t pos;
+
+		if (old[i].ptr == NULL) {
+			continue;
+		}
+
+		pos = cyaml__shared_hash(old[i].ptr) & (slots - 1);
+		while (temp[pos].ptr != NULL) {
+			pos = (pos + 1) & (slots - 1);
+		}
+		temp[pos] = old[i];
+	}
+
+	cyaml__free(config, old);
+	table->slots = temp;
+	table->mask = slots - 1;
+
+	return true;
+}
+
+/**
+ * Find the slot for a pointer value in a shared value table.
+ *
+ * \param[in]  table   The shared value table.
+ * \param[in]  ptr     The pointer value.
+ * \param[in]  schema  Schema for the pointer value.
+ * \param[in]  count   Entry count, for sequence values, else zero.
+ * \return the value's slot, or the empty slot it belongs in.
+ */
+static cyaml_shared_t * cyaml__shared_slot(
+		const cyaml_shared_table_t *table,
+		const void *ptr,
+		const cyaml_schema_value_t *schema,
+		uint32_t count)
+{
+	uint32_t pos = cyaml__shared_hash(ptr) & table->mask;
+
+	while (table->slots[pos].ptr != NULL) {
+		cyaml_shared_t *slot = &table->slots[pos];
+		if (slot->ptr == ptr && slot->count == count &&
+		    cyaml_anchor_schema_match(slot->schema, count, schema)) {
+			break;
+		}
+		pos = (pos + 1) & table->mask;
+	}
+
+	return &table->slots[pos];
+}
+
+/* Exported function, documented in anchor.h. */
+cyaml_shared_t * cyaml_shared_ref(
+		const cyaml_config_t *config,
+		cyaml_shared_table_t *table,
+		const void *ptr,
+		const cyaml_schema_value_t *schema,
+		uint32_t count)
+{
+	cyaml_shared_t *slot;
+
+	if (table->slots == NULL || (table->count + 1) * 2 > table->mask) {
+		uint32_t slots = (table->slots == NULL) ?
+				CYAML_ANCHOR_SLOTS_MIN : (table->mask + 1) * 2;
+		if (!cyaml__shared_resize(config, table, slots)) {
+			return NULL;
+		}
+	}
+
+	slot = cyaml__shared_slot(table, ptr, schema, count);
+	if (slot->ptr == NULL) {
+		*slot = (cyaml_shared_t) {
+			.ptr = ptr,
+			.schema = schema,
+			.count = count,
+		};
+		table->count++;
+	}
+	slot->refs++;
+
+	return slot;
+}
+
+/* Exported function, documented in anchor.h. */
+cyaml_shared_t * cyaml_shared_find(
+		const cyaml_shared_table_t *table,
+		const void *ptr,
+		const cyaml_schema_value_t *schema,
+		uint32_t count)
+{
+	cyaml_shared_t *slot;
+
+	if (table->slots == NULL) {
+		return NULL;
+	}
+
+	slot = cyaml__shared_slot(table, ptr, schema, count);
+
+	return (slot->ptr == NULL) ? NULL : slot;
+}
+
+/* Exported function, documented in anchor.h. */
+void cyaml_shared_fini(
+		const cyaml_config_t *config,
+		cyaml_shared_table_t *table)
+{
+	cyaml__free(config, table->slots);
+
+	table->slots = NULL;
+	table->count = 0;
+	table->mask = 0;
+}
@@ -0,0 +1,198 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (C) 2019 Michael Drake <tlsa@netsurf-browser.org>
+ */
+
+/**
+ * \file
+ * \brief CYAML anchor and alias tables.
+ *
+ * When the client sets \ref CYAML_CFG_ALIASES, loading records the
+ * \ref CYAML_FLAG_POINTER values that have YAML anchors in an anchor
+ * table, so that later aliases can share their allocations.  Saving
+ * counts the references to each pointer value in a shared value table,
+ * so that values reached more than once are written with anchors.
+ *
+ * Both tables only live for the duration of a load or save; they never
+ * own the client data they point at.
+ */
+
+#ifndef CYAML_ANCHOR_H
+#define CYAML_ANCHOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cyaml/cyaml.h"
+
+/** An anchored value found while loading. */
+typedef struct cyaml_anchor {
+	uint32_t name;  /**< Offset of the anchor name in the name buffer. */
+	uint32_t len;   /**< Length of the anchor name in bytes. */
+	uint32_t hash;  /**< Hash of the anchor name. */
+	uint32_t count; /**< Entry count, for sequence values. */
+	/** Schema the anchored value was loaded with. */
+	const cyaml_schema_value_t *schema;
+	void *data;     /**< The value's allocation, once complete. */
+	bool complete;  /**< Whether the value has been fully loaded. */
+} cyaml_anchor_t;
+
+/** A table of anchored values, by anchor name. */
+typedef struct cyaml_anchors {
+	cyaml_anchor_t *entries; /**< Anchored values, in document order. */
+	uint32_t count;          /**< Number of entries in use. */
+	uint32_t max;            /**< Number of entries allocated. */
+	/** Hash table of entry indexes plus one, or zero for empty slots. */
+	uint32_t *slots;
+	uint32_t mask;           /**< Slot count, minus one. */
+	char *names;             /**< Buffer of anchor names. */
+	uint32_t names_used;     /**< Bytes in use in names buffer. */
+	uint32_t names_max;      /**< Bytes allocated for names buffer. */
+} cyaml_anchors_t;
+
+/** A pointer value found while saving. */
+typedef struct cyaml_shared {
+	const void *ptr; /**< The pointer, or NULL if slot is empty. */
+	/** Schema of the pointer value's first occurrence. */
+	const cyaml_schema_value_t *schema;
+	uint32_t count;  /**< Entry count, for sequence values. */
+	uint32_t refs;   /**< Number of times the value is reached. */
+	uint32_t id;     /**< Anchor number, once written, or zero. */
+} cyaml_shared_t;
+
+/** A table of pointer values, by pointer. */
+typedef struct cyaml_shared_table {
+	cyaml_shared_t *slots; /**< The hash table. */
+	uint32_t count;        /**< Number of values in the table. */
+	uint32_t mask;         /**< Slot count, minus one. */
+} cyaml_shared_table_t;
+
+/**
+ * Check whether a value may be shared by two schema values.
+ *
+ * An alias is only accepted if the anchored value is also a valid value
+ * for the alias's schema, and a saved value is only written as an alias
+ * if it could be loaded that way.  Only \ref CYAML_FLAG_POINTER values
+ * can be shared.
+ *
+ * \param[in]  anchor  Schema the shared value was loaded or found with.
+ * \param[in]  count   Entry count of the shared value, for sequences.
+ * \param[in]  schema  Schema for the other use of the value.
+ * \return true if the value may be shared, false otherwise.
+ */
+bool cyaml_anchor_schema_match(
+		const cyaml_schema_value_t *anchor,
+		uint32_t count,
+		const cyaml_schema_value_t *schema);
+
+/**
+ * Add an anchor to an anchor table.
+ *
+ * The new anchor is incomplete, and replaces any earlier anchor with
+ * the same name for \ref cyaml_anchors_find.
+ *
+ * \param[in]      config     The client's CYAML library config.
+ * \param[in,out]  anchors    The anchor table.
+ * \param[in]      name       The anchor name.
+ * \param[in]      len        Length of name in bytes.
+ * \param[in]      schema     Schema the anchored value is loaded with.
+ * \param[out]     index_out  Returns the index of the new anchor.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+cyaml_err_t cyaml_anchors_add(
+		const cyaml_config_t *config,
+		cyaml_anchors_t *anchors,
+		const char *name,
+		size_t len,
+		const cyaml_schema_value_t *schema,
+		uint32_t *index_out);
+
+/**
+ * Get an anchor by index.
+ *
+ * \param[in]  anchors  The anchor table.
+ * \param[in]  index    Index returned by \ref cyaml_anchors_add.
+ * \return the anchor.
+ */
+static inline cyaml_anchor_t * cyaml_anchors_get(
+		cyaml_anchors_t *anchors,
+		uint32_t index)
+{
+	return &anchors->entries[index];
+}
+
+/**
+ * Find the most recent anchor with a given name.
+ *
+ * \param[in]  anchors  The anchor table.
+ * \param[in]  name     The anchor name.
+ * \param[in]  len      Length of name in bytes.
+ * \return the anchor, or NULL if there is no anchor with the name.
+ */
+const cyaml_anchor_t * cyaml_anchors_find(
+		const cyaml_anchors_t *anchors,
+		const char *name,
+		size_t len);
+
+/**
+ * Forget all of the anchors in an anchor table.
+ *
+ * \param[in,out]  anchors  The anchor table.
+ */
+void cyaml_anchors_clear(
+		cyaml_anchors_t *anchors);
+
+/**
+ * Free an anchor table's resources.
+ *
+ * \param[in]      config   The client's CYAML library config.
+ * \param[in,out]  anchors  The anchor table to finalise.
+ */
+void cyaml_anchors_fini(
+		const cyaml_config_t *config,
+		cyaml_anchors_t *anchors);
+
+/**
+ * Count a reference to a pointer value, adding it if necessary.
+ *
+ * \param[in]      config  The client's CYAML library config.
+ * \param[in,out]  table   The shared value table.
+ * \param[in]      ptr     The pointer value; must not be NULL.
+ * \param[in]      schema  Schema for the pointer value.
+ * \param[in]      count   Entry count, for sequence values, else zero.
+ * \return the table entry for the value, or NULL on allocation failure.
+ */
+cyaml_shared_t * cyaml_shared_ref(
+		const cyaml_config_t *config,
+		cyaml_shared_table_t *table,
+		const void *ptr,
+		const cyaml_schema_value_t *schema,
+		uint32_t count);
+
+/**
+ * Find a pointer value in a shared value table.
+ *
+ * \param[in]  table   The shared value table.
+ * \param[in]  ptr     The pointer value.
+ * \param[in]  schema  Schema for the pointer value.
+ * \param[in]  count   Entry count, for sequence values, else zero.
+ * \return the table entry for the value, or NULL if it is not present.
+ */
+cyaml_shared_t * cyaml_shared_find(
+		const cyaml_shared_table_t *table,
+		const void *ptr,
+		const cyaml_schema_value_t *schema,
+		uint32_t count);
+
+/**
+ * Free a shared value table's resources.
+ *
+ * \param[in]      config  The client's CYAML library config.
+ * \param[in,out]  table   The shared value table to finalise.
+ */
+void cyaml_shared_fini(
+		const cyaml_config_t *config,
+		cyaml_shared_table_t *table);
+
+#endif
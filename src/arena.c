@@ -0,0 +1,317 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (C) 2019 Michael Drake <tlsa@netsurf-browser.org>
+ */
+
+/**
+ * \file
+ * \brief CYAML arena allocation for loaded documents.
+ *
+ * Chunk layout:
+ *
+ *     First chunk:  [chunk][arena][link][root data]...
+ *     Other chunks: [chunk]...
+ *
+ * Chunks are chained newest first.  Allocations are bumped from the end
+ * of the newest chunk.  If the root allocation has to move, it is given
+ * a new link.
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "arena.h"
+#include "util.h"
+#include "mem.h"
+
+/** Alignment of allocations made from the arena. */
+#define CYAML_ARENA_ALIGN (_Alignof(max_align_t))
+
+/** Payload size of the first chunk in an arena. */
+#define CYAML_ARENA_CHUNK_MIN (4096 - CYAML_ARENA_ALIGN * 4)
+
+/** Largest payload size used for chunks, unless an allocation needs more. */
+#define CYAML_ARENA_CHUNK_MAX (1024 * 1024)
+
+/** Header for a chunk of arena memory. */
+typedef struct cyaml_arena_chunk {
+	struct cyaml_arena_chunk *prev; /**< Previously allocated chunk. */
+	size_t size; /**< Number of payload bytes in the chunk. */
+	size_t used; /**< Number of payload bytes used. */
+} cyaml_arena_chunk_t;
+
+/** CYAML document arena. */
+struct cyaml_arena {
+	cyaml_arena_chunk_t *chunk; /**< Newest chunk. */
+	uint8_t *last;              /**< Most recent allocation. */
+	size_t next_size;           /**< Payload size for the next chunk. */
+};
+
+/** Precedes a document's root allocation in the arena. */
+typedef struct cyaml_arena_link {
+	cyaml_arena_t *arena; /**< The arena that the document belongs to. */
+} cyaml_arena_link_t;
+
+/**
+ * Round a size up to the arena's allocation alignment.
+ *
+ * \param[in]  size  The size to align.
+ * \return the aligned size.
+ */
+static inline size_t cyaml__arena_align(
+		size_t size)
+{
+	return (size + CYAML_ARENA_ALIGN - 1) & ~(CYAML_ARENA_ALIGN - 1);
+}
+
+/** Size of the space reserved for a chunk header. */
+#define CYAML_ARENA_CHUNK_HDR \
+		(cyaml__arena_align(sizeof(cyaml_arena_chunk_t)))
+
+/** Size of the space reserved for the arena structure. */
+#define CYAML_ARENA_HDR (cyaml__arena_align(sizeof(cyaml_arena_t)))
+
+/** Size of the space reserved for a root allocation's link. */
+#define CYAML_ARENA_LINK (cyaml__arena_align(sizeof(cyaml_arena_link_t)))
+
+/**
+ * Get a pointer to the start of a chunk's payload.
+ *
+ * \param[in]  chunk  The chunk to get the payload of.
+ * \return pointer to the chunk's payload.
+ */
+static inline uint8_t * cyaml__arena_chunk_data(
+		cyaml_arena_chunk_t *chunk)
+{
+	return (uint8_t *)chunk + CYAML_ARENA_CHUNK_HDR;
+}
+
+/**
+ * Allocate a new chunk, with payload of at least the given size.
+ *
+ * \param[in]  config  The client's CYAML library config.
+ * \param[in]  prev    The chunk the new chunk follows, or NULL.
+ * \param[in]  size    Minimum payload size required.
+ * \param[in]  hint    Preferred payload size.
+ * \return the new chunk, or NULL on allocation failure.
+ */
+static cyaml_arena_chunk_t * cyaml__arena_chunk_create(
+		const cyaml_config_t *config,
+		cyaml_arena_chunk_t *prev,
+		size_t size,
+		size_t hint)
+{
+	cyaml_arena_chunk_t *chunk;
+
+	if (size < hint) {
+		size = hint;
+	}
+
+	chunk = cyaml__alloc(config, CYAML_ARENA_CHUNK_HDR + size, false);
+	if (chunk == NULL) {
+		return NULL;
+	}
+
+	chunk->prev = prev;
+	chunk->size = size;
+	chunk->used = 0;
+
+	cyaml__log(config, CYAML_LOG_DEBUG,
+			"Created arena chunk: %p (%zu bytes)\n", chunk, size);
+
+	return chunk;
+}
+
+/**
+ * Create a new arena.
+ *
+ * \param[in]  config  The client's CYAML library config.
+ * \param[in]  size    Size of the first allocation that will be made.
+ * \return the new arena, or NULL on allocation failure.
+ */
+static cyaml_arena_t * cyaml__arena_create(
+		const cyaml_config_t *config,
+		size_t size)
+{
+	cyaml_arena_chunk_t *chunk;
+	cyaml_arena_t *arena;
+
+	chunk = cyaml__arena_chunk_create(config, NULL,
+			CYAML_ARENA_HDR + size, CYAML_ARENA_CHUNK_MIN);
+	if (chunk == NULL) {
+		return NULL;
+	}
+
+	arena = (cyaml_arena_t *)cyaml__arena_chunk_data(chunk);
+	arena->chunk = chunk;
+	arena->last = NULL;
+	arena->next_size = CYAML_ARENA_CHUNK_MIN * 2;
+
+	chunk->used = CYAML_ARENA_HDR;
+
+	return arena;
+}
+
+/**
+ * Bump a new allocation from the arena.
+ *
+ * \param[in]  config  The client's CYAML library config.
+ * \param[in]  arena   The arena to allocate from.
+ * \param[in]  size    Number of bytes required.
+ * \return pointer to the allocation, or NULL on allocation failure.
+ */
+static uint8_t * cyaml__arena_bump(
+		const cyaml_config_t *config,
+		cyaml_arena_t *arena,
+		size_t size)
+{
+	cyaml_arena_chunk_t *chunk = arena->chunk;
+	uint8_t *ptr;
+
+	size = cyaml__arena_align(size);
+
+	if (chunk->size - chunk->used < size) {
+		chunk = cyaml__arena_chunk_create(config, chunk,
+				size, arena->next_size);
+		if (chunk == NULL) {
+			return NULL;
+		}
+		arena->chunk = chunk;
+		if (arena->next_size < CYAML_ARENA_CHUNK_MAX) {
+			arena->next_size *= 2;
+		}
+	}
+
+	ptr = cyaml__arena_chunk_data(chunk) + chunk->used;
+	chunk->used += size;
+	arena->last = ptr;
+
+	return ptr;
+}
+
+/**
+ * Try to resize the most recent allocation in place.
+ *
+ * Shrinking the most recent allocation returns the space to the chunk.
+ *
+ * \param[in]  arena     The arena the allocation belongs to.
+ * \param[in]  ptr       The start of the allocation, including any link.
+ * \param[in]  new_size  Required size of the allocation.
+ * \return true if the allocation was resized, false otherwise.
+ */
+static bool cyaml__arena_extend(
+		cyaml_arena_t *arena,
+		uint8_t *ptr,
+		size_t new_size)
+{
+	cyaml_arena_chunk_t *chunk = arena->chunk;
+	size_t start;
+
+	if (ptr == NULL || ptr != arena->last) {
+		return false;
+	}
+
+	start = ptr - cyaml__arena_chunk_data(chunk);
+	if (new_size > chunk->size - start) {
+		return false;
+	}
+
+	chunk->used = start + cyaml__arena_align(new_size);
+	return true;
+}
+
+/* Exported function, documented in arena.h. */
+void * cyaml_arena_realloc(
+		const cyaml_config_t *config,
+		cyaml_arena_t **arena_io,
+		void *ptr,
+		size_t current_size,
+		size_t new_size,
+		bool root)
+{
+	size_t link = root ? CYAML_ARENA_LINK : 0;
+	cyaml_arena_t *arena = *arena_io;
+	uint8_t *base = NULL;
+	uint8_t *temp;
+
+	if (arena == NULL) {
+		arena = cyaml__arena_create(config, link + new_size);
+		if (arena == NULL) {
+			return NULL;
+		}
+		*arena_io = arena;
+	}
+
+	if (ptr != NULL) {
+		base = (uint8_t *)ptr - link;
+		if (cyaml__arena_extend(arena, base, link + new_size)) {
+			temp = ptr;
+			goto clean;
+		}
+		if (new_size <= current_size) {
+			/* Not worth moving; just leave the spare space. */
+			return ptr;
+		}
+	} else {
+		current_size = 0;
+	}
+
+	base = cyaml__arena_bump(config, arena, link + new_size);
+	if (base == NULL) {
+		return NULL;
+	}
+
+	if (root) {
+		((cyaml_arena_link_t *)base)->arena = arena;
+	}
+
+	temp = base + link;
+	if (ptr != NULL) {
+		memcpy(temp, ptr, (current_size < new_size) ?
+				current_size : new_size);
+	}
+
+clean:
+	if (new_size > current_size) {
+		memset(temp + current_size, 0, new_size - current_size);
+	}
+
+	return temp;
+}
+
+/* Exported function, documented in arena.h. */
+void cyaml_arena_destroy(
+		const cyaml_config_t *config,
+		cyaml_arena_t *arena)
+{
+	cyaml_arena_chunk_t *chunk;
+
+	if (arena == NULL) {
+		return;
+	}
+
+	/* The arena itself lives in the first chunk, so don't touch it
+	 * once chunks start being freed. */
+	chunk = arena->chunk;
+	while (chunk != NULL) {
+		cyaml_arena_chunk_t *prev = chunk->prev;
+		cyaml__log(config, CYAML_LOG_DEBUG,
+				"Freeing arena chunk: %p\n", chunk);
+		cyaml__free(config, chunk);
+		chunk = prev;
+	}
+}
+
+/* Exported function, documented in arena.h. */
+void cyaml_arena_free(
+		const cyaml_config_t *config,
+		void *root)
+{
+	if (root == NULL) {
+		return;
+	}
+
+	cyaml_arena_destroy(config, ((cyaml_arena_link_t *)
+			((uint8_t *)root - CYAML_ARENA_LINK))->arena);
+}
@@ -0,0 +1,79 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (C) 2019 Michael Drake <tlsa@netsurf-browser.org>
+ */
+
+/**
+ * \file
+ * \brief CYAML arena allocation for loaded documents.
+ *
+ * When the client sets \ref CYAML_CFG_ARENA, all of the allocations that make
+ * up a loaded document are carved out of a small number of large chunks,
+ * rather than each being a separate call to the client's \ref cyaml_mem_fn_t.
+ *
+ * The arena's bookkeeping lives at the start of the first chunk, and the
+ * document's root allocation is always preceded by a link back to it.  This
+ * means the whole document can be freed given only its root pointer.
+ */
+
+#ifndef CYAML_ARENA_H
+#define CYAML_ARENA_H
+
+#include <stdbool.h>
+
+#include "cyaml/cyaml.h"
+
+/** Opaque CYAML document arena. */
+typedef struct cyaml_arena cyaml_arena_t;
+
+/**
+ * Make or resize an allocation in a document arena.
+ *
+ * If `*arena_io` is NULL, a new arena is created.  Any newly allocated
+ * memory is initialised to zero.
+ *
+ * If `ptr` is the most recent allocation in the arena, and there is space,
+ * it is extended in place.  Otherwise a new allocation is made and the
+ * existing contents are copied; the old space is not reused until the whole
+ * arena is freed.
+ *
+ * \param[in]      config        The client's CYAML library config.
+ * \param[in,out]  arena_io      The arena to allocate from, or NULL to create
+ *                               one.  Updated on arena creation.
+ * \param[in]      ptr           The existing allocation or NULL.
+ * \param[in]      current_size  Size of the current allocation.
+ * \param[in]      new_size      The number of bytes to resize allocation to.
+ * \param[in]      root          Whether this is the document's root
+ *                               allocation.
+ * \return Pointer to allocation on success, or `NULL` on failure.
+ */
+void * cyaml_arena_realloc(
+		const cyaml_config_t *config,
+		cyaml_arena_t **arena_io,
+		void *ptr,
+		size_t current_size,
+		size_t new_size,
+		bool root);
+
+/**
+ * Free an entire document arena.
+ *
+ * \param[in]  config  The client's CYAML library config.
+ * \param[in]  arena   The arena to free, or NULL.
+ */
+void cyaml_arena_destroy(
+		const cyaml_config_t *config,
+		cyaml_arena_t *arena);
+
+/**
+ * Free an entire document arena, given the document's root allocation.
+ *
+ * \param[in]  config  The client's CYAML library config.
+ * \param[in]  root    The document's root allocation, or NULL.
+ */
+void cyaml_arena_free(
+		const cyaml_config_t *config,
+		void *root);
+
+#endif
@@ -0,0 +1,222 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (C) 2019 Michael Drake <tlsa@netsurf-browser.org>
+ */
+
+/**
+ * \file
+ * \brief Load batches of independent YAML documents in parallel.
+ *
+ * Worker threads claim the next unloaded item from a shared atomic index.
+ * Since items are claimed one at a time as threads become free, the load
+ * balances itself, however uneven the item sizes are.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "mem.h"
+#include "util.h"
+
+/** Upper limit on the number of threads used for a batch. */
+#define CYAML_BATCH_THREADS_MAX 256
+
+/**
+ * Shared state for loading a batch.
+ */
+typedef struct cyaml_batch {
+	cyaml_batch_item_t *items;          /**< Client's batch items. */
+	size_t count;                       /**< Number of items. */
+	const cyaml_config_t *config;       /**< Client's CYAML config. */
+	const cyaml_schema_value_t *schema; /**< Schema for every item. */
+	atomic_size_t next;                 /**< Index of next item to load. */
+} cyaml_batch_t;
+
+/**
+ * Load a single batch item.
+ *
+ * \param[in]      batch   The batch being loaded.
+ * \param[in]      loader  Loader to load with, or NULL.
+ * \param[in,out]  item    The item to load.
+ */
+static void cyaml__batch_load_item(
+		const cyaml_batch_t *batch,
+		cyaml_loader_t *loader,
+		cyaml_batch_item_t *item)
+{
+	unsigned *seq_count_out = NULL;
+
+	item->data = NULL;
+	item->seq_count = 0;
+
+	if (batch->schema->type == CYAML_SEQUENCE) {
+		seq_count_out = &item->seq_count;
+	}
+
+	if (loader != NULL) {
+		item->err = (item->path != NULL) ?
+				cyaml_loader_load_file(loader, item->path,
+						batch->schema, &item->data,
+						seq_count_out) :
+				cyaml_loader_load_data(loader,
+						item->input, item->input_len,
+						batch->schema, &item->data,
+						seq_count_out);
+	} else {
+		item->err = (item->path != NULL) ?
+				cyaml_load_file(item->path, batch->config,
+						batch->schema, &item->data,
+						seq_count_out) :
+				cyaml_load_data(item->input, item->input_len,
+						batch->config, batch->schema,
+						&item->data, seq_count_out);
+	}
+}
+
+/**
+ * Load batch items until there are none left.
+ *
+ * If a loader can't be created for the thread, items are loaded without
+ * one, which is slower but otherwise equivalent.
+ *
+ * \param[in]  batch  The batch being loaded.
+ */
+static void cyaml__batch_work(
+		cyaml_batch_t *batch)
+{
+	cyaml_loader_t *loader = NULL;
+
+	if (cyaml_loader_create(batch->config, &loader) != CYAML_OK) {
+		loader = NULL;
+	}
+
+	for (;;) {
+		size_t i = atomic_fetch_add_explicit(&batch->next, 1,
+				memory_order_relaxed);
+		if (i >= batch->count) {
+			break;
+		}
+
+		cyaml__batch_load_item(batch, loader, &batch->items[i]);
+	}
+
+	cyaml_loader_destroy(loader);
+}
+
+/**
+ * Worker thread entry point.
+ *
+ * \param[in]  pw  The batch being loaded.
+ * \return NULL.
+ */
+static void * cyaml__batch_thread(
+		void *pw)
+{
+	cyaml__batch_work(pw);
+
+	return NULL;
+}
+
+/**
+ * Get the number of threads to use for a batch.
+ *
+ * \param[in]  threads  Number of threads the client asked for, or 0.
+ * \param[in]  count    Number of items in the batch.
+ * \return the number of threads to use, including the calling thread.
+ */
+static unsigned cyaml__batch_thread_count(
+		unsigned threads,
+		size_t count)
+{
+	if (threads == 0) {
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		threads = (cpus > 0) ? (unsigned)cpus : 1;
+	}
+
+	if (threads > CYAML_BATCH_THREADS_MAX) {
+		threads = CYAML_BATCH_THREADS_MAX;
+	}
+
+	if (threads > count) {
+		threads = (unsigned)count;
+	}
+
+	return threads;
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_load_batch(
+		cyaml_batch_item_t *items,
+		size_t count,
+		unsigned threads,
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema)
+{
+	cyaml_batch_t batch = {
+		.items = items,
+		.count = count,
+		.config = config,
+		.schema = schema,
+	};
+	pthread_t *workers = NULL;
+	unsigned started = 0;
+
+	if (config == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_CONFIG;
+	}
+	if (config->mem_fn == NULL) {
+		return CYAML_ERR_BAD_CONFIG_NULL_MEMFN;
+	}
+	if (schema == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_SCHEMA;
+	}
+	if (items == NULL && count != 0) {
+		return CYAML_ERR_BAD_PARAM_NULL_DATA;
+	}
+	if (count == 0) {
+		return CYAML_OK;
+	}
+
+	atomic_init(&batch.next, 0);
+
+	threads = cyaml__batch_thread_count(threads, count);
+	if (threads > 1) {
+		workers = cyaml__alloc(config,
+				sizeof(*workers) * (threads - 1), false);
+	}
+
+	/* If threads can't be created, the rest of the batch is simply
+	 * shared between fewer threads. */
+	if (workers != NULL) {
+		while (started < threads - 1) {
+			if (pthread_create(&workers[started], NULL,
+					cyaml__batch_thread, &batch) != 0) {
+				break;
+			}
+			started++;
+		}
+	}
+
+	/* The calling thread works too. */
+	cyaml__batch_work(&batch);
+
+	for (unsigned i = 0; i < started; i++) {
+		pthread_join(workers[i], NULL);
+	}
+	cyaml__free(config, workers);
+
+	for (size_t i = 0; i < count; i++) {
+		if (items[i].err != CYAML_OK) {
+			return items[i].err;
+		}
+	}
+
+	return CYAML_OK;
+}
@@ -0,0 +1,827 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (C) 2019 Michael Drake <tlsa@netsurf-browser.org>
+ */
+
+/**
+ * \file
+ * \brief Copy, compact and compare data structures, using their schemas.
+ *
+ * These walk the data in the same way as \ref cyaml_free, with an explicit
+ * work stack.  The first \ref CYAML_COPY_STACK_INLINE levels live on the C
+ * stack, deeper data grows the work stack on the heap, and if that fails,
+ * the subtree is walked with a fresh work stack instead.  Values whose
+ * schemas contain no pointers are never visited.
+ *
+ * Copying
+ * -------
+ *
+ * Each allocation is copied whole, and then the pointers in the copy are
+ * replaced with pointers to copies of what they point to.  If an
+ * allocation fails, the rest of the walk only replaces the pointers that
+ * still point into the source data with NULL, so the partial copy can be
+ * freed as normal.
+ *
+ * Compacting first walks the data to measure it, and then copies it into a
+ * single arena allocation.  Allocations are laid out in the order the walk
+ * reaches them, which is depth-first, so each value's contents follow it.
+ *
+ * Comparing
+ * ---------
+ *
+ * Values whose schemas contain no pointers or strings are compared with
+ * `memcmp`, rather than field by field.  Strings are compared up to their
+ * terminating NUL, since the rest of a string buffer may hold anything.
+ * The walk stops at the first difference.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <assert.h>
+#include <string.h>
+
+#include "data.h"
+#include "util.h"
+#include "mem.h"
+#include "arena.h"
+#include "free.h"
+#include "schema.h"
+
+/** Number of work stack frames that are allocated on the C stack. */
+#define CYAML_COPY_STACK_INLINE 32
+
+/** Alignment of allocations within a compacted copy. */
+#define CYAML_COPY_ALIGN (_Alignof(max_align_t))
+
+/**
+ * A copy work stack frame, for a mapping or sequence whose contents own
+ * allocations.
+ */
+typedef struct cyaml_copy_frame {
+	const cyaml_schema_value_t *schema; /**< Schema for the value. */
+	const uint8_t *src; /**< The source value's data. */
+	uint8_t *dst;       /**< The copied value's data, or NULL. */
+	uint32_t idx;       /**< Next mapping field or sequence entry. */
+	uint32_t count;     /**< Sequence entry count. */
+} cyaml_copy_frame_t;
+
+/** State shared by every work stack used for a copy. */
+typedef struct cyaml_copy {
+	const cyaml_config_t *cfg;  /**< The client's CYAML library config. */
+	/** Compiled schema for the value being copied, or NULL. */
+	const cyaml_schema_compiled_t *compiled;
+	/** Whether the data is only being measured, for compacting. */
+	bool measure;
+	uint8_t *slab;   /**< Compacted copy's allocation, or NULL. */
+	size_t used;     /**< Bytes measured, or used in slab. */
+	cyaml_err_t err; /**< The first error, after which copying stops. */
+} cyaml_copy_t;
+
+/** Internal context for copying a CYAML data structure. */
+typedef struct cyaml_copy_ctx {
+	cyaml_copy_t *copy;         /**< The copy's shared state. */
+	cyaml_copy_frame_t *stack;  /**< The work stack. */
+	uint32_t stack_idx;         /**< Next (empty) work stack slot. */
+	uint32_t stack_max;         /**< Current work stack size. */
+	/** Initial work stack. */
+	cyaml_copy_frame_t stack_inline[CYAML_COPY_STACK_INLINE];
+} cyaml_copy_ctx_t;
+
+/**
+ * A comparison work stack frame, for a mapping or sequence whose contents
+ * own allocations.
+ */
+typedef struct cyaml_equal_frame {
+	const cyaml_schema_value_t *schema; /**< Schema for the value. */
+	const uint8_t *a;   /**< The first value's data. */
+	const uint8_t *b;   /**< The second value's data. */
+	uint32_t idx;       /**< Next mapping field or sequence entry. */
+	uint32_t count;     /**< Sequence entry count. */
+} cyaml_equal_frame_t;
+
+/** Internal context for comparing CYAML data structures. */
+typedef struct cyaml_equal_ctx {
+	const cyaml_config_t *cfg;  /**< The client's CYAML library config. */
+	/** Compiled schema for the values being compared, or NULL. */
+	const cyaml_schema_compiled_t *compiled;
+	bool equal;                 /**< Whether no difference was found. */
+	cyaml_equal_frame_t *stack; /**< The work stack. */
+	uint32_t stack_idx;         /**< Next (empty) work stack slot. */
+	uint32_t stack_max;         /**< Current work stack size. */
+	/** Initial work stack. */
+	cyaml_equal_frame_t stack_inline[CYAML_COPY_STACK_INLINE];
+} cyaml_equal_ctx_t;
+
+/**
+ * Get the size of a sequence entry's data.
+ *
+ * \param[in]  entry  The schema for the sequence entries.
+ * \return size of each entry in the sequence's data.
+ */
+static inline size_t cyaml__copy_entry_size(
+		const cyaml_schema_value_t *entry)
+{
+	if (entry->flags & CYAML_FLAG_POINTER) {
+		return sizeof(void *);
+	}
+	if (entry->type == CYAML_SEQUENCE_FIXED) {
+		return (size_t)entry->data_size * entry->sequence.max;
+	}
+
+	return entry->data_size;
+}
+
+/**
+ * Get the size of a value's data.
+ *
+ * \param[in]  schema  The schema for the value.
+ * \param[in]  data    The value's data.
+ * \param[in]  count   Entry count, for sequences.
+ * \return size of the value's data in bytes.
+ */
+static inline size_t cyaml__copy_size(
+		const cyaml_schema_value_t *schema,
+		const uint8_t *data,
+		unsigned count)
+{
+	switch (schema->type) {
+	case CYAML_STRING:
+		if (schema->flags & CYAML_FLAG_POINTER) {
+			return strlen((const char *)data) + 1;
+		}
+		break;
+	case CYAML_SEQUENCE_FIXED: /* Fall through. */
+	case CYAML_SEQUENCE:
+		return cyaml__copy_entry_size(schema->sequence.entry) * count;
+	default:
+		break;
+	}
+
+	return schema->data_size;
+}
+
+/**
+ * Make an allocation for a copy.
+ *
+ * When compacting, space is taken from the slab, or just counted when
+ * measuring.
+ *
+ * \param[in]  copy  The copy's shared state.
+ * \param[in]  size  Size of the allocation in bytes, which is non-zero.
+ * \return the allocation, or NULL when measuring or on failure.
+ */
+static uint8_t * cyaml__copy_alloc(
+		cyaml_copy_t *copy,
+		size_t size)
+{
+	uint8_t *alloc;
+
+	if (copy->slab == NULL && !copy->measure) {
+		return cyaml__alloc(copy->cfg, size, false);
+	}
+
+	alloc = (copy->measure) ? NULL : copy->slab + copy->used;
+	copy->used += (size + CYAML_COPY_ALIGN - 1) & ~(CYAML_COPY_ALIGN - 1);
+	return alloc;
+}
+
+/**
+ * Copy a value with a new work stack.
+ *
+ * \param[in]  copy   The copy's shared state.
+ * \param[in]  frame  A work stack frame for the value.
+ */
+static void cyaml__copy_run(
+		cyaml_copy_t *copy,
+		const cyaml_copy_frame_t *frame);
+
+/**
+ * Start copying a value.
+ *
+ * Values that own no allocations have already been copied with their
+ * parent.  Values that are pointers are given a copy of their own
+ * allocation.  Then, if the value's contents have pointers, a work stack
+ * frame is pushed for it.
+ *
+ * \param[in]  ctx     The copy context.
+ * \param[in]  schema  The schema for the value.
+ * \param[in]  src     The source value's data, or for
+ *                     \ref CYAML_FLAG_POINTER values, the address of the
+ *                     pointer to the data.
+ * \param[in]  dst     Where the copied value's data, or pointer, goes.
+ *                     NULL when measuring.
+ * \param[in]  count   If value is of type \ref CYAML_SEQUENCE, this is the
+ *                     number of entries in the sequence.
+ */
+static void cyaml__copy_push(
+		cyaml_copy_ctx_t *ctx,
+		const cyaml_schema_value_t *schema,
+		const uint8_t *src,
+		uint8_t *dst,
+		unsigned count)
+{
+	cyaml_copy_t *copy = ctx->copy;
+
+	if (schema->type == CYAML_SEQUENCE_FIXED) {
+		count = schema->sequence.max;
+	}
+
+	if (schema->flags & CYAML_FLAG_POINTER) {
+		const uint8_t *ptr = cyaml_data_read_pointer(src);
+		uint8_t *alloc = NULL;
+		size_t size;
+
+		if (ptr == NULL) {
+			return;
+		}
+
+		size = (copy->err == CYAML_OK) ?
+				cyaml__copy_size(schema, ptr, count) : 0;
+		if (size != 0) {
+			alloc = cyaml__copy_alloc(copy, size);
+			if (alloc == NULL && !copy->measure) {
+				copy->err = CYAML_ERR_OOM;
+			}
+		}
+
+		if (copy->measure) {
+			if (size == 0) {
+				return;
+			}
+		} else {
+			cyaml_data_write_pointer(alloc, dst);
+			if (alloc == NULL) {
+				return;
+			}
+			memcpy(alloc, ptr, size);
+		}
+
+		src = ptr;
+		dst = alloc;
+	}
+
+	if (!cyaml_schema_contents_have_pointers(copy->compiled, schema) ||
+	    (schema->type != CYAML_MAPPING && count == 0)) {
+		return;
+	}
+
+	if (ctx->stack_idx == ctx->stack_max) {
+		cyaml_copy_frame_t *temp = NULL;
+		uint32_t max = ctx->stack_max * 2;
+
+		if (ctx->stack == ctx->stack_inline) {
+			temp = cyaml__alloc(copy->cfg,
+					sizeof(*temp) * max, false);
+			if (temp != NULL) {
+				memcpy(temp, ctx->stack_inline,
+						sizeof(ctx->stack_inline));
+			}
+		} else {
+			temp = cyaml__realloc(copy->cfg, ctx->stack, 0,
+					sizeof(*temp) * max, false);
+		}
+		if (temp == NULL) {
+			/* Copy the subtree with a fresh work stack. */
+			cyaml__copy_run(copy, &(cyaml_copy_frame_t) {
+				.schema = schema,
+				.src = src,
+				.dst = dst,
+				.count = count,
+			});
+			return;
+		}
+		ctx->stack = temp;
+		ctx->stack_max = max;
+	}
+
+	ctx->stack[ctx->stack_idx++] = (cyaml_copy_frame_t) {
+		.schema = schema,
+		.src = src,
+		.dst = dst,
+		.count = count,
+	};
+}
+
+/**
+ * Visit the next child of the value on top of the copy work stack.
+ *
+ * If the value has no children left, it is popped.
+ *
+ * \param[in]  ctx  The copy context.
+ */
+static void cyaml__copy_step(
+		cyaml_copy_ctx_t *ctx)
+{
+	cyaml_copy_frame_t *frame = &ctx->stack[ctx->stack_idx - 1];
+	const cyaml_schema_value_t *schema = frame->schema;
+
+	if (schema->type == CYAML_MAPPING) {
+		const cyaml_schema_field_t *field =
+				&schema->mapping.fields[frame->idx];
+
+		if (field->key != NULL) {
+			const uint8_t *src = frame->src;
+			uint8_t *dst = frame->dst;
+			unsigned count = 0;
+
+			frame->idx++;
+			if (field->value.type == CYAML_SEQUENCE) {
+				cyaml_err_t err;
+				count = cyaml_data_read(field->count_size,
+						src + field->count_offset,
+						&err);
+				if (err != CYAML_OK) {
+					ctx->copy->err = err;
+					count = 0;
+				}
+			}
+			if (dst != NULL) {
+				dst += field->data_offset;
+			}
+			/* May move the work stack; frame is invalid after. */
+			cyaml__copy_push(ctx, &field->value,
+					src + field->data_offset,
+					dst, count);
+			return;
+		}
+	} else if (frame->idx < frame->count) {
+		const cyaml_schema_value_t *entry = schema->sequence.entry;
+		size_t offset = cyaml__copy_entry_size(entry) * frame->idx;
+		uint8_t *dst = frame->dst;
+
+		frame->idx++;
+		if (dst != NULL) {
+			dst += offset;
+		}
+		cyaml__copy_push(ctx, entry, frame->src + offset, dst, 0);
+		return;
+	}
+
+	ctx->stack_idx--;
+}
+
+/**
+ * Initialise a copy context.
+ *
+ * \param[in]  ctx   The copy context to initialise.
+ * \param[in]  copy  The copy's shared state.
+ */
+static inline void cyaml__copy_ctx_init(
+		cyaml_copy_ctx_t *ctx,
+		cyaml_copy_t *copy)
+{
+	ctx->copy = copy;
+	ctx->stack = ctx->stack_inline;
+	ctx->stack_idx = 0;
+	ctx->stack_max = CYAML_COPY_STACK_INLINE;
+}
+
+/**
+ * Walk a copy context's work stack until it is empty.
+ *
+ * \param[in]  ctx  The copy context.
+ */
+static void cyaml__copy_walk(
+		cyaml_copy_ctx_t *ctx)
+{
+	while (ctx->stack_idx > 0) {
+		cyaml__copy_step(ctx);
+	}
+
+	if (ctx->stack != ctx->stack_inline) {
+		cyaml__free(ctx->copy->cfg, ctx->stack);
+	}
+}
+
+/* This function is documented at the forward declaration above. */
+static void cyaml__copy_run(
+		cyaml_copy_t *copy,
+		const cyaml_copy_frame_t *frame)
+{
+	cyaml_copy_ctx_t ctx;
+
+	cyaml__copy_ctx_init(&ctx, copy);
+	ctx.stack[ctx.stack_idx++] = *frame;
+	cyaml__copy_walk(&ctx);
+}
+
+/**
+ * Copy a value.
+ *
+ * \param[in]  copy    The copy's shared state.
+ * \param[in]  schema  The schema for the value.
+ * \param[in]  src     The address of the pointer to the source value.
+ * \param[in]  dst     The address of the pointer to set to the copy.
+ * \param[in]  count   If value is of type \ref CYAML_SEQUENCE, this is the
+ *                     number of entries in the sequence.
+ */
+static void cyaml__copy_value(
+		cyaml_copy_t *copy,
+		const cyaml_schema_value_t *schema,
+		const uint8_t *src,
+		uint8_t *dst,
+		unsigned count)
+{
+	cyaml_copy_ctx_t ctx;
+
+	cyaml__copy_ctx_init(&ctx, copy);
+	cyaml__copy_push(&ctx, schema, src, dst, count);
+	cyaml__copy_walk(&ctx);
+}
+
+/**
+ * Check that common copy and comparison params from client are valid.
+ *
+ * \param[in] config     The client's CYAML library config.
+ * \param[in] schema     The schema describing the content of data.
+ * \param[in] data       Points to client's data.
+ * \param[in] seq_count  Top level sequence count.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__copy_validate_params(
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		const cyaml_data_t *data,
+		unsigned seq_count)
+{
+	if (config == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_CONFIG;
+	}
+	if (config->mem_fn == NULL) {
+		return CYAML_ERR_BAD_CONFIG_NULL_MEMFN;
+	}
+	if (schema == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_SCHEMA;
+	}
+	if (schema->type != CYAML_SEQUENCE && seq_count != 0) {
+		return CYAML_ERR_BAD_PARAM_SEQ_COUNT;
+	}
+	if (!(schema->flags & CYAML_FLAG_POINTER)) {
+		return CYAML_ERR_TOP_LEVEL_NON_PTR;
+	}
+	if (data == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_DATA;
+	}
+	return CYAML_OK;
+}
+
+/**
+ * Make a compacted copy of a value.
+ *
+ * \param[in]  copy      The copy's shared state.
+ * \param[in]  schema    The schema for the value.
+ * \param[in]  data      The source value.
+ * \param[in]  count     Top level sequence count.
+ * \param[out] copy_out  Returns the copy on success.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__compact(
+		cyaml_copy_t *copy,
+		const cyaml_schema_value_t *schema,
+		const cyaml_data_t *data,
+		unsigned count,
+		cyaml_data_t **copy_out)
+{
+	cyaml_arena_t *arena = NULL;
+	uint8_t *result = NULL;
+	size_t size;
+
+	copy->measure = true;
+	cyaml__copy_value(copy, schema, (const uint8_t *)&data, NULL, count);
+	copy->measure = false;
+	if (copy->err != CYAML_OK) {
+		return copy->err;
+	}
+
+	size = copy->used;
+	if (size != 0) {
+		copy->slab = cyaml_arena_realloc(copy->cfg, &arena,
+				NULL, 0, size, true);
+		if (copy->slab == NULL) {
+			cyaml_arena_destroy(copy->cfg, arena);
+			return CYAML_ERR_OOM;
+		}
+	}
+
+	copy->used = 0;
+	cyaml__copy_value(copy, schema, (const uint8_t *)&data,
+			(uint8_t *)&result, count);
+	assert(copy->used == size);
+	if (copy->err != CYAML_OK) {
+		cyaml_arena_destroy(copy->cfg, arena);
+		return copy->err;
+	}
+
+	cyaml__log(copy->cfg, CYAML_LOG_DEBUG,
+			"Compacted copy: %p (%zu bytes)\n", result, size);
+
+	*copy_out = result;
+	return CYAML_OK;
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_compact(
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		const cyaml_data_t *data,
+		unsigned seq_count,
+		cyaml_data_t **copy_out)
+{
+	cyaml_copy_t copy = {
+		.cfg = config,
+	};
+	cyaml_err_t err;
+
+	err = cyaml__copy_validate_params(config, schema, data, seq_count);
+	if (err != CYAML_OK) {
+		return err;
+	}
+	if (copy_out == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_DATA;
+	}
+
+	copy.compiled = cyaml_schema_compiled_get(config, schema);
+	return cyaml__compact(&copy, schema, data, seq_count, copy_out);
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_copy(
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		const cyaml_data_t *data,
+		unsigned seq_count,
+		cyaml_data_t **copy_out)
+{
+	cyaml_copy_t copy = {
+		.cfg = config,
+	};
+	uint8_t *result = NULL;
+	cyaml_err_t err;
+
+	err = cyaml__copy_validate_params(config, schema, data, seq_count);
+	if (err != CYAML_OK) {
+		return err;
+	}
+	if (copy_out == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_DATA;
+	}
+
+	copy.compiled = cyaml_schema_compiled_get(config, schema);
+	if (config->flags & CYAML_CFG_ARENA) {
+		/* So that the copy can be freed like loaded data. */
+		return cyaml__compact(&copy, schema, data, seq_count, copy_out);
+	}
+
+	cyaml__copy_value(&copy, schema, (const uint8_t *)&data,
+			(uint8_t *)&result, seq_count);
+	if (copy.err != CYAML_OK) {
+		cyaml_free_value(config, schema, (uint8_t *)&result, seq_count);
+		return copy.err;
+	}
+
+	*copy_out = result;
+	return CYAML_OK;
+}
+
+/**
+ * Compare values with a new work stack.
+ *
+ * \param[in]  ctx    The comparison context to take the config from.
+ * \param[in]  frame  A work stack frame for the values.
+ * \return true if no difference was found, false otherwise.
+ */
+static bool cyaml__equal_run(
+		const cyaml_equal_ctx_t *ctx,
+		const cyaml_equal_frame_t *frame);
+
+/**
+ * Start comparing two values.
+ *
+ * Strings, and values whose contents have no pointers or strings, are
+ * compared immediately.  Otherwise a work stack frame is pushed for them.
+ *
+ * \param[in]  ctx     The comparison context.
+ * \param[in]  schema  The schema for the values.
+ * \param[in]  a       The first value's data, or for
+ *                     \ref CYAML_FLAG_POINTER values, the address of the
+ *                     pointer to the data.
+ * \param[in]  b       The second value's data, or pointer to it.
+ * \param[in]  count   If values are of type \ref CYAML_SEQUENCE, this is
+ *                     the number of entries in each sequence.
+ */
+static void cyaml__equal_push(
+		cyaml_equal_ctx_t *ctx,
+		const cyaml_schema_value_t *schema,
+		const uint8_t *a,
+		const uint8_t *b,
+		unsigned count)
+{
+	if (schema->flags & CYAML_FLAG_POINTER) {
+		const uint8_t *pa = cyaml_data_read_pointer(a);
+		const uint8_t *pb = cyaml_data_read_pointer(b);
+
+		if (pa == pb) {
+			return;
+		}
+		if (pa == NULL || pb == NULL) {
+			ctx->equal = false;
+			return;
+		}
+		a = pa;
+		b = pb;
+	}
+
+	if (schema->type == CYAML_SEQUENCE_FIXED) {
+		count = schema->sequence.max;
+	}
+
+	if (schema->type == CYAML_STRING) {
+		ctx->equal = strcmp((const char *)a, (const char *)b) == 0;
+		return;
+	}
+
+	if (cyaml_schema_contents_are_bytes(ctx->compiled, schema)) {
+		size_t size = cyaml__copy_size(schema, a, count);
+		ctx->equal = memcmp(a, b, size) == 0;
+		return;
+	}
+
+	if (schema->type != CYAML_MAPPING && count == 0) {
+		return;
+	}
+
+	if (ctx->stack_idx == ctx->stack_max) {
+		cyaml_equal_frame_t *temp = NULL;
+		uint32_t max = ctx->stack_max * 2;
+
+		if (ctx->stack == ctx->stack_inline) {
+			temp = cyaml__alloc(ctx->cfg,
+					sizeof(*temp) * max, false);
+			if (temp != NULL) {
+				memcpy(temp, ctx->stack_inline,
+						sizeof(ctx->stack_inline));
+			}
+		} else {
+			temp = cyaml__realloc(ctx->cfg, ctx->stack, 0,
+					sizeof(*temp) * max, false);
+		}
+		if (temp == NULL) {
+			/* Compare the subtrees with a fresh work stack. */
+			ctx->equal = cyaml__equal_run(ctx,
+					&(cyaml_equal_frame_t) {
+						.schema = schema,
+						.a = a,
+						.b = b,
+						.count = count,
+					});
+			return;
+		}
+		ctx->stack = temp;
+		ctx->stack_max = max;
+	}
+
+	ctx->stack[ctx->stack_idx++] = (cyaml_equal_frame_t) {
+		.schema = schema,
+		.a = a,
+		.b = b,
+		.count = count,
+	};
+}
+
+/**
+ * Visit the next children of the values on top of the comparison work
+ * stack.
+ *
+ * If the values have no children left, they are popped.
+ *
+ * \param[in]  ctx  The comparison context.
+ */
+static void cyaml__equal_step(
+		cyaml_equal_ctx_t *ctx)
+{
+	cyaml_equal_frame_t *frame = &ctx->stack[ctx->stack_idx - 1];
+	const cyaml_schema_value_t *schema = frame->schema;
+
+	if (schema->type == CYAML_MAPPING) {
+		const cyaml_schema_field_t *field =
+				&schema->mapping.fields[frame->idx];
+
+		if (field->key != NULL) {
+			unsigned count = 0;
+
+			frame->idx++;
+			if (field->value.type == CYAML_SEQUENCE) {
+				cyaml_err_t err_a;
+				cyaml_err_t err_b;
+				count = cyaml_data_read(field->count_size,
+						frame->a + field->count_offset,
+						&err_a);
+				if (count != cyaml_data_read(field->count_size,
+						frame->b + field->count_offset,
+						&err_b) ||
+				    err_a != CYAML_OK || err_b != CYAML_OK) {
+					ctx->equal = false;
+					return;
+				}
+			}
+			/* May move the work stack; frame is invalid after. */
+			cyaml__equal_push(ctx, &field->value,
+					frame->a + field->data_offset,
+					frame->b + field->data_offset, count);
+			return;
+		}
+	} else if (frame->idx < frame->count) {
+		const cyaml_schema_value_t *entry = schema->sequence.entry;
+		size_t offset = cyaml__copy_entry_size(entry) * frame->idx;
+
+		frame->idx++;
+		cyaml__equal_push(ctx, entry,
+				frame->a + offset, frame->b + offset, 0);
+		return;
+	}
+
+	ctx->stack_idx--;
+}
+
+/**
+ * Walk a comparison context's work stack until it is empty, or a
+ * difference is found.
+ *
+ * \param[in]  ctx  The comparison context.
+ * \return true if no difference was found, false otherwise.
+ */
+static bool cyaml__equal_walk(
+		cyaml_equal_ctx_t *ctx)
+{
+	while (ctx->stack_idx > 0 && ctx->equal) {
+		cyaml__equal_step(ctx);
+	}
+
+	if (ctx->stack != ctx->stack_inline) {
+		cyaml__free(ctx->cfg, ctx->stack);
+	}
+
+	return ctx->equal;
+}
+
+/* This function is documented at the forward declaration above. */
+static bool cyaml__equal_run(
+		const cyaml_equal_ctx_t *ctx,
+		const cyaml_equal_frame_t *frame)
+{
+	cyaml_equal_ctx_t sub = {
+		.cfg = ctx->cfg,
+		.compiled = ctx->compiled,
+		.equal = true,
+		.stack_idx = 1,
+		.stack_max = CYAML_COPY_STACK_INLINE,
+	};
+
+	sub.stack = sub.stack_inline;
+	sub.stack[0] = *frame;
+	return cyaml__equal_walk(&sub);
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_equal(
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		const cyaml_data_t *a,
+		unsigned a_count,
+		const cyaml_data_t *b,
+		unsigned b_count,
+		bool *equal_out)
+{
+	cyaml_equal_ctx_t ctx = {
+		.cfg = config,
+		.equal = true,
+		.stack_max = CYAML_COPY_STACK_INLINE,
+	};
+	cyaml_err_t err;
+
+	err = cyaml__copy_validate_params(config, schema, a, a_count);
+	if (err != CYAML_OK) {
+		return err;
+	}
+	err = cyaml__copy_validate_params(config, schema, b, b_count);
+	if (err != CYAML_OK) {
+		return err;
+	}
+	if (equal_out == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_DATA;
+	}
+
+	if (a_count != b_count) {
+		*equal_out = false;
+		return CYAML_OK;
+	}
+
+	ctx.compiled = cyaml_schema_compiled_get(config, schema);
+	ctx.stack = ctx.stack_inline;
+
+	cyaml__equal_push(&ctx, schema, (const uint8_t *)&a,
+			(const uint8_t *)&b, a_count);
+	*equal_out = cyaml__equal_walk(&ctx);
+	return CYAML_OK;
+}
@@ -12,6 +12,8 @@
 #ifndef CYAML_DATA_H
 #define CYAML_DATA_H
 
+#include <string.h>
+
 #include "cyaml/cyaml.h"
 #include "util.h"
 
@@ -47,6 +49,51 @@ static inline cyaml_err_t cyaml_data_write(
 	return CYAML_OK;
 }
 
+/**
+ * Write a value of up to eight bytes to data_target, for a bulk entry.
+ *
+ * The bytes written are the same as from \ref cyaml_data_write.  On
+ * little-endian hosts, C integer types are stored in that order anyway, so
+ * values of one, two, four or eight bytes are written with a single store,
+ * rather than a byte at a time.
+ *
+ * \param[in]  value        The value to write.
+ * \param[in]  entry_size   The number of bytes of value to write.
+ * \param[in]  data_target  The address to write to.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static inline cyaml_err_t cyaml_data_write_bulk(
+		uint64_t value,
+		uint8_t entry_size,
+		uint8_t *data_target)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	switch (entry_size) {
+	case 1: {
+		uint8_t v = (uint8_t)value;
+		memcpy(data_target, &v, sizeof(v));
+		return CYAML_OK;
+	}
+	case 2: {
+		uint16_t v = (uint16_t)value;
+		memcpy(data_target, &v, sizeof(v));
+		return CYAML_OK;
+	}
+	case 4: {
+		uint32_t v = (uint32_t)value;
+		memcpy(data_target, &v, sizeof(v));
+		return CYAML_OK;
+	}
+	case 8:
+		memcpy(data_target, &value, sizeof(value));
+		return CYAML_OK;
+	default:
+		break;
+	}
+#endif
+	return cyaml_data_write(value, entry_size, data_target);
+}
+
 /**
  * Write a pointer to data.
  *
@@ -108,6 +155,57 @@ static inline uint64_t cyaml_data_read(
 	return ret;
 }
 
+/**
+ * Read a value of up to eight bytes from data, for a bulk entry.
+ *
+ * This is the counterpart of \ref cyaml_data_write_bulk, and gives the same
+ * result as \ref cyaml_data_read.
+ *
+ * \param[in]  entry_size  The number of bytes to read.
+ * \param[in]  data        The address to read from.
+ * \param[out] error_out   Returns the error code.  \ref CYAML_OK on success,
+ *                         or appropriate error otherwise.
+ * \return On success, returns the value read from data.
+ *         On failure, returns 0.
+ */
+static inline uint64_t cyaml_data_read_bulk(
+		uint8_t entry_size,
+		const uint8_t *data,
+		cyaml_err_t *error_out)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	switch (entry_size) {
+	case 1: {
+		uint8_t v;
+		memcpy(&v, data, sizeof(v));
+		*error_out = CYAML_OK;
+		return v;
+	}
+	case 2: {
+		uint16_t v;
+		memcpy(&v, data, sizeof(v));
+		*error_out = CYAML_OK;
+		return v;
+	}
+	case 4: {
+		uint32_t v;
+		memcpy(&v, data, sizeof(v));
+		*error_out = CYAML_OK;
+		return v;
+	}
+	case 8: {
+		uint64_t v;
+		memcpy(&v, data, sizeof(v));
+		*error_out = CYAML_OK;
+		return v;
+	}
+	default:
+		break;
+	}
+#endif
+	return cyaml_data_read(entry_size, data, error_out);
+}
+
 /**
  * Read a pointer from data.
  *
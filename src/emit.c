@@ -0,0 +1,1467 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (C) 2019 Michael Drake <tlsa@netsurf-browser.org>
+ */
+
+/**
+ * \file
+ * \brief Native YAML emitter, for saving without libyaml's emitter.
+ *
+ * The state machine is a port of `libyaml`'s emitter, restricted to what
+ * CYAML's saving code needs: no anchors, tags, directives, or block
+ * scalars.  It uses `libyaml`'s default settings, so that the output is
+ * the same: two space indents, lines broken after 80 columns where
+ * possible, and non-ASCII characters escaped in double quoted scalars.
+ *
+ * The saving code calls the emitter directly, rather than building
+ * events, so scalars are never copied.  Most scalars are made only of
+ * characters which can never need quoting, and those are written as plain
+ * scalars straight into the output buffer.  Only the rest get `libyaml`'s
+ * full analysis, to choose how to quote them.
+ *
+ * `libyaml` queues events to look ahead for empty collections, which it
+ * always writes in flow style.  Here, only the start of a collection is
+ * held back, until the next event shows whether it is empty.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <assert.h>
+#include <string.h>
+
+#include "mem.h"
+#include "emit.h"
+
+/** Number of columns to indent nested block collections by. */
+#define CYAML_EMIT_BEST_INDENT 2
+
+/** Column after which lines are broken, where possible. */
+#define CYAML_EMIT_BEST_WIDTH 80
+
+/** Longest scalar that can be written as a simple mapping key. */
+#define CYAML_EMIT_SIMPLE_KEY_MAX 128
+
+/** Native emitter event types. */
+enum cyaml_emit_event_type {
+	CYAML_EMIT_EVENT_NONE,
+	CYAML_EMIT_EVENT_STREAM_END,
+	CYAML_EMIT_EVENT_DOCUMENT_START,
+	CYAML_EMIT_EVENT_DOCUMENT_END,
+	CYAML_EMIT_EVENT_SEQUENCE_START,
+	CYAML_EMIT_EVENT_SEQUENCE_END, /**< Must follow the start. */
+	CYAML_EMIT_EVENT_MAPPING_START,
+	CYAML_EMIT_EVENT_MAPPING_END,  /**< Must follow the start. */
+	CYAML_EMIT_EVENT_SCALAR,
+};
+
+/** Styles a scalar may be written in. */
+enum cyaml_emit_scalar_style {
+	CYAML_EMIT_SCALAR_PLAIN,
+	CYAML_EMIT_SCALAR_SINGLE,
+	CYAML_EMIT_SCALAR_DOUBLE,
+};
+
+/** Result of analysing a scalar's value. */
+typedef struct cyaml_emit_scalar_info {
+	bool multiline;     /**< Whether the value contains line breaks. */
+	bool flow_plain;    /**< Whether plain style is allowed in flow. */
+	bool block_plain;   /**< Whether plain style is allowed in block. */
+	bool single_quoted; /**< Whether single quoted style is allowed. */
+} cyaml_emit_scalar_info_t;
+
+/** A native emitter event. */
+typedef struct cyaml_emit_event {
+	enum cyaml_emit_event_type type; /**< The event type. */
+	/** For documents whether implicit, for collections whether flow. */
+	bool flag;
+	/** For collection starts, whether the end follows immediately. */
+	bool empty;
+	const uint8_t *value;  /**< For scalars, the value. */
+	size_t len;            /**< For scalars, the value's length. */
+	cyaml_emit_scalar_info_t info; /**< For scalars, the analysis. */
+} cyaml_emit_event_t;
+
+/**
+ * Pass buffered output to the output handler.
+ *
+ * If the handler fails, the output is dropped, and the emitter's error
+ * is set.
+ *
+ * \param[in]  emit  The emitter.
+ */
+static void cyaml__emit_flush(
+		cyaml_emit_t *emit)
+{
+	if (emit->used != 0 && emit->err == CYAML_OK) {
+		if (!emit->handler(emit->handler_ctx,
+				emit->buffer, emit->used)) {
+			emit->err = CYAML_ERR_LIBYAML_EMITTER;
+		}
+	}
+	emit->used = 0;
+}
+
+/**
+ * Write a character.
+ *
+ * \param[in]  emit  The emitter.
+ * \param[in]  c     The ASCII character to write.
+ */
+static inline void cyaml__emit_put(
+		cyaml_emit_t *emit,
+		uint8_t c)
+{
+	if (emit->used == sizeof(emit->buffer)) {
+		cyaml__emit_flush(emit);
+	}
+	emit->buffer[emit->used++] = c;
+	emit->column++;
+}
+
+/**
+ * Write a string of characters.
+ *
+ * \param[in]  emit  The emitter.
+ * \param[in]  data  The ASCII characters to write.
+ * \param[in]  len   Number of characters to write.
+ */
+static void cyaml__emit_write(
+		cyaml_emit_t *emit,
+		const uint8_t *data,
+		size_t len)
+{
+	emit->column += (unsigned)len;
+
+	while (len > 0) {
+		size_t space = sizeof(emit->buffer) - emit->used;
+
+		if (space == 0) {
+			cyaml__emit_flush(emit);
+			continue;
+		}
+		if (space > len) {
+			space = len;
+		}
+		memcpy(emit->buffer + emit->used, data, space);
+		emit->used += space;
+		data += space;
+		len -= space;
+	}
+}
+
+/**
+ * Write a line break.
+ *
+ * \param[in]  emit  The emitter.
+ */
+static inline void cyaml__emit_break(
+		cyaml_emit_t *emit)
+{
+	cyaml__emit_put(emit, '\n');
+	emit->column = 0;
+}
+
+/**
+ * Write an indicator.
+ *
+ * \param[in]  emit            The emitter.
+ * \param[in]  indicator       The indicator to write.
+ * \param[in]  need_space      Whether a space must separate the indicator
+ *                             from any preceding non-whitespace.
+ * \param[in]  is_whitespace   Whether the indicator counts as whitespace.
+ * \param[in]  is_indention    Whether the indicator counts as indention.
+ */
+static void cyaml__emit_indicator(
+		cyaml_emit_t *emit,
+		const char *indicator,
+		bool need_space,
+		bool is_whitespace,
+		bool is_indention)
+{
+	if (need_space && !emit->whitespace) {
+		cyaml__emit_put(emit, ' ');
+	}
+
+	cyaml__emit_write(emit, (const uint8_t *)indicator, strlen(indicator));
+
+	emit->whitespace = is_whitespace;
+	emit->indention = emit->indention && is_indention;
+}
+
+/**
+ * Move to the current indent, starting a new line if needed.
+ *
+ * \param[in]  emit  The emitter.
+ */
+static void cyaml__emit_indent(
+		cyaml_emit_t *emit)
+{
+	static const uint8_t spaces[32] = "                                ";
+	unsigned indent = (emit->indent >= 0) ? (unsigned)emit->indent : 0;
+
+	if (!emit->indention || emit->column > indent ||
+	    (emit->column == indent && !emit->whitespace)) {
+		cyaml__emit_break(emit);
+	}
+
+	while (emit->column < indent) {
+		unsigned len = indent - emit->column;
+		if (len > sizeof(spaces)) {
+			len = sizeof(spaces);
+		}
+		cyaml__emit_write(emit, spaces, len);
+	}
+
+	emit->whitespace = true;
+	emit->indention = true;
+}
+
+/**
+ * Push an entry onto one of an emitter's stacks.
+ *
+ * \param[in]  emit   The emitter.
+ * \param[in]  stack  The stack to push onto.
+ * \param[in]  item   The entry to push.
+ */
+static void cyaml__emit_push(
+		cyaml_emit_t *emit,
+		cyaml_emit_stack_t *stack,
+		int item)
+{
+	if (stack->count == stack->max) {
+		uint32_t max = stack->max * 2;
+		int *temp;
+
+		if (stack->items == stack->items_inline) {
+			temp = cyaml__alloc(emit->config,
+					sizeof(*temp) * max, false);
+			if (temp != NULL) {
+				memcpy(temp, stack->items_inline,
+						sizeof(stack->items_inline));
+			}
+		} else {
+			temp = cyaml__realloc(emit->config, stack->items, 0,
+					sizeof(*temp) * max, false);
+		}
+		if (temp == NULL) {
+			emit->err = CYAML_ERR_OOM;
+			return;
+		}
+		stack->items = temp;
+		stack->max = max;
+	}
+
+	stack->items[stack->count++] = item;
+}
+
+/**
+ * Pop an entry from one of an emitter's stacks.
+ *
+ * \param[in]  emit      The emitter.
+ * \param[in]  stack     The stack to pop from.
+ * \param[in]  fallback  Value to return if the stack is empty.
+ * \return the popped entry.
+ */
+static int cyaml__emit_pop(
+		cyaml_emit_t *emit,
+		cyaml_emit_stack_t *stack,
+		int fallback)
+{
+	if (stack->count == 0) {
+		if (emit->err == CYAML_OK) {
+			emit->err = CYAML_ERR_INTERNAL_ERROR;
+		}
+		return fallback;
+	}
+
+	return stack->items[--stack->count];
+}
+
+/**
+ * Return to the state on top of the state stack.
+ *
+ * \param[in]  emit  The emitter.
+ */
+static inline void cyaml__emit_pop_state(
+		cyaml_emit_t *emit)
+{
+	emit->state = (enum cyaml_emit_state)cyaml__emit_pop(emit,
+			&emit->states, CYAML_EMIT_END);
+}
+
+/**
+ * Increase the indent for a nested node.
+ *
+ * \param[in]  emit        The emitter.
+ * \param[in]  flow        Whether the node is in flow context.
+ * \param[in]  indentless  Whether the node keeps the current indent.
+ */
+static void cyaml__emit_increase_indent(
+		cyaml_emit_t *emit,
+		bool flow,
+		bool indentless)
+{
+	cyaml__emit_push(emit, &emit->indents, emit->indent);
+
+	if (emit->indent < 0) {
+		emit->indent = flow ? CYAML_EMIT_BEST_INDENT : 0;
+	} else if (!indentless) {
+		emit->indent += CYAML_EMIT_BEST_INDENT;
+	}
+}
+
+/**
+ * Check whether a character may appear anywhere in a plain scalar, other
+ * than at the start, regardless of what is around it.
+ *
+ * This is printable ASCII, except space, the flow indicators, ':' and '#'.
+ *
+ * \param[in]  c  The byte to check.
+ * \return true if the character is safe, false otherwise.
+ */
+static inline bool cyaml__emit_plain_safe(
+		uint8_t c)
+{
+	static const uint32_t bits[4] = {
+		0x00000000, 0x7bffeff6, 0xd7ffffff, 0x57ffffff,
+	};
+
+	return (c < 0x80) && ((bits[c >> 5] >> (c & 31)) & 1);
+}
+
+/**
+ * Check whether a scalar can be written as plain in all contexts, and
+ * needs no line breaks, without full analysis.
+ *
+ * This accepts values like identifiers and numbers, which start with an
+ * alphanumeric character, '_', '/', or '-' and a digit, and contain no
+ * spaces or indicators.
+ *
+ * \param[in]  value  The scalar's value.
+ * \param[in]  len    Length of value in bytes.
+ * \return true if the scalar is simple, false if it needs full analysis.
+ */
+static bool cyaml__emit_is_simple(
+		const uint8_t *value,
+		size_t len)
+{
+	uint8_t c;
+
+	if (len == 0) {
+		return false;
+	}
+
+	c = value[0];
+	if (!((c >= '0' && c <= '9') ||
+	      ((c | 0x20) >= 'a' && (c | 0x20) <= 'z') ||
+	      c == '_' || c == '/' ||
+	      (c == '-' && len > 1 && value[1] >= '0' && value[1] <= '9'))) {
+		return false;
+	}
+
+	for (size_t i = 1; i < len; i++) {
+		if (!cyaml__emit_plain_safe(value[i])) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Decode a UTF-8 character.
+ *
+ * \param[in]  s     The input, which must not be empty.
+ * \param[in]  len   Length of input in bytes.
+ * \param[out] c     Returns the decoded codepoint.
+ * \return the number of bytes in the character, or 0 if it is invalid.
+ */
+static unsigned cyaml__emit_utf8(
+		const uint8_t *s,
+		size_t len,
+		uint32_t *c)
+{
+	unsigned width;
+	uint32_t value;
+
+	if (s[0] < 0x80) {
+		*c = s[0];
+		return 1;
+	} else if ((s[0] & 0xe0) == 0xc0) {
+		width = 2;
+		value = s[0] & 0x1f;
+	} else if ((s[0] & 0xf0) == 0xe0) {
+		width = 3;
+		value = s[0] & 0x0f;
+	} else if ((s[0] & 0xf8) == 0xf0) {
+		width = 4;
+		value = s[0] & 0x07;
+	} else {
+		return 0;
+	}
+
+	if (width > len) {
+		return 0;
+	}
+	for (unsigned i = 1; i < width; i++) {
+		if ((s[i] & 0xc0) != 0x80) {
+			return 0;
+		}
+		value = (value << 6) | (s[i] & 0x3f);
+	}
+
+	/* Reject overlong forms, surrogates, and values beyond Unicode. */
+	if ((width == 2 && value < 0x80) ||
+	    (width == 3 && value < 0x800) ||
+	    (width == 4 && value < 0x10000) ||
+	    (value >= 0xd800 && value <= 0xdfff) ||
+	    value > 0x10ffff) {
+		return 0;
+	}
+
+	*c = value;
+	return width;
+}
+
+/**
+ * Check whether a codepoint is a YAML line break.
+ *
+ * \param[in]  c  The codepoint.
+ * \return true if c is a line break, false otherwise.
+ */
+static inline bool cyaml__emit_is_break(
+		uint32_t c)
+{
+	return c == '\r' || c == '\n' || c == 0x85 ||
+			c == 0x2028 || c == 0x2029;
+}
+
+/**
+ * Check whether a codepoint is whitespace, a line break, or the end.
+ *
+ * \param[in]  c  The codepoint, or 0 for the end of the value.
+ * \return true if c is blank or the end, false otherwise.
+ */
+static inline bool cyaml__emit_is_blankz(
+		uint32_t c)
+{
+	return c == ' ' || c == '\t' || c == 0 || cyaml__emit_is_break(c);
+}
+
+/**
+ * Check whether a codepoint is one of a set of ASCII characters.
+ *
+ * \param[in]  c    The codepoint.
+ * \param[in]  set  The characters to check for.
+ * \return true if c is in set, false otherwise.
+ */
+static inline bool cyaml__emit_is_one_of(
+		uint32_t c,
+		const char *set)
+{
+	return c != 0 && c < 0x80 && strchr(set, (int)c) != NULL;
+}
+
+/**
+ * Analyse a scalar's value, to find which styles may be used for it.
+ *
+ * This follows `libyaml`'s analysis, with Unicode output disabled.
+ *
+ * \param[in]  value  The scalar's value.
+ * \param[in]  len    Length of value in bytes.
+ * \param[out] info   Returns the analysis.
+ * \return \ref CYAML_OK on success, or \ref CYAML_ERR_INVALID_VALUE if
+ *         the value is not valid UTF-8.
+ */
+static cyaml_err_t cyaml__emit_analyse(
+		const uint8_t *value,
+		size_t len,
+		cyaml_emit_scalar_info_t *info)
+{
+	bool block_indicators = false;
+	bool flow_indicators = false;
+	bool line_breaks = false;
+	bool special_characters = false;
+	bool leading_space = false;
+	bool leading_break = false;
+	bool trailing_space = false;
+	bool trailing_break = false;
+	bool break_space = false;
+	bool space_break = false;
+	bool preceded_by_whitespace = true;
+	bool previous_space = false;
+	bool previous_break = false;
+	unsigned width;
+	size_t pos = 0;
+	uint32_t c;
+
+	if (len == 0) {
+		*info = (cyaml_emit_scalar_info_t) {
+			.block_plain = true,
+			.single_quoted = true,
+		};
+		return CYAML_OK;
+	}
+
+	if (len >= 3 && (memcmp(value, "---", 3) == 0 ||
+	                 memcmp(value, "...", 3) == 0)) {
+		block_indicators = true;
+		flow_indicators = true;
+	}
+
+	width = cyaml__emit_utf8(value, len, &c);
+	if (width == 0) {
+		return CYAML_ERR_INVALID_VALUE;
+	}
+
+	while (pos < len) {
+		size_t next_pos = pos + width;
+		bool followed_by_whitespace;
+		unsigned next_width = 0;
+		uint32_t next = 0;
+
+		if (next_pos < len) {
+			next_width = cyaml__emit_utf8(value + next_pos,
+					len - next_pos, &next);
+			if (next_width == 0) {
+				return CYAML_ERR_INVALID_VALUE;
+			}
+		}
+		followed_by_whitespace = cyaml__emit_is_blankz(next);
+
+		if (pos == 0) {
+			if (cyaml__emit_is_one_of(c, "#,[]{}&*!|>'\"%@`")) {
+				flow_indicators = true;
+				block_indicators = true;
+			}
+			if (c == '?' || c == ':') {
+				flow_indicators = true;
+				if (followed_by_whitespace) {
+					block_indicators = true;
+				}
+			}
+			if (c == '-' && followed_by_whitespace) {
+				flow_indicators = true;
+				block_indicators = true;
+			}
+		} else {
+			if (cyaml__emit_is_one_of(c, ",?[]{}")) {
+				flow_indicators = true;
+			}
+			if (c == ':') {
+				flow_indicators = true;
+				if (followed_by_whitespace) {
+					block_indicators = true;
+				}
+			}
+			if (c == '#' && preceded_by_whitespace) {
+				flow_indicators = true;
+				block_indicators = true;
+			}
+		}
+
+		if (!(c == '\n' || (c >= 0x20 && c <= 0x7e))) {
+			special_characters = true;
+		}
+		if (cyaml__emit_is_break(c)) {
+			line_breaks = true;
+		}
+
+		if (c == ' ') {
+			if (pos == 0) {
+				leading_space = true;
+			}
+			if (next_pos == len) {
+				trailing_space = true;
+			}
+			if (previous_break) {
+				break_space = true;
+			}
+			previous_space = true;
+			previous_break = false;
+		} else if (cyaml__emit_is_break(c)) {
+			if (pos == 0) {
+				leading_break = true;
+			}
+			if (next_pos == len) {
+				trailing_break = true;
+			}
+			if (previous_space) {
+				space_break = true;
+			}
+			previous_space = false;
+			previous_break = true;
+		} else {
+			previous_space = false;
+			previous_break = false;
+		}
+
+		preceded_by_whitespace = cyaml__emit_is_blankz(c);
+		pos = next_pos;
+		width = next_width;
+		c = next;
+	}
+
+	*info = (cyaml_emit_scalar_info_t) {
+		.multiline = line_breaks,
+		.flow_plain = true,
+		.block_plain = true,
+		.single_quoted = true,
+	};
+
+	if (leading_space || leading_break ||
+	    trailing_space || trailing_break) {
+		info->flow_plain = false;
+		info->block_plain = false;
+	}
+	if (break_space || space_break || special_characters) {
+		info->flow_plain = false;
+		info->block_plain = false;
+		info->single_quoted = false;
+	}
+	if (line_breaks) {
+		info->flow_plain = false;
+		info->block_plain = false;
+	}
+	if (flow_indicators) {
+		info->flow_plain = false;
+	}
+	if (block_indicators) {
+		info->block_plain = false;
+	}
+
+	return CYAML_OK;
+}
+
+/**
+ * Write a plain scalar.
+ *
+ * \param[in]  emit          The emitter.
+ * \param[in]  value         The scalar's value.
+ * \param[in]  len           Length of value in bytes.
+ * \param[in]  allow_breaks  Whether long lines may be broken.
+ */
+static void cyaml__emit_plain(
+		cyaml_emit_t *emit,
+		const uint8_t *value,
+		size_t len,
+		bool allow_breaks)
+{
+	bool spaces = false;
+	size_t start = 0;
+
+	if (!emit->whitespace && (len != 0 || emit->flow_level != 0)) {
+		cyaml__emit_put(emit, ' ');
+	}
+
+	/* Values with line breaks are never plain, so only spaces may need
+	 * to become line breaks. */
+	for (size_t i = 0; i < len; i++) {
+		if (value[i] != ' ') {
+			spaces = false;
+			continue;
+		}
+		if (allow_breaks && !spaces &&
+		    emit->column + (i - start) > CYAML_EMIT_BEST_WIDTH &&
+		    i + 1 < len && value[i + 1] != ' ') {
+			cyaml__emit_write(emit, value + start, i - start);
+			cyaml__emit_indent(emit);
+			start = i + 1;
+		}
+		spaces = true;
+	}
+	cyaml__emit_write(emit, value + start, len - start);
+
+	emit->whitespace = false;
+	emit->indention = false;
+}
+
+/**
+ * Write a single quoted scalar.
+ *
+ * Values only get single quoted if they are printable ASCII, so the only
+ * line break they can contain is '\n'.
+ *
+ * \param[in]  emit          The emitter.
+ * \param[in]  value         The scalar's value.
+ * \param[in]  len           Length of value in bytes.
+ * \param[in]  allow_breaks  Whether long lines may be broken.
+ */
+static void cyaml__emit_single_quoted(
+		cyaml_emit_t *emit,
+		const uint8_t *value,
+		size_t len,
+		bool allow_breaks)
+{
+	bool spaces = false;
+	bool breaks = false;
+
+	cyaml__emit_indicator(emit, "'", true, false, false);
+
+	for (size_t i = 0; i < len; i++) {
+		uint8_t c = value[i];
+
+		if (c == ' ') {
+			if (allow_breaks && !spaces &&
+			    emit->column > CYAML_EMIT_BEST_WIDTH &&
+			    i != 0 && i != len - 1 && value[i + 1] != ' ') {
+				cyaml__emit_indent(emit);
+			} else {
+				cyaml__emit_put(emit, c);
+			}
+			spaces = true;
+		} else if (c == '\n') {
+			if (!breaks) {
+				cyaml__emit_break(emit);
+			}
+			cyaml__emit_break(emit);
+			emit->indention = true;
+			breaks = true;
+		} else {
+			if (breaks) {
+				cyaml__emit_indent(emit);
+			}
+			if (c == '\'') {
+				cyaml__emit_put(emit, '\'');
+			}
+			cyaml__emit_put(emit, c);
+			emit->indention = false;
+			spaces = false;
+			breaks = false;
+		}
+	}
+
+	if (breaks) {
+		cyaml__emit_indent(emit);
+	}
+
+	cyaml__emit_indicator(emit, "'", false, false, false);
+
+	emit->whitespace = false;
+	emit->indention = false;
+}
+
+/**
+ * Write an escape sequence for a character in a double quoted scalar.
+ *
+ * \param[in]  emit  The emitter.
+ * \param[in]  c     The codepoint to escape.
+ */
+static void cyaml__emit_escape(
+		cyaml_emit_t *emit,
+		uint32_t c)
+{
+	static const char hex[] = "0123456789ABCDEF";
+	unsigned digits;
+	uint8_t letter;
+
+	cyaml__emit_put(emit, '\\');
+
+	switch (c) {
+	case 0x00:   letter = '0';  break;
+	case 0x07:   letter = 'a';  break;
+	case 0x08:   letter = 'b';  break;
+	case 0x09:   letter = 't';  break;
+	case 0x0a:   letter = 'n';  break;
+	case 0x0b:   letter = 'v';  break;
+	case 0x0c:   letter = 'f';  break;
+	case 0x0d:   letter = 'r';  break;
+	case 0x1b:   letter = 'e';  break;
+	case 0x22:   letter = '"';  break;
+	case 0x5c:   letter = '\\'; break;
+	case 0x85:   letter = 'N';  break;
+	case 0xa0:   letter = '_';  break;
+	case 0x2028: letter = 'L';  break;
+	case 0x2029: letter = 'P';  break;
+	default:
+		if (c <= 0xff) {
+			letter = 'x';
+			digits = 2;
+		} else if (c <= 0xffff) {
+			letter = 'u';
+			digits = 4;
+		} else {
+			letter = 'U';
+			digits = 8;
+		}
+		cyaml__emit_put(emit, letter);
+		while (digits-- > 0) {
+			cyaml__emit_put(emit, hex[(c >> (digits * 4)) & 0xf]);
+		}
+		return;
+	}
+
+	cyaml__emit_put(emit, letter);
+}
+
+/**
+ * Write a double quoted scalar.
+ *
+ * \param[in]  emit          The emitter.
+ * \param[in]  value         The scalar's value, which is valid UTF-8.
+ * \param[in]  len           Length of value in bytes.
+ * \param[in]  allow_breaks  Whether long lines may be broken.
+ */
+static void cyaml__emit_double_quoted(
+		cyaml_emit_t *emit,
+		const uint8_t *value,
+		size_t len,
+		bool allow_breaks)
+{
+	bool spaces = false;
+	size_t i = 0;
+
+	cyaml__emit_indicator(emit, "\"", true, false, false);
+
+	while (i < len) {
+		uint32_t c;
+		unsigned width = cyaml__emit_utf8(value + i, len - i, &c);
+
+		assert(width != 0);
+
+		if (c < 0x20 || c > 0x7e || c == '"' || c == '\\') {
+			cyaml__emit_escape(emit, c);
+			spaces = false;
+		} else if (c == ' ') {
+			if (allow_breaks && !spaces &&
+			    emit->column > CYAML_EMIT_BEST_WIDTH &&
+			    i != 0 && i != len - 1) {
+				cyaml__emit_indent(emit);
+				if (value[i + 1] == ' ') {
+					cyaml__emit_put(emit, '\\');
+				}
+			} else {
+				cyaml__emit_put(emit, ' ');
+			}
+			spaces = true;
+		} else {
+			cyaml__emit_put(emit, (uint8_t)c);
+			spaces = false;
+		}
+		i += width;
+	}
+
+	cyaml__emit_indicator(emit, "\"", false, false, false);
+
+	emit->whitespace = false;
+	emit->indention = false;
+}
+
+/**
+ * Check whether a node can be written as a simple mapping key.
+ *
+ * \param[in]  event  The event starting the node.
+ * \return true if the node can be a simple key, false otherwise.
+ */
+static bool cyaml__emit_check_simple_key(
+		const cyaml_emit_event_t *event)
+{
+	switch (event->type) {
+	case CYAML_EMIT_EVENT_SCALAR:
+		return !event->info.multiline &&
+				event->len <= CYAML_EMIT_SIMPLE_KEY_MAX;
+	case CYAML_EMIT_EVENT_SEQUENCE_START: /* Fall through. */
+	case CYAML_EMIT_EVENT_MAPPING_START:
+		return event->empty;
+	default:
+		return false;
+	}
+}
+
+/**
+ * Write a scalar node.
+ *
+ * \param[in]  emit   The emitter.
+ * \param[in]  event  The scalar event.
+ */
+static void cyaml__emit_scalar_node(
+		cyaml_emit_t *emit,
+		const cyaml_emit_event_t *event)
+{
+	enum cyaml_emit_scalar_style style = CYAML_EMIT_SCALAR_PLAIN;
+	bool allow_breaks = !emit->simple_key_context;
+
+	if (emit->simple_key_context && event->info.multiline) {
+		style = CYAML_EMIT_SCALAR_DOUBLE;
+	} else {
+		if (( emit->flow_level && !event->info.flow_plain) ||
+		    (!emit->flow_level && !event->info.block_plain) ||
+		    (event->len == 0 &&
+		     (emit->flow_level || emit->simple_key_context))) {
+			style = CYAML_EMIT_SCALAR_SINGLE;
+		}
+		if (style == CYAML_EMIT_SCALAR_SINGLE &&
+		    !event->info.single_quoted) {
+			style = CYAML_EMIT_SCALAR_DOUBLE;
+		}
+	}
+
+	if (style != CYAML_EMIT_SCALAR_PLAIN) {
+		/* The non-specific tag, since quoted scalars take their
+		 * tag from it, rather than being resolved implicitly. */
+		if (!emit->whitespace) {
+			cyaml__emit_put(emit, ' ');
+		}
+		cyaml__emit_put(emit, '!');
+		emit->whitespace = false;
+		emit->indention = false;
+	}
+
+	cyaml__emit_increase_indent(emit, true, false);
+
+	switch (style) {
+	case CYAML_EMIT_SCALAR_PLAIN:
+		cyaml__emit_plain(emit, event->value, event->len,
+				allow_breaks);
+		break;
+	case CYAML_EMIT_SCALAR_SINGLE:
+		cyaml__emit_single_quoted(emit, event->value, event->len,
+				allow_breaks);
+		break;
+	case CYAML_EMIT_SCALAR_DOUBLE:
+		cyaml__emit_double_quoted(emit, event->value, event->len,
+				allow_breaks);
+		break;
+	}
+
+	emit->indent = cyaml__emit_pop(emit, &emit->indents, -1);
+	cyaml__emit_pop_state(emit);
+}
+
+/**
+ * Start writing a node.
+ *
+ * \param[in]  emit        The emitter.
+ * \param[in]  event       The event starting the node.
+ * \param[in]  mapping     Whether the node is a mapping key or value.
+ * \param[in]  simple_key  Whether the node is a simple mapping key.
+ */
+static void cyaml__emit_node(
+		cyaml_emit_t *emit,
+		const cyaml_emit_event_t *event,
+		bool mapping,
+		bool simple_key)
+{
+	bool flow;
+
+	emit->mapping_context = mapping;
+	emit->simple_key_context = simple_key;
+
+	flow = emit->flow_level != 0 || event->flag || event->empty;
+
+	switch (event->type) {
+	case CYAML_EMIT_EVENT_SCALAR:
+		cyaml__emit_scalar_node(emit, event);
+		break;
+	case CYAML_EMIT_EVENT_SEQUENCE_START:
+		emit->state = flow ?
+				CYAML_EMIT_FLOW_SEQUENCE_FIRST_ITEM :
+				CYAML_EMIT_BLOCK_SEQUENCE_FIRST_ITEM;
+		break;
+	case CYAML_EMIT_EVENT_MAPPING_START:
+		emit->state = flow ?
+				CYAML_EMIT_FLOW_MAPPING_FIRST_KEY :
+				CYAML_EMIT_BLOCK_MAPPING_FIRST_KEY;
+		break;
+	default:
+		emit->err = CYAML_ERR_INTERNAL_ERROR;
+		break;
+	}
+}
+
+/**
+ * Handle an event at the start of a document.
+ *
+ * \param[in]  emit   The emitter.
+ * \param[in]  event  The event to handle.
+ * \param[in]  first  Whether this is the stream's first document.
+ */
+static void cyaml__emit_document_start_state(
+		cyaml_emit_t *emit,
+		const cyaml_emit_event_t *event,
+		bool first)
+{
+	switch (event->type) {
+	case CYAML_EMIT_EVENT_DOCUMENT_START:
+		if (!event->flag || !first) {
+			cyaml__emit_indent(emit);
+			cyaml__emit_indicator(emit, "---", true, false, false);
+		}
+		emit->state = CYAML_EMIT_DOCUMENT_CONTENT;
+		break;
+	case CYAML_EMIT_EVENT_STREAM_END:
+		cyaml__emit_flush(emit);
+		emit->state = CYAML_EMIT_END;
+		break;
+	default:
+		emit->err = CYAML_ERR_INTERNAL_ERROR;
+		break;
+	}
+}
+
+/**
+ * Handle an event at the end of a document.
+ *
+ * \param[in]  emit   The emitter.
+ * \param[in]  event  The event to handle.
+ */
+static void cyaml__emit_document_end_state(
+		cyaml_emit_t *emit,
+		const cyaml_emit_event_t *event)
+{
+	if (event->type != CYAML_EMIT_EVENT_DOCUMENT_END) {
+		emit->err = CYAML_ERR_INTERNAL_ERROR;
+		return;
+	}
+
+	cyaml__emit_indent(emit);
+	if (!event->flag) {
+		cyaml__emit_indicator(emit, "...", true, false, false);
+		cyaml__emit_indent(emit);
+	}
+	emit->state = CYAML_EMIT_DOCUMENT_START;
+}
+
+/**
+ * Handle an event in a flow sequence.
+ *
+ * \param[in]  emit   The emitter.
+ * \param[in]  event  The event to handle.
+ * \param[in]  first  Whether this is the sequence's first event.
+ */
+static void cyaml__emit_flow_sequence_item(
+		cyaml_emit_t *emit,
+		const cyaml_emit_event_t *event,
+		bool first)
+{
+	if (first) {
+		cyaml__emit_indicator(emit, "[", true, true, false);
+		cyaml__emit_increase_indent(emit, true, false);
+		emit->flow_level++;
+	}
+
+	if (event->type == CYAML_EMIT_EVENT_SEQUENCE_END) {
+		emit->flow_level--;
+		emit->indent = cyaml__emit_pop(emit, &emit->indents, -1);
+		cyaml__emit_indicator(emit, "]", false, false, false);
+		cyaml__emit_pop_state(emit);
+		return;
+	}
+
+	if (!first) {
+		cyaml__emit_indicator(emit, ",", false, false, false);
+	}
+	if (emit->column > CYAML_EMIT_BEST_WIDTH) {
+		cyaml__emit_indent(emit);
+	}
+	cyaml__emit_push(emit, &emit->states, CYAML_EMIT_FLOW_SEQUENCE_ITEM);
+	cyaml__emit_node(emit, event, false, false);
+}
+
+/**
+ * Handle an event in a flow mapping, where a key is expected.
+ *
+ * \param[in]  emit   The emitter.
+ * \param[in]  event  The event to handle.
+ * \param[in]  first  Whether this is the mapping's first event.
+ */
+static void cyaml__emit_flow_mapping_key(
+		cyaml_emit_t *emit,
+		const cyaml_emit_event_t *event,
+		bool first)
+{
+	if (first) {
+		cyaml__emit_indicator(emit, "{", true, true, false);
+		cyaml__emit_increase_indent(emit, true, false);
+		emit->flow_level++;
+	}
+
+	if (event->type == CYAML_EMIT_EVENT_MAPPING_END) {
+		emit->flow_level--;
+		emit->indent = cyaml__emit_pop(emit, &emit->indents, -1);
+		cyaml__emit_indicator(emit, "}", false, false, false);
+		cyaml__emit_pop_state(emit);
+		return;
+	}
+
+	if (!first) {
+		cyaml__emit_indicator(emit, ",", false, false, false);
+	}
+	if (emit->column > CYAML_EMIT_BEST_WIDTH) {
+		cyaml__emit_indent(emit);
+	}
+	if (cyaml__emit_check_simple_key(event)) {
+		cyaml__emit_push(emit, &emit->states,
+				CYAML_EMIT_FLOW_MAPPING_SIMPLE_VALUE);
+		cyaml__emit_node(emit, event, true, true);
+	} else {
+		cyaml__emit_indicator(emit, "?", true, false, false);
+		cyaml__emit_push(emit, &emit->states,
+				CYAML_EMIT_FLOW_MAPPING_VALUE);
+		cyaml__emit_node(emit, event, true, false);
+	}
+}
+
+/**
+ * Handle an event in a flow mapping, where a value is expected.
+ *
+ * \param[in]  emit    The emitter.
+ * \param[in]  event   The event to handle.
+ * \param[in]  simple  Whether the value's key was a simple key.
+ */
+static void cyaml__emit_flow_mapping_value(
+		cyaml_emit_t *emit,
+		const cyaml_emit_event_t *event,
+		bool simple)
+{
+	if (simple) {
+		cyaml__emit_indicator(emit, ":", false, false, false);
+	} else {
+		if (emit->column > CYAML_EMIT_BEST_WIDTH) {
+			cyaml__emit_indent(emit);
+		}
+		cyaml__emit_indicator(emit, ":", true, false, false);
+	}
+	cyaml__emit_push(emit, &emit->states, CYAML_EMIT_FLOW_MAPPING_KEY);
+	cyaml__emit_node(emit, event, true, false);
+}
+
+/**
+ * Handle an event in a block sequence.
+ *
+ * \param[in]  emit   The emitter.
+ * \param[in]  event  The event to handle.
+ * \param[in]  first  Whether this is the sequence's first event.
+ */
+static void cyaml__emit_block_sequence_item(
+		cyaml_emit_t *emit,
+		const cyaml_emit_event_t *event,
+		bool first)
+{
+	if (first) {
+		cyaml__emit_increase_indent(emit, false,
+				emit->mapping_context && !emit->indention);
+	}
+
+	if (event->type == CYAML_EMIT_EVENT_SEQUENCE_END) {
+		emit->indent = cyaml__emit_pop(emit, &emit->indents, -1);
+		cyaml__emit_pop_state(emit);
+		return;
+	}
+
+	cyaml__emit_indent(emit);
+	cyaml__emit_indicator(emit, "-", true, false, true);
+	cyaml__emit_push(emit, &emit->states, CYAML_EMIT_BLOCK_SEQUENCE_ITEM);
+	cyaml__emit_node(emit, event, false, false);
+}
+
+/**
+ * Handle an event in a block mapping, where a key is expected.
+ *
+ * \param[in]  emit   The emitter.
+ * \param[in]  event  The event to handle.
+ * \param[in]  first  Whether this is the mapping's first event.
+ */
+static void cyaml__emit_block_mapping_key(
+		cyaml_emit_t *emit,
+		const cyaml_emit_event_t *event,
+		bool first)
+{
+	if (first) {
+		cyaml__emit_increase_indent(emit, false, false);
+	}
+
+	if (event->type == CYAML_EMIT_EVENT_MAPPING_END) {
+		emit->indent = cyaml__emit_pop(emit, &emit->indents, -1);
+		cyaml__emit_pop_state(emit);
+		return;
+	}
+
+	cyaml__emit_indent(emit);
+	if (cyaml__emit_check_simple_key(event)) {
+		cyaml__emit_push(emit, &emit->states,
+				CYAML_EMIT_BLOCK_MAPPING_SIMPLE_VALUE);
+		cyaml__emit_node(emit, event, true, true);
+	} else {
+		cyaml__emit_indicator(emit, "?", true, false, true);
+		cyaml__emit_push(emit, &emit->states,
+				CYAML_EMIT_BLOCK_MAPPING_VALUE);
+		cyaml__emit_node(emit, event, true, false);
+	}
+}
+
+/**
+ * Handle an event in a block mapping, where a value is expected.
+ *
+ * \param[in]  emit    The emitter.
+ * \param[in]  event   The event to handle.
+ * \param[in]  simple  Whether the value's key was a simple key.
+ */
+static void cyaml__emit_block_mapping_value(
+		cyaml_emit_t *emit,
+		const cyaml_emit_event_t *event,
+		bool simple)
+{
+	if (simple) {
+		cyaml__emit_indicator(emit, ":", false, false, false);
+	} else {
+		cyaml__emit_indent(emit);
+		cyaml__emit_indicator(emit, ":", true, false, true);
+	}
+	cyaml__emit_push(emit, &emit->states, CYAML_EMIT_BLOCK_MAPPING_KEY);
+	cyaml__emit_node(emit, event, true, false);
+}
+
+/**
+ * Handle an event in the emitter's current state.
+ *
+ * \param[in]  emit   The emitter.
+ * \param[in]  event  The event to handle.
+ */
+static void cyaml__emit_state(
+		cyaml_emit_t *emit,
+		const cyaml_emit_event_t *event)
+{
+	switch (emit->state) {
+	case CYAML_EMIT_FIRST_DOCUMENT_START:
+		cyaml__emit_document_start_state(emit, event, true);
+		break;
+	case CYAML_EMIT_DOCUMENT_START:
+		cyaml__emit_document_start_state(emit, event, false);
+		break;
+	case CYAML_EMIT_DOCUMENT_CONTENT:
+		cyaml__emit_push(emit, &emit->states, CYAML_EMIT_DOCUMENT_END);
+		cyaml__emit_node(emit, event, false, false);
+		break;
+	case CYAML_EMIT_DOCUMENT_END:
+		cyaml__emit_document_end_state(emit, event);
+		break;
+	case CYAML_EMIT_FLOW_SEQUENCE_FIRST_ITEM:
+		cyaml__emit_flow_sequence_item(emit, event, true);
+		break;
+	case CYAML_EMIT_FLOW_SEQUENCE_ITEM:
+		cyaml__emit_flow_sequence_item(emit, event, false);
+		break;
+	case CYAML_EMIT_FLOW_MAPPING_FIRST_KEY:
+		cyaml__emit_flow_mapping_key(emit, event, true);
+		break;
+	case CYAML_EMIT_FLOW_MAPPING_KEY:
+		cyaml__emit_flow_mapping_key(emit, event, false);
+		break;
+	case CYAML_EMIT_FLOW_MAPPING_SIMPLE_VALUE:
+		cyaml__emit_flow_mapping_value(emit, event, true);
+		break;
+	case CYAML_EMIT_FLOW_MAPPING_VALUE:
+		cyaml__emit_flow_mapping_value(emit, event, false);
+		break;
+	case CYAML_EMIT_BLOCK_SEQUENCE_FIRST_ITEM:
+		cyaml__emit_block_sequence_item(emit, event, true);
+		break;
+	case CYAML_EMIT_BLOCK_SEQUENCE_ITEM:
+		cyaml__emit_block_sequence_item(emit, event, false);
+		break;
+	case CYAML_EMIT_BLOCK_MAPPING_FIRST_KEY:
+		cyaml__emit_block_mapping_key(emit, event, true);
+		break;
+	case CYAML_EMIT_BLOCK_MAPPING_KEY:
+		cyaml__emit_block_mapping_key(emit, event, false);
+		break;
+	case CYAML_EMIT_BLOCK_MAPPING_SIMPLE_VALUE:
+		cyaml__emit_block_mapping_value(emit, event, true);
+		break;
+	case CYAML_EMIT_BLOCK_MAPPING_VALUE:
+		cyaml__emit_block_mapping_value(emit, event, false);
+		break;
+	default:
+		emit->err = CYAML_ERR_INTERNAL_ERROR;
+		break;
+	}
+}
+
+/**
+ * Pass an event to the emitter.
+ *
+ * Collection start events are held back until the next event, so that
+ * empty collections can be written in flow style.
+ *
+ * \param[in]  emit   The emitter.
+ * \param[in]  event  The event to handle.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__emit_event(
+		cyaml_emit_t *emit,
+		const cyaml_emit_event_t *event)
+{
+	if (emit->err != CYAML_OK) {
+		return emit->err;
+	}
+
+	if (emit->pending != CYAML_EMIT_EVENT_NONE) {
+		cyaml_emit_event_t start = {
+			.type = (enum cyaml_emit_event_type)emit->pending,
+			.flag = emit->pending_flow,
+			.empty = ((int)event->type == emit->pending + 1),
+		};
+
+		emit->pending = CYAML_EMIT_EVENT_NONE;
+		cyaml__emit_state(emit, &start);
+		if (emit->err != CYAML_OK) {
+			return emit->err;
+		}
+	}
+
+	if (event->type == CYAML_EMIT_EVENT_SEQUENCE_START ||
+	    event->type == CYAML_EMIT_EVENT_MAPPING_START) {
+		emit->pending = event->type;
+		emit->pending_flow = event->flag;
+		return CYAML_OK;
+	}
+
+	cyaml__emit_state(emit, event);
+	return emit->err;
+}
+
+/* Exported function, documented in emit.h. */
+void cyaml_emit_init(
+		cyaml_emit_t *emit,
+		const cyaml_config_t *config,
+		yaml_write_handler_t *handler,
+		void *handler_ctx)
+{
+	emit->config = config;
+	emit->handler = handler;
+	emit->handler_ctx = handler_ctx;
+
+	emit->states.items = emit->states.items_inline;
+	emit->states.count = 0;
+	emit->states.max = CYAML_EMIT_STACK_INLINE;
+	emit->indents.items = emit->indents.items_inline;
+	emit->indents.count = 0;
+	emit->indents.max = CYAML_EMIT_STACK_INLINE;
+
+	emit->state = CYAML_EMIT_FIRST_DOCUMENT_START;
+	emit->pending = CYAML_EMIT_EVENT_NONE;
+	emit->pending_flow = false;
+	emit->indent = -1;
+	emit->column = 0;
+	emit->flow_level = 0;
+	emit->whitespace = true;
+	emit->indention = true;
+	emit->mapping_context = false;
+	emit->simple_key_context = false;
+	emit->err = CYAML_OK;
+	emit->used = 0;
+}
+
+/* Exported function, documented in emit.h. */
+void cyaml_emit_fini(
+		cyaml_emit_t *emit)
+{
+	if (emit->states.items != emit->states.items_inline) {
+		cyaml__free(emit->config, emit->states.items);
+	}
+	if (emit->indents.items != emit->indents.items_inline) {
+		cyaml__free(emit->config, emit->indents.items);
+	}
+}
+
+/* Exported function, documented in emit.h. */
+cyaml_err_t cyaml_emit_document_start(
+		cyaml_emit_t *emit,
+		bool implicit)
+{
+	return cyaml__emit_event(emit, &(cyaml_emit_event_t) {
+		.type = CYAML_EMIT_EVENT_DOCUMENT_START,
+		.flag = implicit,
+	});
+}
+
+/* Exported function, documented in emit.h. */
+cyaml_err_t cyaml_emit_document_end(
+		cyaml_emit_t *emit,
+		bool implicit)
+{
+	return cyaml__emit_event(emit, &(cyaml_emit_event_t) {
+		.type = CYAML_EMIT_EVENT_DOCUMENT_END,
+		.flag = implicit,
+	});
+}
+
+/* Exported function, documented in emit.h. */
+cyaml_err_t cyaml_emit_mapping_start(
+		cyaml_emit_t *emit,
+		bool flow)
+{
+	return cyaml__emit_event(emit, &(cyaml_emit_event_t) {
+		.type = CYAML_EMIT_EVENT_MAPPING_START,
+		.flag = flow,
+	});
+}
+
+/* Exported function, documented in emit.h. */
+cyaml_err_t cyaml_emit_mapping_end(
+		cyaml_emit_t *emit)
+{
+	return cyaml__emit_event(emit, &(cyaml_emit_event_t) {
+		.type = CYAML_EMIT_EVENT_MAPPING_END,
+	});
+}
+
+/* Exported function, documented in emit.h. */
+cyaml_err_t cyaml_emit_sequence_start(
+		cyaml_emit_t *emit,
+		bool flow)
+{
+	return cyaml__emit_event(emit, &(cyaml_emit_event_t) {
+		.type = CYAML_EMIT_EVENT_SEQUENCE_START,
+		.flag = flow,
+	});
+}
+
+/* Exported function, documented in emit.h. */
+cyaml_err_t cyaml_emit_sequence_end(
+		cyaml_emit_t *emit)
+{
+	return cyaml__emit_event(emit, &(cyaml_emit_event_t) {
+		.type = CYAML_EMIT_EVENT_SEQUENCE_END,
+	});
+}
+
+/* Exported function, documented in emit.h. */
+cyaml_err_t cyaml_emit_scalar(
+		cyaml_emit_t *emit,
+		const char *value,
+		size_t len)
+{
+	cyaml_emit_event_t event = {
+		.type = CYAML_EMIT_EVENT_SCALAR,
+		.value = (const uint8_t *)value,
+		.len = len,
+	};
+
+	if (cyaml__emit_is_simple(event.value, len)) {
+		event.info = (cyaml_emit_scalar_info_t) {
+			.flow_plain = true,
+			.block_plain = true,
+			.single_quoted = true,
+		};
+	} else {
+		cyaml_err_t err = cyaml__emit_analyse(event.value, len,
+				&event.info);
+		if (err != CYAML_OK) {
+			return err;
+		}
+	}
+
+	return cyaml__emit_event(emit, &event);
+}
+
+/* Exported function, documented in emit.h. */
+cyaml_err_t cyaml_emit_stream_end(
+		cyaml_emit_t *emit)
+{
+	return cyaml__emit_event(emit, &(cyaml_emit_event_t) {
+		.type = CYAML_EMIT_EVENT_STREAM_END,
+	});
+}
@@ -0,0 +1,200 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (C) 2019 Michael Drake <tlsa@netsurf-browser.org>
+ */
+
+/**
+ * \file
+ * \brief CYAML native YAML emitter.
+ */
+
+#ifndef CYAML_EMIT_H
+#define CYAML_EMIT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <yaml.h>
+
+#include "cyaml/cyaml.h"
+
+/** Number of entries a \ref cyaml_emit_stack_t holds without allocating. */
+#define CYAML_EMIT_STACK_INLINE 16
+
+/** Size of a native emitter's output buffer. */
+#define CYAML_EMIT_BUFFER_SIZE 4096
+
+/** Native emitter states, as used by libyaml's emitter. */
+enum cyaml_emit_state {
+	CYAML_EMIT_FIRST_DOCUMENT_START,
+	CYAML_EMIT_DOCUMENT_START,
+	CYAML_EMIT_DOCUMENT_CONTENT,
+	CYAML_EMIT_DOCUMENT_END,
+	CYAML_EMIT_FLOW_SEQUENCE_FIRST_ITEM,
+	CYAML_EMIT_FLOW_SEQUENCE_ITEM,
+	CYAML_EMIT_FLOW_MAPPING_FIRST_KEY,
+	CYAML_EMIT_FLOW_MAPPING_KEY,
+	CYAML_EMIT_FLOW_MAPPING_SIMPLE_VALUE,
+	CYAML_EMIT_FLOW_MAPPING_VALUE,
+	CYAML_EMIT_BLOCK_SEQUENCE_FIRST_ITEM,
+	CYAML_EMIT_BLOCK_SEQUENCE_ITEM,
+	CYAML_EMIT_BLOCK_MAPPING_FIRST_KEY,
+	CYAML_EMIT_BLOCK_MAPPING_KEY,
+	CYAML_EMIT_BLOCK_MAPPING_SIMPLE_VALUE,
+	CYAML_EMIT_BLOCK_MAPPING_VALUE,
+	CYAML_EMIT_END,
+};
+
+/** A native emitter stack of states or indents. */
+typedef struct cyaml_emit_stack {
+	int *items;      /**< The stack's entries. */
+	uint32_t count;  /**< Number of entries in use. */
+	uint32_t max;    /**< Number of entries allocated. */
+	/** Initial entries. */
+	int items_inline[CYAML_EMIT_STACK_INLINE];
+} cyaml_emit_stack_t;
+
+/**
+ * CYAML native emitter.
+ *
+ * This writes YAML text straight from the saving code's calls, without
+ * building `libyaml` events.  Its output is the same as `libyaml`'s
+ * emitter, with default settings, would produce.
+ *
+ * Emitters must not be moved once initialised.
+ */
+typedef struct cyaml_emit {
+	const cyaml_config_t *config;  /**< Client's CYAML configuration. */
+	yaml_write_handler_t *handler; /**< Output handler. */
+	void *handler_ctx;             /**< Output handler's context. */
+	cyaml_emit_stack_t states;     /**< Stack of states to return to. */
+	cyaml_emit_stack_t indents;    /**< Stack of enclosing indents. */
+	enum cyaml_emit_state state;   /**< Current state. */
+	/** Collection start event held back until the next event. */
+	int pending;
+	bool pending_flow;      /**< Whether pending collection is flow. */
+	int indent;             /**< Current indent, or -1 at the root. */
+	unsigned column;        /**< Current output column. */
+	unsigned flow_level;    /**< Depth of flow collections. */
+	bool whitespace;        /**< Whether last character was whitespace. */
+	bool indention;         /**< Whether last character was indention. */
+	bool mapping_context;   /**< Whether current node is in a mapping. */
+	bool simple_key_context; /**< Whether current node is a simple key. */
+	cyaml_err_t err;        /**< First error, after which output stops. */
+	size_t used;            /**< Bytes used in buffer. */
+	/** Output buffer. */
+	uint8_t buffer[CYAML_EMIT_BUFFER_SIZE];
+} cyaml_emit_t;
+
+/**
+ * Initialise a native emitter.
+ *
+ * This does not allocate.
+ *
+ * \param[out] emit         The emitter to initialise.
+ * \param[in]  config       Client's CYAML configuration structure.
+ * \param[in]  handler      Handler to pass output to.
+ * \param[in]  handler_ctx  Context for handler.
+ */
+void cyaml_emit_init(
+		cyaml_emit_t *emit,
+		const cyaml_config_t *config,
+		yaml_write_handler_t *handler,
+		void *handler_ctx);
+
+/**
+ * Free any allocations owned by a native emitter.
+ *
+ * \param[in]  emit  The emitter to finalise.
+ */
+void cyaml_emit_fini(
+		cyaml_emit_t *emit);
+
+/**
+ * Start a document.
+ *
+ * \param[in]  emit      The emitter.
+ * \param[in]  implicit  Whether to omit the "---" document start marker.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+cyaml_err_t cyaml_emit_document_start(
+		cyaml_emit_t *emit,
+		bool implicit);
+
+/**
+ * End a document.
+ *
+ * \param[in]  emit      The emitter.
+ * \param[in]  implicit  Whether to omit the "..." document end marker.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+cyaml_err_t cyaml_emit_document_end(
+		cyaml_emit_t *emit,
+		bool implicit);
+
+/**
+ * Start a mapping.
+ *
+ * \param[in]  emit  The emitter.
+ * \param[in]  flow  Whether to use flow style, rather than block style.
+ *                   Empty mappings are always written in flow style.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+cyaml_err_t cyaml_emit_mapping_start(
+		cyaml_emit_t *emit,
+		bool flow);
+
+/**
+ * End a mapping.
+ *
+ * \param[in]  emit  The emitter.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+cyaml_err_t cyaml_emit_mapping_end(
+		cyaml_emit_t *emit);
+
+/**
+ * Start a sequence.
+ *
+ * \param[in]  emit  The emitter.
+ * \param[in]  flow  Whether to use flow style, rather than block style.
+ *                   Empty sequences are always written in flow style.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+cyaml_err_t cyaml_emit_sequence_start(
+		cyaml_emit_t *emit,
+		bool flow);
+
+/**
+ * End a sequence.
+ *
+ * \param[in]  emit  The emitter.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+cyaml_err_t cyaml_emit_sequence_end(
+		cyaml_emit_t *emit);
+
+/**
+ * Write a scalar, as a plain scalar if possible.
+ *
+ * \param[in]  emit   The emitter.
+ * \param[in]  value  The scalar's UTF-8 value.
+ * \param[in]  len    Length of value in bytes.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+cyaml_err_t cyaml_emit_scalar(
+		cyaml_emit_t *emit,
+		const char *value,
+		size_t len);
+
+/**
+ * End the output stream, and flush the output.
+ *
+ * \param[in]  emit  The emitter.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+cyaml_err_t cyaml_emit_stream_end(
+		cyaml_emit_t *emit);
+
+#endif
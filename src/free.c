@@ -11,15 +11,23 @@
  * As described in the public API for \ref cyaml_free(), it is preferable for
  * clients to write their own free routines, tailored for their data structure.
  *
- * Recursion and stack usage
- * -------------------------
+ * Stack usage
+ * -----------
  *
- * This generic CYAML free routine is implemented using recursion, rather
- * than iteration with a heap-allocated stack.  This is because recursion
- * seems less bad than allocating within the free code, and the stack-cost
- * of these functions isn't huge.  The maximum recursion depth is of course
- * bound by the schema, however schemas for recursively nesting data structures
- * are unbound, e.g. for a data tree structure.
+ * Schemas for recursively nesting data structures, e.g. for a data tree
+ * structure, allow data of unbounded depth.  So rather than recursing, this
+ * generic CYAML free routine walks the data with an explicit work stack.
+ * The first \ref CYAML_FREE_STACK_INLINE levels live on the C stack, so
+ * typical data is freed without allocating.  Deeper data grows the work
+ * stack on the heap.  If that allocation fails, the routine recurses for
+ * the subtree instead, so that nothing is leaked.
+ *
+ * Values whose schemas contain no pointers own no allocations, so they are
+ * never visited.  A sequence of plain-old-data entries is freed with a
+ * single call to the allocator, however many entries it has.  If the
+ * config has a compiled schema for the data, whether values contain
+ * pointers is looked up.  Otherwise, it is found by walking the value's
+ * schema, and the result is cached for the rest of the free.
  */
 
 #include <stdbool.h>
@@ -29,9 +37,90 @@
 #include "data.h"
 #include "util.h"
 #include "mem.h"
+#include "arena.h"
+#include "free.h"
+#include "schema.h"
+
+/** Number of work stack frames that are allocated on the C stack. */
+#define CYAML_FREE_STACK_INLINE 32
+
+/** Number of slots in the free context's pointer check cache. */
+#define CYAML_FREE_CACHE_SLOTS 32
+
+/**
+ * A work stack frame, for a mapping or sequence whose contents own
+ * allocations.
+ */
+typedef struct cyaml_free_frame {
+	const cyaml_schema_value_t *schema; /**< Schema for the value. */
+	uint8_t *data;  /**< The value's data. */
+	uint8_t *alloc; /**< Allocation to free when done, or NULL. */
+	uint32_t idx;   /**< Next mapping field or sequence entry to visit. */
+	uint32_t count; /**< Sequence entry count. */
+} cyaml_free_frame_t;
+
+/**
+ * A pointer check cache slot.
+ */
+typedef struct cyaml_free_cache_slot {
+	const cyaml_schema_value_t *schema; /**< Schema checked, or NULL. */
+	bool has_pointers; /**< Whether the value's data contains pointers. */
+} cyaml_free_cache_slot_t;
 
 /**
- * Internal function for freeing a CYAML-parsed data structure.
+ * Internal context for freeing a CYAML-parsed data structure.
+ */
+typedef struct cyaml_free_ctx {
+	const cyaml_config_t *cfg;  /**< The client's CYAML library config. */
+	/** Compiled schema for the value being freed, or NULL. */
+	const cyaml_schema_compiled_t *compiled;
+	cyaml_free_frame_t *stack;  /**< The work stack. */
+	uint32_t stack_idx;         /**< Next (empty) work stack slot. */
+	uint32_t stack_max;         /**< Current work stack size. */
+	/** Initial work stack. */
+	cyaml_free_frame_t stack_inline[CYAML_FREE_STACK_INLINE];
+	/** Pointer checks for values the compiled schema doesn't cover. */
+	cyaml_free_cache_slot_t cache[CYAML_FREE_CACHE_SLOTS];
+} cyaml_free_ctx_t;
+
+/**
+ * Check whether a value's own data contains pointers to allocations.
+ *
+ * Without compiled schema information for the value, its schema must be
+ * walked.  The result is cached, so that each schema value is normally only
+ * walked once per free.
+ *
+ * \param[in]  ctx     The free context.
+ * \param[in]  schema  The schema for the value.
+ * \return true if the value's data contains pointers, false otherwise.
+ */
+static inline bool cyaml__contents_have_pointers(
+		cyaml_free_ctx_t *ctx,
+		const cyaml_schema_value_t *schema)
+{
+	cyaml_free_cache_slot_t *slot;
+
+	if (ctx->compiled != NULL) {
+		const cyaml_schema_value_info_t *info =
+				cyaml_schema_compiled_value(
+						ctx->compiled, schema);
+		if (info != NULL) {
+			return info->has_pointers;
+		}
+	}
+
+	slot = &ctx->cache[((uintptr_t)schema / sizeof(*schema)) %
+			CYAML_FREE_CACHE_SLOTS];
+	if (slot->schema != schema) {
+		slot->schema = schema;
+		slot->has_pointers = cyaml_schema_has_pointers(schema);
+	}
+
+	return slot->has_pointers;
+}
+
+/**
+ * Free a CYAML-parsed value recursively, with a new work stack.
  *
  * \param[in]  cfg     The client's CYAML library config.
  * \param[in]  schema  The schema describing how to free `data`.
@@ -42,65 +131,144 @@
 static void cyaml__free_value(
 		const cyaml_config_t *cfg,
 		const cyaml_schema_value_t *schema,
-		uint8_t * data,
+		uint8_t *data,
 		unsigned count);
 
 /**
- * Internal function for freeing a CYAML-parsed sequence.
+ * Start freeing a value.
  *
- * \param[in]  cfg              The client's CYAML library config.
- * \param[in]  sequence_schema  The schema describing how to free `data`.
- * \param[in]  data             The data structure to be freed.
- * \param[in]  count            The sequence's entry count.
+ * Values that own no allocations are ignored.  Values that are pointers to
+ * data that owns no allocations are freed immediately.  Otherwise a work
+ * stack frame is pushed for the value.
+ *
+ * \param[in]  ctx     The free context.
+ * \param[in]  schema  The schema for the value.
+ * \param[in]  data    The value's data, or for \ref CYAML_FLAG_POINTER
+ *                     values, the address of the pointer to the data.
+ * \param[in]  count   If value is of type \ref CYAML_SEQUENCE, this is the
+ *                     number of entries in the sequence.
  */
-static void cyaml__free_sequence(
-		const cyaml_config_t *cfg,
-		const cyaml_schema_value_t *sequence_schema,
-		uint8_t * const data,
+static void cyaml__free_push(
+		cyaml_free_ctx_t *ctx,
+		const cyaml_schema_value_t *schema,
+		uint8_t *data,
 		unsigned count)
 {
-	const cyaml_schema_value_t *schema = sequence_schema->sequence.entry;
-	uint32_t data_size = schema->data_size;
+	uint8_t *alloc = NULL;
 
 	if (schema->flags & CYAML_FLAG_POINTER) {
-		data_size = sizeof(data);
+		alloc = cyaml_data_read_pointer(data);
+		if (alloc == NULL) {
+			return;
+		}
+		data = alloc;
 	}
 
-	for (unsigned i = 0; i < count; i++) {
-		cyaml__log(cfg, CYAML_LOG_DEBUG, "Freeing sequence entry: %u\n", i);
-		cyaml__free_value(cfg, schema, data + data_size * i, 0);
+	if (schema->type == CYAML_SEQUENCE_FIXED) {
+		count = schema->sequence.max;
 	}
+
+	if (!cyaml__contents_have_pointers(ctx, schema) ||
+	    (schema->type != CYAML_MAPPING && count == 0)) {
+		if (alloc != NULL) {
+			cyaml__log(ctx->cfg, CYAML_LOG_DEBUG,
+					"Freeing: %p\n", alloc);
+			cyaml__free(ctx->cfg, alloc);
+		}
+		return;
+	}
+
+	if (ctx->stack_idx == ctx->stack_max) {
+		cyaml_free_frame_t *temp = NULL;
+		uint32_t max = ctx->stack_max * 2;
+
+		if (ctx->stack == ctx->stack_inline) {
+			temp = cyaml__alloc(ctx->cfg,
+					sizeof(*temp) * max, false);
+			if (temp != NULL) {
+				memcpy(temp, ctx->stack_inline,
+						sizeof(ctx->stack_inline));
+			}
+		} else {
+			temp = cyaml__realloc(ctx->cfg, ctx->stack, 0,
+					sizeof(*temp) * max, false);
+		}
+		if (temp == NULL) {
+			/* Free the subtree with a fresh work stack. */
+			cyaml__free_value(ctx->cfg, schema,
+					(alloc != NULL) ? (uint8_t *)&alloc :
+					data, count);
+			return;
+		}
+		ctx->stack = temp;
+		ctx->stack_max = max;
+	}
+
+	ctx->stack[ctx->stack_idx++] = (cyaml_free_frame_t) {
+		.schema = schema,
+		.data = data,
+		.alloc = alloc,
+		.count = count,
+	};
 }
 
 /**
- * Internal function for freeing a CYAML-parsed mapping.
+ * Visit the next child of the value on top of the work stack.
  *
- * \param[in]  cfg             The client's CYAML library config.
- * \param[in]  mapping_schema  The schema describing how to free `data`.
- * \param[in]  data            The data structure to be freed.
+ * If the value has no children left, it is popped, and its allocation
+ * freed.
+ *
+ * \param[in]  ctx  The free context.
  */
-static void cyaml__free_mapping(
-		const cyaml_config_t *cfg,
-		const cyaml_schema_value_t *mapping_schema,
-		uint8_t * const data)
+static void cyaml__free_step(
+		cyaml_free_ctx_t *ctx)
 {
-	const cyaml_schema_field_t *schema = mapping_schema->mapping.fields;
-
-	while (schema->key != NULL) {
-		unsigned count = 0;
-		cyaml__log(cfg, CYAML_LOG_DEBUG, "Freeing key: %s (at offset: %u)\n",
-				schema->key, (unsigned)schema->data_offset);
-		if (schema->value.type == CYAML_SEQUENCE) {
-			cyaml_err_t err;
-			count = cyaml_data_read(schema->count_size,
-					data + schema->count_offset, &err);
-			if (err != CYAML_OK) {
-				return;
+	cyaml_free_frame_t *frame = &ctx->stack[ctx->stack_idx - 1];
+	const cyaml_schema_value_t *schema = frame->schema;
+
+	if (schema->type == CYAML_MAPPING) {
+		const cyaml_schema_field_t *field =
+				&schema->mapping.fields[frame->idx];
+
+		if (field->key != NULL) {
+			uint8_t *data = frame->data;
+			unsigned count = 0;
+
+			frame->idx++;
+			if (field->value.type == CYAML_SEQUENCE) {
+				cyaml_err_t err;
+				count = cyaml_data_read(field->count_size,
+						data + field->count_offset,
+						&err);
+				if (err != CYAML_OK) {
+					return;
+				}
 			}
+			/* May move the work stack; frame is invalid after. */
+			cyaml__free_push(ctx, &field->value,
+					data + field->data_offset, count);
+			return;
+		}
+	} else if (frame->idx < frame->count) {
+		const cyaml_schema_value_t *entry = schema->sequence.entry;
+		uint32_t data_size = entry->data_size;
+		uint8_t *data;
+
+		if (entry->flags & CYAML_FLAG_POINTER) {
+			data_size = sizeof(data);
 		}
-		cyaml__free_value(cfg, &schema->value,
-				data + schema->data_offset, count);
-		schema++;
+
+		data = frame->data + (size_t)data_size * frame->idx;
+		frame->idx++;
+		cyaml__free_push(ctx, entry, data, 0);
+		return;
+	}
+
+	ctx->stack_idx--;
+	if (frame->alloc != NULL) {
+		cyaml__log(ctx->cfg, CYAML_LOG_DEBUG,
+				"Freeing: %p\n", frame->alloc);
+		cyaml__free(ctx->cfg, frame->alloc);
 	}
 }
 
@@ -108,32 +276,37 @@ static void cyaml__free_mapping(
 static void cyaml__free_value(
 		const cyaml_config_t *cfg,
 		const cyaml_schema_value_t *schema,
-		uint8_t * data,
+		uint8_t *data,
 		unsigned count)
 {
-	if (schema->flags & CYAML_FLAG_POINTER) {
-		data = cyaml_data_read_pointer(data);
-		if (data == NULL) {
-			return;
-		}
-	}
+	cyaml_free_ctx_t ctx = {
+		.cfg = cfg,
+		.compiled = cyaml_schema_compiled_get(cfg, schema),
+		.stack_max = CYAML_FREE_STACK_INLINE,
+	};
 
-	if (schema->type == CYAML_MAPPING) {
-		cyaml__free_mapping(cfg, schema, data);
-	} else if (schema->type == CYAML_SEQUENCE ||
-	           schema->type == CYAML_SEQUENCE_FIXED) {
-		if (schema->type == CYAML_SEQUENCE_FIXED) {
-			count = schema->sequence.max;
-		}
-		cyaml__free_sequence(cfg, schema, data, count);
+	ctx.stack = ctx.stack_inline;
+
+	cyaml__free_push(&ctx, schema, data, count);
+	while (ctx.stack_idx > 0) {
+		cyaml__free_step(&ctx);
 	}
 
-	if (schema->flags & CYAML_FLAG_POINTER) {
-		cyaml__log(cfg, CYAML_LOG_DEBUG, "Freeing: %p\n", data);
-		cyaml__free(cfg, data);
+	if (ctx.stack != ctx.stack_inline) {
+		cyaml__free(cfg, ctx.stack);
 	}
 }
 
+/* Exported function, documented in free.h. */
+void cyaml_free_value(
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		uint8_t *data,
+		unsigned count)
+{
+	cyaml__free_value(config, schema, data, count);
+}
+
 /* Exported function, documented in include/cyaml/cyaml.h */
 cyaml_err_t cyaml_free(
 		const cyaml_config_t *config,
@@ -150,6 +323,11 @@ cyaml_err_t cyaml_free(
 	if (schema == NULL) {
 		return CYAML_ERR_BAD_PARAM_NULL_SCHEMA;
 	}
+	if (config->flags & CYAML_CFG_ARENA) {
+		/* Everything was allocated from the document's arena. */
+		cyaml_arena_free(config, data);
+		return CYAML_OK;
+	}
 	cyaml__free_value(config, schema, (void *)&data, seq_count);
 	return CYAML_OK;
 }
@@ -0,0 +1,39 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (C) 2019 Michael Drake <tlsa@netsurf-browser.org>
+ */
+
+/**
+ * \file
+ * \brief Free data structures created by the CYAML load functions.
+ */
+
+#ifndef CYAML_FREE_H
+#define CYAML_FREE_H
+
+#include "cyaml/cyaml.h"
+
+/**
+ * Free a CYAML-parsed value.
+ *
+ * If the value's schema has \ref CYAML_FLAG_POINTER set, `data` is the
+ * address of the pointer to the value, and the value's allocation is
+ * freed.  Otherwise only the allocations the value contains are freed.
+ *
+ * \note This always uses the client's allocator directly, regardless
+ *       of \ref CYAML_CFG_ARENA.
+ *
+ * \param[in]  config  The client's CYAML library config.
+ * \param[in]  schema  The schema describing how to free `data`.
+ * \param[in]  data    The value to be freed.
+ * \param[in]  count   If data is of type \ref CYAML_SEQUENCE, this is the
+ *                     number of entries in the sequence.
+ */
+void cyaml_free_value(
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		uint8_t *data,
+		unsigned count);
+
+#endif
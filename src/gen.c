@@ -0,0 +1,1917 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (C) 2019 Michael Drake <tlsa@netsurf-browser.org>
+ */
+
+/**
+ * \file
+ * \brief Generate specialised C code for CYAML schemas.
+ *
+ * Each distinct value schema reachable from the top level schema becomes
+ * a node, with its own generated load, save and free functions.  Nodes are
+ * found by schema address, so a recursive schema gives recursive functions
+ * rather than an endless walk.
+ */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "gen.h"
+
+#include "mem.h"
+#include "util.h"
+#include "schema.h"
+
+/** Value of \ref cyaml_gen_ctx_t::count for a node that isn't found. */
+#define CYAML_GEN_NODE_NONE UINT32_MAX
+
+/**
+ * CYAML code generation context.
+ */
+typedef struct cyaml_gen_ctx {
+	const cyaml_config_t *config; /**< Client's CYAML configuration. */
+	const char *prefix;           /**< Prefix for generated names. */
+	FILE *out;                    /**< File being written. */
+	/** The value schemas to generate functions for. */
+	const cyaml_schema_value_t **nodes;
+	uint32_t count;               /**< Number of nodes in use. */
+	uint32_t max;                 /**< Number of nodes allocated. */
+} cyaml_gen_ctx_t;
+
+/**
+ * Find a value schema's node.
+ *
+ * \param[in]  ctx     The code generation context.
+ * \param[in]  schema  The value schema to find.
+ * \return the node index, or \ref CYAML_GEN_NODE_NONE.
+ */
+static uint32_t cyaml__gen_find(
+		const cyaml_gen_ctx_t *ctx,
+		const cyaml_schema_value_t *schema)
+{
+	for (uint32_t i = 0; i < ctx->count; i++) {
+		if (ctx->nodes[i] == schema) {
+			return i;
+		}
+	}
+
+	return CYAML_GEN_NODE_NONE;
+}
+
+/**
+ * Check whether a size can be stored with a single C integer type.
+ *
+ * \param[in]  size  The size in bytes.
+ * \return true if the size is 1, 2, 4 or 8 bytes.
+ */
+static inline bool cyaml__gen_int_size(
+		uint32_t size)
+{
+	return size == 1 || size == 2 || size == 4 || size == 8;
+}
+
+/**
+ * Check whether a value schema's data includes allocations to free.
+ *
+ * \param[in]  schema  The value schema.
+ * \return true if the value needs a free function.
+ */
+static inline bool cyaml__gen_owns(
+		const cyaml_schema_value_t *schema)
+{
+	return (schema->flags & CYAML_FLAG_POINTER) ||
+			cyaml_schema_has_pointers(schema);
+}
+
+/**
+ * Get the number of entries in a value schema's sequence.
+ *
+ * \param[in]  schema  The value schema.
+ * \return true for \ref CYAML_SEQUENCE, which has a variable count.
+ */
+static inline bool cyaml__gen_counted(
+		const cyaml_schema_value_t *schema)
+{
+	return schema->type == CYAML_SEQUENCE;
+}
+
+static cyaml_err_t cyaml__gen_add(
+		cyaml_gen_ctx_t *ctx,
+		const cyaml_schema_value_t *schema);
+
+/**
+ * Check that a value schema may be a sequence entry, and add it.
+ *
+ * \param[in]  ctx    The code generation context.
+ * \param[in]  entry  The sequence's entry schema.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__gen_add_entry(
+		cyaml_gen_ctx_t *ctx,
+		const cyaml_schema_value_t *entry)
+{
+	if (entry->type == CYAML_SEQUENCE) {
+		return CYAML_ERR_SEQUENCE_IN_SEQUENCE;
+	} else if (entry->type == CYAML_IGNORE) {
+		return CYAML_ERR_NOT_SUPPORTED;
+	}
+
+	return cyaml__gen_add(ctx, entry);
+}
+
+/**
+ * Check a mapping's fields, and add their value schemas.
+ *
+ * \param[in]  ctx     The code generation context.
+ * \param[in]  schema  The mapping value schema.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__gen_add_fields(
+		cyaml_gen_ctx_t *ctx,
+		const cyaml_schema_value_t *schema)
+{
+	for (const cyaml_schema_field_t *field = schema->mapping.fields;
+			field->key != NULL; field++) {
+		cyaml_err_t err;
+
+		if (field->value.type == CYAML_IGNORE) {
+			continue;
+		}
+		if (field->value.type == CYAML_SEQUENCE &&
+		    !cyaml__gen_int_size(field->count_size)) {
+			cyaml__log(ctx->config, CYAML_LOG_ERROR,
+					"Unsupported count size for: %s\n",
+					field->key);
+			return CYAML_ERR_NOT_SUPPORTED;
+		}
+
+		err = cyaml__gen_add(ctx, &field->value);
+		if (err != CYAML_OK) {
+			return err;
+		}
+	}
+
+	return CYAML_OK;
+}
+
+/**
+ * Check a value schema, and add it and its descendants as nodes.
+ *
+ * \param[in]  ctx     The code generation context.
+ * \param[in]  schema  The value schema to add.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__gen_add(
+		cyaml_gen_ctx_t *ctx,
+		const cyaml_schema_value_t *schema)
+{
+	if (cyaml__gen_find(ctx, schema) != CYAML_GEN_NODE_NONE) {
+		return CYAML_OK;
+	}
+
+	if (ctx->count == ctx->max) {
+		uint32_t max = (ctx->max == 0) ? 16 : ctx->max * 2;
+		const cyaml_schema_value_t **nodes;
+
+		nodes = cyaml__realloc(ctx->config, ctx->nodes,
+				sizeof(*nodes) * ctx->max,
+				sizeof(*nodes) * max, false);
+		if (nodes == NULL) {
+			return CYAML_ERR_OOM;
+		}
+		ctx->nodes = nodes;
+		ctx->max = max;
+	}
+	ctx->nodes[ctx->count++] = schema;
+
+	if (schema->flags & CYAML_FLAG_CASE_INSENSITIVE) {
+		cyaml__log(ctx->config, CYAML_LOG_ERROR,
+				"Case insensitive values are unsupported\n");
+		return CYAML_ERR_NOT_SUPPORTED;
+	}
+
+	switch (schema->type) {
+	case CYAML_INT:  /* Fall through. */
+	case CYAML_UINT: /* Fall through. */
+	case CYAML_BOOL: /* Fall through. */
+	case CYAML_ENUM: /* Fall through. */
+	case CYAML_FLAGS:
+		if (!cyaml__gen_int_size(schema->data_size)) {
+			cyaml__log(ctx->config, CYAML_LOG_ERROR,
+					"Unsupported data size: %"PRIu32"\n",
+					schema->data_size);
+			return CYAML_ERR_NOT_SUPPORTED;
+		}
+		return CYAML_OK;
+	case CYAML_FLOAT:
+		if (schema->data_size != sizeof(float) &&
+		    schema->data_size != sizeof(double)) {
+			return CYAML_ERR_INVALID_DATA_SIZE;
+		}
+		return CYAML_OK;
+	case CYAML_STRING:
+		if (schema->string.min > schema->string.max) {
+			return CYAML_ERR_BAD_MIN_MAX_SCHEMA;
+		}
+		return CYAML_OK;
+	case CYAML_MAPPING:
+		return cyaml__gen_add_fields(ctx, schema);
+	case CYAML_SEQUENCE_FIXED:
+		if (schema->sequence.min != schema->sequence.max) {
+			return CYAML_ERR_SEQUENCE_FIXED_COUNT;
+		}
+		return cyaml__gen_add_entry(ctx, schema->sequence.entry);
+	case CYAML_SEQUENCE:
+		if (schema->sequence.min > schema->sequence.max) {
+			return CYAML_ERR_BAD_MIN_MAX_SCHEMA;
+		}
+		return cyaml__gen_add_entry(ctx, schema->sequence.entry);
+	default:
+		return CYAML_ERR_BAD_TYPE_IN_SCHEMA;
+	}
+}
+
+/**
+ * Write a C string literal.
+ *
+ * Anything other than printable ASCII is written as an octal escape.
+ *
+ * \param[in]  out  File to write to.
+ * \param[in]  str  The string to write.
+ * \return the length of str in bytes.
+ */
+static size_t cyaml__gen_literal(
+		FILE *out,
+		const char *str)
+{
+	size_t len = strlen(str);
+
+	fputc('"', out);
+	for (size_t i = 0; i < len; i++) {
+		unsigned char c = (unsigned char)str[i];
+
+		if (c == '"' || c == '\\') {
+			fprintf(out, "\\%c", c);
+		} else if (c < ' ' || c > '~' || c == '?') {
+			/* Question marks are escaped to avoid trigraphs. */
+			fprintf(out, "\\%03o", c);
+		} else {
+			fputc(c, out);
+		}
+	}
+	fputc('"', out);
+
+	return len;
+}
+
+/**
+ * Write a signed 64-bit integer constant.
+ *
+ * \param[in]  out    File to write to.
+ * \param[in]  value  The value to write.
+ */
+static void cyaml__gen_int64(
+		FILE *out,
+		int64_t value)
+{
+	if (value == INT64_MIN) {
+		fprintf(out, "INT64_MIN");
+	} else {
+		fprintf(out, "INT64_C(%"PRId64")", value);
+	}
+}
+
+/**
+ * Get the name of the C unsigned integer type of a size.
+ *
+ * \param[in]  size  Size of the type, in bytes: 1, 2, 4 or 8.
+ * \return the type name.
+ */
+static const char * cyaml__gen_uint_type(
+		uint32_t size)
+{
+	switch (size) {
+	case 1:  return "uint8_t";
+	case 2:  return "uint16_t";
+	case 4:  return "uint32_t";
+	default: return "uint64_t";
+	}
+}
+
+/**
+ * Get the name of the C signed integer type of a size.
+ *
+ * \param[in]  size  Size of the type, in bytes: 1, 2, 4 or 8.
+ * \return the type name.
+ */
+static const char * cyaml__gen_int_type(
+		uint32_t size)
+{
+	switch (size) {
+	case 1:  return "int8_t";
+	case 2:  return "int16_t";
+	case 4:  return "int32_t";
+	default: return "int64_t";
+	}
+}
+
+/**
+ * Get the stem of the C limit macros for integers of a size.
+ *
+ * \param[in]  size  Size of the type, in bytes: 1, 2 or 4.
+ * \return the limit macro stem, for example "INT8" for one byte.
+ */
+static const char * cyaml__gen_limit(
+		uint32_t size)
+{
+	switch (size) {
+	case 1:  return "INT8";
+	case 2:  return "INT16";
+	default: return "INT32";
+	}
+}
+
+/**
+ * Get the generated style for a mapping or sequence value.
+ *
+ * \param[in]  schema  The value schema.
+ * \return the name of the \ref cyaml_gen_style_t value.
+ */
+static const char * cyaml__gen_style(
+		const cyaml_schema_value_t *schema)
+{
+	if (schema->flags & CYAML_FLAG_BLOCK) {
+		return "CYAML_GEN_STYLE_BLOCK";
+	} else if (schema->flags & CYAML_FLAG_FLOW) {
+		return "CYAML_GEN_STYLE_FLOW";
+	}
+
+	return "CYAML_GEN_STYLE_DEFAULT";
+}
+
+/**
+ * Write the signature of a node's load function.
+ *
+ * \param[in]  ctx    The code generation context.
+ * \param[in]  id     The node index.
+ * \param[in]  proto  Whether to write a prototype, rather than a definition.
+ */
+static void cyaml__gen_load_sig(
+		const cyaml_gen_ctx_t *ctx,
+		uint32_t id,
+		bool proto)
+{
+	fprintf(ctx->out, "static cyaml_err_t %s__load_%"PRIu32"(\n"
+			"\t\tcyaml_gen_load_t *l,\n"
+			"\t\tcyaml_gen_event_t evt,\n"
+			"\t\tuint8_t *data%s)%s\n",
+			ctx->prefix, id,
+			cyaml__gen_counted(ctx->nodes[id]) ?
+					",\n\t\tuint64_t *count" : "",
+			proto ? ";\n" : "");
+}
+
+/**
+ * Write the signature of a node's save function.
+ *
+ * \param[in]  ctx    The code generation context.
+ * \param[in]  id     The node index.
+ * \param[in]  proto  Whether to write a prototype, rather than a definition.
+ */
+static void cyaml__gen_save_sig(
+		const cyaml_gen_ctx_t *ctx,
+		uint32_t id,
+		bool proto)
+{
+	fprintf(ctx->out, "static cyaml_err_t %s__save_%"PRIu32"(\n"
+			"\t\tcyaml_gen_save_t *s,\n"
+			"\t\tconst uint8_t *data%s)%s\n",
+			ctx->prefix, id,
+			cyaml__gen_counted(ctx->nodes[id]) ?
+					",\n\t\tuint64_t count" : "",
+			proto ? ";\n" : "");
+}
+
+/**
+ * Write the signature of a node's free function.
+ *
+ * \param[in]  ctx    The code generation context.
+ * \param[in]  id     The node index.
+ * \param[in]  proto  Whether to write a prototype, rather than a definition.
+ */
+static void cyaml__gen_free_sig(
+		const cyaml_gen_ctx_t *ctx,
+		uint32_t id,
+		bool proto)
+{
+	fprintf(ctx->out, "static void %s__free_%"PRIu32"(\n"
+			"\t\tconst cyaml_config_t *config,\n"
+			"\t\tuint8_t *data%s)%s\n",
+			ctx->prefix, id,
+			cyaml__gen_counted(ctx->nodes[id]) ?
+					",\n\t\tuint64_t count" : "",
+			proto ? ";\n" : "");
+}
+
+/**
+ * Write a node's string lookup function, for enums and flags.
+ *
+ * The strings are dispatched on length, then compared.  Where a string
+ * appears more than once, the first entry wins, as with the interpreter.
+ *
+ * \param[in]  ctx  The code generation context.
+ * \param[in]  id   The node index.
+ */
+static void cyaml__gen_strval_fn(
+		const cyaml_gen_ctx_t *ctx,
+		uint32_t id)
+{
+	const cyaml_schema_value_t *schema = ctx->nodes[id];
+	const cyaml_strval_t *strings = schema->enumeration.strings;
+	uint32_t count = schema->enumeration.count;
+	FILE *out = ctx->out;
+
+	fprintf(out, "static bool %s__str_%"PRIu32"(\n"
+			"\t\tconst char *value,\n"
+			"\t\tsize_t len,\n"
+			"\t\tint64_t *value_out)\n"
+			"{\n", ctx->prefix, id);
+
+	if (count == 0) {
+		fprintf(out, "\t(void)value;\n"
+				"\t(void)len;\n"
+				"\t(void)value_out;\n"
+				"\treturn false;\n"
+				"}\n\n");
+		return;
+	}
+
+	fprintf(out, "\tswitch (len) {\n");
+	for (uint32_t i = 0; i < count; i++) {
+		size_t len = strlen(strings[i].str);
+		bool done = false;
+
+		/* Each length's strings are written at its first use. */
+		for (uint32_t j = 0; j < i; j++) {
+			if (strlen(strings[j].str) == len) {
+				done = true;
+				break;
+			}
+		}
+		if (done) {
+			continue;
+		}
+
+		fprintf(out, "\tcase %zu:\n", len);
+		for (uint32_t j = i; j < count; j++) {
+			if (strlen(strings[j].str) != len) {
+				continue;
+			}
+			fprintf(out, "\t\tif (memcmp(value, ");
+			cyaml__gen_literal(out, strings[j].str);
+			fprintf(out, ", %zu) == 0) {\n"
+					"\t\t\t*value_out = ", len);
+			cyaml__gen_int64(out, strings[j].val);
+			fprintf(out, ";\n"
+					"\t\t\treturn true;\n"
+					"\t\t}\n");
+		}
+		fprintf(out, "\t\tbreak;\n");
+	}
+	fprintf(out, "\tdefault:\n"
+			"\t\tbreak;\n"
+			"\t}\n\n"
+			"\treturn false;\n"
+			"}\n\n");
+}
+
+/**
+ * Write a node's key lookup function, for mappings.
+ *
+ * \param[in]  ctx  The code generation context.
+ * \param[in]  id   The node index.
+ */
+static void cyaml__gen_key_fn(
+		const cyaml_gen_ctx_t *ctx,
+		uint32_t id)
+{
+	const cyaml_schema_field_t *fields = ctx->nodes[id]->mapping.fields;
+	FILE *out = ctx->out;
+
+	fprintf(out, "static int %s__key_%"PRIu32"(\n"
+			"\t\tconst char *key,\n"
+			"\t\tsize_t len)\n"
+			"{\n", ctx->prefix, id);
+
+	if (fields[0].key == NULL) {
+		fprintf(out, "\t(void)key;\n"
+				"\t(void)len;\n"
+				"\treturn -1;\n"
+				"}\n\n");
+		return;
+	}
+
+	fprintf(out, "\tswitch (len) {\n");
+	for (unsigned i = 0; fields[i].key != NULL; i++) {
+		size_t len = strlen(fields[i].key);
+		bool done = false;
+
+		for (unsigned j = 0; j < i; j++) {
+			if (strlen(fields[j].key) == len) {
+				done = true;
+				break;
+			}
+		}
+		if (done) {
+			continue;
+		}
+
+		fprintf(out, "\tcase %zu:\n", len);
+		for (unsigned j = i; fields[j].key != NULL; j++) {
+			if (strlen(fields[j].key) != len) {
+				continue;
+			}
+			fprintf(out, "\t\tif (memcmp(key, ");
+			cyaml__gen_literal(out, fields[j].key);
+			fprintf(out, ", %zu) == 0) {\n"
+					"\t\t\treturn %u;\n"
+					"\t\t}\n", len, j);
+		}
+		fprintf(out, "\t\tbreak;\n");
+	}
+	fprintf(out, "\tdefault:\n"
+			"\t\tbreak;\n"
+			"\t}\n\n"
+			"\treturn -1;\n"
+			"}\n\n");
+}
+
+/**
+ * Write the code to allocate a pointer value, and point data at it.
+ *
+ * \param[in]  out   File to write to.
+ * \param[in]  size  C expression for the allocation size.
+ */
+static void cyaml__gen_load_alloc(
+		FILE *out,
+		const char *size)
+{
+	fprintf(out, "\tp = cyaml_gen_load_alloc(l, NULL, 0, %s);\n"
+			"\tif (p == NULL) {\n"
+			"\t\treturn CYAML_ERR_OOM;\n"
+			"\t}\n"
+			"\tcyaml_gen_data_write_pointer(p, data);\n"
+			"\tdata = p;\n", size);
+}
+
+/**
+ * Write the allocation code for a node's pointer value, if it has one.
+ *
+ * \param[in]  out     File to write to.
+ * \param[in]  schema  The value schema.
+ */
+static void cyaml__gen_load_pointer(
+		FILE *out,
+		const cyaml_schema_value_t *schema)
+{
+	if (schema->flags & CYAML_FLAG_POINTER) {
+		char size[32];
+
+		snprintf(size, sizeof(size), "%"PRIu32, schema->data_size);
+		cyaml__gen_load_alloc(out, size);
+	}
+}
+
+/**
+ * Write the code to check a scalar event, and get the scalar's value.
+ *
+ * \param[in]  out  File to write to.
+ */
+static void cyaml__gen_load_scalar(
+		FILE *out)
+{
+	fprintf(out, "\tif (evt != CYAML_GEN_EVT_SCALAR) {\n"
+			"\t\treturn CYAML_ERR_INVALID_VALUE;\n"
+			"\t}\n"
+			"\tvalue = cyaml_gen_load_scalar(l, &len);\n");
+}
+
+/**
+ * Write the code to range check a parsed signed integer.
+ *
+ * \param[in]  out   File to write to.
+ * \param[in]  size  The integer's size in bytes.
+ */
+static void cyaml__gen_int_range(
+		FILE *out,
+		uint32_t size)
+{
+	if (size < sizeof(int64_t)) {
+		fprintf(out, " ||\n\t    number < %s_MIN || number > %s_MAX",
+				cyaml__gen_limit(size),
+				cyaml__gen_limit(size));
+	}
+}
+
+/**
+ * Write the code to range check a parsed unsigned integer.
+ *
+ * \param[in]  out   File to write to.
+ * \param[in]  name  The variable to check.
+ * \param[in]  size  The integer's size in bytes.
+ */
+static void cyaml__gen_uint_range(
+		FILE *out,
+		const char *name,
+		uint32_t size)
+{
+	if (size < sizeof(uint64_t)) {
+		fprintf(out, " || %s > U%s_MAX", name, cyaml__gen_limit(size));
+	}
+}
+
+/**
+ * Write the body of a scalar node's load function.
+ *
+ * \param[in]  ctx  The code generation context.
+ * \param[in]  id   The node index.
+ */
+static void cyaml__gen_load_scalar_fn(
+		const cyaml_gen_ctx_t *ctx,
+		uint32_t id)
+{
+	const cyaml_schema_value_t *schema = ctx->nodes[id];
+	uint32_t size = schema->data_size;
+	FILE *out = ctx->out;
+
+	if (schema->flags & CYAML_FLAG_POINTER) {
+		fprintf(out, "\tuint8_t *p;\n");
+	}
+	fprintf(out, "\tconst char *value;\n"
+			"\tsize_t len;\n");
+
+	switch (schema->type) {
+	case CYAML_INT:
+		fprintf(out, "\tint64_t number;\n"
+				"\t%s v;\n\n", cyaml__gen_int_type(size));
+		cyaml__gen_load_scalar(out);
+		fprintf(out, "\tif (!cyaml_gen_parse_int(value, len, &number)");
+		cyaml__gen_int_range(out, size);
+		fprintf(out, ") {\n"
+				"\t\treturn CYAML_ERR_INVALID_VALUE;\n"
+				"\t}\n"
+				"\tv = (%s)number;\n",
+				cyaml__gen_int_type(size));
+		break;
+	case CYAML_UINT:
+		fprintf(out, "\tuint64_t number;\n"
+				"\t%s v;\n\n", cyaml__gen_uint_type(size));
+		cyaml__gen_load_scalar(out);
+		fprintf(out, "\tif (!cyaml_gen_parse_uint("
+				"value, len, &number)");
+		cyaml__gen_uint_range(out, "number", size);
+		fprintf(out, ") {\n"
+				"\t\treturn CYAML_ERR_INVALID_VALUE;\n"
+				"\t}\n"
+				"\tv = (%s)number;\n",
+				cyaml__gen_uint_type(size));
+		break;
+	case CYAML_BOOL:
+		fprintf(out, "\t%s v;\n\n", cyaml__gen_uint_type(size));
+		cyaml__gen_load_scalar(out);
+		fprintf(out, "\tv = cyaml_gen_parse_bool(value, len);\n");
+		break;
+	case CYAML_ENUM:
+		fprintf(out, "\tint64_t number;\n"
+				"\t%s v;\n\n", cyaml__gen_uint_type(size));
+		cyaml__gen_load_scalar(out);
+		fprintf(out, "\tif (!%s__str_%"PRIu32"(value, len, &number)",
+				ctx->prefix, id);
+		if (schema->flags & CYAML_FLAG_STRICT) {
+			fprintf(out, ") {\n");
+		} else {
+			fprintf(out, " &&\n\t    (!cyaml_gen_parse_int("
+					"value, len, &number)");
+			cyaml__gen_int_range(out, size);
+			fprintf(out, ")) {\n");
+		}
+		fprintf(out, "\t\treturn CYAML_ERR_INVALID_VALUE;\n"
+				"\t}\n"
+				"\tv = (%s)number;\n",
+				cyaml__gen_uint_type(size));
+		break;
+	case CYAML_FLOAT:
+		fprintf(out, "\t%s v;\n\n", (size == sizeof(float)) ?
+				"float" : "double");
+		cyaml__gen_load_scalar(out);
+		fprintf(out, "\tif (!cyaml_gen_parse_%s(value, len, &v)) {\n"
+				"\t\treturn CYAML_ERR_INVALID_VALUE;\n"
+				"\t}\n", (size == sizeof(float)) ?
+				"float" : "double");
+		break;
+	case CYAML_STRING:
+		fprintf(out, "\n");
+		cyaml__gen_load_scalar(out);
+		if (schema->string.min > 0) {
+			fprintf(out, "\tif (len < %"PRIu32") {\n"
+					"\t\treturn "
+					"CYAML_ERR_STRING_LENGTH_MIN;\n"
+					"\t}\n", schema->string.min);
+		}
+		if (schema->string.max != CYAML_UNLIMITED) {
+			fprintf(out, "\tif (len > %"PRIu32") {\n"
+					"\t\treturn "
+					"CYAML_ERR_STRING_LENGTH_MAX;\n"
+					"\t}\n", schema->string.max);
+		}
+		if (schema->flags & CYAML_FLAG_POINTER) {
+			cyaml__gen_load_alloc(out, "len + 1");
+		}
+		fprintf(out, "\tmemcpy(data, value, len + 1);\n"
+				"\treturn CYAML_OK;\n");
+		return;
+	default:
+		return;
+	}
+
+	cyaml__gen_load_pointer(out, schema);
+	if (schema->type == CYAML_FLOAT) {
+		fprintf(out, "\tmemcpy(data, &v, sizeof(v));\n");
+	} else {
+		fprintf(out, "\tcyaml_gen_data_write("
+				"(uint64_t)v, sizeof(v), data);\n");
+	}
+	fprintf(out, "\treturn CYAML_OK;\n");
+}
+
+/**
+ * Write the body of a flags node's load function.
+ *
+ * \param[in]  ctx  The code generation context.
+ * \param[in]  id   The node index.
+ */
+static void cyaml__gen_load_flags_fn(
+		const cyaml_gen_ctx_t *ctx,
+		uint32_t id)
+{
+	const cyaml_schema_value_t *schema = ctx->nodes[id];
+	uint32_t size = schema->data_size;
+	FILE *out = ctx->out;
+
+	if (schema->flags & CYAML_FLAG_POINTER) {
+		fprintf(out, "\tuint8_t *p;\n");
+	}
+	fprintf(out, "\tuint64_t number = 0;\n"
+			"\tconst char *value;\n"
+			"\tcyaml_err_t err;\n"
+			"\tint64_t flag;\n"
+			"\tsize_t len;\n"
+			"\t%s v;\n\n"
+			"\tif (evt != CYAML_GEN_EVT_SEQ_START) {\n"
+			"\t\treturn CYAML_ERR_INVALID_VALUE;\n"
+			"\t}\n\n"
+			"\twhile (true) {\n"
+			"\t\terr = cyaml_gen_load_next(l, &evt);\n"
+			"\t\tif (err != CYAML_OK) {\n"
+			"\t\t\treturn err;\n"
+			"\t\t} else if (evt == CYAML_GEN_EVT_SEQ_END) {\n"
+			"\t\t\tbreak;\n"
+			"\t\t} else if (evt != CYAML_GEN_EVT_SCALAR) {\n"
+			"\t\t\treturn CYAML_ERR_UNEXPECTED_EVENT;\n"
+			"\t\t}\n"
+			"\t\tvalue = cyaml_gen_load_scalar(l, &len);\n"
+			"\t\tif (%s__str_%"PRIu32"(value, len, &flag)) {\n"
+			"\t\t\tnumber |= (uint64_t)flag;\n",
+			cyaml__gen_uint_type(size), ctx->prefix, id);
+	if (schema->flags & CYAML_FLAG_STRICT) {
+		fprintf(out, "\t\t} else {\n"
+				"\t\t\treturn CYAML_ERR_INVALID_VALUE;\n"
+				"\t\t}\n");
+	} else {
+		fprintf(out, "\t\t} else {\n"
+				"\t\t\tuint64_t extra;\n"
+				"\t\t\tif (!cyaml_gen_parse_uint("
+				"value, len, &extra)");
+		cyaml__gen_uint_range(out, "extra", size);
+		fprintf(out, ") {\n"
+				"\t\t\t\treturn CYAML_ERR_INVALID_VALUE;\n"
+				"\t\t\t}\n"
+				"\t\t\tnumber |= extra;\n"
+				"\t\t}\n");
+	}
+	fprintf(out, "\t}\n\n"
+			"\tv = (%s)number;\n", cyaml__gen_uint_type(size));
+	cyaml__gen_load_pointer(out, schema);
+	fprintf(out, "\tcyaml_gen_data_write(v, sizeof(v), data);\n"
+			"\treturn CYAML_OK;\n");
+}
+
+/**
+ * Get the number of bytes a mapping field's value takes in its mapping.
+ *
+ * \param[in]  field  The mapping field.
+ * \param[in]  buf    Buffer to write the C expression for the size into.
+ * \param[in]  len    Length of buf.
+ */
+static void cyaml__gen_field_size(
+		const cyaml_schema_field_t *field,
+		char *buf,
+		size_t len)
+{
+	const cyaml_schema_value_t *value = &field->value;
+	uint64_t size = value->data_size;
+
+	if (value->flags & CYAML_FLAG_POINTER) {
+		snprintf(buf, len, "sizeof(void *)");
+		return;
+	}
+
+	switch (value->type) {
+	case CYAML_STRING:
+		size = (uint64_t)value->string.max + 1;
+		break;
+	case CYAML_SEQUENCE: /* Fall through. */
+	case CYAML_SEQUENCE_FIXED:
+		size = (uint64_t)value->data_size * value->sequence.max;
+		break;
+	default:
+		break;
+	}
+
+	snprintf(buf, len, "%"PRIu64, size);
+}
+
+/**
+ * Write the code to read a mapping field's sequence entry count.
+ *
+ * \param[in]  out    File to write to.
+ * \param[in]  field  The mapping field.
+ * \param[in]  tab    Indentation to write the code at.
+ */
+static void cyaml__gen_read_count(
+		FILE *out,
+		const cyaml_schema_field_t *field,
+		const char *tab)
+{
+	const char *type = cyaml__gen_uint_type(field->count_size);
+
+	fprintf(out, "%s%s c = (%s)cyaml_gen_data_read(\n"
+			"%s\t\t%"PRIu8", data + %"PRIu32");\n",
+			tab, type, type, tab,
+			field->count_size, field->count_offset);
+}
+
+/**
+ * Write the code to store a mapping field's sequence entry count.
+ *
+ * \param[in]  out    File to write to.
+ * \param[in]  field  The mapping field.
+ * \param[in]  tab    Indentation to write the code at.
+ */
+static void cyaml__gen_store_count(
+		FILE *out,
+		const cyaml_schema_field_t *field,
+		const char *tab)
+{
+	fprintf(out, "%scyaml_gen_data_write(count, %"PRIu8
+			", data + %"PRIu32");\n",
+			tab, field->count_size, field->count_offset);
+}
+
+/**
+ * Write the body of a mapping node's load function.
+ *
+ * \param[in]  ctx  The code generation context.
+ * \param[in]  id   The node index.
+ */
+static void cyaml__gen_load_mapping_fn(
+		const cyaml_gen_ctx_t *ctx,
+		uint32_t id)
+{
+	const cyaml_schema_value_t *schema = ctx->nodes[id];
+	const cyaml_schema_field_t *fields = schema->mapping.fields;
+	bool counted = false;
+	unsigned count = 0;
+	FILE *out = ctx->out;
+
+	for (count = 0; fields[count].key != NULL; count++) {
+		if (fields[count].value.type == CYAML_SEQUENCE) {
+			counted = true;
+		}
+	}
+
+	if (schema->flags & CYAML_FLAG_POINTER) {
+		fprintf(out, "\tuint8_t *p;\n");
+	}
+	if (count > 0) {
+		fprintf(out, "\tuint64_t seen[%u] = { 0 };\n",
+				(count + 63) / 64);
+	}
+	if (counted) {
+		fprintf(out, "\tuint64_t count;\n");
+	}
+	fprintf(out, "\tconst char *key;\n"
+			"\tcyaml_err_t err;\n"
+			"\tsize_t len;\n"
+			"\tint field;\n\n"
+			"\tif (evt != CYAML_GEN_EVT_MAP_START) {\n"
+			"\t\treturn CYAML_ERR_INVALID_VALUE;\n"
+			"\t}\n");
+	cyaml__gen_load_pointer(out, schema);
+	fprintf(out, "\n"
+			"\twhile (true) {\n"
+			"\t\terr = cyaml_gen_load_next(l, &evt);\n"
+			"\t\tif (err != CYAML_OK) {\n"
+			"\t\t\treturn err;\n"
+			"\t\t} else if (evt == CYAML_GEN_EVT_MAP_END) {\n"
+			"\t\t\tbreak;\n"
+			"\t\t} else if (evt != CYAML_GEN_EVT_SCALAR) {\n"
+			"\t\t\treturn CYAML_ERR_UNEXPECTED_EVENT;\n"
+			"\t\t}\n"
+			"\t\tkey = cyaml_gen_load_scalar(l, &len);\n"
+			"\t\tfield = %s__key_%"PRIu32"(key, len);\n"
+			"\t\tif (field < 0 && "
+			"!(cyaml_gen_load_config(l)->flags &\n"
+			"\t\t\t\tCYAML_CFG_IGNORE_UNKNOWN_KEYS)) {\n"
+			"\t\t\treturn CYAML_ERR_INVALID_KEY;\n"
+			"\t\t}\n"
+			"\t\terr = cyaml_gen_load_next(l, &evt);\n"
+			"\t\tif (err != CYAML_OK) {\n"
+			"\t\t\treturn err;\n"
+			"\t\t}\n"
+			"\t\tswitch (field) {\n", ctx->prefix, id);
+
+	for (unsigned i = 0; i < count; i++) {
+		const cyaml_schema_field_t *field = &fields[i];
+		uint32_t value;
+		char bit[32];
+
+		snprintf(bit, sizeof(bit), "((uint64_t)1 << %u)", i % 64);
+
+		fprintf(out, "\t\tcase %u:\n", i);
+		if (field->value.type == CYAML_IGNORE) {
+			fprintf(out, "\t\t\tseen[%u] |= %s;\n"
+					"\t\t\terr = cyaml_gen_load_skip("
+					"l, evt);\n"
+					"\t\t\tbreak;\n", i / 64, bit);
+			continue;
+		}
+
+		value = cyaml__gen_find(ctx, &field->value);
+		if (cyaml__gen_owns(&field->value)) {
+			char size[32];
+
+			/* A repeated key replaces the earlier value. */
+			cyaml__gen_field_size(field, size, sizeof(size));
+			fprintf(out, "\t\t\tif (seen[%u] & %s) {\n",
+					i / 64, bit);
+			if (field->value.type == CYAML_SEQUENCE) {
+				cyaml__gen_read_count(out, field, "\t\t\t\t");
+			}
+			fprintf(out, "\t\t\t\t%s__free_%"PRIu32"("
+					"cyaml_gen_load_config(l),\n"
+					"\t\t\t\t\t\tdata + %"PRIu32"%s);\n"
+					"\t\t\t\tmemset(data + %"PRIu32
+					", 0, %s);\n"
+					"\t\t\t}\n",
+					ctx->prefix, value, field->data_offset,
+					(field->value.type == CYAML_SEQUENCE) ?
+							", c" : "",
+					field->data_offset, size);
+		}
+		fprintf(out, "\t\t\tseen[%u] |= %s;\n", i / 64, bit);
+		if (field->value.type == CYAML_SEQUENCE) {
+			fprintf(out, "\t\t\tcount = 0;\n"
+					"\t\t\terr = %s__load_%"PRIu32"("
+					"l, evt, data + %"PRIu32
+					", &count);\n",
+					ctx->prefix, value, field->data_offset);
+			cyaml__gen_store_count(out, field, "\t\t\t");
+		} else {
+			fprintf(out, "\t\t\terr = %s__load_%"PRIu32"("
+					"l, evt, data + %"PRIu32");\n",
+					ctx->prefix, value, field->data_offset);
+		}
+		fprintf(out, "\t\t\tbreak;\n");
+	}
+
+	fprintf(out, "\t\tdefault:\n"
+			"\t\t\terr = cyaml_gen_load_skip(l, evt);\n"
+			"\t\t\tbreak;\n"
+			"\t\t}\n"
+			"\t\tif (err != CYAML_OK) {\n"
+			"\t\t\treturn err;\n"
+			"\t\t}\n"
+			"\t}\n\n");
+
+	for (unsigned w = 0; w < (count + 63) / 64; w++) {
+		uint64_t required = 0;
+
+		for (unsigned i = w * 64; i < count && i < w * 64 + 64; i++) {
+			if (!(fields[i].value.flags & CYAML_FLAG_OPTIONAL)) {
+				required |= (uint64_t)1 << (i % 64);
+			}
+		}
+		if (required == 0) {
+			continue;
+		}
+		fprintf(out, "\tif ((seen[%u] & UINT64_C(0x%"PRIx64")) !=\n"
+				"\t\t\tUINT64_C(0x%"PRIx64")) {\n"
+				"\t\treturn CYAML_ERR_MAPPING_FIELD_MISSING;\n"
+				"\t}\n", w, required, required);
+	}
+	fprintf(out, "\treturn CYAML_OK;\n");
+}
+
+/**
+ * Write the body of a sequence node's load function.
+ *
+ * \param[in]  ctx  The code generation context.
+ * \param[in]  id   The node index.
+ */
+static void cyaml__gen_load_sequence_fn(
+		const cyaml_gen_ctx_t *ctx,
+		uint32_t id)
+{
+	const cyaml_schema_value_t *schema = ctx->nodes[id];
+	const cyaml_schema_value_t *entry = schema->sequence.entry;
+	bool pointer = schema->flags & CYAML_FLAG_POINTER;
+	bool growing = pointer && schema->type == CYAML_SEQUENCE;
+	uint32_t size = schema->data_size;
+	uint32_t min = schema->sequence.min;
+	uint32_t max = schema->sequence.max;
+	FILE *out = ctx->out;
+
+	if (pointer) {
+		fprintf(out, "\tuint8_t *p;\n");
+	}
+	if (growing) {
+		fprintf(out, "\tuint64_t capacity = 0;\n");
+	}
+	fprintf(out, "\tcyaml_err_t err;\n"
+			"\tuint64_t n = 0;\n\n"
+			"\tif (evt != CYAML_GEN_EVT_SEQ_START) {\n"
+			"\t\treturn CYAML_ERR_INVALID_VALUE;\n"
+			"\t}\n");
+	if (growing) {
+		fprintf(out, "\tp = cyaml_gen_data_read_pointer(data);\n");
+	} else if (pointer) {
+		char alloc[32];
+
+		snprintf(alloc, sizeof(alloc), "%"PRIu64,
+				(uint64_t)size * max);
+		cyaml__gen_load_alloc(out, alloc);
+	}
+
+	fprintf(out, "\n"
+			"\twhile (true) {\n"
+			"\t\terr = cyaml_gen_load_next(l, &evt);\n"
+			"\t\tif (err != CYAML_OK) {\n"
+			"\t\t\treturn err;\n"
+			"\t\t} else if (evt == CYAML_GEN_EVT_SEQ_END) {\n"
+			"\t\t\tbreak;\n"
+			"\t\t} else if (n == %"PRIu32") {\n"
+			"\t\t\treturn CYAML_ERR_SEQUENCE_ENTRIES_MAX;\n"
+			"\t\t}\n", max);
+	if (growing) {
+		fprintf(out, "\t\tif (n == capacity) {\n"
+				"\t\t\tuint64_t grow = %"PRIu32";\n"
+				"\t\t\tuint8_t *temp;\n\n"
+				"\t\t\tif (capacity != 0) {\n"
+				"\t\t\t\tgrow = (capacity <= %"PRIu32" / 2) ?\n"
+				"\t\t\t\t\t\tcapacity * 2 : %"PRIu32";\n"
+				"\t\t\t}\n"
+				"\t\t\tif (grow > %"PRIu32") {\n"
+				"\t\t\t\tgrow = %"PRIu32";\n"
+				"\t\t\t}\n"
+				"\t\t\ttemp = cyaml_gen_load_alloc(l, p,\n"
+				"\t\t\t\t\tcapacity * %"PRIu32
+				", grow * %"PRIu32");\n"
+				"\t\t\tif (temp == NULL) {\n"
+				"\t\t\t\treturn CYAML_ERR_OOM;\n"
+				"\t\t\t}\n"
+				"\t\t\tp = temp;\n"
+				"\t\t\tcyaml_gen_data_write_pointer(p, data);\n"
+				"\t\t\tcapacity = grow;\n"
+				"\t\t}\n",
+				(schema->seq_expected != 0) ?
+						schema->seq_expected : 1,
+				max, max, max, max, size, size);
+	}
+	fprintf(out, "\t\tn++;\n");
+	if (schema->type == CYAML_SEQUENCE) {
+		/* Counted as it goes, so a failed load can be freed. */
+		fprintf(out, "\t\t*count = n;\n");
+	}
+	fprintf(out, "\t\terr = %s__load_%"PRIu32"(l, evt, "
+			"%s + (n - 1) * %"PRIu32");\n"
+			"\t\tif (err != CYAML_OK) {\n"
+			"\t\t\treturn err;\n"
+			"\t\t}\n"
+			"\t}\n\n",
+			ctx->prefix, cyaml__gen_find(ctx, entry),
+			growing ? "p" : "data", size);
+
+	if (min > 0) {
+		fprintf(out, "\tif (n < %"PRIu32") {\n"
+				"\t\treturn CYAML_ERR_SEQUENCE_ENTRIES_MIN;\n"
+				"\t}\n", min);
+	}
+	if (growing) {
+		fprintf(out, "\tif (n < capacity && (cyaml_gen_load_config(l)"
+				"->flags &\n"
+				"\t\t\tCYAML_CFG_SHRINK_SEQUENCES)) {\n"
+				"\t\tuint8_t *temp = "
+				"cyaml_gen_load_alloc(l, p,\n"
+				"\t\t\t\tcapacity * %"PRIu32
+				", n * %"PRIu32");\n"
+				"\t\tif (temp != NULL) {\n"
+				"\t\t\tcyaml_gen_data_write_pointer("
+				"temp, data);\n"
+				"\t\t}\n"
+				"\t}\n", size, size);
+	}
+	fprintf(out, "\treturn CYAML_OK;\n");
+}
+
+/**
+ * Write a node's load function.
+ *
+ * \param[in]  ctx  The code generation context.
+ * \param[in]  id   The node index.
+ */
+static void cyaml__gen_load_fn(
+		const cyaml_gen_ctx_t *ctx,
+		uint32_t id)
+{
+	cyaml__gen_load_sig(ctx, id, false);
+	fprintf(ctx->out, "{\n");
+
+	switch (ctx->nodes[id]->type) {
+	case CYAML_FLAGS:
+		cyaml__gen_load_flags_fn(ctx, id);
+		break;
+	case CYAML_MAPPING:
+		cyaml__gen_load_mapping_fn(ctx, id);
+		break;
+	case CYAML_SEQUENCE: /* Fall through. */
+	case CYAML_SEQUENCE_FIXED:
+		cyaml__gen_load_sequence_fn(ctx, id);
+		break;
+	default:
+		cyaml__gen_load_scalar_fn(ctx, id);
+		break;
+	}
+
+	fprintf(ctx->out, "}\n\n");
+}
+
+/**
+ * Write the code to follow a node's pointer value, if it has one.
+ *
+ * \param[in]  out     File to write to.
+ * \param[in]  schema  The value schema.
+ */
+static void cyaml__gen_save_pointer(
+		FILE *out,
+		const cyaml_schema_value_t *schema)
+{
+	if (schema->flags & CYAML_FLAG_POINTER) {
+		fprintf(out, "\tp = cyaml_gen_data_read_pointer(data);\n"
+				"\tdata = p;\n");
+	}
+}
+
+/**
+ * Write the body of a scalar or flags node's save function.
+ *
+ * \param[in]  ctx  The code generation context.
+ * \param[in]  id   The node index.
+ */
+static void cyaml__gen_save_scalar_fn(
+		const cyaml_gen_ctx_t *ctx,
+		uint32_t id)
+{
+	const cyaml_schema_value_t *schema = ctx->nodes[id];
+	const cyaml_strval_t *strings = schema->enumeration.strings;
+	uint32_t size = schema->data_size;
+	FILE *out = ctx->out;
+
+	if (schema->flags & CYAML_FLAG_POINTER) {
+		fprintf(out, "\tconst uint8_t *p;\n");
+	}
+
+	switch (schema->type) {
+	case CYAML_INT:
+		fprintf(out, "\tchar buf[CYAML_GEN_NUMBER_BUF_SIZE];\n"
+				"\t%s v;\n\n", cyaml__gen_int_type(size));
+		cyaml__gen_save_pointer(out, schema);
+		fprintf(out, "\tv = (%s)(%s)cyaml_gen_data_read("
+				"sizeof(v), data);\n"
+				"\treturn cyaml_gen_save_scalar(s, buf,\n"
+				"\t\t\tcyaml_gen_format_int(v, buf));\n",
+				cyaml__gen_int_type(size),
+				cyaml__gen_uint_type(size));
+		break;
+	case CYAML_UINT:
+		fprintf(out, "\tchar buf[CYAML_GEN_NUMBER_BUF_SIZE];\n"
+				"\t%s v;\n\n", cyaml__gen_uint_type(size));
+		cyaml__gen_save_pointer(out, schema);
+		fprintf(out, "\tv = (%s)cyaml_gen_data_read("
+				"sizeof(v), data);\n"
+				"\treturn cyaml_gen_save_scalar(s, buf,\n"
+				"\t\t\tcyaml_gen_format_uint(v, buf));\n",
+				cyaml__gen_uint_type(size));
+		break;
+	case CYAML_BOOL:
+		fprintf(out, "\t%s v;\n\n", cyaml__gen_uint_type(size));
+		cyaml__gen_save_pointer(out, schema);
+		fprintf(out, "\tv = (%s)cyaml_gen_data_read("
+				"sizeof(v), data);\n"
+				"\treturn (v != 0) ?\n"
+				"\t\t\tcyaml_gen_save_scalar("
+				"s, \"true\", 4) :\n"
+				"\t\t\tcyaml_gen_save_scalar("
+				"s, \"false\", 5);\n",
+				cyaml__gen_uint_type(size));
+		break;
+	case CYAML_ENUM:
+		fprintf(out, "\tchar buf[CYAML_GEN_NUMBER_BUF_SIZE];\n"
+				"\tint64_t number;\n"
+				"\t%s v;\n\n", cyaml__gen_uint_type(size));
+		cyaml__gen_save_pointer(out, schema);
+		fprintf(out, "\tv = (%s)cyaml_gen_data_read("
+				"sizeof(v), data);\n"
+				"\tnumber = (int64_t)v;\n\n",
+				cyaml__gen_uint_type(size));
+		for (uint32_t i = 0; i < schema->enumeration.count; i++) {
+			size_t len;
+
+			fprintf(out, "\tif (number == ");
+			cyaml__gen_int64(out, strings[i].val);
+			fprintf(out, ") {\n"
+					"\t\treturn cyaml_gen_save_scalar(s, ");
+			len = cyaml__gen_literal(out, strings[i].str);
+			fprintf(out, ", %zu);\n"
+					"\t}\n", len);
+		}
+		if (schema->flags & CYAML_FLAG_STRICT) {
+			fprintf(out, "\n\t(void)buf;\n"
+					"\treturn CYAML_ERR_INVALID_VALUE;\n");
+		} else {
+			fprintf(out, "\n"
+					"\treturn cyaml_gen_save_scalar("
+					"s, buf,\n"
+					"\t\t\tcyaml_gen_format_int("
+					"(%s)v, buf));\n",
+					cyaml__gen_int_type(size));
+		}
+		break;
+	case CYAML_FLAGS:
+		fprintf(out, "\tuint64_t number;\n"
+				"\tcyaml_err_t err;\n"
+				"\t%s v;\n\n", cyaml__gen_uint_type(size));
+		cyaml__gen_save_pointer(out, schema);
+		fprintf(out, "\tv = (%s)cyaml_gen_data_read("
+				"sizeof(v), data);\n"
+				"\tnumber = v;\n\n"
+				"\terr = cyaml_gen_save_sequence_start(s, "
+				"CYAML_GEN_STYLE_BLOCK);\n"
+				"\tif (err != CYAML_OK) {\n"
+				"\t\treturn err;\n"
+				"\t}\n", cyaml__gen_uint_type(size));
+		for (uint32_t i = 0; i < schema->enumeration.count; i++) {
+			size_t len;
+
+			fprintf(out, "\tif (number & (uint64_t)");
+			cyaml__gen_int64(out, strings[i].val);
+			fprintf(out, ") {\n"
+					"\t\terr = cyaml_gen_save_scalar(s, ");
+			len = cyaml__gen_literal(out, strings[i].str);
+			fprintf(out, ", %zu);\n"
+					"\t\tif (err != CYAML_OK) {\n"
+					"\t\t\treturn err;\n"
+					"\t\t}\n"
+					"\t\tnumber &= ~(uint64_t)", len);
+			cyaml__gen_int64(out, strings[i].val);
+			fprintf(out, ";\n"
+					"\t}\n");
+		}
+		fprintf(out, "\tif (number != 0) {\n");
+		if (schema->flags & CYAML_FLAG_STRICT) {
+			fprintf(out, "\t\treturn CYAML_ERR_INVALID_VALUE;\n");
+		} else {
+			fprintf(out, "\t\tchar buf["
+					"CYAML_GEN_NUMBER_BUF_SIZE];\n"
+					"\t\terr = cyaml_gen_save_scalar("
+					"s, buf,\n"
+					"\t\t\t\tcyaml_gen_format_uint("
+					"number, buf));\n"
+					"\t\tif (err != CYAML_OK) {\n"
+					"\t\t\treturn err;\n"
+					"\t\t}\n");
+		}
+		fprintf(out, "\t}\n"
+				"\treturn cyaml_gen_save_sequence_end(s);\n");
+		break;
+	case CYAML_FLOAT:
+		fprintf(out, "\tchar buf[CYAML_GEN_NUMBER_BUF_SIZE];\n"
+				"\t%s v;\n\n", (size == sizeof(float)) ?
+				"float" : "double");
+		cyaml__gen_save_pointer(out, schema);
+		fprintf(out, "\tmemcpy(&v, data, sizeof(v));\n"
+				"\treturn cyaml_gen_save_scalar(s, buf,\n"
+				"\t\t\tcyaml_gen_format_%s(v, buf));\n",
+				(size == sizeof(float)) ? "float" : "double");
+		break;
+	case CYAML_STRING:
+		fprintf(out, "\n");
+		cyaml__gen_save_pointer(out, schema);
+		fprintf(out, "\treturn cyaml_gen_save_scalar(s, "
+				"(const char *)data,\n"
+				"\t\t\tstrlen((const char *)data));\n");
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * Write the body of a mapping node's save function.
+ *
+ * \param[in]  ctx  The code generation context.
+ * \param[in]  id   The node index.
+ */
+static void cyaml__gen_save_mapping_fn(
+		const cyaml_gen_ctx_t *ctx,
+		uint32_t id)
+{
+	const cyaml_schema_value_t *schema = ctx->nodes[id];
+	bool pointer = schema->flags & CYAML_FLAG_POINTER;
+	FILE *out = ctx->out;
+
+	for (const cyaml_schema_field_t *field = schema->mapping.fields;
+			field->key != NULL; field++) {
+		if ((field->value.flags & CYAML_FLAG_OPTIONAL) &&
+		    (field->value.flags & CYAML_FLAG_POINTER)) {
+			pointer = true;
+		}
+	}
+
+	if (pointer) {
+		fprintf(out, "\tconst uint8_t *p;\n");
+	}
+	fprintf(out, "\tcyaml_err_t err;\n\n");
+	cyaml__gen_save_pointer(out, schema);
+	fprintf(out, "\terr = cyaml_gen_save_mapping_start(s, %s);\n"
+			"\tif (err != CYAML_OK) {\n"
+			"\t\treturn err;\n"
+			"\t}\n", cyaml__gen_style(schema));
+
+	for (const cyaml_schema_field_t *field = schema->mapping.fields;
+			field->key != NULL; field++) {
+		uint32_t value = cyaml__gen_find(ctx, &field->value);
+		const char *tab = "\t";
+		size_t len;
+
+		if (field->value.type == CYAML_IGNORE) {
+			continue;
+		}
+
+		if ((field->value.flags & CYAML_FLAG_OPTIONAL) &&
+		    (field->value.flags & CYAML_FLAG_POINTER)) {
+			fprintf(out, "\tp = cyaml_gen_data_read_pointer("
+					"data + %"PRIu32");\n"
+					"\tif (p != NULL) {\n",
+					field->data_offset);
+			tab = "\t\t";
+		} else if (field->value.type == CYAML_SEQUENCE) {
+			fprintf(out, "\t{\n");
+			tab = "\t\t";
+		}
+
+		if (field->value.type == CYAML_SEQUENCE) {
+			cyaml__gen_read_count(out, field, tab);
+		}
+		fprintf(out, "%serr = cyaml_gen_save_scalar(s, ", tab);
+		len = cyaml__gen_literal(out, field->key);
+		fprintf(out, ", %zu);\n"
+				"%sif (err != CYAML_OK) {\n"
+				"%s\treturn err;\n"
+				"%s}\n"
+				"%serr = %s__save_%"PRIu32"(s, data + %"PRIu32
+				"%s);\n"
+				"%sif (err != CYAML_OK) {\n"
+				"%s\treturn err;\n"
+				"%s}\n",
+				len, tab, tab, tab,
+				tab, ctx->prefix, value, field->data_offset,
+				(field->value.type == CYAML_SEQUENCE) ?
+						", c" : "",
+				tab, tab, tab);
+		if (tab[1] != '\0') {
+			fprintf(out, "\t}\n");
+		}
+	}
+
+	fprintf(out, "\treturn cyaml_gen_save_mapping_end(s);\n");
+}
+
+/**
+ * Write the body of a sequence node's save function.
+ *
+ * \param[in]  ctx  The code generation context.
+ * \param[in]  id   The node index.
+ */
+static void cyaml__gen_save_sequence_fn(
+		const cyaml_gen_ctx_t *ctx,
+		uint32_t id)
+{
+	const cyaml_schema_value_t *schema = ctx->nodes[id];
+	const cyaml_schema_value_t *entry = schema->sequence.entry;
+	FILE *out = ctx->out;
+
+	if (schema->flags & CYAML_FLAG_POINTER) {
+		fprintf(out, "\tconst uint8_t *p;\n");
+	}
+	if (schema->type == CYAML_SEQUENCE_FIXED) {
+		fprintf(out, "\tuint64_t count = %"PRIu32";\n",
+				schema->sequence.max);
+	}
+	fprintf(out, "\tcyaml_err_t err;\n\n");
+	cyaml__gen_save_pointer(out, schema);
+	fprintf(out, "\terr = cyaml_gen_save_sequence_start(s, %s);\n"
+			"\tif (err != CYAML_OK) {\n"
+			"\t\treturn err;\n"
+			"\t}\n"
+			"\tfor (uint64_t i = 0; i < count; i++) {\n"
+			"\t\terr = %s__save_%"PRIu32"(s, "
+			"data + i * %"PRIu32");\n"
+			"\t\tif (err != CYAML_OK) {\n"
+			"\t\t\treturn err;\n"
+			"\t\t}\n"
+			"\t}\n"
+			"\treturn cyaml_gen_save_sequence_end(s);\n",
+			cyaml__gen_style(schema), ctx->prefix,
+			cyaml__gen_find(ctx, entry), schema->data_size);
+}
+
+/**
+ * Write a node's save function.
+ *
+ * \param[in]  ctx  The code generation context.
+ * \param[in]  id   The node index.
+ */
+static void cyaml__gen_save_fn(
+		const cyaml_gen_ctx_t *ctx,
+		uint32_t id)
+{
+	cyaml__gen_save_sig(ctx, id, false);
+	fprintf(ctx->out, "{\n");
+
+	switch (ctx->nodes[id]->type) {
+	case CYAML_MAPPING:
+		cyaml__gen_save_mapping_fn(ctx, id);
+		break;
+	case CYAML_SEQUENCE: /* Fall through. */
+	case CYAML_SEQUENCE_FIXED:
+		cyaml__gen_save_sequence_fn(ctx, id);
+		break;
+	default:
+		cyaml__gen_save_scalar_fn(ctx, id);
+		break;
+	}
+
+	fprintf(ctx->out, "}\n\n");
+}
+
+/**
+ * Write a node's free function.
+ *
+ * Only nodes that \ref cyaml__gen_owns allocations have free functions.
+ *
+ * \param[in]  ctx  The code generation context.
+ * \param[in]  id   The node index.
+ */
+static void cyaml__gen_free_fn(
+		const cyaml_gen_ctx_t *ctx,
+		uint32_t id)
+{
+	const cyaml_schema_value_t *schema = ctx->nodes[id];
+	bool pointer = schema->flags & CYAML_FLAG_POINTER;
+	FILE *out = ctx->out;
+
+	cyaml__gen_free_sig(ctx, id, false);
+	fprintf(out, "{\n");
+
+	if (pointer) {
+		fprintf(out, "\tuint8_t *p;\n\n"
+				"\tp = cyaml_gen_data_read_pointer(data);\n"
+				"\tif (p == NULL) {\n"
+				"\t\treturn;\n"
+				"\t}\n");
+		if (cyaml_schema_has_pointers(schema)) {
+			fprintf(out, "\tdata = p;\n");
+		}
+	}
+
+	switch (schema->type) {
+	case CYAML_MAPPING:
+		for (const cyaml_schema_field_t *field =
+				schema->mapping.fields;
+				field->key != NULL; field++) {
+			uint32_t value;
+
+			if (field->value.type == CYAML_IGNORE ||
+			    !cyaml__gen_owns(&field->value)) {
+				continue;
+			}
+			value = cyaml__gen_find(ctx, &field->value);
+			if (field->value.type == CYAML_SEQUENCE) {
+				fprintf(out, "\t{\n");
+				cyaml__gen_read_count(out, field, "\t\t");
+				fprintf(out, "\t\t%s__free_%"PRIu32"(config, "
+						"data + %"PRIu32", c);\n"
+						"\t}\n", ctx->prefix, value,
+						field->data_offset);
+			} else {
+				fprintf(out, "\t%s__free_%"PRIu32"(config, "
+						"data + %"PRIu32");\n",
+						ctx->prefix, value,
+						field->data_offset);
+			}
+		}
+		break;
+	case CYAML_SEQUENCE: /* Fall through. */
+	case CYAML_SEQUENCE_FIXED:
+		if (!cyaml__gen_owns(schema->sequence.entry)) {
+			if (schema->type == CYAML_SEQUENCE) {
+				fprintf(out, "\t(void)count;\n");
+			}
+			break;
+		} else if (schema->type == CYAML_SEQUENCE_FIXED) {
+			fprintf(out, "\tuint64_t count = %"PRIu32";\n\n",
+					schema->sequence.max);
+		}
+		fprintf(out, "\tfor (uint64_t i = 0; i < count; i++) {\n"
+				"\t\t%s__free_%"PRIu32"(config, "
+				"data + i * %"PRIu32");\n"
+				"\t}\n", ctx->prefix,
+				cyaml__gen_find(ctx, schema->sequence.entry),
+				schema->data_size);
+		break;
+	default:
+		break;
+	}
+
+	if (pointer) {
+		fprintf(out, "\tcyaml_gen_free(config, p);\n");
+	}
+	fprintf(out, "}\n\n");
+}
+
+/**
+ * Write the generated header.
+ *
+ * \param[in]  ctx     The code generation context.
+ * \param[in]  header  File to write the header to.
+ */
+static void cyaml__gen_header(
+		const cyaml_gen_ctx_t *ctx,
+		FILE *header)
+{
+	bool counted = cyaml__gen_counted(ctx->nodes[0]);
+	const char *prefix = ctx->prefix;
+
+	fprintf(header, "/*\n"
+			" * Generated by cyaml_gen_write.  Do not edit.\n"
+			" */\n\n"
+			"#ifndef ");
+	for (const char *c = prefix; *c != '\0'; c++) {
+		fputc((*c >= 'a' && *c <= 'z') ? *c - 'a' + 'A' : *c, header);
+	}
+	fprintf(header, "_GEN_H\n#define ");
+	for (const char *c = prefix; *c != '\0'; c++) {
+		fputc((*c >= 'a' && *c <= 'z') ? *c - 'a' + 'A' : *c, header);
+	}
+	fprintf(header, "_GEN_H\n\n"
+			"#include <cyaml/cyaml.h>\n\n"
+			"/** Specialised \\ref cyaml_load_data. */\n"
+			"cyaml_err_t %s_load_data(\n"
+			"\t\tconst uint8_t *input,\n"
+			"\t\tsize_t input_len,\n"
+			"\t\tconst cyaml_config_t *config,\n"
+			"\t\tcyaml_data_t **data_out%s);\n\n"
+			"/** Specialised \\ref cyaml_save_data. */\n"
+			"cyaml_err_t %s_save_data(\n"
+			"\t\tchar **output,\n"
+			"\t\tsize_t *len,\n"
+			"\t\tconst cyaml_config_t *config,\n"
+			"\t\tconst cyaml_data_t *data%s);\n\n"
+			"/** Specialised \\ref cyaml_free. */\n"
+			"cyaml_err_t %s_free(\n"
+			"\t\tconst cyaml_config_t *config,\n"
+			"\t\tcyaml_data_t *data%s);\n\n"
+			"#endif\n",
+			prefix, counted ? ",\n\t\tunsigned *seq_count_out" : "",
+			prefix, counted ? ",\n\t\tunsigned seq_count" : "",
+			prefix, counted ? ",\n\t\tunsigned seq_count" : "");
+}
+
+/**
+ * Write the code to hand a call on to the interpreter, if possible.
+ *
+ * \param[in]  ctx     The code generation context.
+ * \param[in]  schema  C expression for the schema, or NULL.
+ * \param[in]  call    Format for the interpreter call, taking the schema.
+ */
+static void cyaml__gen_fallback(
+		const cyaml_gen_ctx_t *ctx,
+		const char *schema,
+		const char *call)
+{
+	FILE *out = ctx->out;
+
+	if (schema == NULL) {
+		fprintf(out, "\tif (err != CYAML_OK) {\n"
+				"\t\treturn err;\n"
+				"\t}\n");
+		return;
+	}
+
+	fprintf(out, "\tif (err == CYAML_ERR_NOT_SUPPORTED) {\n"
+			"\t\treturn ");
+	fprintf(out, call, schema);
+	fprintf(out, ";\n"
+			"\t} else if (err != CYAML_OK) {\n"
+			"\t\treturn err;\n"
+			"\t}\n");
+}
+
+/**
+ * Write the generated entry points.
+ *
+ * \param[in]  ctx     The code generation context.
+ * \param[in]  schema  C expression for the schema, or NULL.
+ */
+static void cyaml__gen_entry_points(
+		const cyaml_gen_ctx_t *ctx,
+		const char *schema)
+{
+	bool counted = cyaml__gen_counted(ctx->nodes[0]);
+	const char *prefix = ctx->prefix;
+	FILE *out = ctx->out;
+
+	/* Loading. */
+	fprintf(out, "/* Exported function, documented in generated header */\n"
+			"cyaml_err_t %s_load_data(\n"
+			"\t\tconst uint8_t *input,\n"
+			"\t\tsize_t input_len,\n"
+			"\t\tconst cyaml_config_t *config,\n"
+			"\t\tcyaml_data_t **data_out%s)\n"
+			"{\n"
+			"\tcyaml_gen_event_t evt;\n"
+			"\tcyaml_gen_load_t *l;\n"
+			"\tuint8_t *data = NULL;\n"
+			"%s"
+			"\tcyaml_err_t err;\n\n"
+			"\terr = cyaml_gen_check_config("
+			"config, CYAML_GEN_OP_LOAD);\n",
+			prefix, counted ? ",\n\t\tunsigned *seq_count_out" : "",
+			counted ? "\tuint64_t count = 0;\n" : "");
+	cyaml__gen_fallback(ctx, schema, counted ?
+			"cyaml_load_data(input, input_len, config,\n"
+			"\t\t\t\t%s, data_out, seq_count_out)" :
+			"cyaml_load_data(input, input_len, config,\n"
+			"\t\t\t\t%s, data_out, NULL)");
+	if (counted) {
+		fprintf(out, "\tif (seq_count_out == NULL) {\n"
+				"\t\treturn CYAML_ERR_BAD_PARAM_SEQ_COUNT;\n"
+				"\t}\n");
+	}
+	fprintf(out, "\tif (data_out == NULL) {\n"
+			"\t\treturn CYAML_ERR_BAD_PARAM_NULL_DATA;\n"
+			"\t}\n\n"
+			"\terr = cyaml_gen_load_start("
+			"config, input, input_len, &l);\n"
+			"\tif (err != CYAML_OK) {\n"
+			"\t\treturn err;\n"
+			"\t}\n"
+			"\terr = cyaml_gen_load_document(l, &evt);\n"
+			"\tif (err == CYAML_OK && "
+			"evt != CYAML_GEN_EVT_NONE) {\n"
+			"\t\terr = %s__load_0(l, evt, (uint8_t *)&data%s);\n"
+			"\t\tif (err == CYAML_OK) {\n"
+			"\t\t\terr = cyaml_gen_load_finish(l);\n"
+			"\t\t}\n"
+			"\t}\n"
+			"\tcyaml_gen_load_destroy(l);\n\n"
+			"\tif (err != CYAML_OK) {\n"
+			"\t\t%s__free_0(config, (uint8_t *)&data%s);\n"
+			"\t\treturn err;\n"
+			"\t}\n\n"
+			"\t*data_out = data;\n"
+			"%s"
+			"\treturn CYAML_OK;\n"
+			"}\n\n",
+			prefix, counted ? ", &count" : "",
+			prefix, counted ? ", count" : "",
+			counted ? "\t*seq_count_out = (unsigned)count;\n" : "");
+
+	/* Saving. */
+	fprintf(out, "/* Exported function, documented in generated header */\n"
+			"cyaml_err_t %s_save_data(\n"
+			"\t\tchar **output,\n"
+			"\t\tsize_t *len,\n"
+			"\t\tconst cyaml_config_t *config,\n"
+			"\t\tconst cyaml_data_t *data%s)\n"
+			"{\n"
+			"\tcyaml_gen_save_t *s;\n"
+			"\tcyaml_err_t err;\n\n"
+			"\terr = cyaml_gen_check_config("
+			"config, CYAML_GEN_OP_SAVE);\n",
+			prefix, counted ? ",\n\t\tunsigned seq_count" : "");
+	cyaml__gen_fallback(ctx, schema, counted ?
+			"cyaml_save_data(output, len, config,\n"
+			"\t\t\t\t%s, data, seq_count)" :
+			"cyaml_save_data(output, len, config,\n"
+			"\t\t\t\t%s, data, 0)");
+	if (counted) {
+		fprintf(out, "\tif (seq_count == 0) {\n"
+				"\t\treturn CYAML_ERR_BAD_PARAM_SEQ_COUNT;\n"
+				"\t}\n");
+	}
+	fprintf(out, "\tif (data == NULL || output == NULL || len == NULL) {\n"
+			"\t\treturn CYAML_ERR_BAD_PARAM_NULL_DATA;\n"
+			"\t}\n\n"
+			"\terr = cyaml_gen_save_start(config, &s);\n"
+			"\tif (err != CYAML_OK) {\n"
+			"\t\treturn err;\n"
+			"\t}\n"
+			"\terr = %s__save_0(s, (const uint8_t *)&data%s);\n"
+			"\tif (err == CYAML_OK) {\n"
+			"\t\terr = cyaml_gen_save_finish(s, output, len);\n"
+			"\t}\n"
+			"\tcyaml_gen_save_destroy(s);\n\n"
+			"\treturn err;\n"
+			"}\n\n",
+			prefix, counted ? ", seq_count" : "");
+
+	/* Freeing. */
+	fprintf(out, "/* Exported function, documented in generated header */\n"
+			"cyaml_err_t %s_free(\n"
+			"\t\tconst cyaml_config_t *config,\n"
+			"\t\tcyaml_data_t *data%s)\n"
+			"{\n"
+			"\tcyaml_err_t err;\n\n"
+			"\terr = cyaml_gen_check_config("
+			"config, CYAML_GEN_OP_FREE);\n",
+			prefix, counted ? ",\n\t\tunsigned seq_count" : "");
+	cyaml__gen_fallback(ctx, schema, counted ?
+			"cyaml_free(config, %s, data, seq_count)" :
+			"cyaml_free(config, %s, data, 0)");
+	fprintf(out, "\n"
+			"\t%s__free_0(config, (uint8_t *)&data%s);\n"
+			"\treturn CYAML_OK;\n"
+			"}\n",
+			prefix, counted ? ", seq_count" : "");
+}
+
+/**
+ * Write the generated source.
+ *
+ * \param[in]  ctx      The code generation context.
+ * \param[in]  options  Options for the generated code.
+ */
+static void cyaml__gen_source(
+		const cyaml_gen_ctx_t *ctx,
+		const cyaml_gen_options_t *options)
+{
+	FILE *out = ctx->out;
+
+	fprintf(out, "/*\n"
+			" * Generated by cyaml_gen_write.  Do not edit.\n"
+			" */\n\n"
+			"#include <stdbool.h>\n"
+			"#include <stdint.h>\n"
+			"#include <string.h>\n\n"
+			"#include <cyaml/cyaml.h>\n"
+			"#include <cyaml/gen.h>\n");
+	if (options->includes != NULL && options->includes[0] != NULL) {
+		fprintf(out, "\n");
+		for (const char * const *inc = options->includes;
+				*inc != NULL; inc++) {
+			fprintf(out, "#include \"%s\"\n", *inc);
+		}
+	}
+	fprintf(out, "\n");
+
+	for (uint32_t id = 0; id < ctx->count; id++) {
+		cyaml__gen_load_sig(ctx, id, true);
+		cyaml__gen_save_sig(ctx, id, true);
+		if (cyaml__gen_owns(ctx->nodes[id])) {
+			cyaml__gen_free_sig(ctx, id, true);
+		}
+	}
+
+	for (uint32_t id = 0; id < ctx->count; id++) {
+		switch (ctx->nodes[id]->type) {
+		case CYAML_ENUM: /* Fall through. */
+		case CYAML_FLAGS:
+			cyaml__gen_strval_fn(ctx, id);
+			break;
+		case CYAML_MAPPING:
+			cyaml__gen_key_fn(ctx, id);
+			break;
+		default:
+			break;
+		}
+		cyaml__gen_load_fn(ctx, id);
+		cyaml__gen_save_fn(ctx, id);
+		if (cyaml__gen_owns(ctx->nodes[id])) {
+			cyaml__gen_free_fn(ctx, id);
+		}
+	}
+
+	cyaml__gen_entry_points(ctx, options->schema);
+}
+
+/**
+ * Check that a generated name prefix is a valid C identifier.
+ *
+ * \param[in]  prefix  The prefix to check.
+ * \return true if prefix is valid, false otherwise.
+ */
+static bool cyaml__gen_valid_prefix(
+		const char *prefix)
+{
+	if (prefix == NULL || prefix[0] == '\0' ||
+	    (prefix[0] >= '0' && prefix[0] <= '9')) {
+		return false;
+	}
+
+	for (const char *c = prefix; *c != '\0'; c++) {
+		if (!((*c >= 'a' && *c <= 'z') ||
+		      (*c >= 'A' && *c <= 'Z') ||
+		      (*c >= '0' && *c <= '9') || *c == '_')) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/* Exported function, documented in src/gen.h */
+cyaml_err_t cyaml_gen_write(
+		FILE *source,
+		FILE *header,
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		const cyaml_gen_options_t *options)
+{
+	cyaml_gen_ctx_t ctx;
+	cyaml_err_t err;
+
+	if (config == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_CONFIG;
+	}
+	if (config->mem_fn == NULL) {
+		return CYAML_ERR_BAD_CONFIG_NULL_MEMFN;
+	}
+	if (schema == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_SCHEMA;
+	}
+	if (!(schema->flags & CYAML_FLAG_POINTER)) {
+		return CYAML_ERR_TOP_LEVEL_NON_PTR;
+	}
+	if (source == NULL || header == NULL || options == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_DATA;
+	}
+	if (!cyaml__gen_valid_prefix(options->prefix)) {
+		cyaml__log(config, CYAML_LOG_ERROR,
+				"Invalid prefix for generated names\n");
+		return CYAML_ERR_BAD_PARAM_NULL_DATA;
+	}
+
+	ctx = (cyaml_gen_ctx_t) {
+		.config = config,
+		.prefix = options->prefix,
+		.out = source,
+	};
+
+	err = cyaml__gen_add(&ctx, schema);
+	if (err == CYAML_OK) {
+		cyaml__gen_source(&ctx, options);
+		cyaml__gen_header(&ctx, header);
+		if (ferror(source) || ferror(header)) {
+			err = CYAML_ERR_FILE_WRITE;
+		}
+	}
+
+	cyaml__free(config, ctx.nodes);
+	return err;
+}
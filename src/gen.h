@@ -0,0 +1,81 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (C) 2019 Michael Drake <tlsa@netsurf-browser.org>
+ */
+
+/**
+ * \file
+ * \brief CYAML schema code generation.
+ *
+ * The code generator writes C source for load, save and free functions
+ * specialised for one schema; see include/cyaml/gen.h for what the
+ * generated code does.  It is not part of the library: it is only built
+ * into the `cyaml-gen` tool and the tests.
+ */
+
+#ifndef CYAML_GEN_WRITE_H
+#define CYAML_GEN_WRITE_H
+
+#include <stdio.h>
+
+#include "cyaml/cyaml.h"
+
+/**
+ * Options for \ref cyaml_gen_write.
+ */
+typedef struct cyaml_gen_options {
+	/**
+	 * Prefix for the generated functions' names.
+	 *
+	 * This must be a valid C identifier.  The generated functions are
+	 * `<prefix>_load_data`, `<prefix>_save_data` and `<prefix>_free`.
+	 */
+	const char *prefix;
+	/**
+	 * C expression for a pointer to the schema, or NULL.
+	 *
+	 * If set, generated functions fall back to the LibCYAML interpreter
+	 * with this schema for configs they don't handle.  For example,
+	 * `"&config_schema"`.
+	 */
+	const char *schema;
+	/**
+	 * NULL terminated array of headers for the generated source to
+	 * include, or NULL.
+	 *
+	 * This should list the headers that declare anything \ref schema
+	 * refers to, along with the header written by \ref cyaml_gen_write.
+	 */
+	const char * const *includes;
+} cyaml_gen_options_t;
+
+/**
+ * Generate specialised load, save and free functions for a schema.
+ *
+ * The generated source and header are written to the given files.  The
+ * schema must be the top level value schema that would be passed to \ref
+ * cyaml_load_data; it is rejected with the error that loading would give
+ * if it is invalid.
+ *
+ * Schemas using \ref CYAML_FLAG_CASE_INSENSITIVE, or integer types with
+ * sizes other than 1, 2, 4 or 8 bytes, are rejected with \ref
+ * CYAML_ERR_NOT_SUPPORTED.  Such a schema can still be used with the
+ * interpreter.
+ *
+ * \param[in]  source   File to write the generated C source to.
+ * \param[in]  header   File to write the generated C header to.
+ * \param[in]  config   Client's CYAML configuration structure, used for
+ *                      logging.
+ * \param[in]  schema   CYAML schema to generate code for.
+ * \param[in]  options  Options for the generated code.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+extern cyaml_err_t cyaml_gen_write(
+		FILE *source,
+		FILE *header,
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		const cyaml_gen_options_t *options);
+
+#endif
@@ -0,0 +1,680 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (C) 2019 Michael Drake <tlsa@netsurf-browser.org>
+ */
+
+/**
+ * \file
+ * \brief Run time for generated schema code.
+ *
+ * Code written by \ref cyaml_gen_write does its own schema handling, and
+ * uses these functions for everything else: parsing and emitting YAML,
+ * allocation, and number conversion.  They're kept small, so that the per
+ * value work is all in the generated code.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <yaml.h>
+
+#include "cyaml/gen.h"
+
+#include "mem.h"
+#include "emit.h"
+#include "util.h"
+#include "number.h"
+
+/** Minimum allocation size for generated code's save output buffers. */
+#define CYAML_GEN_BUFFER_SIZE_MIN 256
+
+/**
+ * Generated code loading context.
+ */
+struct cyaml_gen_load {
+	const cyaml_config_t *config; /**< Client's CYAML configuration. */
+	yaml_parser_t parser;         /**< The `libyaml` parser. */
+	yaml_event_t event;           /**< The current event. */
+	bool have_event;              /**< Whether event needs deleting. */
+};
+
+/**
+ * Generated code saving context.
+ */
+struct cyaml_gen_save {
+	const cyaml_config_t *config; /**< Client's CYAML configuration. */
+	char *data;      /**< Current allocation for serialised output. */
+	size_t len;      /**< Current length of `data` allocation. */
+	size_t used;     /**< Current number of bytes used in `data`. */
+	cyaml_err_t err; /**< Any error encountered in buffer handling. */
+	cyaml_emit_t emit; /**< The native emitter. */
+};
+
+/**
+ * Check the parts of a client config that every operation needs.
+ *
+ * \param[in]  config  Client's CYAML configuration structure.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static inline cyaml_err_t cyaml__gen_valid_config(
+		const cyaml_config_t *config)
+{
+	if (config == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_CONFIG;
+	}
+	if (config->mem_fn == NULL) {
+		return CYAML_ERR_BAD_CONFIG_NULL_MEMFN;
+	}
+	return CYAML_OK;
+}
+
+/* Exported function, documented in include/cyaml/gen.h */
+cyaml_err_t cyaml_gen_check_config(
+		const cyaml_config_t *config,
+		cyaml_gen_op_t op)
+{
+	static const cyaml_limits_t no_limits;
+	cyaml_err_t err;
+
+	err = cyaml__gen_valid_config(config);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	switch (op) {
+	case CYAML_GEN_OP_LOAD:
+		if ((config->flags & (CYAML_CFG_ARENA |
+				CYAML_CFG_PROJECTION |
+				CYAML_CFG_CASE_INSENSITIVE)) ||
+		    config->entry_fn != NULL ||
+		    config->stats != NULL ||
+		    memcmp(&config->limits, &no_limits,
+				sizeof(no_limits)) != 0) {
+			return CYAML_ERR_NOT_SUPPORTED;
+		}
+		break;
+	case CYAML_GEN_OP_SAVE:
+		if ((config->flags & CYAML_CFG_ALIASES) ||
+		    config->stats != NULL) {
+			return CYAML_ERR_NOT_SUPPORTED;
+		}
+		break;
+	case CYAML_GEN_OP_FREE:
+		if (config->flags & CYAML_CFG_ARENA) {
+			return CYAML_ERR_NOT_SUPPORTED;
+		}
+		break;
+	default:
+		return CYAML_ERR_INTERNAL_ERROR;
+	}
+
+	return CYAML_OK;
+}
+
+/* Exported function, documented in include/cyaml/gen.h */
+cyaml_err_t cyaml_gen_load_start(
+		const cyaml_config_t *config,
+		const uint8_t *input,
+		size_t input_len,
+		cyaml_gen_load_t **load_out)
+{
+	cyaml_gen_load_t *load;
+	cyaml_err_t err;
+
+	err = cyaml__gen_valid_config(config);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	load = cyaml__alloc(config, sizeof(*load), true);
+	if (load == NULL) {
+		return CYAML_ERR_OOM;
+	}
+
+	if (!yaml_parser_initialize(&load->parser)) {
+		cyaml__free(config, load);
+		return CYAML_ERR_LIBYAML_PARSER_INIT;
+	}
+	yaml_parser_set_input_string(&load->parser, input, input_len);
+	load->config = config;
+
+	*load_out = load;
+	return CYAML_OK;
+}
+
+/**
+ * Get the next `libyaml` event, replacing the current one.
+ *
+ * \param[in]  load      The loading context.
+ * \param[out] type_out  Returns the new event's type.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__gen_parse(
+		cyaml_gen_load_t *load,
+		yaml_event_type_t *type_out)
+{
+	if (load->have_event) {
+		yaml_event_delete(&load->event);
+		load->have_event = false;
+	}
+
+	if (!yaml_parser_parse(&load->parser, &load->event)) {
+		cyaml__log(load->config, CYAML_LOG_ERROR,
+				"libyaml: %s\n", load->parser.problem);
+		return CYAML_ERR_LIBYAML_PARSER;
+	}
+	load->have_event = true;
+
+	*type_out = load->event.type;
+	return CYAML_OK;
+}
+
+/**
+ * Get the next `libyaml` event, and check its type.
+ *
+ * \param[in]  load  The loading context.
+ * \param[in]  type  The event type expected.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__gen_expect(
+		cyaml_gen_load_t *load,
+		yaml_event_type_t type)
+{
+	yaml_event_type_t got;
+	cyaml_err_t err;
+
+	err = cyaml__gen_parse(load, &got);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	return (got == type) ? CYAML_OK : CYAML_ERR_UNEXPECTED_EVENT;
+}
+
+/* Exported function, documented in include/cyaml/gen.h */
+cyaml_err_t cyaml_gen_load_next(
+		cyaml_gen_load_t *load,
+		cyaml_gen_event_t *event_out)
+{
+	yaml_event_type_t type;
+	cyaml_err_t err;
+
+	err = cyaml__gen_parse(load, &type);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	switch (type) {
+	case YAML_SCALAR_EVENT:
+		*event_out = CYAML_GEN_EVT_SCALAR;
+		break;
+	case YAML_SEQUENCE_START_EVENT:
+		*event_out = CYAML_GEN_EVT_SEQ_START;
+		break;
+	case YAML_SEQUENCE_END_EVENT:
+		*event_out = CYAML_GEN_EVT_SEQ_END;
+		break;
+	case YAML_MAPPING_START_EVENT:
+		*event_out = CYAML_GEN_EVT_MAP_START;
+		break;
+	case YAML_MAPPING_END_EVENT:
+		*event_out = CYAML_GEN_EVT_MAP_END;
+		break;
+	case YAML_ALIAS_EVENT:
+		return CYAML_ERR_ALIAS;
+	default:
+		return CYAML_ERR_UNEXPECTED_EVENT;
+	}
+
+	return CYAML_OK;
+}
+
+/* Exported function, documented in include/cyaml/gen.h */
+cyaml_err_t cyaml_gen_load_document(
+		cyaml_gen_load_t *load,
+		cyaml_gen_event_t *event_out)
+{
+	yaml_event_type_t type;
+	cyaml_err_t err;
+
+	err = cyaml__gen_expect(load, YAML_STREAM_START_EVENT);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	err = cyaml__gen_parse(load, &type);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	switch (type) {
+	case YAML_STREAM_END_EVENT:
+		*event_out = CYAML_GEN_EVT_NONE;
+		return CYAML_OK;
+	case YAML_DOCUMENT_START_EVENT:
+		return cyaml_gen_load_next(load, event_out);
+	default:
+		return CYAML_ERR_UNEXPECTED_EVENT;
+	}
+}
+
+/* Exported function, documented in include/cyaml/gen.h */
+const char * cyaml_gen_load_scalar(
+		const cyaml_gen_load_t *load,
+		size_t *len_out)
+{
+	*len_out = load->event.data.scalar.length;
+	return (const char *)load->event.data.scalar.value;
+}
+
+/* Exported function, documented in include/cyaml/gen.h */
+cyaml_err_t cyaml_gen_load_skip(
+		cyaml_gen_load_t *load,
+		cyaml_gen_event_t event)
+{
+	uint32_t depth = 0;
+	cyaml_err_t err;
+
+	do {
+		switch (event) {
+		case CYAML_GEN_EVT_MAP_START: /* Fall through. */
+		case CYAML_GEN_EVT_SEQ_START:
+			depth++;
+			break;
+		case CYAML_GEN_EVT_MAP_END: /* Fall through. */
+		case CYAML_GEN_EVT_SEQ_END:
+			if (depth == 0) {
+				return CYAML_ERR_UNEXPECTED_EVENT;
+			}
+			depth--;
+			break;
+		default:
+			break;
+		}
+
+		if (depth == 0) {
+			break;
+		}
+
+		err = cyaml_gen_load_next(load, &event);
+		if (err != CYAML_OK) {
+			return err;
+		}
+	} while (true);
+
+	return CYAML_OK;
+}
+
+/* Exported function, documented in include/cyaml/gen.h */
+cyaml_err_t cyaml_gen_load_finish(
+		cyaml_gen_load_t *load)
+{
+	yaml_event_type_t type;
+	cyaml_err_t err;
+
+	err = cyaml__gen_expect(load, YAML_DOCUMENT_END_EVENT);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	err = cyaml__gen_parse(load, &type);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	if (type == YAML_DOCUMENT_START_EVENT) {
+		cyaml__log(load->config, CYAML_LOG_WARNING,
+				"Ignoring documents after first in stream\n");
+		return CYAML_OK;
+	}
+
+	return (type == YAML_STREAM_END_EVENT) ?
+			CYAML_OK : CYAML_ERR_UNEXPECTED_EVENT;
+}
+
+/* Exported function, documented in include/cyaml/gen.h */
+const cyaml_config_t * cyaml_gen_load_config(
+		const cyaml_gen_load_t *load)
+{
+	return load->config;
+}
+
+/* Exported function, documented in include/cyaml/gen.h */
+void * cyaml_gen_load_alloc(
+		cyaml_gen_load_t *load,
+		void *ptr,
+		size_t old_size,
+		size_t new_size)
+{
+	return cyaml__realloc(load->config, ptr, old_size, new_size, true);
+}
+
+/* Exported function, documented in include/cyaml/gen.h */
+void cyaml_gen_load_destroy(
+		cyaml_gen_load_t *load)
+{
+	if (load != NULL) {
+		if (load->have_event) {
+			yaml_event_delete(&load->event);
+		}
+		yaml_parser_delete(&load->parser);
+		cyaml__free(load->config, load);
+	}
+}
+
+/* Exported function, documented in include/cyaml/gen.h */
+void cyaml_gen_free(
+		const cyaml_config_t *config,
+		void *ptr)
+{
+	cyaml__free(config, ptr);
+}
+
+/* Exported function, documented in include/cyaml/gen.h */
+bool cyaml_gen_parse_int(
+		const char *value,
+		size_t len,
+		int64_t *value_out)
+{
+	return cyaml_number_parse_int(value, len, value_out);
+}
+
+/* Exported function, documented in include/cyaml/gen.h */
+bool cyaml_gen_parse_uint(
+		const char *value,
+		size_t len,
+		uint64_t *value_out)
+{
+	return cyaml_number_parse_uint(value, len, value_out);
+}
+
+/* Exported function, documented in include/cyaml/gen.h */
+bool cyaml_gen_parse_float(
+		const char *value,
+		size_t len,
+		float *value_out)
+{
+	return cyaml_number_parse_float(value, len, value_out);
+}
+
+/* Exported function, documented in include/cyaml/gen.h */
+bool cyaml_gen_parse_double(
+		const char *value,
+		size_t len,
+		double *value_out)
+{
+	return cyaml_number_parse_double(value, len, value_out);
+}
+
+/* Exported function, documented in include/cyaml/gen.h */
+bool cyaml_gen_parse_bool(
+		const char *value,
+		size_t len)
+{
+	return cyaml__parse_bool(value, len);
+}
+
+/* Exported function, documented in include/cyaml/gen.h */
+size_t cyaml_gen_format_int(
+		int64_t value,
+		char *buf)
+{
+	cyaml_static_assert(CYAML_GEN_NUMBER_BUF_SIZE ==
+			CYAML_NUMBER_BUF_SIZE);
+
+	return cyaml_number_format_int(value, buf);
+}
+
+/* Exported function, documented in include/cyaml/gen.h */
+size_t cyaml_gen_format_uint(
+		uint64_t value,
+		char *buf)
+{
+	return cyaml_number_format_uint(value, buf);
+}
+
+/* Exported function, documented in include/cyaml/gen.h */
+size_t cyaml_gen_format_float(
+		float value,
+		char *buf)
+{
+	return cyaml_number_format_float(value, buf);
+}
+
+/* Exported function, documented in include/cyaml/gen.h */
+size_t cyaml_gen_format_double(
+		double value,
+		char *buf)
+{
+	return cyaml_number_format_double(value, buf);
+}
+
+/**
+ * Write handler for the native emitter.
+ *
+ * The output buffer grows geometrically, as for \ref cyaml_save_data.
+ *
+ * \param[in]  data    The generated code saving context.
+ * \param[in]  buffer  The buffer with bytes to be written.
+ * \param[in]  size    The number of bytes to be written.
+ * \return 1 on sucess, 0 otherwise.
+ */
+static int cyaml__gen_write_handler(
+		void *data,
+		unsigned char *buffer,
+		size_t size)
+{
+	cyaml_gen_save_t *save = data;
+	enum {
+		RETURN_SUCCESS = 1,
+		RETURN_FAILURE = 0,
+	};
+
+	if (size > save->len - save->used) {
+		size_t len = save->len;
+		char *temp;
+
+		if (size > SIZE_MAX - save->used) {
+			save->err = CYAML_ERR_OOM;
+			return RETURN_FAILURE;
+		}
+
+		if (len < CYAML_GEN_BUFFER_SIZE_MIN) {
+			len = CYAML_GEN_BUFFER_SIZE_MIN;
+		}
+		while (len < save->used + size) {
+			len = (len > SIZE_MAX / 2) ?
+					save->used + size : len * 2;
+		}
+
+		temp = cyaml__realloc(save->config, save->data,
+				save->len, len, false);
+		if (temp == NULL) {
+			save->err = CYAML_ERR_OOM;
+			return RETURN_FAILURE;
+		}
+
+		save->data = temp;
+		save->len = len;
+	}
+
+	memcpy(save->data + save->used, buffer, size);
+	save->used += size;
+
+	return RETURN_SUCCESS;
+}
+
+/**
+ * Prefer any error from the output handler to the emitter's error.
+ *
+ * \param[in]  save  The saving context.
+ * \param[in]  err   Result from the native emitter.
+ * \return the error to report.
+ */
+static inline cyaml_err_t cyaml__gen_save_err(
+		const cyaml_gen_save_t *save,
+		cyaml_err_t err)
+{
+	if (err != CYAML_OK && save->err != CYAML_OK) {
+		return save->err;
+	}
+	return err;
+}
+
+/**
+ * Get whether to use flow style for a mapping or sequence.
+ *
+ * \param[in]  save   The saving context.
+ * \param[in]  style  The mapping or sequence's style from its schema.
+ * \return true for flow style, false for block style.
+ */
+static inline bool cyaml__gen_flow(
+		const cyaml_gen_save_t *save,
+		cyaml_gen_style_t style)
+{
+	if (style == CYAML_GEN_STYLE_DEFAULT) {
+		return !(save->config->flags & CYAML_CFG_STYLE_BLOCK) &&
+				(save->config->flags & CYAML_CFG_STYLE_FLOW);
+	}
+
+	return style == CYAML_GEN_STYLE_FLOW;
+}
+
+/**
+ * Get whether to omit the document delimiters.
+ *
+ * \param[in]  save  The saving context.
+ * \return true if the document delimiters are implicit.
+ */
+static inline bool cyaml__gen_implicit(
+		const cyaml_gen_save_t *save)
+{
+	return !(save->config->flags & CYAML_CFG_DOCUMENT_DELIM);
+}
+
+/* Exported function, documented in include/cyaml/gen.h */
+cyaml_err_t cyaml_gen_save_start(
+		const cyaml_config_t *config,
+		cyaml_gen_save_t **save_out)
+{
+	cyaml_gen_save_t *save;
+	cyaml_err_t err;
+
+	err = cyaml__gen_valid_config(config);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	save = cyaml__alloc(config, sizeof(*save), true);
+	if (save == NULL) {
+		return CYAML_ERR_OOM;
+	}
+
+	save->config = config;
+	cyaml_emit_init(&save->emit, config, cyaml__gen_write_handler, save);
+
+	err = cyaml__gen_save_err(save, cyaml_emit_document_start(
+			&save->emit, cyaml__gen_implicit(save)));
+	if (err != CYAML_OK) {
+		cyaml_gen_save_destroy(save);
+		return err;
+	}
+
+	*save_out = save;
+	return CYAML_OK;
+}
+
+/* Exported function, documented in include/cyaml/gen.h */
+cyaml_err_t cyaml_gen_save_mapping_start(
+		cyaml_gen_save_t *save,
+		cyaml_gen_style_t style)
+{
+	return cyaml__gen_save_err(save, cyaml_emit_mapping_start(
+			&save->emit, cyaml__gen_flow(save, style)));
+}
+
+/* Exported function, documented in include/cyaml/gen.h */
+cyaml_err_t cyaml_gen_save_mapping_end(
+		cyaml_gen_save_t *save)
+{
+	return cyaml__gen_save_err(save,
+			cyaml_emit_mapping_end(&save->emit));
+}
+
+/* Exported function, documented in include/cyaml/gen.h */
+cyaml_err_t cyaml_gen_save_sequence_start(
+		cyaml_gen_save_t *save,
+		cyaml_gen_style_t style)
+{
+	return cyaml__gen_save_err(save, cyaml_emit_sequence_start(
+			&save->emit, cyaml__gen_flow(save, style)));
+}
+
+/* Exported function, documented in include/cyaml/gen.h */
+cyaml_err_t cyaml_gen_save_sequence_end(
+		cyaml_gen_save_t *save)
+{
+	return cyaml__gen_save_err(save,
+			cyaml_emit_sequence_end(&save->emit));
+}
+
+/* Exported function, documented in include/cyaml/gen.h */
+cyaml_err_t cyaml_gen_save_scalar(
+		cyaml_gen_save_t *save,
+		const char *value,
+		size_t len)
+{
+	return cyaml__gen_save_err(save,
+			cyaml_emit_scalar(&save->emit, value, len));
+}
+
+/* Exported function, documented in include/cyaml/gen.h */
+cyaml_err_t cyaml_gen_save_finish(
+		cyaml_gen_save_t *save,
+		char **output,
+		size_t *len)
+{
+	cyaml_err_t err;
+
+	err = cyaml__gen_save_err(save, cyaml_emit_document_end(
+			&save->emit, cyaml__gen_implicit(save)));
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	err = cyaml__gen_save_err(save, cyaml_emit_stream_end(&save->emit));
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	/* Trim the excess from the final geometric growth step. */
+	if (save->used != 0 && save->used < save->len) {
+		char *temp = cyaml__realloc(save->config, save->data,
+				save->len, save->used, false);
+		if (temp != NULL) {
+			save->data = temp;
+			save->len = save->used;
+		}
+	}
+
+	*output = save->data;
+	*len = save->used;
+	save->data = NULL;
+	save->len = 0;
+	save->used = 0;
+
+	return CYAML_OK;
+}
+
+/* Exported function, documented in include/cyaml/gen.h */
+void cyaml_gen_save_destroy(
+		cyaml_gen_save_t *save)
+{
+	if (save != NULL) {
+		cyaml_emit_fini(&save->emit);
+		cyaml__free(save->config, save->data);
+		cyaml__free(save->config, save);
+	}
+}
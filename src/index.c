@@ -0,0 +1,479 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (C) 2019 Michael Drake <tlsa@netsurf-browser.org>
+ */
+
+/**
+ * \file
+ * \brief CYAML mapping schema key lookup indexes.
+ *
+ * Each index is an open addressed hash table with linear probing.  Keys are
+ * inserted in schema order, and keys which match an earlier key are not
+ * inserted at all, so lookups return the same field as stepping through
+ * the schema would.  String value array indexes work the same way.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "index.h"
+#include "util.h"
+#include "mem.h"
+#include "stats.h"
+
+/**
+ * Case sensitive string hash.
+ *
+ * \param[in]  str  String to hash.
+ * \return hash of the string.
+ */
+static inline uint32_t cyaml__index_hash_str(
+		const char *str)
+{
+	const uint8_t *s = (const uint8_t *)str;
+	uint32_t hash = 2166136261u; /* FNV-1a offset basis. */
+
+	while (*s != 0) {
+		hash = (hash ^ *s++) * 16777619u; /* FNV-1a prime. */
+	}
+
+	return hash;
+}
+
+/**
+ * Hash a key according to an index's case sensitivity.
+ *
+ * \param[in]  case_sensitive  Whether to hash with case sensitivity.
+ * \param[in]  key             The key to hash.
+ * \return hash of the key.
+ */
+static inline uint32_t cyaml__index_hash(
+		bool case_sensitive,
+		const char *key)
+{
+	if (case_sensitive) {
+		return cyaml__index_hash_str(key);
+	}
+
+	return cyaml_utf8_casehash(key);
+}
+
+/**
+ * Compare keys according to an index's case sensitivity.
+ *
+ * \param[in]  case_sensitive  Whether to compare with case sensitivity.
+ * \param[in]  key1            First key to compare.
+ * \param[in]  key2            Second key to compare.
+ * \return true if the keys match, false otherwise.
+ */
+static inline bool cyaml__index_key_match(
+		bool case_sensitive,
+		const char *key1,
+		const char *key2)
+{
+	if (case_sensitive) {
+		return strcmp(key1, key2) == 0;
+	}
+
+	return cyaml_utf8_casecmp(key1, key2) == 0;
+}
+
+/**
+ * Find the field for a key in an index's hash table.
+ *
+ * \param[in]  config  The client's CYAML library config.
+ * \param[in]  index   The mapping key index.
+ * \param[in]  key     The key to search for.
+ * \param[in]  hash    The hash of key.
+ * \return index in the mapping schema's fields array for key, or
+ *         \ref CYAML_SCHEMA_IDX_NONE if key is not present in schema.
+ */
+static uint16_t cyaml__index_find(
+		const cyaml_config_t *config,
+		const cyaml_index_t *index,
+		const char *key,
+		uint32_t hash)
+{
+	uint32_t pos = hash & index->mask;
+
+	while (index->slots[pos].idx != CYAML_SCHEMA_IDX_NONE) {
+		const cyaml_index_slot_t *slot = &index->slots[pos];
+
+		CYAML_STATS_INC(config, key_probes);
+		if (slot->hash == hash && cyaml__index_key_match(
+				index->case_sensitive, key,
+				index->fields[slot->idx].key)) {
+			return slot->idx;
+		}
+		pos = (pos + 1) & index->mask;
+	}
+
+	return CYAML_SCHEMA_IDX_NONE;
+}
+
+/**
+ * Create an index for a mapping schema's fields array.
+ *
+ * \param[in]  config          The client's CYAML library config.
+ * \param[in]  fields          The mapping's schema fields array.
+ * \param[in]  count           Number of entries in fields.
+ * \param[in]  case_sensitive  Whether key matching is case sensitive.
+ * \return the new index, or NULL on allocation failure.
+ */
+static cyaml_index_t * cyaml__index_create(
+		const cyaml_config_t *config,
+		const cyaml_schema_field_t *fields,
+		uint16_t count,
+		bool case_sensitive)
+{
+	cyaml_index_t *index;
+	uint32_t slots = 1;
+
+	/* Keep the table at most half full. */
+	while (slots < 2 * (uint32_t)count) {
+		slots <<= 1;
+	}
+
+	index = cyaml__alloc(config, sizeof(*index) +
+			sizeof(*index->slots) * slots, false);
+	if (index == NULL) {
+		return NULL;
+	}
+
+	index->fields = fields;
+	index->case_sensitive = case_sensitive;
+	index->unique = true;
+	index->count = count;
+	index->mask = slots - 1;
+
+	for (uint32_t i = 0; i < slots; i++) {
+		index->slots[i].idx = CYAML_SCHEMA_IDX_NONE;
+	}
+
+	for (uint16_t i = 0; i < count; i++) {
+		uint32_t hash = cyaml__index_hash(case_sensitive,
+				fields[i].key);
+		uint32_t pos = hash & index->mask;
+
+		if (cyaml__index_find(config, index, fields[i].key, hash) !=
+				CYAML_SCHEMA_IDX_NONE) {
+			index->unique = false;
+			continue;
+		}
+
+		while (index->slots[pos].idx != CYAML_SCHEMA_IDX_NONE) {
+			pos = (pos + 1) & index->mask;
+		}
+		index->slots[pos].hash = hash;
+		index->slots[pos].idx = i;
+	}
+
+	return index;
+}
+
+/* Exported function, documented in index.h. */
+cyaml_err_t cyaml_index_get(
+		const cyaml_config_t *config,
+		cyaml_index_cache_t *cache,
+		const cyaml_schema_field_t *fields,
+		bool case_sensitive,
+		const cyaml_index_t **index_out)
+{
+	const cyaml_schema_field_t *entry = fields;
+	cyaml_index_t *index;
+
+	for (uint32_t i = 0; i < cache->count; i++) {
+		if (cache->entries[i]->fields == fields &&
+		    cache->entries[i]->case_sensitive == case_sensitive) {
+			*index_out = cache->entries[i];
+			return CYAML_OK;
+		}
+	}
+
+	while (entry->key != NULL) {
+		entry++;
+	}
+	if (entry - fields <= CYAML_INDEX_MIN_FIELDS ||
+	    entry - fields >= CYAML_SCHEMA_IDX_NONE) {
+		*index_out = NULL;
+		return CYAML_OK;
+	}
+
+	if (cache->count == cache->max) {
+		uint32_t max = cache->max + 16;
+		cyaml_index_t **temp = cyaml__realloc(config, cache->entries,
+				0, sizeof(*cache->entries) * max, false);
+		if (temp == NULL) {
+			return CYAML_ERR_OOM;
+		}
+		cache->entries = temp;
+		cache->max = max;
+	}
+
+	index = cyaml__index_create(config, fields, entry - fields,
+			case_sensitive);
+	if (index == NULL) {
+		return CYAML_ERR_OOM;
+	}
+
+	cyaml__log(config, CYAML_LOG_DEBUG,
+			"Created key index for %u fields (%u slots)\n",
+			(unsigned)index->count, (unsigned)index->mask + 1);
+
+	cache->entries[cache->count++] = index;
+	*index_out = index;
+
+	return CYAML_OK;
+}
+
+/* Exported function, documented in index.h. */
+uint16_t cyaml_index_lookup(
+		const cyaml_config_t *config,
+		const cyaml_index_t *index,
+		const char *key,
+		uint16_t hint)
+{
+	/* Documents commonly list keys in schema order, so check the
+	 * hinted field first, if doing so gives the same result. */
+	CYAML_STATS_INC(config, key_probes);
+	if (index->unique && hint < index->count &&
+	    cyaml__index_key_match(index->case_sensitive,
+			key, index->fields[hint].key)) {
+		return hint;
+	}
+
+	return cyaml__index_find(config, index, key,
+			cyaml__index_hash(index->case_sensitive, key));
+}
+
+/**
+ * Find the entry for a string in a string value index's hash table.
+ *
+ * \param[in]  index  The string value index.
+ * \param[in]  str    The string to search for.
+ * \param[in]  hash   The hash of str.
+ * \return index in the string value array for str, or
+ *         \ref CYAML_STRVAL_IDX_NONE if str is not present.
+ */
+static uint32_t cyaml__index_strval_find(
+		const cyaml_strval_index_t *index,
+		const char *str,
+		uint32_t hash)
+{
+	uint32_t pos = hash & index->mask;
+
+	while (index->slots[pos].idx != CYAML_STRVAL_IDX_NONE) {
+		const cyaml_strval_slot_t *slot = &index->slots[pos];
+
+		if (slot->hash == hash && cyaml__index_key_match(
+				index->case_sensitive, str,
+				index->strings[slot->idx].str)) {
+			return slot->idx;
+		}
+		pos = (pos + 1) & index->mask;
+	}
+
+	return CYAML_STRVAL_IDX_NONE;
+}
+
+/**
+ * Compare string value index sorted table entries, for qsort.
+ *
+ * \param[in]  a  First entry to compare.
+ * \param[in]  b  Second entry to compare.
+ * \return negative, zero, or positive, as a orders before, with, or after b.
+ */
+static int cyaml__index_strval_cmp(
+		const void *a,
+		const void *b)
+{
+	const cyaml_strval_by_val_t *e1 = a;
+	const cyaml_strval_by_val_t *e2 = b;
+
+	if (e1->val != e2->val) {
+		return (e1->val < e2->val) ? -1 : 1;
+	}
+
+	return (e1->idx < e2->idx) ? -1 : (e1->idx > e2->idx);
+}
+
+/**
+ * Create an index for a string value array.
+ *
+ * \param[in]  config          The client's CYAML library config.
+ * \param[in]  strings         The string value array.
+ * \param[in]  count           Number of entries in strings.
+ * \param[in]  case_sensitive  Whether string matching is case sensitive.
+ * \return the new index, or NULL on allocation failure.
+ */
+static cyaml_strval_index_t * cyaml__index_strval_create(
+		const cyaml_config_t *config,
+		const cyaml_strval_t *strings,
+		uint32_t count,
+		bool case_sensitive)
+{
+	cyaml_strval_index_t *index;
+	uint32_t slots = 1;
+
+	/* Keep the table at most half full. */
+	while (slots < 2 * count) {
+		slots <<= 1;
+	}
+
+	index = cyaml__alloc(config, sizeof(*index) +
+			sizeof(*index->slots) * slots +
+			sizeof(*index->by_val) * count, false);
+	if (index == NULL) {
+		return NULL;
+	}
+
+	index->strings = strings;
+	index->case_sensitive = case_sensitive;
+	index->count = count;
+	index->mask = slots - 1;
+	index->by_val = (cyaml_strval_by_val_t *)(index->slots + slots);
+
+	for (uint32_t i = 0; i < slots; i++) {
+		index->slots[i].idx = CYAML_STRVAL_IDX_NONE;
+	}
+
+	for (uint32_t i = 0; i < count; i++) {
+		uint32_t hash = cyaml__index_hash(case_sensitive,
+				strings[i].str);
+		uint32_t pos = hash & index->mask;
+
+		index->by_val[i].val = strings[i].val;
+		index->by_val[i].idx = i;
+
+		if (cyaml__index_strval_find(index, strings[i].str, hash) !=
+				CYAML_STRVAL_IDX_NONE) {
+			continue;
+		}
+
+		while (index->slots[pos].idx != CYAML_STRVAL_IDX_NONE) {
+			pos = (pos + 1) & index->mask;
+		}
+		index->slots[pos].hash = hash;
+		index->slots[pos].idx = i;
+	}
+
+	qsort(index->by_val, count, sizeof(*index->by_val),
+			cyaml__index_strval_cmp);
+
+	return index;
+}
+
+/* Exported function, documented in index.h. */
+cyaml_err_t cyaml_index_strval_get(
+		const cyaml_config_t *config,
+		cyaml_index_cache_t *cache,
+		const cyaml_schema_value_t *schema,
+		bool case_sensitive,
+		const cyaml_strval_index_t **index_out)
+{
+	const cyaml_strval_t *strings = schema->enumeration.strings;
+	uint32_t count = schema->enumeration.count;
+	cyaml_strval_index_t *index;
+
+	if (count <= CYAML_INDEX_MIN_STRVALS || count >= (UINT32_MAX >> 2)) {
+		*index_out = NULL;
+		return CYAML_OK;
+	}
+
+	for (uint32_t i = 0; i < cache->strval_count; i++) {
+		if (cache->strvals[i]->strings == strings &&
+		    cache->strvals[i]->count == count &&
+		    cache->strvals[i]->case_sensitive == case_sensitive) {
+			*index_out = cache->strvals[i];
+			return CYAML_OK;
+		}
+	}
+
+	if (cache->strval_count == cache->strval_max) {
+		uint32_t max = cache->strval_max + 16;
+		cyaml_strval_index_t **temp = cyaml__realloc(config,
+				cache->strvals, 0,
+				sizeof(*cache->strvals) * max, false);
+		if (temp == NULL) {
+			return CYAML_ERR_OOM;
+		}
+		cache->strvals = temp;
+		cache->strval_max = max;
+	}
+
+	index = cyaml__index_strval_create(config, strings, count,
+			case_sensitive);
+	if (index == NULL) {
+		return CYAML_ERR_OOM;
+	}
+
+	cyaml__log(config, CYAML_LOG_DEBUG,
+			"Created string value index for %u entries "
+			"(%u slots)\n", (unsigned)index->count,
+			(unsigned)index->mask + 1);
+
+	cache->strvals[cache->strval_count++] = index;
+	*index_out = index;
+
+	return CYAML_OK;
+}
+
+/* Exported function, documented in index.h. */
+uint32_t cyaml_index_strval_by_str(
+		const cyaml_strval_index_t *index,
+		const char *str)
+{
+	return cyaml__index_strval_find(index, str,
+			cyaml__index_hash(index->case_sensitive, str));
+}
+
+/* Exported function, documented in index.h. */
+uint32_t cyaml_index_strval_by_val(
+		const cyaml_strval_index_t *index,
+		int64_t val)
+{
+	uint32_t lo = 0;
+	uint32_t hi = index->count;
+
+	/* Find the first entry with the value. */
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2;
+
+		if (index->by_val[mid].val < val) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	if (lo < index->count && index->by_val[lo].val == val) {
+		return index->by_val[lo].idx;
+	}
+
+	return CYAML_STRVAL_IDX_NONE;
+}
+
+/* Exported function, documented in index.h. */
+void cyaml_index_cache_fini(
+		const cyaml_config_t *config,
+		cyaml_index_cache_t *cache)
+{
+	for (uint32_t i = 0; i < cache->count; i++) {
+		cyaml__free(config, cache->entries[i]);
+	}
+	cyaml__free(config, cache->entries);
+
+	for (uint32_t i = 0; i < cache->strval_count; i++) {
+		cyaml__free(config, cache->strvals[i]);
+	}
+	cyaml__free(config, cache->strvals);
+
+	cache->entries = NULL;
+	cache->count = 0;
+	cache->max = 0;
+	cache->strvals = NULL;
+	cache->strval_count = 0;
+	cache->strval_max = 0;
+}
@@ -0,0 +1,207 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (C) 2019 Michael Drake <tlsa@netsurf-browser.org>
+ */
+
+/**
+ * \file
+ * \brief CYAML mapping schema key lookup indexes.
+ *
+ * Finding the schema field for a mapping key by stepping through the
+ * mapping's schema fields array is linear in the number of fields.  For
+ * mappings with many fields, this becomes a significant part of the cost
+ * of loading.
+ *
+ * An index is a hash table over a mapping schema's field keys.  Indexes are
+ * built on demand and kept in an index cache, so that each mapping schema
+ * only needs to be indexed once, however many times it is used.
+ *
+ * The same applies to the string value arrays of \ref CYAML_ENUM and
+ * \ref CYAML_FLAGS schemas.  Their indexes have a hash table for finding
+ * values by string, when loading, and a table sorted by value, for finding
+ * strings by value, when saving.
+ */
+
+#ifndef CYAML_INDEX_H
+#define CYAML_INDEX_H
+
+#include <stdbool.h>
+
+#include "cyaml/cyaml.h"
+
+/** Identifies that no mapping schema entry was found for key. */
+#define CYAML_SCHEMA_IDX_NONE 0xffff
+
+/**
+ * Mappings with no more than this many fields are not indexed.
+ *
+ * For small mappings, stepping through the schema is as fast as hashing.
+ */
+#define CYAML_INDEX_MIN_FIELDS 8
+
+/** A single slot in a mapping key index hash table. */
+typedef struct cyaml_index_slot {
+	uint32_t hash; /**< Hash of the field's key. */
+	uint16_t idx;  /**< Field index, or \ref CYAML_SCHEMA_IDX_NONE. */
+} cyaml_index_slot_t;
+
+/**
+ * A mapping key index.
+ *
+ * The hash table slots are allocated along with the index structure.
+ */
+typedef struct cyaml_index {
+	/** The mapping schema fields array that is indexed. */
+	const cyaml_schema_field_t *fields;
+	/** Whether keys are hashed and compared with case sensitivity. */
+	bool case_sensitive;
+	/**
+	 * Whether all of the keys in the fields array are distinct.
+	 *
+	 * If they are not, the first matching field must be found, so
+	 * in-order short cuts can't be used.
+	 */
+	bool unique;
+	uint16_t count; /**< Number of entries in the fields array. */
+	uint32_t mask;  /**< Hash table slot count, minus one. */
+	cyaml_index_slot_t slots[]; /**< The hash table. */
+} cyaml_index_t;
+
+/** Identifies that no string value array entry was found. */
+#define CYAML_STRVAL_IDX_NONE 0xffffffff
+
+/**
+ * String value arrays with no more than this many entries are not indexed.
+ */
+#define CYAML_INDEX_MIN_STRVALS 8
+
+/** A single slot in a string value index hash table. */
+typedef struct cyaml_strval_slot {
+	uint32_t hash; /**< Hash of the entry's string. */
+	uint32_t idx;  /**< Entry index, or \ref CYAML_STRVAL_IDX_NONE. */
+} cyaml_strval_slot_t;
+
+/** An entry in a string value index's table sorted by value. */
+typedef struct cyaml_strval_by_val {
+	int64_t val;   /**< The entry's value. */
+	uint32_t idx;  /**< Index of the entry in the string value array. */
+} cyaml_strval_by_val_t;
+
+/**
+ * A string value array index.
+ *
+ * The sorted value table and the hash table slots are allocated along with
+ * the index structure.
+ */
+typedef struct cyaml_strval_index {
+	/** The string value array that is indexed. */
+	const cyaml_strval_t *strings;
+	/** Whether strings are hashed and compared with case sensitivity. */
+	bool case_sensitive;
+	uint32_t count;  /**< Number of entries in the string value array. */
+	uint32_t mask;   /**< Hash table slot count, minus one. */
+	/** The string value array's entries, sorted by value, then index. */
+	cyaml_strval_by_val_t *by_val;
+	cyaml_strval_slot_t slots[]; /**< The hash table. */
+} cyaml_strval_index_t;
+
+/** A cache of mapping key and string value array indexes. */
+typedef struct cyaml_index_cache {
+	cyaml_index_t **entries; /**< Array of indexes. */
+	uint32_t count;          /**< Number of indexes in entries. */
+	uint32_t max;            /**< Allocated size of entries. */
+	cyaml_strval_index_t **strvals; /**< Array of string value indexes. */
+	uint32_t strval_count;   /**< Number of indexes in strvals. */
+	uint32_t strval_max;     /**< Allocated size of strvals. */
+} cyaml_index_cache_t;
+
+/**
+ * Get the index for a mapping schema, creating it if necessary.
+ *
+ * \param[in]      config          The client's CYAML library config.
+ * \param[in,out]  cache           The index cache to get index from.
+ * \param[in]      fields          The mapping's schema fields array.
+ * \param[in]      case_sensitive  Whether key matching is case sensitive.
+ * \param[out]     index_out       On success, returns the index, or NULL
+ *                                 if the mapping is too small to need one.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+cyaml_err_t cyaml_index_get(
+		const cyaml_config_t *config,
+		cyaml_index_cache_t *cache,
+		const cyaml_schema_field_t *fields,
+		bool case_sensitive,
+		const cyaml_index_t **index_out);
+
+/**
+ * Find the field for a key in an indexed mapping schema.
+ *
+ * \param[in]  config  The client's CYAML library config.
+ * \param[in]  index   The mapping key index.
+ * \param[in]  key     The key to search for.
+ * \param[in]  hint    Field index to check before consulting the hash table.
+ * \return index in the mapping schema's fields array for key, or
+ *         \ref CYAML_SCHEMA_IDX_NONE if key is not present in schema.
+ */
+uint16_t cyaml_index_lookup(
+		const cyaml_config_t *config,
+		const cyaml_index_t *index,
+		const char *key,
+		uint16_t hint);
+
+/**
+ * Get the index for an enum or flags schema, creating it if necessary.
+ *
+ * \param[in]      config          The client's CYAML library config.
+ * \param[in,out]  cache           The index cache to get index from.
+ * \param[in]      schema          The \ref CYAML_ENUM or \ref CYAML_FLAGS
+ *                                 schema.
+ * \param[in]      case_sensitive  Whether string matching is case sensitive.
+ * \param[out]     index_out       On success, returns the index, or NULL
+ *                                 if the string value array is too small
+ *                                 to need one.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+cyaml_err_t cyaml_index_strval_get(
+		const cyaml_config_t *config,
+		cyaml_index_cache_t *cache,
+		const cyaml_schema_value_t *schema,
+		bool case_sensitive,
+		const cyaml_strval_index_t **index_out);
+
+/**
+ * Find the first string value array entry for a string.
+ *
+ * \param[in]  index  The string value index.
+ * \param[in]  str    The string to search for.
+ * \return index in the string value array for str, or
+ *         \ref CYAML_STRVAL_IDX_NONE if str is not present.
+ */
+uint32_t cyaml_index_strval_by_str(
+		const cyaml_strval_index_t *index,
+		const char *str);
+
+/**
+ * Find the first string value array entry for a value.
+ *
+ * \param[in]  index  The string value index.
+ * \param[in]  val    The value to search for.
+ * \return index in the string value array for val, or
+ *         \ref CYAML_STRVAL_IDX_NONE if val is not present.
+ */
+uint32_t cyaml_index_strval_by_val(
+		const cyaml_strval_index_t *index,
+		int64_t val);
+
+/**
+ * Free all the indexes in an index cache.
+ *
+ * \param[in]  config  The client's CYAML library config.
+ * \param[in]  cache   The index cache to clean up.
+ */
+void cyaml_index_cache_fini(
+		const cyaml_config_t *config,
+		cyaml_index_cache_t *cache);
+
+#endif
@@ -0,0 +1,273 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (C) 2019 Michael Drake <tlsa@netsurf-browser.org>
+ */
+
+/**
+ * \file
+ * \brief Decompression of zlib and gzip input, for streamed loading.
+ *
+ * An inflater wraps a client read function, and is itself a read function,
+ * so it can be passed to \ref cyaml_load_stream.  Compressed input is read
+ * a chunk at a time into the inflater's input buffer, and decompressed
+ * straight into the buffer the caller provides.
+ *
+ * This is only built with zlib support, when `CYAML_ZLIB` is defined.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+
+#include "cyaml/cyaml.h"
+
+#ifdef CYAML_ZLIB
+
+#include <zlib.h>
+
+#include "mem.h"
+
+/** Size of an inflater's compressed input buffer. */
+#define CYAML_INFLATE_CHUNK 16384
+
+/**
+ * zlib window bits setting to accept zlib and gzip headers, with the
+ * largest window.
+ */
+#define CYAML_INFLATE_WBITS (15 + 32)
+
+/** CYAML input decompressor. */
+struct cyaml_inflate {
+	const cyaml_config_t *config; /**< Client's CYAML configuration. */
+	cyaml_read_fn_t read_fn;      /**< Client's compressed input reader. */
+	void *read_ctx;               /**< Client's read function context. */
+	z_stream z;                   /**< zlib decompression state. */
+	bool in_end;      /**< Whether the compressed input has ended. */
+	bool member_end;  /**< Whether a complete member was decompressed. */
+	bool end;         /**< Whether the decompressed input has ended. */
+	/** Compressed input buffer. */
+	uint8_t in[CYAML_INFLATE_CHUNK];
+};
+
+/**
+ * zlib allocation function, using the client's allocator.
+ *
+ * \param[in]  opaque  The inflater.
+ * \param[in]  items   Number of items to allocate.
+ * \param[in]  size    Size of each item in bytes.
+ * \return the new allocation, or `Z_NULL` on failure.
+ */
+static voidpf cyaml__inflate_alloc(
+		voidpf opaque,
+		uInt items,
+		uInt size)
+{
+	const cyaml_inflate_t *inf = opaque;
+
+	if (size != 0 && items > SIZE_MAX / size) {
+		return Z_NULL;
+	}
+
+	return cyaml__alloc(inf->config, (size_t)items * size, false);
+}
+
+/**
+ * zlib free function, using the client's allocator.
+ *
+ * \param[in]  opaque   The inflater.
+ * \param[in]  address  The allocation to free.
+ */
+static void cyaml__inflate_free(
+		voidpf opaque,
+		voidpf address)
+{
+	const cyaml_inflate_t *inf = opaque;
+
+	cyaml__free(inf->config, address);
+}
+
+/**
+ * Make sure an inflater has compressed input to decompress.
+ *
+ * \param[in]  inf  The inflater.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__inflate_fill(
+		cyaml_inflate_t *inf)
+{
+	size_t len;
+	cyaml_err_t err;
+
+	if (inf->z.avail_in != 0 || inf->in_end) {
+		return CYAML_OK;
+	}
+
+	err = inf->read_fn(inf->read_ctx,
+			inf->in, sizeof(inf->in), &len);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	if (len == 0) {
+		inf->in_end = true;
+	}
+	inf->z.next_in = inf->in;
+	inf->z.avail_in = (uInt)len;
+
+	return CYAML_OK;
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_inflate_create(
+		const cyaml_config_t *config,
+		cyaml_read_fn_t read_fn,
+		void *read_ctx,
+		cyaml_inflate_t **inflate_out)
+{
+	cyaml_inflate_t *inf;
+
+	if (config == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_CONFIG;
+	}
+	if (config->mem_fn == NULL) {
+		return CYAML_ERR_BAD_CONFIG_NULL_MEMFN;
+	}
+	if (read_fn == NULL || inflate_out == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_DATA;
+	}
+
+	inf = cyaml__alloc(config, sizeof(*inf), true);
+	if (inf == NULL) {
+		return CYAML_ERR_OOM;
+	}
+
+	inf->config = config;
+	inf->read_fn = read_fn;
+	inf->read_ctx = read_ctx;
+	inf->z.zalloc = cyaml__inflate_alloc;
+	inf->z.zfree = cyaml__inflate_free;
+	inf->z.opaque = inf;
+
+	if (inflateInit2(&inf->z, CYAML_INFLATE_WBITS) != Z_OK) {
+		cyaml__free(config, inf);
+		return CYAML_ERR_OOM;
+	}
+
+	*inflate_out = inf;
+	return CYAML_OK;
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_inflate_read(
+		void *ctx,
+		uint8_t *buffer,
+		size_t size,
+		size_t *len)
+{
+	cyaml_inflate_t *inf = ctx;
+	cyaml_err_t err;
+	uInt out_size;
+
+	if (inf == NULL || buffer == NULL || len == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_DATA;
+	}
+
+	out_size = (size > UINT_MAX) ? UINT_MAX : (uInt)size;
+	inf->z.next_out = buffer;
+	inf->z.avail_out = out_size;
+
+	while (inf->z.avail_out == out_size && !inf->end) {
+		err = cyaml__inflate_fill(inf);
+		if (err != CYAML_OK) {
+			return err;
+		}
+
+		if (inf->z.avail_in == 0) {
+			if (!inf->member_end) {
+				/* Compressed input is truncated. */
+				return CYAML_ERR_DECOMPRESS;
+			}
+			inf->end = true;
+			break;
+		}
+
+		if (inf->member_end) {
+			/* There is another gzip member after the last. */
+			if (inflateReset(&inf->z) != Z_OK) {
+				return CYAML_ERR_DECOMPRESS;
+			}
+			inf->member_end = false;
+		}
+
+		switch (inflate(&inf->z, Z_NO_FLUSH)) {
+		case Z_STREAM_END:
+			inf->member_end = true;
+			break;
+		case Z_OK:      /* Fall through. */
+		case Z_BUF_ERROR:
+			break;
+		case Z_MEM_ERROR:
+			return CYAML_ERR_OOM;
+		default:
+			return CYAML_ERR_DECOMPRESS;
+		}
+	}
+
+	*len = out_size - inf->z.avail_out;
+	return CYAML_OK;
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+void cyaml_inflate_destroy(
+		cyaml_inflate_t *inf)
+{
+	if (inf == NULL) {
+		return;
+	}
+
+	inflateEnd(&inf->z);
+	cyaml__free(inf->config, inf);
+}
+
+#else
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_inflate_create(
+		const cyaml_config_t *config,
+		cyaml_read_fn_t read_fn,
+		void *read_ctx,
+		cyaml_inflate_t **inflate_out)
+{
+	(void)config;
+	(void)read_fn;
+	(void)read_ctx;
+	(void)inflate_out;
+
+	return CYAML_ERR_NOT_SUPPORTED;
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_inflate_read(
+		void *ctx,
+		uint8_t *buffer,
+		size_t size,
+		size_t *len)
+{
+	(void)ctx;
+	(void)buffer;
+	(void)size;
+	(void)len;
+
+	return CYAML_ERR_NOT_SUPPORTED;
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+void cyaml_inflate_destroy(
+		cyaml_inflate_t *inf)
+{
+	(void)inf;
+}
+
+#endif
@@ -0,0 +1,161 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (C) 2019 Michael Drake <tlsa@netsurf-browser.org>
+ */
+
+/**
+ * \file
+ * \brief CYAML string interning for loaded documents.
+ *
+ * The intern table is an open addressed hash table with linear probing,
+ * which is kept at most half full.
+ */
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "intern.h"
+#include "util.h"
+#include "mem.h"
+
+/** Number of slots in a newly created intern table. */
+#define CYAML_INTERN_SLOTS_MIN 64
+
+/**
+ * Hash a string.
+ *
+ * \param[in]  str  String to hash.
+ * \param[in]  len  Length of str in bytes.
+ * \return hash of the string.
+ */
+static inline uint32_t cyaml__intern_hash(
+		const char *str,
+		size_t len)
+{
+	const uint8_t *s = (const uint8_t *)str;
+	uint32_t hash = 2166136261u; /* FNV-1a offset basis. */
+
+	for (size_t i = 0; i < len; i++) {
+		hash = (hash ^ s[i]) * 16777619u; /* FNV-1a prime. */
+	}
+
+	return hash;
+}
+
+/**
+ * Resize an intern table, rehashing its strings.
+ *
+ * \param[in]      config  The client's CYAML library config.
+ * \param[in,out]  intern  The intern table to resize.
+ * \param[in]      slots   New number of slots; a power of two.
+ * \return true on success, false on allocation failure.
+ */
+static bool cyaml__intern_resize(
+		const cyaml_config_t *config,
+		cyaml_intern_t *intern,
+		uint32_t slots)
+{
+	cyaml_intern_slot_t *old = intern->slots;
+	uint32_t old_slots = (old == NULL) ? 0 : intern->mask + 1;
+	cyaml_intern_slot_t *temp;
+
+	temp = cyaml__alloc(config, sizeof(*temp) * slots, true);
+	if (temp == NULL) {
+		return false;
+	}
+
+	for (uint32_t i = 0; i < old_slots; i++) {
+		uint32_t pos;
+
+		if (old[i].str == NULL) {
+			continue;
+		}
+
+		pos = old[i].hash & (slots - 1);
+		while (temp[pos].str != NULL) {
+			pos = (pos + 1) & (slots - 1);
+		}
+		temp[pos] = old[i];
+	}
+
+	cyaml__free(config, old);
+	intern->slots = temp;
+	intern->mask = slots - 1;
+
+	return true;
+}
+
+/* Exported function, documented in intern.h. */
+const char * cyaml_intern_get(
+		const cyaml_config_t *config,
+		cyaml_intern_t *intern,
+		cyaml_arena_t **arena_io,
+		const char *str,
+		size_t len)
+{
+	uint32_t hash = cyaml__intern_hash(str, len);
+	cyaml_intern_slot_t *slot;
+	char *copy;
+	uint32_t pos;
+
+	if (len > UINT32_MAX) {
+		/* Too big to be worth sharing. */
+		return NULL;
+	}
+
+	if (intern->slots == NULL || (intern->count + 1) * 2 > intern->mask) {
+		uint32_t slots = (intern->slots == NULL) ?
+				CYAML_INTERN_SLOTS_MIN : (intern->mask + 1) * 2;
+		if (!cyaml__intern_resize(config, intern, slots)) {
+			return NULL;
+		}
+	}
+
+	pos = hash & intern->mask;
+	while (intern->slots[pos].str != NULL) {
+		slot = &intern->slots[pos];
+		if (slot->hash == hash && slot->len == len &&
+		    memcmp(slot->str, str, len) == 0) {
+			return slot->str;
+		}
+		pos = (pos + 1) & intern->mask;
+	}
+
+	copy = cyaml_arena_realloc(config, arena_io, NULL, 0, len + 1, false);
+	if (copy == NULL) {
+		return NULL;
+	}
+	memcpy(copy, str, len);
+
+	slot = &intern->slots[pos];
+	slot->str = copy;
+	slot->len = (uint32_t)len;
+	slot->hash = hash;
+	intern->count++;
+
+	return copy;
+}
+
+/* Exported function, documented in intern.h. */
+void cyaml_intern_clear(
+		cyaml_intern_t *intern)
+{
+	if (intern->slots != NULL) {
+		memset(intern->slots, 0,
+				sizeof(*intern->slots) * (intern->mask + 1));
+	}
+	intern->count = 0;
+}
+
+/* Exported function, documented in intern.h. */
+void cyaml_intern_fini(
+		const cyaml_config_t *config,
+		cyaml_intern_t *intern)
+{
+	cyaml__free(config, intern->slots);
+
+	intern->slots = NULL;
+	intern->count = 0;
+	intern->mask = 0;
+}
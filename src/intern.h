@@ -0,0 +1,81 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (C) 2019 Michael Drake <tlsa@netsurf-browser.org>
+ */
+
+/**
+ * \file
+ * \brief CYAML string interning for loaded documents.
+ *
+ * When the client sets \ref CYAML_CFG_INTERN_STRINGS along with
+ * \ref CYAML_CFG_ARENA, each distinct string value in a document is only
+ * allocated once, in the document's arena.  Every pointer to an equal
+ * string in the loaded data points at the same allocation.
+ *
+ * The intern table only lives for the duration of the load; the strings
+ * themselves belong to the document's arena, and are freed with it.
+ */
+
+#ifndef CYAML_INTERN_H
+#define CYAML_INTERN_H
+
+#include "cyaml/cyaml.h"
+
+#include "arena.h"
+
+/** A single slot in a string intern table. */
+typedef struct cyaml_intern_slot {
+	const char *str; /**< The interned string, or NULL if slot is empty. */
+	uint32_t len;    /**< Length of str in bytes. */
+	uint32_t hash;   /**< Hash of str. */
+} cyaml_intern_slot_t;
+
+/** A string intern table. */
+typedef struct cyaml_intern {
+	cyaml_intern_slot_t *slots; /**< The hash table. */
+	uint32_t count;             /**< Number of strings in the table. */
+	uint32_t mask;              /**< Slot count, minus one. */
+} cyaml_intern_t;
+
+/**
+ * Get the interned copy of a string, adding it if necessary.
+ *
+ * New strings are copied into the given arena, with a trailing nul.
+ *
+ * \param[in]      config    The client's CYAML library config.
+ * \param[in,out]  intern    The intern table.
+ * \param[in,out]  arena_io  The arena to allocate new strings from.
+ * \param[in]      str       The string to intern.
+ * \param[in]      len       Length of str in bytes.
+ * \return the interned string, or NULL on allocation failure.
+ */
+const char * cyaml_intern_get(
+		const cyaml_config_t *config,
+		cyaml_intern_t *intern,
+		cyaml_arena_t **arena_io,
+		const char *str,
+		size_t len);
+
+/**
+ * Forget all of the strings in an intern table.
+ *
+ * This must be called when the arena the strings were allocated from
+ * is freed or passed to the client.
+ *
+ * \param[in,out]  intern  The intern table.
+ */
+void cyaml_intern_clear(
+		cyaml_intern_t *intern);
+
+/**
+ * Free an intern table's resources.
+ *
+ * \param[in]      config  The client's CYAML library config.
+ * \param[in,out]  intern  The intern table to finalise.
+ */
+void cyaml_intern_fini(
+		const cyaml_config_t *config,
+		cyaml_intern_t *intern);
+
+#endif
@@ -13,20 +13,43 @@
  * in the client's data structure.
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <inttypes.h>
 #include <stdbool.h>
 #include <assert.h>
 #include <limits.h>
-#include <errno.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
 
 #include <yaml.h>
 
 #include "mem.h"
 #include "data.h"
 #include "util.h"
+#include "index.h"
+#include "arena.h"
+#include "free.h"
+#include "number.h"
+#include "intern.h"
+#include "anchor.h"
+#include "stats.h"
+#include "schema.h"
+
+/** Number of bit field words kept in a state stack entry. */
+#define CYAML_BITFIELD_INLINE_WORDS \
+	(CYAML_BITFIELD_INLINE_FIELDS / CYAML_BITFIELD_BITS)
 
-/** Identifies that no mapping schema entry was found for key. */
-#define CYAML_SCHEMA_IDX_NONE 0xffff
+/**
+ * Number of state stack entries below the top-level value's entry.
+ *
+ * These are the \ref CYAML_STATE_START, \ref CYAML_STATE_IN_STREAM and
+ * \ref CYAML_STATE_IN_DOC entries.
+ */
+#define CYAML_PRESIZE_STACK_BASE 3
 
 /**
  * A CYAML load state machine stack entry.
@@ -48,20 +71,55 @@ typedef struct cyaml_state {
 		 * \ref CYAML_STATE_IN_MAP_VALUE states. */
 		struct {
 			const cyaml_schema_field_t *schema;
-			/** Bit field of mapping fields found. */
-			cyaml_bitfield_t *fields;
+			/**
+			 * Offset in the context's bitfield scratch space
+			 * of the bit field of mapping fields found.
+			 * Only used for mappings with more than
+			 * \ref CYAML_BITFIELD_INLINE_FIELDS fields.
+			 */
+			uint32_t fields;
+			/** Bit field of mapping fields found, if small. */
+			cyaml_bitfield_t inline_fields[
+					CYAML_BITFIELD_INLINE_WORDS];
+			/** Key lookup index, or NULL for small mappings. */
+			const cyaml_index_t *index;
 			uint16_t schema_idx;
+			/** Number of fields in the mapping schema. */
 			uint16_t entries_count;
+			/**
+			 * Number of required fields not yet found, when
+			 * \ref CYAML_CFG_PROJECTION applies to the mapping.
+			 */
+			uint16_t required_left;
+			/** Whether \ref CYAML_CFG_PROJECTION applies. */
+			bool projected;
 		} mapping;
 		/**  Additional state for \ref CYAML_STATE_IN_SEQUENCE state. */
 		struct {
 			uint8_t *data;
 			uint8_t *count_data;
 			uint32_t count;
+			/** Number of entries allocated. */
+			uint32_t capacity;
 			uint64_t count_size;
+			/** Whether entries go to the client's entry_fn. */
+			bool streamed;
+			/**
+			 * Value of \ref cyaml_ctx_t.limit_bytes before the
+			 * current entry of a streamed sequence was loaded.
+			 */
+			size_t limit_bytes;
+			/**
+			 * Whether entries are numbers loaded in bulk, by
+			 * \ref cyaml__seq_entry_bulk.  The count is only
+			 * written to the client data at the end.
+			 */
+			bool bulk;
 		} sequence;
 	};
 	uint8_t *data;
+	/** Index plus one of the anchor for this state's value, or zero. */
+	uint32_t anchor;
 } cyaml_state_t;
 
 /**
@@ -75,6 +133,32 @@ typedef struct cyaml_ctx {
 	uint32_t stack_max;     /**< Current stack allocation limit. */
 	unsigned seq_count;     /**< Top-level sequence count. */
 	yaml_parser_t *parser;  /**< Internal libyaml parser object. */
+	/** Mapping key indexes built during this load. */
+	cyaml_index_cache_t index_cache;
+	/** Whether loaded data is allocated from the arena. */
+	bool use_arena;
+	/** Arena for loaded data, if \ref CYAML_CFG_ARENA is set. */
+	cyaml_arena_t *arena;
+	/** Whether pointer strings are interned in the arena. */
+	bool use_intern;
+	/** Strings interned in the current document's arena. */
+	cyaml_intern_t intern;
+	/** Whether aliases share the allocations of anchored values. */
+	bool use_aliases;
+	/** Anchored values found in the current document. */
+	cyaml_anchors_t anchors;
+	/** Whether every document in the stream is to be loaded. */
+	bool stream;
+	/** Compiled schema for the current load, or NULL. */
+	const cyaml_schema_compiled_t *compiled;
+	/** Scratch space for mapping bit fields, used as a stack. */
+	cyaml_bitfield_t *bitfields;
+	uint32_t bitfields_used; /**< Bit field words in use. */
+	uint32_t bitfields_max;  /**< Current bit field allocation limit. */
+	/** Bytes counted against the config's byte limit, per document. */
+	size_t limit_bytes;
+	/** Entries counted against the config's entry limit, per document. */
+	uint64_t limit_entries;
 } cyaml_ctx_t;
 
 /**
@@ -130,6 +214,107 @@ static const char * cyaml__libyaml_event_type_str(const yaml_event_t *event)
 	return strings[event->type];
 }
 
+/**
+ * Fail a load for exceeding one of the config's resource limits.
+ *
+ * \param[in]  ctx   The CYAML loading context.
+ * \param[in]  what  Name of the limit that was exceeded.
+ * \param[in]  max   The limit.
+ * \return \ref CYAML_ERR_LIMIT_EXCEEDED.
+ */
+static cyaml_err_t cyaml__limit_exceeded(
+		const cyaml_ctx_t *ctx,
+		const char *what,
+		uint64_t max)
+{
+	cyaml__log(ctx->config, CYAML_LOG_ERROR,
+			"Load limit exceeded: %s (%"PRIu64" max)\n",
+			what, max);
+	return CYAML_ERR_LIMIT_EXCEEDED;
+}
+
+/**
+ * Check a YAML event against the config's scalar length limit.
+ *
+ * \param[in]  ctx    The CYAML loading context.
+ * \param[in]  event  The YAML event to check.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static inline cyaml_err_t cyaml__limit_scalar(
+		const cyaml_ctx_t *ctx,
+		const yaml_event_t *event)
+{
+	size_t max = ctx->config->limits.max_scalar_len;
+
+	if (max != 0 && event->type == YAML_SCALAR_EVENT &&
+	    event->data.scalar.length > max) {
+		return cyaml__limit_exceeded(ctx, "scalar length", max);
+	}
+
+	return CYAML_OK;
+}
+
+/**
+ * Count an entry against the config's entry limit.
+ *
+ * \param[in]  ctx  The CYAML loading context.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static inline cyaml_err_t cyaml__limit_entry(
+		cyaml_ctx_t *ctx)
+{
+	uint64_t max = ctx->config->limits.max_entries;
+
+	if (max != 0 && ++ctx->limit_entries > max) {
+		return cyaml__limit_exceeded(ctx, "entries", max);
+	}
+
+	return CYAML_OK;
+}
+
+/**
+ * Check a collection nesting depth against the config's depth limit.
+ *
+ * \param[in]  ctx    The CYAML loading context.
+ * \param[in]  depth  Nesting depth of the collection, from one.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static inline cyaml_err_t cyaml__limit_depth(
+		const cyaml_ctx_t *ctx,
+		uint32_t depth)
+{
+	uint32_t max = ctx->config->limits.max_depth;
+
+	if (max != 0 && depth > max) {
+		return cyaml__limit_exceeded(ctx, "nesting depth", max);
+	}
+
+	return CYAML_OK;
+}
+
+/**
+ * Count an allocation for loaded data against the config's byte limit.
+ *
+ * \param[in]  ctx   The CYAML loading context.
+ * \param[in]  size  Size of the new allocation, or of its growth, in bytes.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static inline cyaml_err_t cyaml__limit_bytes(
+		cyaml_ctx_t *ctx,
+		size_t size)
+{
+	size_t max = ctx->config->limits.max_bytes;
+
+	if (max != 0) {
+		if (size > max - ctx->limit_bytes) {
+			return cyaml__limit_exceeded(ctx, "bytes", max);
+		}
+		ctx->limit_bytes += size;
+	}
+
+	return CYAML_OK;
+}
+
 /**
  * Helper function to read the next YAML input event.
  *
@@ -144,14 +329,24 @@ static cyaml_err_t cyaml_get_next_event(
 		const cyaml_ctx_t *ctx,
 		yaml_event_t *event)
 {
+	cyaml_err_t err;
+
+	CYAML_STATS_TIMER_START(ctx->config, parse);
+
+	cyaml_static_assert((int)CYAML_STATS_EVT_NONE == (int)YAML_NO_EVENT);
+	cyaml_static_assert((int)CYAML_STATS_EVT_MAP_END ==
+			(int)YAML_MAPPING_END_EVENT);
+
 	if (!yaml_parser_parse(ctx->parser, event)) {
 		cyaml__log(ctx->config, CYAML_LOG_ERROR,
 				"libyaml: %s\n", ctx->parser->problem);
 		return CYAML_ERR_LIBYAML_PARSER;
 	}
 
-	if (event->type == YAML_ALIAS_EVENT) {
-		/** \todo Add support for alias? */
+	CYAML_STATS_TIMER_END(ctx->config, parse_ns, parse);
+	CYAML_STATS_INC(ctx->config, events[event->type]);
+
+	if (event->type == YAML_ALIAS_EVENT && !ctx->use_aliases) {
 		yaml_event_delete(event);
 		return CYAML_ERR_ALIAS;
 	}
@@ -159,6 +354,12 @@ static cyaml_err_t cyaml_get_next_event(
 	cyaml__log(ctx->config, CYAML_LOG_DEBUG, "Event: %s\n",
 			cyaml__libyaml_event_type_str(event));
 
+	err = cyaml__limit_scalar(ctx, event);
+	if (err != CYAML_OK) {
+		yaml_event_delete(event);
+		return err;
+	}
+
 	return CYAML_OK;
 }
 
@@ -178,8 +379,18 @@ static inline uint16_t cyaml__get_entry_from_mapping_schema(
 	const cyaml_schema_value_t *schema = ctx->state->schema;
 	uint16_t index = 0;
 
+	if (ctx->state->mapping.index != NULL) {
+		/* Expect the field following the previous key. */
+		uint16_t prev = ctx->state->mapping.schema_idx;
+		uint16_t hint = (prev == CYAML_SCHEMA_IDX_NONE) ? 0 : prev + 1;
+
+		return cyaml_index_lookup(ctx->config,
+				ctx->state->mapping.index, key, hint);
+	}
+
 	/* Step through each entry in the schema */
 	for (; fields->key != NULL; fields++) {
+		CYAML_STATS_INC(ctx->config, key_probes);
 		if (cyaml__strcmp(ctx->config, schema, fields->key, key) == 0) {
 			return index;
 		}
@@ -222,7 +433,9 @@ static cyaml_err_t cyaml__stack_ensure(
 		cyaml_ctx_t *ctx)
 {
 	cyaml_state_t *temp;
-	uint32_t max = ctx->stack_max + 16;
+	uint32_t max = (ctx->stack_max == 0) ? 16 : ctx->stack_max * 2;
+
+	CYAML_STATS_MAX(ctx->config, stack_peak, ctx->stack_idx + 1);
 
 	if (ctx->stack_idx < ctx->stack_max) {
 		return CYAML_OK;
@@ -242,31 +455,68 @@ static cyaml_err_t cyaml__stack_ensure(
 }
 
 /**
- * Count the entries in a mapping schema array.
+ * Get a mapping state's bitfield array.
  *
- * The mapping schema array must be terminated by an entry with a NULL key.
+ * \param[in]  ctx    The CYAML loading context.
+ * \param[in]  state  CYAML load state for a mapping.
+ * \return the mapping's bit field of fields found.
+ */
+static inline cyaml_bitfield_t * cyaml__mapping_bitfield(
+		cyaml_ctx_t *ctx,
+		cyaml_state_t *state)
+{
+	if (state->mapping.entries_count <= CYAML_BITFIELD_INLINE_FIELDS) {
+		return state->mapping.inline_fields;
+	}
+
+	return ctx->bitfields + state->mapping.fields;
+}
+
+/**
+ * Ensure the context's bitfield scratch space has room for more words.
  *
- * \param[in]  mapping_schema  Array of mapping schema fields.
- * \return Number of entries in mapping_schema array.
+ * \param[in]  ctx    The CYAML loading context.
+ * \param[in]  words  Number of words needed above those in use.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
  */
-static uint16_t cyaml__get_entry_count_from_mapping_schema(
-		const cyaml_schema_field_t *mapping_schema)
+static cyaml_err_t cyaml__bitfields_ensure(
+		cyaml_ctx_t *ctx,
+		uint32_t words)
 {
-	const cyaml_schema_field_t *entry = mapping_schema;
+	cyaml_bitfield_t *temp;
+	uint32_t max = (ctx->bitfields_max == 0) ? 16 : ctx->bitfields_max;
+
+	if (words <= ctx->bitfields_max - ctx->bitfields_used) {
+		return CYAML_OK;
+	}
+
+	while (max < ctx->bitfields_used + words) {
+		max *= 2;
+	}
 
-	while (entry->key != NULL) {
-		entry++;
+	temp = cyaml__realloc(ctx->config, ctx->bitfields, 0,
+			sizeof(*temp) * max, false);
+	if (temp == NULL) {
+		return CYAML_ERR_OOM;
 	}
 
-	return entry - mapping_schema;
+	ctx->bitfields = temp;
+	ctx->bitfields_max = max;
+
+	return CYAML_OK;
 }
 
 /**
- * Create \ref CYAML_STATE_IN_MAP_KEY state's bitfield array allocation.
+ * Create \ref CYAML_STATE_IN_MAP_KEY state's bitfield array.
  *
  * The bitfield is used to record whether the mapping as all the required
  * fields by mapping schema array index.
  *
+ * For mappings with up to \ref CYAML_BITFIELD_INLINE_FIELDS fields the
+ * bitfield lives in the state.  Larger mappings nest, so their bitfields
+ * are taken from the top of the context's scratch space, which is only
+ * reallocated when it is too small for the deepest nesting seen so far.
+ *
  * \param[in]  ctx    The CYAML loading context.
  * \param[in]  state  CYAML load state for a \ref CYAML_STATE_IN_MAP_KEY state.
  * \return \ref CYAML_OK on success, or appropriate error code otherwise.
@@ -275,24 +525,30 @@ static cyaml_err_t cyaml__mapping_bitfieid_create(
 		cyaml_ctx_t *ctx,
 		cyaml_state_t *state)
 {
-	cyaml_bitfield_t *bitfield;
-	unsigned count = cyaml__get_entry_count_from_mapping_schema(
-			state->mapping.schema);
-	size_t size = ((count + CYAML_BITFIELD_BITS - 1) / CYAML_BITFIELD_BITS)
-			* sizeof(*bitfield);
+	uint32_t words = cyaml__bitfield_words(state->mapping.entries_count);
+	cyaml_err_t err;
 
-	bitfield = cyaml__alloc(ctx->config, size, true);
-	if (bitfield == NULL) {
-		return CYAML_ERR_OOM;
+	state->mapping.fields = ctx->bitfields_used;
+	if (words == 0) {
+		memset(state->mapping.inline_fields, 0,
+				sizeof(state->mapping.inline_fields));
+		return CYAML_OK;
+	}
+
+	err = cyaml__bitfields_ensure(ctx, words);
+	if (err != CYAML_OK) {
+		return err;
 	}
 
-	state->mapping.fields = bitfield;
+	memset(ctx->bitfields + ctx->bitfields_used, 0,
+			sizeof(*ctx->bitfields) * words);
+	ctx->bitfields_used += words;
 
 	return CYAML_OK;
 }
 
 /**
- * Destroy a \ref CYAML_STATE_IN_MAP_KEY state's bitfield array allocation.
+ * Destroy a \ref CYAML_STATE_IN_MAP_KEY state's bitfield array.
  *
  * \param[in]  ctx    The CYAML loading context.
  * \param[in]  state  CYAML load state for a \ref CYAML_STATE_IN_MAP_KEY state.
@@ -301,7 +557,7 @@ static void cyaml__mapping_bitfieid_destroy(
 		cyaml_ctx_t *ctx,
 		cyaml_state_t *state)
 {
-	cyaml__free(ctx->config, state->mapping.fields);
+	ctx->bitfields_used = state->mapping.fields;
 }
 
 /**
@@ -315,10 +571,18 @@ static void cyaml__mapping_bitfieid_set(
 		cyaml_ctx_t *ctx)
 {
 	cyaml_state_t *state = ctx->state;
+	cyaml_bitfield_t *fields = cyaml__mapping_bitfield(ctx, state);
 	unsigned idx = state->mapping.schema_idx;
+	cyaml_bitfield_t bit = (cyaml_bitfield_t)1 <<
+			(idx % CYAML_BITFIELD_BITS);
 
-	state->mapping.fields[idx / CYAML_BITFIELD_BITS] |=
-			1 << (idx % CYAML_BITFIELD_BITS);
+	if (state->mapping.projected &&
+	    !(fields[idx / CYAML_BITFIELD_BITS] & bit) &&
+	    !(state->mapping.schema[idx].value.flags & CYAML_FLAG_OPTIONAL)) {
+		state->mapping.required_left--;
+	}
+
+	fields[idx / CYAML_BITFIELD_BITS] |= bit;
 }
 
 /**
@@ -338,15 +602,15 @@ static cyaml_err_t cyaml__mapping_bitfieid_validate(
 		cyaml_ctx_t *ctx)
 {
 	cyaml_state_t *state = ctx->state;
-	unsigned count = cyaml__get_entry_count_from_mapping_schema(
-			state->mapping.schema);
+	const cyaml_bitfield_t *fields = cyaml__mapping_bitfield(ctx, state);
+	unsigned count = state->mapping.entries_count;
 
 	for (unsigned i = 0; i < count; i++) {
 		if (state->mapping.schema[i].value.flags & CYAML_FLAG_OPTIONAL) {
 			continue;
 		}
-		if (state->mapping.fields[i / CYAML_BITFIELD_BITS] &
-				(1 << (i % CYAML_BITFIELD_BITS))) {
+		if (fields[i / CYAML_BITFIELD_BITS] & ((cyaml_bitfield_t)1 <<
+				(i % CYAML_BITFIELD_BITS))) {
 			continue;
 		}
 		cyaml__log(ctx->config, CYAML_LOG_ERROR,
@@ -371,6 +635,64 @@ static inline bool cyaml__is_sequence(const cyaml_schema_value_t *schema)
 	        (schema->type == CYAML_SEQUENCE_FIXED));
 }
 
+/**
+ * Check whether a sequence's entries can be loaded in bulk.
+ *
+ * This is the case when \ref cyaml_schema_entry_is_bulk allows it, as it
+ * does for saving.  Streamed sequences are excluded, since their entries
+ * pass through the client's entry_fn.
+ *
+ * \param[in]  state  CYAML load state for a \ref CYAML_STATE_IN_SEQUENCE
+ *                    state.
+ * \return true if the entries can be loaded in bulk, false otherwise.
+ */
+static bool cyaml__seq_is_bulk(
+		const cyaml_state_t *state)
+{
+	return !state->sequence.streamed &&
+			cyaml_schema_entry_is_bulk(
+					state->schema->sequence.entry);
+}
+
+/**
+ * Set up a \ref CYAML_STATE_IN_MAP_KEY state's field count and key index.
+ *
+ * \param[in]  ctx     The CYAML loading context.
+ * \param[in]  schema  The CYAML schema for the mapping.
+ * \param[in]  state   CYAML load state for a \ref CYAML_STATE_IN_MAP_KEY state.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__mapping_info(
+		cyaml_ctx_t *ctx,
+		const cyaml_schema_value_t *schema,
+		cyaml_state_t *state)
+{
+	bool case_sensitive = cyaml__is_case_sensitive(ctx->config, schema);
+
+	if (ctx->compiled != NULL) {
+		const cyaml_schema_mapping_info_t *info =
+				cyaml_schema_compiled_mapping(ctx->compiled,
+						schema->mapping.fields,
+						case_sensitive);
+		if (info != NULL) {
+			state->mapping.entries_count = info->count;
+			state->mapping.required_left = info->required;
+			state->mapping.index = info->index;
+			return CYAML_OK;
+		}
+	}
+
+	state->mapping.entries_count = cyaml_schema_field_count(
+			schema->mapping.fields);
+	if (ctx->config->flags & CYAML_CFG_PROJECTION) {
+		state->mapping.required_left = cyaml_schema_required_count(
+				schema->mapping.fields);
+	}
+	return cyaml_index_get(ctx->config, &ctx->index_cache,
+			schema->mapping.fields, case_sensitive,
+			&state->mapping.index);
+}
+
 /**
  * Push a new entry onto the CYAML load context's stack.
  *
@@ -393,6 +715,15 @@ static cyaml_err_t cyaml__stack_push(
 		.schema = schema,
 	};
 
+	if (state == CYAML_STATE_IN_MAP_KEY ||
+	    state == CYAML_STATE_IN_SEQUENCE) {
+		err = cyaml__limit_depth(ctx, ctx->stack_idx + 1 -
+				CYAML_PRESIZE_STACK_BASE);
+		if (err != CYAML_OK) {
+			return err;
+		}
+	}
+
 	err = cyaml__stack_ensure(ctx);
 	if (err != CYAML_OK) {
 		return err;
@@ -402,6 +733,13 @@ static cyaml_err_t cyaml__stack_push(
 	case CYAML_STATE_IN_MAP_KEY:
 		assert(schema->type == CYAML_MAPPING);
 		s.mapping.schema = schema->mapping.fields;
+		s.mapping.schema_idx = CYAML_SCHEMA_IDX_NONE;
+		err = cyaml__mapping_info(ctx, schema, &s);
+		if (err != CYAML_OK) {
+			return err;
+		}
+		s.mapping.projected = (s.mapping.required_left > 0) &&
+				(ctx->config->flags & CYAML_CFG_PROJECTION);
 		err = cyaml__mapping_bitfieid_create(ctx, &s);
 		if (err != CYAML_OK) {
 			return err;
@@ -428,8 +766,11 @@ static cyaml_err_t cyaml__stack_push(
 				assert(ctx->state->state == CYAML_STATE_IN_DOC);
 				s.sequence.count_data = (void *)&ctx->seq_count;
 				s.sequence.count_size = sizeof(ctx->seq_count);
+				s.sequence.streamed =
+						(ctx->config->entry_fn != NULL);
 			}
 		}
+		s.sequence.bulk = cyaml__seq_is_bulk(&s);
 		break;
 	default:
 		break;
@@ -478,11 +819,43 @@ static void cyaml__stack_pop(
 	ctx->stack_idx = idx;
 }
 
+/**
+ * Get the new entry capacity for a growing sequence allocation.
+ *
+ * The first allocation is sized for the schema's expected entry count, and
+ * after that the capacity doubles, so the number of reallocations is
+ * logarithmic in the number of entries.  The capacity never exceeds the
+ * schema's maximum entry count.
+ *
+ * \param[in]  schema    The schema for the sequence value.
+ * \param[in]  capacity  The sequence's current entry capacity.
+ * \return the entry capacity to grow the sequence allocation to.
+ */
+static inline uint32_t cyaml__seq_grow(
+		const cyaml_schema_value_t *schema,
+		uint32_t capacity)
+{
+	uint32_t max = schema->sequence.max;
+
+	if (capacity == 0) {
+		capacity = schema->seq_expected;
+		if (capacity == 0) {
+			capacity = 1;
+		}
+	} else if (capacity <= max / 2) {
+		capacity *= 2;
+	} else {
+		capacity = max;
+	}
+
+	return (capacity < max) ? capacity : max;
+}
+
 /**
  * Helper to make allocations for loaded YAML values.
  *
  * If the current state is sequence, this extends any existing allocation
- * for the sequence.
+ * for the sequence, if it has no space for another entry.
  *
  * The current CYAML loading context's state is updated with new allocation
  * address, where necessary.
@@ -502,23 +875,37 @@ static cyaml_err_t cyaml__data_handle_pointer(
 		uint8_t **value_data_io)
 {
 	cyaml_state_t *state = ctx->state;
+	cyaml_err_t err;
 
 	if (schema->flags & CYAML_FLAG_POINTER) {
 		/* Need to create/extend an allocation. */
 		size_t delta = schema->data_size;
 		uint8_t *value_data = NULL;
+		uint32_t capacity = 0;
 		size_t offset = 0;
 
 		if (schema->type == CYAML_STRING) {
 			/* For a string the allocation size is the string
 			 * size from the event, plus trailing NULL. */
-			delta = strlen((const char *)
-					event->data.scalar.value) + 1;
+			delta = event->data.scalar.length + 1;
 		}
 
 		if (schema->type == CYAML_SEQUENCE) {
-			/* Sequence; could be extending allocation. */
-			offset = schema->data_size * state->sequence.count;
+			/* Sequence; could be extending allocation.
+			 * Streamed sequences only need one entry slot. */
+			if (state->sequence.count < state->sequence.capacity ||
+			    (state->sequence.streamed &&
+			     state->sequence.capacity > 0)) {
+				*value_data_io = state->sequence.data;
+				return CYAML_OK;
+			}
+			capacity = state->sequence.streamed ? 1 :
+					cyaml__seq_grow(schema,
+						state->sequence.capacity);
+			offset = (size_t)schema->data_size *
+					state->sequence.capacity;
+			delta = (size_t)schema->data_size *
+					(capacity - state->sequence.capacity);
 			value_data = state->sequence.data;
 		} else if (schema->type == CYAML_SEQUENCE_FIXED) {
 			/* Allocation is only made for full fixed size
@@ -527,11 +914,27 @@ static cyaml_err_t cyaml__data_handle_pointer(
 				*value_data_io = state->sequence.data;
 				return CYAML_OK;
 			}
-			delta = schema->data_size * schema->sequence.max;
+			delta = (size_t)schema->data_size *
+					schema->sequence.max;
+			capacity = schema->sequence.max;
+		}
+
+		err = cyaml__limit_bytes(ctx, delta);
+		if (err != CYAML_OK) {
+			return err;
 		}
 
-		value_data = cyaml__realloc(ctx->config, value_data,
-				offset, offset + delta, true);
+		if (ctx->use_arena) {
+			/* The root allocation is found at the bottom of the
+			 * stack, and is what the arena can be freed by. */
+			value_data = cyaml_arena_realloc(ctx->config,
+					&ctx->arena, value_data,
+					offset, offset + delta,
+					*value_data_io == ctx->stack[0].data);
+		} else {
+			value_data = cyaml__realloc(ctx->config, value_data,
+					offset, offset + delta, true);
+		}
 		if (value_data == NULL) {
 			return CYAML_ERR_OOM;
 		}
@@ -544,6 +947,7 @@ static cyaml_err_t cyaml__data_handle_pointer(
 			/* Updated the in sequence state so it knows the new
 			 * allocation address. */
 			state->sequence.data = value_data;
+			state->sequence.capacity = capacity;
 		}
 
 		/* Write the allocation pointer into the data structure. */
@@ -607,17 +1011,18 @@ static void cyaml__backtrace(
  * \param[in]  ctx     The CYAML loading context.
  * \param[in]  schema  The schema for the value to be read.
  * \param[in]  value   String containing scaler value.
+ * \param[in]  len     Length of value in bytes.
  * \param[in]  data    The place to write the value in the output data.
  * \return \ref CYAML_OK on success, or appropriate error code otherwise.
  */
 static cyaml_err_t cyaml__read_int(
-		const cyaml_ctx_t *ctx,
+		cyaml_ctx_t *ctx,
 		const cyaml_schema_value_t *schema,
 		const char *value,
+		size_t len,
 		uint8_t *data)
 {
-	long long temp;
-	char *end = NULL;
+	int64_t temp;
 	int64_t max;
 	int64_t min;
 
@@ -630,10 +1035,7 @@ static cyaml_err_t cyaml__read_int(
 	max = ((~(uint64_t)0) >> ((8 - schema->data_size) * 8)) / 2;
 	min = (-max) - 1;
 
-	errno = 0;
-	temp = strtoll(value, &end, 0);
-
-	if (end == value || errno == ERANGE ||
+	if (!cyaml_number_parse_int(value, len, &temp) ||
 	    temp < min || temp > max) {
 		return CYAML_ERR_INVALID_VALUE;
 	}
@@ -647,17 +1049,18 @@ static cyaml_err_t cyaml__read_int(
  * \param[in]  ctx     The CYAML loading context.
  * \param[in]  schema  The schema for the value to be read.
  * \param[in]  value   String containing scaler value.
+ * \param[in]  len     Length of value in bytes.
  * \param[in]  data    The place to write the value in the output data.
  * \return \ref CYAML_OK on success, or appropriate error code otherwise.
  */
 static cyaml_err_t cyaml__read_uint(
-		const cyaml_ctx_t *ctx,
+		cyaml_ctx_t *ctx,
 		const cyaml_schema_value_t *schema,
 		const char *value,
+		size_t len,
 		uint8_t *data)
 {
-	long long temp;
-	char *end = NULL;
+	uint64_t temp;
 	uint64_t max;
 
 	CYAML_UNUSED(ctx);
@@ -668,11 +1071,7 @@ static cyaml_err_t cyaml__read_uint(
 
 	max = (~(uint64_t)0) >> ((8 - schema->data_size) * 8);
 
-	errno = 0;
-	temp = strtoll(value, &end, 0);
-
-	if (end == value || errno == ERANGE ||
-	    temp < 0 || (uint64_t)temp > max) {
+	if (!cyaml_number_parse_uint(value, len, &temp) || temp > max) {
 		return CYAML_ERR_INVALID_VALUE;
 	}
 
@@ -685,30 +1084,73 @@ static cyaml_err_t cyaml__read_uint(
  * \param[in]  ctx     The CYAML loading context.
  * \param[in]  schema  The schema for the value to be read.
  * \param[in]  value   String containing scaler value.
+ * \param[in]  len     Length of value in bytes.
  * \param[in]  data    The place to write the value in the output data.
  * \return \ref CYAML_OK on success, or appropriate error code otherwise.
  */
 static cyaml_err_t cyaml__read_bool(
-		const cyaml_ctx_t *ctx,
+		cyaml_ctx_t *ctx,
 		const cyaml_schema_value_t *schema,
 		const char *value,
+		size_t len,
 		uint8_t *data)
 {
-	bool temp = true;
-	static const char * const false_strings[] = {
-		"false", "no", "disable", "0",
-	};
-
 	CYAML_UNUSED(ctx);
 
-	for (uint32_t i = 0; i < CYAML_ARRAY_LEN(false_strings); i++) {
-		if (cyaml_utf8_casecmp(value, false_strings[i]) == 0) {
-			temp = false;
-			break;
+	return cyaml_data_write(cyaml__parse_bool(value, len),
+			schema->data_size, data);
+}
+
+/**
+ * Find the entry for a string in an enum or flags schema's string values.
+ *
+ * \param[in]  ctx      The CYAML loading context.
+ * \param[in]  schema   The \ref CYAML_ENUM or \ref CYAML_FLAGS schema.
+ * \param[in]  value    String to look up.
+ * \param[out] idx_out  Returns index in the schema's string value array,
+ *                      or \ref CYAML_STRVAL_IDX_NONE if not found.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__strval_find(
+		cyaml_ctx_t *ctx,
+		const cyaml_schema_value_t *schema,
+		const char *value,
+		uint32_t *idx_out)
+{
+	const cyaml_strval_t *strings = schema->enumeration.strings;
+	const cyaml_schema_value_info_t *info = NULL;
+	const cyaml_strval_index_t *index;
+
+	if (ctx->compiled != NULL) {
+		info = cyaml_schema_compiled_value(ctx->compiled, schema);
+	}
+	if (info != NULL) {
+		index = info->strval;
+	} else {
+		cyaml_err_t err = cyaml_index_strval_get(ctx->config,
+				&ctx->index_cache, schema,
+				cyaml__is_case_sensitive(ctx->config, schema),
+				&index);
+		if (err != CYAML_OK) {
+			return err;
 		}
 	}
 
-	return cyaml_data_write(temp, schema->data_size, data);
+	if (index != NULL) {
+		*idx_out = cyaml_index_strval_by_str(index, value);
+		return CYAML_OK;
+	}
+
+	for (uint32_t i = 0; i < schema->enumeration.count; i++) {
+		if (cyaml__strcmp(ctx->config, schema,
+				value, strings[i].str) == 0) {
+			*idx_out = i;
+			return CYAML_OK;
+		}
+	}
+
+	*idx_out = CYAML_STRVAL_IDX_NONE;
+	return CYAML_OK;
 }
 
 /**
@@ -717,23 +1159,29 @@ static cyaml_err_t cyaml__read_bool(
  * \param[in]  ctx     The CYAML loading context.
  * \param[in]  schema  The schema for the value to be read.
  * \param[in]  value   String containing scaler value.
+ * \param[in]  len     Length of value in bytes.
  * \param[in]  data    The place to write the value in the output data.
  * \return \ref CYAML_OK on success, or appropriate error code otherwise.
  */
 static cyaml_err_t cyaml__read_enum(
-		const cyaml_ctx_t *ctx,
+		cyaml_ctx_t *ctx,
 		const cyaml_schema_value_t *schema,
 		const char *value,
+		size_t len,
 		uint8_t *data)
 {
 	const cyaml_strval_t *strings = schema->enumeration.strings;
+	cyaml_err_t err;
+	uint32_t i;
 
-	for (uint32_t i = 0; i < schema->enumeration.count; i++) {
-		if (cyaml__strcmp(ctx->config, schema,
-				value, strings[i].str) == 0) {
-			return cyaml_data_write(strings[i].val,
-					schema->data_size, data);
-		}
+	err = cyaml__strval_find(ctx, schema, value, &i);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	if (i != CYAML_STRVAL_IDX_NONE) {
+		return cyaml_data_write(strings[i].val,
+				schema->data_size, data);
 	}
 
 	if (schema->flags & CYAML_FLAG_STRICT) {
@@ -743,7 +1191,7 @@ static cyaml_err_t cyaml__read_enum(
 
 	}
 
-	return cyaml__read_int(ctx, schema, value, data);
+	return cyaml__read_int(ctx, schema, value, len, data);
 }
 
 /**
@@ -752,6 +1200,7 @@ static cyaml_err_t cyaml__read_enum(
  * \param[in]  ctx     The CYAML loading context.
  * \param[in]  schema  The schema for the value to be read.
  * \param[in]  value   String containing scaler value.
+ * \param[in]  len     Length of value in bytes.
  * \param[in]  data    The place to write the value in the output data.
  * \return \ref CYAML_OK on success, or appropriate error code otherwise.
  */
@@ -759,20 +1208,17 @@ static cyaml_err_t cyaml__read_float_f(
 		const cyaml_ctx_t *ctx,
 		const cyaml_schema_value_t *schema,
 		const char *value,
+		size_t len,
 		uint8_t *data)
 {
 	float temp;
-	char *end = NULL;
 
 	assert(schema->data_size == sizeof(temp));
 
 	CYAML_UNUSED(ctx);
 	CYAML_UNUSED(schema);
 
-	errno = 0;
-	temp = strtof(value, &end);
-
-	if (end == value || errno == ERANGE) {
+	if (!cyaml_number_parse_float(value, len, &temp)) {
 		return CYAML_ERR_INVALID_VALUE;
 	}
 
@@ -787,6 +1233,7 @@ static cyaml_err_t cyaml__read_float_f(
  * \param[in]  ctx     The CYAML loading context.
  * \param[in]  schema  The schema for the value to be read.
  * \param[in]  value   String containing scaler value.
+ * \param[in]  len     Length of value in bytes.
  * \param[in]  data    The place to write the value in the output data.
  * \return \ref CYAML_OK on success, or appropriate error code otherwise.
  */
@@ -794,20 +1241,17 @@ static cyaml_err_t cyaml__read_float_d(
 		const cyaml_ctx_t *ctx,
 		const cyaml_schema_value_t *schema,
 		const char *value,
+		size_t len,
 		uint8_t *data)
 {
 	double temp;
-	char *end = NULL;
 
 	assert(schema->data_size == sizeof(temp));
 
 	CYAML_UNUSED(ctx);
 	CYAML_UNUSED(schema);
 
-	errno = 0;
-	temp = strtod(value, &end);
-
-	if (end == value || errno == ERANGE) {
+	if (!cyaml_number_parse_double(value, len, &temp)) {
 		return CYAML_ERR_INVALID_VALUE;
 	}
 
@@ -828,19 +1272,22 @@ static cyaml_err_t cyaml__read_float_d(
  * \param[in]  ctx     The CYAML loading context.
  * \param[in]  schema  The schema for the value to be read.
  * \param[in]  value   String containing scaler value.
+ * \param[in]  len     Length of value in bytes.
  * \param[in]  data    The place to write the value in the output data.
  * \return \ref CYAML_OK on success, or appropriate error code otherwise.
  */
 static cyaml_err_t cyaml__read_float(
-		const cyaml_ctx_t *ctx,
+		cyaml_ctx_t *ctx,
 		const cyaml_schema_value_t *schema,
 		const char *value,
+		size_t len,
 		uint8_t *data)
 {
 	typedef cyaml_err_t (*cyaml_float_fn)(
 			const cyaml_ctx_t *ctx,
 			const cyaml_schema_value_t *schema,
 			const char *value,
+			size_t len,
 			uint8_t *data_target);
 	struct float_fns {
 		size_t size;
@@ -860,65 +1307,138 @@ static cyaml_err_t cyaml__read_float(
 	for (unsigned i = 0; i < CYAML_ARRAY_LEN(fns); i++) {
 		if (fns[i].size == schema->data_size) {
 			assert(fns[i].func != NULL);
-			return fns[i].func(ctx, schema, value, data);
+			return fns[i].func(ctx, schema, value, len, data);
 		}
 	}
 
 	return CYAML_ERR_INVALID_DATA_SIZE;
 }
 
+/**
+ * Check a string's length against its schema's limits.
+ *
+ * Compiled schemas have already had their limits checked.
+ *
+ * \param[in]  ctx     The CYAML loading context.
+ * \param[in]  schema  The schema for the string value.
+ * \param[in]  len     Length of the string in bytes.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static inline cyaml_err_t cyaml__check_string_length(
+		const cyaml_ctx_t *ctx,
+		const cyaml_schema_value_t *schema,
+		size_t len)
+{
+	if (ctx->compiled == NULL &&
+	    schema->string.min > schema->string.max) {
+		return CYAML_ERR_BAD_MIN_MAX_SCHEMA;
+	} else if (len < schema->string.min) {
+		return CYAML_ERR_STRING_LENGTH_MIN;
+	} else if (len > schema->string.max) {
+		return CYAML_ERR_STRING_LENGTH_MAX;
+	}
+
+	return CYAML_OK;
+}
+
 /**
  * Read a value of type \ref CYAML_STRING.
  *
  * \param[in]  ctx     The CYAML loading context.
  * \param[in]  schema  The schema for the value to be read.
  * \param[in]  value   String containing scaler value.
+ * \param[in]  len     Length of value in bytes.
  * \param[in]  data    The place to write the value in the output data.
  * \return \ref CYAML_OK on success, or appropriate error code otherwise.
  */
 static cyaml_err_t cyaml__read_string(
-		const cyaml_ctx_t *ctx,
+		cyaml_ctx_t *ctx,
 		const cyaml_schema_value_t *schema,
 		const char *value,
+		size_t len,
 		uint8_t *data)
 {
-	size_t str_len = strlen(value);
-
-	CYAML_UNUSED(ctx);
+	cyaml_err_t err;
 
-	if (schema->string.min > schema->string.max) {
-		return CYAML_ERR_BAD_MIN_MAX_SCHEMA;
-	} else if (str_len < schema->string.min) {
-		return CYAML_ERR_STRING_LENGTH_MIN;
-	} else if (str_len > schema->string.max) {
-		return CYAML_ERR_STRING_LENGTH_MAX;
+	err = cyaml__check_string_length(ctx, schema, len);
+	if (err != CYAML_OK) {
+		return err;
 	}
 
-	memcpy(data, value, str_len + 1);
+	memcpy(data, value, len + 1);
 
 	return CYAML_OK;
 }
 
 /**
- * Read a scalar value.
+ * Read a \ref CYAML_STRING value with \ref CYAML_FLAG_POINTER, by interning.
+ *
+ * Rather than making an allocation for this value, the value's pointer is
+ * set to the document's shared copy of the string.
  *
  * \param[in]  ctx     The CYAML loading context.
  * \param[in]  schema  The schema for the value to be read.
- * \param[in]  data    The place to write the value in the output data.
+ * \param[in]  data    The place to write the string pointer in the output
+ *                     data.
  * \param[in]  event   The `libyaml` event providing the scalar value data.
  * \return \ref CYAML_OK on success, or appropriate error code otherwise.
  */
-static cyaml_err_t cyaml__read_scalar_value(
-		const cyaml_ctx_t *ctx,
+static cyaml_err_t cyaml__read_string_interned(
+		cyaml_ctx_t *ctx,
 		const cyaml_schema_value_t *schema,
-		cyaml_data_t *data,
+		uint8_t *data,
+		const yaml_event_t *event)
+{
+	const char *value = (const char *)event->data.scalar.value;
+	size_t len = event->data.scalar.length;
+	const char *str;
+	cyaml_err_t err;
+
+	cyaml__log(ctx->config, CYAML_LOG_INFO, "  <%s>\n", value);
+
+	err = cyaml__check_string_length(ctx, schema, len);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	err = cyaml__limit_bytes(ctx, len + 1);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	str = cyaml_intern_get(ctx->config, &ctx->intern,
+			&ctx->arena, value, len);
+	if (str == NULL) {
+		return CYAML_ERR_OOM;
+	}
+
+	cyaml_data_write_pointer(str, data);
+
+	return CYAML_OK;
+}
+
+/**
+ * Read a scalar value.
+ *
+ * \param[in]  ctx     The CYAML loading context.
+ * \param[in]  schema  The schema for the value to be read.
+ * \param[in]  data    The place to write the value in the output data.
+ * \param[in]  event   The `libyaml` event providing the scalar value data.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__read_scalar_value(
+		cyaml_ctx_t *ctx,
+		const cyaml_schema_value_t *schema,
+		cyaml_data_t *data,
 		yaml_event_t *event)
 {
 	const char *value = (const char *)event->data.scalar.value;
+	size_t len = event->data.scalar.length;
 	typedef cyaml_err_t (*cyaml_read_scalar_fn)(
-			const cyaml_ctx_t *ctx,
+			cyaml_ctx_t *ctx,
 			const cyaml_schema_value_t *schema,
 			const char *value,
+			size_t len,
 			uint8_t *data_target);
 	static const cyaml_read_scalar_fn fn[CYAML__TYPE_COUNT] = {
 		[CYAML_INT]    = cyaml__read_int,
@@ -933,7 +1453,7 @@ static cyaml_err_t cyaml__read_scalar_value(
 
 	assert(fn[schema->type] != NULL);
 
-	return fn[schema->type](ctx, schema, value, data);
+	return fn[schema->type](ctx, schema, value, len, data);
 }
 
 /**
@@ -942,35 +1462,37 @@ static cyaml_err_t cyaml__read_scalar_value(
  * \param[in]      ctx        The CYAML loading context.
  * \param[in]      schema     The schema for the value to be read.
  * \param[in]      value      String containing scaler value.
+ * \param[in]      len        Length of value in bytes.
  * \param[in,out]  flags_out  Current flags, updated on success.
  * \return \ref CYAML_OK on success, or appropriate error code otherwise.
  */
 static cyaml_err_t cyaml__set_flag(
-		const cyaml_ctx_t *ctx,
+		cyaml_ctx_t *ctx,
 		const cyaml_schema_value_t *schema,
 		const char *value,
+		size_t len,
 		uint64_t *flags_out)
 {
 	const cyaml_strval_t *strings = schema->enumeration.strings;
+	cyaml_err_t err;
+	uint32_t i;
 
-	for (uint32_t i = 0; i < schema->enumeration.count; i++) {
-		if (cyaml__strcmp(ctx->config, schema,
-				value, strings[i].str) == 0) {
-			*flags_out |= strings[i].val;
-			return CYAML_OK;
-		}
+	err = cyaml__strval_find(ctx, schema, value, &i);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	if (i != CYAML_STRVAL_IDX_NONE) {
+		*flags_out |= strings[i].val;
+		return CYAML_OK;
 	}
 
 	if (!(schema->flags & CYAML_FLAG_STRICT)) {
-		long long temp;
-		char *end = NULL;
 		uint64_t max = (~(uint64_t)0) >> ((8 - schema->data_size) * 8);
+		uint64_t temp;
 
-		errno = 0;
-		temp = strtoll(value, &end, 0);
-
-		if (!(end == value || errno == ERANGE ||
-		      temp < 0 || (uint64_t)temp > max)) {
+		if (cyaml_number_parse_uint(value, len, &temp) &&
+		    temp <= max) {
 			*flags_out |= temp;
 			return CYAML_OK;
 		}
@@ -1015,7 +1537,7 @@ static cyaml_err_t cyaml__read_flags_value(
 		case CYAML_EVT_SCALAR:
 			err = cyaml__set_flag(ctx, schema,
 					(const char *)event.data.scalar.value,
-					&value);
+					event.data.scalar.length, &value);
 			if (err != CYAML_OK) {
 				yaml_event_delete(&event);
 				return err;
@@ -1043,6 +1565,79 @@ static cyaml_err_t cyaml__read_flags_value(
 	return err;
 }
 
+/**
+ * Skip YAML input events until the end of the current collection.
+ *
+ * Skipped events are not decoded, so this reads them directly from the
+ * parser, only tracking how deeply nested they are.  The `libyaml` parser
+ * still copies out skipped scalars; it has no way to read past them
+ * without doing so.
+ *
+ * \param[in]  ctx    The CYAML loading context.
+ * \param[in]  level  Number of collections to leave.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__skip_events(
+		cyaml_ctx_t *ctx,
+		unsigned level)
+{
+	cyaml_err_t err = CYAML_OK;
+
+	CYAML_STATS_TIMER_START(ctx->config, parse);
+
+	while (level > 0) {
+		yaml_event_t event;
+
+		if (!yaml_parser_parse(ctx->parser, &event)) {
+			cyaml__log(ctx->config, CYAML_LOG_ERROR,
+					"libyaml: %s\n", ctx->parser->problem);
+			return CYAML_ERR_LIBYAML_PARSER;
+		}
+		CYAML_STATS_INC(ctx->config, events[event.type]);
+
+		switch (event.type) {
+		case YAML_SEQUENCE_START_EVENT: /* Fall through */
+		case YAML_MAPPING_START_EVENT:
+			level++;
+			err = cyaml__limit_depth(ctx, ctx->stack_idx +
+					level - CYAML_PRESIZE_STACK_BASE);
+			if (err == CYAML_OK) {
+				err = cyaml__limit_entry(ctx);
+			}
+			break;
+
+		case YAML_SCALAR_EVENT:
+			err = cyaml__limit_scalar(ctx, &event);
+			if (err == CYAML_OK) {
+				err = cyaml__limit_entry(ctx);
+			}
+			break;
+
+		case YAML_SEQUENCE_END_EVENT: /* Fall through */
+		case YAML_MAPPING_END_EVENT:
+			level--;
+			break;
+
+		case YAML_ALIAS_EVENT:
+			err = ctx->use_aliases ?
+					cyaml__limit_entry(ctx) :
+					CYAML_ERR_ALIAS;
+			break;
+
+		default:
+			break;
+		}
+		yaml_event_delete(&event);
+		if (err != CYAML_OK) {
+			break;
+		}
+	}
+
+	CYAML_STATS_TIMER_END(ctx->config, parse_ns, parse);
+
+	return err;
+}
+
 /**
  * Entirely consume an ignored value.
  *
@@ -1065,38 +1660,166 @@ static cyaml_err_t cyaml__consume_ignored_value(
 		cyaml_ctx_t *ctx,
 		cyaml_event_t cyaml_event)
 {
-	if (cyaml_event != CYAML_EVT_SCALAR) {
-		unsigned level = 1;
+	CYAML_STATS_INC(ctx->config, ignored_values);
 
+	if (cyaml_event != CYAML_EVT_SCALAR &&
+	    cyaml_event != CYAML_EVT_ALIAS) {
 		assert(cyaml_event == CYAML_EVT_SEQ_START ||
 		       cyaml_event == CYAML_EVT_MAP_START);
 
-		while (level > 0) {
-			cyaml_err_t err;
-			yaml_event_t event;
+		return cyaml__skip_events(ctx, 1);
+	}
 
-			err = cyaml_get_next_event(ctx, &event);
-			if (err != CYAML_OK) {
-				return err;
-			}
-			switch (cyaml__get_event_type(&event)) {
-			case CYAML_EVT_SEQ_START: /* Fall through */
-			case CYAML_EVT_MAP_START:
-				level++;
-				break;
-
-			case CYAML_EVT_SEQ_END: /* Fall through */
-			case CYAML_EVT_MAP_END:
-				level--;
-				break;
-
-			default:
-				break;
-			}
-			yaml_event_delete(&event);
+	return CYAML_OK;
+}
+
+/**
+ * Get a YAML event's anchor name.
+ *
+ * \param[in]  event  The YAML event.
+ * \return the event's anchor name, or NULL if it has no anchor.
+ */
+static inline const char * cyaml__event_anchor(
+		const yaml_event_t *event)
+{
+	switch (event->type) {
+	case YAML_SCALAR_EVENT:
+		return (const char *)event->data.scalar.anchor;
+	case YAML_SEQUENCE_START_EVENT:
+		return (const char *)event->data.sequence_start.anchor;
+	case YAML_MAPPING_START_EVENT:
+		return (const char *)event->data.mapping_start.anchor;
+	default:
+		return NULL;
+	}
+}
+
+/**
+ * Record the anchor of a value that is starting to be loaded.
+ *
+ * Anchors are only recorded for \ref CYAML_FLAG_POINTER values, when
+ * aliases are in use.  Other anchors are ignored.
+ *
+ * \param[in]  ctx         The CYAML loading context.
+ * \param[in]  schema      The schema for the value.
+ * \param[in]  event       The YAML event starting the value.
+ * \param[out] anchor_out  Returns the anchor index plus one, or zero if
+ *                         the value's anchor is not recorded.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__anchor_start(
+		cyaml_ctx_t *ctx,
+		const cyaml_schema_value_t *schema,
+		const yaml_event_t *event,
+		uint32_t *anchor_out)
+{
+	const char *name = cyaml__event_anchor(event);
+	uint32_t index;
+	cyaml_err_t err;
+
+	*anchor_out = 0;
+
+	if (!ctx->use_aliases || name == NULL ||
+	    !(schema->flags & CYAML_FLAG_POINTER)) {
+		return CYAML_OK;
+	}
+
+	err = cyaml_anchors_add(ctx->config, &ctx->anchors,
+			name, strlen(name), schema, &index);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	cyaml__log(ctx->config, CYAML_LOG_DEBUG, "Anchor: &%s\n", name);
+
+	*anchor_out = index + 1;
+	return CYAML_OK;
+}
+
+/**
+ * Record that an anchored value has been completely loaded.
+ *
+ * \param[in]  ctx     The CYAML loading context.
+ * \param[in]  anchor  Anchor index plus one, or zero for no anchor.
+ * \param[in]  data    The value's allocation.
+ * \param[in]  count   The value's entry count, for sequences.
+ */
+static void cyaml__anchor_complete(
+		cyaml_ctx_t *ctx,
+		uint32_t anchor,
+		void *data,
+		uint32_t count)
+{
+	cyaml_anchor_t *a;
+
+	if (anchor == 0) {
+		return;
+	}
+
+	a = cyaml_anchors_get(&ctx->anchors, anchor - 1);
+	a->data = data;
+	a->count = count;
+	a->complete = true;
+}
+
+/**
+ * Read an alias, sharing the allocation of its anchored value.
+ *
+ * \param[in]  ctx     The CYAML loading context.
+ * \param[in]  schema  CYAML schema for the expected value.
+ * \param[in]  data    Pointer to where value's data should be written.
+ * \param[in]  event   The YAML alias event.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__read_alias(
+		cyaml_ctx_t *ctx,
+		const cyaml_schema_value_t *schema,
+		uint8_t *data,
+		const yaml_event_t *event)
+{
+	const char *name = (const char *)event->data.alias.anchor;
+	const cyaml_anchor_t *anchor;
+
+	cyaml__log(ctx->config, CYAML_LOG_INFO, "  <*%s>\n", name);
+
+	anchor = cyaml_anchors_find(&ctx->anchors, name, strlen(name));
+	if (anchor == NULL) {
+		cyaml__log(ctx->config, CYAML_LOG_ERROR,
+				"Alias to unknown anchor: %s\n", name);
+		return CYAML_ERR_INVALID_ALIAS;
+	}
+	if (!anchor->complete) {
+		cyaml__log(ctx->config, CYAML_LOG_ERROR,
+				"Alias within its anchored value: %s\n", name);
+		return CYAML_ERR_INVALID_ALIAS;
+	}
+	if (!cyaml_anchor_schema_match(anchor->schema, anchor->count,
+			schema)) {
+		cyaml__log(ctx->config, CYAML_LOG_ERROR,
+				"Alias to unsuitable value: %s\n", name);
+		return CYAML_ERR_INVALID_ALIAS;
+	}
+
+	if (schema->type == CYAML_SEQUENCE) {
+		const cyaml_schema_field_t *field;
+		cyaml_err_t err;
+
+		if (ctx->state->state != CYAML_STATE_IN_MAP_KEY) {
+			/* Top level aliases have no anchor to refer to, so
+			 * this is a sequence in a sequence. */
+			return CYAML_ERR_SEQUENCE_IN_SEQUENCE;
+		}
+
+		field = cyaml_mapping_schema_field(ctx);
+		err = cyaml_data_write(anchor->count, field->count_size,
+				ctx->state->data + field->count_offset);
+		if (err != CYAML_OK) {
+			return err;
 		}
 	}
 
+	cyaml_data_write_pointer(anchor->data, data);
+
 	return CYAML_OK;
 }
 
@@ -1117,12 +1840,41 @@ static cyaml_err_t cyaml__read_value(
 {
 	cyaml_event_t cyaml_event = cyaml__get_event_type(event);
 	cyaml_err_t err = CYAML_OK;
+	uint32_t anchor;
 
 	cyaml__log(ctx->config, CYAML_LOG_DEBUG,
 			"Reading value of type '%s'%s\n",
 			cyaml__type_to_str(schema->type),
 			schema->flags & CYAML_FLAG_POINTER ? " (pointer)" : "");
 
+	if (cyaml_event == CYAML_EVT_ALIAS) {
+		if (schema->type == CYAML_IGNORE) {
+			return cyaml__consume_ignored_value(ctx, cyaml_event);
+		}
+		return cyaml__read_alias(ctx, schema, data, event);
+	}
+
+	err = cyaml__anchor_start(ctx, schema, event, &anchor);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	if (ctx->use_intern && schema->type == CYAML_STRING &&
+	    (schema->flags & CYAML_FLAG_POINTER) &&
+	    data != ctx->stack[0].data) {
+		/* The root allocation needs its own arena link, so a
+		 * top level string is never shared. */
+		if (cyaml_event != CYAML_EVT_SCALAR) {
+			return CYAML_ERR_INVALID_VALUE;
+		}
+		err = cyaml__read_string_interned(ctx, schema, data, event);
+		if (err == CYAML_OK) {
+			cyaml__anchor_complete(ctx, anchor,
+					cyaml_data_read_pointer(data), 0);
+		}
+		return err;
+	}
+
 	if (!cyaml__is_sequence(schema)) {
 		/* Since sequences extend their allocation for each entry,
 		 * they're handled in the sequence-specific code.
@@ -1144,12 +1896,18 @@ static cyaml_err_t cyaml__read_value(
 			return CYAML_ERR_INVALID_VALUE;
 		}
 		err = cyaml__read_scalar_value(ctx, schema, data, event);
+		if (err == CYAML_OK) {
+			cyaml__anchor_complete(ctx, anchor, data, 0);
+		}
 		break;
 	case CYAML_FLAGS:
 		if (cyaml_event != CYAML_EVT_SEQ_START) {
 			return CYAML_ERR_INVALID_VALUE;
 		}
 		err = cyaml__read_flags_value(ctx, schema, data);
+		if (err == CYAML_OK) {
+			cyaml__anchor_complete(ctx, anchor, data, 0);
+		}
 		break;
 	case CYAML_MAPPING:
 		if (cyaml_event != CYAML_EVT_MAP_START) {
@@ -1157,6 +1915,9 @@ static cyaml_err_t cyaml__read_value(
 		}
 		err = cyaml__stack_push(ctx, CYAML_STATE_IN_MAP_KEY,
 				schema, data);
+		if (err == CYAML_OK) {
+			ctx->state->anchor = anchor;
+		}
 		break;
 	case CYAML_SEQUENCE: /* Fall through. */
 	case CYAML_SEQUENCE_FIXED:
@@ -1168,6 +1929,9 @@ static cyaml_err_t cyaml__read_value(
 		}
 		err = cyaml__stack_push(ctx, CYAML_STATE_IN_SEQUENCE,
 				schema, data);
+		if (err == CYAML_OK) {
+			ctx->state->anchor = anchor;
+		}
 		break;
 	case CYAML_IGNORE:
 		err = cyaml__consume_ignored_value(ctx, cyaml_event);
@@ -1208,13 +1972,16 @@ static cyaml_err_t cyaml__doc_start(
 		yaml_event_t *event)
 {
 	CYAML_UNUSED(event);
-	if (ctx->state->stream.doc_count == 1) {
+	if (ctx->state->stream.doc_count == 1 && !ctx->stream) {
 		cyaml__log(ctx->config, CYAML_LOG_WARNING,
 				"Ignoring documents after first in stream\n");
 		cyaml__stack_pop(ctx);
 		return CYAML_OK;
 	}
 	ctx->state->stream.doc_count++;
+	ctx->limit_bytes = 0;
+	ctx->limit_entries = 0;
+	cyaml_anchors_clear(&ctx->anchors);
 	return cyaml__stack_push(ctx, CYAML_STATE_IN_DOC,
 			ctx->state->schema, ctx->state->data);
 }
@@ -1279,7 +2046,29 @@ static cyaml_err_t cyaml__map_key(
 		yaml_event_t *event)
 {
 	const char *key;
-	cyaml_err_t err = CYAML_OK;
+	cyaml_err_t err;
+
+	err = cyaml__limit_entry(ctx);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	if (ctx->state->mapping.projected &&
+	    ctx->state->mapping.required_left == 0) {
+		cyaml__log(ctx->config, CYAML_LOG_DEBUG,
+				"Skipping rest of mapping\n");
+		CYAML_STATS_INC(ctx->config, ignored_values);
+		err = cyaml__skip_events(ctx, 1);
+		if (err != CYAML_OK) {
+			return err;
+		}
+		/* Every required field was found, so there's nothing
+		 * left to validate. */
+		cyaml__anchor_complete(ctx, ctx->state->anchor,
+				ctx->state->data, 0);
+		cyaml__stack_pop(ctx);
+		return CYAML_OK;
+	}
 
 	key = (const char *)event->data.scalar.value;
 	ctx->state->mapping.schema_idx =
@@ -1313,6 +2102,23 @@ static cyaml_err_t cyaml__map_key(
 	return err;
 }
 
+/**
+ * YAML loading handler for aliases in the \ref CYAML_STATE_IN_MAP_KEY state.
+ *
+ * \param[in]  ctx    The CYAML loading context.
+ * \param[in]  event  The YAML event to handle.
+ * \return \ref CYAML_ERR_INVALID_ALIAS, since keys can't be aliases.
+ */
+static cyaml_err_t cyaml__map_key_alias(
+		cyaml_ctx_t *ctx,
+		yaml_event_t *event)
+{
+	cyaml__log(ctx->config, CYAML_LOG_ERROR,
+			"Alias used as mapping key: %s\n",
+			(const char *)event->data.alias.anchor);
+	return CYAML_ERR_INVALID_ALIAS;
+}
+
 /**
  * YAML loading handler for finalising the \ref CYAML_STATE_IN_MAP_KEY state.
  *
@@ -1333,6 +2139,7 @@ static cyaml_err_t cyaml__map_end(
 		return err;
 	}
 
+	cyaml__anchor_complete(ctx, ctx->state->anchor, ctx->state->data, 0);
 	cyaml__stack_pop(ctx);
 	return CYAML_OK;
 }
@@ -1362,72 +2169,305 @@ static cyaml_err_t cyaml__map_value(
 }
 
 /**
- * YAML loading handler for new sequence entries in the
- * \ref CYAML_STATE_IN_SEQUENCE state.
+ * Pass the current entry of a streamed sequence to the client.
  *
- * \param[in]  ctx    The CYAML loading context.
- * \param[in]  event  The YAML event to handle.
+ * Whatever the client returns, the entry is freed, and its slot cleared
+ * ready for the next entry.
+ *
+ * \param[in]  ctx  The CYAML loading context.
  * \return \ref CYAML_OK on success, or appropriate error code otherwise.
  */
-static cyaml_err_t cyaml__seq_entry(
-		cyaml_ctx_t *ctx,
-		yaml_event_t *event)
+static cyaml_err_t cyaml__seq_entry_deliver(
+		cyaml_ctx_t *ctx)
 {
-	cyaml_err_t err;
 	cyaml_state_t *state = ctx->state;
-	uint8_t *value_data = state->data;
 	const cyaml_schema_value_t *schema = state->schema;
+	cyaml_err_t err;
 
-	if (state->sequence.count + 1 > state->schema->sequence.max) {
-		cyaml__log(ctx->config, CYAML_LOG_ERROR,
-				"Excessive entries (%"PRIu32" max) "
-				"in sequence.\n",
-				state->schema->sequence.max);
-		return CYAML_ERR_SEQUENCE_ENTRIES_MAX;
-	}
-
-	err = cyaml__data_handle_pointer(ctx, schema, event, &value_data);
+	err = ctx->config->entry_fn(ctx->config->entry_ctx,
+			state->sequence.data, state->sequence.count - 1);
 	if (err != CYAML_OK) {
-		return err;
-	}
-
-	cyaml__log(ctx->config, CYAML_LOG_DEBUG,
-			"Sequence entry: %u (%"PRIu32" bytes)\n",
-			state->sequence.count, schema->data_size);
-	value_data += schema->data_size * state->sequence.count;
-	state->sequence.count++;
-
-	if (schema->type != CYAML_SEQUENCE_FIXED) {
-		err = cyaml_data_write(state->sequence.count,
-				state->sequence.count_size,
-				state->sequence.count_data);
-		if (err != CYAML_OK) {
-			cyaml__log(ctx->config, CYAML_LOG_ERROR,
-					"Failed writing sequence count\n");
-			if (schema->flags & CYAML_FLAG_POINTER) {
-				cyaml__log(ctx->config, CYAML_LOG_DEBUG,
-						"Freeing %p\n",
-						state->sequence.data);
-				cyaml__free(ctx->config, state->sequence.data);
-			}
-			return err;
-		}
+		cyaml__log(ctx->config, CYAML_LOG_ERROR,
+				"Client rejected sequence entry: %u\n",
+				state->sequence.count - 1);
 	}
 
-	/* Read the actual value */
-	err = cyaml__read_value(ctx, schema->sequence.entry,
-			value_data, event);
-	if (err != CYAML_OK) {
-		return err;
-	}
+	cyaml_free_value(ctx->config, schema->sequence.entry,
+			state->sequence.data, 0);
+	memset(state->sequence.data, 0, schema->data_size);
+	ctx->limit_bytes = state->sequence.limit_bytes;
 
-	return CYAML_OK;
+	return err;
 }
 
 /**
- * YAML loading handler for finalising the \ref CYAML_STATE_IN_SEQUENCE state.
+ * Write the current sequence's entry count to the client's data.
  *
- * \param[in]  ctx    The CYAML loading context.
+ * If the count can't be written, the entries can't be freed later, so
+ * the sequence's allocation is freed here.
+ *
+ * \param[in]  ctx  The CYAML loading context.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__seq_write_count(
+		cyaml_ctx_t *ctx)
+{
+	cyaml_state_t *state = ctx->state;
+	cyaml_err_t err;
+
+	err = cyaml_data_write(state->sequence.count,
+			state->sequence.count_size,
+			state->sequence.count_data);
+	if (err != CYAML_OK) {
+		cyaml__log(ctx->config, CYAML_LOG_ERROR,
+				"Failed writing sequence count\n");
+		if ((state->schema->flags & CYAML_FLAG_POINTER) &&
+		    !ctx->use_arena) {
+			cyaml__log(ctx->config, CYAML_LOG_DEBUG,
+					"Freeing %p\n",
+					state->sequence.data);
+			cyaml__free(ctx->config, state->sequence.data);
+		}
+	}
+
+	return err;
+}
+
+/**
+ * Parse a number and store it in a sequence entry.
+ *
+ * This stores values just as \ref cyaml__read_int and friends do, without
+ * going through the loading context.
+ *
+ * \param[in]  schema  The schema for the sequence entry.
+ * \param[in]  value   String containing scaler value.
+ * \param[in]  len     Length of value in bytes.
+ * \param[in]  data    The place to write the value in the output data.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static inline cyaml_err_t cyaml__read_number(
+		const cyaml_schema_value_t *schema,
+		const char *value,
+		size_t len,
+		uint8_t *data)
+{
+	unsigned shift = (8 - schema->data_size) * 8;
+
+	switch (schema->type) {
+	case CYAML_INT: {
+		int64_t max = (int64_t)((~(uint64_t)0) >> (shift + 1));
+		int64_t temp;
+
+		if (!cyaml_number_parse_int(value, len, &temp) ||
+		    temp < (-max) - 1 || temp > max) {
+			return CYAML_ERR_INVALID_VALUE;
+		}
+		return cyaml_data_write_bulk((uint64_t)temp,
+				schema->data_size, data);
+	}
+	case CYAML_UINT: {
+		uint64_t temp;
+
+		if (!cyaml_number_parse_uint(value, len, &temp) ||
+		    temp > ((~(uint64_t)0) >> shift)) {
+			return CYAML_ERR_INVALID_VALUE;
+		}
+		return cyaml_data_write_bulk(temp, schema->data_size, data);
+	}
+	case CYAML_FLOAT:
+		if (schema->data_size == sizeof(float)) {
+			float temp;
+			if (!cyaml_number_parse_float(value, len, &temp)) {
+				return CYAML_ERR_INVALID_VALUE;
+			}
+			memcpy(data, &temp, sizeof(temp));
+		} else {
+			double temp;
+			if (!cyaml_number_parse_double(value, len, &temp)) {
+				return CYAML_ERR_INVALID_VALUE;
+			}
+			memcpy(data, &temp, sizeof(temp));
+		}
+		return CYAML_OK;
+	default:
+		return CYAML_ERR_INTERNAL_ERROR;
+	}
+}
+
+/**
+ * YAML loading handler for scalar entries of bulk loaded sequences.
+ *
+ * This is the fast path of \ref cyaml__seq_entry, for sequences with
+ * \ref cyaml_state_t.sequence.bulk set.  The entry is parsed straight into
+ * its place in the sequence, without going through \ref cyaml__read_value,
+ * and the count is left to \ref cyaml__seq_end.
+ *
+ * \param[in]  ctx    The CYAML loading context.
+ * \param[in]  event  The YAML scalar event to handle.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__seq_entry_bulk(
+		cyaml_ctx_t *ctx,
+		yaml_event_t *event)
+{
+	cyaml_state_t *state = ctx->state;
+	const cyaml_schema_value_t *schema = state->schema;
+	const cyaml_schema_value_t *entry = schema->sequence.entry;
+	const char *value = (const char *)event->data.scalar.value;
+	uint8_t *value_data = state->data;
+	cyaml_err_t err;
+
+	if (state->sequence.count + 1 > schema->sequence.max) {
+		cyaml__log(ctx->config, CYAML_LOG_ERROR,
+				"Excessive entries (%"PRIu32" max) "
+				"in sequence.\n",
+				schema->sequence.max);
+		return CYAML_ERR_SEQUENCE_ENTRIES_MAX;
+	}
+
+	err = cyaml__data_handle_pointer(ctx, schema, event, &value_data);
+	if (err != CYAML_OK) {
+		return err;
+	}
+	value_data += entry->data_size * state->sequence.count;
+
+	cyaml__log(ctx->config, CYAML_LOG_INFO, "  <%s>\n", value);
+
+	err = cyaml__read_number(entry, value,
+			event->data.scalar.length, value_data);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	state->sequence.count++;
+	return CYAML_OK;
+}
+
+/**
+ * YAML loading handler for new sequence entries in the
+ * \ref CYAML_STATE_IN_SEQUENCE state.
+ *
+ * \param[in]  ctx    The CYAML loading context.
+ * \param[in]  event  The YAML event to handle.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__seq_entry(
+		cyaml_ctx_t *ctx,
+		yaml_event_t *event)
+{
+	cyaml_err_t err;
+	cyaml_state_t *state = ctx->state;
+	uint8_t *value_data = state->data;
+	const cyaml_schema_value_t *schema = state->schema;
+
+	err = cyaml__limit_entry(ctx);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	if (state->sequence.bulk && event->type == YAML_SCALAR_EVENT) {
+		return cyaml__seq_entry_bulk(ctx, event);
+	}
+
+	if (state->sequence.count + 1 > state->schema->sequence.max) {
+		cyaml__log(ctx->config, CYAML_LOG_ERROR,
+				"Excessive entries (%"PRIu32" max) "
+				"in sequence.\n",
+				state->schema->sequence.max);
+		return CYAML_ERR_SEQUENCE_ENTRIES_MAX;
+	}
+
+	if (state->sequence.streamed && state->sequence.count > 0) {
+		/* The previous entry is complete. */
+		err = cyaml__seq_entry_deliver(ctx);
+		if (err != CYAML_OK) {
+			return err;
+		}
+	}
+
+	err = cyaml__data_handle_pointer(ctx, schema, event, &value_data);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	cyaml__log(ctx->config, CYAML_LOG_DEBUG,
+			"Sequence entry: %u (%"PRIu32" bytes)\n",
+			state->sequence.count, schema->data_size);
+	if (!state->sequence.streamed) {
+		value_data += schema->data_size * state->sequence.count;
+	} else {
+		state->sequence.limit_bytes = ctx->limit_bytes;
+	}
+	state->sequence.count++;
+
+	if (schema->type != CYAML_SEQUENCE_FIXED) {
+		err = cyaml__seq_write_count(ctx);
+		if (err != CYAML_OK) {
+			return err;
+		}
+	}
+
+	/* Read the actual value */
+	err = cyaml__read_value(ctx, schema->sequence.entry,
+			value_data, event);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	return CYAML_OK;
+}
+
+/**
+ * Trim the current sequence's allocation to fit its entries.
+ *
+ * Failure to shrink the allocation isn't an error; the sequence is simply
+ * left with its spare capacity.
+ *
+ * \param[in]  ctx  The CYAML loading context.
+ */
+static void cyaml__seq_shrink(
+		cyaml_ctx_t *ctx)
+{
+	cyaml_state_t *state = ctx->state;
+	const cyaml_schema_value_t *schema = state->schema;
+	size_t current_size, new_size;
+	uint8_t *value_data;
+
+	if (schema->type != CYAML_SEQUENCE ||
+	    !(schema->flags & CYAML_FLAG_POINTER) ||
+	    state->sequence.count == state->sequence.capacity) {
+		return;
+	}
+
+	current_size = (size_t)schema->data_size * state->sequence.capacity;
+	new_size = (size_t)schema->data_size * state->sequence.count;
+
+	if (ctx->use_arena) {
+		value_data = cyaml_arena_realloc(ctx->config,
+				&ctx->arena, state->sequence.data,
+				current_size, new_size,
+				state->data == ctx->stack[0].data);
+	} else {
+		value_data = cyaml__realloc(ctx->config, state->sequence.data,
+				current_size, new_size, false);
+	}
+	if (value_data == NULL) {
+		return;
+	}
+
+	cyaml__log(ctx->config, CYAML_LOG_DEBUG,
+			"Shrunk allocation: %p (%zu bytes)\n",
+			value_data, new_size);
+
+	state->sequence.data = value_data;
+	state->sequence.capacity = state->sequence.count;
+	cyaml_data_write_pointer(value_data, state->data);
+}
+
+/**
+ * YAML loading handler for finalising the \ref CYAML_STATE_IN_SEQUENCE state.
+ *
+ * \param[in]  ctx    The CYAML loading context.
  * \param[in]  event  The YAML event to handle.
  * \return \ref CYAML_OK on success, or appropriate error code otherwise.
  */
@@ -1439,6 +2479,15 @@ static cyaml_err_t cyaml__seq_end(
 
 	CYAML_UNUSED(event);
 
+	if (state->sequence.bulk && state->schema->type == CYAML_SEQUENCE &&
+	    state->sequence.count > 0) {
+		/* Bulk entries leave the count to be written once, here. */
+		cyaml_err_t err = cyaml__seq_write_count(ctx);
+		if (err != CYAML_OK) {
+			return err;
+		}
+	}
+
 	if (state->sequence.count < state->schema->sequence.min) {
 		cyaml__log(ctx->config, CYAML_LOG_ERROR, "Insufficient entries "
 				"(%"PRIu32" of %"PRIu32" min) in sequence.\n",
@@ -1449,6 +2498,28 @@ static cyaml_err_t cyaml__seq_end(
 	cyaml__log(ctx->config, CYAML_LOG_DEBUG, "Sequence count: %u\n",
 			state->sequence.count);
 
+	if (state->sequence.streamed) {
+		cyaml_err_t err = CYAML_OK;
+
+		if (state->sequence.count > 0) {
+			err = cyaml__seq_entry_deliver(ctx);
+		}
+
+		/* Nothing is left in the sequence for the client. */
+		cyaml__free(ctx->config, state->sequence.data);
+		cyaml_data_write_pointer(NULL, state->data);
+		state->sequence.data = NULL;
+		state->sequence.capacity = 0;
+		if (err != CYAML_OK) {
+			return err;
+		}
+
+	} else if (ctx->config->flags & CYAML_CFG_SHRINK_SEQUENCES) {
+		cyaml__seq_shrink(ctx);
+	}
+
+	cyaml__anchor_complete(ctx, state->anchor, state->sequence.data,
+			state->sequence.count);
 	cyaml__stack_pop(ctx);
 	return CYAML_OK;
 }
@@ -1520,21 +2591,25 @@ static inline cyaml_err_t cyaml__load_event(
 			[CYAML_EVT_SCALAR]     = cyaml__doc_root_value,
 			[CYAML_EVT_SEQ_START]  = cyaml__doc_root_value,
 			[CYAML_EVT_MAP_START]  = cyaml__doc_root_value,
+			[CYAML_EVT_ALIAS]      = cyaml__doc_root_value,
 			[CYAML_EVT_DOC_END]    = cyaml__doc_end,
 		},
 		[CYAML_STATE_IN_MAP_KEY] = {
 			[CYAML_EVT_SCALAR]     = cyaml__map_key,
+			[CYAML_EVT_ALIAS]      = cyaml__map_key_alias,
 			[CYAML_EVT_MAP_END]    = cyaml__map_end,
 		},
 		[CYAML_STATE_IN_MAP_VALUE] = {
 			[CYAML_EVT_SCALAR]     = cyaml__map_value,
 			[CYAML_EVT_SEQ_START]  = cyaml__map_value,
 			[CYAML_EVT_MAP_START]  = cyaml__map_value,
+			[CYAML_EVT_ALIAS]      = cyaml__map_value,
 		},
 		[CYAML_STATE_IN_SEQUENCE] = {
 			[CYAML_EVT_SCALAR]     = cyaml__seq_entry,
 			[CYAML_EVT_SEQ_START]  = cyaml__seq_entry,
 			[CYAML_EVT_MAP_START]  = cyaml__seq_entry,
+			[CYAML_EVT_ALIAS]      = cyaml__seq_entry,
 			[CYAML_EVT_SEQ_END]    = cyaml__seq_end,
 		},
 	};
@@ -1551,86 +2626,337 @@ static inline cyaml_err_t cyaml__load_event(
 }
 
 /**
- * The main YAML loading function.
+ * Determine whether loaded data should be allocated from an arena.
  *
- * The public interfaces are wrappers around this.
+ * Streamed top level sequence entries are freed as soon as the client has
+ * seen them, so they are never allocated from an arena.
  *
- * \param[in]  config         Client's CYAML configuration structure.
- * \param[in]  schema         CYAML schema for the YAML to be loaded.
- * \param[out] data_out       Returns the caller-owned loaded data on success.
- *                            Untouched on failure.
- * \param[out] seq_count_out  On success, returns the sequence entry count.
- *                            Untouched on failure.
- *                            Must be non-NULL if top-level schema type is
- *                            \ref CYAML_SEQUENCE, otherwise, must be NULL.
- * \param[in]  parser         An initialised `libyaml` parser object
- *                            with its input set.
- * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ * \param[in]  config  Client's CYAML configuration structure.
+ * \param[in]  schema  CYAML schema for the YAML to be loaded.
+ * \return true if the arena should be used, false otherwise.
  */
-static cyaml_err_t cyaml__load(
+static inline bool cyaml__use_arena(
 		const cyaml_config_t *config,
-		const cyaml_schema_value_t *schema,
-		cyaml_data_t **data_out,
-		unsigned *seq_count_out,
-		yaml_parser_t *parser)
+		const cyaml_schema_value_t *schema)
 {
-	cyaml_data_t *data = NULL;
-	cyaml_ctx_t ctx = {
-		.config = config,
-		.parser = parser,
-	};
-	cyaml_err_t err = CYAML_OK;
-
-	err = cyaml__validate_load_params(config, schema,
-			data_out, seq_count_out);
-	if (err != CYAML_OK) {
-		return err;
+	if (config->entry_fn != NULL && schema->type == CYAML_SEQUENCE) {
+		return false;
 	}
 
-	err = cyaml__stack_push(&ctx, CYAML_STATE_START, schema, &data);
-	if (err != CYAML_OK) {
-		goto out;
+	return config->flags & CYAML_CFG_ARENA;
+}
+
+/**
+ * Handle YAML events until the current document has been loaded.
+ *
+ * In stream mode, this returns when the state machine gets back to the
+ * \ref CYAML_STATE_IN_STREAM state, having loaded a document.  Otherwise
+ * the stream is handled until the state machine finishes.
+ *
+ * \param[in]  ctx  The CYAML loading context.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__load_events(
+		cyaml_ctx_t *ctx)
+{
+	uint32_t doc_count = 0;
+
+	if (ctx->state->state == CYAML_STATE_IN_STREAM) {
+		doc_count = ctx->state->stream.doc_count;
 	}
 
 	do {
 		yaml_event_t event;
+		cyaml_err_t err;
 
-		err = cyaml_get_next_event(&ctx, &event);
+		err = cyaml_get_next_event(ctx, &event);
 		if (err != CYAML_OK) {
-			goto out;
+			return err;
 		}
 
-		err = cyaml__load_event(&ctx, &event);
+		CYAML_STATS_TIMER_START_EXCL(ctx->config, decode, parse_ns);
+		err = cyaml__load_event(ctx, &event);
+		CYAML_STATS_TIMER_END_EXCL(ctx->config, decode_ns, decode,
+				parse_ns);
 		yaml_event_delete(&event);
 		if (err != CYAML_OK) {
-			goto out;
+			return err;
 		}
-	} while (ctx.state->state > CYAML_STATE_START);
-
-	cyaml__stack_pop(&ctx);
 
-	assert(ctx.stack_idx == 0);
+		if (ctx->stream &&
+		    ctx->state->state == CYAML_STATE_IN_STREAM &&
+		    ctx->state->stream.doc_count != doc_count) {
+			break;
+		}
+	} while (ctx->state->state > CYAML_STATE_START);
 
-	*data_out = data;
-	if (seq_count_out != NULL) {
-		*seq_count_out = ctx.seq_count;
-	}
-out:
-	if (err != CYAML_OK) {
-		cyaml_free(config, schema, data, ctx.seq_count);
-		cyaml__backtrace(&ctx);
-	}
-	while (ctx.stack_idx > 0) {
-		cyaml__stack_pop(&ctx);
-	}
-	cyaml__free(config, ctx.stack);
-	return err;
+	return CYAML_OK;
 }
 
-/* Exported function, documented in include/cyaml/cyaml.h */
-cyaml_err_t cyaml_load_file(
-		const char *path,
-		const cyaml_config_t *config,
+/**
+ * Free a partially loaded document, after a loading error.
+ *
+ * \param[in]  ctx     The CYAML loading context.
+ * \param[in]  schema  CYAML schema for the YAML being loaded.
+ * \param[in]  data    The root of the partially loaded data, or NULL.
+ */
+static void cyaml__load_discard(
+		cyaml_ctx_t *ctx,
+		const cyaml_schema_value_t *schema,
+		cyaml_data_t *data)
+{
+	unsigned count = ctx->seq_count;
+
+	if (ctx->stack_idx > 0 && ctx->stack[0].schema->type ==
+			CYAML_SEQUENCE && ctx->config->entry_fn != NULL) {
+		/* Only the entry slot of a streamed sequence remains. */
+		count = (count > 0) ? 1 : 0;
+	}
+
+	if (ctx->use_arena) {
+		cyaml_arena_destroy(ctx->config, ctx->arena);
+	} else {
+		cyaml_free_value(ctx->config, schema, (uint8_t *)&data, count);
+	}
+
+	ctx->arena = NULL;
+	cyaml_intern_clear(&ctx->intern);
+}
+
+/**
+ * Clean up a CYAML loading context.
+ *
+ * \param[in]  ctx  The CYAML loading context.
+ */
+static void cyaml__load_fini(
+		cyaml_ctx_t *ctx)
+{
+	while (ctx->stack_idx > 0) {
+		cyaml__stack_pop(ctx);
+	}
+	cyaml_index_cache_fini(ctx->config, &ctx->index_cache);
+	cyaml_intern_fini(ctx->config, &ctx->intern);
+	cyaml_anchors_fini(ctx->config, &ctx->anchors);
+	cyaml__free(ctx->config, ctx->bitfields);
+	cyaml__free(ctx->config, ctx->stack);
+	ctx->bitfields = NULL;
+	ctx->bitfields_max = 0;
+	ctx->stack = NULL;
+	ctx->stack_max = 0;
+}
+
+/**
+ * Size a fresh CYAML loading context's allocations for a schema.
+ *
+ * This means loading documents which match the schema's shape needs no
+ * allocations for load state.  The space needed comes from the compiled
+ * schema if there is one, and otherwise from walking the schema.  Contexts
+ * which have already been used are left alone, since their allocations
+ * have grown to suit earlier loads.
+ *
+ * \param[in]  ctx     The CYAML loading context.
+ * \param[in]  schema  CYAML schema for the YAML to be loaded.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__load_presize(
+		cyaml_ctx_t *ctx,
+		const cyaml_schema_value_t *schema)
+{
+	cyaml_state_t *stack;
+	uint32_t depth;
+	uint32_t words;
+	uint32_t max;
+
+	if (ctx->stack_max != 0) {
+		return CYAML_OK;
+	}
+
+	if (ctx->compiled != NULL) {
+		depth = ctx->compiled->depth;
+		words = ctx->compiled->words;
+	} else {
+		cyaml_schema_needs(schema, &depth, &words);
+	}
+	max = CYAML_PRESIZE_STACK_BASE + depth;
+
+	stack = cyaml__alloc(ctx->config, sizeof(*stack) * max, false);
+	if (stack == NULL) {
+		return CYAML_ERR_OOM;
+	}
+	ctx->stack = stack;
+	ctx->stack_max = max;
+
+	return cyaml__bitfields_ensure(ctx, words);
+}
+
+/**
+ * Load a YAML document using a CYAML loading context.
+ *
+ * The context's allocations are left in place for reuse, and must be
+ * cleaned up with \ref cyaml__load_fini.  The load parameters must have
+ * been validated by the caller.
+ *
+ * \param[in]  ctx            The CYAML loading context, with its config and
+ *                            parser set, and an empty state stack.
+ * \param[in]  schema         CYAML schema for the YAML to be loaded.
+ * \param[out] data_out       Returns the caller-owned loaded data on success.
+ *                            Untouched on failure.
+ * \param[out] seq_count_out  On success, returns the sequence entry count.
+ *                            Untouched on failure.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__load_ctx(
+		cyaml_ctx_t *ctx,
+		const cyaml_schema_value_t *schema,
+		cyaml_data_t **data_out,
+		unsigned *seq_count_out)
+{
+	cyaml_data_t *data = NULL;
+	cyaml_err_t err = CYAML_OK;
+
+	ctx->seq_count = 0;
+	ctx->arena = NULL;
+	ctx->use_arena = cyaml__use_arena(ctx->config, schema);
+	ctx->use_intern = ctx->use_arena &&
+			(ctx->config->flags & CYAML_CFG_INTERN_STRINGS);
+	ctx->use_aliases = ctx->use_arena &&
+			(ctx->config->flags & CYAML_CFG_ALIASES);
+	ctx->compiled = cyaml_schema_compiled_get(ctx->config, schema);
+
+	err = cyaml__load_presize(ctx, schema);
+	if (err != CYAML_OK) {
+		goto out;
+	}
+
+	err = cyaml__stack_push(ctx, CYAML_STATE_START, schema, &data);
+	if (err != CYAML_OK) {
+		goto out;
+	}
+
+	err = cyaml__load_events(ctx);
+	if (err != CYAML_OK) {
+		goto out;
+	}
+
+	cyaml__stack_pop(ctx);
+
+	assert(ctx->stack_idx == 0);
+
+	*data_out = data;
+	if (seq_count_out != NULL) {
+		*seq_count_out = ctx->seq_count;
+	}
+out:
+	if (err != CYAML_OK) {
+		cyaml__load_discard(ctx, schema, data);
+		cyaml__backtrace(ctx);
+	}
+	while (ctx->stack_idx > 0) {
+		cyaml__stack_pop(ctx);
+	}
+	cyaml_intern_clear(&ctx->intern);
+	return err;
+}
+
+/**
+ * The main YAML loading function.
+ *
+ * The public interfaces are wrappers around this.
+ *
+ * \param[in]  config         Client's CYAML configuration structure.
+ * \param[in]  schema         CYAML schema for the YAML to be loaded.
+ * \param[out] data_out       Returns the caller-owned loaded data on success.
+ *                            Untouched on failure.
+ * \param[out] seq_count_out  On success, returns the sequence entry count.
+ *                            Untouched on failure.
+ *                            Must be non-NULL if top-level schema type is
+ *                            \ref CYAML_SEQUENCE, otherwise, must be NULL.
+ * \param[in]  parser         An initialised `libyaml` parser object
+ *                            with its input set.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__load(
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		cyaml_data_t **data_out,
+		unsigned *seq_count_out,
+		yaml_parser_t *parser)
+{
+	cyaml_ctx_t ctx = {
+		.config = config,
+		.parser = parser,
+	};
+	cyaml_err_t err;
+
+	err = cyaml__validate_load_params(config, schema,
+			data_out, seq_count_out);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	err = cyaml__load_ctx(&ctx, schema, data_out, seq_count_out);
+	cyaml__load_fini(&ctx);
+	return err;
+}
+
+/**
+ * Open a file for loading, mapping it into memory if possible.
+ *
+ * If the file is mapped, `*file_out` is set to NULL, and the caller must
+ * unmap the file when done.  Otherwise the file is opened for reading
+ * through stdio, and `*map_out` is set to NULL.
+ *
+ * \param[in]  path      Path to YAML file to open.
+ * \param[out] file_out  Returns the opened stdio file, or NULL if mapped.
+ * \param[out] map_out   Returns the mapped file contents, or NULL.
+ * \param[out] len_out   Returns the length of the mapped file contents.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__load_file_mmap(
+		const char *path,
+		FILE **file_out,
+		uint8_t **map_out,
+		size_t *len_out)
+{
+	struct stat st;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd == -1) {
+		return CYAML_ERR_FILE_OPEN;
+	}
+
+	/* Only regular files can be mapped.  Empty files can't be either,
+	 * but they're cheap to read anyway. */
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 &&
+	    (uintmax_t)st.st_size <= SIZE_MAX) {
+		size_t len = st.st_size;
+		void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map != MAP_FAILED) {
+			/* The mapping keeps its own reference to the file. */
+			close(fd);
+			posix_madvise(map, len, POSIX_MADV_SEQUENTIAL);
+			*file_out = NULL;
+			*map_out = map;
+			*len_out = len;
+			return CYAML_OK;
+		}
+	}
+
+	*file_out = fdopen(fd, "r");
+	if (*file_out == NULL) {
+		close(fd);
+		return CYAML_ERR_FILE_OPEN;
+	}
+	*map_out = NULL;
+
+	return CYAML_OK;
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_load_file(
+		const char *path,
+		const cyaml_config_t *config,
 		const cyaml_schema_value_t *schema,
 		cyaml_data_t **data_out,
 		unsigned *seq_count_out)
@@ -1639,34 +2965,46 @@ cyaml_err_t cyaml_load_file(
 	cyaml_err_t err;
 	yaml_parser_t parser;
 
+	/* Open input file. */
+	if (config != NULL && (config->flags & CYAML_CFG_MMAP_INPUT)) {
+		uint8_t *map;
+		size_t len;
+
+		err = cyaml__load_file_mmap(path, &file, &map, &len);
+		if (err != CYAML_OK) {
+			return err;
+		}
+
+		if (map != NULL) {
+			err = cyaml_load_data(map, len, config, schema,
+					data_out, seq_count_out);
+			munmap(map, len);
+			return err;
+		}
+	} else {
+		file = fopen(path, "r");
+		if (file == NULL) {
+			return CYAML_ERR_FILE_OPEN;
+		}
+	}
+
 	/* Initialize parser */
 	if (!yaml_parser_initialize(&parser)) {
+		fclose(file);
 		return CYAML_ERR_LIBYAML_PARSER_INIT;
 	}
 
-	/* Open input file. */
-	file = fopen(path, "r");
-	if (file == NULL) {
-		yaml_parser_delete(&parser);
-		return CYAML_ERR_FILE_OPEN;
-	}
-
 	/* Set input file */
 	yaml_parser_set_input_file(&parser, file);
 
 	/* Parse the input */
 	err = cyaml__load(config, schema, data_out, seq_count_out, &parser);
-	if (err != CYAML_OK) {
-		yaml_parser_delete(&parser);
-		fclose(file);
-		return err;
-	}
 
 	/* Cleanup */
 	yaml_parser_delete(&parser);
 	fclose(file);
 
-	return CYAML_OK;
+	return err;
 }
 
 /* Exported function, documented in include/cyaml/cyaml.h */
@@ -1701,3 +3039,741 @@ cyaml_err_t cyaml_load_data(
 
 	return CYAML_OK;
 }
+
+/** CYAML load read callback context. */
+typedef struct cyaml_read_ctx {
+	cyaml_read_fn_t read_fn; /**< Client's read function. */
+	void *read_ctx;          /**< Client's read function context. */
+	cyaml_err_t err;         /**< Any error returned by `read_fn`. */
+} cyaml_read_ctx_t;
+
+/**
+ * Input handler for libyaml, which gets input from a client function.
+ *
+ * The client reads straight into the parser's input buffer.
+ *
+ * \param[in]  data       A pointer to cyaml read context struture.
+ * \param[out] buffer     The buffer to fill with input.
+ * \param[in]  size       The size of buffer.
+ * \param[out] size_read  Returns the number of bytes put in buffer.
+ * \return 1 on sucess, 0 otherwise.
+ */
+static int cyaml__read_handler(
+		void *data,
+		unsigned char *buffer,
+		size_t size,
+		size_t *size_read)
+{
+	cyaml_read_ctx_t *read_ctx = data;
+	enum {
+		RETURN_SUCCESS = 1,
+		RETURN_FAILURE = 0,
+	};
+
+	read_ctx->err = read_ctx->read_fn(read_ctx->read_ctx,
+			buffer, size, size_read);
+	if (read_ctx->err != CYAML_OK) {
+		*size_read = 0;
+		return RETURN_FAILURE;
+	}
+
+	return RETURN_SUCCESS;
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_load_stream(
+		cyaml_read_fn_t read_fn,
+		void *read_ctx,
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		cyaml_data_t **data_out,
+		unsigned *seq_count_out)
+{
+	cyaml_read_ctx_t ctx = {
+		.read_fn = read_fn,
+		.read_ctx = read_ctx,
+		.err = CYAML_OK,
+	};
+	cyaml_err_t err;
+	yaml_parser_t parser;
+
+	if (read_fn == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_DATA;
+	}
+
+	/* Initialize parser */
+	if (!yaml_parser_initialize(&parser)) {
+		return CYAML_ERR_LIBYAML_PARSER_INIT;
+	}
+
+	/* Set input handler */
+	yaml_parser_set_input(&parser, cyaml__read_handler, &ctx);
+
+	/* Parse the input */
+	err = cyaml__load(config, schema, data_out, seq_count_out, &parser);
+	if (err != CYAML_OK && ctx.err != CYAML_OK) {
+		err = ctx.err;
+	}
+
+	/* Cleanup */
+	yaml_parser_delete(&parser);
+
+	return err;
+}
+
+/** Input pushed to a document stream by the client. */
+typedef struct cyaml_push {
+	uint8_t *buf;  /**< Buffered input not yet discarded. */
+	size_t len;    /**< Number of bytes in buf. */
+	size_t max;    /**< Allocated size of buf. */
+	size_t read;   /**< Bytes of buf given to the parser. */
+	size_t scan;   /**< Bytes of buf scanned for document boundaries. */
+	uint32_t docs; /**< Complete documents buffered and not yet loaded. */
+	bool open;     /**< Whether the scan is inside a document. */
+	bool end;      /**< Whether the client has ended the input. */
+} cyaml_push_t;
+
+/**
+ * CYAML document stream.
+ *
+ * The loading context persists for the lifetime of the stream, so its
+ * state stack and mapping key indexes are reused for each document.
+ */
+struct cyaml_stream {
+	cyaml_ctx_t ctx;      /**< Loading context for the stream. */
+	yaml_parser_t parser; /**< The stream's `libyaml` parser. */
+	cyaml_data_t *data;   /**< Root of the document being loaded. */
+	FILE *file;           /**< Input file, or NULL. */
+	uint8_t *map;         /**< Memory mapped input file, or NULL. */
+	size_t map_len;       /**< Length of the memory mapped input file. */
+	cyaml_push_t *push;   /**< Pushed input, or NULL. */
+	cyaml_err_t err;      /**< Result of the previous load. */
+};
+
+/**
+ * Create a document stream.
+ *
+ * \param[in]  config      Client's CYAML configuration structure.
+ * \param[in]  schema      CYAML schema for each document in the stream.
+ * \param[out] stream_out  Returns the new stream on success.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__stream_create(
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		cyaml_stream_t **stream_out)
+{
+	cyaml_stream_t *stream;
+	cyaml_data_t *data = NULL;
+	unsigned count;
+	cyaml_err_t err;
+
+	/* Documents are only returned by \ref cyaml_stream_next, but the
+	 * config and schema can be checked up front. */
+	err = cyaml__validate_load_params(config, schema, &data,
+			(schema != NULL && schema->type == CYAML_SEQUENCE) ?
+			&count : NULL);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	stream = cyaml__alloc(config, sizeof(*stream), true);
+	if (stream == NULL) {
+		return CYAML_ERR_OOM;
+	}
+
+	if (!yaml_parser_initialize(&stream->parser)) {
+		cyaml__free(config, stream);
+		return CYAML_ERR_LIBYAML_PARSER_INIT;
+	}
+
+	stream->ctx.config = config;
+	stream->ctx.parser = &stream->parser;
+	stream->ctx.stream = true;
+	stream->ctx.use_arena = cyaml__use_arena(config, schema);
+	stream->ctx.use_intern = stream->ctx.use_arena &&
+			(config->flags & CYAML_CFG_INTERN_STRINGS);
+	stream->ctx.use_aliases = stream->ctx.use_arena &&
+			(config->flags & CYAML_CFG_ALIASES);
+	stream->ctx.compiled = cyaml_schema_compiled_get(config, schema);
+
+	err = cyaml__load_presize(&stream->ctx, schema);
+	if (err == CYAML_OK) {
+		err = cyaml__stack_push(&stream->ctx, CYAML_STATE_START,
+				schema, &stream->data);
+	}
+	if (err != CYAML_OK) {
+		cyaml_stream_close(stream);
+		return err;
+	}
+
+	*stream_out = stream;
+	return CYAML_OK;
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_stream_open_data(
+		const uint8_t *input,
+		size_t input_len,
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		cyaml_stream_t **stream_out)
+{
+	cyaml_stream_t *stream;
+	cyaml_err_t err;
+
+	if (stream_out == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_DATA;
+	}
+
+	err = cyaml__stream_create(config, schema, &stream);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	yaml_parser_set_input_string(&stream->parser, input, input_len);
+
+	*stream_out = stream;
+	return CYAML_OK;
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_stream_open_file(
+		const char *path,
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		cyaml_stream_t **stream_out)
+{
+	cyaml_stream_t *stream;
+	cyaml_err_t err;
+
+	if (stream_out == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_DATA;
+	}
+
+	err = cyaml__stream_create(config, schema, &stream);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	if (config->flags & CYAML_CFG_MMAP_INPUT) {
+		err = cyaml__load_file_mmap(path, &stream->file,
+				&stream->map, &stream->map_len);
+	} else {
+		stream->file = fopen(path, "r");
+		if (stream->file == NULL) {
+			err = CYAML_ERR_FILE_OPEN;
+		}
+	}
+	if (err != CYAML_OK) {
+		cyaml_stream_close(stream);
+		return err;
+	}
+
+	if (stream->map != NULL) {
+		yaml_parser_set_input_string(&stream->parser,
+				stream->map, stream->map_len);
+	} else {
+		yaml_parser_set_input_file(&stream->parser, stream->file);
+	}
+
+	*stream_out = stream;
+	return CYAML_OK;
+}
+
+/**
+ * Input handler for libyaml, which reads a stream's pushed input.
+ *
+ * The stream only lets the parser run when the pushed input holds the
+ * rest of a document, so running out of input before the client ends it
+ * is treated as a failure rather than the end of the input.
+ *
+ * \param[in]  data       The document stream.
+ * \param[out] buffer     The buffer to fill with input.
+ * \param[in]  size       The size of buffer.
+ * \param[out] size_read  Returns the number of bytes put in buffer.
+ * \return 1 on success, 0 otherwise.
+ */
+static int cyaml__push_read_handler(
+		void *data,
+		unsigned char *buffer,
+		size_t size,
+		size_t *size_read)
+{
+	cyaml_push_t *push = ((cyaml_stream_t *)data)->push;
+	size_t avail = push->len - push->read;
+	enum {
+		RETURN_SUCCESS = 1,
+		RETURN_FAILURE = 0,
+	};
+
+	if (avail == 0 && !push->end) {
+		*size_read = 0;
+		return RETURN_FAILURE;
+	}
+
+	if (size > avail) {
+		size = avail;
+	}
+	memcpy(buffer, push->buf + push->read, size);
+	push->read += size;
+	*size_read = size;
+
+	return RETURN_SUCCESS;
+}
+
+/**
+ * Check whether a line starts with a YAML document marker.
+ *
+ * \param[in]  line    The line, excluding its line break.
+ * \param[in]  len     Length of line in bytes.
+ * \param[in]  marker  The marker character, '-' or '.'.
+ * \return true if the line starts with the three character marker.
+ */
+static inline bool cyaml__push_is_marker(
+		const uint8_t *line,
+		size_t len,
+		uint8_t marker)
+{
+	if (len < 3 || line[0] != marker ||
+	    line[1] != marker || line[2] != marker) {
+		return false;
+	}
+
+	return len == 3 || line[3] == ' ' || line[3] == '\t' ||
+			line[3] == '\r';
+}
+
+/**
+ * Scan newly pushed complete lines for document boundaries.
+ *
+ * Document markers at the start of a line always end the document
+ * before them, whatever the document contains.  Each document known to
+ * be complete can be parsed without the parser needing input beyond the
+ * marker line that ends it.
+ *
+ * \param[in]  push  The pushed input.
+ */
+static void cyaml__push_scan(
+		cyaml_push_t *push)
+{
+	const uint8_t *end = push->buf + push->len;
+	const uint8_t *line = push->buf + push->scan;
+
+	while (line < end) {
+		const uint8_t *nl = memchr(line, '\n', (size_t)(end - line));
+		const uint8_t *pos = line;
+		size_t len;
+
+		if (nl == NULL) {
+			break;
+		}
+		len = (size_t)(nl - line);
+
+		if (line == push->buf && push->scan == 0 && len >= 3 &&
+		    memcmp(line, "\xEF\xBB\xBF", 3) == 0) {
+			/* Skip a UTF-8 byte order mark. */
+			line += 3;
+			len -= 3;
+		}
+
+		if (cyaml__push_is_marker(line, len, '-')) {
+			push->docs += push->open;
+			push->open = true;
+		} else if (cyaml__push_is_marker(line, len, '.')) {
+			push->docs += push->open;
+			push->open = false;
+		} else if (!push->open) {
+			while (pos < nl && (*pos == ' ' || *pos == '\t' ||
+					*pos == '\r')) {
+				pos++;
+			}
+			if (pos < nl && *pos != '#' && *pos != '%') {
+				push->open = true;
+			}
+		}
+
+		line = nl + 1;
+		push->scan = (size_t)(line - push->buf);
+	}
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_stream_open_push(
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		cyaml_stream_t **stream_out)
+{
+	cyaml_stream_t *stream;
+	cyaml_err_t err;
+
+	if (stream_out == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_DATA;
+	}
+
+	err = cyaml__stream_create(config, schema, &stream);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	stream->push = cyaml__alloc(config, sizeof(*stream->push), true);
+	if (stream->push == NULL) {
+		cyaml_stream_close(stream);
+		return CYAML_ERR_OOM;
+	}
+
+	yaml_parser_set_encoding(&stream->parser, YAML_UTF8_ENCODING);
+	yaml_parser_set_input(&stream->parser,
+			cyaml__push_read_handler, stream);
+
+	*stream_out = stream;
+	return CYAML_OK;
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_stream_feed(
+		cyaml_stream_t *stream,
+		const uint8_t *input,
+		size_t input_len)
+{
+	const cyaml_config_t *config;
+	cyaml_push_t *push;
+	size_t discard;
+
+	if (stream == NULL || stream->push == NULL ||
+	    (input == NULL && input_len != 0)) {
+		return CYAML_ERR_BAD_PARAM_NULL_DATA;
+	}
+
+	push = stream->push;
+	if (push->end) {
+		return CYAML_ERR_STREAM_END;
+	}
+	if (input_len == 0) {
+		return CYAML_OK;
+	}
+
+	/* Drop input which has been both parsed and scanned. */
+	discard = (push->read < push->scan) ? push->read : push->scan;
+	if (discard > 0) {
+		memmove(push->buf, push->buf + discard, push->len - discard);
+		push->len -= discard;
+		push->read -= discard;
+		push->scan -= discard;
+	}
+
+	config = stream->ctx.config;
+	if (input_len > push->max - push->len) {
+		size_t max = (push->max == 0) ? 1024 : push->max;
+		uint8_t *buf;
+
+		while (input_len > max - push->len) {
+			if (max > SIZE_MAX / 2) {
+				return CYAML_ERR_OOM;
+			}
+			max *= 2;
+		}
+
+		buf = cyaml__realloc(config, push->buf,
+				push->max, max, false);
+		if (buf == NULL) {
+			return CYAML_ERR_OOM;
+		}
+		push->buf = buf;
+		push->max = max;
+	}
+
+	memcpy(push->buf + push->len, input, input_len);
+	push->len += input_len;
+
+	cyaml__push_scan(push);
+	return CYAML_OK;
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_stream_feed_end(
+		cyaml_stream_t *stream)
+{
+	if (stream == NULL || stream->push == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_DATA;
+	}
+
+	stream->push->end = true;
+	return CYAML_OK;
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_stream_next(
+		cyaml_stream_t *stream,
+		cyaml_data_t **data_out,
+		unsigned *seq_count_out)
+{
+	cyaml_ctx_t *ctx;
+	cyaml_err_t err;
+
+	if (stream == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_DATA;
+	}
+	if (stream->err != CYAML_OK) {
+		return stream->err;
+	}
+
+	ctx = &stream->ctx;
+	err = cyaml__validate_load_params(ctx->config, ctx->stack[0].schema,
+			data_out, seq_count_out);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	if (stream->push != NULL && !stream->push->end &&
+	    stream->push->docs == 0) {
+		return CYAML_ERR_NEED_INPUT;
+	}
+
+	err = cyaml__load_events(ctx);
+	if (err != CYAML_OK) {
+		cyaml__load_discard(ctx, ctx->stack[0].schema, stream->data);
+		cyaml__backtrace(ctx);
+		goto out;
+	}
+
+	if (ctx->state->state == CYAML_STATE_START) {
+		err = CYAML_ERR_STREAM_END;
+		goto out;
+	}
+
+	if (stream->push != NULL && stream->push->docs > 0) {
+		stream->push->docs--;
+	}
+
+	*data_out = stream->data;
+	if (seq_count_out != NULL) {
+		*seq_count_out = ctx->seq_count;
+	}
+
+out:
+	/* Ownership of the document has passed to the client. */
+	stream->data = NULL;
+	ctx->seq_count = 0;
+	ctx->arena = NULL;
+	cyaml_intern_clear(&ctx->intern);
+	stream->err = err;
+	return err;
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+void cyaml_stream_close(
+		cyaml_stream_t *stream)
+{
+	const cyaml_config_t *config;
+
+	if (stream == NULL) {
+		return;
+	}
+
+	config = stream->ctx.config;
+	cyaml__load_fini(&stream->ctx);
+	yaml_parser_delete(&stream->parser);
+	if (stream->map != NULL) {
+		munmap(stream->map, stream->map_len);
+	}
+	if (stream->file != NULL) {
+		fclose(stream->file);
+	}
+	if (stream->push != NULL) {
+		cyaml__free(config, stream->push->buf);
+		cyaml__free(config, stream->push);
+	}
+	cyaml__free(config, stream);
+}
+
+/**
+ * CYAML reusable loader.
+ *
+ * The loading context persists between loads, so its allocations are
+ * reused.
+ */
+struct cyaml_loader {
+	cyaml_ctx_t ctx;      /**< Loading context for the loader. */
+	yaml_parser_t parser; /**< The loader's `libyaml` parser. */
+	bool parser_ready;    /**< Whether parser is initialised and unused. */
+};
+
+/**
+ * Reset a `libyaml` parser, ready to parse a new input.
+ *
+ * `libyaml` has no interface for reusing a parser, so it is deleted and
+ * initialised again.
+ *
+ * \param[in]  parser  The parser to reset.
+ * \return true on success, false if the parser could not be initialised.
+ */
+static bool cyaml__parser_reset(
+		yaml_parser_t *parser)
+{
+	yaml_parser_delete(parser);
+	return yaml_parser_initialize(parser);
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_loader_create(
+		const cyaml_config_t *config,
+		cyaml_loader_t **loader_out)
+{
+	cyaml_loader_t *loader;
+
+	if (config == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_CONFIG;
+	}
+	if (config->mem_fn == NULL) {
+		return CYAML_ERR_BAD_CONFIG_NULL_MEMFN;
+	}
+	if (loader_out == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_DATA;
+	}
+
+	loader = cyaml__alloc(config, sizeof(*loader), true);
+	if (loader == NULL) {
+		return CYAML_ERR_OOM;
+	}
+
+	if (!yaml_parser_initialize(&loader->parser)) {
+		cyaml__free(config, loader);
+		return CYAML_ERR_LIBYAML_PARSER_INIT;
+	}
+
+	loader->ctx.config = config;
+	loader->ctx.parser = &loader->parser;
+	loader->parser_ready = true;
+
+	*loader_out = loader;
+	return CYAML_OK;
+}
+
+/**
+ * Prepare a loader for a load.
+ *
+ * \param[in]  loader         The loader to prepare.
+ * \param[in]  schema         CYAML schema for the YAML to be loaded.
+ * \param[in]  data_out       The client's loaded data return pointer.
+ * \param[in]  seq_count_out  The client's sequence count return pointer.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__loader_prepare(
+		cyaml_loader_t *loader,
+		const cyaml_schema_value_t *schema,
+		cyaml_data_t **data_out,
+		unsigned *seq_count_out)
+{
+	cyaml_err_t err;
+
+	if (loader == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_DATA;
+	}
+
+	err = cyaml__validate_load_params(loader->ctx.config, schema,
+			data_out, seq_count_out);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	if (!loader->parser_ready) {
+		if (!cyaml__parser_reset(&loader->parser)) {
+			/* Leave the parser in a state that is safe to
+			 * delete. */
+			memset(&loader->parser, 0, sizeof(loader->parser));
+			return CYAML_ERR_LIBYAML_PARSER_INIT;
+		}
+		loader->parser_ready = true;
+	}
+
+	return CYAML_OK;
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_loader_load_data(
+		cyaml_loader_t *loader,
+		const uint8_t *input,
+		size_t input_len,
+		const cyaml_schema_value_t *schema,
+		cyaml_data_t **data_out,
+		unsigned *seq_count_out)
+{
+	cyaml_err_t err;
+
+	err = cyaml__loader_prepare(loader, schema, data_out, seq_count_out);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	yaml_parser_set_input_string(&loader->parser, input, input_len);
+	loader->parser_ready = false;
+
+	return cyaml__load_ctx(&loader->ctx, schema, data_out, seq_count_out);
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_loader_load_file(
+		cyaml_loader_t *loader,
+		const char *path,
+		const cyaml_schema_value_t *schema,
+		cyaml_data_t **data_out,
+		unsigned *seq_count_out)
+{
+	FILE *file;
+	uint8_t *map = NULL;
+	size_t len;
+	cyaml_err_t err;
+
+	err = cyaml__loader_prepare(loader, schema, data_out, seq_count_out);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	/* Open input file. */
+	if (loader->ctx.config->flags & CYAML_CFG_MMAP_INPUT) {
+		err = cyaml__load_file_mmap(path, &file, &map, &len);
+		if (err != CYAML_OK) {
+			return err;
+		}
+	} else {
+		file = fopen(path, "r");
+		if (file == NULL) {
+			return CYAML_ERR_FILE_OPEN;
+		}
+	}
+
+	if (map != NULL) {
+		yaml_parser_set_input_string(&loader->parser, map, len);
+	} else {
+		yaml_parser_set_input_file(&loader->parser, file);
+	}
+	loader->parser_ready = false;
+
+	err = cyaml__load_ctx(&loader->ctx, schema, data_out, seq_count_out);
+
+	/* Cleanup */
+	if (map != NULL) {
+		munmap(map, len);
+	} else {
+		fclose(file);
+	}
+
+	return err;
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+void cyaml_loader_destroy(
+		cyaml_loader_t *loader)
+{
+	const cyaml_config_t *config;
+
+	if (loader == NULL) {
+		return;
+	}
+
+	config = loader->ctx.config;
+	cyaml__load_fini(&loader->ctx);
+	yaml_parser_delete(&loader->parser);
+	cyaml__free(config, loader);
+}
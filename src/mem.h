@@ -14,6 +14,8 @@
 
 #include "cyaml/cyaml.h"
 
+#include "stats.h"
+
 /**
  * Helper for freeing using the client's choice of allocator routine.
  *
@@ -24,6 +26,10 @@ static inline void cyaml__free(
 		const cyaml_config_t *config,
 		void *ptr)
 {
+	if (ptr != NULL) {
+		CYAML_STATS_INC(config, mem_frees);
+	}
+
 	config->mem_fn(config->mem_ctx, ptr, 0);
 }
 
@@ -55,6 +61,16 @@ static inline void * cyaml__realloc(
 		return NULL;
 	}
 
+	if (ptr == NULL) {
+		CYAML_STATS_INC(config, mem_allocs);
+	} else {
+		CYAML_STATS_INC(config, mem_reallocs);
+		if (temp != ptr) {
+			CYAML_STATS_INC(config, realloc_copies);
+		}
+	}
+	CYAML_STATS_ADD(config, mem_bytes, new_size);
+
 	if (clean && (new_size > current_size)) {
 		memset(temp + current_size, 0, new_size - current_size);
 	}
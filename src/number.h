@@ -0,0 +1,151 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (C) 2019 Michael Drake <tlsa@netsurf-browser.org>
+ */
+
+/**
+ * \file
+ * \brief CYAML functions for converting numbers to and from text.
+ *
+ * These functions are reentrant, do not allocate, and do not depend on the
+ * current locale.
+ */
+
+#ifndef CYAML_NUMBER_H
+#define CYAML_NUMBER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Size of buffer that is big enough for any formatted number. */
+#define CYAML_NUMBER_BUF_SIZE 32
+
+/**
+ * Format a signed integer as decimal text.
+ *
+ * \param[in]  value  The integer to format.
+ * \param[out] buf    Buffer of at least \ref CYAML_NUMBER_BUF_SIZE bytes to
+ *                    write the nul terminated string into.
+ * \return the length of the formatted string.
+ */
+size_t cyaml_number_format_int(
+		int64_t value,
+		char *buf);
+
+/**
+ * Format an unsigned integer as decimal text.
+ *
+ * \param[in]  value  The integer to format.
+ * \param[out] buf    Buffer of at least \ref CYAML_NUMBER_BUF_SIZE bytes to
+ *                    write the nul terminated string into.
+ * \return the length of the formatted string.
+ */
+size_t cyaml_number_format_uint(
+		uint64_t value,
+		char *buf);
+
+/**
+ * Format a double precision floating point value as text.
+ *
+ * The output always reads back as exactly the same value, and is nearly
+ * always the shortest text that does so.  In rare cases it has more
+ * significant digits than are needed.
+ *
+ * \param[in]  value  The value to format.
+ * \param[out] buf    Buffer of at least \ref CYAML_NUMBER_BUF_SIZE bytes to
+ *                    write the nul terminated string into.
+ * \return the length of the formatted string.
+ */
+size_t cyaml_number_format_double(
+		double value,
+		char *buf);
+
+/**
+ * Format a single precision floating point value as text.
+ *
+ * The output always reads back as exactly the same single precision value,
+ * and is nearly always the shortest text that does so.  In rare cases it
+ * has more significant digits than are needed.
+ *
+ * \param[in]  value  The value to format.
+ * \param[out] buf    Buffer of at least \ref CYAML_NUMBER_BUF_SIZE bytes to
+ *                    write the nul terminated string into.
+ * \return the length of the formatted string.
+ */
+size_t cyaml_number_format_float(
+		float value,
+		char *buf);
+
+/**
+ * Parse a signed integer.
+ *
+ * The integer may have a sign, and may be decimal, hexadecimal with a `0x`
+ * prefix, or octal with a leading zero.
+ *
+ * \param[in]  str        The string to parse.
+ * \param[in]  len        Length of str in bytes.
+ * \param[out] value_out  Updated with the parsed value on success.
+ * \return true if the whole of str is an integer in the range of `int64_t`,
+ *         false otherwise.
+ */
+bool cyaml_number_parse_int(
+		const char *str,
+		size_t len,
+		int64_t *value_out);
+
+/**
+ * Parse an unsigned integer.
+ *
+ * Accepts the same forms as \ref cyaml_number_parse_int, but negative
+ * values are rejected.
+ *
+ * \param[in]  str        The string to parse.
+ * \param[in]  len        Length of str in bytes.
+ * \param[out] value_out  Updated with the parsed value on success.
+ * \return true if the whole of str is an integer in the range of
+ *         `uint64_t`, false otherwise.
+ */
+bool cyaml_number_parse_uint(
+		const char *str,
+		size_t len,
+		uint64_t *value_out);
+
+/**
+ * Parse a double precision floating point value.
+ *
+ * The value may be a decimal number with optional fraction and exponent,
+ * or any case of `inf`, `infinity`, `nan` and the YAML `.inf` and `.nan`
+ * forms.  The result is correctly rounded.
+ *
+ * \param[in]  str        The string to parse.
+ * \param[in]  len        Length of str in bytes.
+ * \param[out] value_out  Updated with the parsed value on success.
+ * \return true if the whole of str is a number, false if it is not, or if
+ *         the value overflows or underflows to zero.
+ */
+bool cyaml_number_parse_double(
+		const char *str,
+		size_t len,
+		double *value_out);
+
+/**
+ * Parse a single precision floating point value.
+ *
+ * Accepts the same forms as \ref cyaml_number_parse_double.  The result
+ * is correctly rounded to single precision directly, rather than through
+ * double precision.
+ *
+ * \param[in]  str        The string to parse.
+ * \param[in]  len        Length of str in bytes.
+ * \param[out] value_out  Updated with the parsed value on success.
+ * \return true if the whole of str is a number, false if it is not, or if
+ *         the value overflows or underflows to zero.
+ */
+bool cyaml_number_parse_float(
+		const char *str,
+		size_t len,
+		float *value_out);
+
+#endif
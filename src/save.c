@@ -12,16 +12,27 @@
  * schema to access the client data, and validates it before emitting the YAML.
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <inttypes.h>
 #include <stdbool.h>
 #include <assert.h>
 #include <limits.h>
+#include <errno.h>
+
+#include <unistd.h>
 
 #include <yaml.h>
 
 #include "mem.h"
 #include "data.h"
+#include "emit.h"
+#include "anchor.h"
 #include "util.h"
+#include "index.h"
+#include "number.h"
+#include "stats.h"
+#include "schema.h"
 
 /**
  * A CYAML save state machine stack entry.
@@ -61,6 +72,17 @@ typedef struct cyaml_ctx {
 	uint32_t stack_max;     /**< Current stack allocation limit. */
 	unsigned seq_count;     /**< Top-level sequence count. */
 	yaml_emitter_t *emitter;  /**< Internal libyaml parser object. */
+	cyaml_emit_t *emit;     /**< Native emitter, or NULL to use libyaml. */
+	/** Enum and flags string value indexes built while saving. */
+	cyaml_index_cache_t index_cache;
+	/** Compiled schema for the current save, or NULL. */
+	const cyaml_schema_compiled_t *compiled;
+	/** Pointer values reached while saving, for \ref CYAML_CFG_ALIASES. */
+	cyaml_shared_table_t shared;
+	uint32_t anchor_count;  /**< Number of anchors written. */
+	bool anchor_pending;    /**< Whether next node takes the anchor. */
+	/** Anchor name for the next node written. */
+	char anchor[CYAML_NUMBER_BUF_SIZE + 1];
 } cyaml_ctx_t;
 
 /**
@@ -73,7 +95,9 @@ static cyaml_err_t cyaml__stack_ensure(
 		cyaml_ctx_t *ctx)
 {
 	cyaml_state_t *temp;
-	uint32_t max = ctx->stack_max + 16;
+	uint32_t max = (ctx->stack_max == 0) ? 16 : ctx->stack_max * 2;
+
+	CYAML_STATS_MAX(ctx->config, stack_peak, ctx->stack_idx + 1);
 
 	if (ctx->stack_idx < ctx->stack_max) {
 		return CYAML_OK;
@@ -92,6 +116,35 @@ static cyaml_err_t cyaml__stack_ensure(
 	return CYAML_OK;
 }
 
+/**
+ * Size a fresh CYAML saving context's state stack for a compiled schema.
+ *
+ * Without a compiled schema the stack is simply grown as needed.
+ *
+ * \param[in]  ctx  The CYAML saving context, with its compiled schema set.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__save_presize(
+		cyaml_ctx_t *ctx)
+{
+	/* Start, stream and document states, then the nested values. */
+	uint32_t max;
+
+	if (ctx->compiled == NULL || ctx->stack_max != 0) {
+		return CYAML_OK;
+	}
+
+	max = 3 + ctx->compiled->depth;
+	ctx->stack = cyaml__alloc(ctx->config,
+			sizeof(*ctx->stack) * max, false);
+	if (ctx->stack == NULL) {
+		return CYAML_ERR_OOM;
+	}
+	ctx->stack_max = max;
+
+	return CYAML_OK;
+}
+
 /**
  * Helper to simplify emitting libyaml events.
  *
@@ -128,7 +181,10 @@ static cyaml_err_t cyaml__emit_event_helper(
 	}
 
 	/* Emit event and update save state stack. */
+	CYAML_STATS_TIMER_START(ctx->config, emit);
 	valid = yaml_emitter_emit(ctx->emitter, event);
+	CYAML_STATS_TIMER_END(ctx->config, emit_ns, emit);
+	CYAML_STATS_INC(ctx->config, events_emitted);
 	if (valid == 0) {
 		cyaml__log(ctx->config, CYAML_LOG_ERROR,
 				"LibYAML: Failed to emit event: %s\n",
@@ -139,6 +195,27 @@ static cyaml_err_t cyaml__emit_event_helper(
 	return CYAML_OK;
 }
 
+/**
+ * Helper for counting and reporting the result of a native emitter call.
+ *
+ * \param[in]  ctx  The CYAML saving context.
+ * \param[in]  err  The result of the native emitter call.
+ * \return err, unchanged.
+ */
+static cyaml_err_t cyaml__emit_native_helper(
+		const cyaml_ctx_t *ctx,
+		cyaml_err_t err)
+{
+	CYAML_STATS_INC(ctx->config, events_emitted);
+	if (err != CYAML_OK) {
+		cyaml__log(ctx->config, CYAML_LOG_ERROR,
+				"Save: Failed to emit: %s\n",
+				cyaml_strerror(err));
+	}
+
+	return err;
+}
+
 /** The style to use when emitting mappings and sequences. */
 enum cyaml_emit_style {
 	CYAML_EMIT_STYLE_DEFAULT,
@@ -230,6 +307,66 @@ static inline bool cyaml__emit_doc_delim(
 	return ctx->config->flags & CYAML_CFG_DOCUMENT_DELIM;
 }
 
+/**
+ * Take the anchor for the node about to be written.
+ *
+ * \param[in]  ctx  The CYAML saving context.
+ * \return the anchor name, or NULL if the node has no anchor.
+ */
+static inline yaml_char_t * cyaml__anchor_take(
+		cyaml_ctx_t *ctx)
+{
+	if (!ctx->anchor_pending) {
+		return NULL;
+	}
+
+	ctx->anchor_pending = false;
+	return (yaml_char_t *)ctx->anchor;
+}
+
+/**
+ * Write the start of the state being pushed to the stack, natively.
+ *
+ * \param[in]  ctx     The CYAML saving context.
+ * \param[in]  state   The CYAML save state we're pushing a stack entry for.
+ * \param[in]  schema  The CYAML schema for the value expected in state.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__stack_push_write_native(
+		const cyaml_ctx_t *ctx,
+		enum cyaml_state_e state,
+		const cyaml_schema_value_t *schema)
+{
+	cyaml_err_t err;
+
+	switch (state) {
+	case CYAML_STATE_START:
+		/* Nothing to write, but count it like the libyaml event. */
+		err = CYAML_OK;
+		break;
+	case CYAML_STATE_IN_DOC:
+		return CYAML_OK;
+	case CYAML_STATE_IN_STREAM:
+		err = cyaml_emit_document_start(ctx->emit,
+				!cyaml__emit_doc_delim(ctx));
+		break;
+	case CYAML_STATE_IN_MAP_KEY:
+		err = cyaml_emit_mapping_start(ctx->emit,
+				cyaml__get_emit_style(ctx, schema) ==
+						CYAML_EMIT_STYLE_FLOW);
+		break;
+	case CYAML_STATE_IN_SEQUENCE:
+		err = cyaml_emit_sequence_start(ctx->emit,
+				cyaml__get_emit_style(ctx, schema) ==
+						CYAML_EMIT_STYLE_FLOW);
+		break;
+	default:
+		return CYAML_ERR_INTERNAL_ERROR;
+	}
+
+	return cyaml__emit_native_helper(ctx, err);
+}
+
 /**
  * Emit a YAML start event for the state being pushed to the stack.
  *
@@ -239,13 +376,17 @@ static inline bool cyaml__emit_doc_delim(
  * \return \ref CYAML_OK on success, or appropriate error code otherwise.
  */
 static cyaml_err_t cyaml__stack_push_write_event(
-		const cyaml_ctx_t *ctx,
+		cyaml_ctx_t *ctx,
 		enum cyaml_state_e state,
 		const cyaml_schema_value_t *schema)
 {
 	yaml_event_t event;
 	int ret;
 
+	if (ctx->emit != NULL) {
+		return cyaml__stack_push_write_native(ctx, state, schema);
+	}
+
 	/* Create any appropriate event for the new state. */
 	switch (state) {
 	case CYAML_STATE_START:
@@ -259,12 +400,14 @@ static cyaml_err_t cyaml__stack_push_write_event(
 	case CYAML_STATE_IN_DOC:
 		return CYAML_OK;
 	case CYAML_STATE_IN_MAP_KEY:
-		ret = yaml_mapping_start_event_initialize(&event, NULL,
+		ret = yaml_mapping_start_event_initialize(&event,
+				cyaml__anchor_take(ctx),
 				(yaml_char_t *)YAML_MAP_TAG, 1,
 				cyaml__get_emit_style_map(ctx, schema));
 		break;
 	case CYAML_STATE_IN_SEQUENCE:
-		ret = yaml_sequence_start_event_initialize(&event, NULL,
+		ret = yaml_sequence_start_event_initialize(&event,
+				cyaml__anchor_take(ctx),
 				(yaml_char_t *)YAML_SEQ_TAG, 1,
 				cyaml__get_emit_style_seq(ctx, schema));
 		break;
@@ -327,6 +470,42 @@ static cyaml_err_t cyaml__stack_push(
 	return CYAML_OK;
 }
 
+/**
+ * Write the end of the state being popped from the stack, natively.
+ *
+ * \param[in]  ctx     The CYAML saving context.
+ * \param[in]  state   The CYAML save state we're popping from the stack.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__stack_pop_write_native(
+		const cyaml_ctx_t *ctx,
+		enum cyaml_state_e state)
+{
+	cyaml_err_t err;
+
+	switch (state) {
+	case CYAML_STATE_START:
+		return CYAML_OK;
+	case CYAML_STATE_IN_STREAM:
+		err = cyaml_emit_stream_end(ctx->emit);
+		break;
+	case CYAML_STATE_IN_DOC:
+		err = cyaml_emit_document_end(ctx->emit,
+				!cyaml__emit_doc_delim(ctx));
+		break;
+	case CYAML_STATE_IN_MAP_KEY:
+		err = cyaml_emit_mapping_end(ctx->emit);
+		break;
+	case CYAML_STATE_IN_SEQUENCE:
+		err = cyaml_emit_sequence_end(ctx->emit);
+		break;
+	default:
+		return CYAML_ERR_INTERNAL_ERROR;
+	}
+
+	return cyaml__emit_native_helper(ctx, err);
+}
+
 /**
  * Emit a YAML end event for the state being popped from the stack.
  *
@@ -343,6 +522,10 @@ static cyaml_err_t cyaml__stack_pop_write_event(
 	yaml_event_t event;
 	int ret;
 
+	if (ctx->emit != NULL) {
+		return cyaml__stack_pop_write_native(ctx, state);
+	}
+
 	/* Create any appropriate event for the new state. */
 	switch (state) {
 	case CYAML_STATE_START:
@@ -471,18 +654,20 @@ static void cyaml__backtrace(
 }
 
 /**
- * Helper to emit YAML scalar events, using libyaml.
+ * Helper to emit YAML scalar events of known length.
  *
  * \param[in]  ctx     The CYAML saving context.
  * \param[in]  schema  The schema for the value to emit.
  * \param[in]  value   The value to emit as a null-terminated C string.
+ * \param[in]  len     Length of value in bytes.
  * \param[in]  tag     YAML tag to use for output.
  * \return \ref CYAML_OK on success, or appropriate error code otherwise.
  */
-static cyaml_err_t cyaml__emit_scalar(
-		const cyaml_ctx_t *ctx,
+static cyaml_err_t cyaml__emit_scalar_len(
+		cyaml_ctx_t *ctx,
 		const cyaml_schema_value_t *schema,
 		const char *value,
+		size_t len,
 		const char *tag)
 {
 	int ret;
@@ -494,61 +679,36 @@ static cyaml_err_t cyaml__emit_scalar(
 		cyaml__log(ctx->config, CYAML_LOG_INFO, "  <%s>\n", value);
 	}
 
-	ret = yaml_scalar_event_initialize(&event, NULL,
+	if (ctx->emit != NULL) {
+		return cyaml__emit_native_helper(ctx, cyaml_emit_scalar(
+				ctx->emit, value, len));
+	}
+
+	ret = yaml_scalar_event_initialize(&event, cyaml__anchor_take(ctx),
 			(yaml_char_t *)tag,
 			(yaml_char_t *)value,
-			strlen(value),
+			len,
 			1, 0, YAML_PLAIN_SCALAR_STYLE);
 
 	return cyaml__emit_event_helper(ctx, ret, &event);
 }
 
 /**
- * Convert signed integer to string.
- *
- * \param[in]  value  The integer to convert.
- * \return String conversion of the value.
- */
-static const char * cyaml__get_int(
-		int64_t value)
-{
-	static char string[32];
-
-	sprintf(string, "%"PRIi64, value);
-
-	return string;
-}
-
-/**
- * Convert unsigned integer to string.
- *
- * \param[in]  value  The integer to convert.
- * \return String conversion of the value.
- */
-static const char * cyaml__get_uint(
-		uint64_t value)
-{
-	static char string[32];
-
-	sprintf(string, "%"PRIu64, value);
-
-	return string;
-}
-
-/**
- * Convert double precision floating point value to string.
+ * Helper to emit YAML scalar events, using libyaml.
  *
- * \param[in]  value  The value to convert.
- * \return String conversion of the value.
+ * \param[in]  ctx     The CYAML saving context.
+ * \param[in]  schema  The schema for the value to emit.
+ * \param[in]  value   The value to emit as a null-terminated C string.
+ * \param[in]  tag     YAML tag to use for output.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
  */
-static const char * cyaml__get_double(
-		double value)
+static inline cyaml_err_t cyaml__emit_scalar(
+		cyaml_ctx_t *ctx,
+		const cyaml_schema_value_t *schema,
+		const char *value,
+		const char *tag)
 {
-	static char string[64];
-
-	sprintf(string, "%g", value);
-
-	return string;
+	return cyaml__emit_scalar_len(ctx, schema, value, strlen(value), tag);
 }
 
 /**
@@ -582,7 +742,7 @@ static int64_t cyaml_sign_pad(uint64_t raw, size_t size)
  * \return \ref CYAML_OK on success, or appropriate error code otherwise.
  */
 static cyaml_err_t cyaml__write_int(
-		const cyaml_ctx_t *ctx,
+		cyaml_ctx_t *ctx,
 		const cyaml_schema_value_t *schema,
 		const uint8_t *data)
 {
@@ -593,7 +753,8 @@ static cyaml_err_t cyaml__write_int(
 			cyaml_data_read(schema->data_size, data, &err),
 			schema->data_size);
 	if (err == CYAML_OK) {
-		const char *string = cyaml__get_int(number);
+		char string[CYAML_NUMBER_BUF_SIZE];
+		cyaml_number_format_int(number, string);
 		err = cyaml__emit_scalar(ctx, schema, string, YAML_INT_TAG);
 	}
 
@@ -609,7 +770,7 @@ static cyaml_err_t cyaml__write_int(
  * \return \ref CYAML_OK on success, or appropriate error code otherwise.
  */
 static cyaml_err_t cyaml__write_uint(
-		const cyaml_ctx_t *ctx,
+		cyaml_ctx_t *ctx,
 		const cyaml_schema_value_t *schema,
 		const uint8_t *data)
 {
@@ -618,7 +779,8 @@ static cyaml_err_t cyaml__write_uint(
 
 	number = cyaml_data_read(schema->data_size, data, &err);
 	if (err == CYAML_OK) {
-		const char *string = cyaml__get_uint(number);
+		char string[CYAML_NUMBER_BUF_SIZE];
+		cyaml_number_format_uint(number, string);
 		err = cyaml__emit_scalar(ctx, schema, string, YAML_INT_TAG);
 	}
 
@@ -634,7 +796,7 @@ static cyaml_err_t cyaml__write_uint(
  * \return \ref CYAML_OK on success, or appropriate error code otherwise.
  */
 static cyaml_err_t cyaml__write_bool(
-		const cyaml_ctx_t *ctx,
+		cyaml_ctx_t *ctx,
 		const cyaml_schema_value_t *schema,
 		const uint8_t *data)
 {
@@ -659,7 +821,7 @@ static cyaml_err_t cyaml__write_bool(
  * \return \ref CYAML_OK on success, or appropriate error code otherwise.
  */
 static cyaml_err_t cyaml__write_enum(
-		const cyaml_ctx_t *ctx,
+		cyaml_ctx_t *ctx,
 		const cyaml_schema_value_t *schema,
 		const uint8_t *data)
 {
@@ -669,11 +831,39 @@ static cyaml_err_t cyaml__write_enum(
 	number = cyaml_data_read(schema->data_size, data, &err);
 	if (err == CYAML_OK) {
 		const cyaml_strval_t *strings = schema->enumeration.strings;
+		const cyaml_schema_value_info_t *info = NULL;
+		const cyaml_strval_index_t *index;
 		const char *string = NULL;
-		for (uint32_t i = 0; i < schema->enumeration.count; i++) {
-			if (number == strings[i].val) {
+
+		if (ctx->compiled != NULL) {
+			info = cyaml_schema_compiled_value(
+					ctx->compiled, schema);
+		}
+		if (info != NULL) {
+			index = info->strval;
+		} else {
+			/* Case sensitivity only matters for lookups by
+			 * string. */
+			err = cyaml_index_strval_get(ctx->config,
+					&ctx->index_cache, schema,
+					true, &index);
+			if (err != CYAML_OK) {
+				return err;
+			}
+		}
+
+		if (index != NULL) {
+			uint32_t i = cyaml_index_strval_by_val(index, number);
+			if (i != CYAML_STRVAL_IDX_NONE) {
 				string = strings[i].str;
-				break;
+			}
+		} else {
+			for (uint32_t i = 0; i < schema->enumeration.count;
+					i++) {
+				if (number == strings[i].val) {
+					string = strings[i].str;
+					break;
+				}
 			}
 		}
 		if (string == NULL) {
@@ -704,21 +894,21 @@ static cyaml_err_t cyaml__write_enum(
  * \return \ref CYAML_OK on success, or appropriate error code otherwise.
  */
 static cyaml_err_t cyaml__write_float(
-		const cyaml_ctx_t *ctx,
+		cyaml_ctx_t *ctx,
 		const cyaml_schema_value_t *schema,
 		const uint8_t *data)
 {
-	const char *string = NULL;
+	char string[CYAML_NUMBER_BUF_SIZE];
 
 	if (schema->data_size == sizeof(float)) {
 		float number;
 		memcpy(&number, data, schema->data_size);
-		string = cyaml__get_double(number);
+		cyaml_number_format_float(number, string);
 
 	} else if (schema->data_size == sizeof(double)) {
 		double number;
 		memcpy(&number, data, schema->data_size);
-		string = cyaml__get_double(number);
+		cyaml_number_format_double(number, string);
 	} else {
 		return CYAML_ERR_INVALID_DATA_SIZE;
 	}
@@ -735,7 +925,7 @@ static cyaml_err_t cyaml__write_float(
  * \return \ref CYAML_OK on success, or appropriate error code otherwise.
  */
 static cyaml_err_t cyaml__write_string(
-		const cyaml_ctx_t *ctx,
+		cyaml_ctx_t *ctx,
 		const cyaml_schema_value_t *schema,
 		const uint8_t *data)
 {
@@ -752,12 +942,12 @@ static cyaml_err_t cyaml__write_string(
  * \return \ref CYAML_OK on success, or appropriate error code otherwise.
  */
 static cyaml_err_t cyaml__write_scalar_value(
-		const cyaml_ctx_t *ctx,
+		cyaml_ctx_t *ctx,
 		const cyaml_schema_value_t *schema,
 		const cyaml_data_t *data)
 {
 	typedef cyaml_err_t (*cyaml_read_scalar_fn)(
-			const cyaml_ctx_t *ctx,
+			cyaml_ctx_t *ctx,
 			const cyaml_schema_value_t *schema,
 			const uint8_t *data_target);
 	static const cyaml_read_scalar_fn fn[CYAML__TYPE_COUNT] = {
@@ -783,7 +973,7 @@ static cyaml_err_t cyaml__write_scalar_value(
  * \return \ref CYAML_OK on success, or appropriate error code otherwise.
  */
 static cyaml_err_t cyaml__emit_flags_sequence(
-		const cyaml_ctx_t *ctx,
+		cyaml_ctx_t *ctx,
 		const cyaml_schema_value_t *schema,
 		uint64_t number)
 {
@@ -792,11 +982,16 @@ static cyaml_err_t cyaml__emit_flags_sequence(
 	cyaml_err_t err;
 	int ret;
 
-	ret = yaml_sequence_start_event_initialize(&event, NULL,
-			(yaml_char_t *)YAML_SEQ_TAG, 1,
-			YAML_ANY_SEQUENCE_STYLE);
-
-	err = cyaml__emit_event_helper(ctx, ret, &event);
+	if (ctx->emit != NULL) {
+		err = cyaml__emit_native_helper(ctx,
+				cyaml_emit_sequence_start(ctx->emit, false));
+	} else {
+		ret = yaml_sequence_start_event_initialize(&event,
+				cyaml__anchor_take(ctx),
+				(yaml_char_t *)YAML_SEQ_TAG, 1,
+				YAML_ANY_SEQUENCE_STYLE);
+		err = cyaml__emit_event_helper(ctx, ret, &event);
+	}
 	if (err != CYAML_OK) {
 		return err;
 	}
@@ -818,7 +1013,8 @@ static cyaml_err_t cyaml__emit_flags_sequence(
 		if (schema->flags & CYAML_FLAG_STRICT) {
 			return CYAML_ERR_INVALID_VALUE;
 		} else {
-			const char *string = cyaml__get_uint(number);
+			char string[CYAML_NUMBER_BUF_SIZE];
+			cyaml_number_format_uint(number, string);
 			err = cyaml__emit_scalar(ctx, schema, string,
 					YAML_STR_TAG);
 			if (err != CYAML_OK) {
@@ -827,6 +1023,11 @@ static cyaml_err_t cyaml__emit_flags_sequence(
 		}
 	}
 
+	if (ctx->emit != NULL) {
+		return cyaml__emit_native_helper(ctx,
+				cyaml_emit_sequence_end(ctx->emit));
+	}
+
 	ret = yaml_sequence_end_event_initialize(&event);
 
 	return cyaml__emit_event_helper(ctx, ret, &event);
@@ -844,7 +1045,7 @@ static cyaml_err_t cyaml__emit_flags_sequence(
  * \return \ref CYAML_OK on success, or appropriate error code otherwise.
  */
 static cyaml_err_t cyaml__write_flags_value(
-		const cyaml_ctx_t *ctx,
+		cyaml_ctx_t *ctx,
 		const cyaml_schema_value_t *schema,
 		const cyaml_data_t *data)
 {
@@ -859,6 +1060,58 @@ static cyaml_err_t cyaml__write_flags_value(
 	return err;
 }
 
+/**
+ * Write the anchor or alias for a value that may be reached more than once.
+ *
+ * The first time a shared value is written, its anchor is set for the
+ * value's first node.  After that, the value is written as an alias.
+ *
+ * \param[in]  ctx        The CYAML saving context.
+ * \param[in]  schema     CYAML schema for the value.
+ * \param[in]  data       The place to read the value's pointer from.
+ * \param[in]  seq_count  Entry count for sequence values.
+ * \param[out] alias_out  Returns true if an alias was written, else false.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__write_shared(
+		cyaml_ctx_t *ctx,
+		const cyaml_schema_value_t *schema,
+		const uint8_t *data,
+		unsigned seq_count,
+		bool *alias_out)
+{
+	const void *ptr = cyaml_data_read_pointer(data);
+	cyaml_shared_t *shared;
+	yaml_event_t event;
+	int ret;
+
+	*alias_out = false;
+
+	if (ptr == NULL) {
+		return CYAML_OK;
+	}
+
+	shared = cyaml_shared_find(&ctx->shared, ptr, schema, seq_count);
+	if (shared == NULL || shared->refs < 2) {
+		return CYAML_OK;
+	}
+
+	if (shared->id == 0) {
+		shared->id = ++ctx->anchor_count;
+		snprintf(ctx->anchor, sizeof(ctx->anchor),
+				"a%"PRIu32, shared->id);
+		ctx->anchor_pending = true;
+		return CYAML_OK;
+	}
+
+	snprintf(ctx->anchor, sizeof(ctx->anchor), "a%"PRIu32, shared->id);
+	cyaml__log(ctx->config, CYAML_LOG_INFO, "  <*%s>\n", ctx->anchor);
+
+	*alias_out = true;
+	ret = yaml_alias_event_initialize(&event, (yaml_char_t *)ctx->anchor);
+	return cyaml__emit_event_helper(ctx, ret, &event);
+}
+
 /**
  * Handle a YAML event corresponding to a YAML data value.
  *
@@ -882,6 +1135,15 @@ static cyaml_err_t cyaml__write_value(
 			cyaml__type_to_str(schema->type),
 			schema->flags & CYAML_FLAG_POINTER ? " (pointer)" : "");
 
+	if (ctx->shared.count != 0 && (schema->flags & CYAML_FLAG_POINTER)) {
+		bool alias;
+
+		err = cyaml__write_shared(ctx, schema, data, seq_count, &alias);
+		if (err != CYAML_OK || alias) {
+			return err;
+		}
+	}
+
 	data = cyaml__data_handle_pointer(ctx->config, schema, data);
 
 	switch (schema->type) {
@@ -1047,6 +1309,74 @@ static cyaml_err_t cyaml__write_mapping(
 	return err;
 }
 
+/**
+ * Write the remaining entries of a sequence of numbers, in bulk.
+ *
+ * Each entry is read and formatted straight into a scalar,
+ * without going through \ref cyaml__write_value.  Once the entries are
+ * written, the sequence is ended.
+ *
+ * \param[in]  ctx  The CYAML saving context.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__write_sequence_bulk(
+		cyaml_ctx_t *ctx)
+{
+	cyaml_state_t *state = ctx->state;
+	const cyaml_schema_value_t *entry = state->schema->sequence.entry;
+	const uint8_t *data = state->data +
+			entry->data_size * state->sequence.entry;
+
+	cyaml__log(ctx->config, CYAML_LOG_INFO,
+			"Sequence entries %u to %u of %u\n",
+			state->sequence.entry + 1,
+			state->sequence.count,
+			state->sequence.count);
+
+	while (state->sequence.entry < state->sequence.count) {
+		char string[CYAML_NUMBER_BUF_SIZE];
+		const char *tag = YAML_FLOAT_TAG;
+		cyaml_err_t err = CYAML_OK;
+		size_t len;
+
+		if (entry->type == CYAML_FLOAT) {
+			if (entry->data_size == sizeof(float)) {
+				float number;
+				memcpy(&number, data, sizeof(number));
+				len = cyaml_number_format_float(number, string);
+			} else {
+				double number;
+				memcpy(&number, data, sizeof(number));
+				len = cyaml_number_format_double(number,
+						string);
+			}
+		} else {
+			uint64_t raw = cyaml_data_read_bulk(
+					entry->data_size, data, &err);
+			if (err != CYAML_OK) {
+				return err;
+			}
+			tag = YAML_INT_TAG;
+			if (entry->type == CYAML_INT) {
+				len = cyaml_number_format_int(cyaml_sign_pad(
+						raw, entry->data_size), string);
+			} else {
+				len = cyaml_number_format_uint(raw, string);
+			}
+		}
+
+		state->sequence.entry++;
+
+		err = cyaml__emit_scalar_len(ctx, entry, string, len, tag);
+		if (err != CYAML_OK) {
+			return err;
+		}
+		data += entry->data_size;
+	}
+
+	return cyaml__stack_pop(ctx, true);
+}
+
 /**
  * YAML saving handler for the \ref CYAML_STATE_IN_SEQUENCE state.
  *
@@ -1068,6 +1398,9 @@ static cyaml_err_t cyaml__write_sequence(
 		if (value->type == CYAML_SEQUENCE) {
 			return CYAML_ERR_SEQUENCE_IN_SEQUENCE;
 
+		} else if (cyaml_schema_entry_is_bulk(value)) {
+			return cyaml__write_sequence_bulk(ctx);
+
 		} else if (value->type == CYAML_SEQUENCE_FIXED) {
 			seq_count = value->sequence.max;
 		}
@@ -1137,82 +1470,573 @@ static inline cyaml_err_t cyaml__validate_save_params(
 	return CYAML_OK;
 }
 
+/** Number of shared value walk frames that are allocated on the C stack. */
+#define CYAML_SHARED_STACK_INLINE 32
+
 /**
- * The main YAML saving function.
+ * A shared value walk frame, for a mapping or sequence whose contents
+ * contain pointers.
+ */
+typedef struct cyaml_shared_frame {
+	const cyaml_schema_value_t *schema; /**< Schema for the value. */
+	const uint8_t *data; /**< The value's data. */
+	uint32_t idx;   /**< Next mapping field or sequence entry to visit. */
+	uint32_t count; /**< Sequence entry count. */
+} cyaml_shared_frame_t;
+
+/**
+ * Context for counting the references to pointer values before saving.
+ */
+typedef struct cyaml_shared_walk {
+	cyaml_ctx_t *ctx;             /**< The CYAML saving context. */
+	cyaml_shared_frame_t *stack;  /**< The work stack. */
+	uint32_t stack_idx;           /**< Next (empty) work stack slot. */
+	uint32_t stack_max;           /**< Current work stack size. */
+	/** Initial work stack. */
+	cyaml_shared_frame_t stack_inline[CYAML_SHARED_STACK_INLINE];
+} cyaml_shared_walk_t;
+
+/**
+ * Start visiting a value, while counting pointer value references.
  *
- * The public interfaces are wrappers around this.
+ * Pointer values are counted in the saving context's shared value table.
+ * The contents of values that were already reached are not visited again,
+ * and neither are contents that contain no pointers.
  *
- * \param[in] config     Client's CYAML configuration structure.
- * \param[in] schema     CYAML schema for the YAML to be saved.
- * \param[in] data       The caller-owned data to be saved.
- * \param[in] seq_count  If top level type is sequence, this should be the
- *                       entry count, otherwise it is ignored.
- * \param[in] emitter    An initialised `libyaml` emitter object
- *                       with its output set.
+ * \param[in]  walk    The shared value walk context.
+ * \param[in]  schema  The schema for the value.
+ * \param[in]  data    The value's data, or for \ref CYAML_FLAG_POINTER
+ *                     values, the address of the pointer to the data.
+ * \param[in]  count   If value is of type \ref CYAML_SEQUENCE, this is the
+ *                     number of entries in the sequence.
  * \return \ref CYAML_OK on success, or appropriate error code otherwise.
  */
-static cyaml_err_t cyaml__save(
-		const cyaml_config_t *config,
+static cyaml_err_t cyaml__shared_push(
+		cyaml_shared_walk_t *walk,
 		const cyaml_schema_value_t *schema,
-		const cyaml_data_t *data,
-		unsigned seq_count,
-		yaml_emitter_t *emitter)
+		const uint8_t *data,
+		unsigned count)
 {
-	cyaml_ctx_t ctx = {
-		.config = config,
-		.emitter = emitter,
-		.seq_count = seq_count,
+	cyaml_ctx_t *ctx = walk->ctx;
+
+	if (schema->type == CYAML_IGNORE) {
+		return CYAML_OK;
+	} else if (schema->type == CYAML_SEQUENCE_FIXED) {
+		count = schema->sequence.max;
+	}
+
+	if (schema->flags & CYAML_FLAG_POINTER) {
+		const uint8_t *ptr = cyaml_data_read_pointer(data);
+		const cyaml_shared_t *shared;
+
+		if (ptr == NULL) {
+			return CYAML_OK;
+		}
+
+		shared = cyaml_shared_ref(ctx->config, &ctx->shared,
+				ptr, schema, count);
+		if (shared == NULL) {
+			return CYAML_ERR_OOM;
+		} else if (shared->refs > 1) {
+			return CYAML_OK;
+		}
+		data = ptr;
+	}
+
+	if (!cyaml_schema_contents_have_pointers(ctx->compiled, schema) ||
+	    (schema->type != CYAML_MAPPING && count == 0)) {
+		return CYAML_OK;
+	}
+
+	if (walk->stack_idx == walk->stack_max) {
+		cyaml_shared_frame_t *temp;
+		uint32_t max = walk->stack_max * 2;
+
+		if (walk->stack == walk->stack_inline) {
+			temp = cyaml__alloc(ctx->config,
+					sizeof(*temp) * max, false);
+			if (temp != NULL) {
+				memcpy(temp, walk->stack_inline,
+						sizeof(walk->stack_inline));
+			}
+		} else {
+			temp = cyaml__realloc(ctx->config, walk->stack, 0,
+					sizeof(*temp) * max, false);
+		}
+		if (temp == NULL) {
+			return CYAML_ERR_OOM;
+		}
+		walk->stack = temp;
+		walk->stack_max = max;
+	}
+
+	walk->stack[walk->stack_idx++] = (cyaml_shared_frame_t) {
+		.schema = schema,
+		.data = data,
+		.count = count,
 	};
-	typedef cyaml_err_t (* const cyaml_write_fn)(
-			cyaml_ctx_t *ctx);
-	static const cyaml_write_fn fn[CYAML_STATE__COUNT] = {
-		[CYAML_STATE_START]        = cyaml__write_start,
-		[CYAML_STATE_IN_STREAM]    = cyaml__write_stream,
-		[CYAML_STATE_IN_DOC]       = cyaml__write_doc,
-		[CYAML_STATE_IN_MAP_KEY]   = cyaml__write_mapping,
-		[CYAML_STATE_IN_MAP_VALUE] = cyaml__write_mapping,
-		[CYAML_STATE_IN_SEQUENCE]  = cyaml__write_sequence,
+	return CYAML_OK;
+}
+
+/**
+ * Visit the next child of the value on top of the shared value walk stack.
+ *
+ * If the value has no children left, it is popped.
+ *
+ * \param[in]  walk  The shared value walk context.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__shared_step(
+		cyaml_shared_walk_t *walk)
+{
+	cyaml_shared_frame_t *frame = &walk->stack[walk->stack_idx - 1];
+	const cyaml_schema_value_t *schema = frame->schema;
+
+	if (schema->type == CYAML_MAPPING) {
+		const cyaml_schema_field_t *field =
+				&schema->mapping.fields[frame->idx];
+
+		if (field->key != NULL) {
+			const uint8_t *data = frame->data;
+			unsigned count = 0;
+
+			frame->idx++;
+			if (field->value.type == CYAML_SEQUENCE) {
+				cyaml_err_t err;
+				count = cyaml_data_read(field->count_size,
+						data + field->count_offset,
+						&err);
+				if (err != CYAML_OK) {
+					return err;
+				}
+			}
+			/* May move the work stack; frame is invalid after. */
+			return cyaml__shared_push(walk, &field->value,
+					data + field->data_offset, count);
+		}
+	} else if (frame->idx < frame->count) {
+		const cyaml_schema_value_t *entry = schema->sequence.entry;
+		size_t data_size = entry->data_size;
+		const uint8_t *data;
+
+		if (entry->flags & CYAML_FLAG_POINTER) {
+			data_size = sizeof(data);
+		} else if (entry->type == CYAML_SEQUENCE_FIXED) {
+			data_size *= entry->sequence.max;
+		}
+
+		data = frame->data + data_size * frame->idx;
+		frame->idx++;
+		return cyaml__shared_push(walk, entry, data, 0);
+	}
+
+	walk->stack_idx--;
+	return CYAML_OK;
+}
+
+/**
+ * Count the references to the pointer values in the data to be saved.
+ *
+ * \param[in]  ctx        The CYAML saving context.
+ * \param[in]  schema     CYAML schema for the YAML to be saved.
+ * \param[in]  data       The address of the pointer to the data to be saved.
+ * \param[in]  seq_count  Top level sequence count.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__shared_count(
+		cyaml_ctx_t *ctx,
+		const cyaml_schema_value_t *schema,
+		const uint8_t *data,
+		unsigned seq_count)
+{
+	cyaml_shared_walk_t walk = {
+		.ctx = ctx,
+		.stack_max = CYAML_SHARED_STACK_INLINE,
 	};
+	cyaml_err_t err;
+
+	walk.stack = walk.stack_inline;
+
+	err = cyaml__shared_push(&walk, schema, data, seq_count);
+	while (err == CYAML_OK && walk.stack_idx > 0) {
+		err = cyaml__shared_step(&walk);
+	}
+
+	if (walk.stack != walk.stack_inline) {
+		cyaml__free(ctx->config, walk.stack);
+	}
+	return err;
+}
+
+/** YAML saving handler function type. */
+typedef cyaml_err_t (* const cyaml_write_state_fn)(
+		cyaml_ctx_t *ctx);
+
+/** YAML saving handlers, indexed by CYAML save state. */
+static const cyaml_write_state_fn cyaml__write_fn[CYAML_STATE__COUNT] = {
+	[CYAML_STATE_START]        = cyaml__write_start,
+	[CYAML_STATE_IN_STREAM]    = cyaml__write_stream,
+	[CYAML_STATE_IN_DOC]       = cyaml__write_doc,
+	[CYAML_STATE_IN_MAP_KEY]   = cyaml__write_mapping,
+	[CYAML_STATE_IN_MAP_VALUE] = cyaml__write_mapping,
+	[CYAML_STATE_IN_SEQUENCE]  = cyaml__write_sequence,
+};
+
+/**
+ * Save a YAML document using a CYAML saving context.
+ *
+ * The context's state stack allocation is left in place for reuse, and
+ * must be freed by the caller.
+ *
+ * \param[in] ctx        The CYAML saving context, with its config and
+ *                       emitter set, and an empty state stack.
+ * \param[in] schema     CYAML schema for the YAML to be saved.
+ * \param[in] data       The caller-owned data to be saved.
+ * \param[in] seq_count  If top level type is sequence, this should be the
+ *                       entry count, otherwise it is ignored.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__save_ctx(
+		cyaml_ctx_t *ctx,
+		const cyaml_schema_value_t *schema,
+		const cyaml_data_t *data,
+		unsigned seq_count)
+{
 	cyaml_err_t err = CYAML_OK;
 
-	err = cyaml__validate_save_params(config, schema, data, seq_count);
+	err = cyaml__validate_save_params(ctx->config, schema, data, seq_count);
 	if (err != CYAML_OK) {
 		return err;
 	}
 
-	err = cyaml__stack_push(&ctx, CYAML_STATE_START, schema, &data);
+	ctx->seq_count = seq_count;
+	ctx->compiled = cyaml_schema_compiled_get(ctx->config, schema);
+
+	if (ctx->config->flags & CYAML_CFG_ALIASES) {
+		err = cyaml__shared_count(ctx, schema,
+				(const uint8_t *)&data, seq_count);
+		if (err != CYAML_OK) {
+			goto out;
+		}
+	}
+
+	err = cyaml__save_presize(ctx);
+	if (err != CYAML_OK) {
+		goto out;
+	}
+
+	err = cyaml__stack_push(ctx, CYAML_STATE_START, schema, &data);
 	if (err != CYAML_OK) {
 		goto out;
 	}
 
 	do {
-		cyaml__log(ctx.config, CYAML_LOG_DEBUG, "Handle state %s\n",
-				cyaml__state_to_str(ctx.state->state));
-		err = fn[ctx.state->state](&ctx);
+		cyaml__log(ctx->config, CYAML_LOG_DEBUG, "Handle state %s\n",
+				cyaml__state_to_str(ctx->state->state));
+		err = cyaml__write_fn[ctx->state->state](ctx);
 		if (err != CYAML_OK) {
 			goto out;
 		}
-	} while (ctx.stack_idx > 1);
+	} while (ctx->stack_idx > 1);
 
-	cyaml__stack_pop(&ctx, true);
+	cyaml__stack_pop(ctx, true);
 
-	assert(ctx.stack_idx == 0);
+	assert(ctx->stack_idx == 0);
 
-	if (!yaml_emitter_flush(emitter)) {
-		cyaml__log(config, CYAML_LOG_ERROR,
+	/* The native emitter flushes at the end of the stream. */
+	if (ctx->emit == NULL && !yaml_emitter_flush(ctx->emitter)) {
+		cyaml__log(ctx->config, CYAML_LOG_ERROR,
 				"LibYAML: Failed to flush emitter: %s\n",
-				emitter->problem);
+				ctx->emitter->problem);
 		err = CYAML_ERR_LIBYAML_EMITTER;
 	}
 
 out:
 	if (err != CYAML_OK) {
-		cyaml__backtrace(&ctx);
+		cyaml__backtrace(ctx);
+	}
+	while (ctx->stack_idx > 0) {
+		cyaml__stack_pop(ctx, false);
+	}
+	cyaml_shared_fini(ctx->config, &ctx->shared);
+	ctx->anchor_pending = false;
+	ctx->anchor_count = 0;
+	return err;
+}
+
+/**
+ * The main YAML saving function.
+ *
+ * The public interfaces are wrappers around this.
+ *
+ * \param[in] config     Client's CYAML configuration structure.
+ * \param[in] schema     CYAML schema for the YAML to be saved.
+ * \param[in] data       The caller-owned data to be saved.
+ * \param[in] seq_count  If top level type is sequence, this should be the
+ *                       entry count, otherwise it is ignored.
+ * \param[in] emitter    An initialised `libyaml` emitter object
+ *                       with its output set.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__save(
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		const cyaml_data_t *data,
+		unsigned seq_count,
+		yaml_emitter_t *emitter)
+{
+	cyaml_ctx_t ctx = {
+		.config = config,
+		.emitter = emitter,
+	};
+	cyaml_err_t err;
+
+	err = cyaml__save_ctx(&ctx, schema, data, seq_count);
+	if (ctx.stack != NULL) {
+		cyaml__free(config, ctx.stack);
+		cyaml_index_cache_fini(config, &ctx.index_cache);
+	}
+	return err;
+}
+
+/**
+ * CYAML reusable saver.
+ *
+ * The saving context persists between saves, so its allocations are
+ * reused.
+ */
+struct cyaml_saver {
+	cyaml_ctx_t ctx;        /**< Saving context for the saver. */
+	yaml_emitter_t emitter; /**< The saver's `libyaml` emitter. */
+	bool emitter_ready;     /**< Whether emitter is set up and unused. */
+};
+
+/**
+ * Reset a `libyaml` emitter, ready to emit a new output.
+ *
+ * `libyaml` has no interface for reusing an emitter, so it is deleted and
+ * initialised again.
+ *
+ * \param[in]  emitter  The emitter to reset.
+ * \return true on success, false if the emitter could not be initialised.
+ */
+static bool cyaml__emitter_reset(
+		yaml_emitter_t *emitter)
+{
+	yaml_emitter_delete(emitter);
+	return yaml_emitter_initialize(emitter);
+}
+
+/**
+ * Check whether a client's config selects the native emitter.
+ *
+ * The native emitter doesn't write anchors or aliases, so `libyaml` is
+ * used whenever \ref CYAML_CFG_ALIASES is set.
+ *
+ * \param[in]  config  Client's CYAML configuration structure, or NULL.
+ * \return true if the native emitter should be used, false otherwise.
+ */
+static inline bool cyaml__use_native_emit(
+		const cyaml_config_t *config)
+{
+	return config != NULL &&
+			(config->flags & CYAML_CFG_FAST_EMIT) &&
+			!(config->flags & CYAML_CFG_ALIASES);
+}
+
+/**
+ * Write a YAML document to a libyaml output handler, with the native emitter.
+ *
+ * \param[in]  saver      Reusable saver to save with, or NULL to use a
+ *                        new saving context.
+ * \param[in]  config     Client's CYAML configuration structure.
+ * \param[in]  schema     CYAML schema for the YAML to be saved.
+ * \param[in]  data       The caller-owned data to be saved.
+ * \param[in]  seq_count  If top level type is sequence, this should be the
+ *                        entry count, otherwise it is ignored.
+ * \param[in]  handler    The libyaml write handler.
+ * \param[in]  hctx       The write handler's context.
+ * \param[in]  herr       Pointer to the write handler's error code, which
+ *                        is returned in preference to the emitter error,
+ *                        if the handler failed.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__save_native(
+		cyaml_saver_t *saver,
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		const cyaml_data_t *data,
+		unsigned seq_count,
+		yaml_write_handler_t *handler,
+		void *hctx,
+		const cyaml_err_t *herr)
+{
+	cyaml_ctx_t local = {
+		.config = config,
+	};
+	cyaml_ctx_t *ctx = (saver != NULL) ? &saver->ctx : &local;
+	cyaml_emit_t emit;
+	cyaml_err_t err;
+
+	cyaml_emit_init(&emit, config, handler, hctx);
+
+	ctx->emit = &emit;
+	err = cyaml__save_ctx(ctx, schema, data, seq_count);
+	ctx->emit = NULL;
+
+	cyaml_emit_fini(&emit);
+
+	if (err != CYAML_OK && *herr != CYAML_OK) {
+		err = *herr;
+	}
+
+	if (local.stack != NULL) {
+		cyaml__free(config, local.stack);
+		cyaml_index_cache_fini(config, &local.index_cache);
+	}
+	return err;
+}
+
+/**
+ * Emit a YAML document to a libyaml output handler.
+ *
+ * \param[in]  saver      Reusable saver to emit with, or NULL to use a
+ *                        new emitter and saving context.
+ * \param[in]  config     Client's CYAML configuration structure.
+ * \param[in]  schema     CYAML schema for the YAML to be saved.
+ * \param[in]  data       The caller-owned data to be saved.
+ * \param[in]  seq_count  If top level type is sequence, this should be the
+ *                        entry count, otherwise it is ignored.
+ * \param[in]  handler    The libyaml write handler.
+ * \param[in]  hctx       The write handler's context.
+ * \param[in]  herr       Pointer to the write handler's error code, which
+ *                        is returned in preference to the libyaml emitter
+ *                        error, if the handler failed.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__save_output(
+		cyaml_saver_t *saver,
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		const cyaml_data_t *data,
+		unsigned seq_count,
+		yaml_write_handler_t *handler,
+		void *hctx,
+		const cyaml_err_t *herr)
+{
+	cyaml_err_t err;
+	yaml_emitter_t emitter;
+
+	if (cyaml__use_native_emit(config)) {
+		return cyaml__save_native(saver, config, schema, data,
+				seq_count, handler, hctx, herr);
+	}
+
+	if (saver != NULL) {
+		if (!saver->emitter_ready) {
+			if (!cyaml__emitter_reset(&saver->emitter)) {
+				/* Leave emitter in a state that is safe to
+				 * delete. */
+				memset(&saver->emitter, 0,
+						sizeof(saver->emitter));
+				return CYAML_ERR_LIBYAML_EMITTER_INIT;
+			}
+		}
+
+		yaml_emitter_set_output(&saver->emitter, handler, hctx);
+		saver->emitter_ready = false;
+
+		err = cyaml__save_ctx(&saver->ctx, schema, data, seq_count);
+		if (err != CYAML_OK && *herr != CYAML_OK) {
+			err = *herr;
+		}
+		return err;
+	}
+
+	/* Initialize emitter */
+	if (!yaml_emitter_initialize(&emitter)) {
+		return CYAML_ERR_LIBYAML_EMITTER_INIT;
+	}
+
+	/* Set output handler */
+	yaml_emitter_set_output(&emitter, handler, hctx);
+
+	/* Emit the document */
+	err = cyaml__save(config, schema, data, seq_count, &emitter);
+	if (err != CYAML_OK && *herr != CYAML_OK) {
+		err = *herr;
+	}
+
+	/* Cleanup */
+	yaml_emitter_delete(&emitter);
+
+	return err;
+}
+
+/** CYAML save file context. */
+typedef struct cyaml_file_ctx {
+	FILE *file;      /**< The file to write to. */
+	cyaml_err_t err; /**< Any error writing the file. */
+} cyaml_file_ctx_t;
+
+/**
+ * Write handler for libyaml, which writes output to a file.
+ *
+ * \param[in]  data    A pointer to cyaml file context structure.
+ * \param[in]  buffer  The buffer with bytes to be written.
+ * \param[in]  size    The number of bytes to be written.
+ * \return 1 on sucess, 0 otherwise.
+ */
+static int cyaml__file_handler(
+		void *data,
+		unsigned char *buffer,
+		size_t size)
+{
+	cyaml_file_ctx_t *file_ctx = data;
+
+	if (fwrite(buffer, 1, size, file_ctx->file) != size) {
+		file_ctx->err = CYAML_ERR_FILE_WRITE;
+		return 0;
 	}
-	while (ctx.stack_idx > 0) {
-		cyaml__stack_pop(&ctx, false);
+
+	return 1;
+}
+
+/**
+ * Save a YAML document to a file, with the native emitter.
+ *
+ * \param[in] path       Path to YAML file to write.
+ * \param[in] config     Client's CYAML configuration structure.
+ * \param[in] schema     CYAML schema for the YAML to be saved.
+ * \param[in] data       The caller-owned data to be saved.
+ * \param[in] seq_count  If top level type is sequence, this should be the
+ *                       entry count, otherwise it is ignored.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__save_file_native(
+		const char *path,
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		const cyaml_data_t *data,
+		unsigned seq_count)
+{
+	cyaml_file_ctx_t file_ctx = {
+		.err = CYAML_OK,
+	};
+	cyaml_err_t err;
+
+	file_ctx.file = fopen(path, "w");
+	if (file_ctx.file == NULL) {
+		return CYAML_ERR_FILE_OPEN;
+	}
+
+	err = cyaml__save_native(NULL, config, schema, data, seq_count,
+			cyaml__file_handler, &file_ctx, &file_ctx.err);
+
+	if (fclose(file_ctx.file) != 0 && err == CYAML_OK) {
+		err = CYAML_ERR_FILE_WRITE;
 	}
-	cyaml__free(config, ctx.stack);
+
 	return err;
 }
 
@@ -1228,6 +2052,11 @@ cyaml_err_t cyaml_save_file(
 	cyaml_err_t err;
 	yaml_emitter_t emitter;
 
+	if (cyaml__use_native_emit(config)) {
+		return cyaml__save_file_native(path, config, schema,
+				data, seq_count);
+	}
+
 	/* Initialize parser */
 	if (!yaml_emitter_initialize(&emitter)) {
 		return CYAML_ERR_LIBYAML_EMITTER_INIT;
@@ -1258,6 +2087,9 @@ cyaml_err_t cyaml_save_file(
 	return CYAML_OK;
 }
 
+/** Size of the first allocation for a serialised output buffer. */
+#define CYAML_BUFFER_SIZE_MIN 1024
+
 /** CYAML save buffer context. */
 typedef struct cyaml_buffer_ctx {
 	/** Client's CYAML configuration structure. */
@@ -1266,6 +2098,7 @@ typedef struct cyaml_buffer_ctx {
 	size_t used;     /**< Current number of bytes used in `data`. */
 	char *data;      /**< Current allocation for serialised output. */
 	cyaml_err_t err; /**< Any error encounted in buffer handling. */
+	bool fixed;      /**< Whether `data` is a caller-owned fixed buffer. */
 } cyaml_buffer_ctx_t;
 
 /**
@@ -1275,7 +2108,9 @@ typedef struct cyaml_buffer_ctx {
  * characters to the output.  The handler should write size bytes of the
  * buffer to the output.
  *
- * \todo Could be more efficient about this, but for now, this is fine.
+ * Allocated buffers grow geometrically, so that the number of reallocations
+ * is logarithmic in the size of the output.  The excess is trimmed once the
+ * document is complete.
  *
  * \param[in]  data    A pointer to cyaml buffer context struture.
  * \param[in]  buffer  The buffer with bytes to be written.
@@ -1294,18 +2129,39 @@ static int cyaml__buffer_handler(
 	};
 
 	if (size > (buffer_ctx->len - buffer_ctx->used)) {
-		char *temp = cyaml__realloc(
-				buffer_ctx->config,
-				buffer_ctx->data,
+		size_t len = buffer_ctx->len;
+		char *temp;
+
+		if (buffer_ctx->fixed) {
+			buffer_ctx->err = CYAML_ERR_BUFFER_FULL;
+			return RETURN_FAILURE;
+		}
+
+		if (size > SIZE_MAX - buffer_ctx->used) {
+			buffer_ctx->err = CYAML_ERR_OOM;
+			return RETURN_FAILURE;
+		}
+
+		if (len < CYAML_BUFFER_SIZE_MIN) {
+			len = CYAML_BUFFER_SIZE_MIN;
+		}
+		while (len < buffer_ctx->used + size) {
+			len = (len > SIZE_MAX / 2) ?
+					buffer_ctx->used + size : len * 2;
+		}
+
+		temp = cyaml__realloc(
+				buffer_ctx->config,
+				buffer_ctx->data,
 				buffer_ctx->len,
-				buffer_ctx->used + size,
+				len,
 				false);
 		if (temp == NULL) {
 			buffer_ctx->err = CYAML_ERR_OOM;
 			return RETURN_FAILURE;
 		}
 		buffer_ctx->data = temp;
-		buffer_ctx->len = buffer_ctx->used + size;
+		buffer_ctx->len = len;
 	}
 
 	memcpy(buffer_ctx->data + buffer_ctx->used, buffer, size);
@@ -1314,6 +2170,60 @@ static int cyaml__buffer_handler(
 	return RETURN_SUCCESS;
 }
 
+/**
+ * Save a YAML document into a new allocation.
+ *
+ * \param[in]  saver      Reusable saver to emit with, or NULL.
+ * \param[out] output     Returns the caller-owned serialised YAML data on
+ *                        success, untouched on failure.
+ * \param[out] len        Returns the length of the data in output on success,
+ *                        untouched on failure.
+ * \param[in]  config     Client's CYAML configuration structure.
+ * \param[in]  schema     CYAML schema for the YAML to be saved.
+ * \param[in]  data       The caller-owned data to be saved.
+ * \param[in]  seq_count  If top level type is sequence, this should be the
+ *                        entry count, otherwise it is ignored.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__save_data(
+		cyaml_saver_t *saver,
+		char **output,
+		size_t *len,
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		const cyaml_data_t *data,
+		unsigned seq_count)
+{
+	cyaml_err_t err;
+	cyaml_buffer_ctx_t buffer_ctx = {
+		.config = config,
+		.err = CYAML_OK,
+	};
+
+	err = cyaml__save_output(saver, config, schema, data, seq_count,
+			cyaml__buffer_handler, &buffer_ctx, &buffer_ctx.err);
+	if (err != CYAML_OK) {
+		if ((config != NULL) && (config->mem_fn != NULL)) {
+			cyaml__free(config, buffer_ctx.data);
+		}
+		return err;
+	}
+
+	/* Trim the excess from the final geometric growth step. */
+	if (buffer_ctx.used != 0 && buffer_ctx.used < buffer_ctx.len) {
+		char *temp = cyaml__realloc(config, buffer_ctx.data,
+				buffer_ctx.len, buffer_ctx.used, false);
+		if (temp != NULL) {
+			buffer_ctx.data = temp;
+		}
+	}
+
+	*output = buffer_ctx.data;
+	*len = buffer_ctx.used;
+
+	return CYAML_OK;
+}
+
 /* Exported function, documented in include/cyaml/cyaml.h */
 cyaml_err_t cyaml_save_data(
 		char **output,
@@ -1322,40 +2232,737 @@ cyaml_err_t cyaml_save_data(
 		const cyaml_schema_value_t *schema,
 		const cyaml_data_t *data,
 		unsigned seq_count)
+{
+	return cyaml__save_data(NULL, output, len,
+			config, schema, data, seq_count);
+}
+
+/**
+ * Save a YAML document into a caller-provided buffer.
+ *
+ * \param[in]  saver      Reusable saver to emit with, or NULL.
+ * \param[out] buffer     Caller-owned buffer to write the YAML into.
+ * \param[in]  size       Size of buffer in bytes.
+ * \param[out] len        Returns the length of the data written to buffer
+ *                        on success, untouched on failure.
+ * \param[in]  config     Client's CYAML configuration structure.
+ * \param[in]  schema     CYAML schema for the YAML to be saved.
+ * \param[in]  data       The caller-owned data to be saved.
+ * \param[in]  seq_count  If top level type is sequence, this should be the
+ *                        entry count, otherwise it is ignored.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__save_buffer(
+		cyaml_saver_t *saver,
+		char *buffer,
+		size_t size,
+		size_t *len,
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		const cyaml_data_t *data,
+		unsigned seq_count)
 {
 	cyaml_err_t err;
-	yaml_emitter_t emitter;
 	cyaml_buffer_ctx_t buffer_ctx = {
 		.config = config,
+		.len = size,
+		.data = buffer,
 		.err = CYAML_OK,
+		.fixed = true,
 	};
 
-	/* Initialize parser */
-	if (!yaml_emitter_initialize(&emitter)) {
+	if ((buffer == NULL && size != 0) || len == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_DATA;
+	}
+
+	err = cyaml__save_output(saver, config, schema, data, seq_count,
+			cyaml__buffer_handler, &buffer_ctx, &buffer_ctx.err);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	*len = buffer_ctx.used;
+
+	return CYAML_OK;
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_save_buffer(
+		char *buffer,
+		size_t size,
+		size_t *len,
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		const cyaml_data_t *data,
+		unsigned seq_count)
+{
+	return cyaml__save_buffer(NULL, buffer, size, len,
+			config, schema, data, seq_count);
+}
+
+/** CYAML save write callback context. */
+typedef struct cyaml_write_ctx {
+	cyaml_write_fn_t write_fn; /**< Client's write function. */
+	void *write_ctx;           /**< Client's write function context. */
+	cyaml_err_t err;           /**< Any error returned by `write_fn`. */
+} cyaml_write_ctx_t;
+
+/**
+ * Write handler for libyaml, which passes output to a client function.
+ *
+ * \param[in]  data    A pointer to cyaml write context struture.
+ * \param[in]  buffer  The buffer with bytes to be written.
+ * \param[in]  size    The number of bytes to be written.
+ * \return 1 on sucess, 0 otherwise.
+ */
+static int cyaml__write_handler(
+		void *data,
+		unsigned char *buffer,
+		size_t size)
+{
+	cyaml_write_ctx_t *write_ctx = data;
+	enum {
+		RETURN_SUCCESS = 1,
+		RETURN_FAILURE = 0,
+	};
+
+	if (size == 0) {
+		return RETURN_SUCCESS;
+	}
+
+	write_ctx->err = write_ctx->write_fn(write_ctx->write_ctx,
+			(const char *)buffer, size);
+	if (write_ctx->err != CYAML_OK) {
+		return RETURN_FAILURE;
+	}
+
+	return RETURN_SUCCESS;
+}
+
+/**
+ * Save a YAML document through a client write function.
+ *
+ * \param[in]  saver      Reusable saver to emit with, or NULL.
+ * \param[in]  write_fn   Client function to write the output.
+ * \param[in]  write_ctx  Client's private context for write_fn.
+ * \param[in]  config     Client's CYAML configuration structure.
+ * \param[in]  schema     CYAML schema for the YAML to be saved.
+ * \param[in]  data       The caller-owned data to be saved.
+ * \param[in]  seq_count  If top level type is sequence, this should be the
+ *                        entry count, otherwise it is ignored.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__save_stream(
+		cyaml_saver_t *saver,
+		cyaml_write_fn_t write_fn,
+		void *write_ctx,
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		const cyaml_data_t *data,
+		unsigned seq_count)
+{
+	cyaml_write_ctx_t ctx = {
+		.write_fn = write_fn,
+		.write_ctx = write_ctx,
+		.err = CYAML_OK,
+	};
+
+	if (write_fn == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_DATA;
+	}
+
+	return cyaml__save_output(saver, config, schema, data, seq_count,
+			cyaml__write_handler, &ctx, &ctx.err);
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_save_stream(
+		cyaml_write_fn_t write_fn,
+		void *write_ctx,
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		const cyaml_data_t *data,
+		unsigned seq_count)
+{
+	return cyaml__save_stream(NULL, write_fn, write_ctx,
+			config, schema, data, seq_count);
+}
+
+/**
+ * Client write function implementation for writing to a file descriptor.
+ *
+ * \param[in]  ctx   Pointer to the file descriptor to write to.
+ * \param[in]  data  The bytes to write.
+ * \param[in]  len   The number of bytes to write.
+ * \return \ref CYAML_OK on success, or \ref CYAML_ERR_FILE_WRITE on failure.
+ */
+static cyaml_err_t cyaml__fd_write(
+		void *ctx,
+		const char *data,
+		size_t len)
+{
+	const int *fd = ctx;
+
+	while (len > 0) {
+		ssize_t written = write(*fd, data, len);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return CYAML_ERR_FILE_WRITE;
+		}
+		data += written;
+		len -= (size_t)written;
+	}
+
+	return CYAML_OK;
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_save_fd(
+		int fd,
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		const cyaml_data_t *data,
+		unsigned seq_count)
+{
+	return cyaml_save_stream(cyaml__fd_write, &fd,
+			config, schema, data, seq_count);
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_saver_create(
+		const cyaml_config_t *config,
+		cyaml_saver_t **saver_out)
+{
+	cyaml_saver_t *saver;
+
+	if (config == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_CONFIG;
+	}
+	if (config->mem_fn == NULL) {
+		return CYAML_ERR_BAD_CONFIG_NULL_MEMFN;
+	}
+	if (saver_out == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_DATA;
+	}
+
+	saver = cyaml__alloc(config, sizeof(*saver), true);
+	if (saver == NULL) {
+		return CYAML_ERR_OOM;
+	}
+
+	if (!yaml_emitter_initialize(&saver->emitter)) {
+		cyaml__free(config, saver);
 		return CYAML_ERR_LIBYAML_EMITTER_INIT;
 	}
 
-	/* Set input file */
-	yaml_emitter_set_output(&emitter, cyaml__buffer_handler, &buffer_ctx);
+	saver->ctx.config = config;
+	saver->ctx.emitter = &saver->emitter;
+	saver->emitter_ready = true;
+
+	*saver_out = saver;
+	return CYAML_OK;
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_saver_save_data(
+		cyaml_saver_t *saver,
+		char **output,
+		size_t *len,
+		const cyaml_schema_value_t *schema,
+		const cyaml_data_t *data,
+		unsigned seq_count)
+{
+	if (saver == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_DATA;
+	}
+
+	return cyaml__save_data(saver, output, len,
+			saver->ctx.config, schema, data, seq_count);
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_saver_save_buffer(
+		cyaml_saver_t *saver,
+		char *buffer,
+		size_t size,
+		size_t *len,
+		const cyaml_schema_value_t *schema,
+		const cyaml_data_t *data,
+		unsigned seq_count)
+{
+	if (saver == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_DATA;
+	}
+
+	return cyaml__save_buffer(saver, buffer, size, len,
+			saver->ctx.config, schema, data, seq_count);
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_saver_save_stream(
+		cyaml_saver_t *saver,
+		cyaml_write_fn_t write_fn,
+		void *write_ctx,
+		const cyaml_schema_value_t *schema,
+		const cyaml_data_t *data,
+		unsigned seq_count)
+{
+	if (saver == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_DATA;
+	}
+
+	return cyaml__save_stream(saver, write_fn, write_ctx,
+			saver->ctx.config, schema, data, seq_count);
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+void cyaml_saver_destroy(
+		cyaml_saver_t *saver)
+{
+	const cyaml_config_t *config;
+
+	if (saver == NULL) {
+		return;
+	}
+
+	config = saver->ctx.config;
+	yaml_emitter_delete(&saver->emitter);
+	cyaml__free(config, saver->ctx.stack);
+	cyaml_index_cache_fini(config, &saver->ctx.index_cache);
+	cyaml__free(config, saver);
+}
+
+/**
+ * CYAML incremental writer.
+ *
+ * The `libyaml` emitter stays open between calls, so a stream can be
+ * written a document, or a root sequence entry, at a time.
+ */
+struct cyaml_writer {
+	cyaml_ctx_t ctx;           /**< Saving context for the writer. */
+	yaml_emitter_t emitter;    /**< The writer's `libyaml` emitter. */
+	cyaml_write_ctx_t output;  /**< Output handler context. */
+	int fd;                    /**< File descriptor for fd writers. */
+	/** Root sequence schema, while writing sequence entries. */
+	const cyaml_schema_value_t *sequence;
+	bool started;              /**< Whether the stream start is emitted. */
+	bool finished;             /**< Whether the stream end is emitted. */
+	cyaml_err_t err;           /**< Sticky error from a failed write. */
+};
+
+/**
+ * Write a value and everything nested in it.
+ *
+ * On failure, the context's state stack is emptied without emitting
+ * any further events.
+ *
+ * \param[in]  ctx        The CYAML saving context, with an empty stack.
+ * \param[in]  schema     CYAML schema for the value.
+ * \param[in]  data       The place to read the value from in the client data.
+ * \param[in]  seq_count  Entry count for sequence values.  Unused for
+ *                        non-sequence values.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__write_value_all(
+		cyaml_ctx_t *ctx,
+		const cyaml_schema_value_t *schema,
+		const uint8_t *data,
+		unsigned seq_count)
+{
+	cyaml_err_t err;
+
+	err = cyaml__write_value(ctx, schema, data, seq_count);
+	while (err == CYAML_OK && ctx->stack_idx > 0) {
+		cyaml__log(ctx->config, CYAML_LOG_DEBUG, "Handle state %s\n",
+				cyaml__state_to_str(ctx->state->state));
+		err = cyaml__write_fn[ctx->state->state](ctx);
+	}
 
-	/* Parse the input */
-	err = cyaml__save(config, schema, data, seq_count, &emitter);
 	if (err != CYAML_OK) {
-		yaml_emitter_delete(&emitter);
-		if ((config != NULL) && (config->mem_fn != NULL)) {
-			cyaml__free(config, buffer_ctx.data);
-		}
-		if (buffer_ctx.err != CYAML_OK) {
-			err = buffer_ctx.err;
+		cyaml__backtrace(ctx);
+		while (ctx->stack_idx > 0) {
+			cyaml__stack_pop(ctx, false);
 		}
+	}
+	return err;
+}
+
+/**
+ * Flush a writer's `libyaml` emitter to its output.
+ *
+ * \param[in]  writer  The writer to flush.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__writer_flush(
+		cyaml_writer_t *writer)
+{
+	if (!yaml_emitter_flush(&writer->emitter)) {
+		cyaml__log(writer->ctx.config, CYAML_LOG_ERROR,
+				"LibYAML: Failed to flush emitter: %s\n",
+				writer->emitter.problem);
+		return CYAML_ERR_LIBYAML_EMITTER;
+	}
+	return CYAML_OK;
+}
+
+/**
+ * Record the result of a writer operation.
+ *
+ * Any failure leaves the emitter in an unknown state, so it is kept and
+ * returned by every later call.  The client write function's error is
+ * returned in preference to the `libyaml` emitter error.
+ *
+ * \param[in]  writer  The writer.
+ * \param[in]  err     Result of the operation.
+ * \return the writer's error state.
+ */
+static cyaml_err_t cyaml__writer_result(
+		cyaml_writer_t *writer,
+		cyaml_err_t err)
+{
+	if (err != CYAML_OK && writer->output.err != CYAML_OK) {
+		err = writer->output.err;
+	}
+	writer->err = err;
+	return err;
+}
+
+/**
+ * Check a writer may be used, and emit the stream start if needed.
+ *
+ * \param[in]  writer  The writer.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__writer_begin(
+		cyaml_writer_t *writer)
+{
+	cyaml_err_t err;
+
+	if (writer->err != CYAML_OK) {
+		return writer->err;
+	}
+	if (writer->finished) {
+		return CYAML_ERR_WRITER_STATE;
+	}
+	if (writer->started) {
+		return CYAML_OK;
+	}
+
+	err = cyaml__stack_push_write_event(&writer->ctx,
+			CYAML_STATE_START, NULL);
+	if (err != CYAML_OK) {
+		return cyaml__writer_result(writer, err);
+	}
+
+	writer->started = true;
+	return CYAML_OK;
+}
+
+/**
+ * Create a writer with its output set.
+ *
+ * \param[in]  config      Client's CYAML configuration structure.
+ * \param[in]  write_fn    Client function to write the output.
+ * \param[in]  write_ctx   Client's private context for write_fn.
+ * \param[out] writer_out  Returns the new writer on success.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__writer_create(
+		const cyaml_config_t *config,
+		cyaml_write_fn_t write_fn,
+		void *write_ctx,
+		cyaml_writer_t **writer_out)
+{
+	cyaml_writer_t *writer;
+
+	if (config == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_CONFIG;
+	}
+	if (config->mem_fn == NULL) {
+		return CYAML_ERR_BAD_CONFIG_NULL_MEMFN;
+	}
+	if (write_fn == NULL || writer_out == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_DATA;
+	}
+
+	writer = cyaml__alloc(config, sizeof(*writer), true);
+	if (writer == NULL) {
+		return CYAML_ERR_OOM;
+	}
+
+	if (!yaml_emitter_initialize(&writer->emitter)) {
+		cyaml__free(config, writer);
+		return CYAML_ERR_LIBYAML_EMITTER_INIT;
+	}
+
+	writer->fd = -1;
+	writer->output.write_fn = write_fn;
+	writer->output.write_ctx = write_ctx;
+	writer->ctx.config = config;
+	writer->ctx.emitter = &writer->emitter;
+
+	yaml_emitter_set_output(&writer->emitter,
+			cyaml__write_handler, &writer->output);
+
+	*writer_out = writer;
+	return CYAML_OK;
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_writer_create(
+		const cyaml_config_t *config,
+		cyaml_write_fn_t write_fn,
+		void *write_ctx,
+		cyaml_writer_t **writer_out)
+{
+	return cyaml__writer_create(config, write_fn, write_ctx, writer_out);
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_writer_create_fd(
+		const cyaml_config_t *config,
+		int fd,
+		cyaml_writer_t **writer_out)
+{
+	cyaml_err_t err;
+
+	err = cyaml__writer_create(config, cyaml__fd_write, NULL, writer_out);
+	if (err != CYAML_OK) {
 		return err;
 	}
 
-	/* Cleanup */
-	yaml_emitter_delete(&emitter);
+	(*writer_out)->fd = fd;
+	(*writer_out)->output.write_ctx = &(*writer_out)->fd;
+	return CYAML_OK;
+}
 
-	*output = buffer_ctx.data;
-	*len = buffer_ctx.used;
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_writer_document(
+		cyaml_writer_t *writer,
+		const cyaml_schema_value_t *schema,
+		const cyaml_data_t *data,
+		unsigned seq_count)
+{
+	cyaml_ctx_t *ctx;
+	cyaml_err_t err;
+
+	if (writer == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_DATA;
+	}
+	if (writer->sequence != NULL) {
+		return CYAML_ERR_WRITER_STATE;
+	}
+
+	ctx = &writer->ctx;
+	err = cyaml__validate_save_params(ctx->config, schema, data, seq_count);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	err = cyaml__writer_begin(writer);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	if (schema->type == CYAML_SEQUENCE_FIXED) {
+		seq_count = schema->sequence.max;
+	}
+	ctx->seq_count = seq_count;
+	ctx->compiled = cyaml_schema_compiled_get(ctx->config, schema);
+
+	err = cyaml__save_presize(ctx);
+	if (err != CYAML_OK) {
+		return cyaml__writer_result(writer, err);
+	}
 
+	err = cyaml__stack_push_write_event(ctx, CYAML_STATE_IN_STREAM, NULL);
+	if (err != CYAML_OK) {
+		return cyaml__writer_result(writer, err);
+	}
+
+	err = cyaml__write_value_all(ctx, schema,
+			(const uint8_t *)&data, seq_count);
+	if (err != CYAML_OK) {
+		return cyaml__writer_result(writer, err);
+	}
+
+	err = cyaml__stack_pop_write_event(ctx, CYAML_STATE_IN_DOC);
+	if (err != CYAML_OK) {
+		return cyaml__writer_result(writer, err);
+	}
+
+	return cyaml__writer_result(writer, cyaml__writer_flush(writer));
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_writer_sequence_start(
+		cyaml_writer_t *writer,
+		const cyaml_schema_value_t *schema)
+{
+	cyaml_ctx_t *ctx;
+	cyaml_err_t err;
+
+	if (writer == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_DATA;
+	}
+	if (schema == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_SCHEMA;
+	}
+	if (schema->type != CYAML_SEQUENCE) {
+		return CYAML_ERR_BAD_TYPE_IN_SCHEMA;
+	}
+	if (schema->sequence.entry->type == CYAML_SEQUENCE) {
+		return CYAML_ERR_SEQUENCE_IN_SEQUENCE;
+	}
+	if (writer->sequence != NULL) {
+		return CYAML_ERR_WRITER_STATE;
+	}
+
+	err = cyaml__writer_begin(writer);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	ctx = &writer->ctx;
+	ctx->compiled = cyaml_schema_compiled_get(ctx->config, schema);
+
+	err = cyaml__save_presize(ctx);
+	if (err != CYAML_OK) {
+		return cyaml__writer_result(writer, err);
+	}
+
+	err = cyaml__stack_push_write_event(ctx, CYAML_STATE_IN_STREAM, NULL);
+	if (err != CYAML_OK) {
+		return cyaml__writer_result(writer, err);
+	}
+
+	err = cyaml__stack_push_write_event(ctx,
+			CYAML_STATE_IN_SEQUENCE, schema);
+	if (err != CYAML_OK) {
+		return cyaml__writer_result(writer, err);
+	}
+
+	writer->sequence = schema;
 	return CYAML_OK;
 }
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_writer_sequence_entry(
+		cyaml_writer_t *writer,
+		const cyaml_data_t *data)
+{
+	const cyaml_schema_value_t *value;
+	unsigned seq_count = 0;
+	cyaml_err_t err;
+
+	if (writer == NULL || data == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_DATA;
+	}
+	if (writer->err != CYAML_OK) {
+		return writer->err;
+	}
+	if (writer->sequence == NULL) {
+		return CYAML_ERR_WRITER_STATE;
+	}
+
+	value = writer->sequence->sequence.entry;
+	if (value->type == CYAML_SEQUENCE_FIXED) {
+		seq_count = value->sequence.max;
+	}
+
+	err = cyaml__write_value_all(&writer->ctx, value, data, seq_count);
+	return cyaml__writer_result(writer, err);
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_writer_sequence_end(
+		cyaml_writer_t *writer)
+{
+	cyaml_err_t err;
+
+	if (writer == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_DATA;
+	}
+	if (writer->err != CYAML_OK) {
+		return writer->err;
+	}
+	if (writer->sequence == NULL) {
+		return CYAML_ERR_WRITER_STATE;
+	}
+
+	writer->sequence = NULL;
+
+	err = cyaml__stack_pop_write_event(&writer->ctx,
+			CYAML_STATE_IN_SEQUENCE);
+	if (err != CYAML_OK) {
+		return cyaml__writer_result(writer, err);
+	}
+
+	err = cyaml__stack_pop_write_event(&writer->ctx, CYAML_STATE_IN_DOC);
+	if (err != CYAML_OK) {
+		return cyaml__writer_result(writer, err);
+	}
+
+	return cyaml__writer_result(writer, cyaml__writer_flush(writer));
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_writer_flush(
+		cyaml_writer_t *writer)
+{
+	if (writer == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_DATA;
+	}
+	if (writer->err != CYAML_OK) {
+		return writer->err;
+	}
+
+	return cyaml__writer_result(writer, cyaml__writer_flush(writer));
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_writer_finish(
+		cyaml_writer_t *writer)
+{
+	cyaml_err_t err;
+
+	if (writer == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_DATA;
+	}
+	if (writer->sequence != NULL) {
+		return CYAML_ERR_WRITER_STATE;
+	}
+
+	err = cyaml__writer_begin(writer);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	err = cyaml__stack_pop_write_event(&writer->ctx,
+			CYAML_STATE_IN_STREAM);
+	if (err != CYAML_OK) {
+		return cyaml__writer_result(writer, err);
+	}
+
+	writer->finished = true;
+	return cyaml__writer_result(writer, cyaml__writer_flush(writer));
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+void cyaml_writer_destroy(
+		cyaml_writer_t *writer)
+{
+	const cyaml_config_t *config;
+
+	if (writer == NULL) {
+		return;
+	}
+
+	config = writer->ctx.config;
+	yaml_emitter_delete(&writer->emitter);
+	cyaml__free(config, writer->ctx.stack);
+	cyaml_index_cache_fini(config, &writer->ctx.index_cache);
+	cyaml__free(config, writer);
+}
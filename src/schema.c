@@ -0,0 +1,573 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (C) 2019 Michael Drake <tlsa@netsurf-browser.org>
+ */
+
+/**
+ * \file
+ * \brief CYAML schema analysis and compiled schemas.
+ *
+ * Compiling walks every value reachable from the top-level schema value.
+ * Mapping fields arrays are only walked the first time they are reached,
+ * so recursive schemas terminate, and shared parts of a schema are only
+ * checked once.
+ */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "schema.h"
+#include "util.h"
+#include "mem.h"
+
+/**
+ * Nesting limit for compiling values without passing through a new mapping.
+ *
+ * Only sequences which contain themselves can reach this.
+ */
+#define CYAML_COMPILE_DEPTH_MAX 1024
+
+/* Exported function, documented in schema.h. */
+bool cyaml_schema_has_pointers(
+		const cyaml_schema_value_t *schema)
+{
+	/* Nested values without \ref CYAML_FLAG_POINTER are stored inline,
+	 * so they can't nest recursively, and this always terminates. */
+	switch (schema->type) {
+	case CYAML_MAPPING:
+		for (const cyaml_schema_field_t *field = schema->mapping.fields;
+				field->key != NULL; field++) {
+			if ((field->value.flags & CYAML_FLAG_POINTER) ||
+			    cyaml_schema_has_pointers(&field->value)) {
+				return true;
+			}
+		}
+		return false;
+	case CYAML_SEQUENCE: /* Fall through. */
+	case CYAML_SEQUENCE_FIXED:
+		return (schema->sequence.entry->flags & CYAML_FLAG_POINTER) ||
+				cyaml_schema_has_pointers(
+						schema->sequence.entry);
+	default:
+		return false;
+	}
+}
+
+/* Exported function, documented in schema.h. */
+bool cyaml_schema_has_strings(
+		const cyaml_schema_value_t *schema)
+{
+	/* Only values stored inline are walked, as for
+	 * \ref cyaml_schema_has_pointers, so this always terminates. */
+	switch (schema->type) {
+	case CYAML_STRING:
+		return true;
+	case CYAML_MAPPING:
+		for (const cyaml_schema_field_t *field = schema->mapping.fields;
+				field->key != NULL; field++) {
+			if (!(field->value.flags & CYAML_FLAG_POINTER) &&
+			    cyaml_schema_has_strings(&field->value)) {
+				return true;
+			}
+		}
+		return false;
+	case CYAML_SEQUENCE: /* Fall through. */
+	case CYAML_SEQUENCE_FIXED:
+		return !(schema->sequence.entry->flags & CYAML_FLAG_POINTER) &&
+				cyaml_schema_has_strings(
+						schema->sequence.entry);
+	default:
+		return false;
+	}
+}
+
+/**
+ * Load state needed for a schema, found by \ref cyaml__schema_needs_walk.
+ */
+typedef struct cyaml_schema_needs_ctx {
+	uint32_t depth;    /**< Deepest nesting of mappings and sequences. */
+	uint32_t words;    /**< Most bitfield scratch words in use at once. */
+	unsigned visits;   /**< Number of schema values visited. */
+} cyaml_schema_needs_ctx_t;
+
+/**
+ * Walk a schema to find the load state needed for its values.
+ *
+ * \param[in]      schema  The schema value to walk.
+ * \param[in]      depth   Nesting of mappings and sequences above schema.
+ * \param[in]      words   Bitfield scratch words in use above schema.
+ * \param[in,out]  needs   Updated with the space needed for schema.
+ */
+static void cyaml__schema_needs_walk(
+		const cyaml_schema_value_t *schema,
+		uint32_t depth,
+		uint32_t words,
+		cyaml_schema_needs_ctx_t *needs)
+{
+	if (depth >= CYAML_SCHEMA_NEEDS_DEPTH_MAX ||
+	    needs->visits >= CYAML_SCHEMA_NEEDS_VISITS_MAX) {
+		return;
+	}
+	needs->visits++;
+
+	switch (schema->type) {
+	case CYAML_MAPPING: {
+		const cyaml_schema_field_t *field = schema->mapping.fields;
+
+		words += cyaml__bitfield_words(cyaml_schema_field_count(field));
+		for (; field->key != NULL; field++) {
+			cyaml__schema_needs_walk(&field->value,
+					depth + 1, words, needs);
+		}
+		break;
+	}
+	case CYAML_SEQUENCE: /* Fall through. */
+	case CYAML_SEQUENCE_FIXED:
+		cyaml__schema_needs_walk(schema->sequence.entry,
+				depth + 1, words, needs);
+		break;
+	default:
+		return;
+	}
+
+	if (needs->depth < depth + 1) {
+		needs->depth = depth + 1;
+	}
+	if (needs->words < words) {
+		needs->words = words;
+	}
+}
+
+/* Exported function, documented in schema.h. */
+void cyaml_schema_needs(
+		const cyaml_schema_value_t *schema,
+		uint32_t *depth_out,
+		uint32_t *words_out)
+{
+	cyaml_schema_needs_ctx_t needs = { 0 };
+
+	cyaml__schema_needs_walk(schema, 0, 0, &needs);
+
+	*depth_out = needs.depth;
+	*words_out = needs.words;
+}
+
+/**
+ * Compare mapping info entries, for sorting and searching.
+ *
+ * \param[in]  a  First mapping info to compare.
+ * \param[in]  b  Second mapping info to compare.
+ * \return negative, zero, or positive, as a sorts before, with, or after b.
+ */
+static int cyaml__mapping_info_cmp(
+		const void *a,
+		const void *b)
+{
+	const cyaml_schema_mapping_info_t *ma = a;
+	const cyaml_schema_mapping_info_t *mb = b;
+
+	if (ma->fields != mb->fields) {
+		return ((uintptr_t)ma->fields < (uintptr_t)mb->fields) ? -1 : 1;
+	}
+
+	return (int)ma->case_sensitive - (int)mb->case_sensitive;
+}
+
+/**
+ * Compare value info entries, for sorting and searching.
+ *
+ * \param[in]  a  First value info to compare.
+ * \param[in]  b  Second value info to compare.
+ * \return negative, zero, or positive, as a sorts before, with, or after b.
+ */
+static int cyaml__value_info_cmp(
+		const void *a,
+		const void *b)
+{
+	const cyaml_schema_value_info_t *va = a;
+	const cyaml_schema_value_info_t *vb = b;
+
+	if (va->value == vb->value) {
+		return 0;
+	}
+
+	return ((uintptr_t)va->value < (uintptr_t)vb->value) ? -1 : 1;
+}
+
+/**
+ * Context for compiling a schema.
+ */
+typedef struct cyaml_compile_ctx {
+	const cyaml_config_t *config;     /**< Client's CYAML config. */
+	cyaml_schema_compiled_t *compiled; /**< Compiled schema being built. */
+	uint32_t mapping_max; /**< Allocated size of the mapping info table. */
+	uint32_t value_max;   /**< Allocated size of the value info table. */
+} cyaml_compile_ctx_t;
+
+/**
+ * Add an entry to a compiled schema table, growing it if necessary.
+ *
+ * \param[in]      config  Client's CYAML configuration structure.
+ * \param[in,out]  table   The table to add to.
+ * \param[in,out]  count   Number of entries in the table.
+ * \param[in,out]  max     Allocated size of the table.
+ * \param[in]      size    Size of a table entry.
+ * \param[in]      entry   The entry to add.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__compile_table_add(
+		const cyaml_config_t *config,
+		void **table,
+		uint32_t *count,
+		uint32_t *max,
+		size_t size,
+		const void *entry)
+{
+	if (*count == *max) {
+		uint32_t new_max = (*max == 0) ? 16 : *max * 2;
+		void *temp = cyaml__realloc(config, *table, 0,
+				size * new_max, false);
+		if (temp == NULL) {
+			return CYAML_ERR_OOM;
+		}
+		*table = temp;
+		*max = new_max;
+	}
+
+	memcpy((uint8_t *)*table + size * (*count)++, entry, size);
+	return CYAML_OK;
+}
+
+/**
+ * Add a mapping to the compiled schema, if it isn't already there.
+ *
+ * \param[in]  ctx             The compile context.
+ * \param[in]  schema          The mapping schema value.
+ * \param[out] walked_out      Returns whether the mapping's fields array
+ *                             was already added, and so has been walked.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__compile_mapping_add(
+		cyaml_compile_ctx_t *ctx,
+		const cyaml_schema_value_t *schema,
+		bool *walked_out)
+{
+	cyaml_schema_compiled_t *compiled = ctx->compiled;
+	cyaml_schema_mapping_info_t info = {
+		.fields = schema->mapping.fields,
+		.case_sensitive = cyaml__is_case_sensitive(ctx->config, schema),
+	};
+	cyaml_err_t err;
+
+	*walked_out = false;
+	for (uint32_t i = 0; i < compiled->mapping_count; i++) {
+		if (compiled->mappings[i].fields == info.fields) {
+			*walked_out = true;
+			if (compiled->mappings[i].case_sensitive ==
+					info.case_sensitive) {
+				return CYAML_OK;
+			}
+		}
+	}
+
+	info.count = cyaml_schema_field_count(info.fields);
+	info.required = cyaml_schema_required_count(info.fields);
+	err = cyaml_index_get(ctx->config, &compiled->cache, info.fields,
+			info.case_sensitive, &info.index);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	return cyaml__compile_table_add(ctx->config,
+			(void **)&compiled->mappings, &compiled->mapping_count,
+			&ctx->mapping_max, sizeof(info), &info);
+}
+
+/**
+ * Check a schema value's own settings are valid.
+ *
+ * \param[in]  schema  The schema value to check.
+ * \param[in]  parent  The schema value containing schema, or NULL.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__compile_check(
+		const cyaml_schema_value_t *schema,
+		const cyaml_schema_value_t *parent)
+{
+	switch (schema->type) {
+	case CYAML_INT:   /* Fall through. */
+	case CYAML_UINT:  /* Fall through. */
+	case CYAML_BOOL:  /* Fall through. */
+	case CYAML_ENUM:  /* Fall through. */
+	case CYAML_FLAGS:
+		if (schema->data_size == 0 ||
+		    schema->data_size > sizeof(uint64_t)) {
+			return CYAML_ERR_INVALID_DATA_SIZE;
+		}
+		break;
+	case CYAML_FLOAT:
+		if (schema->data_size != sizeof(float) &&
+		    schema->data_size != sizeof(double)) {
+			return CYAML_ERR_INVALID_DATA_SIZE;
+		}
+		break;
+	case CYAML_STRING:
+		if (schema->string.min > schema->string.max) {
+			return CYAML_ERR_BAD_MIN_MAX_SCHEMA;
+		}
+		break;
+	case CYAML_SEQUENCE:
+		if (parent != NULL && (parent->type == CYAML_SEQUENCE ||
+				parent->type == CYAML_SEQUENCE_FIXED)) {
+			return CYAML_ERR_SEQUENCE_IN_SEQUENCE;
+		}
+		if (schema->sequence.min > schema->sequence.max) {
+			return CYAML_ERR_BAD_MIN_MAX_SCHEMA;
+		}
+		break;
+	case CYAML_SEQUENCE_FIXED:
+		if (schema->sequence.min != schema->sequence.max) {
+			return CYAML_ERR_SEQUENCE_FIXED_COUNT;
+		}
+		break;
+	case CYAML_MAPPING: /* Fall through. */
+	case CYAML_IGNORE:
+		break;
+	default:
+		return CYAML_ERR_BAD_TYPE_IN_SCHEMA;
+	}
+
+	return CYAML_OK;
+}
+
+/**
+ * Compile a schema value, and the values it contains.
+ *
+ * \param[in]  ctx     The compile context.
+ * \param[in]  schema  The schema value to compile.
+ * \param[in]  parent  The schema value containing schema, or NULL.
+ * \param[in]  depth   Number of values above schema since the last mapping
+ *                     fields array that had not been walked.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__compile_value(
+		cyaml_compile_ctx_t *ctx,
+		const cyaml_schema_value_t *schema,
+		const cyaml_schema_value_t *parent,
+		unsigned depth)
+{
+	cyaml_schema_compiled_t *compiled = ctx->compiled;
+	cyaml_schema_value_info_t info = {
+		.value = schema,
+	};
+	cyaml_err_t err;
+
+	if (depth >= CYAML_COMPILE_DEPTH_MAX) {
+		cyaml__log(ctx->config, CYAML_LOG_ERROR,
+				"Schema: Sequence contains itself\n");
+		return CYAML_ERR_BAD_TYPE_IN_SCHEMA;
+	}
+
+	err = cyaml__compile_check(schema, parent);
+	if (err != CYAML_OK) {
+		cyaml__log(ctx->config, CYAML_LOG_ERROR,
+				"Schema: Bad %s value: %s\n",
+				cyaml__type_to_str(schema->type),
+				cyaml_strerror(err));
+		return err;
+	}
+
+	info.has_pointers = cyaml_schema_has_pointers(schema);
+	info.has_strings = cyaml_schema_has_strings(schema);
+	if (schema->type == CYAML_ENUM || schema->type == CYAML_FLAGS) {
+		err = cyaml_index_strval_get(ctx->config, &compiled->cache,
+				schema, cyaml__is_case_sensitive(
+						ctx->config, schema),
+				&info.strval);
+		if (err != CYAML_OK) {
+			return err;
+		}
+	}
+
+	err = cyaml__compile_table_add(ctx->config,
+			(void **)&compiled->values, &compiled->value_count,
+			&ctx->value_max, sizeof(info), &info);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	switch (schema->type) {
+	case CYAML_MAPPING: {
+		bool walked;
+
+		err = cyaml__compile_mapping_add(ctx, schema, &walked);
+		if (err != CYAML_OK || walked) {
+			return err;
+		}
+		for (const cyaml_schema_field_t *field = schema->mapping.fields;
+				field->key != NULL; field++) {
+			err = cyaml__compile_value(ctx, &field->value,
+					schema, 0);
+			if (err != CYAML_OK) {
+				cyaml__log(ctx->config, CYAML_LOG_ERROR,
+						"Schema: In field: %s\n",
+						field->key);
+				return err;
+			}
+		}
+		break;
+	}
+	case CYAML_SEQUENCE: /* Fall through. */
+	case CYAML_SEQUENCE_FIXED:
+		return cyaml__compile_value(ctx, schema->sequence.entry,
+				schema, depth + 1);
+	default:
+		break;
+	}
+
+	return CYAML_OK;
+}
+
+/**
+ * Sort a compiled schema's value table, and remove repeated values.
+ *
+ * Values can be reached more than once, when sequence entry schemas
+ * are shared.
+ *
+ * \param[in]  compiled  The compiled schema.
+ */
+static void cyaml__compile_values_sort(
+		cyaml_schema_compiled_t *compiled)
+{
+	uint32_t count = 0;
+
+	if (compiled->value_count == 0) {
+		return;
+	}
+
+	qsort(compiled->values, compiled->value_count,
+			sizeof(*compiled->values), cyaml__value_info_cmp);
+
+	for (uint32_t i = 1; i < compiled->value_count; i++) {
+		if (compiled->values[i].value !=
+		    compiled->values[count].value) {
+			compiled->values[++count] = compiled->values[i];
+		}
+	}
+	compiled->value_count = count + 1;
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_schema_compile(
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		cyaml_schema_compiled_t **compiled_out)
+{
+	cyaml_compile_ctx_t ctx = {
+		.config = config,
+	};
+	cyaml_schema_compiled_t *compiled;
+	cyaml_err_t err;
+
+	if (config == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_CONFIG;
+	}
+	if (config->mem_fn == NULL) {
+		return CYAML_ERR_BAD_CONFIG_NULL_MEMFN;
+	}
+	if (schema == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_SCHEMA;
+	}
+	if (compiled_out == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_DATA;
+	}
+	if (!(schema->flags & CYAML_FLAG_POINTER)) {
+		return CYAML_ERR_TOP_LEVEL_NON_PTR;
+	}
+
+	compiled = cyaml__alloc(config, sizeof(*compiled), true);
+	if (compiled == NULL) {
+		return CYAML_ERR_OOM;
+	}
+
+	compiled->schema = schema;
+	compiled->case_insensitive =
+			!!(config->flags & CYAML_CFG_CASE_INSENSITIVE);
+	ctx.compiled = compiled;
+
+	err = cyaml__compile_value(&ctx, schema, NULL, 0);
+	if (err != CYAML_OK) {
+		cyaml_schema_compiled_free(config, compiled);
+		return err;
+	}
+
+	cyaml__compile_values_sort(compiled);
+	if (compiled->mapping_count > 0) {
+		qsort(compiled->mappings, compiled->mapping_count,
+				sizeof(*compiled->mappings),
+				cyaml__mapping_info_cmp);
+	}
+	cyaml_schema_needs(schema, &compiled->depth, &compiled->words);
+
+	cyaml__log(config, CYAML_LOG_DEBUG,
+			"Compiled schema: %"PRIu32" mappings, "
+			"%"PRIu32" values\n",
+			compiled->mapping_count, compiled->value_count);
+
+	*compiled_out = compiled;
+	return CYAML_OK;
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+void cyaml_schema_compiled_free(
+		const cyaml_config_t *config,
+		cyaml_schema_compiled_t *compiled)
+{
+	if (config == NULL || config->mem_fn == NULL || compiled == NULL) {
+		return;
+	}
+
+	cyaml_index_cache_fini(config, &compiled->cache);
+	cyaml__free(config, compiled->mappings);
+	cyaml__free(config, compiled->values);
+	cyaml__free(config, compiled);
+}
+
+/* Exported function, documented in schema.h. */
+const cyaml_schema_mapping_info_t * cyaml_schema_compiled_mapping(
+		const cyaml_schema_compiled_t *compiled,
+		const cyaml_schema_field_t *fields,
+		bool case_sensitive)
+{
+	const cyaml_schema_mapping_info_t key = {
+		.fields = fields,
+		.case_sensitive = case_sensitive,
+	};
+
+	if (compiled->mapping_count == 0) {
+		return NULL;
+	}
+
+	return bsearch(&key, compiled->mappings, compiled->mapping_count,
+			sizeof(*compiled->mappings), cyaml__mapping_info_cmp);
+}
+
+/* Exported function, documented in schema.h. */
+const cyaml_schema_value_info_t * cyaml_schema_compiled_value(
+		const cyaml_schema_compiled_t *compiled,
+		const cyaml_schema_value_t *value)
+{
+	const cyaml_schema_value_info_t key = {
+		.value = value,
+	};
+
+	if (compiled->value_count == 0) {
+		return NULL;
+	}
+
+	return bsearch(&key, compiled->values, compiled->value_count,
+			sizeof(*compiled->values), cyaml__value_info_cmp);
+}
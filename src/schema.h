@@ -0,0 +1,302 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (C) 2019 Michael Drake <tlsa@netsurf-browser.org>
+ */
+
+/**
+ * \file
+ * \brief CYAML schema analysis and compiled schemas.
+ *
+ * Loading, saving and freeing need some data about schemas which is not
+ * in the schema structures themselves, such as the number of fields in a
+ * mapping, or whether a value owns any allocations.  Without a compiled
+ * schema, this is worked out as it is needed.
+ *
+ * A compiled schema has this data for every value reachable from its
+ * top-level schema value, in tables sorted by schema pointer.
+ */
+
+#ifndef CYAML_SCHEMA_H
+#define CYAML_SCHEMA_H
+
+#include <stdbool.h>
+
+#include "cyaml/cyaml.h"
+#include "index.h"
+
+/**
+ * Deepest nesting of schema values considered by \ref cyaml_schema_needs.
+ *
+ * Recursive schemas can nest without limit.  Documents which nest deeper
+ * than this still load; the state stack is simply grown as needed.
+ */
+#define CYAML_SCHEMA_NEEDS_DEPTH_MAX 64
+
+/** Limit on the schema values visited by \ref cyaml_schema_needs. */
+#define CYAML_SCHEMA_NEEDS_VISITS_MAX 1024
+
+/** Precomputed data for a mapping schema's fields array. */
+typedef struct cyaml_schema_mapping_info {
+	/** The mapping schema fields array. */
+	const cyaml_schema_field_t *fields;
+	/** Key lookup index, or NULL for small mappings. */
+	const cyaml_index_t *index;
+	/** Whether the index matches keys with case sensitivity. */
+	bool case_sensitive;
+	/** Number of entries in the fields array. */
+	uint16_t count;
+	/** Number of fields without \ref CYAML_FLAG_OPTIONAL. */
+	uint16_t required;
+} cyaml_schema_mapping_info_t;
+
+/** Precomputed data for a schema value. */
+typedef struct cyaml_schema_value_info {
+	/** The schema value. */
+	const cyaml_schema_value_t *value;
+	/** String value index for enums and flags, or NULL. */
+	const cyaml_strval_index_t *strval;
+	/** Whether the value's own data contains pointers. */
+	bool has_pointers;
+	/** Whether the value's own data contains strings. */
+	bool has_strings;
+} cyaml_schema_value_info_t;
+
+/**
+ * A compiled schema.
+ *
+ * Everything is allocated when the schema is compiled, and nothing is
+ * changed afterwards.
+ */
+struct cyaml_schema_compiled {
+	/** The compiled top-level schema value. */
+	const cyaml_schema_value_t *schema;
+	/** The \ref CYAML_CFG_CASE_INSENSITIVE setting compiled for. */
+	bool case_insensitive;
+	/** Deepest mapping and sequence nesting, for sizing load state. */
+	uint32_t depth;
+	/** Most bitfield scratch words in use at once, when loading. */
+	uint32_t words;
+	/** The indexes referenced by the info tables. */
+	cyaml_index_cache_t cache;
+	/** Mapping info, sorted by fields array, then case sensitivity. */
+	cyaml_schema_mapping_info_t *mappings;
+	uint32_t mapping_count; /**< Number of entries in mappings. */
+	/** Value info, sorted by schema value. */
+	cyaml_schema_value_info_t *values;
+	uint32_t value_count;   /**< Number of entries in values. */
+};
+
+/**
+ * Get the number of entries in a mapping schema fields array.
+ *
+ * \param[in]  fields  Mapping schema fields array, terminated by an entry
+ *                     with a NULL key.
+ * \return Number of entries in fields array.
+ */
+static inline uint16_t cyaml_schema_field_count(
+		const cyaml_schema_field_t *fields)
+{
+	const cyaml_schema_field_t *entry = fields;
+
+	while (entry->key != NULL) {
+		entry++;
+	}
+
+	return entry - fields;
+}
+
+/**
+ * Get the number of required fields in a mapping schema fields array.
+ *
+ * \param[in]  fields  Mapping schema fields array, terminated by an entry
+ *                     with a NULL key.
+ * \return Number of entries without the \ref CYAML_FLAG_OPTIONAL flag.
+ */
+static inline uint16_t cyaml_schema_required_count(
+		const cyaml_schema_field_t *fields)
+{
+	uint16_t required = 0;
+
+	for (; fields->key != NULL; fields++) {
+		if (!(fields->value.flags & CYAML_FLAG_OPTIONAL)) {
+			required++;
+		}
+	}
+
+	return required;
+}
+
+/**
+ * Check whether a value's own data contains pointers to allocations.
+ *
+ * This doesn't consider whether the value itself is a pointer.
+ *
+ * \param[in]  schema  The schema for the value.
+ * \return true if the value's data contains pointers, false otherwise.
+ */
+bool cyaml_schema_has_pointers(
+		const cyaml_schema_value_t *schema);
+
+/**
+ * Check whether a value's own data contains strings.
+ *
+ * A string's buffer may hold anything after the terminating NUL, so data
+ * containing strings can't be compared byte for byte.  Strings which are
+ * pointed to are not counted, since the pointers to them are.
+ *
+ * \param[in]  schema  The schema for the value.
+ * \return true if the value's data contains strings, false otherwise.
+ */
+bool cyaml_schema_has_strings(
+		const cyaml_schema_value_t *schema);
+
+/**
+ * Find the load state needed for the values of a schema.
+ *
+ * Recursive schemas, and schemas which reuse values widely, would make
+ * a full walk unbounded, or very slow.  So this gives up beyond
+ * \ref CYAML_SCHEMA_NEEDS_DEPTH_MAX and \ref CYAML_SCHEMA_NEEDS_VISITS_MAX,
+ * and its results are only lower bounds.
+ *
+ * \param[in]  schema     The schema to walk.
+ * \param[out] depth_out  Returns the deepest nesting of mappings and
+ *                        sequences.
+ * \param[out] words_out  Returns the most bitfield scratch words in
+ *                        use at once.
+ */
+void cyaml_schema_needs(
+		const cyaml_schema_value_t *schema,
+		uint32_t *depth_out,
+		uint32_t *words_out);
+
+/**
+ * Get the compiled schema to use for a schema.
+ *
+ * \param[in]  config  The client's CYAML library config.
+ * \param[in]  schema  The top-level schema being used.
+ * \return the config's compiled schema if it applies, or NULL.
+ */
+static inline const cyaml_schema_compiled_t * cyaml_schema_compiled_get(
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema)
+{
+	const cyaml_schema_compiled_t *compiled = config->compiled;
+
+	if (compiled == NULL || compiled->schema != schema ||
+	    compiled->case_insensitive !=
+			!!(config->flags & CYAML_CFG_CASE_INSENSITIVE)) {
+		return NULL;
+	}
+
+	return compiled;
+}
+
+/**
+ * Find a compiled schema's info for a mapping schema fields array.
+ *
+ * \param[in]  compiled        The compiled schema.
+ * \param[in]  fields          The mapping schema fields array.
+ * \param[in]  case_sensitive  Whether key matching is case sensitive.
+ * \return the mapping's info, or NULL if it isn't part of the schema.
+ */
+const cyaml_schema_mapping_info_t * cyaml_schema_compiled_mapping(
+		const cyaml_schema_compiled_t *compiled,
+		const cyaml_schema_field_t *fields,
+		bool case_sensitive);
+
+/**
+ * Find a compiled schema's info for a schema value.
+ *
+ * \param[in]  compiled  The compiled schema.
+ * \param[in]  value     The schema value.
+ * \return the value's info, or NULL if it isn't part of the schema.
+ */
+const cyaml_schema_value_info_t * cyaml_schema_compiled_value(
+		const cyaml_schema_compiled_t *compiled,
+		const cyaml_schema_value_t *value);
+
+/**
+ * Check whether a value's own data contains pointers to allocations.
+ *
+ * This is looked up in the compiled schema, if there is one, and found by
+ * walking the schema otherwise.
+ *
+ * \param[in]  compiled  The compiled schema, or NULL.
+ * \param[in]  schema    The schema for the value.
+ * \return true if the value's data contains pointers, false otherwise.
+ */
+static inline bool cyaml_schema_contents_have_pointers(
+		const cyaml_schema_compiled_t *compiled,
+		const cyaml_schema_value_t *schema)
+{
+	if (compiled != NULL) {
+		const cyaml_schema_value_info_t *info =
+				cyaml_schema_compiled_value(compiled, schema);
+		if (info != NULL) {
+			return info->has_pointers;
+		}
+	}
+
+	return cyaml_schema_has_pointers(schema);
+}
+
+/**
+ * Check whether a value's own data can be compared byte for byte.
+ *
+ * This is the case when it contains neither pointers nor strings.  It is
+ * looked up in the compiled schema, if there is one, and found by walking
+ * the schema otherwise.
+ *
+ * \param[in]  compiled  The compiled schema, or NULL.
+ * \param[in]  schema    The schema for the value.
+ * \return true if the value's data can be compared with memcmp,
+ *         false otherwise.
+ */
+static inline bool cyaml_schema_contents_are_bytes(
+		const cyaml_schema_compiled_t *compiled,
+		const cyaml_schema_value_t *schema)
+{
+	if (compiled != NULL) {
+		const cyaml_schema_value_info_t *info =
+				cyaml_schema_compiled_value(compiled, schema);
+		if (info != NULL) {
+			return !info->has_pointers && !info->has_strings;
+		}
+	}
+
+	return !cyaml_schema_has_pointers(schema) &&
+	       !cyaml_schema_has_strings(schema);
+}
+
+/**
+ * Check whether a sequence's entries can be loaded and saved in bulk.
+ *
+ * This is the case for numbers that are stored in place, in C types of one,
+ * two, four or eight bytes.  Loading and saving both use this, so that any
+ * sequence that is loaded in bulk is also saved in bulk.
+ *
+ * \param[in]  entry  The schema for the sequence's entries.
+ * \return true if the entries can be handled in bulk, false otherwise.
+ */
+static inline bool cyaml_schema_entry_is_bulk(
+		const cyaml_schema_value_t *entry)
+{
+	if (entry->flags & CYAML_FLAG_POINTER) {
+		return false;
+	}
+
+	switch (entry->type) {
+	case CYAML_INT: /* Fall through. */
+	case CYAML_UINT:
+		return entry->data_size == 1 || entry->data_size == 2 ||
+		       entry->data_size == 4 || entry->data_size == 8;
+	case CYAML_FLOAT:
+		return entry->data_size == sizeof(float) ||
+		       entry->data_size == sizeof(double);
+	default:
+		return false;
+	}
+}
+
+#endif
@@ -0,0 +1,1062 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (C) 2019 Michael Drake <tlsa@netsurf-browser.org>
+ */
+
+/**
+ * \file
+ * \brief Binary snapshots of loaded data.
+ *
+ * A snapshot is an image of every allocation in a loaded document, laid
+ * out one after another.  Pointers in the image are stored as offsets to
+ * the start of the allocation they point to, and a relocation table lists
+ * where they are.
+ *
+ * File layout:
+ *
+ *     [header][image][allocation offsets][relocation offsets]
+ *
+ * Snapshots use the host's data layout, so they are only valid on the
+ * platform that wrote them.  They are keyed by a fingerprint of the schema
+ * and by a client-supplied source key, and they are ignored if either
+ * doesn't match.
+ *
+ * Loading with \ref CYAML_CFG_ARENA set reads the image into the root
+ * allocation of a new arena, and fixes up its pointers in place.  Otherwise
+ * each allocation is copied out of the image into its own allocation, so
+ * that the data can be freed as normal.
+ *
+ * Saving walks the data with an explicit queue, rather than recursing:
+ * each allocation is appended to the image once, and its contents are
+ * walked after the allocations before it.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <sys/stat.h>
+
+#include "data.h"
+#include "util.h"
+#include "mem.h"
+#include "arena.h"
+#include "schema.h"
+
+/** Identifies a CYAML snapshot file. */
+#define CYAML_SNAPSHOT_MAGIC "CYAMLSNP"
+
+/** Version of the snapshot file format. */
+#define CYAML_SNAPSHOT_VERSION 1
+
+/** Written in the header, to detect snapshots with other byte orders. */
+#define CYAML_SNAPSHOT_ENDIAN 0x0102
+
+/** Alignment of allocations in a snapshot image. */
+#define CYAML_SNAPSHOT_ALIGN (_Alignof(max_align_t))
+
+/** Starting value of \ref cyaml__snapshot_hash hashes. */
+#define CYAML_SNAPSHOT_HASH_INIT 0xcbf29ce484222325u
+
+/** Header at the start of a snapshot file. */
+typedef struct cyaml_snapshot_header {
+	char magic[8];          /**< \ref CYAML_SNAPSHOT_MAGIC. */
+	uint32_t version;       /**< \ref CYAML_SNAPSHOT_VERSION. */
+	uint16_t endian;        /**< \ref CYAML_SNAPSHOT_ENDIAN. */
+	uint8_t pointer_size;   /**< Size of pointers in the image. */
+	uint8_t align;          /**< \ref CYAML_SNAPSHOT_ALIGN. */
+	uint64_t schema_hash;   /**< Fingerprint of the top-level schema. */
+	uint64_t source;        /**< Client's key for the source data. */
+	uint64_t image_size;    /**< Number of bytes in the image. */
+	uint64_t alloc_count;   /**< Number of allocations in the image. */
+	uint64_t reloc_count;   /**< Number of pointers in the image. */
+	uint64_t check;         /**< Hash of image and tables. */
+	uint64_t seq_count;     /**< Top-level sequence entry count. */
+} cyaml_snapshot_header_t;
+
+/** An allocation queued for its contents to be written. */
+typedef struct cyaml_snapshot_alloc {
+	const cyaml_schema_value_t *schema; /**< Schema for the allocation. */
+	const uint8_t *data; /**< The client's data for the allocation. */
+	uint64_t offset;     /**< Offset of the allocation in the image. */
+	unsigned count;      /**< Entry count, for sequences. */
+} cyaml_snapshot_alloc_t;
+
+/** Internal context for writing a snapshot. */
+typedef struct cyaml_snapshot_ctx {
+	const cyaml_config_t *config; /**< Settings provided by client. */
+	/** Compiled schema for the data being written, or NULL. */
+	const cyaml_schema_compiled_t *compiled;
+	uint8_t *image;        /**< The image being built. */
+	size_t image_size;     /**< Used bytes in image. */
+	size_t image_max;      /**< Allocated bytes in image. */
+	/** Allocations in the image, in image order. */
+	cyaml_snapshot_alloc_t *allocs;
+	size_t alloc_count;    /**< Used entries in allocs. */
+	size_t alloc_max;      /**< Allocated entries in allocs. */
+	uint64_t *relocs;      /**< Image offsets of pointers. */
+	size_t reloc_count;    /**< Used entries in relocs. */
+	size_t reloc_max;      /**< Allocated entries in relocs. */
+} cyaml_snapshot_ctx_t;
+
+/** Ancestor of a mapping, for fingerprinting recursive schemas. */
+typedef struct cyaml_snapshot_ancestor {
+	const cyaml_schema_field_t *fields; /**< The mapping's fields. */
+	const struct cyaml_snapshot_ancestor *parent; /**< Next ancestor. */
+} cyaml_snapshot_ancestor_t;
+
+/**
+ * Add bytes to a hash.
+ *
+ * This is FNV-1a, but taking a word at a time, since it hashes whole
+ * images.  It detects damage to snapshots; it isn't meant to be robust
+ * against deliberate tampering.
+ *
+ * \param[in]  hash  The hash so far.
+ * \param[in]  data  The bytes to add.
+ * \param[in]  len   Number of bytes to add.
+ * \return the updated hash.
+ */
+static uint64_t cyaml__snapshot_hash(
+		uint64_t hash,
+		const void *data,
+		size_t len)
+{
+	const uint64_t prime = 0x100000001b3u;
+	const uint8_t *bytes = data;
+
+	for (; len >= sizeof(uint64_t); len -= sizeof(uint64_t)) {
+		uint64_t word;
+		memcpy(&word, bytes, sizeof(word));
+		hash = (hash ^ word) * prime;
+		bytes += sizeof(word);
+	}
+	for (; len > 0; len--) {
+		hash = (hash ^ *bytes++) * prime;
+	}
+
+	return hash;
+}
+
+/**
+ * Add a number to a hash.
+ *
+ * \param[in]  hash   The hash so far.
+ * \param[in]  value  The number to add.
+ * \return the updated hash.
+ */
+static inline uint64_t cyaml__snapshot_hash_u64(
+		uint64_t hash,
+		uint64_t value)
+{
+	return cyaml__snapshot_hash(hash, &value, sizeof(value));
+}
+
+/**
+ * Add a string, including its terminator, to a hash.
+ *
+ * \param[in]  hash  The hash so far.
+ * \param[in]  str   The string to add.
+ * \return the updated hash.
+ */
+static inline uint64_t cyaml__snapshot_hash_str(
+		uint64_t hash,
+		const char *str)
+{
+	return cyaml__snapshot_hash(hash, str, strlen(str) + 1);
+}
+
+/**
+ * Fingerprint a schema value.
+ *
+ * Everything that affects how values of the schema are loaded, or where
+ * they are stored, is included.  Mappings which contain themselves are
+ * fingerprinted as a reference back to the enclosing mapping.
+ *
+ * \param[in]  hash    The hash so far.
+ * \param[in]  schema  The schema value to fingerprint.
+ * \param[in]  parent  The innermost enclosing mapping, or NULL.
+ * \return the updated hash.
+ */
+static uint64_t cyaml__snapshot_schema_hash(
+		uint64_t hash,
+		const cyaml_schema_value_t *schema,
+		const cyaml_snapshot_ancestor_t *parent)
+{
+	hash = cyaml__snapshot_hash_u64(hash, schema->type);
+	hash = cyaml__snapshot_hash_u64(hash, schema->flags);
+	hash = cyaml__snapshot_hash_u64(hash, schema->data_size);
+
+	switch (schema->type) {
+	case CYAML_STRING:
+		hash = cyaml__snapshot_hash_u64(hash, schema->string.min);
+		hash = cyaml__snapshot_hash_u64(hash, schema->string.max);
+		break;
+	case CYAML_ENUM: /* Fall through. */
+	case CYAML_FLAGS:
+		hash = cyaml__snapshot_hash_u64(hash,
+				schema->enumeration.count);
+		for (uint32_t i = 0; i < schema->enumeration.count; i++) {
+			const cyaml_strval_t *strval =
+					&schema->enumeration.strings[i];
+			hash = cyaml__snapshot_hash_str(hash, strval->str);
+			hash = cyaml__snapshot_hash_u64(hash,
+					(uint64_t)strval->val);
+		}
+		break;
+	case CYAML_MAPPING: {
+		const cyaml_schema_field_t *field = schema->mapping.fields;
+		const cyaml_snapshot_ancestor_t self = {
+			.fields = field,
+			.parent = parent,
+		};
+		uint64_t depth = 0;
+
+		for (; parent != NULL; parent = parent->parent, depth++) {
+			if (parent->fields == field) {
+				hash = cyaml__snapshot_hash_u64(hash,
+						UINT64_MAX);
+				return cyaml__snapshot_hash_u64(hash, depth);
+			}
+		}
+
+		for (; field->key != NULL; field++) {
+			hash = cyaml__snapshot_hash_str(hash, field->key);
+			hash = cyaml__snapshot_hash_u64(hash,
+					field->data_offset);
+			hash = cyaml__snapshot_hash_u64(hash,
+					field->count_offset);
+			hash = cyaml__snapshot_hash_u64(hash,
+					field->count_size);
+			hash = cyaml__snapshot_schema_hash(hash,
+					&field->value, &self);
+		}
+		hash = cyaml__snapshot_hash_u64(hash, 0);
+		break;
+	}
+	case CYAML_SEQUENCE: /* Fall through. */
+	case CYAML_SEQUENCE_FIXED:
+		hash = cyaml__snapshot_hash_u64(hash, schema->sequence.min);
+		hash = cyaml__snapshot_hash_u64(hash, schema->sequence.max);
+		hash = cyaml__snapshot_schema_hash(hash,
+				schema->sequence.entry, parent);
+		break;
+	default:
+		break;
+	}
+
+	return hash;
+}
+
+/**
+ * Get the size of a sequence entry's data.
+ *
+ * \param[in]  entry  The schema for the sequence entries.
+ * \return size of each entry in the sequence's allocation.
+ */
+static inline uint64_t cyaml__snapshot_entry_size(
+		const cyaml_schema_value_t *entry)
+{
+	if (entry->flags & CYAML_FLAG_POINTER) {
+		return sizeof(void *);
+	}
+
+	return entry->data_size;
+}
+
+/**
+ * Check whether a value's own data contains pointers to allocations.
+ *
+ * \param[in]  ctx     The snapshot context.
+ * \param[in]  schema  The schema for the value.
+ * \return true if the value's data contains pointers, false otherwise.
+ */
+static inline bool cyaml__snapshot_has_pointers(
+		const cyaml_snapshot_ctx_t *ctx,
+		const cyaml_schema_value_t *schema)
+{
+	return cyaml_schema_contents_have_pointers(ctx->compiled, schema);
+}
+
+/**
+ * Ensure a table has room for one more entry.
+ *
+ * \param[in]      config  The client's CYAML library config.
+ * \param[in,out]  table   The table to grow.
+ * \param[in]      count   Number of entries in use.
+ * \param[in,out]  max     Number of entries allocated.
+ * \param[in]      size    Size of each entry.
+ * \param[in]      need    Number of entries needed beyond those in use.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__snapshot_grow(
+		const cyaml_config_t *config,
+		void **table,
+		size_t count,
+		size_t *max,
+		size_t size,
+		size_t need)
+{
+	size_t new_max = (*max == 0) ? 64 : *max;
+	void *temp;
+
+	if (need <= *max - count) {
+		return CYAML_OK;
+	}
+
+	while (new_max - count < need) {
+		if (new_max > SIZE_MAX / 2 / size) {
+			return CYAML_ERR_OOM;
+		}
+		new_max *= 2;
+	}
+
+	temp = cyaml__realloc(config, *table, 0, size * new_max, false);
+	if (temp == NULL) {
+		return CYAML_ERR_OOM;
+	}
+
+	*table = temp;
+	*max = new_max;
+	return CYAML_OK;
+}
+
+/**
+ * Append a copy of an allocation to the image.
+ *
+ * The allocation is queued, so that its contents are written later.
+ *
+ * \param[in]  ctx         The snapshot context.
+ * \param[in]  schema      The schema for the allocation.
+ * \param[in]  data        The client's allocation.
+ * \param[in]  count       Entry count, for sequences.
+ * \param[out] offset_out  Returns the allocation's offset in the image.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__snapshot_append(
+		cyaml_snapshot_ctx_t *ctx,
+		const cyaml_schema_value_t *schema,
+		const uint8_t *data,
+		unsigned count,
+		uint64_t *offset_out)
+{
+	uint64_t size;
+	size_t space;
+	cyaml_err_t err;
+
+	switch (schema->type) {
+	case CYAML_STRING:
+		size = strlen((const char *)data) + 1;
+		break;
+	case CYAML_SEQUENCE_FIXED:
+		count = schema->sequence.max;
+		/* Fall through. */
+	case CYAML_SEQUENCE:
+		size = cyaml__snapshot_entry_size(schema->sequence.entry) *
+				count;
+		break;
+	default:
+		size = schema->data_size;
+		break;
+	}
+
+	if (size > SIZE_MAX - CYAML_SNAPSHOT_ALIGN) {
+		return CYAML_ERR_OOM;
+	}
+	/* Every allocation gets space, so offsets are unique. */
+	space = (size == 0) ? 1 : size;
+	space = (space + CYAML_SNAPSHOT_ALIGN - 1) &
+			~(CYAML_SNAPSHOT_ALIGN - 1);
+
+	err = cyaml__snapshot_grow(ctx->config, (void **)&ctx->image,
+			ctx->image_size, &ctx->image_max, 1, space);
+	if (err != CYAML_OK) {
+		return err;
+	}
+	err = cyaml__snapshot_grow(ctx->config, (void **)&ctx->allocs,
+			ctx->alloc_count, &ctx->alloc_max,
+			sizeof(*ctx->allocs), 1);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	memcpy(ctx->image + ctx->image_size, data, size);
+	memset(ctx->image + ctx->image_size + size, 0, space - size);
+
+	ctx->allocs[ctx->alloc_count++] = (cyaml_snapshot_alloc_t) {
+		.schema = schema,
+		.data = data,
+		.offset = ctx->image_size,
+		.count = count,
+	};
+
+	*offset_out = ctx->image_size;
+	ctx->image_size += space;
+	return CYAML_OK;
+}
+
+/**
+ * Write a value into the image.
+ *
+ * The value's own data has already been copied into the image; this
+ * replaces any pointers in it with image offsets.
+ *
+ * \param[in]  ctx     The snapshot context.
+ * \param[in]  schema  The schema for the value.
+ * \param[in]  data    The client's data for the value.
+ * \param[in]  offset  Offset of the value in the image.
+ * \param[in]  count   Entry count, for sequences.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__snapshot_write_value(
+		cyaml_snapshot_ctx_t *ctx,
+		const cyaml_schema_value_t *schema,
+		const uint8_t *data,
+		uint64_t offset,
+		unsigned count);
+
+/**
+ * Write the contents of a value into the image.
+ *
+ * \param[in]  ctx     The snapshot context.
+ * \param[in]  schema  The schema for the value.
+ * \param[in]  data    The client's data for the value's contents.
+ * \param[in]  offset  Offset of the value's contents in the image.
+ * \param[in]  count   Entry count, for sequences.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__snapshot_write_contents(
+		cyaml_snapshot_ctx_t *ctx,
+		const cyaml_schema_value_t *schema,
+		const uint8_t *data,
+		uint64_t offset,
+		unsigned count)
+{
+	cyaml_err_t err = CYAML_OK;
+
+	switch (schema->type) {
+	case CYAML_MAPPING: {
+		const cyaml_schema_field_t *field = schema->mapping.fields;
+
+		for (; field->key != NULL && err == CYAML_OK; field++) {
+			unsigned entries = 0;
+
+			if (field->value.type == CYAML_SEQUENCE) {
+				entries = cyaml_data_read(field->count_size,
+						data + field->count_offset,
+						&err);
+				if (err != CYAML_OK) {
+					break;
+				}
+			}
+			err = cyaml__snapshot_write_value(ctx, &field->value,
+					data + field->data_offset,
+					offset + field->data_offset, entries);
+		}
+		break;
+	}
+	case CYAML_SEQUENCE_FIXED:
+		count = schema->sequence.max;
+		/* Fall through. */
+	case CYAML_SEQUENCE: {
+		const cyaml_schema_value_t *entry = schema->sequence.entry;
+		uint64_t size = cyaml__snapshot_entry_size(entry);
+
+		for (unsigned i = 0; i < count && err == CYAML_OK; i++) {
+			err = cyaml__snapshot_write_value(ctx, entry,
+					data + size * i, offset + size * i, 0);
+		}
+		break;
+	}
+	default:
+		break;
+	}
+
+	return err;
+}
+
+/* This function is documented at the forward declaration above. */
+static cyaml_err_t cyaml__snapshot_write_value(
+		cyaml_snapshot_ctx_t *ctx,
+		const cyaml_schema_value_t *schema,
+		const uint8_t *data,
+		uint64_t offset,
+		unsigned count)
+{
+	if (schema->flags & CYAML_FLAG_POINTER) {
+		const uint8_t *ptr = cyaml_data_read_pointer(data);
+		uint64_t target = 0;
+		uintptr_t slot;
+		cyaml_err_t err;
+
+		if (ptr != NULL) {
+			err = cyaml__snapshot_append(ctx, schema, ptr,
+					count, &target);
+			if (err != CYAML_OK) {
+				return err;
+			}
+			err = cyaml__snapshot_grow(ctx->config,
+					(void **)&ctx->relocs,
+					ctx->reloc_count, &ctx->reloc_max,
+					sizeof(*ctx->relocs), 1);
+			if (err != CYAML_OK) {
+				return err;
+			}
+			ctx->relocs[ctx->reloc_count++] = offset;
+		}
+
+		/* The contents are written when the queue reaches them. */
+		slot = (uintptr_t)target;
+		memcpy(ctx->image + offset, &slot, sizeof(slot));
+		return CYAML_OK;
+	}
+
+	if (!cyaml__snapshot_has_pointers(ctx, schema)) {
+		return CYAML_OK;
+	}
+
+	return cyaml__snapshot_write_contents(ctx, schema, data, offset, count);
+}
+
+/**
+ * Write a snapshot file.
+ *
+ * \param[in]  ctx     The snapshot context, with the image built.
+ * \param[in]  header  The snapshot header.
+ * \param[in]  path    Path to write the snapshot to.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__snapshot_write_file(
+		cyaml_snapshot_ctx_t *ctx,
+		const cyaml_snapshot_header_t *header,
+		const char *path)
+{
+	uint64_t *offsets;
+	FILE *file;
+	bool ok;
+
+	/* The queue is done with, so keep just the offsets. */
+	offsets = (uint64_t *)ctx->allocs;
+	for (size_t i = 0; i < ctx->alloc_count; i++) {
+		offsets[i] = ctx->allocs[i].offset;
+	}
+
+	file = fopen(path, "wb");
+	if (file == NULL) {
+		return CYAML_ERR_FILE_OPEN;
+	}
+
+	ok = fwrite(header, sizeof(*header), 1, file) == 1 &&
+	     fwrite(ctx->image, 1, ctx->image_size, file) == ctx->image_size &&
+	     fwrite(offsets, sizeof(*offsets), ctx->alloc_count, file) ==
+			ctx->alloc_count &&
+	     fwrite(ctx->relocs, sizeof(*ctx->relocs), ctx->reloc_count,
+			file) == ctx->reloc_count;
+
+	if (fclose(file) != 0 || !ok) {
+		return CYAML_ERR_FILE_WRITE;
+	}
+
+	return CYAML_OK;
+}
+
+/**
+ * Fill in a snapshot header's fields which identify snapshot compatibility.
+ *
+ * \param[out] header  The header to fill in.
+ * \param[in]  schema  The top-level schema.
+ * \param[in]  source  Client's key for the source data.
+ */
+static void cyaml__snapshot_header_init(
+		cyaml_snapshot_header_t *header,
+		const cyaml_schema_value_t *schema,
+		uint64_t source)
+{
+	memset(header, 0, sizeof(*header));
+	memcpy(header->magic, CYAML_SNAPSHOT_MAGIC, sizeof(header->magic));
+	header->version = CYAML_SNAPSHOT_VERSION;
+	header->endian = CYAML_SNAPSHOT_ENDIAN;
+	header->pointer_size = sizeof(void *);
+	header->align = CYAML_SNAPSHOT_ALIGN;
+	header->schema_hash = cyaml__snapshot_schema_hash(
+			CYAML_SNAPSHOT_HASH_INIT, schema, NULL);
+	header->source = source;
+}
+
+/**
+ * Hash a snapshot's image and tables.
+ *
+ * \param[in]  image      The image.
+ * \param[in]  size       Size of the image in bytes.
+ * \param[in]  tables     The allocation offsets and relocation offsets.
+ * \param[in]  count      Number of entries in tables.
+ * \return the hash.
+ */
+static uint64_t cyaml__snapshot_check(
+		const uint8_t *image,
+		size_t size,
+		const uint64_t *tables,
+		size_t count)
+{
+	uint64_t hash = CYAML_SNAPSHOT_HASH_INIT;
+
+	hash = cyaml__snapshot_hash(hash, image, size);
+	return cyaml__snapshot_hash(hash, tables, count * sizeof(*tables));
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_snapshot_save(
+		const char *path,
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		const cyaml_data_t *data,
+		unsigned seq_count,
+		uint64_t source)
+{
+	cyaml_snapshot_ctx_t ctx = {
+		.config = config,
+	};
+	cyaml_snapshot_header_t header;
+	cyaml_err_t err = CYAML_OK;
+
+	if (config == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_CONFIG;
+	}
+	if (config->mem_fn == NULL) {
+		return CYAML_ERR_BAD_CONFIG_NULL_MEMFN;
+	}
+	if (schema == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_SCHEMA;
+	}
+	if (!(schema->flags & CYAML_FLAG_POINTER)) {
+		return CYAML_ERR_TOP_LEVEL_NON_PTR;
+	}
+	if (schema->type != CYAML_SEQUENCE) {
+		seq_count = 0;
+	}
+
+	ctx.compiled = cyaml_schema_compiled_get(config, schema);
+
+	if (data != NULL) {
+		uint64_t root;
+
+		err = cyaml__snapshot_append(&ctx, schema, data,
+				seq_count, &root);
+	}
+
+	/* Allocations are appended to the queue as they are found. */
+	for (size_t i = 0; i < ctx.alloc_count && err == CYAML_OK; i++) {
+		const cyaml_snapshot_alloc_t alloc = ctx.allocs[i];
+
+		if (cyaml__snapshot_has_pointers(&ctx, alloc.schema)) {
+			err = cyaml__snapshot_write_contents(&ctx,
+					alloc.schema, alloc.data,
+					alloc.offset, alloc.count);
+		}
+	}
+
+	if (err == CYAML_OK) {
+		cyaml__snapshot_header_init(&header, schema, source);
+		header.image_size = ctx.image_size;
+		header.alloc_count = ctx.alloc_count;
+		header.reloc_count = ctx.reloc_count;
+		header.seq_count = seq_count;
+
+		/* Hash the tables as they are stored. */
+		header.check = cyaml__snapshot_hash(CYAML_SNAPSHOT_HASH_INIT,
+				ctx.image, ctx.image_size);
+		for (size_t i = 0; i < ctx.alloc_count; i++) {
+			header.check = cyaml__snapshot_hash_u64(header.check,
+					ctx.allocs[i].offset);
+		}
+		header.check = cyaml__snapshot_hash(header.check, ctx.relocs,
+				ctx.reloc_count * sizeof(*ctx.relocs));
+
+		err = cyaml__snapshot_write_file(&ctx, &header, path);
+	}
+
+	cyaml__free(config, ctx.image);
+	cyaml__free(config, ctx.allocs);
+	cyaml__free(config, ctx.relocs);
+	return err;
+}
+
+/**
+ * Find the allocation containing an image offset.
+ *
+ * \param[in]  offsets  Allocation offsets, in increasing order.
+ * \param[in]  count    Number of allocations.
+ * \param[in]  offset   The image offset to find.
+ * \return index of the allocation containing offset.
+ */
+static size_t cyaml__snapshot_find(
+		const uint64_t *offsets,
+		size_t count,
+		uint64_t offset)
+{
+	size_t lo = 0;
+	size_t hi = count;
+
+	/* The first allocation is at offset zero, so one always matches. */
+	while (hi - lo > 1) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (offsets[mid] <= offset) {
+			lo = mid;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
+/**
+ * Check a snapshot's tables are consistent with its image.
+ *
+ * \param[in]  header  The snapshot header.
+ * \param[in]  image   The image, before fixing up pointers.
+ * \param[in]  tables  The allocation offsets and relocation offsets.
+ * \return \ref CYAML_OK if the tables are valid, or
+ *         \ref CYAML_ERR_SNAPSHOT_INVALID otherwise.
+ */
+static cyaml_err_t cyaml__snapshot_validate(
+		const cyaml_snapshot_header_t *header,
+		const uint8_t *image,
+		const uint64_t *tables)
+{
+	const uint64_t *offsets = tables;
+	const uint64_t *relocs = tables + header->alloc_count;
+
+	if (header->alloc_count > 0 && offsets[0] != 0) {
+		return CYAML_ERR_SNAPSHOT_INVALID;
+	}
+	for (uint64_t i = 1; i < header->alloc_count; i++) {
+		if (offsets[i] <= offsets[i - 1] ||
+		    offsets[i] >= header->image_size) {
+			return CYAML_ERR_SNAPSHOT_INVALID;
+		}
+	}
+
+	for (uint64_t i = 0; i < header->reloc_count; i++) {
+		uintptr_t target;
+		size_t idx;
+
+		if (relocs[i] % sizeof(void *) != 0 ||
+		    relocs[i] > header->image_size - sizeof(void *)) {
+			return CYAML_ERR_SNAPSHOT_INVALID;
+		}
+		memcpy(&target, image + relocs[i], sizeof(target));
+		idx = cyaml__snapshot_find(offsets,
+				header->alloc_count, target);
+		if (offsets[idx] != target || idx == 0) {
+			return CYAML_ERR_SNAPSHOT_INVALID;
+		}
+	}
+
+	return CYAML_OK;
+}
+
+/**
+ * Read the header of a snapshot file, and check it is usable.
+ *
+ * \param[in]  file    The snapshot file.
+ * \param[in]  schema  The top-level schema.
+ * \param[in]  source  Client's key for the source data.
+ * \param[out] header  Returns the header.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__snapshot_read_header(
+		FILE *file,
+		const cyaml_schema_value_t *schema,
+		uint64_t source,
+		cyaml_snapshot_header_t *header)
+{
+	cyaml_snapshot_header_t expected;
+	struct stat st;
+	uint64_t tables;
+
+	if (fread(header, sizeof(*header), 1, file) != 1 ||
+	    memcmp(header->magic, CYAML_SNAPSHOT_MAGIC,
+			sizeof(header->magic)) != 0) {
+		return CYAML_ERR_SNAPSHOT_INVALID;
+	}
+
+	cyaml__snapshot_header_init(&expected, schema, source);
+	if (header->version != expected.version ||
+	    header->endian != expected.endian ||
+	    header->pointer_size != expected.pointer_size ||
+	    header->align != expected.align ||
+	    header->schema_hash != expected.schema_hash ||
+	    header->source != expected.source) {
+		return CYAML_ERR_SNAPSHOT_STALE;
+	}
+
+	if (fstat(fileno(file), &st) != 0 || st.st_size < 0) {
+		return CYAML_ERR_SNAPSHOT_INVALID;
+	}
+
+	/* Sizes are checked against the file before being trusted. */
+	if (header->image_size > (uint64_t)st.st_size ||
+	    header->alloc_count > (uint64_t)st.st_size ||
+	    header->reloc_count > (uint64_t)st.st_size) {
+		return CYAML_ERR_SNAPSHOT_INVALID;
+	}
+	tables = header->alloc_count + header->reloc_count;
+	if (sizeof(*header) + header->image_size +
+			tables * sizeof(uint64_t) != (uint64_t)st.st_size) {
+		return CYAML_ERR_SNAPSHOT_INVALID;
+	}
+	if (header->image_size % CYAML_SNAPSHOT_ALIGN != 0 ||
+	    (header->alloc_count == 0) != (header->image_size == 0)) {
+		return CYAML_ERR_SNAPSHOT_INVALID;
+	}
+
+	return CYAML_OK;
+}
+
+/**
+ * Copy a snapshot image's allocations into separate allocations.
+ *
+ * \param[in]  config    The client's CYAML library config.
+ * \param[in]  header    The snapshot header.
+ * \param[in]  image     The validated image.
+ * \param[in]  tables    The allocation offsets and relocation offsets.
+ * \param[out] root_out  Returns the root allocation on success.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__snapshot_copy_out(
+		const cyaml_config_t *config,
+		const cyaml_snapshot_header_t *header,
+		const uint8_t *image,
+		const uint64_t *tables,
+		uint8_t **root_out)
+{
+	const uint64_t *offsets = tables;
+	const uint64_t *relocs = tables + header->alloc_count;
+	size_t count = header->alloc_count;
+	uint8_t **ptrs;
+
+	ptrs = cyaml__alloc(config, sizeof(*ptrs) * count, true);
+	if (ptrs == NULL) {
+		return CYAML_ERR_OOM;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		uint64_t end = (i + 1 < count) ?
+				offsets[i + 1] : header->image_size;
+
+		ptrs[i] = cyaml__alloc(config, end - offsets[i], false);
+		if (ptrs[i] == NULL) {
+			while (i > 0) {
+				cyaml__free(config, ptrs[--i]);
+			}
+			cyaml__free(config, ptrs);
+			return CYAML_ERR_OOM;
+		}
+		memcpy(ptrs[i], image + offsets[i], end - offsets[i]);
+	}
+
+	for (uint64_t i = 0; i < header->reloc_count; i++) {
+		size_t slot = cyaml__snapshot_find(offsets, count, relocs[i]);
+		uintptr_t target;
+
+		memcpy(&target, image + relocs[i], sizeof(target));
+		cyaml_data_write_pointer(
+				ptrs[cyaml__snapshot_find(offsets, count,
+						target)],
+				ptrs[slot] + (relocs[i] - offsets[slot]));
+	}
+
+	*root_out = ptrs[0];
+	cyaml__free(config, ptrs);
+	return CYAML_OK;
+}
+
+/**
+ * Load the data from a snapshot file.
+ *
+ * \param[in]  file      The snapshot file, positioned after the header.
+ * \param[in]  config    The client's CYAML library config.
+ * \param[in]  header    The snapshot header.
+ * \param[out] root_out  Returns the root allocation on success.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t cyaml__snapshot_read(
+		FILE *file,
+		const cyaml_config_t *config,
+		const cyaml_snapshot_header_t *header,
+		uint8_t **root_out)
+{
+	bool arena = config->flags & CYAML_CFG_ARENA;
+	size_t count = header->alloc_count + header->reloc_count;
+	cyaml_arena_t *doc_arena = NULL;
+	uint8_t *image = NULL;
+	uint64_t *tables;
+	cyaml_err_t err;
+
+	tables = cyaml__alloc(config, sizeof(*tables) * count, false);
+	if (tables == NULL) {
+		return CYAML_ERR_OOM;
+	}
+
+	if (arena) {
+		image = cyaml_arena_realloc(config, &doc_arena, NULL, 0,
+				header->image_size, true);
+	} else {
+		image = cyaml__alloc(config, header->image_size, false);
+	}
+	if (image == NULL) {
+		err = CYAML_ERR_OOM;
+		goto out;
+	}
+
+	if (fread(image, 1, header->image_size, file) != header->image_size ||
+	    fread(tables, sizeof(*tables), count, file) != count ||
+	    cyaml__snapshot_check(image, header->image_size,
+			tables, count) != header->check) {
+		err = CYAML_ERR_SNAPSHOT_INVALID;
+		goto out;
+	}
+
+	err = cyaml__snapshot_validate(header, image, tables);
+	if (err != CYAML_OK) {
+		goto out;
+	}
+
+	if (arena) {
+		const uint64_t *relocs = tables + header->alloc_count;
+
+		for (uint64_t i = 0; i < header->reloc_count; i++) {
+			uintptr_t target;
+
+			memcpy(&target, image + relocs[i], sizeof(target));
+			cyaml_data_write_pointer(image + target,
+					image + relocs[i]);
+		}
+		*root_out = image;
+		image = NULL;
+		doc_arena = NULL;
+	} else {
+		err = cyaml__snapshot_copy_out(config, header, image,
+				tables, root_out);
+	}
+
+out:
+	if (arena) {
+		cyaml_arena_destroy(config, doc_arena);
+	} else {
+		cyaml__free(config, image);
+	}
+	cyaml__free(config, tables);
+	return err;
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_snapshot_load(
+		const char *path,
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		uint64_t source,
+		cyaml_data_t **data_out,
+		unsigned *seq_count_out)
+{
+	cyaml_snapshot_header_t header;
+	uint8_t *root = NULL;
+	cyaml_err_t err;
+	FILE *file;
+
+	if (config == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_CONFIG;
+	}
+	if (config->mem_fn == NULL) {
+		return CYAML_ERR_BAD_CONFIG_NULL_MEMFN;
+	}
+	if (schema == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_SCHEMA;
+	}
+	if ((schema->type == CYAML_SEQUENCE) != (seq_count_out != NULL)) {
+		return CYAML_ERR_BAD_PARAM_SEQ_COUNT;
+	}
+	if (!(schema->flags & CYAML_FLAG_POINTER)) {
+		return CYAML_ERR_TOP_LEVEL_NON_PTR;
+	}
+	if (data_out == NULL) {
+		return CYAML_ERR_BAD_PARAM_NULL_DATA;
+	}
+
+	file = fopen(path, "rb");
+	if (file == NULL) {
+		return CYAML_ERR_FILE_OPEN;
+	}
+
+	err = cyaml__snapshot_read_header(file, schema, source, &header);
+	if (err == CYAML_OK && header.alloc_count > 0) {
+		err = cyaml__snapshot_read(file, config, &header, &root);
+	}
+	fclose(file);
+
+	if (err != CYAML_OK) {
+		cyaml__log(config, CYAML_LOG_INFO,
+				"Snapshot %s: %s\n", path, cyaml_strerror(err));
+		return err;
+	}
+
+	*data_out = root;
+	if (seq_count_out != NULL) {
+		*seq_count_out = (unsigned)header.seq_count;
+	}
+	return CYAML_OK;
+}
+
+/* Exported function, documented in include/cyaml/cyaml.h */
+cyaml_err_t cyaml_load_file_cached(
+		const char *path,
+		const char *snapshot_path,
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		cyaml_data_t **data_out,
+		unsigned *seq_count_out)
+{
+	uint64_t source = CYAML_SNAPSHOT_HASH_INIT;
+	struct stat st;
+	cyaml_err_t err;
+
+	if (stat(path, &st) != 0) {
+		return CYAML_ERR_FILE_OPEN;
+	}
+
+	/* Any change to the file should change one of these. */
+	source = cyaml__snapshot_hash_u64(source, (uint64_t)st.st_dev);
+	source = cyaml__snapshot_hash_u64(source, (uint64_t)st.st_ino);
+	source = cyaml__snapshot_hash_u64(source, (uint64_t)st.st_size);
+	source = cyaml__snapshot_hash_u64(source, (uint64_t)st.st_mtim.tv_sec);
+	source = cyaml__snapshot_hash_u64(source, (uint64_t)st.st_mtim.tv_nsec);
+
+	err = cyaml_snapshot_load(snapshot_path, config, schema, source,
+			data_out, seq_count_out);
+	if (err != CYAML_ERR_FILE_OPEN &&
+	    err != CYAML_ERR_SNAPSHOT_STALE &&
+	    err != CYAML_ERR_SNAPSHOT_INVALID) {
+		return err;
+	}
+
+	err = cyaml_load_file(path, config, schema, data_out, seq_count_out);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	err = cyaml_snapshot_save(snapshot_path, config, schema, *data_out,
+			(seq_count_out != NULL) ? *seq_count_out : 0, source);
+	if (err != CYAML_OK) {
+		/* The data is loaded; the next load just won't be faster. */
+		cyaml__log(config, CYAML_LOG_WARNING,
+				"Failed to save snapshot %s: %s\n",
+				snapshot_path, cyaml_strerror(err));
+	}
+
+	return CYAML_OK;
+}
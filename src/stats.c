@@ -0,0 +1,37 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (C) 2019 Michael Drake <tlsa@netsurf-browser.org>
+ */
+
+/**
+ * \file
+ * \brief CYAML load and save statistics.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <time.h>
+
+#include "stats.h"
+
+#ifdef CYAML_STATS
+
+/* Exported function, documented in stats.h. */
+uint64_t cyaml_stats_time(
+		const cyaml_config_t *config,
+		uint64_t exclude)
+{
+	struct timespec ts;
+
+	if (!CYAML_STATS_TIMING(config)) {
+		return 0;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000u +
+			(uint64_t)ts.tv_nsec - exclude;
+}
+
+#endif
@@ -0,0 +1,111 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (C) 2019 Michael Drake <tlsa@netsurf-browser.org>
+ */
+
+/**
+ * \file
+ * \brief CYAML load and save statistics.
+ *
+ * Statistics are gathered into the client's \ref cyaml_stats_t, if one is
+ * attached to the config.  When the library is built without
+ * `CYAML_STATS` defined, these macros expand to nothing.
+ */
+
+#ifndef CYAML_STATS_H
+#define CYAML_STATS_H
+
+#include "cyaml/cyaml.h"
+
+#ifdef CYAML_STATS
+
+/**
+ * Get the current time, if the client is gathering timing statistics.
+ *
+ * \param[in]  config   The client's CYAML library config.
+ * \param[in]  exclude  Nanoseconds already counted elsewhere, to exclude.
+ * \return the current time in nanoseconds, less exclude, or 0 if timing
+ *         is not required.
+ */
+uint64_t cyaml_stats_time(
+		const cyaml_config_t *config,
+		uint64_t exclude);
+
+/** Add `_n` to counter `_counter`. */
+#define CYAML_STATS_ADD(_config, _counter, _n) \
+	do { \
+		if ((_config)->stats != NULL) { \
+			(_config)->stats->_counter += (_n); \
+		} \
+	} while (0)
+
+/** Raise counter `_counter` to `_n`, if it is lower. */
+#define CYAML_STATS_MAX(_config, _counter, _n) \
+	do { \
+		if ((_config)->stats != NULL && \
+		    (_config)->stats->_counter < (_n)) { \
+			(_config)->stats->_counter = (_n); \
+		} \
+	} while (0)
+
+/** Whether the client is gathering timing statistics. */
+#define CYAML_STATS_TIMING(_config) \
+	((_config)->stats != NULL && (_config)->stats->timing)
+
+/**
+ * Start a timer, named `_timer`.
+ *
+ * Time added to counter `_excl` while the timer runs is not counted by
+ * the timer.
+ */
+#define CYAML_STATS_TIMER_START_EXCL(_config, _timer, _excl) \
+	uint64_t _timer = !CYAML_STATS_TIMING(_config) ? 0 : \
+			cyaml_stats_time(_config, (_config)->stats->_excl)
+
+/** Stop timer `_timer`, adding the time it ran to counter `_counter`. */
+#define CYAML_STATS_TIMER_END_EXCL(_config, _counter, _timer, _excl) \
+	do { \
+		if (_timer != 0) { \
+			(_config)->stats->_counter += cyaml_stats_time( \
+					_config, \
+					(_config)->stats->_excl) - _timer; \
+		} \
+	} while (0)
+
+/** Start a timer, named `_timer`. */
+#define CYAML_STATS_TIMER_START(_config, _timer) \
+	uint64_t _timer = !CYAML_STATS_TIMING(_config) ? 0 : \
+			cyaml_stats_time(_config, 0)
+
+/** Stop timer `_timer`, adding the time it ran to counter `_counter`. */
+#define CYAML_STATS_TIMER_END(_config, _counter, _timer) \
+	do { \
+		if (_timer != 0) { \
+			(_config)->stats->_counter += \
+					cyaml_stats_time(_config, 0) - _timer; \
+		} \
+	} while (0)
+
+#else
+
+#define CYAML_STATS_ADD(_config, _counter, _n) \
+	((void)(_config))
+#define CYAML_STATS_MAX(_config, _counter, _n) \
+	((void)(_config))
+#define CYAML_STATS_TIMER_START_EXCL(_config, _timer, _excl) \
+	((void)(_config))
+#define CYAML_STATS_TIMER_END_EXCL(_config, _counter, _timer, _excl) \
+	((void)(_config))
+#define CYAML_STATS_TIMER_START(_config, _timer) \
+	((void)(_config))
+#define CYAML_STATS_TIMER_END(_config, _counter, _timer) \
+	((void)(_config))
+
+#endif
+
+/** Increment counter `_counter`. */
+#define CYAML_STATS_INC(_config, _counter) \
+	CYAML_STATS_ADD(_config, _counter, 1)
+
+#endif
@@ -10,8 +10,10 @@
  */
 
 #include <assert.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 
 #include "utf8.h"
 
@@ -105,6 +107,113 @@ invalid:
 	return 0xfffd; /* REPLACEMENT CHARACTER */
 }
 
+/** Codepoints at and above this have no lower case mapping in the tables. */
+#define CYAML_UTF8_LOWER_LIMIT 0x0280
+
+/** Number of codepoints covered by each block of the case mapping table. */
+#define CYAML_UTF8_LOWER_BLOCK 64
+
+/**
+ * Case mapping block for each \ref CYAML_UTF8_LOWER_BLOCK codepoints.
+ *
+ * Indexes \ref cyaml_utf8_lower_delta.  Block 0 has no mappings, and is
+ * shared by every range without upper case letters.
+ */
+static const uint8_t cyaml_utf8_lower_blocks[
+		CYAML_UTF8_LOWER_LIMIT / CYAML_UTF8_LOWER_BLOCK] = {
+	0, 1, 0, 2, 3, 4, 5, 6, 7, 8,
+};
+
+/**
+ * Per-codepoint offset from each codepoint to its lower case form.
+ *
+ * Covers Basic Latin, Latin-1 Supplement, Latin Extended-A and
+ * Latin Extended-B.
+ */
+static const int16_t cyaml_utf8_lower_delta[][CYAML_UTF8_LOWER_BLOCK] = {
+	[0] = { 0 },
+	[1] = {
+		   0,   32,   32,   32,   32,   32,   32,   32,
+		  32,   32,   32,   32,   32,   32,   32,   32,
+		  32,   32,   32,   32,   32,   32,   32,   32,
+		  32,   32,   32,    0,    0,    0,    0,    0,
+		   0,    0,    0,    0,    0,    0,    0,    0,
+		   0,    0,    0,    0,    0,    0,    0,    0,
+		   0,    0,    0,    0,    0,    0,    0,    0,
+		   0,    0,    0,    0,    0,    0,    0,    0,
+	},
+	[2] = {
+		  32,   32,   32,   32,   32,   32,   32,   32,
+		  32,   32,   32,   32,   32,   32,   32,   32,
+		  32,   32,   32,   32,   32,   32,   32,    0,
+		  32,   32,   32,   32,   32,   32,   32,    0,
+		   0,    0,    0,    0,    0,    0,    0,    0,
+		   0,    0,    0,    0,    0,    0,    0,    0,
+		   0,    0,    0,    0,    0,    0,    0,    0,
+		   0,    0,    0,    0,    0,    0,    0,    0,
+	},
+	[3] = {
+		   0,   -1,    0,   -1,    0,   -1,    0,   -1,
+		   0,   -1,    0,   -1,    0,   -1,    0,   -1,
+		   0,   -1,    0,   -1,    0,   -1,    0,   -1,
+		   0,   -1,    0,   -1,    0,   -1,    0,   -1,
+		   0,   -1,    0,   -1,    0,   -1,    0,   -1,
+		   0,   -1,    0,   -1,    0,   -1,    0,   -1,
+		   0,    0,    0,   -1,    0,   -1,    0,   -1,
+		   0,    1,    0,    1,    0,    1,    0,    1,
+	},
+	[4] = {
+		   0,    1,    0,    1,    0,    1,    0,    1,
+		   0,    0,    0,   -1,    0,   -1,    0,   -1,
+		   0,   -1,    0,   -1,    0,   -1,    0,   -1,
+		   0,   -1,    0,   -1,    0,   -1,    0,   -1,
+		   0,   -1,    0,   -1,    0,   -1,    0,   -1,
+		   0,   -1,    0,   -1,    0,   -1,    0,   -1,
+		   0,   -1,    0,   -1,    0,   -1,    0,   -1,
+		-121,    1,    0,    1,    0,    1,    0,    0,
+	},
+	[5] = {
+		   0,    0,    0,   -1,    0,   -1,    0,    1,
+		   0,    0,    0,    1,    0,    0,   79,    0,
+		   0,    1,    0,    0,    0,    0,    0,    0,
+		   1,    0,    0,    0,    0,    0,    0,    0,
+		   0,   -1,    0,   -1,    0,   -1,    0,    1,
+		   0,    0,    0,    0,    1,    0,    0,    1,
+		   0,    0,    0,    1,    0,    1,    0,  219,
+		   1,    0,    0,    0,    1,    0,    0,    0,
+	},
+	[6] = {
+		   0,    0,    0,    0,    2,    1,    0,    2,
+		   1,    0,    2,    1,    0,    1,    0,    1,
+		   0,    1,    0,    1,    0,    1,    0,    1,
+		   0,    1,    0,    1,    0,    0,    0,   -1,
+		   0,   -1,    0,   -1,    0,   -1,    0,   -1,
+		   0,   -1,    0,   -1,    0,   -1,    0,   -1,
+		   0,    2,    1,    0,    1,    0,    0,  -56,
+		   0,   -1,    0,   -1,    0,   -1,    0,   -1,
+	},
+	[7] = {
+		   0,   -1,    0,   -1,    0,   -1,    0,   -1,
+		   0,   -1,    0,   -1,    0,   -1,    0,   -1,
+		   0,   -1,    0,   -1,    0,   -1,    0,   -1,
+		   0,   -1,    0,   -1,    0,   -1,    0,   -1,
+		-130,    0,    0,   -1,    0,   -1,    0,   -1,
+		   0,   -1,    0,   -1,    0,   -1,    0,   -1,
+		   0,   -1,    0,   -1,    0,    0,    0,    0,
+		   0,    0,    0,    1,    0, -163,    0,    0,
+	},
+	[8] = {
+		   0,    1,    0, -195,    0,    0,    0,   -1,
+		   0,   -1,    0,   -1,    0,   -1,    0,   -1,
+		   0,    0,    0,    0,    0,    0,    0,    0,
+		   0,    0,    0,    0,    0,    0,    0,    0,
+		   0,    0,    0,    0,    0,    0,    0,    0,
+		   0,    0,    0,    0,    0,    0,    0,    0,
+		   0,    0,    0,    0,    0,    0,    0,    0,
+		   0,    0,    0,    0,    0,    0,    0,    0,
+	},
+};
+
 /**
  * Convert a Unicode codepoint to lower case.
  *
@@ -114,61 +223,65 @@ invalid:
  * \param[in]  c  Codepoint to convert to lower-case, if applicable.
  * \return the lower-cased codepoint.
  */
-static unsigned cyaml_utf8_to_lower(unsigned c)
+static inline unsigned cyaml_utf8_to_lower(unsigned c)
 {
-	if (((c >= 0x0041) && (c <= 0x005a)) /* Basic Latin */        ||
-	    ((c >= 0x00c0) && (c <= 0x00d6)) /* Latin-1 Supplement */ ||
-	    ((c >= 0x00d8) && (c <= 0x00de)) /* Latin-1 Supplement */ ) {
-		return c + 32;
-
-	} else if (((c >= 0x0100) && (c <= 0x012f)) /* Latin Extended-A */ ||
-	           ((c >= 0x0132) && (c <= 0x0137)) /* Latin Extended-A */ ||
-	           ((c >= 0x014a) && (c <= 0x0177)) /* Latin Extended-A */ ||
-	           ((c >= 0x0182) && (c <= 0x0185)) /* Latin Extended-B */ ||
-	           ((c >= 0x01a0) && (c <= 0x01a5)) /* Latin Extended-B */ ||
-	           ((c >= 0x01de) && (c <= 0x01ef)) /* Latin Extended-B */ ||
-	           ((c >= 0x01f8) && (c <= 0x021f)) /* Latin Extended-B */ ||
-	           ((c >= 0x0222) && (c <= 0x0233)) /* Latin Extended-B */ ||
-	           ((c >= 0x0246) && (c <= 0x024f)) /* Latin Extended-B */ ) {
-		return c & ~0x1;
-
-	} else if (((c >= 0x0139) && (c <= 0x0148) /* Latin Extended-A */) ||
-	           ((c >= 0x0179) && (c <= 0x017e) /* Latin Extended-A */) ||
-	           ((c >= 0x01b3) && (c <= 0x01b6) /* Latin Extended-B */) ||
-	           ((c >= 0x01cd) && (c <= 0x01dc) /* Latin Extended-B */)) {
-		return (c + 1) & ~0x1;
-
-	} else switch (c) {
-		case 0x0178: return 0x00ff; /* Latin Extended-A */
-		case 0x0187: return 0x0188; /* Latin Extended-B */
-		case 0x018b: return 0x018c; /* Latin Extended-B */
-		case 0x018e: return 0x01dd; /* Latin Extended-B */
-		case 0x0191: return 0x0192; /* Latin Extended-B */
-		case 0x0198: return 0x0199; /* Latin Extended-B */
-		case 0x01a7: return 0x01a8; /* Latin Extended-B */
-		case 0x01ac: return 0x01ad; /* Latin Extended-B */
-		case 0x01af: return 0x01b0; /* Latin Extended-B */
-		case 0x01b7: return 0x0292; /* Latin Extended-B */
-		case 0x01b8: return 0x01b9; /* Latin Extended-B */
-		case 0x01bc: return 0x01bd; /* Latin Extended-B */
-		case 0x01c4: return 0x01c6; /* Latin Extended-B */
-		case 0x01c5: return 0x01c6; /* Latin Extended-B */
-		case 0x01c7: return 0x01c9; /* Latin Extended-B */
-		case 0x01c8: return 0x01c9; /* Latin Extended-B */
-		case 0x01ca: return 0x01cc; /* Latin Extended-B */
-		case 0x01cb: return 0x01cc; /* Latin Extended-B */
-		case 0x01f1: return 0x01f3; /* Latin Extended-B */
-		case 0x01f2: return 0x01f3; /* Latin Extended-B */
-		case 0x01f4: return 0x01f5; /* Latin Extended-B */
-		case 0x01f7: return 0x01bf; /* Latin Extended-B */
-		case 0x0220: return 0x019e; /* Latin Extended-B */
-		case 0x023b: return 0x023c; /* Latin Extended-B */
-		case 0x023d: return 0x019a; /* Latin Extended-B */
-		case 0x0241: return 0x0242; /* Latin Extended-B */
-		case 0x0243: return 0x0180; /* Latin Extended-B */
+	if (c >= CYAML_UTF8_LOWER_LIMIT) {
+		return c;
 	}
 
-	return c;
+	return c + cyaml_utf8_lower_delta
+			[cyaml_utf8_lower_blocks[c / CYAML_UTF8_LOWER_BLOCK]]
+			[c % CYAML_UTF8_LOWER_BLOCK];
+}
+
+/** Word size for processing runs of ASCII several bytes at a time. */
+typedef uint64_t cyaml_utf8_word_t;
+
+/** Get a \ref cyaml_utf8_word_t with every byte set to the given value. */
+#define CYAML_UTF8_WORD_BYTES(_b) \
+	((cyaml_utf8_word_t)(_b) * (UINT64_MAX / 0xff))
+
+/**
+ * Load a word of string bytes.
+ *
+ * \param[in]  s  String to load from, with at least a word of bytes left.
+ * \return the bytes.
+ */
+static inline cyaml_utf8_word_t cyaml_utf8_word_load(const uint8_t *s)
+{
+	cyaml_utf8_word_t w;
+
+	memcpy(&w, s, sizeof(w));
+	return w;
+}
+
+/**
+ * Test whether every byte in a word is ASCII.
+ *
+ * \param[in]  w  Word of bytes to test.
+ * \return true if no byte has its top bit set, false otherwise.
+ */
+static inline bool cyaml_utf8_word_is_ascii(cyaml_utf8_word_t w)
+{
+	return (w & CYAML_UTF8_WORD_BYTES(0x80)) == 0;
+}
+
+/**
+ * Convert a word of ASCII bytes to lower case.
+ *
+ * Each byte gets its top bit set by the addition if it is above a bound.
+ * Bytes are ASCII, so the additions can't carry between bytes.
+ *
+ * \param[in]  w  Word of ASCII bytes to convert.
+ * \return the word with upper case letters converted to lower case.
+ */
+static inline cyaml_utf8_word_t cyaml_utf8_word_to_lower(cyaml_utf8_word_t w)
+{
+	cyaml_utf8_word_t ge_a = w + CYAML_UTF8_WORD_BYTES(0x80 - 'A');
+	cyaml_utf8_word_t gt_z = w + CYAML_UTF8_WORD_BYTES(0x7f - 'Z');
+	cyaml_utf8_word_t upper = (ge_a ^ gt_z) & CYAML_UTF8_WORD_BYTES(0x80);
+
+	return w | (upper >> 2);
 }
 
 /* Exported function, documented in utf8.h. */
@@ -178,6 +291,8 @@ int cyaml_utf8_casecmp(
 {
 	const uint8_t *s1 = str1;
 	const uint8_t *s2 = str2;
+	const uint8_t *end1 = s1 + strlen(str1);
+	const uint8_t *end2 = s2 + strlen(str2);
 
 	while (true) {
 		unsigned len1;
@@ -185,6 +300,22 @@ int cyaml_utf8_casecmp(
 		int cmp1;
 		int cmp2;
 
+		/* Skip runs of matching ASCII a word at a time.  Anything
+		 * else is left for the per-character comparison below. */
+		while ((end1 - s1 >= (ptrdiff_t)sizeof(cyaml_utf8_word_t)) &&
+		       (end2 - s2 >= (ptrdiff_t)sizeof(cyaml_utf8_word_t))) {
+			cyaml_utf8_word_t w1 = cyaml_utf8_word_load(s1);
+			cyaml_utf8_word_t w2 = cyaml_utf8_word_load(s2);
+
+			if (!cyaml_utf8_word_is_ascii(w1 | w2) ||
+			    cyaml_utf8_word_to_lower(w1) !=
+			    cyaml_utf8_word_to_lower(w2)) {
+				break;
+			}
+			s1 += sizeof(cyaml_utf8_word_t);
+			s2 += sizeof(cyaml_utf8_word_t);
+		}
+
 		/* Check for end of strings. */
 		if ((*s1 == 0) && (*s2 == 0)) {
 			return 0; /* Both strings ended; match. */
@@ -242,3 +373,69 @@ int cyaml_utf8_casecmp(
 		s2 += len2;
 	}
 }
+
+/* Exported function, documented in utf8.h. */
+uint32_t cyaml_utf8_casehash(
+		const void * const str)
+{
+	const uint8_t *s = str;
+	const uint8_t *end = s + strlen(str);
+	uint32_t hash = 2166136261u; /* FNV-1a offset basis. */
+
+	while (*s != 0) {
+		unsigned len;
+		unsigned c;
+
+		/* Fold runs of ASCII a word at a time. */
+		while (end - s >= (ptrdiff_t)sizeof(cyaml_utf8_word_t)) {
+			cyaml_utf8_word_t w = cyaml_utf8_word_load(s);
+			uint8_t folded[sizeof(w)];
+
+			if (!cyaml_utf8_word_is_ascii(w)) {
+				break;
+			}
+			w = cyaml_utf8_word_to_lower(w);
+			memcpy(folded, &w, sizeof(w));
+			for (unsigned i = 0; i < sizeof(w); i++) {
+				hash = (hash ^ folded[i]) * 16777619u;
+			}
+			s += sizeof(w);
+		}
+		if (*s == 0) {
+			break;
+		}
+
+		len = cyaml_utf8_char_len(*s);
+
+		if (len == 1) {
+			/* Common case: ASCII. */
+			c = ((*s >= 'A') && (*s <= 'Z')) ?
+					(*s + 'a' - 'A') : *s;
+
+		} else if (len != 0) {
+			/* Don't decode past the end of a truncated sequence. */
+			for (unsigned i = 1; i < len; i++) {
+				if (s[i] == 0) {
+					len = 0;
+					break;
+				}
+			}
+		}
+
+		if (len == 0) {
+			/* The comparison function considers any two invalid
+			 * sequences to match, so they all hash the same. */
+			c = 0xffffffff;
+			len = 1;
+
+		} else if (len != 1) {
+			c = cyaml_utf8_to_lower(
+					cyaml_utf8_get_codepoint(s, &len));
+		}
+
+		hash = (hash ^ c) * 16777619u; /* FNV-1a prime. */
+		s += len;
+	}
+
+	return hash;
+}
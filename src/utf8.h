@@ -43,4 +43,16 @@ int cyaml_utf8_casecmp(
 		const void * const str1,
 		const void * const str2);
 
+/**
+ * Case insensitive hash.
+ *
+ * Any two strings which \ref cyaml_utf8_casecmp considers equal will
+ * produce the same hash value.
+ *
+ * \param[in]  str  String to hash.
+ * \return hash of the case-folded string.
+ */
+uint32_t cyaml_utf8_casehash(
+		const void * const str);
+
 #endif
@@ -106,6 +106,17 @@ const char * cyaml_strerror(
 		[CYAML_ERR_LIBYAML_EVENT_INIT]    = "libyaml event init failed",
 		[CYAML_ERR_LIBYAML_EMITTER]       = "libyaml emitter error",
 		[CYAML_ERR_LIBYAML_PARSER]        = "libyaml parser error",
+		[CYAML_ERR_STREAM_END]            = "No more documents in stream",
+		[CYAML_ERR_BUFFER_FULL]           = "Output buffer too small",
+		[CYAML_ERR_FILE_WRITE]            = "Failed to write file",
+		[CYAML_ERR_SNAPSHOT_INVALID]      = "Invalid snapshot file",
+		[CYAML_ERR_SNAPSHOT_STALE]        = "Snapshot does not match input",
+		[CYAML_ERR_WRITER_STATE]          = "Writer function called out of order",
+		[CYAML_ERR_NEED_INPUT]            = "More input needed",
+		[CYAML_ERR_NOT_SUPPORTED]         = "Not supported by this build",
+		[CYAML_ERR_DECOMPRESS]            = "Invalid compressed input",
+		[CYAML_ERR_LIMIT_EXCEEDED]        = "Load limit exceeded",
+		[CYAML_ERR_INVALID_ALIAS]         = "Invalid alias",
 	};
 	if ((unsigned)err >= CYAML_ERR__COUNT) {
 		return "Invalid error code";
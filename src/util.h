@@ -12,6 +12,8 @@
 #ifndef CYAML_UTIL_H
 #define CYAML_UTIL_H
 
+#include <limits.h>
+
 #include "cyaml/cyaml.h"
 #include "utf8.h"
 
@@ -32,6 +34,28 @@ typedef uint32_t cyaml_bitfield_t;
 /** Number of bits in \ref cyaml_bitfield_t. */
 #define CYAML_BITFIELD_BITS (sizeof(cyaml_bitfield_t) * CHAR_BIT)
 
+/**
+ * Mappings with up to this many fields keep their bit field of fields found
+ * in their load state stack entry, rather than in scratch space.
+ */
+#define CYAML_BITFIELD_INLINE_FIELDS 64
+
+/**
+ * Get the number of bit field scratch words needed to load a mapping.
+ *
+ * \param[in]  count  Number of fields in the mapping schema.
+ * \return the number of words of bitfield scratch space used.
+ */
+static inline uint32_t cyaml__bitfield_words(
+		unsigned count)
+{
+	if (count <= CYAML_BITFIELD_INLINE_FIELDS) {
+		return 0;
+	}
+
+	return (count + CYAML_BITFIELD_BITS - 1) / CYAML_BITFIELD_BITS;
+}
+
 /** CYAML state machine states. */
 enum cyaml_state_e {
 	CYAML_STATE_START,        /**< Initial state. */
@@ -166,4 +190,57 @@ static inline int cyaml__strcmp(
 	return cyaml_utf8_casecmp(str1, str2);
 }
 
+/**
+ * Compare a string with a lower case ASCII string, ignoring case.
+ *
+ * \param[in]  str    The string to compare.
+ * \param[in]  lower  Lower case ASCII string to compare with.
+ * \param[in]  len    Number of bytes to compare.
+ * \return true if the strings match, false otherwise.
+ */
+static inline bool cyaml__ascii_caseeq(
+		const char *str,
+		const char *lower,
+		size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		char c = str[i];
+		if (c >= 'A' && c <= 'Z') {
+			c += 'a' - 'A';
+		}
+		if (c != lower[i]) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Parse a boolean value.
+ *
+ * The strings "0", "no", "false" and "disable", in any case, are false.
+ * Everything else is true.
+ *
+ * \param[in]  value  The string to parse.
+ * \param[in]  len    Length of value in bytes.
+ * \return the boolean value.
+ */
+static inline bool cyaml__parse_bool(
+		const char *value,
+		size_t len)
+{
+	/* The strings that mean false, indexed by their length. */
+	static const char * const false_strings[] = {
+		[1] = "0",
+		[2] = "no",
+		[5] = "false",
+		[7] = "disable",
+	};
+
+	return !(len < CYAML_ARRAY_LEN(false_strings) &&
+	         false_strings[len] != NULL &&
+	         cyaml__ascii_caseeq(value, false_strings[len], len));
+}
+
 #endif
@@ -0,0 +1,66 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (C) 2019 Michael Drake <tlsa@netsurf-browser.org>
+ */
+
+/**
+ * \file
+ * \brief CYAML benchmark workloads.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <cyaml/cyaml.h>
+
+/** A growable buffer for generated YAML. */
+typedef struct bench_buf {
+	char *data;  /**< Buffer contents, nul terminated. */
+	size_t len;  /**< Length of contents in bytes. */
+	size_t max;  /**< Allocated size of data. */
+} bench_buf_t;
+
+/**
+ * Append formatted text to a buffer.
+ *
+ * \param[in,out]  buf  The buffer to append to.
+ * \param[in]      fmt  Format string.
+ * \return true on success, false on allocation failure.
+ */
+bool bench_buf_printf(
+		bench_buf_t *buf,
+		const char *fmt,
+		...);
+
+/** A benchmark workload. */
+typedef struct bench_workload {
+	/** Short name of workload, used in results. */
+	const char *name;
+	/** Schema for each document. */
+	const cyaml_schema_value_t *schema;
+	/** Whether the input is a stream of many documents. */
+	bool stream;
+	/**
+	 * Generate the workload's input YAML.
+	 *
+	 * \param[in,out]  buf    Empty buffer to generate input into.
+	 * \param[in]      scale  Multiplier for the size of the input.
+	 * \return number of documents generated, or 0 on failure.
+	 */
+	unsigned (*generate)(bench_buf_t *buf, unsigned scale);
+} bench_workload_t;
+
+/**
+ * Get the benchmark workloads.
+ *
+ * \param[out] count  Returns the number of workloads.
+ * \return the array of workloads.
+ */
+const bench_workload_t * bench_workloads(
+		unsigned *count);
+
+#endif
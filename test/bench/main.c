@@ -0,0 +1,532 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (C) 2019 Michael Drake <tlsa@netsurf-browser.org>
+ */
+
+/**
+ * \file
+ * \brief CYAML benchmark harness.
+ *
+ * Runs each workload through \ref cyaml_load_data, \ref cyaml_load_file,
+ * \ref cyaml_save_data and \ref cyaml_free, and reports throughput and
+ * allocation counts.  With `-m`, results are written as one JSON object
+ * per line, for comparison between releases.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <unistd.h>
+
+#include "bench.h"
+
+/** Benchmarked operations. */
+enum bench_op {
+	BENCH_OP_LOAD_DATA,
+	BENCH_OP_LOAD_FILE,
+	BENCH_OP_SAVE_DATA,
+	BENCH_OP_FREE,
+	BENCH_OP__COUNT,
+};
+
+/** Names of \ref bench_op values, used in results. */
+static const char * const bench_op_names[BENCH_OP__COUNT] = {
+	[BENCH_OP_LOAD_DATA] = "load_data",
+	[BENCH_OP_LOAD_FILE] = "load_file",
+	[BENCH_OP_SAVE_DATA] = "save_data",
+	[BENCH_OP_FREE]      = "free",
+};
+
+/** Allocator call counts. */
+struct bench_mem {
+	uint64_t allocs; /**< Calls allocating or resizing. */
+	uint64_t frees;  /**< Calls freeing an allocation. */
+};
+
+/** A workload's generated input. */
+struct bench_input {
+	const bench_workload_t *workload; /**< The workload. */
+	bench_buf_t yaml;                 /**< Generated YAML. */
+	const char *path;                 /**< File containing the YAML. */
+	unsigned docs;                    /**< Number of documents. */
+};
+
+/** A loaded set of documents. */
+struct bench_docs {
+	cyaml_data_t **data;  /**< Loaded document data. */
+	unsigned *seq_count;  /**< Top level sequence entry counts. */
+	unsigned count;       /**< Number of documents loaded. */
+};
+
+/** Results for one operation on one workload. */
+struct bench_result {
+	uint64_t bytes;      /**< Bytes processed per iteration. */
+	uint64_t iterations; /**< Number of iterations run. */
+	double seconds;      /**< Time spent in the operation. */
+	struct bench_mem mem; /**< Allocator calls over all iterations. */
+};
+
+/** Benchmark settings. */
+struct bench_settings {
+	unsigned scale;      /**< Workload size multiplier. */
+	double min_seconds;  /**< Minimum time to run each operation for. */
+	bool machine;        /**< Whether to produce JSON output. */
+	const char *only;    /**< Name of only workload to run, or NULL. */
+};
+
+/**
+ * Counting allocator.
+ *
+ * \param[in]  ctx   The \ref bench_mem to count calls in.
+ * \param[in]  ptr   Existing allocation, or NULL.
+ * \param[in]  size  New size, or 0 to free.
+ * \return the allocation, or NULL.
+ */
+static void * bench_mem_fn(
+		void *ctx,
+		void *ptr,
+		size_t size)
+{
+	struct bench_mem *mem = ctx;
+
+	if (size == 0) {
+		if (ptr != NULL) {
+			mem->frees++;
+		}
+		free(ptr);
+		return NULL;
+	}
+
+	mem->allocs++;
+	return realloc(ptr, size);
+}
+
+/**
+ * Get the current time.
+ *
+ * \return the time in seconds.
+ */
+static double bench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Free a set of loaded documents.
+ *
+ * \param[in]      config  The CYAML config.
+ * \param[in]      input   The input the documents were loaded from.
+ * \param[in,out]  docs    The documents to free.
+ */
+static void bench_docs_free(
+		const cyaml_config_t *config,
+		const struct bench_input *input,
+		struct bench_docs *docs)
+{
+	for (unsigned i = 0; i < docs->count; i++) {
+		cyaml_free(config, input->workload->schema,
+				docs->data[i], docs->seq_count[i]);
+	}
+	docs->count = 0;
+}
+
+/**
+ * Load an input's documents.
+ *
+ * \param[in]      config  The CYAML config.
+ * \param[in]      input   The input to load.
+ * \param[in]      file    Whether to load from the input's file.
+ * \param[in,out]  docs    Returns the loaded documents.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t bench_docs_load(
+		const cyaml_config_t *config,
+		const struct bench_input *input,
+		bool file,
+		struct bench_docs *docs)
+{
+	const cyaml_schema_value_t *schema = input->workload->schema;
+	cyaml_stream_t *stream;
+	cyaml_err_t err;
+
+	docs->count = 0;
+
+	if (!input->workload->stream) {
+		err = file ?
+			cyaml_load_file(input->path, config, schema,
+					&docs->data[0], &docs->seq_count[0]) :
+			cyaml_load_data((const uint8_t *)input->yaml.data,
+					input->yaml.len, config, schema,
+					&docs->data[0], &docs->seq_count[0]);
+		if (err == CYAML_OK) {
+			docs->count = 1;
+		}
+		return err;
+	}
+
+	err = file ?
+		cyaml_stream_open_file(input->path, config, schema, &stream) :
+		cyaml_stream_open_data((const uint8_t *)input->yaml.data,
+				input->yaml.len, config, schema, &stream);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	while (docs->count < input->docs) {
+		docs->seq_count[docs->count] = 0;
+		err = cyaml_stream_next(stream,
+				&docs->data[docs->count], NULL);
+		if (err != CYAML_OK) {
+			break;
+		}
+		docs->count++;
+	}
+	cyaml_stream_close(stream);
+
+	if (err == CYAML_OK && docs->count != input->docs) {
+		err = CYAML_ERR_STREAM_END;
+	}
+	if (err != CYAML_OK) {
+		bench_docs_free(config, input, docs);
+	}
+	return err;
+}
+
+/**
+ * Save a set of loaded documents, discarding the output.
+ *
+ * \param[in]  config  The CYAML config.
+ * \param[in]  input   The input the documents were loaded from.
+ * \param[in]  docs    The documents to save.
+ * \param[out] bytes   Returns the number of bytes of output.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t bench_docs_save(
+		const cyaml_config_t *config,
+		const struct bench_input *input,
+		const struct bench_docs *docs,
+		uint64_t *bytes)
+{
+	*bytes = 0;
+
+	for (unsigned i = 0; i < docs->count; i++) {
+		char *output;
+		size_t len;
+		cyaml_err_t err;
+
+		err = cyaml_save_data(&output, &len, config,
+				input->workload->schema,
+				docs->data[i], docs->seq_count[i]);
+		if (err != CYAML_OK) {
+			return err;
+		}
+		config->mem_fn(config->mem_ctx, output, 0);
+		*bytes += len;
+	}
+
+	return CYAML_OK;
+}
+
+/**
+ * Run one operation on an input, until enough time has passed.
+ *
+ * \param[in]  settings  The benchmark settings.
+ * \param[in]  input     The input to run the operation on.
+ * \param[in]  op        The operation to run.
+ * \param[out] result    Returns the results.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t bench_run_op(
+		const struct bench_settings *settings,
+		const struct bench_input *input,
+		enum bench_op op,
+		struct bench_result *result)
+{
+	struct bench_docs docs = { .count = 0 };
+	struct bench_mem mem = { 0 };
+	cyaml_config_t config = {
+		.log_level = CYAML_LOG_ERROR,
+		.log_fn = cyaml_log,
+		.mem_fn = bench_mem_fn,
+		.mem_ctx = &mem,
+		.flags = CYAML_CFG_DEFAULT,
+	};
+	cyaml_err_t err = CYAML_OK;
+	double wall_start;
+
+	memset(result, 0, sizeof(*result));
+	result->bytes = input->yaml.len;
+
+	docs.data = calloc(input->docs, sizeof(*docs.data));
+	docs.seq_count = calloc(input->docs, sizeof(*docs.seq_count));
+	if (docs.data == NULL || docs.seq_count == NULL) {
+		err = CYAML_ERR_OOM;
+		goto out;
+	}
+
+	/* Saving reuses one set of documents for every iteration. */
+	if (op == BENCH_OP_SAVE_DATA) {
+		err = bench_docs_load(&config, input, false, &docs);
+		if (err != CYAML_OK) {
+			goto out;
+		}
+	}
+
+	/* Limit the total time too, since iterations of some operations
+	 * include untimed set up, which can dwarf the timed part. */
+	wall_start = bench_now();
+	while (result->iterations < 3 ||
+	       (result->seconds < settings->min_seconds &&
+	        bench_now() - wall_start < settings->min_seconds * 10)) {
+		struct bench_mem before;
+		double start;
+
+		if (op == BENCH_OP_FREE) {
+			err = bench_docs_load(&config, input, false, &docs);
+			if (err != CYAML_OK) {
+				goto out;
+			}
+		}
+
+		before = mem;
+		start = bench_now();
+		switch (op) {
+		case BENCH_OP_LOAD_DATA: /* Fall through. */
+		case BENCH_OP_LOAD_FILE:
+			err = bench_docs_load(&config, input,
+					op == BENCH_OP_LOAD_FILE, &docs);
+			break;
+		case BENCH_OP_SAVE_DATA:
+			err = bench_docs_save(&config, input, &docs,
+					&result->bytes);
+			break;
+		case BENCH_OP_FREE:
+			bench_docs_free(&config, input, &docs);
+			break;
+		default:
+			err = CYAML_ERR_INTERNAL_ERROR;
+			break;
+		}
+		result->seconds += bench_now() - start;
+		result->mem.allocs += mem.allocs - before.allocs;
+		result->mem.frees += mem.frees - before.frees;
+		result->iterations++;
+
+		if (err != CYAML_OK) {
+			goto out;
+		}
+
+		if (op != BENCH_OP_SAVE_DATA) {
+			bench_docs_free(&config, input, &docs);
+		}
+	}
+
+out:
+	bench_docs_free(&config, input, &docs);
+	free(docs.seq_count);
+	free(docs.data);
+	return err;
+}
+
+/**
+ * Report one operation's results.
+ *
+ * \param[in]  settings  The benchmark settings.
+ * \param[in]  input     The input the operation was run on.
+ * \param[in]  op        The operation.
+ * \param[in]  result    The operation's results.
+ */
+static void bench_report(
+		const struct bench_settings *settings,
+		const struct bench_input *input,
+		enum bench_op op,
+		const struct bench_result *result)
+{
+	double docs = (double)input->docs * result->iterations;
+	double mb_s = result->bytes * result->iterations /
+			result->seconds / 1e6;
+	double docs_s = docs / result->seconds;
+	double allocs = result->mem.allocs / docs;
+	double frees = result->mem.frees / docs;
+
+	if (settings->machine) {
+		printf("{\"workload\":\"%s\",\"op\":\"%s\","
+				"\"bytes\":%"PRIu64",\"docs\":%u,"
+				"\"iterations\":%"PRIu64",\"seconds\":%.6f,"
+				"\"mb_per_s\":%.3f,\"docs_per_s\":%.3f,"
+				"\"allocs_per_doc\":%.3f,"
+				"\"frees_per_doc\":%.3f}\n",
+				input->workload->name, bench_op_names[op],
+				result->bytes, input->docs,
+				result->iterations, result->seconds,
+				mb_s, docs_s, allocs, frees);
+	} else {
+		printf("%-8s %-10s %10.2f %12.1f %12.2f %12.2f\n",
+				input->workload->name, bench_op_names[op],
+				mb_s, docs_s, allocs, frees);
+	}
+}
+
+/**
+ * Generate a workload's input, writing it to a file too.
+ *
+ * \param[in]  settings  The benchmark settings.
+ * \param[in]  workload  The workload to generate input for.
+ * \param[in]  path      Path of temporary file to write the input to.
+ * \param[out] input     Returns the generated input.
+ * \return true on success, false otherwise.
+ */
+static bool bench_input_create(
+		const struct bench_settings *settings,
+		const bench_workload_t *workload,
+		const char *path,
+		struct bench_input *input)
+{
+	FILE *file;
+	size_t written;
+
+	memset(input, 0, sizeof(*input));
+	input->workload = workload;
+	input->path = path;
+	input->docs = workload->generate(&input->yaml, settings->scale);
+	if (input->docs == 0) {
+		return false;
+	}
+
+	file = fopen(path, "wb");
+	if (file == NULL) {
+		return false;
+	}
+	written = fwrite(input->yaml.data, 1, input->yaml.len, file);
+	if (fclose(file) != 0 || written != input->yaml.len) {
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Print program usage
+ *
+ * \param[in]  prog_name  Name of program.
+ */
+static void usage(const char *prog_name)
+{
+	fprintf(stderr, "Usage: %s [-m] [-s SCALE] [-t SECONDS] "
+			"[-w WORKLOAD]\n", prog_name);
+	fprintf(stderr, "\n");
+	fprintf(stderr, "  -m  Machine readable output (JSON lines)\n");
+	fprintf(stderr, "  -s  Workload size multiplier (default 1)\n");
+	fprintf(stderr, "  -t  Minimum time per operation (default 0.5)\n");
+	fprintf(stderr, "  -w  Only run the named workload\n");
+}
+
+/**
+ * Main entry point from OS.
+ *
+ * \param[in]  argc  Argument count.
+ * \param[in]  argv  Vector of string arguments.
+ * \return Program return code.
+ */
+int main(int argc, char *argv[])
+{
+	struct bench_settings settings = {
+		.scale = 1,
+		.min_seconds = 0.5,
+	};
+	char path[] = "/tmp/cyaml-bench-XXXXXX";
+	const bench_workload_t *workloads;
+	unsigned count;
+	bool ok = true;
+	int fd;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "ms:t:w:")) != -1) {
+		switch (opt) {
+		case 'm':
+			settings.machine = true;
+			break;
+		case 's':
+			settings.scale = (unsigned)strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			settings.min_seconds = strtod(optarg, NULL);
+			break;
+		case 'w':
+			settings.only = optarg;
+			break;
+		default:
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (optind != argc || settings.scale == 0) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	fd = mkstemp(path);
+	if (fd == -1) {
+		fprintf(stderr, "Failed to create temporary file\n");
+		return EXIT_FAILURE;
+	}
+	close(fd);
+
+	if (!settings.machine) {
+		printf("%-8s %-10s %10s %12s %12s %12s\n", "workload", "op",
+				"MB/s", "docs/s", "allocs/doc", "frees/doc");
+	}
+
+	workloads = bench_workloads(&count);
+	for (unsigned w = 0; w < count; w++) {
+		struct bench_input input;
+
+		if (settings.only != NULL &&
+		    strcmp(settings.only, workloads[w].name) != 0) {
+			continue;
+		}
+
+		if (!bench_input_create(&settings, &workloads[w],
+				path, &input)) {
+			fprintf(stderr, "%s: Failed to generate input\n",
+					workloads[w].name);
+			free(input.yaml.data);
+			ok = false;
+			continue;
+		}
+
+		for (unsigned op = 0; op < BENCH_OP__COUNT; op++) {
+			struct bench_result result;
+			cyaml_err_t err;
+
+			err = bench_run_op(&settings, &input, op, &result);
+			if (err != CYAML_OK) {
+				fprintf(stderr, "%s: %s: %s\n",
+						workloads[w].name,
+						bench_op_names[op],
+						cyaml_strerror(err));
+				ok = false;
+				continue;
+			}
+			bench_report(&settings, &input, op, &result);
+			fflush(stdout);
+		}
+
+		free(input.yaml.data);
+	}
+
+	unlink(path);
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,348 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (C) 2019 Michael Drake <tlsa@netsurf-browser.org>
+ */
+
+/**
+ * \file
+ * \brief CYAML benchmark workloads.
+ *
+ * Each workload generates synthetic input which stresses a different
+ * part of loading and saving.  Generated documents are deterministic, so
+ * results are comparable between runs.
+ */
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "bench.h"
+
+/* Exported function, documented in bench.h. */
+bool bench_buf_printf(
+		bench_buf_t *buf,
+		const char *fmt,
+		...)
+{
+	va_list args;
+	int len;
+
+	va_start(args, fmt);
+	len = vsnprintf(buf->data + buf->len, buf->max - buf->len, fmt, args);
+	va_end(args);
+
+	if (len < 0) {
+		return false;
+	}
+
+	if (buf->len + len >= buf->max) {
+		size_t max = (buf->max == 0) ? 4096 : buf->max;
+		char *temp;
+
+		while (buf->len + len >= max) {
+			max *= 2;
+		}
+		temp = realloc(buf->data, max);
+		if (temp == NULL) {
+			return false;
+		}
+		buf->data = temp;
+		buf->max = max;
+
+		va_start(args, fmt);
+		vsnprintf(buf->data + buf->len, buf->max - buf->len, fmt, args);
+		va_end(args);
+	}
+
+	buf->len += len;
+	return true;
+}
+
+/** Number of fields in each wide mapping. */
+#define BENCH_WIDE_FIELDS 64
+
+/** A record with many fields. */
+struct bench_wide {
+	int32_t v[BENCH_WIDE_FIELDS];
+};
+
+/** Keys for \ref bench_wide fields. */
+static char bench_wide_keys[BENCH_WIDE_FIELDS][8];
+
+/** Schema fields for \ref bench_wide, filled in at startup. */
+static cyaml_schema_field_t bench_wide_fields[BENCH_WIDE_FIELDS + 1];
+
+/** Schema for a \ref bench_wide sequence entry. */
+static const cyaml_schema_value_t bench_wide_entry = {
+	CYAML_VALUE_MAPPING(CYAML_FLAG_DEFAULT,
+			struct bench_wide, bench_wide_fields),
+};
+
+/** Schema for the wide mapping workload. */
+static const cyaml_schema_value_t bench_wide_schema = {
+	CYAML_VALUE_SEQUENCE(CYAML_FLAG_POINTER, struct bench_wide,
+			&bench_wide_entry, 0, CYAML_UNLIMITED),
+};
+
+/**
+ * Fill in the \ref bench_wide schema fields.
+ */
+static void bench_wide_init(void)
+{
+	for (unsigned i = 0; i < BENCH_WIDE_FIELDS; i++) {
+		snprintf(bench_wide_keys[i], sizeof(bench_wide_keys[i]),
+				"field%02u", i);
+		bench_wide_fields[i] = (cyaml_schema_field_t) {
+			.key = bench_wide_keys[i],
+			.data_offset = i * sizeof(int32_t),
+			.value = {
+				CYAML_VALUE_INT(CYAML_FLAG_DEFAULT, int32_t),
+			},
+		};
+	}
+}
+
+/** Generator for the wide mapping workload. */
+static unsigned bench_wide_generate(
+		bench_buf_t *buf,
+		unsigned scale)
+{
+	for (unsigned r = 0; r < 200 * scale; r++) {
+		for (unsigned i = 0; i < BENCH_WIDE_FIELDS; i++) {
+			/* Keys in reverse schema order, as a worst case. */
+			unsigned f = BENCH_WIDE_FIELDS - 1 - i;
+			if (!bench_buf_printf(buf, "%s%s: %u\n",
+					(i == 0) ? "- " : "  ",
+					bench_wide_keys[f], r * f)) {
+				return 0;
+			}
+		}
+	}
+
+	return 1;
+}
+
+/** Depth of each deeply nested chain. */
+#define BENCH_DEEP_DEPTH 256
+
+/** A node in a deeply nested chain. */
+struct bench_node {
+	int32_t value;
+	struct bench_node *next;
+};
+
+/* Declared ahead of its definition, since it refers to itself. */
+static const cyaml_schema_field_t bench_node_fields[3];
+
+/** Schema fields for \ref bench_node. */
+static const cyaml_schema_field_t bench_node_fields[3] = {
+	CYAML_FIELD_INT("value", CYAML_FLAG_DEFAULT,
+			struct bench_node, value),
+	CYAML_FIELD_MAPPING_PTR("next", CYAML_FLAG_OPTIONAL,
+			struct bench_node, next, bench_node_fields),
+	CYAML_FIELD_END
+};
+
+/** Schema for a \ref bench_node sequence entry. */
+static const cyaml_schema_value_t bench_deep_entry = {
+	CYAML_VALUE_MAPPING(CYAML_FLAG_DEFAULT,
+			struct bench_node, bench_node_fields),
+};
+
+/** Schema for the deep nesting workload. */
+static const cyaml_schema_value_t bench_deep_schema = {
+	CYAML_VALUE_SEQUENCE(CYAML_FLAG_POINTER, struct bench_node,
+			&bench_deep_entry, 0, CYAML_UNLIMITED),
+};
+
+/** Generator for the deep nesting workload. */
+static unsigned bench_deep_generate(
+		bench_buf_t *buf,
+		unsigned scale)
+{
+	for (unsigned c = 0; c < 20 * scale; c++) {
+		if (!bench_buf_printf(buf, "- ")) {
+			return 0;
+		}
+		for (unsigned d = 0; d < BENCH_DEEP_DEPTH; d++) {
+			if (!bench_buf_printf(buf, "{ value: %u%s",
+					c + d, (d + 1 < BENCH_DEEP_DEPTH) ?
+					", next: " : "")) {
+				return 0;
+			}
+		}
+		for (unsigned d = 0; d < BENCH_DEEP_DEPTH; d++) {
+			if (!bench_buf_printf(buf, " }")) {
+				return 0;
+			}
+		}
+		if (!bench_buf_printf(buf, "\n")) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/** Schema for a scalar sequence entry. */
+static const cyaml_schema_value_t bench_scalar_entry = {
+	CYAML_VALUE_INT(CYAML_FLAG_DEFAULT, int32_t),
+};
+
+/** Schema for the long scalar sequence workload. */
+static const cyaml_schema_value_t bench_scalar_schema = {
+	CYAML_VALUE_SEQUENCE(CYAML_FLAG_POINTER, int32_t,
+			&bench_scalar_entry, 0, CYAML_UNLIMITED),
+};
+
+/** Generator for the long scalar sequence workload. */
+static unsigned bench_scalar_generate(
+		bench_buf_t *buf,
+		unsigned scale)
+{
+	for (unsigned i = 0; i < 100000 * scale; i++) {
+		if (!bench_buf_printf(buf, "- %u\n", i * 2654435761u >> 8)) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/** A record with several string fields. */
+struct bench_person {
+	char *name;
+	char *email;
+	char *city;
+	char *note;
+};
+
+/** Schema fields for \ref bench_person. */
+static const cyaml_schema_field_t bench_person_fields[] = {
+	CYAML_FIELD_STRING_PTR("name", CYAML_FLAG_POINTER,
+			struct bench_person, name, 0, CYAML_UNLIMITED),
+	CYAML_FIELD_STRING_PTR("email", CYAML_FLAG_POINTER,
+			struct bench_person, email, 0, CYAML_UNLIMITED),
+	CYAML_FIELD_STRING_PTR("city", CYAML_FLAG_POINTER,
+			struct bench_person, city, 0, CYAML_UNLIMITED),
+	CYAML_FIELD_STRING_PTR("note", CYAML_FLAG_POINTER,
+			struct bench_person, note, 0, CYAML_UNLIMITED),
+	CYAML_FIELD_END
+};
+
+/** Schema for a \ref bench_person sequence entry. */
+static const cyaml_schema_value_t bench_person_entry = {
+	CYAML_VALUE_MAPPING(CYAML_FLAG_DEFAULT,
+			struct bench_person, bench_person_fields),
+};
+
+/** Schema for the string heavy workload. */
+static const cyaml_schema_value_t bench_strings_schema = {
+	CYAML_VALUE_SEQUENCE(CYAML_FLAG_POINTER, struct bench_person,
+			&bench_person_entry, 0, CYAML_UNLIMITED),
+};
+
+/** Cities for string heavy records; few, so they repeat. */
+static const char * const bench_cities[] = {
+	"Cambridge", "Edinburgh", "Manchester", "Bristol",
+	"Aberystwyth", "Llanfairpwllgwyngyll", "York", "Bath",
+};
+
+/** Generator for the string heavy workload. */
+static unsigned bench_strings_generate(
+		bench_buf_t *buf,
+		unsigned scale)
+{
+	for (unsigned i = 0; i < 2000 * scale; i++) {
+		if (!bench_buf_printf(buf,
+				"- name: Person Number %u\n"
+				"  email: person.%u@example.com\n"
+				"  city: %s\n"
+				"  note: \"Record %u has a note which is long "
+					"enough to need a few allocations "
+					"and some copying.\"\n",
+				i, i, bench_cities[i % 8], i)) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/** A small record, as found in log or message streams. */
+struct bench_msg {
+	uint32_t id;
+	char *topic;
+	int32_t *values;
+	unsigned values_count;
+};
+
+/** Schema for a \ref bench_msg value. */
+static const cyaml_schema_value_t bench_msg_value = {
+	CYAML_VALUE_INT(CYAML_FLAG_DEFAULT, int32_t),
+};
+
+/** Schema fields for \ref bench_msg. */
+static const cyaml_schema_field_t bench_msg_fields[] = {
+	CYAML_FIELD_UINT("id", CYAML_FLAG_DEFAULT, struct bench_msg, id),
+	CYAML_FIELD_STRING_PTR("topic", CYAML_FLAG_POINTER,
+			struct bench_msg, topic, 0, CYAML_UNLIMITED),
+	CYAML_FIELD_SEQUENCE("values", CYAML_FLAG_POINTER,
+			struct bench_msg, values,
+			&bench_msg_value, 0, CYAML_UNLIMITED),
+	CYAML_FIELD_END
+};
+
+/** Schema for each document of the stream workload. */
+static const cyaml_schema_value_t bench_stream_schema = {
+	CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+			struct bench_msg, bench_msg_fields),
+};
+
+/** Generator for the multi-document stream workload. */
+static unsigned bench_stream_generate(
+		bench_buf_t *buf,
+		unsigned scale)
+{
+	unsigned docs = 2000 * scale;
+
+	for (unsigned i = 0; i < docs; i++) {
+		if (!bench_buf_printf(buf,
+				"---\n"
+				"id: %u\n"
+				"topic: sensors/%u/temperature\n"
+				"values: [ %u, %u, %u, %u ]\n",
+				i, i % 16, i, i + 1, i * 3, i ^ 0x55)) {
+			return 0;
+		}
+	}
+
+	return docs;
+}
+
+/* Exported function, documented in bench.h. */
+const bench_workload_t * bench_workloads(
+		unsigned *count)
+{
+	static const bench_workload_t workloads[] = {
+		{ "wide",    &bench_wide_schema,    false,
+				bench_wide_generate },
+		{ "deep",    &bench_deep_schema,    false,
+				bench_deep_generate },
+		{ "scalars", &bench_scalar_schema,  false,
+				bench_scalar_generate },
+		{ "strings", &bench_strings_schema, false,
+				bench_strings_generate },
+		{ "stream",  &bench_stream_schema,  true,
+				bench_stream_generate },
+	};
+
+	if (bench_wide_fields[0].key == NULL) {
+		bench_wide_init();
+	}
+
+	*count = sizeof(workloads) / sizeof(*workloads);
+	return workloads;
+}
@@ -2365,6 +2365,100 @@ static bool test_err_load_schema_invalid_value_double_invalid(
 	return ttest_pass(&tc);
 }
 
+/**
+ * Test loading when schema expects int but value has trailing characters.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_err_load_schema_invalid_value_int_trailing(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char yaml[] =
+		"a: 12abc\n";
+	struct target_struct {
+		int a;
+	} *data_tgt = NULL;
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_INT("a", CYAML_FLAG_DEFAULT,
+				struct target_struct, a),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = config,
+		.schema = &top_schema,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_load_data(yaml, YAML_LEN(yaml), config, &top_schema,
+			(cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_ERR_INVALID_VALUE) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (data_tgt != NULL) {
+		return ttest_fail(&tc, "Data non-NULL on error.");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test loading when schema expects double but value has trailing characters.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_err_load_schema_invalid_value_double_trailing(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char yaml[] =
+		"a: 1.5e3x\n";
+	struct target_struct {
+		double a;
+	} *data_tgt = NULL;
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_FLOAT("a", CYAML_FLAG_DEFAULT,
+				struct target_struct, a),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = config,
+		.schema = &top_schema,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_load_data(yaml, YAML_LEN(yaml), config, &top_schema,
+			(cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_ERR_INVALID_VALUE) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (data_tgt != NULL) {
+		return ttest_fail(&tc, "Data non-NULL on error.");
+	}
+
+	return ttest_pass(&tc);
+}
+
 /**
  * Test loading when schema expects int but value is out of range.
  *
@@ -4086,6 +4180,91 @@ static bool test_err_load_alloc_oom_1(
 	return ttest_pass(&tc);
 }
 
+/**
+ * Test arena loading, with memory allocation failure at every possible point.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_err_load_alloc_oom_arena(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	cyaml_config_t cfg = *config;
+	static const unsigned char yaml[] =
+		"- kind: cat\n"
+		"  sound: meow\n"
+		"- kind: snake\n"
+		"  sound: hiss\n";
+	struct animal_s {
+		char *kind;
+		char *sound;
+	} *data_tgt = NULL;
+	static const struct cyaml_schema_field animal_schema[] = {
+		CYAML_FIELD_STRING_PTR("kind", CYAML_FLAG_POINTER,
+				struct animal_s, kind, 0, CYAML_UNLIMITED),
+		CYAML_FIELD_STRING_PTR("sound", CYAML_FLAG_POINTER,
+				struct animal_s, sound, 0, CYAML_UNLIMITED),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value animal_entry_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_DEFAULT, struct animal_s,
+				animal_schema),
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_SEQUENCE(CYAML_FLAG_POINTER, struct animal_s,
+				&animal_entry_schema, 0, CYAML_UNLIMITED),
+	};
+	unsigned count = 0;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.seq_count = &count,
+		.config = &cfg,
+		.schema = &top_schema,
+	};
+	cyaml_err_t err;
+	struct test_cyaml_mem_ctx mem_ctx = {
+		.required = 0,
+	};
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	cfg.flags |= CYAML_CFG_ARENA;
+	cfg.mem_fn = test_cyaml_mem_count_allocs;
+	cfg.mem_ctx = &mem_ctx;
+
+	err = cyaml_load_data(yaml, YAML_LEN(yaml), &cfg, &top_schema,
+			(cyaml_data_t **) &data_tgt, &count);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (mem_ctx.required == 0) {
+		return ttest_fail(&tc, "There were no allocations.");
+	}
+
+	cyaml_free(&cfg, &top_schema, data_tgt, count);
+	data_tgt = NULL;
+
+	cfg.mem_fn = test_cyaml_mem_fail;
+
+	for (mem_ctx.fail = 0; mem_ctx.fail < mem_ctx.required;
+			mem_ctx.fail++) {
+		mem_ctx.current = 0;
+		err = cyaml_load_data(yaml, YAML_LEN(yaml), &cfg, &top_schema,
+				(cyaml_data_t **) &data_tgt, &count);
+		if (err != CYAML_ERR_OOM) {
+			return ttest_fail(&tc, cyaml_strerror(err));
+		}
+
+		cyaml_free(&cfg, &top_schema, data_tgt, count);
+		data_tgt = NULL;
+	}
+
+	return ttest_pass(&tc);
+}
+
 /**
  * Test loading, with all memory allocation failure at every possible point.
  *
@@ -4338,7 +4517,9 @@ static bool test_err_save_alloc_oom_1(
 		mem_ctx.current = 0;
 		err = cyaml_save_data(&buffer, &len, &cfg, &top_schema,
 				data_tgt, 0);
-		if (err != CYAML_ERR_OOM) {
+		if (err == CYAML_OK && mem_ctx.fail == mem_ctx.required - 1) {
+			/* Failing to trim the final output buffer is fine. */
+		} else if (err != CYAML_ERR_OOM) {
 			return ttest_fail(&tc, cyaml_strerror(err));
 		}
 
@@ -4490,7 +4671,9 @@ static bool test_err_save_alloc_oom_2(
 		mem_ctx.current = 0;
 		err = cyaml_save_data(&buffer, &len, &cfg, &top_schema,
 				data_tgt, 0);
-		if (err != CYAML_ERR_OOM) {
+		if (err == CYAML_OK && mem_ctx.fail == mem_ctx.required - 1) {
+			/* Failing to trim the final output buffer is fine. */
+		} else if (err != CYAML_ERR_OOM) {
 			return ttest_fail(&tc, cyaml_strerror(err));
 		}
 
@@ -4618,6 +4801,150 @@ static bool test_err_load_mapping_value_alias(
 	return ttest_pass(&tc);
 }
 
+/**
+ * Test compiling bad schemas.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_err_schema_compile(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	struct target_struct {
+		char *str;
+		float f;
+		unsigned *seq;
+		uint32_t seq_count;
+		int i;
+	};
+	static const struct cyaml_schema_value entry_schema = {
+		CYAML_VALUE_UINT(CYAML_FLAG_DEFAULT, unsigned),
+	};
+	static const struct cyaml_schema_value seq_schema = {
+		CYAML_VALUE_SEQUENCE(CYAML_FLAG_DEFAULT, unsigned,
+				&entry_schema, 0, CYAML_UNLIMITED),
+	};
+	static const struct cyaml_schema_field string_min_max[] = {
+		CYAML_FIELD_STRING_PTR("str", CYAML_FLAG_POINTER,
+				struct target_struct, str, 10, 9),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_field float_size[] = {
+		{
+			.key = "f",
+			.value = {
+				.type = CYAML_FLOAT,
+				.flags = CYAML_FLAG_DEFAULT,
+				.data_size = 3,
+			},
+			.data_offset = offsetof(struct target_struct, f),
+		},
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_field int_size[] = {
+		{
+			.key = "i",
+			.value = {
+				.type = CYAML_INT,
+				.flags = CYAML_FLAG_DEFAULT,
+				.data_size = 9,
+			},
+			.data_offset = offsetof(struct target_struct, i),
+		},
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_field fixed_count[] = {
+		{
+			.key = "seq",
+			.value = {
+				.type = CYAML_SEQUENCE_FIXED,
+				.flags = CYAML_FLAG_POINTER,
+				.data_size = sizeof(unsigned),
+				.sequence = {
+					.entry = &entry_schema,
+					.min = 0,
+					.max = CYAML_UNLIMITED,
+				},
+			},
+			.data_offset = offsetof(struct target_struct, seq),
+		},
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_field seq_in_seq[] = {
+		CYAML_FIELD_SEQUENCE("seq", CYAML_FLAG_POINTER,
+				struct target_struct, seq,
+				&seq_schema, 0, CYAML_UNLIMITED),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_field bad_type[] = {
+		{
+			.key = "i",
+			.value = {
+				.type = CYAML__TYPE_COUNT,
+				.flags = CYAML_FLAG_DEFAULT,
+				.data_size = sizeof(int),
+			},
+			.data_offset = offsetof(struct target_struct, i),
+		},
+		CYAML_FIELD_END
+	};
+	static const struct test {
+		const struct cyaml_schema_field *fields;
+		cyaml_flag_e flags;
+		cyaml_err_t err;
+	} tests[] = {
+		{ string_min_max, CYAML_FLAG_POINTER,
+				CYAML_ERR_BAD_MIN_MAX_SCHEMA },
+		{ float_size,     CYAML_FLAG_POINTER,
+				CYAML_ERR_INVALID_DATA_SIZE },
+		{ int_size,       CYAML_FLAG_POINTER,
+				CYAML_ERR_INVALID_DATA_SIZE },
+		{ fixed_count,    CYAML_FLAG_POINTER,
+				CYAML_ERR_SEQUENCE_FIXED_COUNT },
+		{ seq_in_seq,     CYAML_FLAG_POINTER,
+				CYAML_ERR_SEQUENCE_IN_SEQUENCE },
+		{ bad_type,       CYAML_FLAG_POINTER,
+				CYAML_ERR_BAD_TYPE_IN_SCHEMA },
+		{ string_min_max, CYAML_FLAG_DEFAULT,
+				CYAML_ERR_TOP_LEVEL_NON_PTR },
+	};
+	cyaml_schema_compiled_t *compiled = NULL;
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, NULL, NULL);
+
+	for (unsigned i = 0; i < CYAML_ARRAY_LEN(tests); i++) {
+		const struct cyaml_schema_value top_schema = {
+			CYAML_VALUE_MAPPING(tests[i].flags,
+					struct target_struct,
+					tests[i].fields),
+		};
+
+		err = cyaml_schema_compile(config, &top_schema, &compiled);
+		if (err != tests[i].err) {
+			cyaml_schema_compiled_free(config, compiled);
+			return ttest_fail(&tc, "Test %u: %s", i,
+					cyaml_strerror(err));
+		}
+		if (compiled != NULL) {
+			return ttest_fail(&tc, "Test %u: compiled on error", i);
+		}
+	}
+
+	err = cyaml_schema_compile(NULL, &entry_schema, &compiled);
+	if (err != CYAML_ERR_BAD_PARAM_NULL_CONFIG) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+	err = cyaml_schema_compile(config, NULL, &compiled);
+	if (err != CYAML_ERR_BAD_PARAM_NULL_SCHEMA) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	return ttest_pass(&tc);
+}
+
 /**
  * Run the CYAML error unit tests.
  *
@@ -4687,6 +5014,7 @@ bool errs_tests(
 	pass &= test_err_load_schema_bad_data_size_float(rc, &config);
 	pass &= test_err_load_schema_sequence_in_sequence(rc, &config);
 	pass &= test_err_save_schema_sequence_in_sequence(rc, &config);
+	pass &= test_err_schema_compile(rc, &config);
 
 	ttest_heading(rc, "YAML / schema mismatch: bad values");
 
@@ -4709,6 +5037,8 @@ bool errs_tests(
 	pass &= test_err_load_schema_invalid_value_uint_range_5(rc, &config);
 	pass &= test_err_load_schema_invalid_value_float_invalid(rc, &config);
 	pass &= test_err_load_schema_invalid_value_double_invalid(rc, &config);
+	pass &= test_err_load_schema_invalid_value_int_trailing(rc, &config);
+	pass &= test_err_load_schema_invalid_value_double_trailing(rc, &config);
 
 	ttest_heading(rc, "YAML / schema mismatch: string lengths");
 
@@ -4749,6 +5079,7 @@ bool errs_tests(
 	pass &= test_err_free_null(rc, &config);
 	pass &= test_err_load_alloc_oom_1(rc, &config);
 	pass &= test_err_load_alloc_oom_2(rc, &config);
+	pass &= test_err_load_alloc_oom_arena(rc, &config);
 	pass &= test_err_save_alloc_oom_1(rc, &config);
 	pass &= test_err_save_alloc_oom_2(rc, &config);
 
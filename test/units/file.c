@@ -6,7 +6,9 @@
 
 #include <stdbool.h>
 #include <assert.h>
+#include <inttypes.h>
 #include <stdio.h>
+#include <string.h>
 
 #include <cyaml/cyaml.h>
 
@@ -339,6 +341,643 @@ static bool test_file_load_basic_invalid(
 	return ttest_pass(&tc);
 }
 
+/**
+ * Test loading the basic YAML file, with the file mapped into memory.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_file_load_basic_mmap(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	struct animal {
+		char *kind;
+		char **sounds;
+		unsigned sounds_count;
+	};
+	struct target_struct {
+		struct animal *animals;
+		unsigned animals_count;
+		char **cakes;
+		unsigned cakes_count;
+	} *data_tgt = NULL, *data_ref = NULL;
+	static const struct cyaml_schema_value sounds_entry_schema = {
+		CYAML_VALUE_STRING(CYAML_FLAG_POINTER, char, 0, CYAML_UNLIMITED),
+	};
+	static const struct cyaml_schema_field animal_mapping_schema[] = {
+		CYAML_FIELD_STRING_PTR("kind", CYAML_FLAG_POINTER,
+				struct animal, kind, 0, CYAML_UNLIMITED),
+		CYAML_FIELD_SEQUENCE("sounds", CYAML_FLAG_POINTER,
+				struct animal, sounds,
+				&sounds_entry_schema, 0, CYAML_UNLIMITED),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value animals_entry_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_DEFAULT,
+				struct animal, animal_mapping_schema),
+	};
+	static const struct cyaml_schema_value cakes_entry_schema = {
+		CYAML_VALUE_STRING(CYAML_FLAG_POINTER, char, 0, CYAML_UNLIMITED),
+	};
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_SEQUENCE("animals", CYAML_FLAG_POINTER,
+				struct target_struct, animals,
+				&animals_entry_schema, 0, CYAML_UNLIMITED),
+		CYAML_FIELD_SEQUENCE("cakes", CYAML_FLAG_POINTER,
+				struct target_struct, cakes,
+				&cakes_entry_schema, 0, CYAML_UNLIMITED),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	cyaml_config_t cfg = *config;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = config,
+		.schema = &top_schema,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_load_file("test/data/basic.yaml", config, &top_schema,
+			(cyaml_data_t **) &data_ref, NULL);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	cfg.flags |= CYAML_CFG_MMAP_INPUT;
+	err = cyaml_load_file("test/data/basic.yaml", &cfg, &top_schema,
+			(cyaml_data_t **) &data_tgt, NULL);
+	if (err == CYAML_OK && (
+			data_tgt->animals_count != data_ref->animals_count ||
+			data_tgt->cakes_count != data_ref->cakes_count)) {
+		err = CYAML_ERR_INVALID_VALUE;
+	}
+	cyaml_free(config, &top_schema, data_ref, 0);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test that memory mapped loading falls back to stdio for special files.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_file_load_mmap_special(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	int *data_tgt = NULL;
+	unsigned count = 1;
+	static const struct cyaml_schema_value entry_schema = {
+		CYAML_VALUE_INT(CYAML_FLAG_DEFAULT, int),
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_SEQUENCE(CYAML_FLAG_POINTER, int,
+				&entry_schema, 0, CYAML_UNLIMITED),
+	};
+	cyaml_config_t cfg = *config;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.seq_count = &count,
+		.config = config,
+		.schema = &top_schema,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	cfg.flags |= CYAML_CFG_MMAP_INPUT;
+	err = cyaml_load_file("/dev/null", &cfg, &top_schema,
+			(cyaml_data_t **) &data_tgt, &count);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (data_tgt != NULL || count != 0) {
+		return ttest_fail(&tc, "Unexpected data for empty input.");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test memory mapped loading of a non-existent file.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_file_load_mmap_bad_path(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	struct target_struct {
+		char *cakes;
+	} *data_tgt = NULL;
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	cyaml_config_t cfg = *config;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = config,
+		.schema = &top_schema,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	cfg.flags |= CYAML_CFG_MMAP_INPUT;
+	err = cyaml_load_file("/cyaml/path/shouldn't/exist.yaml",
+			&cfg, &top_schema, (cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_ERR_FILE_OPEN) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test loading a batch of files, including one that doesn't exist.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_file_load_batch(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	struct animal {
+		char *kind;
+		char **sounds;
+		unsigned sounds_count;
+	};
+	struct target_struct {
+		struct animal *animals;
+		unsigned animals_count;
+		char **cakes;
+		unsigned cakes_count;
+	};
+	static const struct cyaml_schema_value sounds_entry_schema = {
+		CYAML_VALUE_STRING(CYAML_FLAG_POINTER, char, 0, CYAML_UNLIMITED),
+	};
+	static const struct cyaml_schema_field animal_mapping_schema[] = {
+		CYAML_FIELD_STRING_PTR("kind", CYAML_FLAG_POINTER,
+				struct animal, kind, 0, CYAML_UNLIMITED),
+		CYAML_FIELD_SEQUENCE("sounds", CYAML_FLAG_POINTER,
+				struct animal, sounds,
+				&sounds_entry_schema, 0, CYAML_UNLIMITED),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value animals_entry_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_DEFAULT,
+				struct animal, animal_mapping_schema),
+	};
+	static const struct cyaml_schema_value cakes_entry_schema = {
+		CYAML_VALUE_STRING(CYAML_FLAG_POINTER, char, 0, CYAML_UNLIMITED),
+	};
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_SEQUENCE("animals", CYAML_FLAG_POINTER,
+				struct target_struct, animals,
+				&animals_entry_schema, 0, CYAML_UNLIMITED),
+		CYAML_FIELD_SEQUENCE("cakes", CYAML_FLAG_POINTER,
+				struct target_struct, cakes,
+				&cakes_entry_schema, 0, CYAML_UNLIMITED),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	cyaml_batch_item_t items[8] = { { 0 } };
+	test_data_t td = {
+		.config = config,
+		.schema = &top_schema,
+	};
+	cyaml_err_t err;
+	bool ok = true;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	for (unsigned i = 0; i < CYAML_ARRAY_LEN(items); i++) {
+		items[i].path = (i == 3) ?
+				"/cyaml/path/shouldn't/exist.yaml" :
+				"test/data/basic.yaml";
+	}
+
+	err = cyaml_load_batch(items, CYAML_ARRAY_LEN(items), 3,
+			config, &top_schema);
+
+	for (unsigned i = 0; i < CYAML_ARRAY_LEN(items); i++) {
+		const struct target_struct *data = items[i].data;
+
+		if (i == 3) {
+			if (items[i].err != CYAML_ERR_FILE_OPEN ||
+			    data != NULL) {
+				ok = false;
+			}
+		} else if (items[i].err != CYAML_OK || data == NULL ||
+				data->animals_count == 0) {
+			ok = false;
+		}
+		cyaml_free(config, &top_schema, items[i].data, 0);
+	}
+
+	if (err != CYAML_ERR_FILE_OPEN) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (!ok) {
+		return ttest_fail(&tc, "Incorrect item result.");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/** An animal, as loaded from the basic YAML file. */
+struct basic_animal {
+	char *kind;
+	char **sounds;
+	unsigned sounds_count;
+};
+
+/** Data loaded from the basic YAML file. */
+struct basic_data {
+	struct basic_animal *animals;
+	unsigned animals_count;
+	char **cakes;
+	unsigned cakes_count;
+};
+
+/** Schema for \ref basic_animal sounds. */
+static const struct cyaml_schema_value basic_sound_schema = {
+	CYAML_VALUE_STRING(CYAML_FLAG_POINTER, char, 0, CYAML_UNLIMITED),
+};
+
+/** Schema fields for \ref basic_animal. */
+static const struct cyaml_schema_field basic_animal_fields[] = {
+	CYAML_FIELD_STRING_PTR("kind", CYAML_FLAG_POINTER,
+			struct basic_animal, kind, 0, CYAML_UNLIMITED),
+	CYAML_FIELD_SEQUENCE("sounds", CYAML_FLAG_POINTER,
+			struct basic_animal, sounds,
+			&basic_sound_schema, 0, CYAML_UNLIMITED),
+	CYAML_FIELD_END
+};
+
+/** Schema for \ref basic_animal. */
+static const struct cyaml_schema_value basic_animal_schema = {
+	CYAML_VALUE_MAPPING(CYAML_FLAG_DEFAULT,
+			struct basic_animal, basic_animal_fields),
+};
+
+/** Schema for \ref basic_data cakes. */
+static const struct cyaml_schema_value basic_cake_schema = {
+	CYAML_VALUE_STRING(CYAML_FLAG_POINTER, char, 0, CYAML_UNLIMITED),
+};
+
+/** Schema fields for \ref basic_data. */
+static const struct cyaml_schema_field basic_fields[] = {
+	CYAML_FIELD_SEQUENCE("animals", CYAML_FLAG_POINTER,
+			struct basic_data, animals,
+			&basic_animal_schema, 0, CYAML_UNLIMITED),
+	CYAML_FIELD_SEQUENCE("cakes", CYAML_FLAG_POINTER,
+			struct basic_data, cakes,
+			&basic_cake_schema, 0, CYAML_UNLIMITED),
+	CYAML_FIELD_END
+};
+
+/** Schema for \ref basic_data. */
+static const struct cyaml_schema_value basic_schema = {
+	CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+			struct basic_data, basic_fields),
+};
+
+/**
+ * Check data matches the contents of the basic YAML file.
+ *
+ * \param[in]  data  The loaded data.
+ * \return true if the data is correct, false otherwise.
+ */
+static bool basic_data_check(
+		const struct basic_data *data)
+{
+	if (data == NULL ||
+	    data->animals_count != 3 ||
+	    data->cakes_count != 5 ||
+	    strcmp(data->animals[1].kind, "hippo") != 0 ||
+	    data->animals[1].sounds_count != 3 ||
+	    strcmp(data->animals[1].sounds[2], "roar") != 0 ||
+	    strcmp(data->animals[2].sounds[0], "hiss") != 0 ||
+	    strcmp(data->cakes[4], "yule log") != 0) {
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Save a snapshot of the basic YAML file.
+ *
+ * \param[in]  config  The CYAML config to use.
+ * \param[in]  path    Path to save the snapshot to.
+ * \param[in]  source  Source key to save the snapshot with.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t basic_snapshot_save(
+		const cyaml_config_t *config,
+		const char *path,
+		uint64_t source)
+{
+	struct basic_data *data = NULL;
+	cyaml_err_t err;
+
+	err = cyaml_load_file("test/data/basic.yaml", config, &basic_schema,
+			(cyaml_data_t **) &data, NULL);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	err = cyaml_snapshot_save(path, config, &basic_schema, data, 0, source);
+	cyaml_free(config, &basic_schema, data, 0);
+	return err;
+}
+
+/**
+ * Test saving and loading a snapshot.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_file_snapshot(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	struct basic_data *data_tgt = NULL;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = config,
+		.schema = &basic_schema,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = basic_snapshot_save(config, "build/basic.snapshot", 1);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	err = cyaml_snapshot_load("build/basic.snapshot", config,
+			&basic_schema, 1, (cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (!basic_data_check(data_tgt)) {
+		return ttest_fail(&tc, "Incorrect value");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test loading a snapshot into an arena.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_file_snapshot_arena(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	struct basic_data *data_tgt = NULL;
+	cyaml_stats_t stats = { .timing = false };
+	cyaml_config_t cfg = *config;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = &cfg,
+		.schema = &basic_schema,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = basic_snapshot_save(config, "build/basic.snapshot", 1);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	cfg.flags |= CYAML_CFG_ARENA;
+	cfg.stats = &stats;
+
+	err = cyaml_snapshot_load("build/basic.snapshot", &cfg,
+			&basic_schema, 1, (cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (!basic_data_check(data_tgt)) {
+		return ttest_fail(&tc, "Incorrect value");
+	}
+
+#ifdef CYAML_STATS
+	/* The arena's chunk, and the temporary table space. */
+	if (stats.mem_allocs != 2) {
+		return ttest_fail(&tc, "Unexpected allocations: %"PRIu64,
+				stats.mem_allocs);
+	}
+#endif
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test snapshots are rejected for a different source or schema.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_file_snapshot_stale(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	struct basic_data *data_tgt = NULL;
+	static const struct cyaml_schema_field cakes_fields[] = {
+		CYAML_FIELD_SEQUENCE("cakes", CYAML_FLAG_POINTER,
+				struct basic_data, cakes,
+				&basic_cake_schema, 0, CYAML_UNLIMITED),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value cakes_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct basic_data, cakes_fields),
+	};
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = config,
+		.schema = &basic_schema,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = basic_snapshot_save(config, "build/basic.snapshot", 1);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	err = cyaml_snapshot_load("build/basic.snapshot", config,
+			&basic_schema, 2, (cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_ERR_SNAPSHOT_STALE) {
+		return ttest_fail(&tc, "Wrong source: %s",
+				cyaml_strerror(err));
+	}
+
+	err = cyaml_snapshot_load("build/basic.snapshot", config,
+			&cakes_schema, 1, (cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_ERR_SNAPSHOT_STALE) {
+		return ttest_fail(&tc, "Wrong schema: %s",
+				cyaml_strerror(err));
+	}
+
+	if (data_tgt != NULL) {
+		return ttest_fail(&tc, "Data non-NULL on error");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test damaged snapshots are rejected.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_file_snapshot_invalid(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	struct basic_data *data_tgt = NULL;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = config,
+		.schema = &basic_schema,
+	};
+	cyaml_err_t err;
+	FILE *file;
+	long size;
+	int c;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = basic_snapshot_save(config, "build/basic.snapshot", 1);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	/* Damage a byte in the middle of the image. */
+	file = fopen("build/basic.snapshot", "r+b");
+	if (file == NULL || fseek(file, 0, SEEK_END) != 0 ||
+	    (size = ftell(file)) < 0 || fseek(file, size / 2, SEEK_SET) != 0 ||
+	    (c = fgetc(file)) == EOF || fseek(file, size / 2, SEEK_SET) != 0 ||
+	    fputc(c ^ 0x10, file) == EOF) {
+		if (file != NULL) {
+			fclose(file);
+		}
+		return ttest_fail(&tc, "Failed to modify snapshot");
+	}
+	fclose(file);
+
+	err = cyaml_snapshot_load("build/basic.snapshot", config,
+			&basic_schema, 1, (cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_ERR_SNAPSHOT_INVALID) {
+		return ttest_fail(&tc, "Damaged: %s", cyaml_strerror(err));
+	}
+
+	err = cyaml_snapshot_load("test/data/basic.yaml", config,
+			&basic_schema, 1, (cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_ERR_SNAPSHOT_INVALID) {
+		return ttest_fail(&tc, "Not a snapshot: %s",
+				cyaml_strerror(err));
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test loading a YAML file with a snapshot cache.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_file_load_cached(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	struct basic_data *data_tgt = NULL;
+	cyaml_stats_t stats = { .timing = false };
+	cyaml_config_t cfg = *config;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = &cfg,
+		.schema = &basic_schema,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	remove("build/cached.snapshot");
+	cfg.stats = &stats;
+
+	for (unsigned i = 0; i < 2; i++) {
+		memset(stats.events, 0, sizeof(stats.events));
+
+		err = cyaml_load_file_cached("test/data/basic.yaml",
+				"build/cached.snapshot", &cfg, &basic_schema,
+				(cyaml_data_t **) &data_tgt, NULL);
+		if (err != CYAML_OK) {
+			return ttest_fail(&tc, cyaml_strerror(err));
+		}
+
+		if (!basic_data_check(data_tgt)) {
+			return ttest_fail(&tc, "Incorrect value in load %u", i);
+		}
+
+		cyaml_free(&cfg, &basic_schema, data_tgt, 0);
+		data_tgt = NULL;
+	}
+
+#ifdef CYAML_STATS
+	/* The second load comes from the snapshot. */
+	if (stats.events[CYAML_STATS_EVT_SCALAR] != 0) {
+		return ttest_fail(&tc, "YAML parsed for cached load");
+	}
+#endif
+
+	return ttest_pass(&tc);
+}
+
 /**
  * Run the YAML file tests.
  *
@@ -364,6 +1003,11 @@ bool file_tests(
 
 	pass &= test_file_load_basic(rc, &config);
 	pass &= test_file_load_save_basic(rc, &config);
+	pass &= test_file_load_basic_mmap(rc, &config);
+	pass &= test_file_load_mmap_special(rc, &config);
+	pass &= test_file_snapshot(rc, &config);
+	pass &= test_file_snapshot_arena(rc, &config);
+	pass &= test_file_load_cached(rc, &config);
 
 	/* Since we expect loads of error logging for these tests,
 	 * suppress log output if required log level is greater
@@ -374,8 +1018,12 @@ bool file_tests(
 	}
 
 	pass &= test_file_load_bad_path(rc, &config);
+	pass &= test_file_load_mmap_bad_path(rc, &config);
 	pass &= test_file_save_bad_path(rc, &config);
 	pass &= test_file_load_basic_invalid(rc, &config);
+	pass &= test_file_load_batch(rc, &config);
+	pass &= test_file_snapshot_stale(rc, &config);
+	pass &= test_file_snapshot_invalid(rc, &config);
 
 	return pass;
 }
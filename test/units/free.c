@@ -7,6 +7,7 @@
 #include <stdbool.h>
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
 
 #include <cyaml/cyaml.h>
 
@@ -120,6 +121,618 @@ static bool test_free_null_schema(
 	return ttest_pass(&tc);
 }
 
+/** Memory allocation function context for counting frees. */
+struct test_free_count_ctx {
+	unsigned frees; /**< Number of allocations freed. */
+};
+
+/**
+ * Memory allocation function that counts frees.
+ *
+ * \param[in]  ctx   A \ref test_free_count_ctx.
+ * \param[in]  ptr   Pointer to existing allocation, or NULL.
+ * \param[in]  size  Size to allocate, or 0 to free.
+ * \return Pointer to new allocation, or NULL.
+ */
+static void * test_free_count_mem(
+		void *ctx,
+		void *ptr,
+		size_t size)
+{
+	struct test_free_count_ctx *count_ctx = ctx;
+
+	if (size == 0 && ptr != NULL) {
+		count_ctx->frees++;
+	}
+
+	return cyaml_mem(ctx, ptr, size);
+}
+
+/**
+ * Test that cyaml_free frees a sequence of plain data in one go.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_free_sequence_plain_data(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	enum { ENTRY_COUNT = 100000 };
+	struct entry {
+		int a;
+		char name[8];
+		int pos[3];
+	};
+	struct target_struct {
+		struct entry *entries;
+		unsigned entries_count;
+	} *data;
+	static const struct cyaml_schema_value pos_schema = {
+		CYAML_VALUE_INT(CYAML_FLAG_DEFAULT, int),
+	};
+	static const struct cyaml_schema_field entry_fields[] = {
+		CYAML_FIELD_INT("a", CYAML_FLAG_DEFAULT, struct entry, a),
+		CYAML_FIELD_STRING("name", CYAML_FLAG_DEFAULT,
+				struct entry, name, 0),
+		CYAML_FIELD_SEQUENCE_FIXED("pos", CYAML_FLAG_DEFAULT,
+				struct entry, pos, &pos_schema, 3),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value entry_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_DEFAULT,
+				struct entry, entry_fields),
+	};
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_SEQUENCE("entries", CYAML_FLAG_POINTER,
+				struct target_struct, entries,
+				&entry_schema, 0, CYAML_UNLIMITED),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	struct test_free_count_ctx count_ctx = { 0 };
+	cyaml_config_t cfg = *config;
+	cyaml_err_t err;
+	ttest_ctx_t tc = ttest_start(report, __func__, NULL, NULL);
+
+	cfg.mem_fn = test_free_count_mem;
+	cfg.mem_ctx = &count_ctx;
+
+	data = cyaml_mem(NULL, NULL, sizeof(*data));
+	data->entries = cyaml_mem(NULL, NULL,
+			sizeof(*data->entries) * ENTRY_COUNT);
+	data->entries_count = ENTRY_COUNT;
+	if (data->entries == NULL) {
+		cyaml_mem(NULL, data, 0);
+		return ttest_fail(&tc, "Allocation failed.");
+	}
+
+	err = cyaml_free(&cfg, &top_schema, data, 0);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, "Free failed: %s", cyaml_strerror(err));
+	}
+
+	if (count_ctx.frees != 2) {
+		return ttest_fail(&tc, "Unexpected free count: %u",
+				count_ctx.frees);
+	}
+
+	return ttest_pass(&tc);
+}
+
+/** Linked list node for \ref test_free_deep_list. */
+struct test_node {
+	int value;              /**< Node value. */
+	struct test_node *next; /**< Next node in list, or NULL. */
+};
+
+/* Declared ahead of its definition, since it refers to itself. */
+static const struct cyaml_schema_field test_node_fields[3];
+
+/** Schema fields for \ref test_node. */
+static const struct cyaml_schema_field test_node_fields[3] = {
+	CYAML_FIELD_INT("value", CYAML_FLAG_DEFAULT,
+			struct test_node, value),
+	CYAML_FIELD_MAPPING_PTR("next", CYAML_FLAG_OPTIONAL,
+			struct test_node, next, test_node_fields),
+	CYAML_FIELD_END
+};
+
+/**
+ * Test that cyaml_free handles data nested much deeper than its initial
+ * work stack.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_free_deep_list(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	enum { NODE_COUNT = 100000 };
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct test_node, test_node_fields),
+	};
+	struct test_free_count_ctx count_ctx = { 0 };
+	struct test_node *head = NULL;
+	cyaml_config_t cfg = *config;
+	cyaml_err_t err;
+	ttest_ctx_t tc = ttest_start(report, __func__, NULL, NULL);
+
+	cfg.mem_fn = test_free_count_mem;
+	cfg.mem_ctx = &count_ctx;
+
+	for (unsigned i = 0; i < NODE_COUNT; i++) {
+		struct test_node *node = cyaml_mem(NULL, NULL, sizeof(*node));
+		if (node == NULL) {
+			cyaml_free(config, &top_schema, head, 0);
+			return ttest_fail(&tc, "Allocation failed.");
+		}
+		node->value = (int)i;
+		node->next = head;
+		head = node;
+	}
+
+	err = cyaml_free(&cfg, &top_schema, head, 0);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, "Free failed: %s", cyaml_strerror(err));
+	}
+
+	/* The nodes, and the work stack's heap allocation. */
+	if (count_ctx.frees != NODE_COUNT + 1) {
+		return ttest_fail(&tc, "Unexpected free count: %u",
+				count_ctx.frees);
+	}
+
+	return ttest_pass(&tc);
+}
+
+/** Sequence entry for the copy tests. */
+struct test_copy_entry {
+	char *name; /**< Entry name. */
+	int pos[3]; /**< Entry position. */
+};
+
+/** Top level data for the copy tests. */
+struct test_copy_data {
+	char *title;                     /**< Document title. */
+	char tag[8];                     /**< Inline string. */
+	struct test_copy_entry *entries; /**< Sequence of entries. */
+	unsigned entries_count;          /**< Number of entries. */
+	int *opt;                        /**< Optional value, or NULL. */
+};
+
+/** Schema for the position of a \ref test_copy_entry. */
+static const struct cyaml_schema_value test_copy_pos_schema = {
+	CYAML_VALUE_INT(CYAML_FLAG_DEFAULT, int),
+};
+
+/** Schema fields for \ref test_copy_entry. */
+static const struct cyaml_schema_field test_copy_entry_fields[] = {
+	CYAML_FIELD_STRING_PTR("name", CYAML_FLAG_POINTER,
+			struct test_copy_entry, name, 0, CYAML_UNLIMITED),
+	CYAML_FIELD_SEQUENCE_FIXED("pos", CYAML_FLAG_DEFAULT,
+			struct test_copy_entry, pos,
+			&test_copy_pos_schema, 3),
+	CYAML_FIELD_END
+};
+
+/** Schema for \ref test_copy_entry. */
+static const struct cyaml_schema_value test_copy_entry_schema = {
+	CYAML_VALUE_MAPPING(CYAML_FLAG_DEFAULT,
+			struct test_copy_entry, test_copy_entry_fields),
+};
+
+/** Schema fields for \ref test_copy_data. */
+static const struct cyaml_schema_field test_copy_fields[] = {
+	CYAML_FIELD_STRING_PTR("title", CYAML_FLAG_POINTER,
+			struct test_copy_data, title, 0, CYAML_UNLIMITED),
+	CYAML_FIELD_STRING("tag", CYAML_FLAG_DEFAULT,
+			struct test_copy_data, tag, 0),
+	CYAML_FIELD_SEQUENCE("entries", CYAML_FLAG_POINTER,
+			struct test_copy_data, entries,
+			&test_copy_entry_schema, 0, CYAML_UNLIMITED),
+	CYAML_FIELD_INT_PTR("opt", CYAML_FLAG_POINTER | CYAML_FLAG_OPTIONAL,
+			struct test_copy_data, opt),
+	CYAML_FIELD_END
+};
+
+/** Top level schema for \ref test_copy_data. */
+static const struct cyaml_schema_value test_copy_schema = {
+	CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+			struct test_copy_data, test_copy_fields),
+};
+
+/** Input document for the copy tests. */
+static const char test_copy_yaml[] =
+	"title: Copy test\n"
+	"tag: abc\n"
+	"entries:\n"
+	"  - { name: first, pos: [1, 2, 3] }\n"
+	"  - { name: second, pos: [4, 5, 6] }\n"
+	"  - { name: third, pos: [7, 8, 9] }\n"
+	"opt: 42\n";
+
+/** Test cleanup data for the copy tests. */
+struct test_copy_cleanup_data {
+	const cyaml_config_t *config;       /**< Config to free data with. */
+	const cyaml_config_t *copy_config;  /**< Config to free copy with. */
+	const struct cyaml_schema_value *schema; /**< The data's schema. */
+	cyaml_data_t *data; /**< Source data, or NULL. */
+	cyaml_data_t *copy; /**< Copied data, or NULL. */
+};
+
+/**
+ * Cleanup function for the copy tests.
+ *
+ * \param[in]  data  A \ref test_copy_cleanup_data.
+ */
+static void test_copy_cleanup(
+		void *data)
+{
+	struct test_copy_cleanup_data *td = data;
+
+	cyaml_free(td->config, td->schema, td->data, 0);
+	cyaml_free(td->copy_config, td->schema, td->copy, 0);
+}
+
+/**
+ * Test cyaml_copy and cyaml_equal with loaded data.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_copy_deep(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	struct test_copy_cleanup_data td = {
+		.config = config,
+		.copy_config = config,
+		.schema = &test_copy_schema,
+	};
+	struct test_copy_data *data;
+	struct test_copy_data *copy;
+	bool equal = false;
+	cyaml_err_t err;
+	ttest_ctx_t tc = ttest_start(report, __func__, test_copy_cleanup, &td);
+
+	err = cyaml_load_data((const uint8_t *)test_copy_yaml,
+			sizeof(test_copy_yaml) - 1, config,
+			&test_copy_schema, &td.data, NULL);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, "Load failed: %s", cyaml_strerror(err));
+	}
+	data = td.data;
+
+	err = cyaml_copy(config, &test_copy_schema, data, 0, &td.copy);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, "Copy failed: %s", cyaml_strerror(err));
+	}
+	copy = td.copy;
+
+	if (copy == data || copy->title == data->title ||
+	    copy->entries == data->entries || copy->opt == data->opt ||
+	    copy->entries[2].name == data->entries[2].name) {
+		return ttest_fail(&tc, "Copy shares allocations with source.");
+	}
+
+	err = cyaml_equal(config, &test_copy_schema, data, 0, copy, 0, &equal);
+	if (err != CYAML_OK || !equal) {
+		return ttest_fail(&tc, "Copy not equal to source: %s",
+				cyaml_strerror(err));
+	}
+
+	copy->entries[2].name[0] = 'T';
+	err = cyaml_equal(config, &test_copy_schema, data, 0, copy, 0, &equal);
+	if (err != CYAML_OK || equal) {
+		return ttest_fail(&tc, "Changed string not found: %s",
+				cyaml_strerror(err));
+	}
+	copy->entries[2].name[0] = 't';
+
+	copy->entries[1].pos[2] = 0;
+	err = cyaml_equal(config, &test_copy_schema, data, 0, copy, 0, &equal);
+	if (err != CYAML_OK || equal) {
+		return ttest_fail(&tc, "Changed value not found: %s",
+				cyaml_strerror(err));
+	}
+	copy->entries[1].pos[2] = 6;
+
+	copy->entries_count--;
+	err = cyaml_equal(config, &test_copy_schema, data, 0, copy, 0, &equal);
+	copy->entries_count++;
+	if (err != CYAML_OK || equal) {
+		return ttest_fail(&tc, "Changed count not found: %s",
+				cyaml_strerror(err));
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test that cyaml_compact makes a single allocation, laid out depth-first.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_copy_compact(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	cyaml_config_t arena_cfg = *config;
+	struct test_copy_cleanup_data td = {
+		.config = config,
+		.copy_config = &arena_cfg,
+		.schema = &test_copy_schema,
+	};
+	struct test_copy_data *data;
+	struct test_copy_data *copy;
+	bool equal = false;
+	uintptr_t prev;
+	cyaml_err_t err;
+	ttest_ctx_t tc = ttest_start(report, __func__, test_copy_cleanup, &td);
+
+	arena_cfg.flags |= CYAML_CFG_ARENA;
+
+	err = cyaml_load_data((const uint8_t *)test_copy_yaml,
+			sizeof(test_copy_yaml) - 1, config,
+			&test_copy_schema, &td.data, NULL);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, "Load failed: %s", cyaml_strerror(err));
+	}
+	data = td.data;
+
+	err = cyaml_compact(config, &test_copy_schema, data, 0, &td.copy);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, "Compact failed: %s",
+				cyaml_strerror(err));
+	}
+	copy = td.copy;
+
+	/* Each allocation follows the one before it in the walk. */
+	prev = (uintptr_t)copy;
+	if ((uintptr_t)copy->title <= prev ||
+	    (uintptr_t)copy->entries <= (uintptr_t)copy->title) {
+		return ttest_fail(&tc, "Unexpected layout.");
+	}
+	prev = (uintptr_t)copy->entries;
+	for (unsigned i = 0; i < copy->entries_count; i++) {
+		if ((uintptr_t)copy->entries[i].name <= prev) {
+			return ttest_fail(&tc, "Unexpected layout.");
+		}
+		prev = (uintptr_t)copy->entries[i].name;
+	}
+	if ((uintptr_t)copy->opt <= prev) {
+		return ttest_fail(&tc, "Unexpected layout.");
+	}
+
+	err = cyaml_equal(config, &test_copy_schema, data, 0, copy, 0, &equal);
+	if (err != CYAML_OK || !equal) {
+		return ttest_fail(&tc, "Copy not equal to source: %s",
+				cyaml_strerror(err));
+	}
+
+	return ttest_pass(&tc);
+}
+
+/** Memory allocation function context for failing allocations. */
+struct test_copy_fail_ctx {
+	unsigned allocs; /**< Number of allocations left before failing. */
+};
+
+/**
+ * Memory allocation function that fails new allocations after a limit.
+ *
+ * \param[in]  ctx   A \ref test_copy_fail_ctx.
+ * \param[in]  ptr   Pointer to existing allocation, or NULL.
+ * \param[in]  size  Size to allocate, or 0 to free.
+ * \return Pointer to new allocation, or NULL.
+ */
+static void * test_copy_fail_mem(
+		void *ctx,
+		void *ptr,
+		size_t size)
+{
+	struct test_copy_fail_ctx *fail_ctx = ctx;
+
+	if (size != 0) {
+		if (fail_ctx->allocs == 0) {
+			return NULL;
+		}
+		fail_ctx->allocs--;
+	}
+
+	return cyaml_mem(ctx, ptr, size);
+}
+
+/**
+ * Test that cyaml_copy cleans up when allocations fail part way.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_copy_oom(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	struct test_copy_data *data = NULL;
+	struct test_copy_data *copy = NULL;
+	struct test_copy_fail_ctx fail_ctx;
+	cyaml_config_t cfg = *config;
+	unsigned limit = 0;
+	cyaml_err_t err;
+	ttest_ctx_t tc = ttest_start(report, __func__, NULL, NULL);
+
+	cfg.mem_fn = test_copy_fail_mem;
+	cfg.mem_ctx = &fail_ctx;
+
+	err = cyaml_load_data((const uint8_t *)test_copy_yaml,
+			sizeof(test_copy_yaml) - 1, config,
+			&test_copy_schema, (cyaml_data_t **)&data, NULL);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, "Load failed: %s", cyaml_strerror(err));
+	}
+
+	do {
+		fail_ctx.allocs = limit++;
+		err = cyaml_copy(&cfg, &test_copy_schema, data, 0,
+				(cyaml_data_t **)&copy);
+	} while (err == CYAML_ERR_OOM);
+
+	cyaml_free(config, &test_copy_schema, data, 0);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, "Copy failed: %s", cyaml_strerror(err));
+	}
+	cyaml_free(config, &test_copy_schema, copy, 0);
+
+	/* The top level value, title, entries, three names and opt. */
+	if (limit != 8) {
+		return ttest_fail(&tc, "Unexpected allocation count: %u",
+				limit - 1);
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test that cyaml_copy and cyaml_equal handle data nested much deeper than
+ * their initial work stacks.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_copy_deep_list(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	enum { NODE_COUNT = 100000 };
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct test_node, test_node_fields),
+	};
+	struct test_copy_cleanup_data td = {
+		.config = config,
+		.copy_config = config,
+		.schema = &top_schema,
+	};
+	struct test_node *head = NULL;
+	struct test_node *copy;
+	struct test_node *tail;
+	bool equal = false;
+	cyaml_err_t err;
+	ttest_ctx_t tc = ttest_start(report, __func__, test_copy_cleanup, &td);
+
+	for (unsigned i = 0; i < NODE_COUNT; i++) {
+		struct test_node *node = cyaml_mem(NULL, NULL, sizeof(*node));
+		if (node == NULL) {
+			return ttest_fail(&tc, "Allocation failed.");
+		}
+		node->value = (int)i;
+		node->next = head;
+		head = node;
+		td.data = head;
+	}
+
+	err = cyaml_copy(config, &top_schema, head, 0, &td.copy);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, "Copy failed: %s", cyaml_strerror(err));
+	}
+	copy = td.copy;
+
+	err = cyaml_equal(config, &top_schema, head, 0, copy, 0, &equal);
+	if (err != CYAML_OK || !equal) {
+		return ttest_fail(&tc, "Copy not equal to source: %s",
+				cyaml_strerror(err));
+	}
+
+	for (tail = copy; tail->next != NULL; tail = tail->next) {
+	}
+	tail->value = -1;
+	err = cyaml_equal(config, &top_schema, head, 0, copy, 0, &equal);
+	if (err != CYAML_OK || equal) {
+		return ttest_fail(&tc, "Changed value not found: %s",
+				cyaml_strerror(err));
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test that cyaml_equal ignores bytes after a string's terminating NUL.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_equal_inline_string(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	struct target_struct {
+		char name[8];
+		int x;
+	};
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_STRING("name", CYAML_FLAG_DEFAULT,
+				struct target_struct, name, 0),
+		CYAML_FIELD_INT("x", CYAML_FLAG_DEFAULT,
+				struct target_struct, x),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	struct target_struct a = { .name = "abcdef", .x = 1 };
+	struct target_struct b = { .name = "ab", .x = 1 };
+	cyaml_schema_compiled_t *compiled;
+	cyaml_config_t cfg = *config;
+	bool equal = false;
+	cyaml_err_t err;
+	ttest_ctx_t tc = ttest_start(report, __func__, NULL, NULL);
+
+	memcpy(a.name, "ab", 3);
+
+	err = cyaml_equal(config, &top_schema, &a, 0, &b, 0, &equal);
+	if (err != CYAML_OK || !equal) {
+		return ttest_fail(&tc, "Equal strings differ: %s",
+				cyaml_strerror(err));
+	}
+
+	err = cyaml_schema_compile(config, &top_schema, &compiled);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, "Compile failed: %s",
+				cyaml_strerror(err));
+	}
+	cfg.compiled = compiled;
+	err = cyaml_equal(&cfg, &top_schema, &a, 0, &b, 0, &equal);
+	cyaml_schema_compiled_free(config, compiled);
+	if (err != CYAML_OK || !equal) {
+		return ttest_fail(&tc, "Equal strings differ when compiled: %s",
+				cyaml_strerror(err));
+	}
+
+	b.name[1] = 'c';
+	err = cyaml_equal(config, &top_schema, &a, 0, &b, 0, &equal);
+	if (err != CYAML_OK || equal) {
+		return ttest_fail(&tc, "Changed string not found: %s",
+				cyaml_strerror(err));
+	}
+
+	return ttest_pass(&tc);
+}
+
 /**
  * Run the CYAML freeing unit tests.
  *
@@ -147,6 +760,16 @@ bool free_tests(
 	pass &= test_free_null_mem_fn(rc, &config);
 	pass &= test_free_null_config(rc, &config);
 	pass &= test_free_null_schema(rc, &config);
+	pass &= test_free_sequence_plain_data(rc, &config);
+	pass &= test_free_deep_list(rc, &config);
+
+	ttest_heading(rc, "Copy tests");
+
+	pass &= test_copy_deep(rc, &config);
+	pass &= test_copy_compact(rc, &config);
+	pass &= test_copy_oom(rc, &config);
+	pass &= test_copy_deep_list(rc, &config);
+	pass &= test_equal_inline_string(rc, &config);
 
 	return pass;
 }
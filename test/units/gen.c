@@ -0,0 +1,766 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (C) 2019 Michael Drake <tlsa@netsurf-browser.org>
+ */
+
+#include <stdbool.h>
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <cyaml/cyaml.h>
+#include <cyaml/gen.h>
+
+#include "../../src/gen.h"
+
+#include "ttest.h"
+
+#include "gen_schema.h"
+#include "gen_map.h"
+#include "gen_seq.h"
+
+/** Helper macro to count bytes of YAML input data. */
+#define YAML_LEN(_y) (sizeof(_y) - 1)
+
+/** Document using every field of \ref gen_test_map_schema. */
+static const unsigned char doc_yaml[] =
+	"i8: -128\n"
+	"i16: 32767\n"
+	"i32: -2147483648\n"
+	"i64: 9223372036854775807\n"
+	"u8: 255\n"
+	"u64: 18446744073709551615\n"
+	"flag: No\n"
+	"colour: blue\n"
+	"loose: 7\n"
+	"perms: [read, exec, 64]\n"
+	"strict-perms: [all]\n"
+	"f: 1.5\n"
+	"d: -0.25\n"
+	"name: Hello \"world\"\n"
+	"code: abcd\n"
+	"opt-num: 42\n"
+	"origin: { x: 1, y: -2 }\n"
+	"corner:\n"
+	"  x: 3\n"
+	"  y: 4\n"
+	"items:\n"
+	"  - name: first\n"
+	"    qty: 1\n"
+	"  - name: second\n"
+	"  - name: third\n"
+	"    qty: 3\n"
+	"fixed: [7, 8, 9]\n"
+	"tags: [a, bb, ccc]\n"
+	"inline-seq: [10, 20]\n"
+	"tree:\n"
+	"  value: 1\n"
+	"  next:\n"
+	"    value: 2\n"
+	"    next:\n"
+	"      value: 3\n"
+	"skip: { anything: [ goes, here ] }\n";
+
+/**
+ * Unit test context data.
+ */
+typedef struct test_data {
+	cyaml_data_t **data;
+	cyaml_data_t **gen_data;
+	char **buffer;
+	char **gen_buffer;
+	const struct cyaml_config *config;
+} test_data_t;
+
+/**
+ * Common clean up function to free data allocated by tests.
+ *
+ * \param[in]  data  The unit test context data.
+ */
+static void cyaml_cleanup(void *data)
+{
+	struct test_data *td = data;
+
+	if (td->data != NULL) {
+		cyaml_free(td->config, &gen_test_map_schema, *(td->data), 0);
+	}
+	if (td->gen_data != NULL) {
+		gen_map_free(td->config, *(td->gen_data));
+	}
+	if (td->buffer != NULL) {
+		td->config->mem_fn(td->config->mem_ctx, *(td->buffer), 0);
+	}
+	if (td->gen_buffer != NULL) {
+		td->config->mem_fn(td->config->mem_ctx, *(td->gen_buffer), 0);
+	}
+}
+
+/**
+ * Test generated loading gives the same data as the interpreter.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_gen_load_mapping(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	struct gen_test_doc *data = NULL;
+	struct gen_test_doc *gen_data = NULL;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data,
+		.gen_data = (cyaml_data_t **) &gen_data,
+		.config = config,
+	};
+	cyaml_err_t err;
+	bool equal;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_load_data(doc_yaml, YAML_LEN(doc_yaml), config,
+			&gen_test_map_schema, (cyaml_data_t **) &data, NULL);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	err = gen_map_load_data(doc_yaml, YAML_LEN(doc_yaml), config,
+			(cyaml_data_t **) &gen_data);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	err = cyaml_equal(config, &gen_test_map_schema, data, 0,
+			gen_data, 0, &equal);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+	if (!equal) {
+		return ttest_fail(&tc, "Generated data differs");
+	}
+
+	if (gen_data->i8 != -128 || gen_data->u64 != UINT64_MAX ||
+	    gen_data->flag != false || gen_data->colour != GEN_TEST_BLUE ||
+	    gen_data->loose != 7 || gen_data->perms != 69 ||
+	    gen_data->strict_perms != 7 || gen_data->d != -0.25 ||
+	    strcmp(gen_data->name, "Hello \"world\"") != 0 ||
+	    strcmp(gen_data->code, "abcd") != 0 ||
+	    *gen_data->opt_num != 42 || gen_data->origin.y != -2 ||
+	    gen_data->corner->x != 3 || gen_data->items_count != 3 ||
+	    gen_data->items[1].qty != 0 || gen_data->fixed[2] != 9 ||
+	    gen_data->tags_count != 3 || gen_data->inline_seq_count != 2 ||
+	    gen_data->tree->next->next->value != 3 ||
+	    gen_data->tree->next->next->next != NULL) {
+		return ttest_fail(&tc, "Unexpected value");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test generated loading with only the required fields present.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_gen_load_mapping_minimal(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char yaml[] =
+		"items: []\n"
+		"fixed: [1, 2, 3]\n"
+		"name: x\n"
+		"origin: { y: 0, x: 0 }\n"
+		"perms: []\n"
+		"i8: 0\ni16: 0\ni32: 0\ni64: 0\nu8: 0\nu64: 0\n"
+		"flag: yes\ncolour: rouge\nf: 0\nd: 0\n";
+	struct gen_test_doc *gen_data = NULL;
+	test_data_t td = {
+		.gen_data = (cyaml_data_t **) &gen_data,
+		.config = config,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = gen_map_load_data(yaml, YAML_LEN(yaml), config,
+			(cyaml_data_t **) &gen_data);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (gen_data->items != NULL || gen_data->items_count != 0 ||
+	    gen_data->tags != NULL || gen_data->corner != NULL ||
+	    gen_data->tree != NULL || gen_data->opt_num != NULL ||
+	    gen_data->colour != GEN_TEST_RED || gen_data->flag != true) {
+		return ttest_fail(&tc, "Unexpected value");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test generated loading gives the same errors as the interpreter.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_gen_load_errors(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const struct {
+		const char *yaml;
+		cyaml_err_t expected;
+	} tests[] = {
+		{ "i8: 128\n", CYAML_ERR_INVALID_VALUE },
+		{ "u8: -1\n", CYAML_ERR_INVALID_VALUE },
+		{ "i16: [1]\n", CYAML_ERR_INVALID_VALUE },
+		{ "colour: 5\n", CYAML_ERR_INVALID_VALUE },
+		{ "loose: 128\n", CYAML_ERR_INVALID_VALUE },
+		{ "perms: [read, bad]\n", CYAML_ERR_INVALID_VALUE },
+		{ "perms: [read, [exec]]\n", CYAML_ERR_UNEXPECTED_EVENT },
+		{ "strict-perms: [1]\n", CYAML_ERR_INVALID_VALUE },
+		{ "f: pi\n", CYAML_ERR_INVALID_VALUE },
+		{ "name: \"\"\n", CYAML_ERR_STRING_LENGTH_MIN },
+		{ "name: 01234567890123456\n", CYAML_ERR_STRING_LENGTH_MAX },
+		{ "code: abcde\n", CYAML_ERR_STRING_LENGTH_MAX },
+		{ "items: [{ name: a }, { qty: 1 }]\n",
+				CYAML_ERR_MAPPING_FIELD_MISSING },
+		{ "items: [{}, {}, {}, {}, {}, {}, {}, {}, {}]\n",
+				CYAML_ERR_MAPPING_FIELD_MISSING },
+		{ "items: [{ name: a }, { name: a }, { name: a },"
+		  " { name: a }, { name: a }, { name: a }, { name: a },"
+		  " { name: a }, { name: a }]\n",
+				CYAML_ERR_SEQUENCE_ENTRIES_MAX },
+		{ "fixed: [1, 2]\n", CYAML_ERR_SEQUENCE_ENTRIES_MIN },
+		{ "fixed: [1, 2, 3, 4]\n", CYAML_ERR_SEQUENCE_ENTRIES_MAX },
+		{ "tags: []\n", CYAML_ERR_SEQUENCE_ENTRIES_MIN },
+		{ "tags: [a, 123456789]\n", CYAML_ERR_STRING_LENGTH_MAX },
+		{ "inline-seq: [1, 2, 3, 4, 5]\n",
+				CYAML_ERR_SEQUENCE_ENTRIES_MAX },
+		{ "tree: { value: 1, next: { next: {} } }\n",
+				CYAML_ERR_MAPPING_FIELD_MISSING },
+		{ "unknown: 1\n", CYAML_ERR_INVALID_KEY },
+		{ "origin: 1\n", CYAML_ERR_INVALID_VALUE },
+		{ "[1, 2]\n", CYAML_ERR_INVALID_VALUE },
+		{ "i8: 1\n", CYAML_ERR_MAPPING_FIELD_MISSING },
+		{ "{\n", CYAML_ERR_LIBYAML_PARSER },
+		{ "tags: &a [x]\nname: *a\n", CYAML_ERR_ALIAS },
+	};
+	cyaml_data_t *data = NULL;
+	cyaml_data_t *gen_data = NULL;
+	test_data_t td = {
+		.data = &data,
+		.gen_data = &gen_data,
+		.config = config,
+	};
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	for (unsigned i = 0; i < CYAML_ARRAY_LEN(tests); i++) {
+		const uint8_t *yaml = (const uint8_t *)tests[i].yaml;
+		size_t len = strlen(tests[i].yaml);
+		cyaml_err_t gen_err;
+		cyaml_err_t err;
+
+		err = cyaml_load_data(yaml, len, config,
+				&gen_test_map_schema, &data, NULL);
+		gen_err = gen_map_load_data(yaml, len, config, &gen_data);
+		if (err != tests[i].expected || gen_err != err) {
+			return ttest_fail(&tc, "Bad errors for:\n%s\n"
+					"EXPECTED: %s\n"
+					"GOT: %s (interpreter), "
+					"%s (generated)\n", tests[i].yaml,
+					cyaml_strerror(tests[i].expected),
+					cyaml_strerror(err),
+					cyaml_strerror(gen_err));
+		}
+		if (data != NULL || gen_data != NULL) {
+			return ttest_fail(&tc, "Data returned on failure");
+		}
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test generated loading of ignored keys, repeated keys, and empty input.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_gen_load_keys(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char yaml[] =
+		"items: [{ name: a }]\n"
+		"fixed: [1, 2, 3]\n"
+		"name: first\n"
+		"origin: { y: 0, x: 0 }\n"
+		"perms: []\n"
+		"unknown: [1, { 2: 3 }]\n"
+		"i8: 0\ni16: 0\ni32: 0\ni64: 0\nu8: 0\nu64: 0\n"
+		"flag: yes\ncolour: red\nf: 0\nd: 0\n"
+		"items: [{ name: b }, { name: c }]\n"
+		"name: second\n";
+	cyaml_config_t cfg = *config;
+	struct gen_test_doc *gen_data = NULL;
+	test_data_t td = {
+		.gen_data = (cyaml_data_t **) &gen_data,
+		.config = &cfg,
+	};
+	cyaml_err_t err;
+
+	cfg.flags |= CYAML_CFG_IGNORE_UNKNOWN_KEYS;
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = gen_map_load_data((const uint8_t *)"", 0, &cfg,
+			(cyaml_data_t **) &gen_data);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+	if (gen_data != NULL) {
+		return ttest_fail(&tc, "Data loaded from empty input");
+	}
+
+	err = gen_map_load_data(yaml, YAML_LEN(yaml), &cfg,
+			(cyaml_data_t **) &gen_data);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (strcmp(gen_data->name, "second") != 0 ||
+	    gen_data->items_count != 2 ||
+	    strcmp(gen_data->items[1].name, "c") != 0) {
+		return ttest_fail(&tc, "Repeated key didn't replace value");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test generated saving gives the same output as the interpreter.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_gen_save_mapping(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const cyaml_cfg_flags_t flags[] = {
+		CYAML_CFG_DEFAULT,
+		CYAML_CFG_DOCUMENT_DELIM,
+		CYAML_CFG_STYLE_FLOW,
+		CYAML_CFG_STYLE_BLOCK,
+		CYAML_CFG_FAST_EMIT,
+	};
+	cyaml_config_t cfg = *config;
+	struct gen_test_doc *data = NULL;
+	char *buffer = NULL;
+	char *gen_buffer = NULL;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data,
+		.buffer = &buffer,
+		.gen_buffer = &gen_buffer,
+		.config = &cfg,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_load_data(doc_yaml, YAML_LEN(doc_yaml), &cfg,
+			&gen_test_map_schema, (cyaml_data_t **) &data, NULL);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	/* Negative enum values are read back unsigned, so strict saving
+	 * rejects them, with or without generated code. */
+	data->colour = GEN_TEST_RED;
+	for (unsigned i = 0; i < CYAML_ARRAY_LEN(flags); i++) {
+		size_t gen_len;
+		size_t len;
+
+		cfg.flags = flags[i];
+		err = cyaml_save_data(&buffer, &len, &cfg,
+				&gen_test_map_schema, data, 0);
+		if (err != CYAML_OK) {
+			return ttest_fail(&tc, cyaml_strerror(err));
+		}
+		err = gen_map_save_data(&gen_buffer, &gen_len, &cfg, data);
+		if (err != CYAML_OK) {
+			return ttest_fail(&tc, cyaml_strerror(err));
+		}
+
+		if (len != gen_len || memcmp(buffer, gen_buffer, len) != 0) {
+			return ttest_fail(&tc, "Bad data:\n"
+					"EXPECTED (%zu):\n\n%.*s\n\n"
+					"GOT (%zu):\n\n%.*s\n",
+					len, (int)len, buffer,
+					gen_len, (int)gen_len, gen_buffer);
+		}
+
+		cfg.mem_fn(cfg.mem_ctx, buffer, 0);
+		cfg.mem_fn(cfg.mem_ctx, gen_buffer, 0);
+		buffer = NULL;
+		gen_buffer = NULL;
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test generated saving gives the same errors as the interpreter.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_gen_save_errors(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	struct gen_test_doc *data = NULL;
+	char *gen_buffer = NULL;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data,
+		.gen_buffer = &gen_buffer,
+		.config = config,
+	};
+	size_t gen_len;
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_load_data(doc_yaml, YAML_LEN(doc_yaml), config,
+			&gen_test_map_schema, (cyaml_data_t **) &data, NULL);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	err = gen_map_save_data(&gen_buffer, &gen_len, config, NULL);
+	if (err != CYAML_ERR_BAD_PARAM_NULL_DATA) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	data->colour = 99;
+	err = gen_map_save_data(&gen_buffer, &gen_len, config, data);
+	if (err != CYAML_ERR_INVALID_VALUE || gen_buffer != NULL) {
+		return ttest_fail(&tc, "Invalid strict enum saved");
+	}
+
+	data->colour = GEN_TEST_GREEN;
+	data->strict_perms = 0x80;
+	err = gen_map_save_data(&gen_buffer, &gen_len, config, data);
+	if (err != CYAML_ERR_INVALID_VALUE || gen_buffer != NULL) {
+		return ttest_fail(&tc, "Invalid strict flags saved");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test generated code for a top level sequence.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_gen_sequence(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char yaml[] =
+		"- 1\n- -2\n- 3\n- 4\n- 5\n";
+	int32_t **data = NULL;
+	int32_t **gen_data = NULL;
+	char *buffer = NULL;
+	char *gen_buffer = NULL;
+	test_data_t td = {
+		.buffer = &buffer,
+		.gen_buffer = &gen_buffer,
+		.config = config,
+	};
+	unsigned gen_count = 0;
+	unsigned count = 0;
+	size_t gen_len;
+	size_t len;
+	cyaml_err_t err;
+	bool equal;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = gen_seq_load_data(yaml, YAML_LEN(yaml), config,
+			(cyaml_data_t **) &gen_data, NULL);
+	if (err != CYAML_ERR_BAD_PARAM_SEQ_COUNT) {
+		return ttest_fail(&tc, "Missing seq_count_out accepted");
+	}
+
+	err = cyaml_load_data(yaml, YAML_LEN(yaml), config,
+			&gen_test_seq_schema, (cyaml_data_t **) &data, &count);
+	if (err == CYAML_OK) {
+		err = gen_seq_load_data(yaml, YAML_LEN(yaml), config,
+				(cyaml_data_t **) &gen_data, &gen_count);
+	}
+	if (err == CYAML_OK) {
+		err = cyaml_equal(config, &gen_test_seq_schema,
+				data, count, gen_data, gen_count, &equal);
+	}
+	if (err == CYAML_OK && (!equal || gen_count != 5)) {
+		err = CYAML_ERR_INTERNAL_ERROR;
+	}
+	if (err == CYAML_OK) {
+		err = cyaml_save_data(&buffer, &len, config,
+				&gen_test_seq_schema, data, count);
+	}
+	if (err == CYAML_OK) {
+		err = gen_seq_save_data(&gen_buffer, &gen_len, config,
+				gen_data, gen_count);
+	}
+	if (err == CYAML_OK && (len != gen_len ||
+			memcmp(buffer, gen_buffer, len) != 0)) {
+		err = CYAML_ERR_INTERNAL_ERROR;
+	}
+	if (err == CYAML_OK && gen_seq_save_data(&gen_buffer, &gen_len,
+			config, gen_data, 0) != CYAML_ERR_BAD_PARAM_SEQ_COUNT) {
+		err = CYAML_ERR_INTERNAL_ERROR;
+	}
+
+	cyaml_free(config, &gen_test_seq_schema, data, count);
+	gen_seq_free(config, gen_data, gen_count);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test generated code hands unsupported configurations to the interpreter.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_gen_fallback(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	cyaml_config_t cfg = *config;
+	struct gen_test_doc *data = NULL;
+	struct gen_test_doc *gen_data = NULL;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data,
+		.gen_data = (cyaml_data_t **) &gen_data,
+		.config = &cfg,
+	};
+	cyaml_err_t err;
+	bool equal;
+
+	cfg.flags |= CYAML_CFG_ARENA;
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	if (cyaml_gen_check_config(&cfg, CYAML_GEN_OP_LOAD) !=
+			CYAML_ERR_NOT_SUPPORTED ||
+	    cyaml_gen_check_config(&cfg, CYAML_GEN_OP_SAVE) != CYAML_OK) {
+		return ttest_fail(&tc, "Unexpected configuration check");
+	}
+
+	err = cyaml_load_data(doc_yaml, YAML_LEN(doc_yaml), &cfg,
+			&gen_test_map_schema, (cyaml_data_t **) &data, NULL);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	err = gen_map_load_data(doc_yaml, YAML_LEN(doc_yaml), &cfg,
+			(cyaml_data_t **) &gen_data);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	err = cyaml_equal(&cfg, &gen_test_map_schema, data, 0,
+			gen_data, 0, &equal);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+	if (!equal) {
+		return ttest_fail(&tc, "Fallback data differs");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test generated code stores values with the interpreter's byte layout.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_gen_data_layout(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const uint8_t expected[] = {
+		0x08, 0x07, 0x06, 0x05, 0x04, 0x03, 0x02, 0x01,
+	};
+	uint8_t data[sizeof(expected)] = { 0 };
+	uint8_t ptr[sizeof(void *)];
+	test_data_t td = {
+		.config = config,
+	};
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	cyaml_gen_data_write(0x0102030405060708, sizeof(data), data);
+	if (memcmp(data, expected, sizeof(data)) != 0) {
+		return ttest_fail(&tc, "Unexpected byte order");
+	}
+	if (cyaml_gen_data_read(2, data) != 0x0708) {
+		return ttest_fail(&tc, "Unexpected value read");
+	}
+
+	cyaml_gen_data_write_pointer(expected, ptr);
+	if (cyaml_gen_data_read_pointer(ptr) != expected) {
+		return ttest_fail(&tc, "Unexpected pointer read");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test code generation rejects unsuitable schemas and parameters.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_gen_write_errors(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const cyaml_schema_field_t fields[] = {
+		CYAML_FIELD_INT("a", CYAML_FLAG_DEFAULT,
+				struct gen_test_point, x),
+		CYAML_FIELD_END
+	};
+	static const cyaml_schema_value_t non_ptr = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_DEFAULT,
+				struct gen_test_point, fields),
+	};
+	static const cyaml_schema_value_t caseless = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER |
+				CYAML_FLAG_CASE_INSENSITIVE,
+				struct gen_test_point, fields),
+	};
+	static const cyaml_schema_value_t odd_size = {
+		.type = CYAML_INT,
+		.flags = CYAML_FLAG_POINTER,
+		.data_size = 3,
+	};
+	static const struct {
+		const cyaml_schema_value_t *schema;
+		const char *prefix;
+		cyaml_err_t expected;
+	} tests[] = {
+		{ &gen_test_map_schema, "ok", CYAML_OK },
+		{ &gen_test_map_schema, "1bad",
+				CYAML_ERR_BAD_PARAM_NULL_DATA },
+		{ &gen_test_map_schema, "b-a-d",
+				CYAML_ERR_BAD_PARAM_NULL_DATA },
+		{ NULL, "ok", CYAML_ERR_BAD_PARAM_NULL_SCHEMA },
+		{ &non_ptr, "ok", CYAML_ERR_TOP_LEVEL_NON_PTR },
+		{ &caseless, "ok", CYAML_ERR_NOT_SUPPORTED },
+		{ &odd_size, "ok", CYAML_ERR_NOT_SUPPORTED },
+	};
+	test_data_t td = {
+		.config = config,
+	};
+	FILE *source;
+	FILE *header;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	source = tmpfile();
+	header = tmpfile();
+	if (source == NULL || header == NULL) {
+		if (source != NULL) {
+			fclose(source);
+		}
+		if (header != NULL) {
+			fclose(header);
+		}
+		return ttest_fail(&tc, "Failed to open temporary files");
+	}
+
+	for (unsigned i = 0; i < CYAML_ARRAY_LEN(tests); i++) {
+		cyaml_gen_options_t options = {
+			.prefix = tests[i].prefix,
+		};
+		cyaml_err_t err;
+
+		err = cyaml_gen_write(source, header, config,
+				tests[i].schema, &options);
+		if (err != tests[i].expected) {
+			fclose(source);
+			fclose(header);
+			return ttest_fail(&tc, cyaml_strerror(err));
+		}
+	}
+
+	fclose(source);
+	fclose(header);
+	return ttest_pass(&tc);
+}
+
+/**
+ * Run the CYAML code generation unit tests.
+ *
+ * \param[in]  rc         The ttest report context.
+ * \param[in]  log_level  CYAML log level.
+ * \param[in]  log_fn     CYAML logging function, or NULL.
+ * \return true iff all unit tests pass, otherwise false.
+ */
+bool gen_tests(
+		ttest_report_ctx_t *rc,
+		cyaml_log_t log_level,
+		cyaml_log_fn_t log_fn)
+{
+	bool pass = true;
+	cyaml_config_t config = {
+		.log_fn = log_fn,
+		.mem_fn = cyaml_mem,
+		.log_level = log_level,
+		.flags = CYAML_CFG_DEFAULT,
+	};
+
+	ttest_heading(rc, "Code generation tests: loading");
+
+	pass &= test_gen_load_mapping(rc, &config);
+	pass &= test_gen_load_mapping_minimal(rc, &config);
+	pass &= test_gen_load_errors(rc, &config);
+	pass &= test_gen_load_keys(rc, &config);
+
+	ttest_heading(rc, "Code generation tests: saving");
+
+	pass &= test_gen_save_mapping(rc, &config);
+	pass &= test_gen_save_errors(rc, &config);
+
+	ttest_heading(rc, "Code generation tests: other");
+
+	pass &= test_gen_sequence(rc, &config);
+	pass &= test_gen_fallback(rc, &config);
+	pass &= test_gen_data_layout(rc, &config);
+	pass &= test_gen_write_errors(rc, &config);
+
+	return pass;
+}
@@ -0,0 +1,133 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (C) 2019 Michael Drake <tlsa@netsurf-browser.org>
+ */
+
+#include <cyaml/cyaml.h>
+
+#include "gen_schema.h"
+
+static const cyaml_strval_t colour_strings[] = {
+	{ "red",   GEN_TEST_RED },
+	{ "green", GEN_TEST_GREEN },
+	{ "blue",  GEN_TEST_BLUE },
+	{ "rouge", GEN_TEST_RED },
+};
+
+static const cyaml_strval_t perm_strings[] = {
+	{ "read",  GEN_TEST_READ },
+	{ "write", GEN_TEST_WRITE },
+	{ "exec",  GEN_TEST_EXEC },
+	{ "all",   GEN_TEST_READ | GEN_TEST_WRITE | GEN_TEST_EXEC },
+};
+
+static const cyaml_schema_field_t point_fields[] = {
+	CYAML_FIELD_INT("x", CYAML_FLAG_DEFAULT, struct gen_test_point, x),
+	CYAML_FIELD_INT("y", CYAML_FLAG_DEFAULT, struct gen_test_point, y),
+	CYAML_FIELD_END
+};
+
+static const cyaml_schema_field_t item_fields[] = {
+	CYAML_FIELD_STRING_PTR("name", CYAML_FLAG_POINTER,
+			struct gen_test_item, name, 0, CYAML_UNLIMITED),
+	CYAML_FIELD_UINT("qty", CYAML_FLAG_OPTIONAL,
+			struct gen_test_item, qty),
+	CYAML_FIELD_END
+};
+
+static const cyaml_schema_value_t item_schema = {
+	CYAML_VALUE_MAPPING(CYAML_FLAG_DEFAULT,
+			struct gen_test_item, item_fields),
+};
+
+static const cyaml_schema_value_t int16_schema = {
+	CYAML_VALUE_INT(CYAML_FLAG_DEFAULT, int16_t),
+};
+
+static const cyaml_schema_value_t uint32_schema = {
+	CYAML_VALUE_UINT(CYAML_FLAG_DEFAULT, uint32_t),
+};
+
+static const cyaml_schema_value_t tag_schema = {
+	CYAML_VALUE_STRING(CYAML_FLAG_POINTER, char, 1, 8),
+};
+
+static const cyaml_schema_field_t node_fields[3];
+
+static const cyaml_schema_field_t node_fields[] = {
+	CYAML_FIELD_INT("value", CYAML_FLAG_DEFAULT,
+			struct gen_test_node, value),
+	CYAML_FIELD_MAPPING_PTR("next",
+			CYAML_FLAG_POINTER | CYAML_FLAG_OPTIONAL,
+			struct gen_test_node, next, node_fields),
+	CYAML_FIELD_END
+};
+
+static const cyaml_schema_field_t doc_fields[] = {
+	CYAML_FIELD_INT("i8", CYAML_FLAG_DEFAULT, struct gen_test_doc, i8),
+	CYAML_FIELD_INT("i16", CYAML_FLAG_DEFAULT, struct gen_test_doc, i16),
+	CYAML_FIELD_INT("i32", CYAML_FLAG_DEFAULT, struct gen_test_doc, i32),
+	CYAML_FIELD_INT("i64", CYAML_FLAG_DEFAULT, struct gen_test_doc, i64),
+	CYAML_FIELD_UINT("u8", CYAML_FLAG_DEFAULT, struct gen_test_doc, u8),
+	CYAML_FIELD_UINT("u64", CYAML_FLAG_DEFAULT, struct gen_test_doc, u64),
+	CYAML_FIELD_BOOL("flag", CYAML_FLAG_DEFAULT,
+			struct gen_test_doc, flag),
+	CYAML_FIELD_ENUM("colour", CYAML_FLAG_STRICT,
+			struct gen_test_doc, colour, colour_strings,
+			CYAML_ARRAY_LEN(colour_strings)),
+	CYAML_FIELD_ENUM("loose", CYAML_FLAG_OPTIONAL,
+			struct gen_test_doc, loose, colour_strings,
+			CYAML_ARRAY_LEN(colour_strings)),
+	CYAML_FIELD_FLAGS("perms", CYAML_FLAG_FLOW,
+			struct gen_test_doc, perms, perm_strings,
+			CYAML_ARRAY_LEN(perm_strings)),
+	CYAML_FIELD_FLAGS("strict-perms",
+			CYAML_FLAG_STRICT | CYAML_FLAG_OPTIONAL,
+			struct gen_test_doc, strict_perms, perm_strings,
+			CYAML_ARRAY_LEN(perm_strings)),
+	CYAML_FIELD_FLOAT("f", CYAML_FLAG_DEFAULT, struct gen_test_doc, f),
+	CYAML_FIELD_FLOAT("d", CYAML_FLAG_DEFAULT, struct gen_test_doc, d),
+	CYAML_FIELD_STRING_PTR("name", CYAML_FLAG_POINTER,
+			struct gen_test_doc, name, 1, 16),
+	CYAML_FIELD_STRING("code", CYAML_FLAG_OPTIONAL,
+			struct gen_test_doc, code, 0),
+	CYAML_FIELD_INT_PTR("opt-num",
+			CYAML_FLAG_POINTER | CYAML_FLAG_OPTIONAL,
+			struct gen_test_doc, opt_num),
+	CYAML_FIELD_MAPPING("origin", CYAML_FLAG_FLOW,
+			struct gen_test_doc, origin, point_fields),
+	CYAML_FIELD_MAPPING_PTR("corner",
+			CYAML_FLAG_POINTER | CYAML_FLAG_OPTIONAL,
+			struct gen_test_doc, corner, point_fields),
+	CYAML_FIELD_SEQUENCE("items", CYAML_FLAG_POINTER,
+			struct gen_test_doc, items, &item_schema, 0, 8),
+	CYAML_FIELD_SEQUENCE_FIXED("fixed", CYAML_FLAG_FLOW,
+			struct gen_test_doc, fixed, &int16_schema, 3),
+	CYAML_FIELD_SEQUENCE("tags", CYAML_FLAG_POINTER | CYAML_FLAG_OPTIONAL,
+			struct gen_test_doc, tags, &tag_schema,
+			1, CYAML_UNLIMITED),
+	CYAML_FIELD_SEQUENCE("inline-seq", CYAML_FLAG_OPTIONAL,
+			struct gen_test_doc, inline_seq, &uint32_schema, 0, 4),
+	CYAML_FIELD_MAPPING_PTR("tree",
+			CYAML_FLAG_POINTER | CYAML_FLAG_OPTIONAL,
+			struct gen_test_doc, tree, node_fields),
+	CYAML_FIELD_IGNORE("skip", CYAML_FLAG_OPTIONAL),
+	CYAML_FIELD_END
+};
+
+/* Exported schema, documented in gen_schema.h */
+const cyaml_schema_value_t gen_test_map_schema = {
+	CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+			struct gen_test_doc, doc_fields),
+};
+
+static const cyaml_schema_value_t int32_ptr_schema = {
+	CYAML_VALUE_INT(CYAML_FLAG_POINTER, int32_t),
+};
+
+/* Exported schema, documented in gen_schema.h */
+const cyaml_schema_value_t gen_test_seq_schema = {
+	CYAML_VALUE_SEQUENCE(CYAML_FLAG_POINTER, int32_t *,
+			&int32_ptr_schema, 1, CYAML_UNLIMITED),
+};
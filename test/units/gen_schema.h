@@ -0,0 +1,91 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (C) 2019 Michael Drake <tlsa@netsurf-browser.org>
+ */
+
+/**
+ * \file
+ * \brief Schemas for the code generation tests.
+ *
+ * Code is generated from these at build time, and the tests compare the
+ * generated functions with the interpreter.
+ */
+
+#ifndef GEN_SCHEMA_H
+#define GEN_SCHEMA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <cyaml/cyaml.h>
+
+/** Enumeration for the code generation tests. */
+enum gen_test_colour {
+	GEN_TEST_RED,
+	GEN_TEST_GREEN = 5,
+	GEN_TEST_BLUE = -3,
+};
+
+/** Flags for the code generation tests. */
+enum gen_test_perm {
+	GEN_TEST_READ  = (1 << 0),
+	GEN_TEST_WRITE = (1 << 1),
+	GEN_TEST_EXEC  = (1 << 2),
+};
+
+/** Inline mapping for the code generation tests. */
+struct gen_test_point {
+	int16_t x;
+	int16_t y;
+};
+
+/** Sequence entry mapping for the code generation tests. */
+struct gen_test_item {
+	char *name;
+	uint32_t qty;
+};
+
+/** Recursive mapping for the code generation tests. */
+struct gen_test_node {
+	int32_t value;
+	struct gen_test_node *next;
+};
+
+/** Top level mapping for the code generation tests. */
+struct gen_test_doc {
+	int8_t i8;
+	int16_t i16;
+	int32_t i32;
+	int64_t i64;
+	uint8_t u8;
+	uint64_t u64;
+	bool flag;
+	enum gen_test_colour colour;
+	int8_t loose;
+	uint16_t perms;
+	uint8_t strict_perms;
+	float f;
+	double d;
+	char *name;
+	char code[5];
+	int *opt_num;
+	struct gen_test_point origin;
+	struct gen_test_point *corner;
+	struct gen_test_item *items;
+	uint8_t items_count;
+	int16_t fixed[3];
+	char **tags;
+	unsigned tags_count;
+	uint32_t inline_seq[4];
+	uint16_t inline_seq_count;
+	struct gen_test_node *tree;
+};
+
+/** Schema for a pointer to \ref gen_test_doc. */
+extern const cyaml_schema_value_t gen_test_map_schema;
+
+/** Schema for a sequence of pointers to int32_t. */
+extern const cyaml_schema_value_t gen_test_seq_schema;
+
+#endif
@@ -4,13 +4,19 @@
  * Copyright (C) 2017-2018 Michael Drake <tlsa@netsurf-browser.org>
  */
 
+#include <inttypes.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <assert.h>
 #include <string.h>
 #include <stdio.h>
 
 #include <cyaml/cyaml.h>
 
+#ifdef CYAML_ZLIB
+#include <zlib.h>
+#endif
+
 #include "../../src/data.h"
 #include "ttest.h"
 
@@ -537,6 +543,257 @@ static bool test_load_mapping_entry_double_ptr(
 	return ttest_pass(&tc);
 }
 
+/**
+ * Test loading doubles that need correct rounding.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_mapping_entry_double_precise(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char yaml[] =
+		"a: 0.30000000000000004\n"
+		"b: 5e-324\n"
+		"c: -1.5E+3\n"
+		"d: 179769313486231570814527423731704356798070e267\n";
+	struct target_struct {
+		double a;
+		double b;
+		double c;
+		double d;
+	} *data_tgt = NULL;
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_FLOAT("a", CYAML_FLAG_DEFAULT,
+				struct target_struct, a),
+		CYAML_FIELD_FLOAT("b", CYAML_FLAG_DEFAULT,
+				struct target_struct, b),
+		CYAML_FIELD_FLOAT("c", CYAML_FLAG_DEFAULT,
+				struct target_struct, c),
+		CYAML_FIELD_FLOAT("d", CYAML_FLAG_DEFAULT,
+				struct target_struct, d),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = config,
+		.schema = &top_schema,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_load_data(yaml, YAML_LEN(yaml), config, &top_schema,
+			(cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (data_tgt->a != 0.1 + 0.2 ||
+	    data_tgt->b != 5e-324 ||
+	    data_tgt->c != -1500.0 ||
+	    data_tgt->d != 1.7976931348623157e308) {
+		return ttest_fail(&tc, "Incorrect value: "
+				"got: %a, %a, %a, %a",
+				data_tgt->a, data_tgt->b,
+				data_tgt->c, data_tgt->d);
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test loading floats that would be rounded wrongly via double precision.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_mapping_entry_float_precise(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char yaml[] =
+		"a: 1.00000005960464477539062500000001\n"
+		"b: 1.000000059604644775390625\n"
+		"c: .inf\n";
+	struct target_struct {
+		float a;
+		float b;
+		float c;
+	} *data_tgt = NULL;
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_FLOAT("a", CYAML_FLAG_DEFAULT,
+				struct target_struct, a),
+		CYAML_FIELD_FLOAT("b", CYAML_FLAG_DEFAULT,
+				struct target_struct, b),
+		CYAML_FIELD_FLOAT("c", CYAML_FLAG_DEFAULT,
+				struct target_struct, c),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = config,
+		.schema = &top_schema,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_load_data(yaml, YAML_LEN(yaml), config, &top_schema,
+			(cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (data_tgt->a != 1.00000011920928955078125f ||
+	    data_tgt->b != 1.0f ||
+	    !(data_tgt->c > 3.4028235e38f)) {
+		return ttest_fail(&tc, "Incorrect value: "
+				"got: %a, %a, %a",
+				data_tgt->a, data_tgt->b, data_tgt->c);
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test loading unsigned integers at the limits of their types.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_mapping_entry_uint_limits(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char yaml[] =
+		"a: 18446744073709551615\n"
+		"b: 0xff\n"
+		"c: -0\n";
+	struct target_struct {
+		uint64_t a;
+		uint8_t b;
+		uint16_t c;
+	} *data_tgt = NULL;
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_UINT("a", CYAML_FLAG_DEFAULT,
+				struct target_struct, a),
+		CYAML_FIELD_UINT("b", CYAML_FLAG_DEFAULT,
+				struct target_struct, b),
+		CYAML_FIELD_UINT("c", CYAML_FLAG_DEFAULT,
+				struct target_struct, c),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = config,
+		.schema = &top_schema,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_load_data(yaml, YAML_LEN(yaml), config, &top_schema,
+			(cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (data_tgt->a != UINT64_MAX ||
+	    data_tgt->b != 0xff ||
+	    data_tgt->c != 0) {
+		return ttest_fail(&tc, "Incorrect value: "
+				"got: %" PRIu64 ", %u, %u",
+				data_tgt->a, (unsigned)data_tgt->b,
+				(unsigned)data_tgt->c);
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test loading each of the strings that mean false, in varying case.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_mapping_entry_bool_false_strings(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char yaml[] =
+		"a: No\n"
+		"b: DISABLE\n"
+		"c: fAlSe\n"
+		"d: 0\n"
+		"e: nope\n";
+	struct target_struct {
+		bool a;
+		bool b;
+		bool c;
+		bool d;
+		bool e;
+	} *data_tgt = NULL;
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_BOOL("a", CYAML_FLAG_DEFAULT,
+				struct target_struct, a),
+		CYAML_FIELD_BOOL("b", CYAML_FLAG_DEFAULT,
+				struct target_struct, b),
+		CYAML_FIELD_BOOL("c", CYAML_FLAG_DEFAULT,
+				struct target_struct, c),
+		CYAML_FIELD_BOOL("d", CYAML_FLAG_DEFAULT,
+				struct target_struct, d),
+		CYAML_FIELD_BOOL("e", CYAML_FLAG_DEFAULT,
+				struct target_struct, e),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = config,
+		.schema = &top_schema,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_load_data(yaml, YAML_LEN(yaml), config, &top_schema,
+			(cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (data_tgt->a || data_tgt->b || data_tgt->c || data_tgt->d ||
+	    !data_tgt->e) {
+		return ttest_fail(&tc, "Incorrect value: "
+				"got: %d, %d, %d, %d, %d",
+				data_tgt->a, data_tgt->b, data_tgt->c,
+				data_tgt->d, data_tgt->e);
+	}
+
+	return ttest_pass(&tc);
+}
+
 /**
  * Test loading a boolean value (true).
  *
@@ -5223,64 +5480,3808 @@ static bool test_load_mapping_fields_value_insensitive_1(
 }
 
 /**
- * Run the YAML loading unit tests.
+ * Test loading a mapping with many fields, in schema order.
  *
- * \param[in]  rc         The ttest report context.
- * \param[in]  log_level  CYAML log level.
- * \param[in]  log_fn     CYAML logging function, or NULL.
- * \return true iff all unit tests pass, otherwise false.
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
  */
-bool load_tests(
-		ttest_report_ctx_t *rc,
-		cyaml_log_t log_level,
-		cyaml_log_fn_t log_fn)
+static bool test_load_mapping_many_fields_in_order(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
 {
-	bool pass = true;
-	cyaml_config_t config = {
-		.log_fn = log_fn,
-		.mem_fn = cyaml_mem,
-		.log_level = log_level,
-		.flags = CYAML_CFG_DEFAULT,
+	static const unsigned char yaml[] =
+		"a: 1\n"
+		"b: 2\n"
+		"c: 3\n"
+		"d: 4\n"
+		"e: 5\n"
+		"f: 6\n"
+		"g: 7\n"
+		"h: 8\n"
+		"i: 9\n"
+		"j: 10\n"
+		"k: 11\n"
+		"l: 12\n";
+	struct target_struct {
+		int a, b, c, d, e, f, g, h, i, j, k, l;
+	} *data_tgt = NULL;
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_INT("a", CYAML_FLAG_DEFAULT, struct target_struct, a),
+		CYAML_FIELD_INT("b", CYAML_FLAG_DEFAULT, struct target_struct, b),
+		CYAML_FIELD_INT("c", CYAML_FLAG_DEFAULT, struct target_struct, c),
+		CYAML_FIELD_INT("d", CYAML_FLAG_DEFAULT, struct target_struct, d),
+		CYAML_FIELD_INT("e", CYAML_FLAG_DEFAULT, struct target_struct, e),
+		CYAML_FIELD_INT("f", CYAML_FLAG_DEFAULT, struct target_struct, f),
+		CYAML_FIELD_INT("g", CYAML_FLAG_DEFAULT, struct target_struct, g),
+		CYAML_FIELD_INT("h", CYAML_FLAG_DEFAULT, struct target_struct, h),
+		CYAML_FIELD_INT("i", CYAML_FLAG_DEFAULT, struct target_struct, i),
+		CYAML_FIELD_INT("j", CYAML_FLAG_DEFAULT, struct target_struct, j),
+		CYAML_FIELD_INT("k", CYAML_FLAG_DEFAULT, struct target_struct, k),
+		CYAML_FIELD_INT("l", CYAML_FLAG_DEFAULT, struct target_struct, l),
+		CYAML_FIELD_END
 	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	cyaml_config_t cfg = *config;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = &cfg,
+		.schema = &top_schema,
+	};
+	cyaml_err_t err;
 
-	ttest_heading(rc, "Load single entry mapping tests: simple types");
-
-	pass &= test_load_mapping_entry_enum(rc, &config);
-	pass &= test_load_mapping_entry_uint(rc, &config);
-	pass &= test_load_mapping_entry_float(rc, &config);
-	pass &= test_load_mapping_entry_double(rc, &config);
-	pass &= test_load_mapping_entry_string(rc, &config);
-	pass &= test_load_mapping_entry_int_pos(rc, &config);
-	pass &= test_load_mapping_entry_int_neg(rc, &config);
-	pass &= test_load_mapping_entry_enum_ptr(rc, &config);
-	pass &= test_load_mapping_entry_uint_ptr(rc, &config);
-	pass &= test_load_mapping_entry_float_ptr(rc, &config);
-	pass &= test_load_mapping_entry_bool_true(rc, &config);
-	pass &= test_load_mapping_entry_bool_false(rc, &config);
-	pass &= test_load_mapping_entry_double_ptr(rc, &config);
-	pass &= test_load_mapping_entry_string_ptr(rc, &config);
-	pass &= test_load_mapping_entry_int_pos_ptr(rc, &config);
-	pass &= test_load_mapping_entry_int_neg_ptr(rc, &config);
-	pass &= test_load_mapping_entry_enum_sparse(rc, &config);
-	pass &= test_load_mapping_entry_ignore_deep(rc, &config);
-	pass &= test_load_mapping_entry_ignore_scalar(rc, &config);
-	pass &= test_load_mapping_entry_bool_true_ptr(rc, &config);
-	pass &= test_load_mapping_entry_bool_false_ptr(rc, &config);
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
 
-	ttest_heading(rc, "Load single entry mapping tests: complex types");
+	err = cyaml_load_data(yaml, YAML_LEN(yaml), &cfg, &top_schema,
+			(cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
 
-	pass &= test_load_mapping_entry_flags(rc, &config);
-	pass &= test_load_mapping_entry_mapping(rc, &config);
-	pass &= test_load_mapping_entry_flags_ptr(rc, &config);
-	pass &= test_load_mapping_entry_mapping_ptr(rc, &config);
-	pass &= test_load_mapping_entry_flags_empty(rc, &config);
-	pass &= test_load_mapping_entry_flags_sparse(rc, &config);
+	if (data_tgt->a != 1 || data_tgt->b != 2 || data_tgt->c != 3 ||
+	    data_tgt->d != 4 || data_tgt->e != 5 || data_tgt->f != 6 ||
+	    data_tgt->g != 7 || data_tgt->h != 8 || data_tgt->i != 9 ||
+	    data_tgt->j != 10 || data_tgt->k != 11 || data_tgt->l != 12) {
+		return ttest_fail(&tc, "Incorrect value");
+	}
 
-	ttest_heading(rc, "Load single entry mapping tests: sequences");
+	return ttest_pass(&tc);
+}
 
-	pass &= test_load_mapping_entry_sequence_int(rc, &config);
-	pass &= test_load_mapping_entry_sequence_enum(rc, &config);
-	pass &= test_load_mapping_entry_sequence_uint(rc, &config);
+/**
+ * Test loading a mapping with many fields, in reverse schema order.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_mapping_many_fields_reversed(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char yaml[] =
+		"l: 12\n"
+		"k: 11\n"
+		"j: 10\n"
+		"i: 9\n"
+		"h: 8\n"
+		"g: 7\n"
+		"f: 6\n"
+		"e: 5\n"
+		"d: 4\n"
+		"c: 3\n"
+		"b: 2\n"
+		"a: 1\n";
+	struct target_struct {
+		int a, b, c, d, e, f, g, h, i, j, k, l;
+	} *data_tgt = NULL;
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_INT("a", CYAML_FLAG_DEFAULT, struct target_struct, a),
+		CYAML_FIELD_INT("b", CYAML_FLAG_DEFAULT, struct target_struct, b),
+		CYAML_FIELD_INT("c", CYAML_FLAG_DEFAULT, struct target_struct, c),
+		CYAML_FIELD_INT("d", CYAML_FLAG_DEFAULT, struct target_struct, d),
+		CYAML_FIELD_INT("e", CYAML_FLAG_DEFAULT, struct target_struct, e),
+		CYAML_FIELD_INT("f", CYAML_FLAG_DEFAULT, struct target_struct, f),
+		CYAML_FIELD_INT("g", CYAML_FLAG_DEFAULT, struct target_struct, g),
+		CYAML_FIELD_INT("h", CYAML_FLAG_DEFAULT, struct target_struct, h),
+		CYAML_FIELD_INT("i", CYAML_FLAG_DEFAULT, struct target_struct, i),
+		CYAML_FIELD_INT("j", CYAML_FLAG_DEFAULT, struct target_struct, j),
+		CYAML_FIELD_INT("k", CYAML_FLAG_DEFAULT, struct target_struct, k),
+		CYAML_FIELD_INT("l", CYAML_FLAG_DEFAULT, struct target_struct, l),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	cyaml_config_t cfg = *config;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = &cfg,
+		.schema = &top_schema,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_load_data(yaml, YAML_LEN(yaml), &cfg, &top_schema,
+			(cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (data_tgt->a != 1 || data_tgt->b != 2 || data_tgt->c != 3 ||
+	    data_tgt->d != 4 || data_tgt->e != 5 || data_tgt->f != 6 ||
+	    data_tgt->g != 7 || data_tgt->h != 8 || data_tgt->i != 9 ||
+	    data_tgt->j != 10 || data_tgt->k != 11 || data_tgt->l != 12) {
+		return ttest_fail(&tc, "Incorrect value");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test loading a mapping with many fields, with case insensitive keys.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_mapping_many_fields_insensitive(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char yaml[] =
+		"l: 12\n"
+		"A: 1\n"
+		"b: 2\n"
+		"K: 11\n"
+		"c: 3\n"
+		"D: 4\n"
+		"j: 10\n"
+		"E: 5\n"
+		"i: 9\n"
+		"F: 6\n"
+		"h: 8\n"
+		"G: 7\n";
+	struct target_struct {
+		int a, b, c, d, e, f, g, h, i, j, k, l;
+	} *data_tgt = NULL;
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_INT("a", CYAML_FLAG_DEFAULT, struct target_struct, a),
+		CYAML_FIELD_INT("b", CYAML_FLAG_DEFAULT, struct target_struct, b),
+		CYAML_FIELD_INT("c", CYAML_FLAG_DEFAULT, struct target_struct, c),
+		CYAML_FIELD_INT("d", CYAML_FLAG_DEFAULT, struct target_struct, d),
+		CYAML_FIELD_INT("e", CYAML_FLAG_DEFAULT, struct target_struct, e),
+		CYAML_FIELD_INT("f", CYAML_FLAG_DEFAULT, struct target_struct, f),
+		CYAML_FIELD_INT("g", CYAML_FLAG_DEFAULT, struct target_struct, g),
+		CYAML_FIELD_INT("h", CYAML_FLAG_DEFAULT, struct target_struct, h),
+		CYAML_FIELD_INT("i", CYAML_FLAG_DEFAULT, struct target_struct, i),
+		CYAML_FIELD_INT("j", CYAML_FLAG_DEFAULT, struct target_struct, j),
+		CYAML_FIELD_INT("k", CYAML_FLAG_DEFAULT, struct target_struct, k),
+		CYAML_FIELD_INT("l", CYAML_FLAG_DEFAULT, struct target_struct, l),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	cyaml_config_t cfg = *config;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = &cfg,
+		.schema = &top_schema,
+	};
+	cyaml_err_t err;
+
+	cfg.flags |= CYAML_CFG_CASE_INSENSITIVE;
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_load_data(yaml, YAML_LEN(yaml), &cfg, &top_schema,
+			(cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (data_tgt->a != 1 || data_tgt->b != 2 || data_tgt->c != 3 ||
+	    data_tgt->d != 4 || data_tgt->e != 5 || data_tgt->f != 6 ||
+	    data_tgt->g != 7 || data_tgt->h != 8 || data_tgt->i != 9 ||
+	    data_tgt->j != 10 || data_tgt->k != 11 || data_tgt->l != 12) {
+		return ttest_fail(&tc, "Incorrect value");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test loading a mapping with many fields, and some unknown keys.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_mapping_many_fields_unknown_keys(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char yaml[] =
+		"a: 1\n"
+		"b: 2\n"
+		"x: 0\n"
+		"c: 3\n"
+		"d: 4\n"
+		"e: 5\n"
+		"f: 6\n"
+		"y: [1, 2]\n"
+		"g: 7\n"
+		"h: 8\n"
+		"i: 9\n"
+		"j: 10\n"
+		"k: 11\n"
+		"z: { a: 1 }\n"
+		"l: 12\n";
+	struct target_struct {
+		int a, b, c, d, e, f, g, h, i, j, k, l;
+	} *data_tgt = NULL;
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_INT("a", CYAML_FLAG_DEFAULT, struct target_struct, a),
+		CYAML_FIELD_INT("b", CYAML_FLAG_DEFAULT, struct target_struct, b),
+		CYAML_FIELD_INT("c", CYAML_FLAG_DEFAULT, struct target_struct, c),
+		CYAML_FIELD_INT("d", CYAML_FLAG_DEFAULT, struct target_struct, d),
+		CYAML_FIELD_INT("e", CYAML_FLAG_DEFAULT, struct target_struct, e),
+		CYAML_FIELD_INT("f", CYAML_FLAG_DEFAULT, struct target_struct, f),
+		CYAML_FIELD_INT("g", CYAML_FLAG_DEFAULT, struct target_struct, g),
+		CYAML_FIELD_INT("h", CYAML_FLAG_DEFAULT, struct target_struct, h),
+		CYAML_FIELD_INT("i", CYAML_FLAG_DEFAULT, struct target_struct, i),
+		CYAML_FIELD_INT("j", CYAML_FLAG_DEFAULT, struct target_struct, j),
+		CYAML_FIELD_INT("k", CYAML_FLAG_DEFAULT, struct target_struct, k),
+		CYAML_FIELD_INT("l", CYAML_FLAG_DEFAULT, struct target_struct, l),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	cyaml_config_t cfg = *config;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = &cfg,
+		.schema = &top_schema,
+	};
+	cyaml_err_t err;
+
+	cfg.flags |= CYAML_CFG_IGNORE_UNKNOWN_KEYS;
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_load_data(yaml, YAML_LEN(yaml), &cfg, &top_schema,
+			(cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (data_tgt->a != 1 || data_tgt->b != 2 || data_tgt->c != 3 ||
+	    data_tgt->d != 4 || data_tgt->e != 5 || data_tgt->f != 6 ||
+	    data_tgt->g != 7 || data_tgt->h != 8 || data_tgt->i != 9 ||
+	    data_tgt->j != 10 || data_tgt->k != 11 || data_tgt->l != 12) {
+		return ttest_fail(&tc, "Incorrect value");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Allocation counter for arena tests.
+ *
+ * \param[in]  ctx   Allocation context; points to an unsigned count.
+ * \param[in]  ptr   Pointer to allocation to resize or NULL.
+ * \param[in]  size  Size to set allocation to.
+ * \return Pointer to new allocation, or NULL on failure.
+ */
+static void * test_load_mem_count(
+		void *ctx,
+		void *ptr,
+		size_t size)
+{
+	unsigned *count = ctx;
+
+	if (size == 0) {
+		free(ptr);
+		return NULL;
+	}
+
+	(*count)++;
+
+	return realloc(ptr, size);
+}
+
+/**
+ * Test loading a mapping with nested pointer values into an arena.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_arena_mapping(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char yaml[] =
+		"animals:\n"
+		"  - kind: cat\n"
+		"    sound: meow\n"
+		"    position: [ 1, 2, 1 ]\n"
+		"  - kind: snake\n"
+		"    sound: hiss\n"
+		"    position: [ 3, 1, 0 ]\n"
+		"name: zoo\n";
+	struct animal_s {
+		char *kind;
+		char *sound;
+		int *position;
+	};
+	struct target_struct {
+		struct animal_s *animal;
+		uint32_t animal_count;
+		char *name;
+	} *data_tgt = NULL;
+	static const struct cyaml_schema_value position_entry_schema = {
+		CYAML_VALUE_INT(CYAML_FLAG_DEFAULT, int),
+	};
+	static const struct cyaml_schema_field animal_schema[] = {
+		CYAML_FIELD_STRING_PTR("kind", CYAML_FLAG_POINTER,
+				struct animal_s, kind, 0, CYAML_UNLIMITED),
+		CYAML_FIELD_STRING_PTR("sound", CYAML_FLAG_POINTER,
+				struct animal_s, sound, 0, CYAML_UNLIMITED),
+		CYAML_FIELD_SEQUENCE_FIXED("position", CYAML_FLAG_POINTER,
+				struct animal_s, position,
+				&position_entry_schema, 3),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value animal_entry_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_DEFAULT, struct animal_s,
+				animal_schema),
+	};
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_SEQUENCE("animals", CYAML_FLAG_POINTER,
+				struct target_struct, animal,
+				&animal_entry_schema, 0, CYAML_UNLIMITED),
+		CYAML_FIELD_STRING_PTR("name", CYAML_FLAG_POINTER,
+				struct target_struct, name, 0, CYAML_UNLIMITED),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	unsigned plain_allocs = 0;
+	unsigned allocs = 0;
+	cyaml_config_t cfg = *config;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = &cfg,
+		.schema = &top_schema,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	cfg.mem_fn = test_load_mem_count;
+	cfg.mem_ctx = &plain_allocs;
+
+	err = cyaml_load_data(yaml, YAML_LEN(yaml), &cfg, &top_schema,
+			(cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	cyaml_free(&cfg, &top_schema, data_tgt, 0);
+	data_tgt = NULL;
+
+	cfg.flags |= CYAML_CFG_ARENA;
+	cfg.mem_ctx = &allocs;
+
+	err = cyaml_load_data(yaml, YAML_LEN(yaml), &cfg, &top_schema,
+			(cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (data_tgt == NULL) {
+		return ttest_fail(&tc, "Data NULL on success.");
+	}
+
+	if (data_tgt->animal_count != 2 ||
+	    strcmp(data_tgt->animal[0].kind, "cat") != 0 ||
+	    strcmp(data_tgt->animal[0].sound, "meow") != 0 ||
+	    strcmp(data_tgt->animal[1].kind, "snake") != 0 ||
+	    strcmp(data_tgt->animal[1].sound, "hiss") != 0 ||
+	    strcmp(data_tgt->name, "zoo") != 0) {
+		return ttest_fail(&tc, "Bad value.");
+	}
+
+	if (data_tgt->animal[0].position[1] != 2 ||
+	    data_tgt->animal[1].position[0] != 3) {
+		return ttest_fail(&tc, "Bad position value.");
+	}
+
+	/* The loader's working state is allocated the same way in both
+	 * cases, but the loaded data should all fit in one chunk. */
+	if (allocs >= plain_allocs) {
+		return ttest_fail(&tc, "Arena didn't reduce allocations.");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test loading a top level sequence, which has to move, into an arena.
+ *
+ * Each entry's string is allocated after the sequence, so the sequence
+ * can't be extended in place.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_arena_top_level_sequence(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	enum { ENTRIES = 300 };
+	char **value = NULL;
+	unsigned count = 0;
+	static const struct cyaml_schema_value entry_schema = {
+		CYAML_VALUE_STRING(CYAML_FLAG_POINTER, char, 0, CYAML_UNLIMITED)
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_SEQUENCE(CYAML_FLAG_POINTER, char *,
+				&entry_schema, 0, CYAML_UNLIMITED)
+	};
+	unsigned allocs = 0;
+	cyaml_config_t cfg = *config;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &value,
+		.seq_count = &count,
+		.config = &cfg,
+		.schema = &top_schema,
+	};
+	char yaml[ENTRIES * 16];
+	size_t len = 0;
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	for (unsigned i = 0; i < ENTRIES; i++) {
+		len += sprintf(yaml + len, "- entry%u\n", i);
+	}
+
+	cfg.flags |= CYAML_CFG_ARENA | CYAML_CFG_SHRINK_SEQUENCES;
+	cfg.mem_fn = test_load_mem_count;
+	cfg.mem_ctx = &allocs;
+
+	err = cyaml_load_data((const uint8_t *)yaml, len, &cfg, &top_schema,
+			(cyaml_data_t **) &value, &count);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (count != ENTRIES) {
+		return ttest_fail(&tc, "Unexpected sequence count.");
+	}
+
+	for (unsigned i = 0; i < ENTRIES; i++) {
+		char expected[16];
+		sprintf(expected, "entry%u", i);
+		if (strcmp(value[i], expected) != 0) {
+			return ttest_fail(&tc, "Bad value.");
+		}
+	}
+
+	if (allocs >= ENTRIES) {
+		return ttest_fail(&tc, "Too many allocations.");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test loading with interned strings into an arena.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_arena_intern_strings(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	enum { ENTRIES = 200, HOSTS = 4 };
+	struct host {
+		char *host;
+		char *region;
+	} *value = NULL;
+	unsigned count = 0;
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_STRING_PTR("host", CYAML_FLAG_POINTER,
+				struct host, host, 0, CYAML_UNLIMITED),
+		CYAML_FIELD_STRING_PTR("region", CYAML_FLAG_POINTER,
+				struct host, region, 0, CYAML_UNLIMITED),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value entry_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_DEFAULT,
+				struct host, mapping_schema),
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_SEQUENCE(CYAML_FLAG_POINTER, struct host,
+				&entry_schema, 0, CYAML_UNLIMITED)
+	};
+	cyaml_config_t cfg = *config;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &value,
+		.seq_count = &count,
+		.config = &cfg,
+		.schema = &top_schema,
+	};
+	char yaml[ENTRIES * 32];
+	size_t len = 0;
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	for (unsigned i = 0; i < ENTRIES; i++) {
+		len += sprintf(yaml + len, "- { host: h%u, region: eu }\n",
+				i % HOSTS);
+	}
+
+	cfg.flags |= CYAML_CFG_ARENA | CYAML_CFG_INTERN_STRINGS;
+
+	err = cyaml_load_data((const uint8_t *)yaml, len, &cfg, &top_schema,
+			(cyaml_data_t **) &value, &count);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (count != ENTRIES) {
+		return ttest_fail(&tc, "Unexpected sequence count.");
+	}
+
+	for (unsigned i = 0; i < ENTRIES; i++) {
+		char expected[16];
+		sprintf(expected, "h%u", i % HOSTS);
+		if (strcmp(value[i].host, expected) != 0 ||
+		    strcmp(value[i].region, "eu") != 0) {
+			return ttest_fail(&tc, "Bad value.");
+		}
+		if (value[i].host != value[i % HOSTS].host ||
+		    value[i].region != value[0].region) {
+			return ttest_fail(&tc, "String not shared.");
+		}
+		if (i > 0 && i < HOSTS && value[i].host == value[0].host) {
+			return ttest_fail(&tc, "Distinct strings shared.");
+		}
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test that string interning has no effect without an arena.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_intern_strings_no_arena(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char yaml[] =
+		"- same\n"
+		"- same\n";
+	char **value = NULL;
+	unsigned count = 0;
+	static const struct cyaml_schema_value entry_schema = {
+		CYAML_VALUE_STRING(CYAML_FLAG_POINTER, char, 0, CYAML_UNLIMITED)
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_SEQUENCE(CYAML_FLAG_POINTER, char *,
+				&entry_schema, 0, CYAML_UNLIMITED)
+	};
+	cyaml_config_t cfg = *config;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &value,
+		.seq_count = &count,
+		.config = &cfg,
+		.schema = &top_schema,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	cfg.flags |= CYAML_CFG_INTERN_STRINGS;
+
+	err = cyaml_load_data(yaml, YAML_LEN(yaml), &cfg, &top_schema,
+			(cyaml_data_t **) &value, &count);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (count != 2 || strcmp(value[0], "same") != 0 ||
+	    strcmp(value[1], "same") != 0) {
+		return ttest_fail(&tc, "Bad value.");
+	}
+
+	if (value[0] == value[1]) {
+		return ttest_fail(&tc, "Strings shared without arena.");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/** Allocation tracking context for sequence growth tests. */
+struct test_load_mem_track {
+	unsigned count;   /**< Number of (re)allocations made. */
+	void *last_ptr;   /**< Most recent allocation. */
+	size_t last_size; /**< Size of most recent allocation. */
+};
+
+/**
+ * Allocation tracker for sequence growth tests.
+ *
+ * \param[in]  ctx   Allocation context.
+ * \param[in]  ptr   Pointer to allocation to resize or NULL.
+ * \param[in]  size  Size to set allocation to.
+ * \return Pointer to new allocation, or NULL on failure.
+ */
+static void * test_load_mem_track(
+		void *ctx,
+		void *ptr,
+		size_t size)
+{
+	struct test_load_mem_track *track = ctx;
+
+	if (size == 0) {
+		free(ptr);
+		return NULL;
+	}
+
+	track->count++;
+	track->last_size = size;
+	track->last_ptr = realloc(ptr, size);
+
+	return track->last_ptr;
+}
+
+/**
+ * Load a top level sequence of integers, tracking allocations.
+ *
+ * \param[in]   config   The CYAML config to use.
+ * \param[in]   schema   The top level sequence schema.
+ * \param[in]   entries  Number of sequence entries to generate.
+ * \param[out]  track    Returns allocation tracking info.
+ * \param[out]  value    Returns the loaded sequence.
+ * \param[out]  count    Returns the loaded sequence's entry count.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t test_load_int_sequence(
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		unsigned entries,
+		struct test_load_mem_track *track,
+		int **value,
+		unsigned *count)
+{
+	cyaml_config_t cfg = *config;
+	size_t len = 0;
+	cyaml_err_t err;
+	char *yaml;
+
+	yaml = malloc(entries * 16);
+	if (yaml == NULL) {
+		return CYAML_ERR_OOM;
+	}
+
+	for (unsigned i = 0; i < entries; i++) {
+		len += sprintf(yaml + len, "- %u\n", i);
+	}
+
+	cfg.mem_fn = test_load_mem_track;
+	cfg.mem_ctx = track;
+
+	err = cyaml_load_data((const uint8_t *)yaml, len, &cfg, schema,
+			(cyaml_data_t **) value, count);
+	free(yaml);
+	if (err != CYAML_OK) {
+		return err;
+	}
+
+	for (unsigned i = 0; i < entries; i++) {
+		if ((*value)[i] != (int)i) {
+			return CYAML_ERR_INVALID_VALUE;
+		}
+	}
+
+	return CYAML_OK;
+}
+
+/**
+ * Test that loading a long sequence doesn't reallocate for every entry.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_sequence_growth(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	enum { ENTRIES = 10000 };
+	int *value = NULL;
+	unsigned count = 0;
+	static const struct cyaml_schema_value entry_schema = {
+		CYAML_VALUE_INT(CYAML_FLAG_DEFAULT, int)
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_SEQUENCE(CYAML_FLAG_POINTER, int,
+				&entry_schema, 0, CYAML_UNLIMITED)
+	};
+	test_data_t td = {
+		.data = (cyaml_data_t **) &value,
+		.seq_count = &count,
+		.config = config,
+		.schema = &top_schema,
+	};
+	struct test_load_mem_track track = { 0 };
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = test_load_int_sequence(config, &top_schema, ENTRIES,
+			&track, &value, &count);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (count != ENTRIES) {
+		return ttest_fail(&tc, "Unexpected sequence count.");
+	}
+
+	if (track.count > 64) {
+		return ttest_fail(&tc, "Too many allocations.");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test that a sequence's expected entry count is allocated up front.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_sequence_expected(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	enum { ENTRIES = 1000 };
+	int *value = NULL;
+	unsigned count = 0;
+	static const struct cyaml_schema_value entry_schema = {
+		CYAML_VALUE_INT(CYAML_FLAG_DEFAULT, int)
+	};
+	static const struct cyaml_schema_value plain_schema = {
+		CYAML_VALUE_SEQUENCE(CYAML_FLAG_POINTER, int,
+				&entry_schema, 0, CYAML_UNLIMITED)
+	};
+	static const struct cyaml_schema_value top_schema = {
+		.type = CYAML_SEQUENCE,
+		.flags = CYAML_FLAG_POINTER,
+		.data_size = sizeof(int),
+		.seq_expected = ENTRIES,
+		.sequence = {
+			.entry = &entry_schema,
+			.min = 0,
+			.max = CYAML_UNLIMITED,
+		},
+	};
+	test_data_t td = {
+		.data = (cyaml_data_t **) &value,
+		.seq_count = &count,
+		.config = config,
+		.schema = &top_schema,
+	};
+	struct test_load_mem_track plain = { 0 };
+	struct test_load_mem_track track = { 0 };
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = test_load_int_sequence(config, &plain_schema, ENTRIES,
+			&plain, &value, &count);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	cyaml_free(config, &plain_schema, value, count);
+	value = NULL;
+	count = 0;
+
+	err = test_load_int_sequence(config, &top_schema, ENTRIES,
+			&track, &value, &count);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (count != ENTRIES) {
+		return ttest_fail(&tc, "Unexpected sequence count.");
+	}
+
+	/* Without the hint, the sequence is allocated eleven times as it
+	 * doubles to 1024 entries.  With it, there should be one. */
+	if (plain.count - track.count != 10) {
+		return ttest_fail(&tc, "Unexpected allocation count.");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test that sequences can be shrunk to fit once loaded.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_sequence_shrink(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	enum { ENTRIES = 1000 };
+	int *value = NULL;
+	unsigned count = 0;
+	static const struct cyaml_schema_value entry_schema = {
+		CYAML_VALUE_INT(CYAML_FLAG_DEFAULT, int)
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_SEQUENCE(CYAML_FLAG_POINTER, int,
+				&entry_schema, 0, CYAML_UNLIMITED)
+	};
+	cyaml_config_t cfg = *config;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &value,
+		.seq_count = &count,
+		.config = config,
+		.schema = &top_schema,
+	};
+	struct test_load_mem_track track = { 0 };
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	cfg.flags |= CYAML_CFG_SHRINK_SEQUENCES;
+
+	err = test_load_int_sequence(&cfg, &top_schema, ENTRIES,
+			&track, &value, &count);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (count != ENTRIES) {
+		return ttest_fail(&tc, "Unexpected sequence count.");
+	}
+
+	/* The shrink is the last allocation made by the load. */
+	if (track.last_ptr != value ||
+	    track.last_size != ENTRIES * sizeof(*value)) {
+		return ttest_fail(&tc, "Sequence not shrunk to fit.");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test loading each document from a multi-document stream.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_stream_documents(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char yaml[] =
+		"---\n"
+		"id: 1\n"
+		"name: first\n"
+		"---\n"
+		"id: 2\n"
+		"name: second\n"
+		"---\n"
+		"id: 3\n"
+		"name: third\n";
+	static const char * const names[] = { "first", "second", "third" };
+	struct target_struct {
+		int id;
+		char *name;
+	} *data_tgt = NULL;
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_INT("id", CYAML_FLAG_DEFAULT,
+				struct target_struct, id),
+		CYAML_FIELD_STRING_PTR("name", CYAML_FLAG_POINTER,
+				struct target_struct, name,
+				0, CYAML_UNLIMITED),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = config,
+		.schema = &top_schema,
+	};
+	cyaml_stream_t *stream = NULL;
+	unsigned docs = 0;
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_stream_open_data(yaml, YAML_LEN(yaml), config,
+			&top_schema, &stream);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	while ((err = cyaml_stream_next(stream,
+			(cyaml_data_t **) &data_tgt, NULL)) == CYAML_OK) {
+		if (docs >= CYAML_ARRAY_LEN(names) ||
+		    data_tgt->id != (int)docs + 1 ||
+		    strcmp(data_tgt->name, names[docs]) != 0) {
+			cyaml_stream_close(stream);
+			return ttest_fail(&tc, "Bad document.");
+		}
+		cyaml_free(config, &top_schema, data_tgt, 0);
+		data_tgt = NULL;
+		docs++;
+	}
+
+	if (err != CYAML_ERR_STREAM_END) {
+		cyaml_stream_close(stream);
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	err = cyaml_stream_next(stream, (cyaml_data_t **) &data_tgt, NULL);
+	cyaml_stream_close(stream);
+	if (err != CYAML_ERR_STREAM_END) {
+		return ttest_fail(&tc, "Stream didn't stay ended.");
+	}
+
+	if (docs != CYAML_ARRAY_LEN(names)) {
+		return ttest_fail(&tc, "Unexpected document count.");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test loading documents from input pushed a byte at a time.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_stream_push(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char yaml[] =
+		"---\n"
+		"id: 1\n"
+		"name: first\n"
+		"---\n"
+		"id: 2\n"
+		"name: second\n"
+		"---\n"
+		"id: 3\n"
+		"name: third\n";
+	static const char * const names[] = { "first", "second", "third" };
+	/* Input needed before each document can be loaded. */
+	static const size_t ready[] = { 26, 49, SIZE_MAX };
+	struct target_struct {
+		int id;
+		char *name;
+	} *data_tgt = NULL;
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_INT("id", CYAML_FLAG_DEFAULT,
+				struct target_struct, id),
+		CYAML_FIELD_STRING_PTR("name", CYAML_FLAG_POINTER,
+				struct target_struct, name,
+				0, CYAML_UNLIMITED),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = config,
+		.schema = &top_schema,
+	};
+	cyaml_stream_t *stream = NULL;
+	unsigned docs = 0;
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_stream_open_push(config, &top_schema, &stream);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	for (size_t i = 0; i <= YAML_LEN(yaml); i++) {
+		if (i < YAML_LEN(yaml)) {
+			err = cyaml_stream_feed(stream, yaml + i, 1);
+		} else {
+			err = cyaml_stream_feed_end(stream);
+		}
+		if (err != CYAML_OK) {
+			cyaml_stream_close(stream);
+			return ttest_fail(&tc, cyaml_strerror(err));
+		}
+
+		while ((err = cyaml_stream_next(stream,
+				(cyaml_data_t **) &data_tgt, NULL)) ==
+				CYAML_OK) {
+			size_t pushed = (i < YAML_LEN(yaml)) ? i + 1 : SIZE_MAX;
+			if (docs >= CYAML_ARRAY_LEN(names) ||
+			    pushed != ready[docs] ||
+			    data_tgt->id != (int)docs + 1 ||
+			    strcmp(data_tgt->name, names[docs]) != 0) {
+				cyaml_stream_close(stream);
+				return ttest_fail(&tc, "Bad document %u at %zu",
+						docs, i);
+			}
+			cyaml_free(config, &top_schema, data_tgt, 0);
+			data_tgt = NULL;
+			docs++;
+		}
+
+		if (err != CYAML_ERR_NEED_INPUT &&
+		    err != CYAML_ERR_STREAM_END) {
+			cyaml_stream_close(stream);
+			return ttest_fail(&tc, cyaml_strerror(err));
+		}
+	}
+
+	cyaml_stream_close(stream);
+	if (err != CYAML_ERR_STREAM_END) {
+		return ttest_fail(&tc, "Stream didn't end.");
+	}
+
+	if (docs != CYAML_ARRAY_LEN(names)) {
+		return ttest_fail(&tc, "Unexpected document count.");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test pushed input with document end markers, comments and directives.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_stream_push_markers(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char yaml1[] =
+		"# Leading comment\n"
+		"%YAML 1.1\n"
+		"---\n"
+		"- 1\n"
+		"- 2\n"
+		"...\n"
+		"# Between documents\n"
+		"---\n"
+		"- 3\n";
+	static const unsigned char yaml2[] =
+		"...\n"
+		"--- [4, 5, 6]\n";
+	static const int counts[] = { 2, 1, 3 };
+	int *data_tgt = NULL;
+	unsigned count = 0;
+	static const struct cyaml_schema_value entry_schema = {
+		CYAML_VALUE_INT(CYAML_FLAG_DEFAULT, int),
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_SEQUENCE(CYAML_FLAG_POINTER, int,
+				&entry_schema, 0, CYAML_UNLIMITED),
+	};
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.seq_count = &count,
+		.config = config,
+		.schema = &top_schema,
+	};
+	cyaml_stream_t *stream = NULL;
+	unsigned docs = 0;
+	int value = 1;
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_stream_open_push(config, &top_schema, &stream);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	for (unsigned i = 0; i < 3; i++) {
+		switch (i) {
+		case 0:
+			err = cyaml_stream_feed(stream,
+					yaml1, YAML_LEN(yaml1));
+			break;
+		case 1:
+			err = cyaml_stream_feed(stream,
+					yaml2, YAML_LEN(yaml2));
+			break;
+		default:
+			err = cyaml_stream_feed_end(stream);
+			break;
+		}
+		if (err != CYAML_OK) {
+			cyaml_stream_close(stream);
+			return ttest_fail(&tc, cyaml_strerror(err));
+		}
+
+		while ((err = cyaml_stream_next(stream,
+				(cyaml_data_t **) &data_tgt, &count)) ==
+				CYAML_OK) {
+			if (docs != i || docs >= CYAML_ARRAY_LEN(counts) ||
+			    count != (unsigned)counts[docs]) {
+				cyaml_stream_close(stream);
+				return ttest_fail(&tc, "Bad document %u", docs);
+			}
+			for (unsigned j = 0; j < count; j++) {
+				if (data_tgt[j] != value++) {
+					cyaml_stream_close(stream);
+					return ttest_fail(&tc, "Bad value");
+				}
+			}
+			cyaml_free(config, &top_schema, data_tgt, count);
+			data_tgt = NULL;
+			docs++;
+		}
+
+		if (err != ((i < 2) ? CYAML_ERR_NEED_INPUT :
+				CYAML_ERR_STREAM_END)) {
+			cyaml_stream_close(stream);
+			return ttest_fail(&tc, cyaml_strerror(err));
+		}
+	}
+
+	err = cyaml_stream_feed(stream, yaml2, YAML_LEN(yaml2));
+	cyaml_stream_close(stream);
+	if (err != CYAML_ERR_STREAM_END) {
+		return ttest_fail(&tc, "Input accepted after end.");
+	}
+
+	if (docs != CYAML_ARRAY_LEN(counts)) {
+		return ttest_fail(&tc, "Unexpected document count.");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/** Client read function context for load stream tests. */
+struct test_read_ctx {
+	const uint8_t *data; /**< Input to provide. */
+	size_t len;          /**< Length of data in bytes. */
+	size_t pos;          /**< Number of bytes provided so far. */
+	size_t chunk;        /**< Most bytes to provide per call. */
+	unsigned calls;      /**< Number of read function calls. */
+	unsigned fail_call;  /**< Call to fail with err, or zero for none. */
+	cyaml_err_t err;     /**< Error code for read function to fail with. */
+};
+
+/**
+ * Client read function for load stream tests.
+ *
+ * \param[in]  ctx     The \ref test_read_ctx to provide input from.
+ * \param[out] buffer  Buffer to read input into.
+ * \param[in]  size    Size of buffer in bytes.
+ * \param[out] len     Returns the number of bytes read.
+ * \return \ref CYAML_OK, or the error code from ctx on the failing call.
+ */
+static cyaml_err_t test_read_fn(
+		void *ctx,
+		uint8_t *buffer,
+		size_t size,
+		size_t *len)
+{
+	struct test_read_ctx *rctx = ctx;
+	size_t n = rctx->len - rctx->pos;
+
+	rctx->calls++;
+	if (rctx->calls == rctx->fail_call) {
+		return rctx->err;
+	}
+
+	if (n > size) {
+		n = size;
+	}
+	if (n > rctx->chunk) {
+		n = rctx->chunk;
+	}
+
+	memcpy(buffer, rctx->data + rctx->pos, n);
+	rctx->pos += n;
+	*len = n;
+
+	return CYAML_OK;
+}
+
+/** Schema for the load stream tests. */
+struct test_read_data {
+	int id;
+	char *name;
+	int *values;
+	unsigned values_count;
+};
+
+/** Sequence entry schema for \ref test_read_data values. */
+static const struct cyaml_schema_value test_read_value = {
+	CYAML_VALUE_INT(CYAML_FLAG_DEFAULT, int),
+};
+
+/** Mapping fields for \ref test_read_data. */
+static const struct cyaml_schema_field test_read_fields[] = {
+	CYAML_FIELD_INT("id", CYAML_FLAG_DEFAULT,
+			struct test_read_data, id),
+	CYAML_FIELD_STRING_PTR("name", CYAML_FLAG_POINTER,
+			struct test_read_data, name, 0, CYAML_UNLIMITED),
+	CYAML_FIELD_SEQUENCE("values", CYAML_FLAG_POINTER,
+			struct test_read_data, values,
+			&test_read_value, 0, CYAML_UNLIMITED),
+	CYAML_FIELD_END
+};
+
+/** Top level schema for \ref test_read_data. */
+static const struct cyaml_schema_value test_read_schema = {
+	CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+			struct test_read_data, test_read_fields),
+};
+
+/** Input for the load stream tests. */
+static const unsigned char test_read_yaml[] =
+	"id: 42\n"
+	"name: streamed\n"
+	"values: [1, 2, 3, 4, 5, 6, 7, 8]\n";
+
+/**
+ * Check data loaded from \ref test_read_yaml.
+ *
+ * \param[in]  data  The loaded data.
+ * \return true if the data is correct, false otherwise.
+ */
+static bool test_read_data_check(
+		const struct test_read_data *data)
+{
+	if (data == NULL || data->id != 42 ||
+	    strcmp(data->name, "streamed") != 0 ||
+	    data->values_count != 8) {
+		return false;
+	}
+
+	for (unsigned i = 0; i < data->values_count; i++) {
+		if (data->values[i] != (int)i + 1) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Test loading through a client read function.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_stream_read(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	struct test_read_data *data_tgt = NULL;
+	struct test_read_ctx rctx = {
+		.data = test_read_yaml,
+		.len = YAML_LEN(test_read_yaml),
+		.chunk = 5,
+	};
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = config,
+		.schema = &test_read_schema,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_load_stream(test_read_fn, &rctx, config,
+			&test_read_schema, (cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (!test_read_data_check(data_tgt)) {
+		return ttest_fail(&tc, "Bad data");
+	}
+
+	if (rctx.calls <= YAML_LEN(test_read_yaml) / rctx.chunk) {
+		return ttest_fail(&tc, "Unexpected read count: %u",
+				rctx.calls);
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test errors from a client read function are returned.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_stream_read_error(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	struct test_read_data *data_tgt = NULL;
+	struct test_read_ctx rctx = {
+		.data = test_read_yaml,
+		.len = YAML_LEN(test_read_yaml),
+		.chunk = 5,
+		.fail_call = 3,
+		.err = CYAML_ERR_FILE_OPEN,
+	};
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = config,
+		.schema = &test_read_schema,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_load_stream(test_read_fn, &rctx, config,
+			&test_read_schema, (cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_ERR_FILE_OPEN) {
+		return ttest_fail(&tc, "Unexpected result: %s",
+				cyaml_strerror(err));
+	}
+
+	if (data_tgt != NULL) {
+		return ttest_fail(&tc, "Data returned on failure");
+	}
+
+	return ttest_pass(&tc);
+}
+
+#ifdef CYAML_ZLIB
+/**
+ * Append a gzip member to a buffer.
+ *
+ * \param[in]     in      Data to compress.
+ * \param[in]     in_len  Length of in, in bytes.
+ * \param[in,out] out     Buffer to append the gzip member to.
+ * \param[in]     out_max Size of out in bytes.
+ * \param[in,out] out_len Length of data in out.
+ * \return true on success, false otherwise.
+ */
+static bool test_gzip_append(
+		const uint8_t *in,
+		size_t in_len,
+		uint8_t *out,
+		size_t out_max,
+		size_t *out_len)
+{
+	z_stream z = { .zalloc = Z_NULL };
+	int ret;
+
+	if (deflateInit2(&z, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+			Z_DEFAULT_STRATEGY) != Z_OK) {
+		return false;
+	}
+
+	z.next_in = (Bytef *)in;
+	z.avail_in = (uInt)in_len;
+	z.next_out = out + *out_len;
+	z.avail_out = (uInt)(out_max - *out_len);
+
+	ret = deflate(&z, Z_FINISH);
+	*out_len = out_max - z.avail_out;
+	deflateEnd(&z);
+
+	return ret == Z_STREAM_END;
+}
+#endif
+
+/**
+ * Test loading gzip compressed input, through an inflater.
+ *
+ * The input is two concatenated gzip members, read a few bytes at a time.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_stream_inflate(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	struct test_read_data *data_tgt = NULL;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = config,
+		.schema = &test_read_schema,
+	};
+	cyaml_inflate_t *inflate = NULL;
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+#ifdef CYAML_ZLIB
+	uint8_t gz[256];
+	size_t split = 20;
+	struct test_read_ctx rctx = {
+		.data = gz,
+		.chunk = 3,
+	};
+
+	if (!test_gzip_append(test_read_yaml, split,
+			gz, sizeof(gz), &rctx.len) ||
+	    !test_gzip_append(test_read_yaml + split,
+			YAML_LEN(test_read_yaml) - split,
+			gz, sizeof(gz), &rctx.len)) {
+		return ttest_fail(&tc, "Failed to compress input");
+	}
+
+	err = cyaml_inflate_create(config, test_read_fn, &rctx, &inflate);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	err = cyaml_load_stream(cyaml_inflate_read, inflate, config,
+			&test_read_schema, (cyaml_data_t **) &data_tgt, NULL);
+	cyaml_inflate_destroy(inflate);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (!test_read_data_check(data_tgt)) {
+		return ttest_fail(&tc, "Bad data");
+	}
+
+	/* Truncated input must fail, rather than load a partial document. */
+	cyaml_free(config, &test_read_schema, data_tgt, 0);
+	data_tgt = NULL;
+	rctx.len -= 4;
+	rctx.pos = 0;
+
+	err = cyaml_inflate_create(config, test_read_fn, &rctx, &inflate);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	err = cyaml_load_stream(cyaml_inflate_read, inflate, config,
+			&test_read_schema, (cyaml_data_t **) &data_tgt, NULL);
+	cyaml_inflate_destroy(inflate);
+	if (err != CYAML_ERR_DECOMPRESS) {
+		return ttest_fail(&tc, "Truncated input: %s",
+				cyaml_strerror(err));
+	}
+#else
+	err = cyaml_inflate_create(config, test_read_fn, NULL, &inflate);
+	if (err != CYAML_ERR_NOT_SUPPORTED || inflate != NULL) {
+		return ttest_fail(&tc, "Inflater without zlib support");
+	}
+#endif
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test loading top level sequence documents from a stream into arenas.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_stream_arena_sequences(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char yaml[] =
+		"--- [ 1 ]\n"
+		"--- [ 1, 2 ]\n"
+		"--- [ 1, 2, 3 ]\n";
+	int *value = NULL;
+	unsigned count = 0;
+	static const struct cyaml_schema_value entry_schema = {
+		CYAML_VALUE_INT(CYAML_FLAG_DEFAULT, int)
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_SEQUENCE(CYAML_FLAG_POINTER, int,
+				&entry_schema, 0, CYAML_UNLIMITED)
+	};
+	cyaml_config_t cfg = *config;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &value,
+		.seq_count = &count,
+		.config = &cfg,
+		.schema = &top_schema,
+	};
+	cyaml_stream_t *stream = NULL;
+	unsigned docs = 0;
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	cfg.flags |= CYAML_CFG_ARENA;
+
+	err = cyaml_stream_open_data(yaml, YAML_LEN(yaml), &cfg,
+			&top_schema, &stream);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	while ((err = cyaml_stream_next(stream,
+			(cyaml_data_t **) &value, &count)) == CYAML_OK) {
+		docs++;
+		if (count != docs || value[count - 1] != (int)count) {
+			cyaml_stream_close(stream);
+			return ttest_fail(&tc, "Bad document.");
+		}
+		cyaml_free(&cfg, &top_schema, value, count);
+		value = NULL;
+		count = 0;
+	}
+
+	cyaml_stream_close(stream);
+	if (err != CYAML_ERR_STREAM_END) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (docs != 3) {
+		return ttest_fail(&tc, "Unexpected document count.");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test loading a document stream with interned strings.
+ *
+ * Each document must get its own copies of the strings, since they are
+ * freed separately.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_stream_intern_strings(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char yaml[] =
+		"--- [ tag, tag ]\n"
+		"--- [ tag, other, tag ]\n";
+	char **value = NULL;
+	unsigned count = 0;
+	static const struct cyaml_schema_value entry_schema = {
+		CYAML_VALUE_STRING(CYAML_FLAG_POINTER, char, 0, CYAML_UNLIMITED)
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_SEQUENCE(CYAML_FLAG_POINTER, char *,
+				&entry_schema, 0, CYAML_UNLIMITED)
+	};
+	cyaml_config_t cfg = *config;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &value,
+		.seq_count = &count,
+		.config = &cfg,
+		.schema = &top_schema,
+	};
+	cyaml_stream_t *stream = NULL;
+	unsigned docs = 0;
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	cfg.flags |= CYAML_CFG_ARENA | CYAML_CFG_INTERN_STRINGS;
+
+	err = cyaml_stream_open_data(yaml, YAML_LEN(yaml), &cfg,
+			&top_schema, &stream);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	while ((err = cyaml_stream_next(stream,
+			(cyaml_data_t **) &value, &count)) == CYAML_OK) {
+		docs++;
+		if (strcmp(value[0], "tag") != 0 ||
+		    value[0] != value[count - 1]) {
+			cyaml_stream_close(stream);
+			return ttest_fail(&tc, "Bad document.");
+		}
+		cyaml_free(&cfg, &top_schema, value, count);
+		value = NULL;
+		count = 0;
+	}
+
+	cyaml_stream_close(stream);
+	if (err != CYAML_ERR_STREAM_END) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (docs != 2) {
+		return ttest_fail(&tc, "Unexpected document count.");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test that a document stream stops at an invalid document.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_stream_invalid_document(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char yaml[] =
+		"--- 1\n"
+		"--- two\n"
+		"--- 3\n";
+	int *value = NULL;
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_INT(CYAML_FLAG_POINTER, int)
+	};
+	test_data_t td = {
+		.data = (cyaml_data_t **) &value,
+		.config = config,
+		.schema = &top_schema,
+	};
+	cyaml_stream_t *stream = NULL;
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_stream_open_data(yaml, YAML_LEN(yaml), config,
+			&top_schema, &stream);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	err = cyaml_stream_next(stream, (cyaml_data_t **) &value, NULL);
+	if (err != CYAML_OK || *value != 1) {
+		cyaml_stream_close(stream);
+		return ttest_fail(&tc, "Bad first document.");
+	}
+
+	err = cyaml_stream_next(stream, (cyaml_data_t **) &value, NULL);
+	if (err != CYAML_ERR_INVALID_VALUE) {
+		cyaml_stream_close(stream);
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	err = cyaml_stream_next(stream, (cyaml_data_t **) &value, NULL);
+	cyaml_stream_close(stream);
+	if (err != CYAML_ERR_INVALID_VALUE) {
+		return ttest_fail(&tc, "Error not kept.");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/** Context for sequence entry streaming tests. */
+struct test_entry_ctx {
+	unsigned count;  /**< Number of entries seen. */
+	int sum;         /**< Sum of entry values. */
+	char *kept;      /**< String taken from an entry. */
+	unsigned fail;   /**< Entry index to reject. */
+};
+
+/** Sequence entry type for sequence entry streaming tests. */
+struct test_entry {
+	int value;
+	char *name;
+};
+
+/**
+ * Sequence entry handler for sequence entry streaming tests.
+ *
+ * \param[in]  ctx    Entry context.
+ * \param[in]  entry  The loaded sequence entry.
+ * \param[in]  index  Index of the entry in the sequence.
+ * \return \ref CYAML_OK on success, or appropriate error code otherwise.
+ */
+static cyaml_err_t test_load_entry_fn(
+		void *ctx,
+		cyaml_data_t *entry,
+		unsigned index)
+{
+	struct test_entry_ctx *entry_ctx = ctx;
+	struct test_entry *e = entry;
+
+	if (index != entry_ctx->count) {
+		return CYAML_ERR_INTERNAL_ERROR;
+	}
+	if (index == entry_ctx->fail) {
+		return CYAML_ERR_INVALID_VALUE;
+	}
+
+	if (index == 1) {
+		/* Take ownership of this entry's name. */
+		entry_ctx->kept = e->name;
+		e->name = NULL;
+	}
+
+	entry_ctx->sum += e->value;
+	entry_ctx->count++;
+
+	return CYAML_OK;
+}
+
+/**
+ * Test loading a top level sequence with entries passed to the client.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_entry_fn_sequence(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char yaml[] =
+		"- { value: 1, name: one }\n"
+		"- { value: 2, name: two }\n"
+		"- { value: 3, name: three }\n"
+		"- { value: 4, name: four }\n";
+	struct test_entry *value = NULL;
+	unsigned count = 0;
+	static const struct cyaml_schema_field entry_fields[] = {
+		CYAML_FIELD_INT("value", CYAML_FLAG_DEFAULT,
+				struct test_entry, value),
+		CYAML_FIELD_STRING_PTR("name", CYAML_FLAG_POINTER,
+				struct test_entry, name,
+				0, CYAML_UNLIMITED),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value entry_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_DEFAULT,
+				struct test_entry, entry_fields),
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_SEQUENCE(CYAML_FLAG_POINTER, struct test_entry,
+				&entry_schema, 0, CYAML_UNLIMITED)
+	};
+	struct test_entry_ctx entry_ctx = {
+		.fail = ~0u,
+	};
+	cyaml_config_t cfg = *config;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &value,
+		.seq_count = &count,
+		.config = config,
+		.schema = &top_schema,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	cfg.entry_fn = test_load_entry_fn;
+	cfg.entry_ctx = &entry_ctx;
+
+	err = cyaml_load_data(yaml, YAML_LEN(yaml), &cfg, &top_schema,
+			(cyaml_data_t **) &value, &count);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (value != NULL) {
+		return ttest_fail(&tc, "Sequence data returned.");
+	}
+
+	if (count != 4 || entry_ctx.count != 4 || entry_ctx.sum != 10) {
+		return ttest_fail(&tc, "Unexpected entries.");
+	}
+
+	if (entry_ctx.kept == NULL || strcmp(entry_ctx.kept, "two") != 0) {
+		free(entry_ctx.kept);
+		return ttest_fail(&tc, "Bad kept entry string.");
+	}
+	free(entry_ctx.kept);
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test a client rejecting a streamed top level sequence entry.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_entry_fn_reject(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char yaml[] =
+		"- { value: 1, name: one }\n"
+		"- { value: 2, name: two }\n"
+		"- { value: 3, name: three }\n";
+	struct test_entry *value = NULL;
+	unsigned count = 0;
+	static const struct cyaml_schema_field entry_fields[] = {
+		CYAML_FIELD_INT("value", CYAML_FLAG_DEFAULT,
+				struct test_entry, value),
+		CYAML_FIELD_STRING_PTR("name", CYAML_FLAG_POINTER,
+				struct test_entry, name,
+				0, CYAML_UNLIMITED),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value entry_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_DEFAULT,
+				struct test_entry, entry_fields),
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_SEQUENCE(CYAML_FLAG_POINTER, struct test_entry,
+				&entry_schema, 0, CYAML_UNLIMITED)
+	};
+	struct test_entry_ctx entry_ctx = {
+		.fail = 2,
+	};
+	cyaml_config_t cfg = *config;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &value,
+		.seq_count = &count,
+		.config = config,
+		.schema = &top_schema,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	cfg.flags |= CYAML_CFG_ARENA;
+	cfg.entry_fn = test_load_entry_fn;
+	cfg.entry_ctx = &entry_ctx;
+
+	err = cyaml_load_data(yaml, YAML_LEN(yaml), &cfg, &top_schema,
+			(cyaml_data_t **) &value, &count);
+	free(entry_ctx.kept);
+	if (err != CYAML_ERR_INVALID_VALUE) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (entry_ctx.count != 2) {
+		return ttest_fail(&tc, "Unexpected entries.");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test loading several documents with a reusable loader.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_loader_reuse(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const char * const yaml[] = {
+		"name: one\n"
+		"values: [ 1 ]\n"
+		"child: { a: 10, b: 100 }\n",
+		"child:\n"
+		"  b: 200\n"
+		"  a: 20\n"
+		"values: [ 2, 2 ]\n"
+		"name: two\n",
+		"{ name: three, values: [ 3, 3, 3 ], child: { a: 30, b: 300 } }\n",
+	};
+	struct child {
+		int a;
+		int b;
+	};
+	struct target_struct {
+		char *name;
+		int *values;
+		unsigned values_count;
+		struct child child;
+	} *data_tgt = NULL;
+	static const struct cyaml_schema_field child_schema[] = {
+		CYAML_FIELD_INT("a", CYAML_FLAG_DEFAULT, struct child, a),
+		CYAML_FIELD_INT("b", CYAML_FLAG_DEFAULT, struct child, b),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value value_schema = {
+		CYAML_VALUE_INT(CYAML_FLAG_DEFAULT, int),
+	};
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_STRING_PTR("name", CYAML_FLAG_POINTER,
+				struct target_struct, name, 0, CYAML_UNLIMITED),
+		CYAML_FIELD_SEQUENCE("values", CYAML_FLAG_POINTER,
+				struct target_struct, values,
+				&value_schema, 0, CYAML_UNLIMITED),
+		CYAML_FIELD_MAPPING("child", CYAML_FLAG_DEFAULT,
+				struct target_struct, child, child_schema),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	static const char * const names[] = { "one", "two", "three" };
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = config,
+		.schema = &top_schema,
+	};
+	cyaml_loader_t *loader = NULL;
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_loader_create(config, &loader);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	for (unsigned i = 0; i < CYAML_ARRAY_LEN(yaml); i++) {
+		int n = (int)i + 1;
+
+		err = cyaml_loader_load_data(loader,
+				(const uint8_t *)yaml[i], strlen(yaml[i]),
+				&top_schema, (cyaml_data_t **) &data_tgt, NULL);
+		if (err != CYAML_OK) {
+			cyaml_loader_destroy(loader);
+			return ttest_fail(&tc, cyaml_strerror(err));
+		}
+
+		if (strcmp(data_tgt->name, names[i]) != 0 ||
+		    data_tgt->values_count != i + 1 ||
+		    data_tgt->values[i] != n ||
+		    data_tgt->child.a != n * 10 ||
+		    data_tgt->child.b != n * 100) {
+			cyaml_loader_destroy(loader);
+			return ttest_fail(&tc, "Incorrect value for doc %u", i);
+		}
+
+		cyaml_free(config, &top_schema, data_tgt, 0);
+		data_tgt = NULL;
+	}
+
+	cyaml_loader_destroy(loader);
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test that a reusable loader recovers from failed loads.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_loader_after_error(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const struct {
+		const char *yaml;
+		cyaml_err_t err;
+	} docs[] = {
+		{ "{ a: 1, b: 2 }\n",       CYAML_OK },
+		{ "{ a: 1, b: two }\n",     CYAML_ERR_INVALID_VALUE },
+		{ "{ a: 3, b: 4 }\n",       CYAML_OK },
+		{ "{ a: 1, b: 2\n",         CYAML_ERR_LIBYAML_PARSER },
+		{ "{ a: 5, b: 6 }\n",       CYAML_OK },
+		{ "{ a: 7 }\n",             CYAML_ERR_MAPPING_FIELD_MISSING },
+		{ "{ a: 7, b: 8 }\n",       CYAML_OK },
+	};
+	struct target_struct {
+		int a;
+		int b;
+	} *data_tgt = NULL;
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_INT("a", CYAML_FLAG_DEFAULT, struct target_struct, a),
+		CYAML_FIELD_INT("b", CYAML_FLAG_DEFAULT, struct target_struct, b),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = config,
+		.schema = &top_schema,
+	};
+	cyaml_loader_t *loader = NULL;
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_loader_create(config, &loader);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	for (unsigned i = 0; i < CYAML_ARRAY_LEN(docs); i++) {
+		err = cyaml_loader_load_data(loader,
+				(const uint8_t *)docs[i].yaml,
+				strlen(docs[i].yaml), &top_schema,
+				(cyaml_data_t **) &data_tgt, NULL);
+		if (err != docs[i].err) {
+			cyaml_loader_destroy(loader);
+			return ttest_fail(&tc, "Doc %u: %s", i,
+					cyaml_strerror(err));
+		}
+
+		if (err != CYAML_OK) {
+			continue;
+		}
+
+		if (data_tgt->b != data_tgt->a + 1) {
+			cyaml_loader_destroy(loader);
+			return ttest_fail(&tc, "Incorrect value for doc %u", i);
+		}
+
+		cyaml_free(config, &top_schema, data_tgt, 0);
+		data_tgt = NULL;
+	}
+
+	cyaml_loader_destroy(loader);
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test loading a batch of documents from memory on several threads.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_batch_data(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	enum { ITEM_COUNT = 64 };
+	static char yaml[ITEM_COUNT][64];
+	struct target_struct {
+		int id;
+		int *values;
+		unsigned values_count;
+	};
+	static const struct cyaml_schema_value value_schema = {
+		CYAML_VALUE_INT(CYAML_FLAG_DEFAULT, int),
+	};
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_INT("id", CYAML_FLAG_DEFAULT,
+				struct target_struct, id),
+		CYAML_FIELD_SEQUENCE("values", CYAML_FLAG_POINTER,
+				struct target_struct, values,
+				&value_schema, 0, CYAML_UNLIMITED),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	cyaml_batch_item_t items[ITEM_COUNT] = { { 0 } };
+	test_data_t td = {
+		.config = config,
+		.schema = &top_schema,
+	};
+	cyaml_err_t err;
+	bool ok = true;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	for (unsigned i = 0; i < ITEM_COUNT; i++) {
+		items[i].input_len = (size_t)sprintf(yaml[i],
+				"id: %u\nvalues: [ %u, %u ]\n", i, i, i * 2);
+		items[i].input = (const uint8_t *)yaml[i];
+	}
+
+	err = cyaml_load_batch(items, ITEM_COUNT, 4, config, &top_schema);
+
+	for (unsigned i = 0; i < ITEM_COUNT; i++) {
+		const struct target_struct *data = items[i].data;
+
+		if (items[i].err != CYAML_OK || data == NULL ||
+		    data->id != (int)i || data->values_count != 2 ||
+		    data->values[1] != (int)i * 2) {
+			ok = false;
+		}
+		cyaml_free(config, &top_schema, items[i].data, 0);
+	}
+
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (!ok) {
+		return ttest_fail(&tc, "Incorrect value.");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test loading a batch of documents, where some of them are invalid.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_batch_errors(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const struct {
+		const char *yaml;
+		cyaml_err_t err;
+	} docs[] = {
+		{ "[ 1, 2, 3 ]\n",    CYAML_OK },
+		{ "[ 1, two ]\n",     CYAML_ERR_INVALID_VALUE },
+		{ "[ 4 ]\n",          CYAML_OK },
+		{ "[ 1, 2\n",         CYAML_ERR_LIBYAML_PARSER },
+		{ "[ ]\n",            CYAML_OK },
+	};
+	static const struct cyaml_schema_value entry_schema = {
+		CYAML_VALUE_INT(CYAML_FLAG_DEFAULT, int),
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_SEQUENCE(CYAML_FLAG_POINTER, int,
+				&entry_schema, 0, CYAML_UNLIMITED),
+	};
+	static const unsigned counts[] = { 3, 0, 1, 0, 0 };
+	cyaml_batch_item_t items[CYAML_ARRAY_LEN(docs)] = { { 0 } };
+	test_data_t td = {
+		.config = config,
+		.schema = &top_schema,
+	};
+	cyaml_err_t err;
+	bool ok = true;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	for (unsigned i = 0; i < CYAML_ARRAY_LEN(docs); i++) {
+		items[i].input = (const uint8_t *)docs[i].yaml;
+		items[i].input_len = strlen(docs[i].yaml);
+	}
+
+	err = cyaml_load_batch(items, CYAML_ARRAY_LEN(items), 0,
+			config, &top_schema);
+
+	for (unsigned i = 0; i < CYAML_ARRAY_LEN(items); i++) {
+		if (items[i].err != docs[i].err ||
+		    items[i].seq_count != counts[i] ||
+		    (items[i].err != CYAML_OK && items[i].data != NULL)) {
+			ok = false;
+		}
+		cyaml_free(config, &top_schema, items[i].data,
+				items[i].seq_count);
+	}
+
+	if (err != CYAML_ERR_INVALID_VALUE) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (!ok) {
+		return ttest_fail(&tc, "Incorrect item result.");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test loading enums with enough strings to be indexed.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_enum_indexed(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const cyaml_strval_t strings[] = {
+		{ "zero",      0 }, { "one",      1 }, { "two",     2 },
+		{ "three",     3 }, { "four",     4 }, { "five",    5 },
+		{ "six",       6 }, { "seven",    7 }, { "eight",   8 },
+		{ "nine",      9 }, { "Ten",     10 }, { "three",  33 },
+		{ "minus-one", -1 }, { "ELEVEN", 11 },
+	};
+	static const int expected[] = { 3, 10, 11, -1, 9, 99, 0 };
+	static const unsigned char yaml[] =
+		"[ three, ten, eleven, Minus-One, nine, 99, ZERO ]\n";
+	int *data_tgt = NULL;
+	unsigned count = 0;
+	static const struct cyaml_schema_value entry_schema = {
+		CYAML_VALUE_ENUM(CYAML_FLAG_CASE_INSENSITIVE, int,
+				strings, CYAML_ARRAY_LEN(strings)),
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_SEQUENCE(CYAML_FLAG_POINTER, int,
+				&entry_schema, 0, CYAML_UNLIMITED),
+	};
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.seq_count = &count,
+		.config = config,
+		.schema = &top_schema,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_load_data(yaml, YAML_LEN(yaml), config, &top_schema,
+			(cyaml_data_t **) &data_tgt, &count);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (count != CYAML_ARRAY_LEN(expected)) {
+		return ttest_fail(&tc, "Incorrect sequence count");
+	}
+
+	for (unsigned i = 0; i < count; i++) {
+		if (data_tgt[i] != expected[i]) {
+			return ttest_fail(&tc, "Incorrect value for entry %u",
+					i);
+		}
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test loading flags with enough strings to be indexed.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_flags_indexed(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const cyaml_strval_t strings[] = {
+		{ "f0", 1 << 0 }, { "f1", 1 << 1 }, { "f2", 1 << 2 },
+		{ "f3", 1 << 3 }, { "f4", 1 << 4 }, { "f5", 1 << 5 },
+		{ "f6", 1 << 6 }, { "f7", 1 << 7 }, { "f8", 1 << 8 },
+		{ "f9", 1 << 9 }, { "low", 0x3 },
+	};
+	static const unsigned char yaml[] =
+		"test_flags: [ f9, low, f5 ]\n"
+		"test_strict: [ f8, f10 ]\n";
+	struct target_struct {
+		unsigned test_flags;
+		unsigned test_strict;
+	} *data_tgt = NULL;
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_FLAGS("test_flags", CYAML_FLAG_DEFAULT,
+				struct target_struct, test_flags,
+				strings, CYAML_ARRAY_LEN(strings)),
+		CYAML_FIELD_FLAGS("test_strict",
+				CYAML_FLAG_STRICT | CYAML_FLAG_OPTIONAL,
+				struct target_struct, test_strict,
+				strings, CYAML_ARRAY_LEN(strings)),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = config,
+		.schema = &top_schema,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_load_data(yaml, YAML_LEN(yaml), config, &top_schema,
+			(cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_ERR_INVALID_VALUE) {
+		return ttest_fail(&tc, "Unexpected result: %s",
+				cyaml_strerror(err));
+	}
+
+	/* Just the first line. */
+	err = cyaml_load_data(yaml, strchr((const char *)yaml, '\n') -
+			(const char *)yaml + 1, config, &top_schema,
+			(cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (data_tgt->test_flags != ((1 << 9) | (1 << 5) | 0x3)) {
+		return ttest_fail(&tc, "Incorrect value");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test gathering statistics while loading.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_stats(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char yaml[] =
+		"a: 1\n"
+		"skip: { x: [ 1, 2 ], y: 3 }\n"
+		"b: [ 1, 2, 3 ]\n";
+	struct target_struct {
+		int a;
+		int *b;
+		unsigned b_count;
+	} *data_tgt = NULL;
+	static const struct cyaml_schema_value entry_schema = {
+		CYAML_VALUE_INT(CYAML_FLAG_DEFAULT, int),
+	};
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_INT("a", CYAML_FLAG_DEFAULT,
+				struct target_struct, a),
+		CYAML_FIELD_SEQUENCE("b", CYAML_FLAG_POINTER,
+				struct target_struct, b,
+				&entry_schema, 0, CYAML_UNLIMITED),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	cyaml_stats_t stats = { .timing = false };
+	cyaml_config_t cfg = *config;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = &cfg,
+		.schema = &top_schema,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	cfg.flags |= CYAML_CFG_IGNORE_UNKNOWN_KEYS;
+	cfg.stats = &stats;
+
+	err = cyaml_load_data(yaml, YAML_LEN(yaml), &cfg, &top_schema,
+			(cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (data_tgt->a != 1 || data_tgt->b_count != 3) {
+		return ttest_fail(&tc, "Incorrect value");
+	}
+
+	cyaml_free(&cfg, &top_schema, data_tgt, 0);
+	data_tgt = NULL;
+
+#ifdef CYAML_STATS
+	if (stats.events[CYAML_STATS_EVT_STRM_START] != 1 ||
+	    stats.events[CYAML_STATS_EVT_DOC_END] != 1 ||
+	    stats.events[CYAML_STATS_EVT_MAP_START] != 2 ||
+	    stats.events[CYAML_STATS_EVT_SEQ_END] != 2 ||
+	    stats.events[CYAML_STATS_EVT_SCALAR] != 12 ||
+	    stats.events[CYAML_STATS_EVT_ALIAS] != 0) {
+		return ttest_fail(&tc, "Incorrect event counts");
+	}
+
+	if (stats.ignored_values != 1) {
+		return ttest_fail(&tc, "Incorrect ignored value count: %"PRIu64,
+				stats.ignored_values);
+	}
+
+	if (stats.stack_peak != 5) {
+		return ttest_fail(&tc, "Incorrect stack peak: %"PRIu32,
+				stats.stack_peak);
+	}
+
+	if (stats.key_probes != 5) {
+		return ttest_fail(&tc, "Incorrect key probe count: %"PRIu64,
+				stats.key_probes);
+	}
+
+	if (stats.mem_allocs == 0 || stats.mem_bytes == 0 ||
+	    stats.mem_allocs != stats.mem_frees) {
+		return ttest_fail(&tc, "Incorrect memory counts");
+	}
+#else
+	if (stats.events[CYAML_STATS_EVT_SCALAR] != 0 ||
+	    stats.mem_allocs != 0) {
+		return ttest_fail(&tc, "Statistics gathered when disabled");
+	}
+#endif
+
+	if (stats.parse_ns != 0 || stats.decode_ns != 0 ||
+	    stats.emit_ns != 0 || stats.events_emitted != 0) {
+		return ttest_fail(&tc, "Unexpected timing or emitter counts");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/** Enum for \ref test_load_schema_compiled. */
+enum compiled_enum {
+	ONE = 1, TWO, THREE, FOUR, FIVE, SIX, SEVEN, EIGHT, NINE,
+};
+
+/** String values for \ref compiled_enum. */
+static const cyaml_strval_t compiled_strings[] = {
+	{ "one",   ONE   }, { "two",   TWO   }, { "three", THREE },
+	{ "four",  FOUR  }, { "five",  FIVE  }, { "six",   SIX   },
+	{ "seven", SEVEN }, { "eight", EIGHT }, { "nine",  NINE  },
+};
+
+/** Target structure for \ref test_load_schema_compiled. */
+struct compiled_struct {
+	int a, b, c, d, f, g, h, i, j, k;
+	enum compiled_enum e;
+	char **names;
+	unsigned names_count;
+	struct compiled_struct *next;
+};
+
+/** Schema for \ref compiled_struct names. */
+static const struct cyaml_schema_value compiled_name_schema = {
+	CYAML_VALUE_STRING(CYAML_FLAG_POINTER, char, 0, 8),
+};
+
+/** Schema fields for \ref compiled_struct. */
+static const struct cyaml_schema_field compiled_fields[] = {
+	CYAML_FIELD_INT("a", CYAML_FLAG_DEFAULT,
+			struct compiled_struct, a),
+	CYAML_FIELD_INT("b", CYAML_FLAG_OPTIONAL,
+			struct compiled_struct, b),
+	CYAML_FIELD_INT("c", CYAML_FLAG_OPTIONAL,
+			struct compiled_struct, c),
+	CYAML_FIELD_INT("d", CYAML_FLAG_OPTIONAL,
+			struct compiled_struct, d),
+	CYAML_FIELD_INT("f", CYAML_FLAG_OPTIONAL,
+			struct compiled_struct, f),
+	CYAML_FIELD_INT("g", CYAML_FLAG_OPTIONAL,
+			struct compiled_struct, g),
+	CYAML_FIELD_INT("h", CYAML_FLAG_OPTIONAL,
+			struct compiled_struct, h),
+	CYAML_FIELD_INT("i", CYAML_FLAG_OPTIONAL,
+			struct compiled_struct, i),
+	CYAML_FIELD_INT("j", CYAML_FLAG_OPTIONAL,
+			struct compiled_struct, j),
+	CYAML_FIELD_INT("k", CYAML_FLAG_OPTIONAL,
+			struct compiled_struct, k),
+	CYAML_FIELD_ENUM("e", CYAML_FLAG_OPTIONAL,
+			struct compiled_struct, e,
+			compiled_strings,
+			CYAML_ARRAY_LEN(compiled_strings)),
+	CYAML_FIELD_SEQUENCE("names",
+			CYAML_FLAG_POINTER | CYAML_FLAG_OPTIONAL,
+			struct compiled_struct, names,
+			&compiled_name_schema, 0, CYAML_UNLIMITED),
+	CYAML_FIELD_MAPPING_PTR("next", CYAML_FLAG_OPTIONAL,
+			struct compiled_struct, next, compiled_fields),
+	CYAML_FIELD_END
+};
+
+/** Top-level schema for \ref test_load_schema_compiled. */
+static const struct cyaml_schema_value compiled_schema = {
+	CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+			struct compiled_struct, compiled_fields),
+};
+
+/**
+ * Test loading and freeing with a compiled schema.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_schema_compiled(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char yaml[] =
+		"k: 10\n"
+		"e: nine\n"
+		"names: [ a, bb, ccc ]\n"
+		"next: { a: 1, next: { a: 2 } }\n"
+		"a: 3\n";
+	struct compiled_struct *data_tgt = NULL;
+	cyaml_schema_compiled_t *compiled = NULL;
+	cyaml_config_t cfg = *config;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = config,
+		.schema = &compiled_schema,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_schema_compile(config, &compiled_schema, &compiled);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+	cfg.compiled = compiled;
+
+	/* The compiled schema is ignored when the case setting differs. */
+	for (unsigned i = 0; i < 2; i++) {
+		if (i == 1) {
+			cfg.flags |= CYAML_CFG_CASE_INSENSITIVE;
+		}
+
+		err = cyaml_load_data(yaml, YAML_LEN(yaml), &cfg, &compiled_schema,
+				(cyaml_data_t **) &data_tgt, NULL);
+		if (err != CYAML_OK) {
+			cyaml_schema_compiled_free(config, compiled);
+			return ttest_fail(&tc, cyaml_strerror(err));
+		}
+
+		if (data_tgt->a != 3 || data_tgt->k != 10 ||
+		    data_tgt->e != NINE || data_tgt->names_count != 3 ||
+		    strcmp(data_tgt->names[2], "ccc") != 0 ||
+		    data_tgt->next == NULL || data_tgt->next->a != 1 ||
+		    data_tgt->next->next == NULL ||
+		    data_tgt->next->next->a != 2 ||
+		    data_tgt->next->next->next != NULL) {
+			cyaml_schema_compiled_free(config, compiled);
+			return ttest_fail(&tc, "Incorrect value (pass %u)", i);
+		}
+
+		cyaml_free(&cfg, &compiled_schema, data_tgt, 0);
+		data_tgt = NULL;
+	}
+
+	cyaml_schema_compiled_free(config, compiled);
+	return ttest_pass(&tc);
+}
+
+/** Number of fields in \ref test_load_mapping_many_fields's mapping. */
+#define TEST_MANY_FIELDS 70
+
+/**
+ * Test loading mappings with too many fields to track in the state stack.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_mapping_many_fields(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	struct small {
+		int x;
+	};
+	struct target_struct {
+		struct small inner;
+		int v[TEST_MANY_FIELDS];
+	} *data_tgt = NULL;
+	static const struct cyaml_schema_field small_schema[] = {
+		CYAML_FIELD_INT("x", CYAML_FLAG_DEFAULT, struct small, x),
+		CYAML_FIELD_END
+	};
+	static char keys[TEST_MANY_FIELDS][8];
+	static struct cyaml_schema_field mapping_schema[
+			TEST_MANY_FIELDS + 2];
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = config,
+		.schema = &top_schema,
+	};
+	char yaml[TEST_MANY_FIELDS * 16 + 32];
+	size_t len = 0;
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	/* The small mapping comes before the final field, so the large
+	 * mapping's bit field must survive it. */
+	for (unsigned i = 0; i < TEST_MANY_FIELDS; i++) {
+		unsigned f = (i < TEST_MANY_FIELDS - 1) ? i : i + 1;
+		sprintf(keys[i], "f%u", i);
+		mapping_schema[f] = (struct cyaml_schema_field)
+				CYAML_FIELD_INT(keys[i], CYAML_FLAG_DEFAULT,
+						struct target_struct, v[i]);
+		len += sprintf(yaml + len, "%s%s: %u\n",
+				(i == TEST_MANY_FIELDS - 1) ?
+						"inner: { x: 5 }\n" : "",
+				keys[i], i * 3);
+	}
+	mapping_schema[TEST_MANY_FIELDS - 1] = (struct cyaml_schema_field)
+			CYAML_FIELD_MAPPING("inner", CYAML_FLAG_DEFAULT,
+					struct target_struct, inner,
+					small_schema);
+	mapping_schema[TEST_MANY_FIELDS + 1] = (struct cyaml_schema_field)
+			CYAML_FIELD_END;
+
+	err = cyaml_load_data((const uint8_t *)yaml, len, config,
+			&top_schema, (cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (data_tgt->inner.x != 5) {
+		return ttest_fail(&tc, "Incorrect value for inner mapping");
+	}
+	for (unsigned i = 0; i < TEST_MANY_FIELDS; i++) {
+		if (data_tgt->v[i] != (int)i * 3) {
+			return ttest_fail(&tc, "Incorrect value for %s",
+					keys[i]);
+		}
+	}
+
+	cyaml_free(config, &top_schema, data_tgt, 0);
+	data_tgt = NULL;
+
+	/* Drop the last field, which is beyond the first 64. */
+	len = strstr(yaml, keys[TEST_MANY_FIELDS - 1]) - yaml;
+	err = cyaml_load_data((const uint8_t *)yaml, len, config,
+			&top_schema, (cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_ERR_MAPPING_FIELD_MISSING) {
+		return ttest_fail(&tc, "Unexpected result: %s",
+				cyaml_strerror(err));
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test that load state is allocated up front, from the schema.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_state_presized(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char yaml[] =
+		"a: { b: { c: { d: { e: { f: { g: { h: { i: { j: "
+		"{ k: { l: { m: { n: { o: { p: { q: { r: 1 } } } } } } } } "
+		"} } } } } } } } }\n";
+	struct target_struct {
+		int a[1];
+	} *data_tgt = NULL;
+	/* Seventeen nested mappings, keyed "a" to "q", around "r". */
+	static struct cyaml_schema_field levels[17][2];
+	static const char * const keys[] = {
+		"a", "b", "c", "d", "e", "f", "g", "h", "i",
+		"j", "k", "l", "m", "n", "o", "p", "q",
+	};
+	static const struct cyaml_schema_field innermost[] = {
+		CYAML_FIELD_INT("r", CYAML_FLAG_DEFAULT,
+				struct target_struct, a[0]),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, levels[0]),
+	};
+	cyaml_stats_t stats = { .timing = false };
+	cyaml_config_t cfg = *config;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = &cfg,
+		.schema = &top_schema,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	for (unsigned i = 0; i < 17; i++) {
+		levels[i][0] = (struct cyaml_schema_field)
+				CYAML_FIELD_MAPPING(keys[i], CYAML_FLAG_DEFAULT,
+						struct target_struct, a,
+						(i == 16) ? innermost :
+								levels[i + 1]);
+		levels[i][1] = (struct cyaml_schema_field) CYAML_FIELD_END;
+	}
+	cfg.stats = &stats;
+
+	err = cyaml_load_data(yaml, YAML_LEN(yaml), &cfg, &top_schema,
+			(cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (data_tgt->a[0] != 1) {
+		return ttest_fail(&tc, "Incorrect value");
+	}
+
+	cyaml_free(&cfg, &top_schema, data_tgt, 0);
+	data_tgt = NULL;
+
+#ifdef CYAML_STATS
+	/* One for the state stack, and one for the loaded data. */
+	if (stats.mem_allocs != 2 || stats.mem_reallocs != 0) {
+		return ttest_fail(&tc, "Unexpected allocations: "
+				"%"PRIu64" allocs, %"PRIu64" reallocs",
+				stats.mem_allocs, stats.mem_reallocs);
+	}
+	if (stats.stack_peak != 3 + 18) {
+		return ttest_fail(&tc, "Incorrect stack peak: %"PRIu32,
+				stats.stack_peak);
+	}
+#endif
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test loading a projection of a document.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_projection(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char yaml[] =
+		"- id: 1\n"
+		"  inner: { x: 5, y: 6 }\n"
+		"  extra: 7\n"
+		"  unknown: { deep: [ 1, 2, { z: 3 } ] }\n"
+		"- extra: 8\n"
+		"  id: 2\n"
+		"  unknown: [ a, b, c ]\n"
+		"  inner: { y: 9, x: 10, w: 11 }\n";
+	struct inner_struct {
+		int x;
+		int y;
+	};
+	struct target_struct {
+		int id;
+		int extra;
+		struct inner_struct inner;
+	} *data_tgt = NULL;
+	static const struct cyaml_schema_field inner_schema[] = {
+		CYAML_FIELD_INT("x", CYAML_FLAG_DEFAULT,
+				struct inner_struct, x),
+		CYAML_FIELD_INT("y", CYAML_FLAG_OPTIONAL,
+				struct inner_struct, y),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_INT("id", CYAML_FLAG_DEFAULT,
+				struct target_struct, id),
+		CYAML_FIELD_INT("extra", CYAML_FLAG_OPTIONAL,
+				struct target_struct, extra),
+		CYAML_FIELD_MAPPING("inner", CYAML_FLAG_OPTIONAL,
+				struct target_struct, inner, inner_schema),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value entry_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_DEFAULT,
+				struct target_struct, mapping_schema),
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_SEQUENCE(CYAML_FLAG_POINTER,
+				struct target_struct, &entry_schema,
+				0, CYAML_UNLIMITED),
+	};
+	cyaml_stats_t stats = { .timing = false };
+	cyaml_config_t cfg = *config;
+	unsigned count = 0;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.seq_count = &count,
+		.config = &cfg,
+		.schema = &top_schema,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	cfg.flags |= CYAML_CFG_PROJECTION;
+	cfg.stats = &stats;
+
+	err = cyaml_load_data(yaml, YAML_LEN(yaml), &cfg, &top_schema,
+			(cyaml_data_t **) &data_tgt, &count);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (count != 2) {
+		return ttest_fail(&tc, "Incorrect sequence count");
+	}
+
+	/* Everything after "id" is skipped in the first entry. */
+	if (data_tgt[0].id != 1 || data_tgt[0].extra != 0 ||
+	    data_tgt[0].inner.x != 0 || data_tgt[0].inner.y != 0) {
+		return ttest_fail(&tc, "Incorrect value for entry 0");
+	}
+
+	/* Optional fields before "id" are loaded. */
+	if (data_tgt[1].id != 2 || data_tgt[1].extra != 8 ||
+	    data_tgt[1].inner.x != 0) {
+		return ttest_fail(&tc, "Incorrect value for entry 1");
+	}
+
+#ifdef CYAML_STATS
+	if (stats.ignored_values != 2) {
+		return ttest_fail(&tc, "Incorrect ignored value count: %"PRIu64,
+				stats.ignored_values);
+	}
+#endif
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test projection leaves mappings without required fields to load fully.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_projection_nested(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char yaml[] =
+		"opt: 1\n"
+		"inner: { b: 2, a: 3, c: 4 }\n"
+		"last: 5\n";
+	struct inner_struct {
+		int a;
+		int b;
+	};
+	struct target_struct {
+		int opt;
+		struct inner_struct inner;
+		int last;
+	} *data_tgt = NULL;
+	static const struct cyaml_schema_field inner_schema[] = {
+		CYAML_FIELD_INT("a", CYAML_FLAG_DEFAULT,
+				struct inner_struct, a),
+		CYAML_FIELD_INT("b", CYAML_FLAG_DEFAULT,
+				struct inner_struct, b),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_INT("opt", CYAML_FLAG_OPTIONAL,
+				struct target_struct, opt),
+		CYAML_FIELD_MAPPING("inner", CYAML_FLAG_OPTIONAL,
+				struct target_struct, inner, inner_schema),
+		CYAML_FIELD_INT("last", CYAML_FLAG_OPTIONAL,
+				struct target_struct, last),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	cyaml_config_t cfg = *config;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = &cfg,
+		.schema = &top_schema,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	cfg.flags |= CYAML_CFG_PROJECTION;
+
+	err = cyaml_load_data(yaml, YAML_LEN(yaml), &cfg, &top_schema,
+			(cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (data_tgt->opt != 1 || data_tgt->inner.a != 3 ||
+	    data_tgt->inner.b != 2 || data_tgt->last != 5) {
+		return ttest_fail(&tc, "Incorrect value");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test loading limits of each numeric type through bulk sequences.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_sequence_bulk_limits(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char yaml[] =
+		"i8: [ -128, 127, 0x7f ]\n"
+		"u16: [ 0, 65535 ]\n"
+		"i64: [ -9223372036854775808, 9223372036854775807 ]\n"
+		"u64: [ 18446744073709551615 ]\n"
+		"f: [ 0.5, -1.25e3 ]\n"
+		"d: [ 0.1, 1e300 ]\n";
+	struct target_struct {
+		int8_t *i8;
+		uint8_t i8_count;
+		uint16_t u16[2];
+		uint16_t u16_count;
+		int64_t i64[2];
+		uint64_t i64_count;
+		uint64_t *u64;
+		uint32_t u64_count;
+		float *f;
+		uint32_t f_count;
+		double d[2];
+	} *data_tgt = NULL;
+	static const struct cyaml_schema_value i8_schema = {
+		CYAML_VALUE_INT(CYAML_FLAG_DEFAULT, int8_t),
+	};
+	static const struct cyaml_schema_value u16_schema = {
+		CYAML_VALUE_UINT(CYAML_FLAG_DEFAULT, uint16_t),
+	};
+	static const struct cyaml_schema_value i64_schema = {
+		CYAML_VALUE_INT(CYAML_FLAG_DEFAULT, int64_t),
+	};
+	static const struct cyaml_schema_value u64_schema = {
+		CYAML_VALUE_UINT(CYAML_FLAG_DEFAULT, uint64_t),
+	};
+	static const struct cyaml_schema_value f_schema = {
+		CYAML_VALUE_FLOAT(CYAML_FLAG_DEFAULT, float),
+	};
+	static const struct cyaml_schema_value d_schema = {
+		CYAML_VALUE_FLOAT(CYAML_FLAG_DEFAULT, double),
+	};
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_SEQUENCE("i8", CYAML_FLAG_POINTER,
+				struct target_struct, i8, &i8_schema,
+				0, CYAML_UNLIMITED),
+		CYAML_FIELD_SEQUENCE("u16", CYAML_FLAG_DEFAULT,
+				struct target_struct, u16, &u16_schema,
+				0, 2),
+		CYAML_FIELD_SEQUENCE("i64", CYAML_FLAG_DEFAULT,
+				struct target_struct, i64, &i64_schema,
+				0, 2),
+		CYAML_FIELD_SEQUENCE("u64", CYAML_FLAG_POINTER,
+				struct target_struct, u64, &u64_schema,
+				0, CYAML_UNLIMITED),
+		CYAML_FIELD_SEQUENCE("f", CYAML_FLAG_POINTER,
+				struct target_struct, f, &f_schema,
+				0, CYAML_UNLIMITED),
+		CYAML_FIELD_SEQUENCE_FIXED("d", CYAML_FLAG_DEFAULT,
+				struct target_struct, d, &d_schema, 2),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = config,
+		.schema = &top_schema,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_load_data(yaml, YAML_LEN(yaml), config, &top_schema,
+			(cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (data_tgt->i8_count != 3 || data_tgt->u16_count != 2 ||
+	    data_tgt->i64_count != 2 || data_tgt->u64_count != 1 ||
+	    data_tgt->f_count != 2) {
+		return ttest_fail(&tc, "Incorrect sequence count");
+	}
+
+	if (data_tgt->i8[0] != INT8_MIN || data_tgt->i8[1] != INT8_MAX ||
+	    data_tgt->i8[2] != INT8_MAX) {
+		return ttest_fail(&tc, "Incorrect int8_t value");
+	}
+	if (data_tgt->u16[0] != 0 || data_tgt->u16[1] != UINT16_MAX) {
+		return ttest_fail(&tc, "Incorrect uint16_t value");
+	}
+	if (data_tgt->i64[0] != INT64_MIN || data_tgt->i64[1] != INT64_MAX) {
+		return ttest_fail(&tc, "Incorrect int64_t value");
+	}
+	if (data_tgt->u64[0] != UINT64_MAX) {
+		return ttest_fail(&tc, "Incorrect uint64_t value");
+	}
+	if (data_tgt->f[0] != 0.5f || data_tgt->f[1] != -1250.0f) {
+		return ttest_fail(&tc, "Incorrect float value");
+	}
+	if (data_tgt->d[0] != 0.1 || data_tgt->d[1] != 1e300) {
+		return ttest_fail(&tc, "Incorrect double value");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test loading out of range values through bulk sequences.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_sequence_bulk_range(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const char * const yaml[] = {
+		"i8: [ 1, 128 ]\n",
+		"i8: [ -129 ]\n",
+		"u8: [ 256 ]\n",
+		"u8: [ -1 ]\n",
+		"u8: [ 1, x ]\n",
+		"f: [ 1e39 ]\n",
+	};
+	struct target_struct {
+		int8_t *i8;
+		uint32_t i8_count;
+		uint8_t *u8;
+		uint32_t u8_count;
+		float *f;
+		uint32_t f_count;
+	} *data_tgt = NULL;
+	static const struct cyaml_schema_value i8_schema = {
+		CYAML_VALUE_INT(CYAML_FLAG_DEFAULT, int8_t),
+	};
+	static const struct cyaml_schema_value u8_schema = {
+		CYAML_VALUE_UINT(CYAML_FLAG_DEFAULT, uint8_t),
+	};
+	static const struct cyaml_schema_value f_schema = {
+		CYAML_VALUE_FLOAT(CYAML_FLAG_DEFAULT, float),
+	};
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_SEQUENCE("i8", CYAML_FLAG_POINTER |
+				CYAML_FLAG_OPTIONAL,
+				struct target_struct, i8, &i8_schema,
+				0, CYAML_UNLIMITED),
+		CYAML_FIELD_SEQUENCE("u8", CYAML_FLAG_POINTER |
+				CYAML_FLAG_OPTIONAL,
+				struct target_struct, u8, &u8_schema,
+				0, CYAML_UNLIMITED),
+		CYAML_FIELD_SEQUENCE("f", CYAML_FLAG_POINTER |
+				CYAML_FLAG_OPTIONAL,
+				struct target_struct, f, &f_schema,
+				0, CYAML_UNLIMITED),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = config,
+		.schema = &top_schema,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	for (unsigned i = 0; i < CYAML_ARRAY_LEN(yaml); i++) {
+		err = cyaml_load_data((const uint8_t *) yaml[i],
+				strlen(yaml[i]), config, &top_schema,
+				(cyaml_data_t **) &data_tgt, NULL);
+		if (err != CYAML_ERR_INVALID_VALUE) {
+			return ttest_fail(&tc, "Unexpected result (i=%u): %s",
+					i, cyaml_strerror(err));
+		}
+		if (data_tgt != NULL) {
+			return ttest_fail(&tc, "Data non-NULL on error.");
+		}
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test the nesting depth limit, including within ignored values.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_limit_depth(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char yaml[] =
+		"inner:\n"
+		"  seq: [ 1, 2 ]\n";
+	static const unsigned char yaml_ignored[] =
+		"inner:\n"
+		"  seq: [ 1, 2 ]\n"
+		"  other: [ [ 3 ] ]\n";
+	struct inner_struct {
+		int *seq;
+		unsigned seq_count;
+	};
+	struct target_struct {
+		struct inner_struct inner;
+	} *data_tgt = NULL;
+	static const struct cyaml_schema_value entry_schema = {
+		CYAML_VALUE_INT(CYAML_FLAG_DEFAULT, int),
+	};
+	static const struct cyaml_schema_field inner_schema[] = {
+		CYAML_FIELD_SEQUENCE("seq", CYAML_FLAG_POINTER,
+				struct inner_struct, seq, &entry_schema,
+				0, CYAML_UNLIMITED),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_MAPPING("inner", CYAML_FLAG_DEFAULT,
+				struct target_struct, inner, inner_schema),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	cyaml_config_t cfg = *config;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = &cfg,
+		.schema = &top_schema,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	cfg.flags |= CYAML_CFG_IGNORE_UNKNOWN_KEYS;
+	cfg.limits.max_depth = 3;
+
+	err = cyaml_load_data(yaml, YAML_LEN(yaml), &cfg, &top_schema,
+			(cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+	if (data_tgt->inner.seq_count != 2) {
+		return ttest_fail(&tc, "Incorrect sequence count");
+	}
+	cyaml_cleanup(&td);
+	data_tgt = NULL;
+
+	err = cyaml_load_data(yaml_ignored, YAML_LEN(yaml_ignored), &cfg,
+			&top_schema, (cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_ERR_LIMIT_EXCEEDED) {
+		return ttest_fail(&tc, "Ignored value: %s",
+				cyaml_strerror(err));
+	}
+
+	cfg.limits.max_depth = 2;
+
+	err = cyaml_load_data(yaml, YAML_LEN(yaml), &cfg, &top_schema,
+			(cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_ERR_LIMIT_EXCEEDED) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+	if (data_tgt != NULL) {
+		return ttest_fail(&tc, "Data non-NULL on error.");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test the total entry limit.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_limit_entries(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char yaml[] =
+		"seq: [ 1, 2, 3, 4, 5, 6, 7, 8 ]\n"
+		"value: 9\n";
+	struct target_struct {
+		int *seq;
+		unsigned seq_count;
+		int value;
+	} *data_tgt = NULL;
+	static const struct cyaml_schema_value entry_schema = {
+		CYAML_VALUE_INT(CYAML_FLAG_DEFAULT, int),
+	};
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_SEQUENCE("seq", CYAML_FLAG_POINTER,
+				struct target_struct, seq, &entry_schema,
+				0, CYAML_UNLIMITED),
+		CYAML_FIELD_INT("value", CYAML_FLAG_DEFAULT,
+				struct target_struct, value),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	cyaml_config_t cfg = *config;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = &cfg,
+		.schema = &top_schema,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	/* Two mapping keys and eight sequence entries. */
+	cfg.limits.max_entries = 10;
+
+	err = cyaml_load_data(yaml, YAML_LEN(yaml), &cfg, &top_schema,
+			(cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+	if (data_tgt->seq_count != 8 || data_tgt->value != 9) {
+		return ttest_fail(&tc, "Incorrect value");
+	}
+	cyaml_cleanup(&td);
+	data_tgt = NULL;
+
+	cfg.limits.max_entries = 9;
+
+	err = cyaml_load_data(yaml, YAML_LEN(yaml), &cfg, &top_schema,
+			(cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_ERR_LIMIT_EXCEEDED) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+	if (data_tgt != NULL) {
+		return ttest_fail(&tc, "Data non-NULL on error.");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test the allocated bytes limit.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_limit_bytes(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char yaml[] =
+		"name: abc\n"
+		"seq: [ 1, 2, 3, 4 ]\n";
+	struct target_struct {
+		char *name;
+		uint32_t *seq;
+		unsigned seq_count;
+	} *data_tgt = NULL;
+	static const struct cyaml_schema_value entry_schema = {
+		CYAML_VALUE_UINT(CYAML_FLAG_DEFAULT, uint32_t),
+	};
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_STRING_PTR("name", CYAML_FLAG_POINTER,
+				struct target_struct, name,
+				0, CYAML_UNLIMITED),
+		CYAML_FIELD_SEQUENCE("seq", CYAML_FLAG_POINTER,
+				struct target_struct, seq, &entry_schema,
+				0, CYAML_UNLIMITED),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	/* The mapping, the string with its terminator, and the sequence. */
+	size_t size = sizeof(*data_tgt) + 4 + 4 * sizeof(uint32_t);
+	cyaml_config_t cfg = *config;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = &cfg,
+		.schema = &top_schema,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	cfg.limits.max_bytes = size;
+
+	err = cyaml_load_data(yaml, YAML_LEN(yaml), &cfg, &top_schema,
+			(cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+	if (data_tgt->seq_count != 4 || strcmp(data_tgt->name, "abc") != 0) {
+		return ttest_fail(&tc, "Incorrect value");
+	}
+	cyaml_cleanup(&td);
+	data_tgt = NULL;
+
+	cfg.limits.max_bytes = size - 1;
+
+	err = cyaml_load_data(yaml, YAML_LEN(yaml), &cfg, &top_schema,
+			(cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_ERR_LIMIT_EXCEEDED) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+	if (data_tgt != NULL) {
+		return ttest_fail(&tc, "Data non-NULL on error.");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test the allocated bytes limit applies per entry of streamed sequences.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_limit_bytes_entry_fn(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char yaml[] =
+		"- { value: 1, name: one }\n"
+		"- { value: 2, name: two }\n"
+		"- { value: 3, name: six }\n"
+		"- { value: 4, name: ten }\n";
+	struct test_entry *value = NULL;
+	unsigned count = 0;
+	static const struct cyaml_schema_field entry_fields[] = {
+		CYAML_FIELD_INT("value", CYAML_FLAG_DEFAULT,
+				struct test_entry, value),
+		CYAML_FIELD_STRING_PTR("name", CYAML_FLAG_POINTER,
+				struct test_entry, name,
+				0, CYAML_UNLIMITED),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value entry_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_DEFAULT,
+				struct test_entry, entry_fields),
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_SEQUENCE(CYAML_FLAG_POINTER, struct test_entry,
+				&entry_schema, 0, CYAML_UNLIMITED)
+	};
+	struct test_entry_ctx entry_ctx = {
+		.fail = ~0u,
+	};
+	cyaml_config_t cfg = *config;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &value,
+		.seq_count = &count,
+		.config = config,
+		.schema = &top_schema,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	cfg.entry_fn = test_load_entry_fn;
+	cfg.entry_ctx = &entry_ctx;
+	/* Room for the entry slot and one entry's name. */
+	cfg.limits.max_bytes = sizeof(struct test_entry) + 4;
+
+	err = cyaml_load_data(yaml, YAML_LEN(yaml), &cfg, &top_schema,
+			(cyaml_data_t **) &value, &count);
+	free(entry_ctx.kept);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (count != 4 || entry_ctx.count != 4 || entry_ctx.sum != 10) {
+		return ttest_fail(&tc, "Unexpected entries.");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test the scalar length limit.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_limit_scalar_len(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char yaml[] =
+		"name: abcd\n"
+		"other: efgh\n";
+	static const unsigned char yaml_long_key[] =
+		"names: abcd\n";
+	struct target_struct {
+		char name[8];
+	} *data_tgt = NULL;
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_STRING("name", CYAML_FLAG_DEFAULT,
+				struct target_struct, name, 0),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	cyaml_config_t cfg = *config;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = &cfg,
+		.schema = &top_schema,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	cfg.flags |= CYAML_CFG_IGNORE_UNKNOWN_KEYS;
+	cfg.limits.max_scalar_len = 5;
+
+	err = cyaml_load_data(yaml, YAML_LEN(yaml), &cfg, &top_schema,
+			(cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+	if (strcmp(data_tgt->name, "abcd") != 0) {
+		return ttest_fail(&tc, "Incorrect value");
+	}
+	cyaml_cleanup(&td);
+	data_tgt = NULL;
+
+	cfg.limits.max_scalar_len = 4;
+
+	err = cyaml_load_data(yaml, YAML_LEN(yaml), &cfg, &top_schema,
+			(cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_ERR_LIMIT_EXCEEDED) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	err = cyaml_load_data(yaml_long_key, YAML_LEN(yaml_long_key), &cfg,
+			&top_schema, (cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_ERR_LIMIT_EXCEEDED) {
+		return ttest_fail(&tc, "Long key: %s", cyaml_strerror(err));
+	}
+	if (data_tgt != NULL) {
+		return ttest_fail(&tc, "Data non-NULL on error.");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/** Mapping used by the alias tests. */
+struct test_alias_point {
+	int x; /**< X coordinate. */
+	int y; /**< Y coordinate. */
+};
+
+/** Fields for \ref struct test_alias_point. */
+static const struct cyaml_schema_field test_alias_point_fields[] = {
+	CYAML_FIELD_INT("x", CYAML_FLAG_DEFAULT, struct test_alias_point, x),
+	CYAML_FIELD_INT("y", CYAML_FLAG_DEFAULT, struct test_alias_point, y),
+	CYAML_FIELD_END
+};
+
+/**
+ * Test loading aliases to anchored mappings, strings and sequences.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_alias_shared(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char yaml[] =
+		"a: &p { x: 1, y: 2 }\n"
+		"b: *p\n"
+		"name: &s hello\n"
+		"label: *s\n"
+		"list: &l [1, 2, 3]\n"
+		"copy: *l\n";
+	struct target_struct {
+		struct test_alias_point *a;
+		struct test_alias_point *b;
+		char *name;
+		char *label;
+		int *list;
+		unsigned list_count;
+		int *copy;
+		unsigned copy_count;
+	} *data_tgt = NULL;
+	static const struct cyaml_schema_value entry_schema = {
+		CYAML_VALUE_INT(CYAML_FLAG_DEFAULT, int),
+	};
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_MAPPING_PTR("a", CYAML_FLAG_DEFAULT,
+				struct target_struct, a,
+				test_alias_point_fields),
+		CYAML_FIELD_MAPPING_PTR("b", CYAML_FLAG_DEFAULT,
+				struct target_struct, b,
+				test_alias_point_fields),
+		CYAML_FIELD_STRING_PTR("name", CYAML_FLAG_DEFAULT,
+				struct target_struct, name, 0, 16),
+		CYAML_FIELD_STRING_PTR("label", CYAML_FLAG_DEFAULT,
+				struct target_struct, label,
+				0, CYAML_UNLIMITED),
+		CYAML_FIELD_SEQUENCE("list", CYAML_FLAG_POINTER,
+				struct target_struct, list,
+				&entry_schema, 0, CYAML_UNLIMITED),
+		CYAML_FIELD_SEQUENCE("copy", CYAML_FLAG_POINTER,
+				struct target_struct, copy,
+				&entry_schema, 1, 3),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	cyaml_config_t cfg = *config;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = &cfg,
+		.schema = &top_schema,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	cfg.flags |= CYAML_CFG_ARENA | CYAML_CFG_ALIASES;
+
+	err = cyaml_load_data(yaml, YAML_LEN(yaml), &cfg, &top_schema,
+			(cyaml_data_t **) &data_tgt, NULL);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (data_tgt->a->x != 1 || data_tgt->a->y != 2 ||
+	    strcmp(data_tgt->name, "hello") != 0) {
+		return ttest_fail(&tc, "Bad anchored value.");
+	}
+	if (data_tgt->b != data_tgt->a) {
+		return ttest_fail(&tc, "Mapping not shared.");
+	}
+	if (data_tgt->label != data_tgt->name) {
+		return ttest_fail(&tc, "String not shared.");
+	}
+	if (data_tgt->copy != data_tgt->list ||
+	    data_tgt->copy_count != 3 || data_tgt->list_count != 3) {
+		return ttest_fail(&tc, "Sequence not shared.");
+	}
+	if (data_tgt->list[0] != 1 || data_tgt->list[2] != 3) {
+		return ttest_fail(&tc, "Bad sequence value.");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/** Recursive mapping used by the alias rejection tests. */
+struct test_alias_node {
+	struct test_alias_point *a;    /**< Optional point. */
+	struct test_alias_point *b;    /**< Optional point. */
+	char *name;                    /**< Optional short string. */
+	char *tag;                     /**< Optional string. */
+	struct test_alias_node **kids; /**< Child nodes. */
+	unsigned kids_count;           /**< Number of child nodes. */
+};
+
+/** Schema for a \ref struct test_alias_node pointer. */
+static const struct cyaml_schema_value test_alias_node_schema;
+
+/** Fields for \ref struct test_alias_node. */
+static const struct cyaml_schema_field test_alias_node_fields[] = {
+	CYAML_FIELD_MAPPING_PTR("a", CYAML_FLAG_OPTIONAL,
+			struct test_alias_node, a, test_alias_point_fields),
+	CYAML_FIELD_MAPPING_PTR("b", CYAML_FLAG_OPTIONAL,
+			struct test_alias_node, b, test_alias_point_fields),
+	CYAML_FIELD_STRING_PTR("name", CYAML_FLAG_OPTIONAL,
+			struct test_alias_node, name, 0, 4),
+	CYAML_FIELD_STRING_PTR("tag", CYAML_FLAG_OPTIONAL,
+			struct test_alias_node, tag, 0, 16),
+	CYAML_FIELD_SEQUENCE("kids", CYAML_FLAG_POINTER | CYAML_FLAG_OPTIONAL,
+			struct test_alias_node, kids,
+			&test_alias_node_schema, 0, CYAML_UNLIMITED),
+	CYAML_FIELD_END
+};
+
+/** Schema for a \ref struct test_alias_node pointer. */
+static const struct cyaml_schema_value test_alias_node_schema = {
+	CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+			struct test_alias_node, test_alias_node_fields),
+};
+
+/**
+ * Test loading a document with aliases, expecting an error.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \param[in]  name    Name of the test.
+ * \param[in]  yaml    The YAML document to load.
+ * \param[in]  flags   Config flags to add for the test.
+ * \param[in]  expect  The expected error.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_alias_expect_err(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config,
+		const char *name,
+		const char *yaml,
+		cyaml_cfg_flags_t flags,
+		cyaml_err_t expect)
+{
+	struct test_alias_node *data_tgt = NULL;
+	cyaml_config_t cfg = *config;
+	test_data_t td = {
+		.data = (cyaml_data_t **) &data_tgt,
+		.config = &cfg,
+		.schema = &test_alias_node_schema,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, name, cyaml_cleanup, &td);
+
+	cfg.flags |= flags;
+
+	err = cyaml_load_data((const uint8_t *)yaml, strlen(yaml), &cfg,
+			&test_alias_node_schema,
+			(cyaml_data_t **) &data_tgt, NULL);
+	if (err != expect) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test loading aliases that must be rejected.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_load_alias_invalid(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	const cyaml_cfg_flags_t aliases = CYAML_CFG_ARENA | CYAML_CFG_ALIASES;
+	bool pass = true;
+
+	pass &= test_load_alias_expect_err(report, config,
+			"test_load_alias_unknown",
+			"a: { x: 1, y: 2 }\nb: *p\n",
+			aliases, CYAML_ERR_INVALID_ALIAS);
+	pass &= test_load_alias_expect_err(report, config,
+			"test_load_alias_schema_mismatch",
+			"a: &p { x: 1, y: 2 }\ntag: *p\n",
+			aliases, CYAML_ERR_INVALID_ALIAS);
+	pass &= test_load_alias_expect_err(report, config,
+			"test_load_alias_string_range",
+			"tag: &s long\nname: *s\n",
+			aliases, CYAML_ERR_INVALID_ALIAS);
+	pass &= test_load_alias_expect_err(report, config,
+			"test_load_alias_recursive",
+			"kids: [ &r { kids: [ *r ] } ]\n",
+			aliases, CYAML_ERR_INVALID_ALIAS);
+	pass &= test_load_alias_expect_err(report, config,
+			"test_load_alias_key",
+			"&k a: { x: 1, y: 2 }\n*k : { x: 1, y: 2 }\n",
+			aliases, CYAML_ERR_INVALID_ALIAS);
+	pass &= test_load_alias_expect_err(report, config,
+			"test_load_alias_no_arena",
+			"a: &p { x: 1, y: 2 }\nb: *p\n",
+			CYAML_CFG_ALIASES, CYAML_ERR_ALIAS);
+
+	return pass;
+}
+
+/**
+ * Run the YAML loading unit tests.
+ *
+ * \param[in]  rc         The ttest report context.
+ * \param[in]  log_level  CYAML log level.
+ * \param[in]  log_fn     CYAML logging function, or NULL.
+ * \return true iff all unit tests pass, otherwise false.
+ */
+bool load_tests(
+		ttest_report_ctx_t *rc,
+		cyaml_log_t log_level,
+		cyaml_log_fn_t log_fn)
+{
+	bool pass = true;
+	cyaml_config_t config = {
+		.log_fn = log_fn,
+		.mem_fn = cyaml_mem,
+		.log_level = log_level,
+		.flags = CYAML_CFG_DEFAULT,
+	};
+
+	ttest_heading(rc, "Load single entry mapping tests: simple types");
+
+	pass &= test_load_mapping_entry_enum(rc, &config);
+	pass &= test_load_mapping_entry_uint(rc, &config);
+	pass &= test_load_mapping_entry_float(rc, &config);
+	pass &= test_load_mapping_entry_double(rc, &config);
+	pass &= test_load_mapping_entry_string(rc, &config);
+	pass &= test_load_mapping_entry_int_pos(rc, &config);
+	pass &= test_load_mapping_entry_int_neg(rc, &config);
+	pass &= test_load_mapping_entry_enum_ptr(rc, &config);
+	pass &= test_load_mapping_entry_uint_ptr(rc, &config);
+	pass &= test_load_mapping_entry_float_ptr(rc, &config);
+	pass &= test_load_mapping_entry_bool_true(rc, &config);
+	pass &= test_load_mapping_entry_bool_false(rc, &config);
+	pass &= test_load_mapping_entry_double_ptr(rc, &config);
+	pass &= test_load_mapping_entry_double_precise(rc, &config);
+	pass &= test_load_mapping_entry_float_precise(rc, &config);
+	pass &= test_load_mapping_entry_uint_limits(rc, &config);
+	pass &= test_load_mapping_entry_bool_false_strings(rc, &config);
+	pass &= test_load_mapping_entry_string_ptr(rc, &config);
+	pass &= test_load_mapping_entry_int_pos_ptr(rc, &config);
+	pass &= test_load_mapping_entry_int_neg_ptr(rc, &config);
+	pass &= test_load_mapping_entry_enum_sparse(rc, &config);
+	pass &= test_load_mapping_entry_ignore_deep(rc, &config);
+	pass &= test_load_mapping_entry_ignore_scalar(rc, &config);
+	pass &= test_load_mapping_entry_bool_true_ptr(rc, &config);
+	pass &= test_load_mapping_entry_bool_false_ptr(rc, &config);
+
+	ttest_heading(rc, "Load single entry mapping tests: complex types");
+
+	pass &= test_load_mapping_entry_flags(rc, &config);
+	pass &= test_load_mapping_entry_mapping(rc, &config);
+	pass &= test_load_mapping_entry_flags_ptr(rc, &config);
+	pass &= test_load_mapping_entry_mapping_ptr(rc, &config);
+	pass &= test_load_mapping_entry_flags_empty(rc, &config);
+	pass &= test_load_mapping_entry_flags_sparse(rc, &config);
+
+	ttest_heading(rc, "Load single entry mapping tests: sequences");
+
+	pass &= test_load_mapping_entry_sequence_int(rc, &config);
+	pass &= test_load_mapping_entry_sequence_enum(rc, &config);
+	pass &= test_load_mapping_entry_sequence_uint(rc, &config);
 	pass &= test_load_mapping_entry_sequence_bool(rc, &config);
 	pass &= test_load_mapping_entry_sequence_flags(rc, &config);
 	pass &= test_load_mapping_entry_sequence_string(rc, &config);
@@ -5330,6 +9331,9 @@ bool load_tests(
 	pass &= test_load_sequence_without_max_entries(rc, &config);
 	pass &= test_load_schema_top_level_sequence_fixed(rc, &config);
 	pass &= test_load_schema_sequence_entry_count_member(rc, &config);
+	pass &= test_load_mapping_many_fields_in_order(rc, &config);
+	pass &= test_load_mapping_many_fields_reversed(rc, &config);
+	pass &= test_load_mapping_many_fields_unknown_keys(rc, &config);
 
 	ttest_heading(rc, "Load tests: case sensitivity");
 
@@ -5340,6 +9344,91 @@ bool load_tests(
 	pass &= test_load_mapping_fields_cfg_insensitive_3(rc, &config);
 	pass &= test_load_mapping_fields_value_sensitive_1(rc, &config);
 	pass &= test_load_mapping_fields_value_insensitive_1(rc, &config);
+	pass &= test_load_mapping_many_fields_insensitive(rc, &config);
+
+	ttest_heading(rc, "Load tests: arena allocation");
+
+	pass &= test_load_arena_mapping(rc, &config);
+	pass &= test_load_arena_top_level_sequence(rc, &config);
+	pass &= test_load_arena_intern_strings(rc, &config);
+	pass &= test_load_intern_strings_no_arena(rc, &config);
+
+	ttest_heading(rc, "Load tests: sequence allocation");
+
+	pass &= test_load_sequence_growth(rc, &config);
+	pass &= test_load_sequence_expected(rc, &config);
+	pass &= test_load_sequence_shrink(rc, &config);
+
+	ttest_heading(rc, "Load tests: document streams");
+
+	pass &= test_load_stream_documents(rc, &config);
+	pass &= test_load_stream_arena_sequences(rc, &config);
+	pass &= test_load_stream_intern_strings(rc, &config);
+	pass &= test_load_stream_invalid_document(rc, &config);
+	pass &= test_load_stream_push(rc, &config);
+	pass &= test_load_stream_push_markers(rc, &config);
+
+	ttest_heading(rc, "Load tests: read functions");
+
+	pass &= test_load_stream_read(rc, &config);
+	pass &= test_load_stream_read_error(rc, &config);
+	pass &= test_load_stream_inflate(rc, &config);
+
+	ttest_heading(rc, "Load tests: sequence entry handler");
+
+	pass &= test_load_entry_fn_sequence(rc, &config);
+	pass &= test_load_entry_fn_reject(rc, &config);
+
+	ttest_heading(rc, "Load tests: reusable loader");
+
+	pass &= test_load_loader_reuse(rc, &config);
+	pass &= test_load_loader_after_error(rc, &config);
+
+	ttest_heading(rc, "Load tests: batch loading");
+
+	pass &= test_load_batch_data(rc, &config);
+	pass &= test_load_batch_errors(rc, &config);
+
+	ttest_heading(rc, "Load tests: indexed enums and flags");
+
+	pass &= test_load_enum_indexed(rc, &config);
+	pass &= test_load_flags_indexed(rc, &config);
+
+	ttest_heading(rc, "Load tests: statistics");
+
+	pass &= test_load_stats(rc, &config);
+
+	ttest_heading(rc, "Load tests: compiled schemas");
+
+	pass &= test_load_schema_compiled(rc, &config);
+
+	ttest_heading(rc, "Load tests: state allocation");
+
+	pass &= test_load_mapping_many_fields(rc, &config);
+	pass &= test_load_state_presized(rc, &config);
+
+	ttest_heading(rc, "Load tests: projection");
+
+	pass &= test_load_projection(rc, &config);
+	pass &= test_load_projection_nested(rc, &config);
+
+	ttest_heading(rc, "Load tests: bulk numeric sequences");
+
+	pass &= test_load_sequence_bulk_limits(rc, &config);
+	pass &= test_load_sequence_bulk_range(rc, &config);
+
+	ttest_heading(rc, "Load tests: resource limits");
+
+	pass &= test_load_limit_depth(rc, &config);
+	pass &= test_load_limit_entries(rc, &config);
+	pass &= test_load_limit_bytes(rc, &config);
+	pass &= test_load_limit_bytes_entry_fn(rc, &config);
+	pass &= test_load_limit_scalar_len(rc, &config);
+
+	ttest_heading(rc, "Load tests: aliases");
+
+	pass &= test_load_alias_shared(rc, &config);
+	pass &= test_load_alias_invalid(rc, &config);
 
 	return pass;
 }
@@ -4,11 +4,14 @@
  * Copyright (C) 2018 Michael Drake <tlsa@netsurf-browser.org>
  */
 
+#include <inttypes.h>
 #include <stdbool.h>
 #include <assert.h>
 #include <string.h>
 #include <stdio.h>
 
+#include <unistd.h>
+
 #include <cyaml/cyaml.h>
 
 #include "../../src/data.h"
@@ -210,6 +213,234 @@ static bool test_save_mapping_entry_double(
 	return ttest_pass(&tc);
 }
 
+/**
+ * Test saving floats that need a varying number of significant digits.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_save_mapping_entry_float_precise(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char ref[] =
+		"---\n"
+		"a: 0.1\n"
+		"b: 0.33333334\n"
+		"c: 16777216\n"
+		"d: -2.5e-10\n"
+		"e: 3.4028235e+38\n"
+		"...\n";
+	static const struct target_struct {
+		float a;
+		float b;
+		float c;
+		float d;
+		float e;
+	} data = {
+		.a = 0.1f,
+		.b = 1.0f / 3.0f,
+		.c = 16777216.0f,
+		.d = -2.5e-10f,
+		.e = 3.4028235e38f,
+	};
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_FLOAT("a", CYAML_FLAG_DEFAULT,
+				struct target_struct, a),
+		CYAML_FIELD_FLOAT("b", CYAML_FLAG_DEFAULT,
+				struct target_struct, b),
+		CYAML_FIELD_FLOAT("c", CYAML_FLAG_DEFAULT,
+				struct target_struct, c),
+		CYAML_FIELD_FLOAT("d", CYAML_FLAG_DEFAULT,
+				struct target_struct, d),
+		CYAML_FIELD_FLOAT("e", CYAML_FLAG_DEFAULT,
+				struct target_struct, e),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	char *buffer;
+	size_t len;
+	test_data_t td = {
+		.buffer = &buffer,
+		.config = config,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_save_data(&buffer, &len, config, &top_schema,
+				&data, 0);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (len != YAML_LEN(ref) || memcmp(ref, buffer, len) != 0) {
+		return ttest_fail(&tc, "Bad data:\n"
+				"EXPECTED (%zu):\n\n%.*s\n\n"
+				"GOT (%zu):\n\n%.*s\n",
+				YAML_LEN(ref), YAML_LEN(ref), ref,
+				len, len, buffer);
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test saving doubles that need a varying number of significant digits.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_save_mapping_entry_double_precise(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char ref[] =
+		"---\n"
+		"a: 0.30000000000000004\n"
+		"b: 1e+300\n"
+		"c: -0\n"
+		"d: 0.0001\n"
+		"e: 1e-05\n"
+		"f: 123456.789\n"
+		"g: 5e-324\n"
+		"...\n";
+	static const struct target_struct {
+		double a;
+		double b;
+		double c;
+		double d;
+		double e;
+		double f;
+		double g;
+	} data = {
+		.a = 0.1 + 0.2,
+		.b = 1e300,
+		.c = -0.0,
+		.d = 0.0001,
+		.e = 0.00001,
+		.f = 123456.789,
+		.g = 5e-324,
+	};
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_FLOAT("a", CYAML_FLAG_DEFAULT,
+				struct target_struct, a),
+		CYAML_FIELD_FLOAT("b", CYAML_FLAG_DEFAULT,
+				struct target_struct, b),
+		CYAML_FIELD_FLOAT("c", CYAML_FLAG_DEFAULT,
+				struct target_struct, c),
+		CYAML_FIELD_FLOAT("d", CYAML_FLAG_DEFAULT,
+				struct target_struct, d),
+		CYAML_FIELD_FLOAT("e", CYAML_FLAG_DEFAULT,
+				struct target_struct, e),
+		CYAML_FIELD_FLOAT("f", CYAML_FLAG_DEFAULT,
+				struct target_struct, f),
+		CYAML_FIELD_FLOAT("g", CYAML_FLAG_DEFAULT,
+				struct target_struct, g),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	char *buffer;
+	size_t len;
+	test_data_t td = {
+		.buffer = &buffer,
+		.config = config,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_save_data(&buffer, &len, config, &top_schema,
+				&data, 0);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (len != YAML_LEN(ref) || memcmp(ref, buffer, len) != 0) {
+		return ttest_fail(&tc, "Bad data:\n"
+				"EXPECTED (%zu):\n\n%.*s\n\n"
+				"GOT (%zu):\n\n%.*s\n",
+				YAML_LEN(ref), YAML_LEN(ref), ref,
+				len, len, buffer);
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test saving the extreme values of 64-bit integers.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_save_mapping_entry_int_limits(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char ref[] =
+		"---\n"
+		"min: -9223372036854775808\n"
+		"max: 9223372036854775807\n"
+		"umax: 18446744073709551615\n"
+		"...\n";
+	static const struct target_struct {
+		int64_t min;
+		int64_t max;
+		uint64_t umax;
+	} data = {
+		.min = INT64_MIN,
+		.max = INT64_MAX,
+		.umax = UINT64_MAX,
+	};
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_INT("min", CYAML_FLAG_DEFAULT,
+				struct target_struct, min),
+		CYAML_FIELD_INT("max", CYAML_FLAG_DEFAULT,
+				struct target_struct, max),
+		CYAML_FIELD_UINT("umax", CYAML_FLAG_DEFAULT,
+				struct target_struct, umax),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	char *buffer;
+	size_t len;
+	test_data_t td = {
+		.buffer = &buffer,
+		.config = config,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_save_data(&buffer, &len, config, &top_schema,
+				&data, 0);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (len != YAML_LEN(ref) || memcmp(ref, buffer, len) != 0) {
+		return ttest_fail(&tc, "Bad data:\n"
+				"EXPECTED (%zu):\n\n%.*s\n\n"
+				"GOT (%zu):\n\n%.*s\n",
+				YAML_LEN(ref), YAML_LEN(ref), ref,
+				len, len, buffer);
+	}
+
+	return ttest_pass(&tc);
+}
+
 /**
  * Test saving a string.
  *
@@ -3379,93 +3610,99 @@ static bool test_save_schema_top_level_sequence_fixed(
 }
 
 /**
- * Test saving a sequence with flow style configured.
+ * Test saving a long sequence, which requires the output buffer to grow.
  *
  * \param[in]  report  The test report context.
  * \param[in]  config  The CYAML config to use for the test.
  * \return true if test passes, false otherwise.
  */
-static bool test_save_sequence_config_flow_style(
+static bool test_save_buffer_growth(
 		ttest_report_ctx_t *report,
 		const cyaml_config_t *config)
 {
-	static const unsigned char ref[] =
-		"--- [7, 6, 5]\n"
-		"...\n";
-	int data[3] = { 7, 6, 5 };
+	enum { ENTRY_COUNT = 4096 };
+	static unsigned data[ENTRY_COUNT];
+	static char ref[ENTRY_COUNT * 8 + 16];
 	static const struct cyaml_schema_value entry_schema = {
-		CYAML_VALUE_INT(CYAML_FLAG_DEFAULT, int)
+		CYAML_VALUE_UINT(CYAML_FLAG_DEFAULT, unsigned),
 	};
 	static const struct cyaml_schema_value top_schema = {
-		CYAML_VALUE_SEQUENCE(CYAML_FLAG_POINTER, int,
-				&entry_schema, 0, 3),
+		CYAML_VALUE_SEQUENCE(CYAML_FLAG_POINTER, unsigned,
+				&entry_schema, 0, CYAML_UNLIMITED),
 	};
 	char *buffer = NULL;
-	size_t len = 0;
-	cyaml_config_t cfg = *config;
+	size_t ref_len;
+	size_t len;
 	test_data_t td = {
 		.buffer = &buffer,
-		.config = &cfg,
+		.config = config,
 	};
 	cyaml_err_t err;
 
-	cfg.flags |= CYAML_CFG_STYLE_FLOW;
 	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
 
-	err = cyaml_save_data(&buffer, &len, &cfg, &top_schema, data, 3);
+	ref_len = (size_t)sprintf(ref, "---\n");
+	for (unsigned i = 0; i < ENTRY_COUNT; i++) {
+		data[i] = i * 7;
+		ref_len += (size_t)sprintf(ref + ref_len, "- %u\n", data[i]);
+	}
+	ref_len += (size_t)sprintf(ref + ref_len, "...\n");
+
+	err = cyaml_save_data(&buffer, &len, config, &top_schema,
+			data, ENTRY_COUNT);
 	if (err != CYAML_OK) {
 		return ttest_fail(&tc, cyaml_strerror(err));
 	}
 
-	if (len != YAML_LEN(ref) || memcmp(ref, buffer, len) != 0) {
-		return ttest_fail(&tc, "Bad data:\n"
-				"EXPECTED (%zu):\n\n%.*s\n\n"
-				"GOT (%zu):\n\n%.*s\n",
-				YAML_LEN(ref), YAML_LEN(ref), ref,
-				len, len, buffer);
+	if (len != ref_len || memcmp(ref, buffer, len) != 0) {
+		return ttest_fail(&tc, "Bad data: expected %zu bytes, got %zu",
+				ref_len, len);
 	}
 
 	return ttest_pass(&tc);
 }
 
 /**
- * Test saving a sequence with block style configured.
+ * Test saving into a caller-provided buffer.
  *
  * \param[in]  report  The test report context.
  * \param[in]  config  The CYAML config to use for the test.
  * \return true if test passes, false otherwise.
  */
-static bool test_save_sequence_config_block_style(
+static bool test_save_buffer_fixed(
 		ttest_report_ctx_t *report,
 		const cyaml_config_t *config)
 {
 	static const unsigned char ref[] =
 		"---\n"
-		"- 7\n"
-		"- 6\n"
-		"- 5\n"
+		"test_uint: 555\n"
 		"...\n";
-	int data[3] = { 7, 6, 5 };
-	static const struct cyaml_schema_value entry_schema = {
-		CYAML_VALUE_INT(CYAML_FLAG_DEFAULT, int)
+	static const struct target_struct {
+		unsigned test_uint;
+	} data = {
+		.test_uint = 555,
+	};
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_UINT("test_uint", CYAML_FLAG_DEFAULT,
+				struct target_struct, test_uint),
+		CYAML_FIELD_END
 	};
 	static const struct cyaml_schema_value top_schema = {
-		CYAML_VALUE_SEQUENCE(CYAML_FLAG_POINTER, int,
-				&entry_schema, 0, 3),
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
 	};
-	char *buffer = NULL;
+	char buffer[YAML_LEN(ref)];
 	size_t len = 0;
-	cyaml_config_t cfg = *config;
 	test_data_t td = {
-		.buffer = &buffer,
-		.config = &cfg,
+		.buffer = NULL,
+		.config = config,
 	};
 	cyaml_err_t err;
 
-	cfg.flags |= CYAML_CFG_STYLE_BLOCK;
 	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
 
-	err = cyaml_save_data(&buffer, &len, &cfg, &top_schema, data, 3);
+	err = cyaml_save_buffer(buffer, sizeof(buffer), &len, config,
+			&top_schema, &data, 0);
 	if (err != CYAML_OK) {
 		return ttest_fail(&tc, cyaml_strerror(err));
 	}
@@ -3482,148 +3719,1498 @@ static bool test_save_sequence_config_block_style(
 }
 
 /**
- * Test saving a mapping with flow style value.
+ * Test saving into a caller-provided buffer that is too small.
  *
  * \param[in]  report  The test report context.
  * \param[in]  config  The CYAML config to use for the test.
  * \return true if test passes, false otherwise.
  */
-static bool test_save_mapping_value_flow_style(
+static bool test_save_buffer_fixed_too_small(
 		ttest_report_ctx_t *report,
 		const cyaml_config_t *config)
 {
-	static const char ref[] =
-		"--- {a: 555, b: 99, c: 7}\n"
+	static const unsigned char ref[] =
+		"---\n"
+		"test_uint: 555\n"
 		"...\n";
 	static const struct target_struct {
-		unsigned a;
-		unsigned b;
-		unsigned c;
+		unsigned test_uint;
 	} data = {
-		.a = 555,
-		.b = 99,
-		.c = 7,
+		.test_uint = 555,
 	};
 	static const struct cyaml_schema_field mapping_schema[] = {
-		CYAML_FIELD_UINT("a", CYAML_FLAG_DEFAULT,
-				struct target_struct, a),
-		CYAML_FIELD_UINT("b", CYAML_FLAG_DEFAULT,
-				struct target_struct, b),
-		CYAML_FIELD_UINT("c", CYAML_FLAG_DEFAULT,
-				struct target_struct, c),
+		CYAML_FIELD_UINT("test_uint", CYAML_FLAG_DEFAULT,
+				struct target_struct, test_uint),
 		CYAML_FIELD_END
 	};
 	static const struct cyaml_schema_value top_schema = {
-		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER | CYAML_FLAG_FLOW,
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
 				struct target_struct, mapping_schema),
 	};
-	char *buffer = NULL;
+	char buffer[YAML_LEN(ref) - 1];
 	size_t len = 0;
-	cyaml_config_t cfg = *config;
 	test_data_t td = {
-		.buffer = &buffer,
-		.config = &cfg,
+		.buffer = NULL,
+		.config = config,
 	};
 	cyaml_err_t err;
 
 	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
 
-	err = cyaml_save_data(&buffer, &len, config, &top_schema,
-				&data, 0);
-	if (err != CYAML_OK) {
+	err = cyaml_save_buffer(buffer, sizeof(buffer), &len, config,
+			&top_schema, &data, 0);
+	if (err != CYAML_ERR_BUFFER_FULL) {
 		return ttest_fail(&tc, cyaml_strerror(err));
 	}
 
-	if (len != YAML_LEN(ref) || memcmp(ref, buffer, len) != 0) {
-		return ttest_fail(&tc, "Bad data:\n"
-				"EXPECTED (%zu):\n\n%.*s\n\n"
-				"GOT (%zu):\n\n%.*s\n",
-				YAML_LEN(ref), YAML_LEN(ref), ref,
-				len, len, buffer);
+	if (len != 0) {
+		return ttest_fail(&tc, "Length set on failure.");
 	}
 
 	return ttest_pass(&tc);
 }
 
+/** Client write function context for save stream tests. */
+struct test_write_ctx {
+	char data[256];   /**< Output collected so far. */
+	size_t used;      /**< Number of bytes collected. */
+	unsigned calls;   /**< Number of times the write function was called. */
+	cyaml_err_t err;  /**< Error code for write function to return. */
+};
+
 /**
- * Test saving a mapping with block style value.
+ * Client write function for save stream tests.
  *
- * \param[in]  report  The test report context.
- * \param[in]  config  The CYAML config to use for the test.
- * \return true if test passes, false otherwise.
+ * \param[in]  ctx   The \ref test_write_ctx to collect output in.
+ * \param[in]  data  The bytes to write.
+ * \param[in]  len   The number of bytes to write.
+ * \return the error code from ctx.
  */
-static bool test_save_mapping_value_block_style(
-		ttest_report_ctx_t *report,
-		const cyaml_config_t *config)
+static cyaml_err_t test_write_fn(
+		void *ctx,
+		const char *data,
+		size_t len)
 {
-	static const unsigned char ref[] =
+	struct test_write_ctx *wctx = ctx;
+
+	wctx->calls++;
+	if (wctx->err != CYAML_OK) {
+		return wctx->err;
+	}
+
+	if (len > sizeof(wctx->data) - wctx->used) {
+		return CYAML_ERR_BUFFER_FULL;
+	}
+
+	memcpy(wctx->data + wctx->used, data, len);
+	wctx->used += len;
+
+	return CYAML_OK;
+}
+
+/**
+ * Test saving through a client write function.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_save_stream(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char ref[] =
+		"---\n"
+		"test_uint: 555\n"
+		"...\n";
+	static const struct target_struct {
+		unsigned test_uint;
+	} data = {
+		.test_uint = 555,
+	};
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_UINT("test_uint", CYAML_FLAG_DEFAULT,
+				struct target_struct, test_uint),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	struct test_write_ctx wctx = {
+		.err = CYAML_OK,
+	};
+	test_data_t td = {
+		.buffer = NULL,
+		.config = config,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_save_stream(test_write_fn, &wctx, config,
+			&top_schema, &data, 0);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (wctx.used != YAML_LEN(ref) ||
+	    memcmp(ref, wctx.data, wctx.used) != 0) {
+		return ttest_fail(&tc, "Bad data:\n"
+				"EXPECTED (%zu):\n\n%.*s\n\n"
+				"GOT (%zu):\n\n%.*s\n",
+				YAML_LEN(ref), YAML_LEN(ref), ref,
+				wctx.used, wctx.used, wctx.data);
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test that errors from a client write function are returned.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_save_stream_write_error(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const struct target_struct {
+		unsigned test_uint;
+	} data = {
+		.test_uint = 555,
+	};
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_UINT("test_uint", CYAML_FLAG_DEFAULT,
+				struct target_struct, test_uint),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	struct test_write_ctx wctx = {
+		.err = CYAML_ERR_FILE_WRITE,
+	};
+	test_data_t td = {
+		.buffer = NULL,
+		.config = config,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_save_stream(test_write_fn, &wctx, config,
+			&top_schema, &data, 0);
+	if (err != CYAML_ERR_FILE_WRITE) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (wctx.calls != 1) {
+		return ttest_fail(&tc, "Write function called %u times.",
+				wctx.calls);
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test saving to a file descriptor.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_save_fd(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char ref[] =
+		"---\n"
+		"test_uint: 555\n"
+		"...\n";
+	static const struct target_struct {
+		unsigned test_uint;
+	} data = {
+		.test_uint = 555,
+	};
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_UINT("test_uint", CYAML_FLAG_DEFAULT,
+				struct target_struct, test_uint),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	char buffer[64];
+	ssize_t len;
+	int fds[2];
+	test_data_t td = {
+		.buffer = NULL,
+		.config = config,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	if (pipe(fds) != 0) {
+		return ttest_fail(&tc, "Failed to create pipe.");
+	}
+
+	err = cyaml_save_fd(fds[1], config, &top_schema, &data, 0);
+	close(fds[1]);
+	if (err != CYAML_OK) {
+		close(fds[0]);
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	len = read(fds[0], buffer, sizeof(buffer));
+	close(fds[0]);
+
+	if (len != (ssize_t)YAML_LEN(ref) ||
+	    memcmp(ref, buffer, (size_t)len) != 0) {
+		return ttest_fail(&tc, "Bad data:\n"
+				"EXPECTED (%zu):\n\n%.*s\n\n"
+				"GOT (%zd):\n\n%.*s\n",
+				YAML_LEN(ref), YAML_LEN(ref), ref,
+				len, (int)len, buffer);
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test saving to a bad file descriptor.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_save_fd_bad(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const struct target_struct {
+		unsigned test_uint;
+	} data = {
+		.test_uint = 555,
+	};
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_UINT("test_uint", CYAML_FLAG_DEFAULT,
+				struct target_struct, test_uint),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	test_data_t td = {
+		.buffer = NULL,
+		.config = config,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_save_fd(-1, config, &top_schema, &data, 0);
+	if (err != CYAML_ERR_FILE_WRITE) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test saving a sequence with flow style configured.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_save_sequence_config_flow_style(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char ref[] =
+		"--- [7, 6, 5]\n"
+		"...\n";
+	int data[3] = { 7, 6, 5 };
+	static const struct cyaml_schema_value entry_schema = {
+		CYAML_VALUE_INT(CYAML_FLAG_DEFAULT, int)
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_SEQUENCE(CYAML_FLAG_POINTER, int,
+				&entry_schema, 0, 3),
+	};
+	char *buffer = NULL;
+	size_t len = 0;
+	cyaml_config_t cfg = *config;
+	test_data_t td = {
+		.buffer = &buffer,
+		.config = &cfg,
+	};
+	cyaml_err_t err;
+
+	cfg.flags |= CYAML_CFG_STYLE_FLOW;
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_save_data(&buffer, &len, &cfg, &top_schema, data, 3);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (len != YAML_LEN(ref) || memcmp(ref, buffer, len) != 0) {
+		return ttest_fail(&tc, "Bad data:\n"
+				"EXPECTED (%zu):\n\n%.*s\n\n"
+				"GOT (%zu):\n\n%.*s\n",
+				YAML_LEN(ref), YAML_LEN(ref), ref,
+				len, len, buffer);
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test saving a sequence with block style configured.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_save_sequence_config_block_style(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char ref[] =
+		"---\n"
+		"- 7\n"
+		"- 6\n"
+		"- 5\n"
+		"...\n";
+	int data[3] = { 7, 6, 5 };
+	static const struct cyaml_schema_value entry_schema = {
+		CYAML_VALUE_INT(CYAML_FLAG_DEFAULT, int)
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_SEQUENCE(CYAML_FLAG_POINTER, int,
+				&entry_schema, 0, 3),
+	};
+	char *buffer = NULL;
+	size_t len = 0;
+	cyaml_config_t cfg = *config;
+	test_data_t td = {
+		.buffer = &buffer,
+		.config = &cfg,
+	};
+	cyaml_err_t err;
+
+	cfg.flags |= CYAML_CFG_STYLE_BLOCK;
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_save_data(&buffer, &len, &cfg, &top_schema, data, 3);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (len != YAML_LEN(ref) || memcmp(ref, buffer, len) != 0) {
+		return ttest_fail(&tc, "Bad data:\n"
+				"EXPECTED (%zu):\n\n%.*s\n\n"
+				"GOT (%zu):\n\n%.*s\n",
+				YAML_LEN(ref), YAML_LEN(ref), ref,
+				len, len, buffer);
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test saving a mapping with flow style value.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_save_mapping_value_flow_style(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const char ref[] =
+		"--- {a: 555, b: 99, c: 7}\n"
+		"...\n";
+	static const struct target_struct {
+		unsigned a;
+		unsigned b;
+		unsigned c;
+	} data = {
+		.a = 555,
+		.b = 99,
+		.c = 7,
+	};
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_UINT("a", CYAML_FLAG_DEFAULT,
+				struct target_struct, a),
+		CYAML_FIELD_UINT("b", CYAML_FLAG_DEFAULT,
+				struct target_struct, b),
+		CYAML_FIELD_UINT("c", CYAML_FLAG_DEFAULT,
+				struct target_struct, c),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER | CYAML_FLAG_FLOW,
+				struct target_struct, mapping_schema),
+	};
+	char *buffer = NULL;
+	size_t len = 0;
+	cyaml_config_t cfg = *config;
+	test_data_t td = {
+		.buffer = &buffer,
+		.config = &cfg,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_save_data(&buffer, &len, config, &top_schema,
+				&data, 0);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (len != YAML_LEN(ref) || memcmp(ref, buffer, len) != 0) {
+		return ttest_fail(&tc, "Bad data:\n"
+				"EXPECTED (%zu):\n\n%.*s\n\n"
+				"GOT (%zu):\n\n%.*s\n",
+				YAML_LEN(ref), YAML_LEN(ref), ref,
+				len, len, buffer);
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test saving a mapping with block style value.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_save_mapping_value_block_style(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char ref[] =
+		"---\n"
+		"a: 555\n"
+		"b: 99\n"
+		"c: 7\n"
+		"...\n";
+	static const struct target_struct {
+		unsigned a;
+		unsigned b;
+		unsigned c;
+	} data = {
+		.a = 555,
+		.b = 99,
+		.c = 7,
+	};
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_UINT("a", CYAML_FLAG_DEFAULT,
+				struct target_struct, a),
+		CYAML_FIELD_UINT("b", CYAML_FLAG_DEFAULT,
+				struct target_struct, b),
+		CYAML_FIELD_UINT("c", CYAML_FLAG_DEFAULT,
+				struct target_struct, c),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER | CYAML_FLAG_BLOCK,
+				struct target_struct, mapping_schema),
+	};
+	char *buffer = NULL;
+	size_t len = 0;
+	test_data_t td = {
+		.buffer = &buffer,
+		.config = config,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_save_data(&buffer, &len, config, &top_schema,
+				&data, 0);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (len != YAML_LEN(ref) || memcmp(ref, buffer, len) != 0) {
+		return ttest_fail(&tc, "Bad data:\n"
+				"EXPECTED (%zu):\n\n%.*s\n\n"
+				"GOT (%zu):\n\n%.*s\n",
+				YAML_LEN(ref), YAML_LEN(ref), ref,
+				len, len, buffer);
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test saving without document delimiters.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_save_no_document_delimiters(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char ref[] =
+		"test_uint: 555\n";
+	static const struct target_struct {
+		unsigned test_uint;
+	} data = {
+		.test_uint = 555,
+	};
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_UINT("test_uint", CYAML_FLAG_DEFAULT,
+				struct target_struct, test_uint),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	cyaml_config_t cfg = *config;
+	char *buffer;
+	size_t len;
+	test_data_t td = {
+		.buffer = &buffer,
+		.config = &cfg,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	cfg.flags &= ~CYAML_CFG_DOCUMENT_DELIM;
+	err = cyaml_save_data(&buffer, &len, &cfg, &top_schema, &data, 0);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (len != YAML_LEN(ref) || memcmp(ref, buffer, len) != 0) {
+		return ttest_fail(&tc, "Bad data:\n"
+				"EXPECTED (%zu):\n\n%.*s\n\n"
+				"GOT (%zu):\n\n%.*s\n",
+				YAML_LEN(ref), YAML_LEN(ref), ref,
+				len, len, buffer);
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test saving several documents with a reusable saver.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_save_saver_reuse(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char ref[] =
+		"---\n"
+		"test_uint: 555\n"
+		"test_seq:\n"
+		"- 1\n"
+		"- 2\n"
+		"...\n";
+	static const int seq[] = { 1, 2 };
+	static const struct target_struct {
+		unsigned test_uint;
+		const int *test_seq;
+		unsigned test_seq_count;
+	} data = {
+		.test_uint = 555,
+		.test_seq = seq,
+		.test_seq_count = 2,
+	};
+	static const struct cyaml_schema_value entry_schema = {
+		CYAML_VALUE_INT(CYAML_FLAG_DEFAULT, int),
+	};
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_UINT("test_uint", CYAML_FLAG_DEFAULT,
+				struct target_struct, test_uint),
+		CYAML_FIELD_SEQUENCE("test_seq", CYAML_FLAG_POINTER,
+				struct target_struct, test_seq,
+				&entry_schema, 0, CYAML_UNLIMITED),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	struct test_write_ctx wctx = {
+		.err = CYAML_OK,
+	};
+	char fixed[YAML_LEN(ref)];
+	char *buffer = NULL;
+	size_t len;
+	test_data_t td = {
+		.buffer = &buffer,
+		.config = config,
+	};
+	cyaml_saver_t *saver = NULL;
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_saver_create(config, &saver);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	for (unsigned i = 0; i < 3; i++) {
+		err = cyaml_saver_save_data(saver, &buffer, &len,
+				&top_schema, &data, 0);
+		if (err != CYAML_OK) {
+			cyaml_saver_destroy(saver);
+			return ttest_fail(&tc, cyaml_strerror(err));
+		}
+
+		if (len != YAML_LEN(ref) || memcmp(ref, buffer, len) != 0) {
+			cyaml_saver_destroy(saver);
+			return ttest_fail(&tc, "Bad data for save %u", i);
+		}
+
+		config->mem_fn(config->mem_ctx, buffer, 0);
+		buffer = NULL;
+	}
+
+	err = cyaml_saver_save_buffer(saver, fixed, sizeof(fixed), &len,
+			&top_schema, &data, 0);
+	if (err != CYAML_OK || len != YAML_LEN(ref) ||
+	    memcmp(ref, fixed, len) != 0) {
+		cyaml_saver_destroy(saver);
+		return ttest_fail(&tc, "Bad buffer save: %s",
+				cyaml_strerror(err));
+	}
+
+	err = cyaml_saver_save_stream(saver, test_write_fn, &wctx,
+			&top_schema, &data, 0);
+	cyaml_saver_destroy(saver);
+	if (err != CYAML_OK || wctx.used != YAML_LEN(ref) ||
+	    memcmp(ref, wctx.data, wctx.used) != 0) {
+		return ttest_fail(&tc, "Bad stream save: %s",
+				cyaml_strerror(err));
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test that a reusable saver recovers from failed saves.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_save_saver_after_error(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char ref[] =
+		"---\n"
+		"test_uint: 555\n"
+		"...\n";
+	static const struct target_struct {
+		unsigned test_uint;
+	} data = {
+		.test_uint = 555,
+	};
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_UINT("test_uint", CYAML_FLAG_DEFAULT,
+				struct target_struct, test_uint),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	char buffer[YAML_LEN(ref)];
+	size_t len = 0;
+	test_data_t td = {
+		.buffer = NULL,
+		.config = config,
+	};
+	cyaml_saver_t *saver = NULL;
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_saver_create(config, &saver);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	err = cyaml_saver_save_buffer(saver, buffer, sizeof(buffer) - 1, &len,
+			&top_schema, &data, 0);
+	if (err != CYAML_ERR_BUFFER_FULL) {
+		cyaml_saver_destroy(saver);
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	err = cyaml_saver_save_buffer(saver, buffer, sizeof(buffer), &len,
+			&top_schema, NULL, 0);
+	if (err != CYAML_ERR_BAD_PARAM_NULL_DATA) {
+		cyaml_saver_destroy(saver);
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	err = cyaml_saver_save_buffer(saver, buffer, sizeof(buffer), &len,
+			&top_schema, &data, 0);
+	cyaml_saver_destroy(saver);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (len != YAML_LEN(ref) || memcmp(ref, buffer, len) != 0) {
+		return ttest_fail(&tc, "Bad data:\n"
+				"EXPECTED (%zu):\n\n%.*s\n\n"
+				"GOT (%zu):\n\n%.*s\n",
+				YAML_LEN(ref), YAML_LEN(ref), ref,
+				len, len, buffer);
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test saving enums with enough strings to be indexed.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_save_enum_indexed(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char ref[] =
+		"---\n"
+		"- three\n"
+		"- five\n"
+		"- seven\n"
+		"- twelve\n"
+		"- 99\n"
+		"- zero\n"
+		"...\n";
+	static const cyaml_strval_t strings[] = {
+		{ "twelve",    12 }, { "zero",     0 }, { "one",     1 },
+		{ "two",        2 }, { "three",    3 }, { "four",    4 },
+		{ "five",       5 }, { "six",      6 }, { "cinq",    5 },
+		{ "seven",      7 }, { "douze",   12 }, { "sept",    7 },
+	};
+	static const int data[] = { 3, 5, 7, 12, 99, 0 };
+	static const struct cyaml_schema_value entry_schema = {
+		CYAML_VALUE_ENUM(CYAML_FLAG_DEFAULT, int,
+				strings, CYAML_ARRAY_LEN(strings)),
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_SEQUENCE(CYAML_FLAG_POINTER, int,
+				&entry_schema, 0, CYAML_UNLIMITED),
+	};
+	char *buffer = NULL;
+	size_t len;
+	test_data_t td = {
+		.buffer = &buffer,
+		.config = config,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_save_data(&buffer, &len, config, &top_schema,
+			data, CYAML_ARRAY_LEN(data));
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (len != YAML_LEN(ref) || memcmp(ref, buffer, len) != 0) {
+		return ttest_fail(&tc, "Bad data:\n"
+				"EXPECTED (%zu):\n\n%.*s\n\n"
+				"GOT (%zu):\n\n%.*s\n",
+				YAML_LEN(ref), YAML_LEN(ref), ref,
+				len, len, buffer);
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test saving with a compiled schema.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_save_schema_compiled(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char ref[] =
+		"---\n"
+		"- three\n"
+		"- cinq\n"
+		"- 99\n"
+		"- zero\n"
+		"...\n";
+	static const cyaml_strval_t strings[] = {
+		{ "zero",   0 }, { "one",    1 }, { "two",    2 },
+		{ "three",  3 }, { "four",   4 }, { "cinq",   5 },
+		{ "six",    6 }, { "seven",  7 }, { "eight",  8 },
+	};
+	static const int data[] = { 3, 5, 99, 0 };
+	static const struct cyaml_schema_value entry_schema = {
+		CYAML_VALUE_ENUM(CYAML_FLAG_DEFAULT, int,
+				strings, CYAML_ARRAY_LEN(strings)),
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_SEQUENCE(CYAML_FLAG_POINTER, int,
+				&entry_schema, 0, CYAML_UNLIMITED),
+	};
+	cyaml_schema_compiled_t *compiled = NULL;
+	cyaml_config_t cfg = *config;
+	char *buffer = NULL;
+	size_t len;
+	test_data_t td = {
+		.buffer = &buffer,
+		.config = config,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_schema_compile(config, &top_schema, &compiled);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+	cfg.compiled = compiled;
+
+	err = cyaml_save_data(&buffer, &len, &cfg, &top_schema,
+			data, CYAML_ARRAY_LEN(data));
+	cyaml_schema_compiled_free(config, compiled);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (len != YAML_LEN(ref) || memcmp(ref, buffer, len) != 0) {
+		return ttest_fail(&tc, "Bad data:\n"
+				"EXPECTED (%zu):\n\n%.*s\n\n"
+				"GOT (%zu):\n\n%.*s\n",
+				YAML_LEN(ref), YAML_LEN(ref), ref,
+				len, len, buffer);
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test gathering statistics while saving.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_save_stats(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char ref[] =
+		"---\n"
+		"test_uint: 555\n"
+		"test_seq:\n"
+		"- 1\n"
+		"- 2\n"
+		"...\n";
+	static const int seq[] = { 1, 2 };
+	static const struct target_struct {
+		unsigned test_uint;
+		const int *test_seq;
+		unsigned test_seq_count;
+	} data = {
+		.test_uint = 555,
+		.test_seq = seq,
+		.test_seq_count = 2,
+	};
+	static const struct cyaml_schema_value entry_schema = {
+		CYAML_VALUE_INT(CYAML_FLAG_DEFAULT, int),
+	};
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_UINT("test_uint", CYAML_FLAG_DEFAULT,
+				struct target_struct, test_uint),
+		CYAML_FIELD_SEQUENCE("test_seq", CYAML_FLAG_POINTER,
+				struct target_struct, test_seq,
+				&entry_schema, 0, CYAML_UNLIMITED),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	cyaml_stats_t stats = { .timing = true };
+	cyaml_config_t cfg = *config;
+	char *buffer = NULL;
+	size_t len;
+	test_data_t td = {
+		.buffer = &buffer,
+		.config = config,
+	};
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	cfg.stats = &stats;
+
+	err = cyaml_save_data(&buffer, &len, &cfg, &top_schema, &data, 0);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (len != YAML_LEN(ref) || memcmp(ref, buffer, len) != 0) {
+		return ttest_fail(&tc, "Bad data");
+	}
+
+#ifdef CYAML_STATS
+	if (stats.events_emitted != 13) {
+		return ttest_fail(&tc, "Incorrect emitted event count: %"PRIu64,
+				stats.events_emitted);
+	}
+
+	if (stats.stack_peak != 5) {
+		return ttest_fail(&tc, "Incorrect stack peak: %"PRIu32,
+				stats.stack_peak);
+	}
+
+	/* Everything but the output buffer is freed. */
+	if (stats.mem_allocs != stats.mem_frees + 1) {
+		return ttest_fail(&tc, "Incorrect memory counts");
+	}
+#else
+	if (stats.events_emitted != 0 || stats.mem_allocs != 0) {
+		return ttest_fail(&tc, "Statistics gathered when disabled");
+	}
+#endif
+
+	if (stats.parse_ns != 0 || stats.decode_ns != 0 ||
+	    stats.events[CYAML_STATS_EVT_SCALAR] != 0) {
+		return ttest_fail(&tc, "Unexpected parser counts");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test writing documents one at a time with an incremental writer.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_save_writer_documents(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char ref[] =
+		"---\n"
+		"test_uint: 1\n"
+		"...\n"
+		"---\n"
+		"test_uint: 2\n"
+		"...\n";
+	struct target_struct {
+		unsigned test_uint;
+	} data[] = {
+		{ .test_uint = 1 },
+		{ .test_uint = 2 },
+	};
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_UINT("test_uint", CYAML_FLAG_DEFAULT,
+				struct target_struct, test_uint),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	struct test_write_ctx wctx = {
+		.err = CYAML_OK,
+	};
+	test_data_t td = {
+		.buffer = NULL,
+		.config = config,
+	};
+	cyaml_writer_t *writer = NULL;
+	size_t first_len = 0;
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_writer_create(config, test_write_fn, &wctx, &writer);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	for (unsigned i = 0; i < CYAML_ARRAY_LEN(data); i++) {
+		err = cyaml_writer_document(writer, &top_schema, &data[i], 0);
+		if (err != CYAML_OK) {
+			cyaml_writer_destroy(writer);
+			return ttest_fail(&tc, cyaml_strerror(err));
+		}
+		if (i == 0) {
+			first_len = wctx.used;
+		}
+	}
+
+	err = cyaml_writer_finish(writer);
+	cyaml_writer_destroy(writer);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (first_len != strlen("---\ntest_uint: 1\n...\n")) {
+		return ttest_fail(&tc, "First document not flushed: %zu",
+				first_len);
+	}
+
+	if (wctx.used != YAML_LEN(ref) ||
+	    memcmp(ref, wctx.data, wctx.used) != 0) {
+		return ttest_fail(&tc, "Bad data:\n"
+				"EXPECTED (%zu):\n\n%.*s\n\n"
+				"GOT (%zu):\n\n%.*s\n",
+				YAML_LEN(ref), YAML_LEN(ref), ref,
+				wctx.used, wctx.used, wctx.data);
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test writing a top level sequence an entry at a time.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_save_writer_sequence(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char ref[] =
+		"---\n"
+		"- 1\n"
+		"- 2\n"
+		"- 3\n"
+		"...\n";
+	static const struct cyaml_schema_value entry_schema = {
+		CYAML_VALUE_UINT(CYAML_FLAG_DEFAULT, unsigned),
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_SEQUENCE(CYAML_FLAG_POINTER,
+				unsigned, &entry_schema, 0, CYAML_UNLIMITED),
+	};
+	struct test_write_ctx wctx = {
+		.err = CYAML_OK,
+	};
+	test_data_t td = {
+		.buffer = NULL,
+		.config = config,
+	};
+	cyaml_writer_t *writer = NULL;
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_writer_create(config, test_write_fn, &wctx, &writer);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	err = cyaml_writer_sequence_start(writer, &top_schema);
+	for (unsigned i = 1; i <= 3 && err == CYAML_OK; i++) {
+		err = cyaml_writer_sequence_entry(writer, &i);
+	}
+	if (err == CYAML_OK) {
+		err = cyaml_writer_sequence_end(writer);
+	}
+	if (err == CYAML_OK) {
+		err = cyaml_writer_finish(writer);
+	}
+	cyaml_writer_destroy(writer);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (wctx.used != YAML_LEN(ref) ||
+	    memcmp(ref, wctx.data, wctx.used) != 0) {
+		return ttest_fail(&tc, "Bad data:\n"
+				"EXPECTED (%zu):\n\n%.*s\n\n"
+				"GOT (%zu):\n\n%.*s\n",
+				YAML_LEN(ref), YAML_LEN(ref), ref,
+				wctx.used, wctx.used, wctx.data);
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test incremental writer calls made out of order are rejected, and that
+ * write errors are kept.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_save_writer_misuse(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	unsigned value = 7;
+	static const struct cyaml_schema_value entry_schema = {
+		CYAML_VALUE_UINT(CYAML_FLAG_DEFAULT, unsigned),
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_SEQUENCE(CYAML_FLAG_POINTER,
+				unsigned, &entry_schema, 0, CYAML_UNLIMITED),
+	};
+	static const struct cyaml_schema_value uint_schema = {
+		CYAML_VALUE_UINT(CYAML_FLAG_POINTER, unsigned),
+	};
+	struct test_write_ctx wctx = {
+		.err = CYAML_OK,
+	};
+	test_data_t td = {
+		.buffer = NULL,
+		.config = config,
+	};
+	cyaml_writer_t *writer = NULL;
+	cyaml_err_t err;
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	err = cyaml_writer_create(config, test_write_fn, &wctx, &writer);
+	if (err != CYAML_OK) {
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (cyaml_writer_sequence_entry(writer, &value) !=
+			CYAML_ERR_WRITER_STATE ||
+	    cyaml_writer_sequence_end(writer) != CYAML_ERR_WRITER_STATE ||
+	    cyaml_writer_sequence_start(writer, &uint_schema) !=
+			CYAML_ERR_BAD_TYPE_IN_SCHEMA) {
+		cyaml_writer_destroy(writer);
+		return ttest_fail(&tc, "Sequence calls allowed out of order");
+	}
+
+	err = cyaml_writer_sequence_start(writer, &top_schema);
+	if (err != CYAML_OK) {
+		cyaml_writer_destroy(writer);
+		return ttest_fail(&tc, cyaml_strerror(err));
+	}
+
+	if (cyaml_writer_document(writer, &uint_schema, &value, 0) !=
+			CYAML_ERR_WRITER_STATE ||
+	    cyaml_writer_sequence_start(writer, &top_schema) !=
+			CYAML_ERR_WRITER_STATE ||
+	    cyaml_writer_finish(writer) != CYAML_ERR_WRITER_STATE) {
+		cyaml_writer_destroy(writer);
+		return ttest_fail(&tc, "Calls allowed inside sequence");
+	}
+
+	wctx.err = CYAML_ERR_FILE_WRITE;
+	err = cyaml_writer_sequence_end(writer);
+	if (err != CYAML_ERR_FILE_WRITE) {
+		cyaml_writer_destroy(writer);
+		return ttest_fail(&tc, "Write error not returned: %s",
+				cyaml_strerror(err));
+	}
+
+	wctx.err = CYAML_OK;
+	err = cyaml_writer_document(writer, &uint_schema, &value, 0);
+	cyaml_writer_destroy(writer);
+	if (err != CYAML_ERR_FILE_WRITE) {
+		return ttest_fail(&tc, "Write error not kept: %s",
+				cyaml_strerror(err));
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Save data with both `libyaml`'s and the native emitter, and check both.
+ *
+ * \param[in]  tc      The test context.
+ * \param[in]  td      The test data, for the output buffer.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \param[in]  schema  The schema for the data.
+ * \param[in]  data    The data to save.
+ * \param[in]  ref     The expected output.
+ * \param[in]  ref_len Length of the expected output.
+ * \return true if both emitters gave the expected output, false otherwise.
+ */
+static bool test_save_fast_emit_check(
+		ttest_ctx_t *tc,
+		test_data_t *td,
+		const cyaml_config_t *config,
+		const cyaml_schema_value_t *schema,
+		const cyaml_data_t *data,
+		const unsigned char *ref,
+		size_t ref_len)
+{
+	for (unsigned i = 0; i < 2; i++) {
+		cyaml_config_t cfg = *config;
+		cyaml_err_t err;
+		size_t len;
+
+		if (i == 1) {
+			cfg.flags |= CYAML_CFG_FAST_EMIT;
+		}
+
+		cyaml_cleanup(td);
+		*td->buffer = NULL;
+
+		err = cyaml_save_data(td->buffer, &len, &cfg, schema, data, 0);
+		if (err != CYAML_OK) {
+			return ttest_fail(tc, "%s: %s",
+					(i == 1) ? "native" : "libyaml",
+					cyaml_strerror(err));
+		}
+
+		if (len != ref_len || memcmp(ref, *td->buffer, len) != 0) {
+			return ttest_fail(tc, "Bad data from %s:\n"
+					"EXPECTED (%zu):\n\n%.*s\n\n"
+					"GOT (%zu):\n\n%.*s\n",
+					(i == 1) ? "native" : "libyaml",
+					ref_len, (int)ref_len, ref,
+					len, (int)len, *td->buffer);
+		}
+	}
+
+	return ttest_pass(tc);
+}
+
+/**
+ * Test the native emitter quotes and escapes scalars like `libyaml`.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_save_fast_emit_scalars(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char ref[] =
 		"---\n"
-		"a: 555\n"
-		"b: 99\n"
-		"c: 7\n"
+		"strings:\n"
+		"- plain_value\n"
+		"- two words\n"
+		"- ! 'a: b'\n"
+		"- ! '- x'\n"
+		"- it's\n"
+		"- ! \"tab\\tx\"\n"
+		"- ! 'line\n"
+		"\n"
+		"  break'\n"
+		"- ! \"\\xFCn\\xEF\"\n"
+		"- ! ' lead'\n"
+		"-\n"
+		"- -12\n"
+		"- If a line grows past the preferred width it is broken at "
+			"a space and the rest is\n"
+		"  indented\n"
+		"empty: []\n"
 		"...\n";
+	static const char *strings[] = {
+		"plain_value",
+		"two words",
+		"a: b",
+		"- x",
+		"it's",
+		"tab\tx",
+		"line\nbreak",
+		"\xc3\xbcn\xc3\xaf",
+		" lead",
+		"",
+		"-12",
+		"If a line grows past the preferred width it is broken at "
+			"a space and the rest is indented",
+	};
 	static const struct target_struct {
-		unsigned a;
-		unsigned b;
-		unsigned c;
+		const char **strings;
+		unsigned strings_count;
+		int *empty;
+		unsigned empty_count;
 	} data = {
-		.a = 555,
-		.b = 99,
-		.c = 7,
+		.strings = strings,
+		.strings_count = CYAML_ARRAY_LEN(strings),
+	};
+	static const struct cyaml_schema_value string_schema = {
+		CYAML_VALUE_STRING(CYAML_FLAG_POINTER, char,
+				0, CYAML_UNLIMITED),
+	};
+	static const struct cyaml_schema_value int_schema = {
+		CYAML_VALUE_INT(CYAML_FLAG_DEFAULT, int),
 	};
 	static const struct cyaml_schema_field mapping_schema[] = {
-		CYAML_FIELD_UINT("a", CYAML_FLAG_DEFAULT,
-				struct target_struct, a),
-		CYAML_FIELD_UINT("b", CYAML_FLAG_DEFAULT,
-				struct target_struct, b),
-		CYAML_FIELD_UINT("c", CYAML_FLAG_DEFAULT,
-				struct target_struct, c),
+		CYAML_FIELD_SEQUENCE("strings", CYAML_FLAG_POINTER,
+				struct target_struct, strings,
+				&string_schema, 0, CYAML_UNLIMITED),
+		CYAML_FIELD_SEQUENCE("empty", CYAML_FLAG_POINTER,
+				struct target_struct, empty,
+				&int_schema, 0, CYAML_UNLIMITED),
 		CYAML_FIELD_END
 	};
 	static const struct cyaml_schema_value top_schema = {
-		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER | CYAML_FLAG_BLOCK,
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
 				struct target_struct, mapping_schema),
 	};
 	char *buffer = NULL;
-	size_t len = 0;
 	test_data_t td = {
 		.buffer = &buffer,
 		.config = config,
 	};
-	cyaml_err_t err;
 
 	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
 
-	err = cyaml_save_data(&buffer, &len, config, &top_schema,
-				&data, 0);
-	if (err != CYAML_OK) {
-		return ttest_fail(&tc, cyaml_strerror(err));
-	}
+	return test_save_fast_emit_check(&tc, &td, config, &top_schema,
+			&data, ref, YAML_LEN(ref));
+}
 
-	if (len != YAML_LEN(ref) || memcmp(ref, buffer, len) != 0) {
-		return ttest_fail(&tc, "Bad data:\n"
-				"EXPECTED (%zu):\n\n%.*s\n\n"
-				"GOT (%zu):\n\n%.*s\n",
-				YAML_LEN(ref), YAML_LEN(ref), ref,
-				len, len, buffer);
-	}
+/**
+ * Test the native emitter writes flow style like `libyaml`.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_save_fast_emit_flow(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char ref[] =
+		"---\n"
+		"name:\n"
+		"seq: [1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, "
+			"17, 18, 19, 20, 21, 22,\n"
+		"  23, 24]\n"
+		"flow: {name: ! 'x, y', seq: [4, 5]}\n"
+		"block:\n"
+		"  name: ! '{block}'\n"
+		"  seq:\n"
+		"  - 7\n"
+		"empty: {name: ! '', seq: []}\n"
+		"...\n";
+	struct inner_struct {
+		const char *name;
+		int *seq;
+		unsigned seq_count;
+	};
+	static int seq1[] = {
+		1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12,
+		13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24,
+	};
+	static int seq2[] = { 4, 5 };
+	static int seq3[] = { 7 };
+	static struct inner_struct flow = {
+		.name = "x, y",
+		.seq = seq2,
+		.seq_count = CYAML_ARRAY_LEN(seq2),
+	};
+	static struct inner_struct block = {
+		.name = "{block}",
+		.seq = seq3,
+		.seq_count = CYAML_ARRAY_LEN(seq3),
+	};
+	static struct inner_struct empty = {
+		.name = "",
+	};
+	static const struct target_struct {
+		const char *name;
+		int *seq;
+		unsigned seq_count;
+		struct inner_struct *flow;
+		struct inner_struct *block;
+		struct inner_struct *empty;
+	} data = {
+		.name = "",
+		.seq = seq1,
+		.seq_count = CYAML_ARRAY_LEN(seq1),
+		.flow = &flow,
+		.block = &block,
+		.empty = &empty,
+	};
+	static const struct cyaml_schema_value int_schema = {
+		CYAML_VALUE_INT(CYAML_FLAG_DEFAULT, int),
+	};
+	static const struct cyaml_schema_field inner_schema[] = {
+		CYAML_FIELD_STRING_PTR("name", CYAML_FLAG_POINTER,
+				struct inner_struct, name,
+				0, CYAML_UNLIMITED),
+		CYAML_FIELD_SEQUENCE("seq", CYAML_FLAG_POINTER,
+				struct inner_struct, seq,
+				&int_schema, 0, CYAML_UNLIMITED),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_STRING_PTR("name", CYAML_FLAG_POINTER,
+				struct target_struct, name,
+				0, CYAML_UNLIMITED),
+		CYAML_FIELD_SEQUENCE("seq", CYAML_FLAG_POINTER |
+				CYAML_FLAG_FLOW,
+				struct target_struct, seq,
+				&int_schema, 0, CYAML_UNLIMITED),
+		CYAML_FIELD_MAPPING_PTR("flow", CYAML_FLAG_POINTER |
+				CYAML_FLAG_FLOW,
+				struct target_struct, flow, inner_schema),
+		CYAML_FIELD_MAPPING_PTR("block", CYAML_FLAG_POINTER,
+				struct target_struct, block, inner_schema),
+		CYAML_FIELD_MAPPING_PTR("empty", CYAML_FLAG_POINTER |
+				CYAML_FLAG_FLOW,
+				struct target_struct, empty, inner_schema),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	char *buffer = NULL;
+	test_data_t td = {
+		.buffer = &buffer,
+		.config = config,
+	};
 
-	return ttest_pass(&tc);
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	return test_save_fast_emit_check(&tc, &td, config, &top_schema,
+			&data, ref, YAML_LEN(ref));
 }
 
 /**
- * Test saving without document delimiters.
+ * Test that client write errors are returned with the native emitter.
  *
  * \param[in]  report  The test report context.
  * \param[in]  config  The CYAML config to use for the test.
  * \return true if test passes, false otherwise.
  */
-static bool test_save_no_document_delimiters(
+static bool test_save_fast_emit_write_error(
 		ttest_report_ctx_t *report,
 		const cyaml_config_t *config)
 {
-	static const unsigned char ref[] =
-		"test_uint: 555\n";
 	static const struct target_struct {
 		unsigned test_uint;
 	} data = {
@@ -3638,34 +5225,254 @@ static bool test_save_no_document_delimiters(
 		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
 				struct target_struct, mapping_schema),
 	};
+	struct test_write_ctx wctx = {
+		.err = CYAML_ERR_FILE_WRITE,
+	};
 	cyaml_config_t cfg = *config;
-	char *buffer;
-	size_t len;
 	test_data_t td = {
-		.buffer = &buffer,
-		.config = &cfg,
+		.buffer = NULL,
+		.config = config,
 	};
 	cyaml_err_t err;
 
 	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
 
-	cfg.flags &= ~CYAML_CFG_DOCUMENT_DELIM;
-	err = cyaml_save_data(&buffer, &len, &cfg, &top_schema, &data, 0);
-	if (err != CYAML_OK) {
+	cfg.flags |= CYAML_CFG_FAST_EMIT;
+
+	err = cyaml_save_stream(test_write_fn, &wctx, &cfg,
+			&top_schema, &data, 0);
+	if (err != CYAML_ERR_FILE_WRITE) {
 		return ttest_fail(&tc, cyaml_strerror(err));
 	}
 
-	if (len != YAML_LEN(ref) || memcmp(ref, buffer, len) != 0) {
-		return ttest_fail(&tc, "Bad data:\n"
-				"EXPECTED (%zu):\n\n%.*s\n\n"
-				"GOT (%zu):\n\n%.*s\n",
-				YAML_LEN(ref), YAML_LEN(ref), ref,
-				len, len, buffer);
+	if (wctx.calls != 1) {
+		return ttest_fail(&tc, "Write function called %u times.",
+				wctx.calls);
 	}
 
 	return ttest_pass(&tc);
 }
 
+/**
+ * Test saving limits of each numeric type through bulk sequences.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_save_sequence_bulk(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char ref[] =
+		"---\n"
+		"i8: [-128, 127, 0]\n"
+		"u16:\n"
+		"- 0\n"
+		"- 65535\n"
+		"i64: [-9223372036854775808, 9223372036854775807]\n"
+		"u64: [18446744073709551615]\n"
+		"f: [0.5, -1250]\n"
+		"d: [0.1, 1e+300]\n"
+		"...\n";
+	static int8_t i8[] = { INT8_MIN, INT8_MAX, 0 };
+	static uint64_t u64[] = { UINT64_MAX };
+	static float f[] = { 0.5f, -1250.0f };
+	static const struct target_struct {
+		int8_t *i8;
+		uint8_t i8_count;
+		uint16_t u16[2];
+		uint16_t u16_count;
+		int64_t i64[2];
+		uint64_t i64_count;
+		uint64_t *u64;
+		uint32_t u64_count;
+		float *f;
+		uint32_t f_count;
+		double d[2];
+	} data = {
+		.i8 = i8,
+		.i8_count = CYAML_ARRAY_LEN(i8),
+		.u16 = { 0, UINT16_MAX },
+		.u16_count = 2,
+		.i64 = { INT64_MIN, INT64_MAX },
+		.i64_count = 2,
+		.u64 = u64,
+		.u64_count = CYAML_ARRAY_LEN(u64),
+		.f = f,
+		.f_count = CYAML_ARRAY_LEN(f),
+		.d = { 0.1, 1e300 },
+	};
+	static const struct cyaml_schema_value i8_schema = {
+		CYAML_VALUE_INT(CYAML_FLAG_DEFAULT, int8_t),
+	};
+	static const struct cyaml_schema_value u16_schema = {
+		CYAML_VALUE_UINT(CYAML_FLAG_DEFAULT, uint16_t),
+	};
+	static const struct cyaml_schema_value i64_schema = {
+		CYAML_VALUE_INT(CYAML_FLAG_DEFAULT, int64_t),
+	};
+	static const struct cyaml_schema_value u64_schema = {
+		CYAML_VALUE_UINT(CYAML_FLAG_DEFAULT, uint64_t),
+	};
+	static const struct cyaml_schema_value f_schema = {
+		CYAML_VALUE_FLOAT(CYAML_FLAG_DEFAULT, float),
+	};
+	static const struct cyaml_schema_value d_schema = {
+		CYAML_VALUE_FLOAT(CYAML_FLAG_DEFAULT, double),
+	};
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_SEQUENCE("i8", CYAML_FLAG_POINTER |
+				CYAML_FLAG_FLOW,
+				struct target_struct, i8, &i8_schema,
+				0, CYAML_UNLIMITED),
+		CYAML_FIELD_SEQUENCE("u16", CYAML_FLAG_DEFAULT,
+				struct target_struct, u16, &u16_schema,
+				0, 2),
+		CYAML_FIELD_SEQUENCE("i64", CYAML_FLAG_FLOW,
+				struct target_struct, i64, &i64_schema,
+				0, 2),
+		CYAML_FIELD_SEQUENCE("u64", CYAML_FLAG_POINTER |
+				CYAML_FLAG_FLOW,
+				struct target_struct, u64, &u64_schema,
+				0, CYAML_UNLIMITED),
+		CYAML_FIELD_SEQUENCE("f", CYAML_FLAG_POINTER |
+				CYAML_FLAG_FLOW,
+				struct target_struct, f, &f_schema,
+				0, CYAML_UNLIMITED),
+		CYAML_FIELD_SEQUENCE_FIXED("d", CYAML_FLAG_FLOW,
+				struct target_struct, d, &d_schema, 2),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	char *buffer = NULL;
+	test_data_t td = {
+		.buffer = &buffer,
+		.config = config,
+	};
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	return test_save_fast_emit_check(&tc, &td, config, &top_schema,
+			&data, ref, YAML_LEN(ref));
+}
+
+/**
+ * Test saving pointer values that are reached more than once as aliases.
+ *
+ * \param[in]  report  The test report context.
+ * \param[in]  config  The CYAML config to use for the test.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_save_alias_shared(
+		ttest_report_ctx_t *report,
+		const cyaml_config_t *config)
+{
+	static const unsigned char ref[] =
+		"---\n"
+		"a: &a1\n"
+		"  x: 1\n"
+		"  y: 2\n"
+		"b: *a1\n"
+		"c:\n"
+		"  x: 1\n"
+		"  y: 2\n"
+		"name: &a2 hello\n"
+		"label: *a2\n"
+		"list: &a3 [1, 2, 3]\n"
+		"copy: *a3\n"
+		"short: [1, 2]\n"
+		"...\n";
+	struct point {
+		int x;
+		int y;
+	};
+	static struct point p = { .x = 1, .y = 2 };
+	static struct point q = { .x = 1, .y = 2 };
+	static char name[] = "hello";
+	static int list[] = { 1, 2, 3 };
+	static const struct target_struct {
+		struct point *a;
+		struct point *b;
+		struct point *c;
+		char *name;
+		char *label;
+		int *list;
+		unsigned list_count;
+		int *copy;
+		unsigned copy_count;
+		int *short_list;
+		unsigned short_list_count;
+	} data = {
+		.a = &p,
+		.b = &p,
+		.c = &q,
+		.name = name,
+		.label = name,
+		.list = list,
+		.list_count = 3,
+		.copy = list,
+		.copy_count = 3,
+		.short_list = list,
+		.short_list_count = 2,
+	};
+	static const struct cyaml_schema_field point_schema[] = {
+		CYAML_FIELD_INT("x", CYAML_FLAG_DEFAULT, struct point, x),
+		CYAML_FIELD_INT("y", CYAML_FLAG_DEFAULT, struct point, y),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value entry_schema = {
+		CYAML_VALUE_INT(CYAML_FLAG_DEFAULT, int),
+	};
+	static const struct cyaml_schema_field mapping_schema[] = {
+		CYAML_FIELD_MAPPING_PTR("a", CYAML_FLAG_DEFAULT,
+				struct target_struct, a, point_schema),
+		CYAML_FIELD_MAPPING_PTR("b", CYAML_FLAG_DEFAULT,
+				struct target_struct, b, point_schema),
+		CYAML_FIELD_MAPPING_PTR("c", CYAML_FLAG_DEFAULT,
+				struct target_struct, c, point_schema),
+		CYAML_FIELD_STRING_PTR("name", CYAML_FLAG_DEFAULT,
+				struct target_struct, name, 0, CYAML_UNLIMITED),
+		CYAML_FIELD_STRING_PTR("label", CYAML_FLAG_DEFAULT,
+				struct target_struct, label,
+				0, CYAML_UNLIMITED),
+		CYAML_FIELD_SEQUENCE("list", CYAML_FLAG_POINTER |
+				CYAML_FLAG_FLOW,
+				struct target_struct, list,
+				&entry_schema, 0, CYAML_UNLIMITED),
+		CYAML_FIELD_SEQUENCE("copy", CYAML_FLAG_POINTER |
+				CYAML_FLAG_FLOW,
+				struct target_struct, copy,
+				&entry_schema, 0, CYAML_UNLIMITED),
+		CYAML_FIELD_SEQUENCE("short", CYAML_FLAG_POINTER |
+				CYAML_FLAG_FLOW,
+				struct target_struct, short_list,
+				&entry_schema, 0, CYAML_UNLIMITED),
+		CYAML_FIELD_END
+	};
+	static const struct cyaml_schema_value top_schema = {
+		CYAML_VALUE_MAPPING(CYAML_FLAG_POINTER,
+				struct target_struct, mapping_schema),
+	};
+	cyaml_config_t cfg = *config;
+	char *buffer = NULL;
+	test_data_t td = {
+		.buffer = &buffer,
+		.config = &cfg,
+	};
+
+	ttest_ctx_t tc = ttest_start(report, __func__, cyaml_cleanup, &td);
+
+	cfg.flags |= CYAML_CFG_ALIASES;
+
+	/* The native emitter isn't used when aliases are enabled. */
+	return test_save_fast_emit_check(&tc, &td, &cfg, &top_schema,
+			&data, ref, YAML_LEN(ref));
+}
+
 /**
  * Run the YAML saving unit tests.
  *
@@ -3692,6 +5499,9 @@ bool save_tests(
 	pass &= test_save_mapping_entry_uint(rc, &config);
 	pass &= test_save_mapping_entry_float(rc, &config);
 	pass &= test_save_mapping_entry_double(rc, &config);
+	pass &= test_save_mapping_entry_float_precise(rc, &config);
+	pass &= test_save_mapping_entry_double_precise(rc, &config);
+	pass &= test_save_mapping_entry_int_limits(rc, &config);
 	pass &= test_save_mapping_entry_string(rc, &config);
 	pass &= test_save_mapping_entry_int_64(rc, &config);
 	pass &= test_save_mapping_entry_int_pos(rc, &config);
@@ -3757,5 +5567,52 @@ bool save_tests(
 	pass &= test_save_sequence_config_block_style(rc, &config);
 	pass &= test_save_schema_top_level_sequence_fixed(rc, &config);
 
+	ttest_heading(rc, "Save tests: output sinks");
+
+	pass &= test_save_buffer_growth(rc, &config);
+	pass &= test_save_buffer_fixed(rc, &config);
+	pass &= test_save_buffer_fixed_too_small(rc, &config);
+	pass &= test_save_stream(rc, &config);
+	pass &= test_save_stream_write_error(rc, &config);
+	pass &= test_save_fd(rc, &config);
+	pass &= test_save_fd_bad(rc, &config);
+
+	ttest_heading(rc, "Save tests: reusable saver");
+
+	pass &= test_save_saver_reuse(rc, &config);
+	pass &= test_save_saver_after_error(rc, &config);
+
+	ttest_heading(rc, "Save tests: incremental writer");
+
+	pass &= test_save_writer_documents(rc, &config);
+	pass &= test_save_writer_sequence(rc, &config);
+	pass &= test_save_writer_misuse(rc, &config);
+
+	ttest_heading(rc, "Save tests: indexed enums");
+
+	pass &= test_save_enum_indexed(rc, &config);
+
+	ttest_heading(rc, "Save tests: compiled schemas");
+
+	pass &= test_save_schema_compiled(rc, &config);
+
+	ttest_heading(rc, "Save tests: statistics");
+
+	pass &= test_save_stats(rc, &config);
+
+	ttest_heading(rc, "Save tests: native emitter");
+
+	pass &= test_save_fast_emit_scalars(rc, &config);
+	pass &= test_save_fast_emit_flow(rc, &config);
+	pass &= test_save_fast_emit_write_error(rc, &config);
+
+	ttest_heading(rc, "Save tests: bulk numeric sequences");
+
+	pass &= test_save_sequence_bulk(rc, &config);
+
+	ttest_heading(rc, "Save tests: aliases");
+
+	pass &= test_save_alias_shared(rc, &config);
+
 	return pass;
 }
@@ -7,6 +7,7 @@
 #include <stdbool.h>
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
 
 #include <cyaml/cyaml.h>
 
@@ -239,6 +240,128 @@ static bool test_utf8_strcmp_mismatches(
 	return pass;
 }
 
+/**
+ * Test comparing and hashing long strings, which use the ASCII fast path.
+ *
+ * \param[in]  report  The test report context.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_utf8_strcmp_long(
+		ttest_report_ctx_t *report)
+{
+	static const char upper[] = "THE QUICK BROWN FOX JUMPS OVER "
+			"THE LAZY DOG @[`{ 0123456789";
+	static const char lower[] = "the quick brown fox jumps over "
+			"the lazy dog @[`{ 0123456789";
+	ttest_ctx_t tc = ttest_start(report, __func__, NULL, NULL);
+	char a[sizeof(upper) + 8];
+	char b[sizeof(upper) + 8];
+
+	/* A difference at every offset, from every starting alignment. */
+	for (unsigned start = 0; start < 8; start++) {
+		for (unsigned i = start; i < SLEN(upper); i++) {
+			memcpy(a, upper + start, sizeof(upper) - start);
+			memcpy(b, lower + start, sizeof(lower) - start);
+
+			if (cyaml_utf8_casecmp(a, b) != 0) {
+				return ttest_fail(&tc, "Strings don't match: "
+						"%s and %s", a, b);
+			}
+			if (cyaml_utf8_casehash(a) != cyaml_utf8_casehash(b)) {
+				return ttest_fail(&tc, "Hash mismatch: "
+						"%s and %s", a, b);
+			}
+
+			b[i - start] = '~';
+			if (cyaml_utf8_casecmp(a, b) >= 0 ||
+			    cyaml_utf8_casecmp(b, a) <= 0) {
+				return ttest_fail(&tc, "Bad ordering: "
+						"%s and %s", a, b);
+			}
+
+			b[i - start] = '\0';
+			if (cyaml_utf8_casecmp(a, b) != -1 ||
+			    cyaml_utf8_casecmp(b, a) != 1) {
+				return ttest_fail(&tc, "Bad prefix ordering: "
+						"%s and %s", a, b);
+			}
+		}
+	}
+
+	/* Multi-byte characters after, between, and before ASCII runs. */
+	if (cyaml_utf8_casecmp(u8"ABCDEFGHIJKLMNOPÀÁÂĀĂĄ",
+			u8"abcdefghijklmnopàáâāăą") != 0 ||
+	    cyaml_utf8_casecmp(u8"ÀABCDEFGHIJKLMNOPÁQRSTUVWXYZ",
+			u8"àabcdefghijklmnopáqrstuvwxyz") != 0 ||
+	    cyaml_utf8_casecmp(u8"ÀÁÂĀĂĄABCDEFGHIJKLMNOP",
+			u8"àáâāăąabcdefghijklmnop") != 0 ||
+	    cyaml_utf8_casecmp(u8"ABCDEFGHIJKLMNOPÀ",
+			u8"abcdefghijklmnopá") == 0) {
+		return ttest_fail(&tc, "Incorrect mixed comparison");
+	}
+	if (cyaml_utf8_casehash(u8"ABCDEFGHIJKLMNOPÀÁÂĀĂĄ") !=
+	    cyaml_utf8_casehash(u8"abcdefghijklmnopàáâāăą") ||
+	    cyaml_utf8_casehash(u8"ÀABCDEFGHIJKLMNOPÁQRSTUVWXYZ") !=
+	    cyaml_utf8_casehash(u8"àabcdefghijklmnopáqrstuvwxyz")) {
+		return ttest_fail(&tc, "Incorrect mixed hash");
+	}
+
+	return ttest_pass(&tc);
+}
+
+/**
+ * Test hashing strings that match.
+ *
+ * \param[in]  report  The test report context.
+ * \return true if test passes, false otherwise.
+ */
+static bool test_utf8_casehash_matches(
+		ttest_report_ctx_t *report)
+{
+	static const struct string_pairs {
+		const char *a;
+		const char *b;
+	} pairs[] = {
+		{ "", "" },
+		{ "This is a TEST", "this is A test" },
+		{ u8"ÀÁÂÃÄÅÆÇÈÉÊËÌÍÎÏÐÑÒÓÔÕÖ", u8"àáâãäåæçèéêëìíîïðñòóôõö" },
+		{ u8"ĀĂĄĆĈĊČĎĐĒĔĖĘĚĜĞ", u8"āăąćĉċčďđēĕėęěĝğ" },
+		{ u8"ŊŌŎŐŒŔŖŘŚŜŞŠŢŤŦŨŪŬŮŰŲŴŶ", u8"ŋōŏőœŕŗřśŝşšţťŧũūŭůűųŵŷ" },
+		{ u8"ǍǏǑǓǕǗǙǛ", u8"ǎǐǒǔǖǘǚǜ" },
+		{ u8"\u01c4", u8"\u01c6" },
+		{ u8"\u0243", u8"\u0180" },
+		{ "\xF0\x9F\x98\xB8", "\xF0\x9F\x98\xB8" },
+		{ "A\xc2""C", u8"A\ufffdC" },
+		{ "\xfa", "\xfb" },
+	};
+	bool pass = true;
+
+	for (unsigned i = 0; i < CYAML_ARRAY_LEN(pairs); i++) {
+		ttest_ctx_t tc;
+		char name[sizeof(__func__) + 32];
+		sprintf(name, "%s_%u", __func__, i);
+
+		tc = ttest_start(report, name, NULL, NULL);
+
+		if (cyaml_utf8_casecmp(pairs[i].a, pairs[i].b) != 0) {
+			pass &= ttest_fail(&tc, "Strings don't match: "
+					"%s and %s", pairs[i].a, pairs[i].b);
+			continue;
+		}
+
+		if (cyaml_utf8_casehash(pairs[i].a) !=
+		    cyaml_utf8_casehash(pairs[i].b)) {
+			pass &= ttest_fail(&tc, "Hash mismatch: "
+					"%s and %s", pairs[i].a, pairs[i].b);
+			continue;
+		}
+
+		pass &= ttest_pass(&tc);
+	}
+
+	return pass;
+}
+
 /**
  * Run the CYAML util unit tests.
  *
@@ -266,6 +389,11 @@ bool utf8_tests(
 	pass &= test_utf8_strcmp_same(rc);
 	pass &= test_utf8_strcmp_matches(rc);
 	pass &= test_utf8_strcmp_mismatches(rc);
+	pass &= test_utf8_strcmp_long(rc);
+
+	ttest_heading(rc, "UTF-8 tests: String hashing");
+
+	pass &= test_utf8_casehash_matches(rc);
 
 	return pass;
 }
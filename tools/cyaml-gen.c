@@ -0,0 +1,112 @@
+/*
+ * SPDX-License-Identifier: ISC
+ *
+ * Copyright (C) 2019 Michael Drake <tlsa@netsurf-browser.org>
+ */
+
+/**
+ * \file
+ * \brief Build time tool to generate specialised code for a schema.
+ *
+ * This is built together with the client's schema, and must be compiled
+ * with the following defined:
+ *
+ * - `CYAML_GEN_HEADER`: String literal name of the header declaring the
+ *   schema, which is also included by the generated source.
+ * - `CYAML_GEN_SCHEMA`: Name of the top level \ref cyaml_schema_value_t.
+ *
+ * The Makefile's `gen` target does this.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <cyaml/cyaml.h>
+#include <cyaml/gen.h>
+
+#include "../src/gen.h"
+
+#include CYAML_GEN_HEADER
+
+/** Helper macro to expand a macro argument, and make it a string. */
+#define CYAML_GEN_STR(_x) CYAML_GEN_STR_(_x)
+/** Helper macro to make a macro argument a string. */
+#define CYAML_GEN_STR_(_x) #_x
+
+/**
+ * Open a file to write, or report failure.
+ *
+ * \param[in]  path  Path to the file.
+ * \return the open file, or NULL on failure.
+ */
+static FILE * open_output(const char *path)
+{
+	FILE *file = fopen(path, "w");
+
+	if (file == NULL) {
+		fprintf(stderr, "ERROR: Failed to open '%s'\n", path);
+	}
+
+	return file;
+}
+
+/**
+ * Main entry point.
+ *
+ * \param[in]  argc  Argument count.
+ * \param[in]  argv  Command line arguments.
+ * \return Program exit code.
+ */
+int main(int argc, char *argv[])
+{
+	static const char * const includes[] = {
+		CYAML_GEN_HEADER,
+		NULL,
+	};
+	static const cyaml_config_t config = {
+		.log_fn = cyaml_log,
+		.mem_fn = cyaml_mem,
+		.log_level = CYAML_LOG_WARNING,
+	};
+	cyaml_gen_options_t options = {
+		.schema = "&" CYAML_GEN_STR(CYAML_GEN_SCHEMA),
+		.includes = includes,
+	};
+	cyaml_err_t err;
+	FILE *source;
+	FILE *header;
+
+	if (argc != 4) {
+		fprintf(stderr, "Usage:\n");
+		fprintf(stderr, "  %s <PREFIX> <SOURCE> <HEADER>\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	options.prefix = argv[1];
+
+	source = open_output(argv[2]);
+	if (source == NULL) {
+		return EXIT_FAILURE;
+	}
+	header = open_output(argv[3]);
+	if (header == NULL) {
+		fclose(source);
+		return EXIT_FAILURE;
+	}
+
+	err = cyaml_gen_write(source, header, &config,
+			&CYAML_GEN_SCHEMA, &options);
+	if (fclose(source) != 0 && err == CYAML_OK) {
+		err = CYAML_ERR_FILE_WRITE;
+	}
+	if (fclose(header) != 0 && err == CYAML_OK) {
+		err = CYAML_ERR_FILE_WRITE;
+	}
+	if (err != CYAML_OK) {
+		fprintf(stderr, "ERROR: %s\n", cyaml_strerror(err));
+		remove(argv[2]);
+		remove(argv[3]);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}